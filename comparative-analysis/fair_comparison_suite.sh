@@ -20,6 +20,10 @@ COMMON_FLAGS="-nostdlib -nostartfiles -ffreestanding -O2 -g3 -Wall -Wextra"
 RISCV_FLAGS="$COMMON_FLAGS -march=rv64imac -mabi=lp64"
 CHERI_FLAGS="$COMMON_FLAGS --config cheribsd-riscv64-purecap"
 
+# *-baremetal tests link the shared runtime (crt0, heap/stack layout, HTIF exit)
+RUNTIME_DIR="$PROJECT_ROOT/extreme-details/runtime"
+RUNTIME_FLAGS="-I$RUNTIME_DIR $RUNTIME_DIR/crt0.S $RUNTIME_DIR/string.c -T $RUNTIME_DIR/baremetal.ld"
+
 echo "====================================="
 echo "FAIR COMPARISON TEST SUITE"
 echo "====================================="
@@ -41,10 +45,16 @@ run_comparison_test() {
     
     local riscv_exe="$RESULTS_DIR/${test_name}_riscv"
     local cheri_exe="$RESULTS_DIR/${test_name}_cheri"
+    local riscv_runtime=""
+    local cheri_runtime=""
+    if [[ "$source_file" == *-baremetal.c ]]; then
+        riscv_runtime="-mcmodel=medany $RUNTIME_FLAGS"
+        cheri_runtime="$RUNTIME_FLAGS"
+    fi
     
     # Build Standard RISC-V version
     echo "Building Standard RISC-V version..."
-    if $RISCV_CC $RISCV_FLAGS -o "$riscv_exe" "$source_file" 2>"$RESULTS_DIR/${test_name}_riscv_build.log"; then
+    if $RISCV_CC $RISCV_FLAGS $riscv_runtime -o "$riscv_exe" "$source_file" 2>"$RESULTS_DIR/${test_name}_riscv_build.log"; then
         echo "✅ Standard RISC-V build successful"
         
         # Get size information
@@ -59,7 +69,7 @@ run_comparison_test() {
     
     # Build CHERI version
     echo "Building CHERI version..."
-    if $CHERI_CC $CHERI_FLAGS -o "$cheri_exe" "$source_file" 2>"$RESULTS_DIR/${test_name}_cheri_build.log"; then
+    if $CHERI_CC $CHERI_FLAGS $cheri_runtime -o "$cheri_exe" "$source_file" 2>"$RESULTS_DIR/${test_name}_cheri_build.log"; then
         echo "✅ CHERI build successful"
         
         # Get size information
@@ -87,9 +97,10 @@ run_comparison_test() {
     echo "CHERI Overhead: $overhead bytes ($overhead_percent%)"
     echo ""
     
-    # If it's a performance test, note that we can't run cross-compiled binaries
+    # Performance tests are timed on the simulator or in QEMU, not here
     if [[ "$test_type" == "performance" ]]; then
-        echo "Note: Performance tests built for analysis. Cross-platform execution not supported."
+        echo "Note: Performance tests are linked with the bare-metal runtime; time them with"
+        echo "      make simulate-baremetal (rvsim) or make run-baremetal-qemu."
         echo "Binary analysis completed. See build logs for compiler output."
     fi
     
@@ -0,0 +1,286 @@
+/*
+ * qtrace - Allocation Trace Hook for qsim
+ *
+ * LD_PRELOAD interposer that records every malloc-family call of a live
+ * program in qsim's trace format (qsim.h):
+ *
+ *   LD_PRELOAD=emulation/qsim/libqtrace.so QTRACE_FILE=app.%p.qtrace ./app
+ *
+ * QTRACE_FILE names the trace ("%p" becomes the process id; default
+ * qtrace.<pid>.out). Timestamps are nanoseconds since the hook loaded.
+ * Lines are formatted by hand into a buffer flushed with write(2), so the
+ * hook never allocates itself, and a mutex keeps threads' lines whole and
+ * in timestamp order. Frees are logged before the block is released and
+ * allocations after they return, so when another thread gets the same
+ * address back the trace shows the free first. realloc() keeps the trace
+ * lock from before the real call until its event is written, so a block it
+ * moves away from cannot show up in another thread's allocation first.
+ * A forked child stops tracing rather than share the parent's file.
+ */
+
+#define _GNU_SOURCE
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define TRACE_BUFFER        (64 * 1024)
+#define LINE_MAX_LEN        96
+#define BOOTSTRAP_BYTES     (64 * 1024)     // Served while dlsym() allocates
+
+static void *(*real_malloc)(size_t);
+static void (*real_free)(void *);
+static void *(*real_calloc)(size_t, size_t);
+static void *(*real_realloc)(void *, size_t);
+static int (*real_posix_memalign)(void **, size_t, size_t);
+static void *(*real_aligned_alloc)(size_t, size_t);
+static void *(*real_memalign)(size_t, size_t);
+
+// Recursive: realloc() holds it across the real call and its own event
+static pthread_mutex_t trace_lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+static char trace_buffer[TRACE_BUFFER];
+static size_t trace_used;
+static int trace_fd = -1;
+static uint64_t trace_start_ns;
+
+static _Alignas(16) char bootstrap[BOOTSTRAP_BYTES];
+static size_t bootstrap_used;
+static int resolving;
+
+static inline int from_bootstrap(const void *p) {
+    return (const char *)p >= bootstrap && (const char *)p < bootstrap + BOOTSTRAP_BYTES;
+}
+
+static void *bootstrap_alloc(size_t size) {
+    size = (size + 15) & ~(size_t)15;
+    if (size > BOOTSTRAP_BYTES - bootstrap_used) return NULL;
+    void *p = bootstrap + bootstrap_used;
+    bootstrap_used += size;
+    return p;   // Static storage, already zero
+}
+
+static void resolve(void) {
+    if (real_malloc || resolving) return;
+    resolving = 1;
+    real_free = dlsym(RTLD_NEXT, "free");
+    real_calloc = dlsym(RTLD_NEXT, "calloc");
+    real_realloc = dlsym(RTLD_NEXT, "realloc");
+    real_posix_memalign = dlsym(RTLD_NEXT, "posix_memalign");
+    real_aligned_alloc = dlsym(RTLD_NEXT, "aligned_alloc");
+    real_memalign = dlsym(RTLD_NEXT, "memalign");
+    real_malloc = dlsym(RTLD_NEXT, "malloc");
+    resolving = 0;
+}
+
+// ---------------------------------------------------------------------------
+// Trace output
+// ---------------------------------------------------------------------------
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void flush_locked(void) {
+    size_t done = 0;
+    while (done < trace_used) {
+        ssize_t n = write(trace_fd, trace_buffer + done, trace_used - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        done += (size_t)n;
+    }
+    trace_used = 0;
+}
+
+static char *put_dec(char *p, uint64_t v) {
+    char digits[20];
+    int n = 0;
+    do {
+        digits[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    while (n) *p++ = digits[--n];
+    return p;
+}
+
+static char *put_hex(char *p, uint64_t v) {
+    char digits[16];
+    int n = 0;
+    do {
+        digits[n++] = "0123456789abcdef"[v & 15];
+        v >>= 4;
+    } while (v);
+    while (n) *p++ = digits[--n];
+    return p;
+}
+
+/*
+ * One event: "<ns> <op> <a> [<b>] [<size>]". a and b are addresses; has_b
+ * and has_size say which of the trailing fields the op carries.
+ */
+static void trace_event(char op, const void *a, const void *b, int has_b, size_t size, int has_size) {
+    char line[LINE_MAX_LEN];
+    if (trace_fd < 0) return;
+
+    pthread_mutex_lock(&trace_lock);
+    if (trace_fd >= 0) {
+        char *p = put_dec(line, now_ns() - trace_start_ns);
+        *p++ = ' ';
+        *p++ = op;
+        *p++ = ' ';
+        p = put_hex(p, (uintptr_t)a);
+        if (has_b) {
+            *p++ = ' ';
+            p = put_hex(p, (uintptr_t)b);
+        }
+        if (has_size) {
+            *p++ = ' ';
+            p = put_dec(p, size);
+        }
+        *p++ = '\n';
+        size_t len = (size_t)(p - line);
+        if (trace_used + len > TRACE_BUFFER) flush_locked();
+        memcpy(trace_buffer + trace_used, line, len);
+        trace_used += len;
+    }
+    pthread_mutex_unlock(&trace_lock);
+}
+
+static void before_fork(void) {
+    pthread_mutex_lock(&trace_lock);
+}
+
+static void after_fork_parent(void) {
+    pthread_mutex_unlock(&trace_lock);
+}
+
+static void after_fork_child(void) {
+    trace_fd = -1;          // The parent keeps the file
+    trace_used = 0;
+    pthread_mutex_unlock(&trace_lock);
+}
+
+// QTRACE_FILE with each "%p" replaced by the process id
+static void trace_path(char *buf, size_t len) {
+    const char *pattern = getenv("QTRACE_FILE");
+    if (!pattern || !*pattern) pattern = "qtrace.%p.out";
+    char pid[24];
+    *put_dec(pid, (uint64_t)getpid()) = '\0';
+
+    size_t used = 0;
+    for (const char *s = pattern; *s && used + 1 < len; s++) {
+        if (s[0] == '%' && s[1] == 'p') {
+            for (const char *d = pid; *d && used + 1 < len; d++) buf[used++] = *d;
+            s++;
+        } else {
+            buf[used++] = *s;
+        }
+    }
+    buf[used] = '\0';
+}
+
+__attribute__((constructor)) static void qtrace_start(void) {
+    static const char header[] = "# qtrace v1: <ns> m <addr> <size> | f <addr> | r <old> <new> <size>\n";
+    char path[4096];
+
+    resolve();
+    trace_path(path, sizeof(path));
+    trace_start_ns = now_ns();
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return;
+
+    pthread_mutex_lock(&trace_lock);
+    memcpy(trace_buffer, header, sizeof(header) - 1);
+    trace_used = sizeof(header) - 1;
+    trace_fd = fd;
+    pthread_mutex_unlock(&trace_lock);
+    pthread_atfork(before_fork, after_fork_parent, after_fork_child);
+}
+
+__attribute__((destructor)) static void qtrace_stop(void) {
+    pthread_mutex_lock(&trace_lock);
+    if (trace_fd >= 0) {
+        flush_locked();
+        close(trace_fd);
+        trace_fd = -1;
+    }
+    pthread_mutex_unlock(&trace_lock);
+}
+
+// ---------------------------------------------------------------------------
+// Interposed functions
+// ---------------------------------------------------------------------------
+
+void *malloc(size_t size) {
+    resolve();
+    if (!real_malloc) return bootstrap_alloc(size);
+    void *p = real_malloc(size);
+    if (p) trace_event('m', p, NULL, 0, size, 1);
+    return p;
+}
+
+void free(void *p) {
+    if (!p || from_bootstrap(p)) return;
+    resolve();
+    trace_event('f', p, NULL, 0, 0, 0);
+    real_free(p);
+}
+
+void *calloc(size_t count, size_t size) {
+    resolve();
+    if (!real_calloc) return bootstrap_alloc(count && size > SIZE_MAX / count ? SIZE_MAX : count * size);
+    void *p = real_calloc(count, size);
+    if (p) trace_event('m', p, NULL, 0, count * size, 1);
+    return p;
+}
+
+void *realloc(void *old, size_t size) {
+    resolve();
+    if (from_bootstrap(old)) {
+        // Never released; copy out what the old block could have held
+        void *p = malloc(size);
+        size_t room = (size_t)(bootstrap + BOOTSTRAP_BYTES - (char *)old);
+        if (p) memcpy(p, old, size < room ? size : room);
+        return p;
+    }
+    if (!real_realloc) return bootstrap_alloc(size);
+    if (old && size == 0) {
+        free(old);
+        return NULL;
+    }
+    if (trace_fd < 0) return real_realloc(old, size);
+    pthread_mutex_lock(&trace_lock);
+    void *p = real_realloc(old, size);
+    if (p) trace_event('r', old, p, 1, size, 1);
+    pthread_mutex_unlock(&trace_lock);
+    return p;
+}
+
+int posix_memalign(void **out, size_t alignment, size_t size) {
+    resolve();
+    int err = real_posix_memalign(out, alignment, size);
+    if (err == 0 && *out) trace_event('m', *out, NULL, 0, size, 1);
+    return err;
+}
+
+void *aligned_alloc(size_t alignment, size_t size) {
+    resolve();
+    void *p = real_aligned_alloc(alignment, size);
+    if (p) trace_event('m', p, NULL, 0, size, 1);
+    return p;
+}
+
+void *memalign(size_t alignment, size_t size) {
+    resolve();
+    void *p = real_memalign(alignment, size);
+    if (p) trace_event('m', p, NULL, 0, size, 1);
+    return p;
+}
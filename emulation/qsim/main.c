@@ -0,0 +1,377 @@
+/*
+ * qsim - Command Line Driver
+ *
+ * Replays each trace once through the reuse tracker (reuse.c) and every
+ * quarantine policy (policy.c), then prints the reuse distances per size
+ * class and, per policy kind, the memory held against the protection
+ * window for each limit. Machine-readable lines follow the workloads'
+ * format, with the trace in place of the workload:
+ *
+ *   RESULT,<trace>,reuse,<class>_<metric>,<value>,<unit>
+ *   RESULT,<trace>,<policy>,<metric>,<value>,<unit>
+ */
+
+#include "qsim.h"
+
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_LIMITS_PER_KIND     32
+
+static const char *const default_limits[QS_POLICY_KINDS] = {
+    "16,64,256,1K,4K,16K,64K,256K",
+    "64K,256K,1M,4M,16M,64M,256M",
+    "10us,100us,1ms,10ms,100ms,1s",
+};
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [options] <trace>...\n", prog);
+    fprintf(stderr, "  -q kind=v,...  Quarantine limits to simulate (repeatable; replaces the defaults)\n");
+    fprintf(stderr, "                 fifo=<blocks>, bytes=<size> (K/M/G suffixes), time=<ns|us|ms|s>\n");
+    fprintf(stderr, "  -l <label>     Trace name in RESULT lines (default: the file name)\n");
+    fprintf(stderr, "Traces come from hook/libqtrace.so (see README.md); '-' reads stdin.\n");
+    exit(2);
+}
+
+static const char *base_name(const char *path) {
+    const char *slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+// ---------------------------------------------------------------------------
+// Policy list
+// ---------------------------------------------------------------------------
+
+// "4K" -> 4096, "10ms" -> 10000000; 0 on success
+static int parse_limit(qs_policy_kind_t kind, const char *text, uint64_t *limit) {
+    char *end;
+    uint64_t v = strtoull(text, &end, 10);
+    if (end == text) return -1;
+    if (kind == QS_POLICY_TIME) {
+        if (strcmp(end, "s") == 0) v *= 1000000000ull;
+        else if (strcmp(end, "ms") == 0) v *= 1000000ull;
+        else if (strcmp(end, "us") == 0) v *= 1000ull;
+        else if (strcmp(end, "ns") != 0 && *end != '\0') return -1;
+    } else {
+        if (strcmp(end, "K") == 0) v <<= 10;
+        else if (strcmp(end, "M") == 0) v <<= 20;
+        else if (strcmp(end, "G") == 0) v <<= 30;
+        else if (*end != '\0') return -1;
+    }
+    *limit = v;
+    return v ? 0 : -1;
+}
+
+// Append one policy per value of "kind=v1,v2,..."
+static int add_policies(qs_policy_t *policies, int *count, const char *spec) {
+    char buf[512];
+    snprintf(buf, sizeof(buf), "%s", spec);
+    char *eq = strchr(buf, '=');
+    if (!eq) return -1;
+    *eq = '\0';
+
+    int kind = 0;
+    while (kind < QS_POLICY_KINDS && strcmp(buf, qs_policy_kind_name((qs_policy_kind_t)kind)) != 0) kind++;
+    if (kind == QS_POLICY_KINDS) return -1;
+
+    int values = 0;
+    for (char *v = strtok(eq + 1, ","); v; v = strtok(NULL, ",")) {
+        uint64_t limit;
+        if (*count == QS_MAX_POLICIES || ++values > MAX_LIMITS_PER_KIND) return -1;
+        if (parse_limit((qs_policy_kind_t)kind, v, &limit) != 0) return -1;
+        if (qs_policy_init(&policies[*count], (qs_policy_kind_t)kind, limit) != 0) return -1;
+        (*count)++;
+    }
+    return values ? 0 : -1;
+}
+
+// ---------------------------------------------------------------------------
+// Replay
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    qs_reuse_t reuse;
+    qs_live_t live;
+    qs_clock_t clock;
+    qs_policy_t *policies;
+    int policy_count;
+
+    uint64_t events;
+    uint64_t reallocs;
+    uint64_t unmatched_frees;   // Frees of blocks allocated before tracing began
+    uint64_t live_bytes;
+    uint64_t peak_live_bytes;
+    double live_sum;            // live_bytes summed over events, for the mean
+} replay_t;
+
+static void on_reuse(void *ctx, const qs_block_t *block, const qs_clock_t *now) {
+    replay_t *r = ctx;
+    for (int i = 0; i < r->policy_count; i++) qs_policy_reused(&r->policies[i], block, now);
+}
+
+static int replay_alloc(replay_t *r, uint64_t addr, uint64_t size) {
+    r->clock.allocs++;
+    r->clock.alloc_bytes += size;
+    qs_reuse_allocated(&r->reuse, addr, size, &r->clock, on_reuse, r);
+    r->live_bytes += size;
+    if (r->live_bytes > r->peak_live_bytes) r->peak_live_bytes = r->live_bytes;
+    return qs_live_put(&r->live, addr, size);
+}
+
+static int replay_free(replay_t *r, uint64_t addr) {
+    uint64_t size;
+    if (qs_live_take(&r->live, addr, &size) != 0) {
+        if (addr) r->unmatched_frees++;
+        return 0;
+    }
+    r->clock.frees++;
+    r->clock.free_bytes += size;
+    r->live_bytes -= size;
+    if (qs_reuse_freed(&r->reuse, addr, size, &r->clock) != 0) return -1;
+    for (int i = 0; i < r->policy_count; i++) {
+        if (qs_policy_freed(&r->policies[i], size, &r->clock) != 0) return -1;
+    }
+    return 0;
+}
+
+// In place: only growth can touch freed memory; otherwise the new block comes first
+static int replay_realloc(replay_t *r, uint64_t old_addr, uint64_t addr, uint64_t size) {
+    uint64_t old_size;
+    r->reallocs++;
+    if (old_addr == 0) return replay_alloc(r, addr, size);
+    if (old_addr != addr) {
+        if (replay_alloc(r, addr, size) != 0) return -1;
+        return replay_free(r, old_addr);
+    }
+    if (qs_live_take(&r->live, addr, &old_size) != 0) return replay_alloc(r, addr, size);
+    r->live_bytes -= old_size;
+    if (size > old_size) {
+        r->clock.alloc_bytes += size - old_size;
+        qs_reuse_allocated(&r->reuse, addr + old_size, size - old_size, &r->clock, on_reuse, r);
+    }
+    r->live_bytes += size;
+    if (r->live_bytes > r->peak_live_bytes) r->peak_live_bytes = r->live_bytes;
+    return qs_live_put(&r->live, addr, size);
+}
+
+static int replay(replay_t *r, qs_trace_t *t) {
+    qs_event_t e;
+    int status;
+    while ((status = qs_trace_next(t, &e)) > 0) {
+        // Threads can race to the trace lock; keep the clock monotonic
+        if (e.ns > r->clock.ns) r->clock.ns = e.ns;
+        switch (e.op) {
+        case QS_ALLOC: status = replay_alloc(r, e.addr, e.size); break;
+        case QS_FREE: status = replay_free(r, e.addr); break;
+        default: status = replay_realloc(r, e.old_addr, e.addr, e.size); break;
+        }
+        if (status != 0) {
+            fprintf(stderr, "qsim: out of memory at %s:%llu\n", t->path, (unsigned long long)t->line);
+            return -1;
+        }
+        for (int i = 0; i < r->policy_count; i++) qs_policy_tick(&r->policies[i], &r->clock);
+        r->live_sum += (double)r->live_bytes;
+        r->events++;
+    }
+    if (status < 0) {
+        fprintf(stderr, "qsim: %s:%llu: malformed line\n", t->path, (unsigned long long)t->line);
+        return -1;
+    }
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Report
+// ---------------------------------------------------------------------------
+
+static double mb(double bytes) {
+    return bytes / (1 << 20);
+}
+
+static double us(uint64_t ns) {
+    return (double)ns / 1000.0;
+}
+
+// A percentile column scaled by div, or "-" for an empty histogram
+static const char *percentile(char *buf, size_t len, const uint64_t *hist, double pct, double div, int decimals) {
+    if (qs_histogram_total(hist) == 0) snprintf(buf, len, "-");
+    else snprintf(buf, len, "%.*f", decimals, (double)qs_histogram_percentile(hist, pct) / div);
+    return buf;
+}
+
+// "16B", "4K", ..., ">64M"
+static void class_name(int c, char *buf, size_t len) {
+    uint64_t limit = 1ull << (QS_MIN_CLASS_SHIFT + c);
+    if (c == QS_CLASS_COUNT - 1) snprintf(buf, len, ">%lluM", (unsigned long long)(limit >> 21));
+    else if (limit >= (1 << 20)) snprintf(buf, len, "%lluM", (unsigned long long)(limit >> 20));
+    else if (limit >= (1 << 10)) snprintf(buf, len, "%lluK", (unsigned long long)(limit >> 10));
+    else snprintf(buf, len, "%lluB", (unsigned long long)limit);
+}
+
+static void report_reuse(const replay_t *r, const char *label) {
+    char name[16], col[6][24];
+    printf("REUSE DISTANCE BY SIZE CLASS (bucket upper bounds)\n");
+    printf("%-6s %10s %8s %11s %11s %10s %10s %10s %10s\n", "class", "frees", "reused", "p50 allocs",
+           "p90 allocs", "p50 MB", "p90 MB", "p50 us", "p90 us");
+    for (int c = 0; c < QS_CLASS_COUNT; c++) {
+        const qs_class_stats_t *s = &r->reuse.classes[c];
+        if (s->frees == 0) continue;
+        class_name(c, name, sizeof(name));
+        printf("%-6s %10llu %7.1f%% %11s %11s %10s %10s %10s %10s\n", name,
+               (unsigned long long)s->frees, 100.0 * (double)s->reused / (double)s->frees,
+               percentile(col[0], sizeof(col[0]), s->allocs, 50, 1, 0),
+               percentile(col[1], sizeof(col[1]), s->allocs, 90, 1, 0),
+               percentile(col[2], sizeof(col[2]), s->bytes, 50, 1 << 20, 2),
+               percentile(col[3], sizeof(col[3]), s->bytes, 90, 1 << 20, 2),
+               percentile(col[4], sizeof(col[4]), s->ns, 50, 1000, 1),
+               percentile(col[5], sizeof(col[5]), s->ns, 90, 1000, 1));
+    }
+    printf("\n");
+
+    for (int c = 0; c < QS_CLASS_COUNT; c++) {
+        const qs_class_stats_t *s = &r->reuse.classes[c];
+        if (s->frees == 0) continue;
+        class_name(c, name, sizeof(name));
+        printf("RESULT,%s,reuse,%s_frees,%llu,frees\n", label, name, (unsigned long long)s->frees);
+        printf("RESULT,%s,reuse,%s_reused_pct,%.2f,%%\n", label, name, 100.0 * (double)s->reused / (double)s->frees);
+        if (s->reused == 0) continue;
+        printf("RESULT,%s,reuse,%s_p50_allocs,%llu,allocs\n", label, name,
+               (unsigned long long)qs_histogram_percentile(s->allocs, 50));
+        printf("RESULT,%s,reuse,%s_p90_allocs,%llu,allocs\n", label, name,
+               (unsigned long long)qs_histogram_percentile(s->allocs, 90));
+        printf("RESULT,%s,reuse,%s_p50_bytes,%llu,bytes\n", label, name,
+               (unsigned long long)qs_histogram_percentile(s->bytes, 50));
+        printf("RESULT,%s,reuse,%s_p50_us,%.1f,us\n", label, name, us(qs_histogram_percentile(s->ns, 50)));
+    }
+    printf("\n");
+}
+
+/*
+ * One table per policy kind: the memory-versus-protection curve. Blocks
+ * still quarantined when the trace ends enter the windows with the time
+ * they have spent so far (qs_policy_finish()); "held" is their share.
+ */
+static void report_policies(const replay_t *r, const char *label) {
+    double mean_live = r->events ? r->live_sum / (double)r->events : 0;
+    char col[2][24];
+    for (int kind = 0; kind < QS_POLICY_KINDS; kind++) {
+        int header = 0;
+        for (int i = 0; i < r->policy_count; i++) {
+            const qs_policy_t *p = &r->policies[i];
+            if ((int)p->kind != kind) continue;
+            if (!header) {
+                printf("QUARANTINE: %s\n", qs_policy_kind_name(p->kind));
+                printf("%-14s %10s %10s %9s %13s %13s %9s %9s\n", "policy", "mean MB", "peak MB", "overhead",
+                       "window allocs", "window us", "held", "delayed");
+                header = 1;
+            }
+            double mean_held = p->events ? p->held_sum / (double)p->events : 0;
+            double overhead = mean_live > 0 ? 100.0 * mean_held / mean_live : 0;
+            double delayed = p->reuses ? 100.0 * (double)p->delayed / (double)p->reuses : 0;
+            uint64_t blocks = qs_histogram_total(p->window_allocs);
+            double held = blocks ? 100.0 * (double)p->unreleased / (double)blocks : 0;
+            printf("%-14s %10.2f %10.2f %8.1f%% %13s %13s %8.1f%% %8.1f%%\n", p->name, mb(mean_held),
+                   mb((double)p->peak_bytes), overhead, percentile(col[0], sizeof(col[0]), p->window_allocs, 50, 1, 0),
+                   percentile(col[1], sizeof(col[1]), p->window_ns, 50, 1000, 1), held, delayed);
+        }
+        if (header) printf("\n");
+    }
+
+    for (int i = 0; i < r->policy_count; i++) {
+        const qs_policy_t *p = &r->policies[i];
+        double mean_held = p->events ? p->held_sum / (double)p->events : 0;
+        printf("RESULT,%s,%s,mean_held_mb,%.3f,MB\n", label, p->name, mb(mean_held));
+        printf("RESULT,%s,%s,peak_held_mb,%.3f,MB\n", label, p->name, mb((double)p->peak_bytes));
+        printf("RESULT,%s,%s,overhead_pct,%.2f,%%\n", label, p->name, mean_live > 0 ? 100.0 * mean_held / mean_live : 0);
+        uint64_t blocks = qs_histogram_total(p->window_allocs);
+        if (blocks) {
+            printf("RESULT,%s,%s,window_p50_allocs,%llu,allocs\n", label, p->name,
+                   (unsigned long long)qs_histogram_percentile(p->window_allocs, 50));
+            printf("RESULT,%s,%s,window_p50_us,%.1f,us\n", label, p->name,
+                   us(qs_histogram_percentile(p->window_ns, 50)));
+            printf("RESULT,%s,%s,unreleased_pct,%.2f,%%\n", label, p->name,
+                   100.0 * (double)p->unreleased / (double)blocks);
+        }
+        printf("RESULT,%s,%s,delayed_reuse_pct,%.2f,%%\n", label, p->name,
+               p->reuses ? 100.0 * (double)p->delayed / (double)p->reuses : 0);
+    }
+    printf("\n");
+}
+
+int main(int argc, char **argv) {
+    qs_policy_t *policies = calloc(QS_MAX_POLICIES, sizeof(*policies));
+    const char *specs[QS_MAX_POLICIES];
+    int spec_count = 0;
+    const char *label = NULL;
+    int opt;
+
+    if (!policies) {
+        fprintf(stderr, "qsim: out of memory\n");
+        return 1;
+    }
+    while ((opt = getopt(argc, argv, "q:l:h")) != -1) {
+        switch (opt) {
+        case 'q':
+            if (spec_count == QS_MAX_POLICIES) usage(argv[0]);
+            specs[spec_count++] = optarg;
+            break;
+        case 'l': label = optarg; break;
+        case 'h':
+        default: usage(argv[0]);
+        }
+    }
+    if (optind >= argc) usage(argv[0]);
+
+    int status = 0;
+    for (int i = optind; i < argc; i++) {
+        replay_t r;
+        qs_trace_t trace;
+        memset(&r, 0, sizeof(r));
+        r.policies = policies;
+
+        // Fresh policies per trace
+        char spec[512];
+        for (int s = 0; s < (spec_count ? spec_count : QS_POLICY_KINDS); s++) {
+            if (spec_count) snprintf(spec, sizeof(spec), "%s", specs[s]);
+            else snprintf(spec, sizeof(spec), "%s=%s", qs_policy_kind_name((qs_policy_kind_t)s), default_limits[s]);
+            if (add_policies(policies, &r.policy_count, spec) != 0) {
+                fprintf(stderr, "qsim: bad quarantine '%s'\n", spec);
+                return 1;
+            }
+        }
+        if (qs_trace_open(&trace, argv[i]) != 0) {
+            fprintf(stderr, "qsim: %s: cannot open\n", argv[i]);
+            status = 1;
+        } else if (qs_live_init(&r.live) != 0) {
+            fprintf(stderr, "qsim: out of memory\n");
+            status = 1;
+        } else {
+            const char *name = label ? label : base_name(argv[i]);
+            qs_reuse_init(&r.reuse);
+            if (replay(&r, &trace) != 0) {
+                status = 1;
+            } else {
+                for (int p = 0; p < r.policy_count; p++) qs_policy_finish(&policies[p], &r.clock);
+                printf("==============================================\n");
+                printf("TRACE: %s\n", argv[i]);
+                printf("==============================================\n");
+                printf("Events: %llu (%llu allocations, %llu frees, %llu reallocs), %llu unmatched frees\n",
+                       (unsigned long long)r.events, (unsigned long long)r.clock.allocs,
+                       (unsigned long long)r.clock.frees, (unsigned long long)r.reallocs,
+                       (unsigned long long)r.unmatched_frees);
+                printf("Live heap: mean %.2f MB, peak %.2f MB; %.3f s traced\n\n",
+                       mb(r.events ? r.live_sum / (double)r.events : 0), mb((double)r.peak_live_bytes),
+                       (double)r.clock.ns / 1e9);
+                report_reuse(&r, name);
+                report_policies(&r, name);
+            }
+            qs_reuse_destroy(&r.reuse);
+        }
+        qs_live_destroy(&r.live);
+        qs_trace_close(&trace);
+        for (int p = 0; p < r.policy_count; p++) qs_policy_destroy(&policies[p]);
+    }
+    free(policies);
+    return status;
+}
@@ -0,0 +1,142 @@
+/*
+ * qsim - Quarantine Policies
+ *
+ * Each policy keeps its own FIFO of freed blocks, as a revoking allocator
+ * would between free() and handing the memory back:
+ *   fifo   - at most limit blocks; the oldest leaves when a new one comes
+ *   bytes  - at most limit bytes; the oldest leave until the rest fit
+ *   time   - every block stays limit nanoseconds
+ * Memory held is sampled after every trace event (mean and peak), and the
+ * protection window is how long each block stayed, in allocations and in
+ * nanoseconds. Blocks still held when the trace ends count with the time
+ * they have spent so far, a lower bound, so a policy that never releases
+ * anything shows the longest windows rather than none. For every reuse
+ * seen in the trace, a policy also says whether it would still have held
+ * the block at that point, i.e. whether it would have delayed the reuse:
+ * all three limits are monotonic in time, so that follows from the clocks
+ * at the free and at the reuse alone.
+ */
+
+#include "qsim.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define RING_INITIAL    1024
+
+static const char *const kind_names[QS_POLICY_KINDS] = { "fifo", "bytes", "time" };
+
+const char *qs_policy_kind_name(qs_policy_kind_t kind) {
+    return kind_names[kind];
+}
+
+// 4096 -> "4K", 1000000 ns -> "1ms"
+static void format_limit(char *buf, size_t len, qs_policy_kind_t kind, uint64_t limit) {
+    if (kind == QS_POLICY_TIME) {
+        static const char *const units[] = { "ns", "us", "ms", "s" };
+        int u = 0;
+        while (u < 3 && limit >= 1000 && limit % 1000 == 0) {
+            limit /= 1000;
+            u++;
+        }
+        snprintf(buf, len, "%llu%s", (unsigned long long)limit, units[u]);
+        return;
+    }
+    static const char suffixes[] = " KMGT";
+    int s = 0;
+    while (s < 4 && limit >= 1024 && limit % 1024 == 0) {
+        limit /= 1024;
+        s++;
+    }
+    if (s) snprintf(buf, len, "%llu%c", (unsigned long long)limit, suffixes[s]);
+    else snprintf(buf, len, "%llu", (unsigned long long)limit);
+}
+
+int qs_policy_init(qs_policy_t *p, qs_policy_kind_t kind, uint64_t limit) {
+    char value[24];
+    memset(p, 0, sizeof(*p));
+    p->kind = kind;
+    p->limit = limit;
+    format_limit(value, sizeof(value), kind, limit);
+    snprintf(p->name, sizeof(p->name), "%s=%s", kind_names[kind], value);
+    p->capacity = RING_INITIAL;
+    p->ring = malloc(p->capacity * sizeof(qs_entry_t));
+    return p->ring ? 0 : -1;
+}
+
+void qs_policy_destroy(qs_policy_t *p) {
+    free(p->ring);
+    p->ring = NULL;
+}
+
+static int ring_grow(qs_policy_t *p) {
+    qs_entry_t *bigger = malloc(2 * p->capacity * sizeof(qs_entry_t));
+    if (!bigger) return -1;
+    for (size_t i = 0; i < p->count; i++) bigger[i] = p->ring[(p->head + i) & (p->capacity - 1)];
+    free(p->ring);
+    p->ring = bigger;
+    p->capacity *= 2;
+    p->head = 0;
+    return 0;
+}
+
+// Release the oldest block
+static void evict(qs_policy_t *p, const qs_clock_t *now) {
+    const qs_entry_t *e = &p->ring[p->head];
+    p->window_allocs[qs_bucket(now->allocs - e->allocs)]++;
+    p->window_ns[qs_bucket(now->ns - e->ns)]++;
+    p->held_bytes -= e->size;
+    p->head = (p->head + 1) & (p->capacity - 1);
+    p->count--;
+}
+
+int qs_policy_freed(qs_policy_t *p, uint64_t size, const qs_clock_t *now) {
+    if (p->count == p->capacity && ring_grow(p) != 0) return -1;
+    qs_entry_t *e = &p->ring[(p->head + p->count) & (p->capacity - 1)];
+    e->size = size;
+    e->ns = now->ns;
+    e->allocs = now->allocs;
+    p->count++;
+    p->held_bytes += size;
+
+    if (p->kind == QS_POLICY_FIFO) {
+        while (p->count > p->limit) evict(p, now);
+    } else if (p->kind == QS_POLICY_BYTES) {
+        while (p->count && p->held_bytes > p->limit) evict(p, now);
+    }
+    if (p->held_bytes > p->peak_bytes) p->peak_bytes = p->held_bytes;
+    return 0;
+}
+
+void qs_policy_tick(qs_policy_t *p, const qs_clock_t *now) {
+    if (p->kind == QS_POLICY_TIME) {
+        while (p->count && now->ns - p->ring[p->head].ns >= p->limit) evict(p, now);
+    }
+    p->held_sum += (double)p->held_bytes;
+    p->events++;
+}
+
+void qs_policy_reused(qs_policy_t *p, const qs_block_t *block, const qs_clock_t *now) {
+    int held;
+    switch (p->kind) {
+    case QS_POLICY_FIFO:
+        // Blocks freed since, plus this one
+        held = now->frees - block->freed.frees + 1 <= p->limit;
+        break;
+    case QS_POLICY_BYTES:
+        held = now->free_bytes - block->freed.free_bytes + block->size <= p->limit;
+        break;
+    default:
+        held = now->ns - block->freed.ns < p->limit;
+        break;
+    }
+    p->reuses++;
+    p->delayed += held;
+}
+
+void qs_policy_finish(qs_policy_t *p, const qs_clock_t *now) {
+    while (p->count) {
+        evict(p, now);
+        p->unreleased++;
+    }
+}
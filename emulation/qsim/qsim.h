@@ -0,0 +1,197 @@
+/*
+ * qsim - Reuse-Distance and Quarantine-Sizing Analysis
+ *
+ * Temporal safety by revocation holds freed memory in quarantine until a
+ * sweep has removed every capability to it, so the quarantine decides both
+ * how long a stale pointer keeps faulting and how much memory sits idle.
+ * qsim replays an allocation trace (written by hook/qtrace.c from a live
+ * program, or by any tool that emits the same text format) and measures:
+ *   - reuse distance: for every freed block, the allocations, allocated
+ *     bytes and time until the allocator hands any of its bytes out again,
+ *     as log2 histograms per size class
+ *   - quarantine policies: FIFO (entry count), size-bounded (bytes held)
+ *     and time-bounded (nanoseconds), each swept over a range of limits,
+ *     reporting the memory held against the protection window it buys and
+ *     the share of observed reuses it would have delayed
+ * Everything is computed in one pass over the trace, so a trace can be
+ * streamed through a pipe while the program runs.
+ */
+
+#ifndef QSIM_H
+#define QSIM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define QS_MIN_CLASS_SHIFT      4       // Smallest size class: up to 16 bytes
+#define QS_CLASS_COUNT          24      // Up to 16 B, 32 B, ..., 64 MB, and larger
+#define QS_BUCKETS              48      // log2 buckets: 0, 1, 2-3, 4-7, ...
+#define QS_MAX_POLICIES         64
+
+// ---------------------------------------------------------------------------
+// Traces (trace.c)
+// ---------------------------------------------------------------------------
+
+/*
+ * One event per line, fields separated by spaces, addresses in hex, '#'
+ * starts a comment:
+ *   <ns> m <addr> <size>           malloc, calloc, aligned allocations
+ *   <ns> f <addr>                  free
+ *   <ns> r <old> <new> <size>      realloc (old 0: allocation)
+ */
+typedef enum {
+    QS_ALLOC = 0,
+    QS_FREE,
+    QS_REALLOC
+} qs_op_t;
+
+typedef struct {
+    uint64_t ns;
+    qs_op_t op;
+    uint64_t addr;              // New block (ALLOC, REALLOC) or freed block (FREE)
+    uint64_t old_addr;          // REALLOC: block being resized
+    uint64_t size;
+} qs_event_t;
+
+typedef struct {
+    FILE *file;
+    const char *path;
+    uint64_t line;
+} qs_trace_t;
+
+int qs_trace_open(qs_trace_t *t, const char *path);    // "-" reads stdin
+int qs_trace_next(qs_trace_t *t, qs_event_t *e);        // 1: event, 0: end, -1: malformed line
+void qs_trace_close(qs_trace_t *t);
+
+// Live blocks, address to size
+typedef struct {
+    uint64_t *keys;             // 0 marks an empty slot
+    uint64_t *sizes;
+    size_t capacity;            // Power of two
+    size_t count;
+} qs_live_t;
+
+int qs_live_init(qs_live_t *l);
+int qs_live_put(qs_live_t *l, uint64_t addr, uint64_t size);
+int qs_live_take(qs_live_t *l, uint64_t addr, uint64_t *size);  // 0 and the size if it was live
+void qs_live_destroy(qs_live_t *l);
+
+// ---------------------------------------------------------------------------
+// Clocks
+// ---------------------------------------------------------------------------
+
+// Every distance is measured on these counters, which only move forward
+typedef struct {
+    uint64_t ns;
+    uint64_t allocs;            // Allocations so far
+    uint64_t alloc_bytes;
+    uint64_t frees;             // Frees so far
+    uint64_t free_bytes;
+} qs_clock_t;
+
+static inline int qs_bucket(uint64_t v) {
+    int b = v ? 64 - __builtin_clzll(v) : 0;
+    return b < QS_BUCKETS ? b : QS_BUCKETS - 1;
+}
+
+// Largest value that falls in a bucket
+static inline uint64_t qs_bucket_limit(int b) {
+    return b == 0 ? 0 : b >= 64 ? UINT64_MAX : (1ull << b) - 1;
+}
+
+static inline int qs_size_class(uint64_t size) {
+    if (size <= (1ull << QS_MIN_CLASS_SHIFT)) return 0;
+    int c = 64 - __builtin_clzll(size - 1) - QS_MIN_CLASS_SHIFT;
+    return c < QS_CLASS_COUNT ? c : QS_CLASS_COUNT - 1;
+}
+
+// Upper bound of the bucket holding the pct-th percentile of a non-empty histogram
+uint64_t qs_histogram_percentile(const uint64_t *hist, double pct);
+uint64_t qs_histogram_total(const uint64_t *hist);
+
+// ---------------------------------------------------------------------------
+// Reuse distance (reuse.c)
+// ---------------------------------------------------------------------------
+
+typedef struct qs_block {
+    uint64_t addr;
+    uint64_t size;
+    qs_clock_t freed;           // Clocks just after the free
+    uint32_t priority;
+    struct qs_block *left, *right;
+} qs_block_t;
+
+typedef struct {
+    uint64_t frees;
+    uint64_t reused;
+    uint64_t allocs[QS_BUCKETS];    // Allocations between free and reuse
+    uint64_t bytes[QS_BUCKETS];     // Bytes allocated between free and reuse
+    uint64_t ns[QS_BUCKETS];
+} qs_class_stats_t;
+
+typedef void (*qs_reuse_fn)(void *ctx, const qs_block_t *block, const qs_clock_t *now);
+
+// Freed blocks whose memory has not been handed out again, ordered by address
+typedef struct {
+    qs_block_t *root;
+    size_t count;
+    uint32_t seed;
+    qs_class_stats_t classes[QS_CLASS_COUNT];
+} qs_reuse_t;
+
+void qs_reuse_init(qs_reuse_t *r);
+int qs_reuse_freed(qs_reuse_t *r, uint64_t addr, uint64_t size, const qs_clock_t *now);
+// Record the reuse of every freed block overlapping [addr, addr + size), calling fn for each
+void qs_reuse_allocated(qs_reuse_t *r, uint64_t addr, uint64_t size, const qs_clock_t *now,
+                        qs_reuse_fn fn, void *ctx);
+void qs_reuse_destroy(qs_reuse_t *r);
+
+// ---------------------------------------------------------------------------
+// Quarantine policies (policy.c)
+// ---------------------------------------------------------------------------
+
+typedef enum {
+    QS_POLICY_FIFO = 0,         // At most limit blocks
+    QS_POLICY_BYTES,            // At most limit bytes
+    QS_POLICY_TIME,             // Each block for limit nanoseconds
+    QS_POLICY_KINDS
+} qs_policy_kind_t;
+
+typedef struct {
+    uint64_t size;
+    uint64_t ns;
+    uint64_t allocs;
+} qs_entry_t;
+
+typedef struct {
+    qs_policy_kind_t kind;
+    uint64_t limit;
+    char name[32];
+
+    qs_entry_t *ring;           // Quarantined blocks, oldest first
+    size_t capacity;            // Power of two
+    size_t head;
+    size_t count;
+    uint64_t held_bytes;
+
+    // Results
+    uint64_t peak_bytes;
+    double held_sum;            // held_bytes summed over events, for the mean
+    uint64_t events;
+    uint64_t window_allocs[QS_BUCKETS];     // Allocations while a block was quarantined
+    uint64_t window_ns[QS_BUCKETS];
+    uint64_t unreleased;        // Blocks still held when the trace ended
+    uint64_t reuses;            // Reuses observed in the trace
+    uint64_t delayed;           // ... of blocks this policy would still hold
+} qs_policy_t;
+
+const char *qs_policy_kind_name(qs_policy_kind_t kind);
+int qs_policy_init(qs_policy_t *p, qs_policy_kind_t kind, uint64_t limit);
+int qs_policy_freed(qs_policy_t *p, uint64_t size, const qs_clock_t *now);
+void qs_policy_tick(qs_policy_t *p, const qs_clock_t *now);     // After every event
+void qs_policy_reused(qs_policy_t *p, const qs_block_t *block, const qs_clock_t *now);
+void qs_policy_finish(qs_policy_t *p, const qs_clock_t *now);   // At the end of the trace
+void qs_policy_destroy(qs_policy_t *p);
+
+#endif // QSIM_H
@@ -0,0 +1,159 @@
+/*
+ * qsim - Reuse Distance
+ *
+ * Freed blocks wait in a treap ordered by address until an allocation
+ * overlaps them. An allocator may split or merge free blocks, so reuse is
+ * any overlap, not only the same address coming back. Each freed block is
+ * reused at most once, and blocks in the treap never overlap one another:
+ * an allocation removes every freed block it touches. Per size class, the
+ * distance to that first reuse is histogrammed in allocations, allocated
+ * bytes and nanoseconds.
+ */
+
+#include "qsim.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+uint64_t qs_histogram_total(const uint64_t *hist) {
+    uint64_t total = 0;
+    for (int b = 0; b < QS_BUCKETS; b++) total += hist[b];
+    return total;
+}
+
+uint64_t qs_histogram_percentile(const uint64_t *hist, double pct) {
+    uint64_t total = qs_histogram_total(hist), seen = 0;
+    if (total == 0) return 0;
+    double want = pct / 100.0 * (double)total;
+    for (int b = 0; b < QS_BUCKETS; b++) {
+        seen += hist[b];
+        if ((double)seen >= want) return qs_bucket_limit(b);
+    }
+    return qs_bucket_limit(QS_BUCKETS - 1);
+}
+
+// ---------------------------------------------------------------------------
+// Treap
+// ---------------------------------------------------------------------------
+
+// Split t into blocks below key and blocks at or above it
+static void split(qs_block_t *t, uint64_t key, qs_block_t **below, qs_block_t **above) {
+    if (!t) {
+        *below = *above = NULL;
+    } else if (t->addr < key) {
+        split(t->right, key, &t->right, above);
+        *below = t;
+    } else {
+        split(t->left, key, below, &t->left);
+        *above = t;
+    }
+}
+
+// Every key of a is below every key of b
+static qs_block_t *merge(qs_block_t *a, qs_block_t *b) {
+    if (!a) return b;
+    if (!b) return a;
+    if (a->priority > b->priority) {
+        a->right = merge(a->right, b);
+        return a;
+    }
+    b->left = merge(a, b->left);
+    return b;
+}
+
+static uint32_t next_priority(qs_reuse_t *r) {
+    uint32_t x = r->seed;  // xorshift32
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return r->seed = x;
+}
+
+/*
+ * Remove every freed block overlapping [addr, addr + size). With fn set
+ * they count as reused; otherwise they are dropped (a trace that missed
+ * the allocation covering them).
+ */
+static void take_overlapping(qs_reuse_t *r, uint64_t addr, uint64_t size, const qs_clock_t *now,
+                             qs_reuse_fn fn, void *ctx) {
+    uint64_t end = addr + (size ? size : 1);
+
+    // Most allocations touch nothing freed: look before splitting
+    const qs_block_t *last = NULL;
+    for (const qs_block_t *t = r->root; t;) {
+        if (t->addr < end) {
+            last = t;
+            t = t->right;
+        } else {
+            t = t->left;
+        }
+    }
+    if (!last || last->addr + last->size <= addr) return;
+
+    qs_block_t *below, *above;
+    split(r->root, end, &below, &above);
+    // Blocks never overlap, so their ends ascend with their addresses
+    while (below) {
+        qs_block_t **t = &below;
+        while ((*t)->right) t = &(*t)->right;
+        qs_block_t *b = *t;
+        if (b->addr + b->size <= addr) break;
+        *t = b->left;   // Unlinking the highest block keeps the heap order
+        if (fn) {
+            qs_class_stats_t *c = &r->classes[qs_size_class(b->size)];
+            c->reused++;
+            c->allocs[qs_bucket(now->allocs - b->freed.allocs)]++;
+            c->bytes[qs_bucket(now->alloc_bytes - b->freed.alloc_bytes)]++;
+            c->ns[qs_bucket(now->ns - b->freed.ns)]++;
+            fn(ctx, b, now);
+        }
+        free(b);
+        r->count--;
+    }
+    r->root = merge(below, above);
+}
+
+// ---------------------------------------------------------------------------
+// Interface
+// ---------------------------------------------------------------------------
+
+void qs_reuse_init(qs_reuse_t *r) {
+    memset(r, 0, sizeof(*r));
+    r->seed = 0x9E3779B9u;
+}
+
+int qs_reuse_freed(qs_reuse_t *r, uint64_t addr, uint64_t size, const qs_clock_t *now) {
+    qs_block_t *b = calloc(1, sizeof(*b));
+    if (!b) return -1;
+    take_overlapping(r, addr, size, now, NULL, NULL);
+    b->addr = addr;
+    b->size = size ? size : 1;
+    b->freed = *now;
+    b->priority = next_priority(r);
+
+    qs_block_t *below, *above;
+    split(r->root, addr, &below, &above);
+    r->root = merge(merge(below, b), above);
+    r->count++;
+    r->classes[qs_size_class(size)].frees++;
+    return 0;
+}
+
+void qs_reuse_allocated(qs_reuse_t *r, uint64_t addr, uint64_t size, const qs_clock_t *now,
+                        qs_reuse_fn fn, void *ctx) {
+    take_overlapping(r, addr, size, now, fn, ctx);
+}
+
+static void free_tree(qs_block_t *t) {
+    while (t) {
+        free_tree(t->left);
+        qs_block_t *right = t->right;
+        free(t);
+        t = right;
+    }
+}
+
+void qs_reuse_destroy(qs_reuse_t *r) {
+    free_tree(r->root);
+    memset(r, 0, sizeof(*r));
+}
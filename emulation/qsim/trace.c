@@ -0,0 +1,142 @@
+/*
+ * qsim - Trace Reading and Live Blocks
+ *
+ * Traces are text, one allocator event per line (qsim.h), so they can be
+ * produced by hook/qtrace.c, converted from other tools or written by
+ * hand. Frees carry no size; the live table maps each allocated address to
+ * its size until it is freed.
+ */
+
+#include "qsim.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define LIVE_INITIAL    4096
+#define LINE_MAX_LEN    256
+
+int qs_trace_open(qs_trace_t *t, const char *path) {
+    memset(t, 0, sizeof(*t));
+    t->path = path;
+    t->file = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+    return t->file ? 0 : -1;
+}
+
+void qs_trace_close(qs_trace_t *t) {
+    if (t->file && t->file != stdin) fclose(t->file);
+    t->file = NULL;
+}
+
+// Next field of a line in the given base; -1 if there is none
+static int field(char **p, int base, uint64_t *v) {
+    char *end;
+    *v = strtoull(*p, &end, base);
+    if (end == *p) return -1;
+    *p = end;
+    return 0;
+}
+
+int qs_trace_next(qs_trace_t *t, qs_event_t *e) {
+    char line[LINE_MAX_LEN];
+    while (fgets(line, sizeof(line), t->file)) {
+        t->line++;
+        char *p = line;
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p == '#' || *p == '\n' || *p == '\0') continue;
+
+        memset(e, 0, sizeof(*e));
+        if (field(&p, 10, &e->ns) != 0) return -1;
+        while (*p == ' ' || *p == '\t') p++;
+        switch (*p++) {
+        case 'm':
+            e->op = QS_ALLOC;
+            return field(&p, 16, &e->addr) == 0 && field(&p, 10, &e->size) == 0 ? 1 : -1;
+        case 'f':
+            e->op = QS_FREE;
+            return field(&p, 16, &e->addr) == 0 ? 1 : -1;
+        case 'r':
+            e->op = QS_REALLOC;
+            return field(&p, 16, &e->old_addr) == 0 && field(&p, 16, &e->addr) == 0 &&
+                   field(&p, 10, &e->size) == 0 ? 1 : -1;
+        default:
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Live blocks: open addressing, linear probing, backward-shift deletion
+// ---------------------------------------------------------------------------
+
+static inline size_t live_slot(const qs_live_t *l, uint64_t addr) {
+    return (size_t)(((addr >> 4) * 0x9E3779B97F4A7C15ull) >> 20) & (l->capacity - 1);
+}
+
+int qs_live_init(qs_live_t *l) {
+    memset(l, 0, sizeof(*l));
+    l->capacity = LIVE_INITIAL;
+    l->keys = calloc(l->capacity, sizeof(uint64_t));
+    l->sizes = calloc(l->capacity, sizeof(uint64_t));
+    return l->keys && l->sizes ? 0 : -1;
+}
+
+void qs_live_destroy(qs_live_t *l) {
+    free(l->keys);
+    free(l->sizes);
+    memset(l, 0, sizeof(*l));
+}
+
+static int live_grow(qs_live_t *l) {
+    qs_live_t bigger = { NULL, NULL, l->capacity * 2, 0 };
+    bigger.keys = calloc(bigger.capacity, sizeof(uint64_t));
+    bigger.sizes = calloc(bigger.capacity, sizeof(uint64_t));
+    if (!bigger.keys || !bigger.sizes) {
+        free(bigger.keys);
+        free(bigger.sizes);
+        return -1;
+    }
+    for (size_t i = 0; i < l->capacity; i++) {
+        if (l->keys[i]) qs_live_put(&bigger, l->keys[i], l->sizes[i]);
+    }
+    qs_live_destroy(l);
+    *l = bigger;
+    return 0;
+}
+
+// A repeated address replaces the old entry (its free was not traced)
+int qs_live_put(qs_live_t *l, uint64_t addr, uint64_t size) {
+    if (addr == 0) return 0;
+    if ((l->count + 1) * 4 > l->capacity * 3 && live_grow(l) != 0) return -1;
+    size_t i = live_slot(l, addr);
+    while (l->keys[i] && l->keys[i] != addr) i = (i + 1) & (l->capacity - 1);
+    if (!l->keys[i]) l->count++;
+    l->keys[i] = addr;
+    l->sizes[i] = size;
+    return 0;
+}
+
+int qs_live_take(qs_live_t *l, uint64_t addr, uint64_t *size) {
+    if (addr == 0) return -1;
+    size_t mask = l->capacity - 1;
+    size_t i = live_slot(l, addr);
+    while (l->keys[i] != addr) {
+        if (!l->keys[i]) return -1;
+        i = (i + 1) & mask;
+    }
+    *size = l->sizes[i];
+    l->count--;
+
+    // Move later entries of the probe run back into the hole
+    size_t hole = i;
+    for (size_t j = (i + 1) & mask; l->keys[j]; j = (j + 1) & mask) {
+        size_t home = live_slot(l, l->keys[j]);
+        if (((j - home) & mask) >= ((j - hole) & mask)) {
+            l->keys[hole] = l->keys[j];
+            l->sizes[hole] = l->sizes[j];
+            hole = j;
+        }
+    }
+    l->keys[hole] = 0;
+    return 0;
+}
@@ -0,0 +1,134 @@
+/*
+ * rvsim - Batch Simulation Farm
+ *
+ * Runs every (binary, configuration) job of a sweep on a pool of threads.
+ * The caller loads and predecodes each image once; workers only read the
+ * images, and each job owns its machine memory and timing model, so jobs
+ * share nothing mutable and throughput scales with the number of cores.
+ * Workers take the next job index under a lock, render the job's report
+ * into a private buffer and append its RESULT lines to the shared results
+ * stream when it finishes, so one file fills up while the sweep runs.
+ */
+
+#include "rvsim.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef struct {
+    const rv_image_t *images;
+    const rv_config_t *configs;     // NULL for functional runs
+    int config_count;               // Configurations per image (1 if functional)
+    int job_count;
+    const rv_run_opts_t *opts;
+    FILE *results;
+    int csv;
+
+    pthread_mutex_t lock;
+    int next_job;
+    int done;
+    int status;
+    uint64_t instructions;
+    struct timespec start;
+} farm_t;
+
+static double elapsed(const struct timespec *since) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - since->tv_sec) + (double)(now.tv_nsec - since->tv_nsec) / 1e9;
+}
+
+// Append the RESULT lines of one job's report (caller holds the lock)
+static void emit_results(farm_t *f, const char *report, size_t size) {
+    const char *p = report, *end = report + size;
+    while (p < end) {
+        const char *eol = memchr(p, '\n', (size_t)(end - p));
+        size_t len = eol ? (size_t)(eol - p) : (size_t)(end - p);
+        if (len > 7 && memcmp(p, "RESULT,", 7) == 0) {
+            const char *line = f->csv ? p + 7 : p;
+            fwrite(line, 1, len - (size_t)(line - p), f->results);
+            fputc('\n', f->results);
+        }
+        p += len + 1;
+    }
+    fflush(f->results);
+}
+
+static void *worker(void *arg) {
+    farm_t *f = arg;
+    for (;;) {
+        pthread_mutex_lock(&f->lock);
+        int job = f->next_job < f->job_count ? f->next_job++ : -1;
+        pthread_mutex_unlock(&f->lock);
+        if (job < 0) break;
+
+        const rv_image_t *img = &f->images[job / f->config_count];
+        const rv_config_t *cfg = f->configs ? &f->configs[job % f->config_count] : NULL;
+        char *report = NULL;
+        size_t size = 0;
+        rv_run_result_t result = { 0, 0, RV_STOP_NONE };
+        struct timespec start;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+
+        FILE *out = open_memstream(&report, &size);
+        int rc = out ? rv_run(img, cfg, f->opts, out, &result) : 1;
+        if (out) fclose(out);
+
+        pthread_mutex_lock(&f->lock);
+        if (report) emit_results(f, report, size);
+        f->status |= rc;
+        f->instructions += result.instructions;
+        f->done++;
+        const char *slash = strrchr(img->path, '/');
+        fprintf(stderr, "[%d/%d] %s %s: %llu instructions", f->done, f->job_count,
+                slash ? slash + 1 : img->path, cfg ? cfg->name : "functional",
+                (unsigned long long)result.instructions);
+        if (result.cycles > 0 && result.instructions)
+            fprintf(stderr, ", CPI %.3f", result.cycles / (double)result.instructions);
+        fprintf(stderr, ", %s (%.1fs)\n", rv_stop_name(result.stop), elapsed(&start));
+        pthread_mutex_unlock(&f->lock);
+        free(report);
+    }
+    return NULL;
+}
+
+int rv_batch(const rv_image_t *images, int image_count, const rv_config_t *configs,
+             int config_count, const rv_run_opts_t *opts, int threads, FILE *results, int csv) {
+    farm_t f;
+    memset(&f, 0, sizeof(f));
+    f.images = images;
+    f.configs = configs;
+    f.config_count = configs ? config_count : 1;
+    f.job_count = image_count * f.config_count;
+    f.opts = opts;
+    f.results = results;
+    f.csv = csv;
+    pthread_mutex_init(&f.lock, NULL);
+    clock_gettime(CLOCK_MONOTONIC, &f.start);
+
+    if (threads > f.job_count) threads = f.job_count;
+    if (threads < 1) threads = 1;
+    if (csv) {
+        fprintf(results, "binary,config,metric,value,unit\n");
+        fflush(results);
+    }
+
+    pthread_t *pool = calloc((size_t)threads, sizeof(*pool));
+    int started = 0;
+    if (pool) {
+        for (; started < threads; started++)
+            if (pthread_create(&pool[started], NULL, worker, &f) != 0) break;
+    }
+    if (started == 0) worker(&f);  // No threads available: run the jobs here
+    for (int i = 0; i < started; i++) pthread_join(pool[i], NULL);
+    free(pool);
+
+    double secs = elapsed(&f.start);
+    fprintf(stderr, "rvsim: %d jobs on %d threads, %.2fG instructions in %.1fs (%.1f MIPS)\n",
+            f.job_count, started ? started : 1, (double)f.instructions / 1e9, secs,
+            secs > 0 ? (double)f.instructions / secs / 1e6 : 0.0);
+    pthread_mutex_destroy(&f.lock);
+    return f.status;
+}
@@ -0,0 +1,185 @@
+/*
+ * rvsim - Core Timing Configuration
+ *
+ * Every timing parameter is an integer reachable by a dotted key, so a
+ * configuration file is a list of "key = value" lines ('#' starts a
+ * comment) and single parameters can be overridden on the command line.
+ */
+
+#include "rvsim.h"
+
+#include <ctype.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    const char *key;
+    size_t offset;
+    int min;
+} config_key_t;
+
+#define KEY(name, field, min) { name, offsetof(rv_config_t, field), min }
+
+static const config_key_t keys[] = {
+    KEY("width", width, 1),
+    KEY("rob", rob, 1),
+    KEY("lsq", lsq, 1),
+    KEY("sb", sb, 1),
+    KEY("frontend", frontend, 0),
+    KEY("mispredict", mispredict, 0),
+    KEY("lat.alu", lat_alu, 1),
+    KEY("lat.mul", lat_mul, 1),
+    KEY("lat.div", lat_div, 1),
+    KEY("lat.load", lat_load, 1),
+    KEY("lat.csr", lat_csr, 1),
+    KEY("lat.fp", lat_fp, 1),
+    KEY("cap.alu", cap_alu, 1),
+    KEY("cap.bounds", cap_bounds, 1),
+    KEY("cap.inspect", cap_inspect, 1),
+    KEY("cap.load", cap_load, 0),
+    KEY("cap.store", cap_store, 0),
+    KEY("cap.check", cap_check, 0),
+    KEY("cap.jump", cap_jump, 0),
+    KEY("line", line, 4),
+    KEY("l1i.size", l1i_size, 0),
+    KEY("l1i.assoc", l1i_assoc, 1),
+    KEY("l1d.size", l1d_size, 0),
+    KEY("l1d.assoc", l1d_assoc, 1),
+    KEY("l2.size", l2_size, 0),
+    KEY("l2.assoc", l2_assoc, 1),
+    KEY("l2.lat", l2_lat, 0),
+    KEY("mem.lat", mem_lat, 0),
+    KEY("bp.entries", bp_entries, 1),
+    KEY("btb", btb_entries, 1),
+    KEY("ras", ras, 0),
+};
+
+#define KEY_COUNT (sizeof(keys) / sizeof(keys[0]))
+
+void rv_config_default(rv_config_t *cfg, rv_core_t core) {
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->core = core;
+    cfg->lat_alu = 1;
+    cfg->lat_mul = 3;
+    cfg->lat_div = 20;
+    cfg->lat_csr = 1;
+    cfg->lat_fp = 4;
+    cfg->cap_alu = 1;
+    cfg->cap_bounds = 2;
+    cfg->cap_inspect = 1;
+    cfg->cap_load = 1;
+    cfg->cap_store = 0;
+    cfg->cap_check = 0;
+    cfg->cap_jump = 1;
+    cfg->line = 64;
+    cfg->l1i_size = 32 * 1024;
+    cfg->l1i_assoc = 4;
+    cfg->l1d_size = 32 * 1024;
+    cfg->l1d_assoc = 4;
+    cfg->l2_assoc = 8;
+
+    if (core == RV_CORE_INORDER) {
+        // Classic 5-stage pipeline: branches resolve in EX, one load-use bubble
+        snprintf(cfg->name, sizeof(cfg->name), "inorder");
+        cfg->width = 1;
+        cfg->rob = 1;
+        cfg->lsq = 1;
+        cfg->sb = 1;
+        cfg->frontend = 1;
+        cfg->mispredict = 2;
+        cfg->lat_load = 2;
+        cfg->l2_size = 256 * 1024;
+        cfg->l2_lat = 12;
+        cfg->mem_lat = 100;
+        cfg->bp_entries = 1024;
+        cfg->btb_entries = 256;
+        cfg->ras = 8;
+    } else {
+        snprintf(cfg->name, sizeof(cfg->name), "ooo");
+        cfg->width = 4;
+        cfg->rob = 128;
+        cfg->lsq = 48;
+        cfg->sb = 32;
+        cfg->frontend = 5;
+        cfg->mispredict = 12;
+        cfg->lat_load = 4;
+        cfg->l2_size = 1024 * 1024;
+        cfg->l2_lat = 14;
+        cfg->mem_lat = 150;
+        cfg->bp_entries = 4096;
+        cfg->btb_entries = 1024;
+        cfg->ras = 16;
+    }
+}
+
+static char *trim(char *s) {
+    while (isspace((unsigned char)*s)) s++;
+    char *end = s + strlen(s);
+    while (end > s && isspace((unsigned char)end[-1])) *--end = '\0';
+    return s;
+}
+
+int rv_config_set(rv_config_t *cfg, const char *key, const char *value) {
+    if (strcmp(key, "name") == 0) {
+        snprintf(cfg->name, sizeof(cfg->name), "%s", value);
+        return 0;
+    }
+    if (strcmp(key, "core") == 0) {
+        // Switching the core resets to its defaults, so "core" comes first in a file
+        if (strcmp(value, "inorder") == 0) rv_config_default(cfg, RV_CORE_INORDER);
+        else if (strcmp(value, "ooo") == 0) rv_config_default(cfg, RV_CORE_OOO);
+        else return -1;
+        return 0;
+    }
+    for (size_t i = 0; i < KEY_COUNT; i++) {
+        if (strcmp(key, keys[i].key) != 0) continue;
+        char *end;
+        long v = strtol(value, &end, 0);
+        if (*end == 'K' || *end == 'k') v *= 1024, end++;
+        else if (*end == 'M' || *end == 'm') v *= 1024 * 1024, end++;
+        if (end == value || *end || v < keys[i].min || v > (1L << 30)) return -1;
+        *(int *)((char *)cfg + keys[i].offset) = (int)v;
+        return 0;
+    }
+    return -1;
+}
+
+int rv_config_apply(rv_config_t *cfg, const char *assignment) {
+    char buf[256];
+    snprintf(buf, sizeof(buf), "%s", assignment);
+    char *eq = strchr(buf, '=');
+    if (!eq) return -1;
+    *eq = '\0';
+    return rv_config_set(cfg, trim(buf), trim(eq + 1));
+}
+
+int rv_config_load(rv_config_t *cfg, const char *path, char *err, size_t err_size) {
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        snprintf(err, err_size, "%s: cannot open", path);
+        return -1;
+    }
+    char line[256];
+    int lineno = 0;
+    while (fgets(line, sizeof(line), f)) {
+        lineno++;
+        char *hash = strchr(line, '#');
+        if (hash) *hash = '\0';
+        char *s = trim(line);
+        if (!*s) continue;
+        if (rv_config_apply(cfg, s) != 0) {
+            snprintf(err, err_size, "%s:%d: bad setting '%s'", path, lineno, s);
+            fclose(f);
+            return -1;
+        }
+    }
+    fclose(f);
+    return 0;
+}
+
+void rv_config_print(const rv_config_t *cfg, FILE *out) {
+    fprintf(out, "name = %s\ncore = %s\n", cfg->name, cfg->core == RV_CORE_OOO ? "ooo" : "inorder");
+    for (size_t i = 0; i < KEY_COUNT; i++)
+        fprintf(out, "%s = %d\n", keys[i].key, *(const int *)((const char *)cfg + keys[i].offset));
+}
@@ -0,0 +1,575 @@
+/*
+ * rvsim - Instruction Decoder and Disassembler
+ *
+ * RV64IMAFDC plus the CHERI-RISC-V (ISAv9) instructions emitted by the
+ * purecap toolchain. Compressed instructions are expanded into their
+ * 32-bit equivalents; in capability mode the RV64 floating-point
+ * compressed slots are the capability loads and stores (LQ/SQ immediate
+ * layout) and the stack-pointer adjustments become CIncOffsetImm.
+ * Floating-point registers are numbered RV_FREG + n in the decoded
+ * operands so that one scoreboard covers both register files.
+ */
+
+#include "rvsim.h"
+
+#include <string.h>
+
+static const char *const op_names[RV_OP_COUNT] = {
+#define RV_OP_NAME(name, cls) #name,
+    RV_OPS(RV_OP_NAME)
+#undef RV_OP_NAME
+};
+
+static const uint8_t op_classes[RV_OP_COUNT] = {
+#define RV_OP_CLASS(name, cls) RV_CLS_##cls,
+    RV_OPS(RV_OP_CLASS)
+#undef RV_OP_CLASS
+};
+
+static const char *const class_names[RV_CLS_COUNT] = {
+    "alu", "mul", "div", "load", "store", "amo", "branch", "jump", "jumpr",
+    "system", "fp", "cap", "cap_bounds", "cap_inspect", "cap_load", "cap_store",
+};
+
+static const char *const reg_names[64] = {
+    "zero", "ra", "sp", "gp", "tp", "t0", "t1", "t2",
+    "s0", "s1", "a0", "a1", "a2", "a3", "a4", "a5",
+    "a6", "a7", "s2", "s3", "s4", "s5", "s6", "s7",
+    "s8", "s9", "s10", "s11", "t3", "t4", "t5", "t6",
+    "ft0", "ft1", "ft2", "ft3", "ft4", "ft5", "ft6", "ft7",
+    "fs0", "fs1", "fa0", "fa1", "fa2", "fa3", "fa4", "fa5",
+    "fa6", "fa7", "fs2", "fs3", "fs4", "fs5", "fs6", "fs7",
+    "fs8", "fs9", "fs10", "fs11", "ft8", "ft9", "ft10", "ft11",
+};
+
+const char *rv_op_name(rv_op_t op) {
+    return op < RV_OP_COUNT ? op_names[op] : "?";
+}
+
+const char *rv_reg_name(int reg) {
+    return reg >= 0 && reg < 64 ? reg_names[reg] : "?";
+}
+
+const char *rv_class_name(rv_class_t cls) {
+    return cls < RV_CLS_COUNT ? class_names[cls] : "?";
+}
+
+rv_class_t rv_op_class(rv_op_t op) {
+    return op < RV_OP_COUNT ? (rv_class_t)op_classes[op] : RV_CLS_SYSTEM;
+}
+
+int rv_is_cap_class(rv_class_t cls) {
+    return cls >= RV_CLS_CAP && cls <= RV_CLS_CAP_STORE;
+}
+
+// ---------------------------------------------------------------------------
+// Field helpers
+// ---------------------------------------------------------------------------
+
+static inline uint32_t bits(uint32_t w, int hi, int lo) {
+    return (w >> lo) & ((1u << (hi - lo + 1)) - 1);
+}
+
+static inline int64_t sext(uint64_t v, int width) {
+    return (int64_t)(v << (64 - width)) >> (64 - width);
+}
+
+static void set(rv_insn_t *in, rv_op_t op, int rd, int rs1, int rs2, int64_t imm) {
+    in->op = (uint16_t)op;
+    in->cls = (uint8_t)rv_op_class(op);
+    in->rd = (uint8_t)rd;
+    in->rs1 = (uint8_t)rs1;
+    in->rs2 = (uint8_t)rs2;
+    in->imm = imm;
+    switch (op) {
+    case RV_OP_LB: case RV_OP_LBU: case RV_OP_SB: in->mem_size = 1; break;
+    case RV_OP_LH: case RV_OP_LHU: case RV_OP_SH: in->mem_size = 2; break;
+    case RV_OP_LW: case RV_OP_LWU: case RV_OP_SW: case RV_OP_FLW: case RV_OP_FSW: in->mem_size = 4; break;
+    case RV_OP_LD: case RV_OP_SD: case RV_OP_FLD: case RV_OP_FSD: in->mem_size = 8; break;
+    case RV_OP_CLC: case RV_OP_CSC: in->mem_size = RV_CAP_SIZE; break;
+    default:
+        if (op >= RV_OP_LR_W && op <= RV_OP_AMOMAXU_W) in->mem_size = 4;
+        else if (op >= RV_OP_LR_D && op <= RV_OP_AMOMAXU_D) in->mem_size = 8;
+        else in->mem_size = 0;
+        break;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// 32-bit encodings
+// ---------------------------------------------------------------------------
+
+static void decode_cheri(uint32_t w, rv_insn_t *in) {
+    int rd = bits(w, 11, 7), rs1 = bits(w, 19, 15), rs2 = bits(w, 24, 20);
+    int f3 = bits(w, 14, 12), f7 = bits(w, 31, 25);
+
+    if (f3 == 1) {
+        set(in, RV_OP_CINCOFFSETIMM, rd, rs1, 0, sext(bits(w, 31, 20), 12));
+        return;
+    }
+    if (f3 == 2) {
+        set(in, RV_OP_CSETBOUNDSIMM, rd, rs1, 0, bits(w, 31, 20));
+        return;
+    }
+    if (f3 != 0) return;
+
+    if (f7 == 0x7f) {
+        static const int16_t unary[32] = {
+            [0x00] = RV_OP_CGETPERM, [0x01] = RV_OP_CGETTYPE, [0x02] = RV_OP_CGETBASE,
+            [0x03] = RV_OP_CGETLEN, [0x04] = RV_OP_CGETTAG, [0x05] = RV_OP_CGETSEALED,
+            [0x06] = RV_OP_CGETOFFSET, [0x07] = RV_OP_CGETFLAGS, [0x08] = RV_OP_CRRL,
+            [0x09] = RV_OP_CRAM, [0x0a] = RV_OP_CMOVE, [0x0b] = RV_OP_CCLEARTAG,
+            [0x0c] = RV_OP_CJALR, [0x0f] = RV_OP_CGETADDR, [0x11] = RV_OP_CSEALENTRY,
+        };
+        if (unary[rs2]) set(in, (rv_op_t)unary[rs2], rd, rs1, 0, 0);
+        return;
+    }
+
+    rv_op_t op;
+    switch (f7) {
+    case 0x01: op = RV_OP_CSPECIALRW; break;
+    case 0x08: op = RV_OP_CSETBOUNDS; break;
+    case 0x09: op = RV_OP_CSETBOUNDSEXACT; break;
+    case 0x0b: op = RV_OP_CSEAL; break;
+    case 0x0c: op = RV_OP_CUNSEAL; break;
+    case 0x0d: op = RV_OP_CANDPERM; break;
+    case 0x0e: op = RV_OP_CSETFLAGS; break;
+    case 0x0f: op = RV_OP_CSETOFFSET; break;
+    case 0x10: op = RV_OP_CSETADDR; break;
+    case 0x11: op = RV_OP_CINCOFFSET; break;
+    case 0x12: op = RV_OP_CTOPTR; break;
+    case 0x13: op = RV_OP_CFROMPTR; break;
+    case 0x14: op = RV_OP_CSUB; break;
+    case 0x1d: op = RV_OP_CBUILDCAP; break;
+    case 0x1e: op = RV_OP_CCOPYTYPE; break;
+    case 0x1f: op = RV_OP_CCSEAL; break;
+    case 0x20: op = RV_OP_CTESTSUBSET; break;
+    case 0x21: op = RV_OP_CSETEQUALEXACT; break;
+    default: return;
+    }
+    // CSpecialRW names the special capability register in the rs2 field
+    set(in, op, rd, rs1, op == RV_OP_CSPECIALRW ? 0 : rs2, op == RV_OP_CSPECIALRW ? rs2 : 0);
+}
+
+// OP-FP (0x53); fmt 0 is single and 1 double precision
+static void decode_fp(uint32_t w, rv_insn_t *in) {
+    int rd = bits(w, 11, 7), rs1 = bits(w, 19, 15), rs2 = bits(w, 24, 20);
+    int f3 = bits(w, 14, 12), f7 = bits(w, 31, 25);
+    int d = f7 & 1, fd = RV_FREG + rd, fs1 = RV_FREG + rs1, fs2 = RV_FREG + rs2;
+    if (f7 & 2) return;
+
+    switch (f7 >> 2) {
+    case 0x00: set(in, d ? RV_OP_FADD_D : RV_OP_FADD_S, fd, fs1, fs2, f3); return;
+    case 0x01: set(in, d ? RV_OP_FSUB_D : RV_OP_FSUB_S, fd, fs1, fs2, f3); return;
+    case 0x02: set(in, d ? RV_OP_FMUL_D : RV_OP_FMUL_S, fd, fs1, fs2, f3); return;
+    case 0x03: set(in, d ? RV_OP_FDIV_D : RV_OP_FDIV_S, fd, fs1, fs2, f3); return;
+    case 0x0b: if (rs2 == 0) set(in, d ? RV_OP_FSQRT_D : RV_OP_FSQRT_S, fd, fs1, 0, f3); return;
+    case 0x04: {
+        static const int16_t ops[2][3] = { { RV_OP_FSGNJ_S, RV_OP_FSGNJN_S, RV_OP_FSGNJX_S },
+                                           { RV_OP_FSGNJ_D, RV_OP_FSGNJN_D, RV_OP_FSGNJX_D } };
+        if (f3 < 3) set(in, (rv_op_t)ops[d][f3], fd, fs1, fs2, 0);
+        return;
+    }
+    case 0x05:
+        if (f3 == 0) set(in, d ? RV_OP_FMIN_D : RV_OP_FMIN_S, fd, fs1, fs2, 0);
+        else if (f3 == 1) set(in, d ? RV_OP_FMAX_D : RV_OP_FMAX_S, fd, fs1, fs2, 0);
+        return;
+    case 0x08:
+        if (d && rs2 == 0) set(in, RV_OP_FCVT_D_S, fd, fs1, 0, f3);
+        else if (!d && rs2 == 1) set(in, RV_OP_FCVT_S_D, fd, fs1, 0, f3);
+        return;
+    case 0x14: {
+        static const int16_t ops[2][3] = { { RV_OP_FLE_S, RV_OP_FLT_S, RV_OP_FEQ_S },
+                                           { RV_OP_FLE_D, RV_OP_FLT_D, RV_OP_FEQ_D } };
+        if (f3 < 3) set(in, (rv_op_t)ops[d][f3], rd, fs1, fs2, 0);
+        return;
+    }
+    case 0x18: {
+        static const int16_t ops[2][4] = {
+            { RV_OP_FCVT_W_S, RV_OP_FCVT_WU_S, RV_OP_FCVT_L_S, RV_OP_FCVT_LU_S },
+            { RV_OP_FCVT_W_D, RV_OP_FCVT_WU_D, RV_OP_FCVT_L_D, RV_OP_FCVT_LU_D } };
+        if (rs2 < 4) set(in, (rv_op_t)ops[d][rs2], rd, fs1, 0, f3);
+        return;
+    }
+    case 0x1a: {
+        static const int16_t ops[2][4] = {
+            { RV_OP_FCVT_S_W, RV_OP_FCVT_S_WU, RV_OP_FCVT_S_L, RV_OP_FCVT_S_LU },
+            { RV_OP_FCVT_D_W, RV_OP_FCVT_D_WU, RV_OP_FCVT_D_L, RV_OP_FCVT_D_LU } };
+        if (rs2 < 4) set(in, (rv_op_t)ops[d][rs2], fd, rs1, 0, f3);
+        return;
+    }
+    case 0x1c:
+        if (rs2 != 0) return;
+        if (f3 == 0) set(in, d ? RV_OP_FMV_X_D : RV_OP_FMV_X_W, rd, fs1, 0, 0);
+        else if (f3 == 1) set(in, d ? RV_OP_FCLASS_D : RV_OP_FCLASS_S, rd, fs1, 0, 0);
+        return;
+    case 0x1e:
+        if (rs2 == 0 && f3 == 0) set(in, d ? RV_OP_FMV_D_X : RV_OP_FMV_W_X, fd, rs1, 0, 0);
+        return;
+    }
+}
+
+static void decode32(uint32_t w, rv_insn_t *in) {
+    int rd = bits(w, 11, 7), rs1 = bits(w, 19, 15), rs2 = bits(w, 24, 20);
+    int f3 = bits(w, 14, 12), f7 = bits(w, 31, 25);
+    int64_t imm_i = sext(w >> 20, 12);
+    int64_t imm_s = sext((bits(w, 31, 25) << 5) | bits(w, 11, 7), 12);
+    int64_t imm_b = sext((bits(w, 31, 31) << 12) | (bits(w, 7, 7) << 11) |
+                         (bits(w, 30, 25) << 5) | (bits(w, 11, 8) << 1), 13);
+    int64_t imm_u = sext(w & 0xfffff000u, 32);
+    int64_t imm_j = sext((bits(w, 31, 31) << 20) | (bits(w, 19, 12) << 12) |
+                         (bits(w, 20, 20) << 11) | (bits(w, 30, 21) << 1), 21);
+
+    switch (w & 0x7f) {
+    case 0x37: set(in, RV_OP_LUI, rd, 0, 0, imm_u); return;
+    case 0x17: set(in, RV_OP_AUIPC, rd, 0, 0, imm_u); return;
+    case 0x6f: set(in, RV_OP_JAL, rd, 0, 0, imm_j); return;
+    case 0x67:
+        if (f3 == 0) set(in, RV_OP_JALR, rd, rs1, 0, imm_i);
+        return;
+    case 0x63: {
+        static const int16_t ops[8] = { RV_OP_BEQ, RV_OP_BNE, 0, 0,
+                                        RV_OP_BLT, RV_OP_BGE, RV_OP_BLTU, RV_OP_BGEU };
+        if (ops[f3]) set(in, (rv_op_t)ops[f3], 0, rs1, rs2, imm_b);
+        return;
+    }
+    case 0x03: {
+        static const int16_t ops[8] = { RV_OP_LB, RV_OP_LH, RV_OP_LW, RV_OP_LD,
+                                        RV_OP_LBU, RV_OP_LHU, RV_OP_LWU, 0 };
+        if (ops[f3]) set(in, (rv_op_t)ops[f3], rd, rs1, 0, imm_i);
+        return;
+    }
+    case 0x23: {
+        static const int16_t ops[8] = { RV_OP_SB, RV_OP_SH, RV_OP_SW, RV_OP_SD, RV_OP_CSC };
+        if (ops[f3]) set(in, (rv_op_t)ops[f3], 0, rs1, rs2, imm_s);
+        return;
+    }
+    case 0x13:
+        switch (f3) {
+        case 0: set(in, RV_OP_ADDI, rd, rs1, 0, imm_i); return;
+        case 2: set(in, RV_OP_SLTI, rd, rs1, 0, imm_i); return;
+        case 3: set(in, RV_OP_SLTIU, rd, rs1, 0, imm_i); return;
+        case 4: set(in, RV_OP_XORI, rd, rs1, 0, imm_i); return;
+        case 6: set(in, RV_OP_ORI, rd, rs1, 0, imm_i); return;
+        case 7: set(in, RV_OP_ANDI, rd, rs1, 0, imm_i); return;
+        case 1:
+            if (bits(w, 31, 26) == 0) set(in, RV_OP_SLLI, rd, rs1, 0, bits(w, 25, 20));
+            return;
+        case 5:
+            if (bits(w, 31, 26) == 0) set(in, RV_OP_SRLI, rd, rs1, 0, bits(w, 25, 20));
+            else if (bits(w, 31, 26) == 0x10) set(in, RV_OP_SRAI, rd, rs1, 0, bits(w, 25, 20));
+            return;
+        }
+        return;
+    case 0x1b:
+        if (f3 == 0) set(in, RV_OP_ADDIW, rd, rs1, 0, imm_i);
+        else if (f3 == 1 && f7 == 0) set(in, RV_OP_SLLIW, rd, rs1, 0, rs2);
+        else if (f3 == 5 && f7 == 0) set(in, RV_OP_SRLIW, rd, rs1, 0, rs2);
+        else if (f3 == 5 && f7 == 0x20) set(in, RV_OP_SRAIW, rd, rs1, 0, rs2);
+        return;
+    case 0x33: {
+        static const int16_t base[8] = { RV_OP_ADD, RV_OP_SLL, RV_OP_SLT, RV_OP_SLTU,
+                                         RV_OP_XOR, RV_OP_SRL, RV_OP_OR, RV_OP_AND };
+        static const int16_t muldiv[8] = { RV_OP_MUL, RV_OP_MULH, RV_OP_MULHSU, RV_OP_MULHU,
+                                           RV_OP_DIV, RV_OP_DIVU, RV_OP_REM, RV_OP_REMU };
+        if (f7 == 0) set(in, (rv_op_t)base[f3], rd, rs1, rs2, 0);
+        else if (f7 == 1) set(in, (rv_op_t)muldiv[f3], rd, rs1, rs2, 0);
+        else if (f7 == 0x20 && f3 == 0) set(in, RV_OP_SUB, rd, rs1, rs2, 0);
+        else if (f7 == 0x20 && f3 == 5) set(in, RV_OP_SRA, rd, rs1, rs2, 0);
+        return;
+    }
+    case 0x3b: {
+        static const int16_t muldiv[8] = { RV_OP_MULW, 0, 0, 0,
+                                           RV_OP_DIVW, RV_OP_DIVUW, RV_OP_REMW, RV_OP_REMUW };
+        if (f7 == 0 && f3 == 0) set(in, RV_OP_ADDW, rd, rs1, rs2, 0);
+        else if (f7 == 0 && f3 == 1) set(in, RV_OP_SLLW, rd, rs1, rs2, 0);
+        else if (f7 == 0 && f3 == 5) set(in, RV_OP_SRLW, rd, rs1, rs2, 0);
+        else if (f7 == 0x20 && f3 == 0) set(in, RV_OP_SUBW, rd, rs1, rs2, 0);
+        else if (f7 == 0x20 && f3 == 5) set(in, RV_OP_SRAW, rd, rs1, rs2, 0);
+        else if (f7 == 1 && muldiv[f3]) set(in, (rv_op_t)muldiv[f3], rd, rs1, rs2, 0);
+        return;
+    }
+    case 0x0f:
+        if (f3 == 0) set(in, RV_OP_FENCE, 0, 0, 0, 0);
+        else if (f3 == 1) set(in, RV_OP_FENCE_I, 0, 0, 0, 0);
+        else if (f3 == 2) set(in, RV_OP_CLC, rd, rs1, 0, imm_i);
+        return;
+    case 0x73:
+        if (f3 == 0) {
+            if (w == 0x00000073) set(in, RV_OP_ECALL, 0, 0, 0, 0);
+            else if (w == 0x00100073) set(in, RV_OP_EBREAK, 0, 0, 0, 0);
+            else if (w == 0x10500073) set(in, RV_OP_WFI, 0, 0, 0, 0);
+            return;
+        }
+        if (f3 == 4) return;
+        {
+            static const int16_t ops[8] = { 0, RV_OP_CSRRW, RV_OP_CSRRS, RV_OP_CSRRC,
+                                            0, RV_OP_CSRRWI, RV_OP_CSRRSI, RV_OP_CSRRCI };
+            // rs1 holds the zero-extended immediate for the I forms
+            set(in, (rv_op_t)ops[f3], rd, rs1, 0, w >> 20);
+        }
+        return;
+    case 0x2f: {
+        int f5 = bits(w, 31, 27);
+        int d = f3 == 3;
+        rv_op_t op;
+        if (f3 != 2 && f3 != 3) return;
+        switch (f5) {
+        case 0x02: if (rs2) return; op = d ? RV_OP_LR_D : RV_OP_LR_W; break;
+        case 0x03: op = d ? RV_OP_SC_D : RV_OP_SC_W; break;
+        case 0x01: op = d ? RV_OP_AMOSWAP_D : RV_OP_AMOSWAP_W; break;
+        case 0x00: op = d ? RV_OP_AMOADD_D : RV_OP_AMOADD_W; break;
+        case 0x04: op = d ? RV_OP_AMOXOR_D : RV_OP_AMOXOR_W; break;
+        case 0x0c: op = d ? RV_OP_AMOAND_D : RV_OP_AMOAND_W; break;
+        case 0x08: op = d ? RV_OP_AMOOR_D : RV_OP_AMOOR_W; break;
+        case 0x10: op = d ? RV_OP_AMOMIN_D : RV_OP_AMOMIN_W; break;
+        case 0x14: op = d ? RV_OP_AMOMAX_D : RV_OP_AMOMAX_W; break;
+        case 0x18: op = d ? RV_OP_AMOMINU_D : RV_OP_AMOMINU_W; break;
+        case 0x1c: op = d ? RV_OP_AMOMAXU_D : RV_OP_AMOMAXU_W; break;
+        default: return;
+        }
+        set(in, op, rd, rs1, rs2, 0);
+        return;
+    }
+    case 0x5b:
+        decode_cheri(w, in);
+        return;
+    case 0x07:
+        if (f3 == 2) set(in, RV_OP_FLW, RV_FREG + rd, rs1, 0, imm_i);
+        else if (f3 == 3) set(in, RV_OP_FLD, RV_FREG + rd, rs1, 0, imm_i);
+        return;
+    case 0x27:
+        if (f3 == 2) set(in, RV_OP_FSW, 0, rs1, RV_FREG + rs2, imm_s);
+        else if (f3 == 3) set(in, RV_OP_FSD, 0, rs1, RV_FREG + rs2, imm_s);
+        return;
+    case 0x43: case 0x47: case 0x4b: case 0x4f: {
+        static const int16_t ops[2][4] = {
+            { RV_OP_FMADD_S, RV_OP_FMSUB_S, RV_OP_FNMSUB_S, RV_OP_FNMADD_S },
+            { RV_OP_FMADD_D, RV_OP_FMSUB_D, RV_OP_FNMSUB_D, RV_OP_FNMADD_D } };
+        int fmt = bits(w, 26, 25);
+        if (fmt < 2)
+            set(in, (rv_op_t)ops[fmt][(w >> 2) & 3], RV_FREG + rd, RV_FREG + rs1, RV_FREG + rs2,
+                f3 | ((int64_t)bits(w, 31, 27) << 8));
+        return;
+    }
+    case 0x53:
+        decode_fp(w, in);
+        return;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Compressed encodings
+// ---------------------------------------------------------------------------
+
+static void decode16(uint32_t w, int capmode, rv_insn_t *in) {
+    int f3 = bits(w, 15, 13);
+    int rd = bits(w, 11, 7), rs2 = bits(w, 6, 2);
+    int rdp = bits(w, 4, 2) + 8, rs1p = bits(w, 9, 7) + 8;
+    int64_t imm6 = sext((bits(w, 12, 12) << 5) | bits(w, 6, 2), 6);
+    // Immediate layouts of the 8-byte and 16-byte register-based loads and stores
+    uint32_t uimm_d = (bits(w, 12, 10) << 3) | (bits(w, 6, 5) << 6);
+    uint32_t uimm_w = (bits(w, 12, 10) << 3) | (bits(w, 6, 6) << 2) | (bits(w, 5, 5) << 6);
+    uint32_t uimm_q = (bits(w, 12, 11) << 4) | (bits(w, 10, 10) << 8) | (bits(w, 6, 5) << 6);
+
+    switch (w & 3) {
+    case 0:
+        switch (f3) {
+        case 0: {
+            uint32_t nz = (bits(w, 12, 11) << 4) | (bits(w, 10, 7) << 6) |
+                          (bits(w, 6, 6) << 2) | (bits(w, 5, 5) << 3);
+            if (nz) set(in, capmode ? RV_OP_CINCOFFSETIMM : RV_OP_ADDI, rdp, 2, 0, nz);
+            return;
+        }
+        case 1:
+            if (capmode) set(in, RV_OP_CLC, rdp, rs1p, 0, uimm_q);
+            else set(in, RV_OP_FLD, RV_FREG + rdp, rs1p, 0, uimm_d);
+            return;
+        case 2: set(in, RV_OP_LW, rdp, rs1p, 0, uimm_w); return;
+        case 3: set(in, RV_OP_LD, rdp, rs1p, 0, uimm_d); return;
+        case 5:
+            if (capmode) set(in, RV_OP_CSC, 0, rs1p, rdp, uimm_q);
+            else set(in, RV_OP_FSD, 0, rs1p, RV_FREG + rdp, uimm_d);
+            return;
+        case 6: set(in, RV_OP_SW, 0, rs1p, rdp, uimm_w); return;
+        case 7: set(in, RV_OP_SD, 0, rs1p, rdp, uimm_d); return;
+        }
+        return;
+    case 1:
+        switch (f3) {
+        case 0: set(in, RV_OP_ADDI, rd, rd, 0, imm6); return;
+        case 1: if (rd) set(in, RV_OP_ADDIW, rd, rd, 0, imm6); return;
+        case 2: set(in, RV_OP_ADDI, rd, 0, 0, imm6); return;
+        case 3:
+            if (rd == 2) {
+                int64_t nz = sext((bits(w, 12, 12) << 9) | (bits(w, 6, 6) << 4) |
+                                  (bits(w, 5, 5) << 6) | (bits(w, 4, 3) << 7) |
+                                  (bits(w, 2, 2) << 5), 10);
+                if (nz) set(in, capmode ? RV_OP_CINCOFFSETIMM : RV_OP_ADDI, 2, 2, 0, nz);
+            } else if (imm6) {
+                set(in, RV_OP_LUI, rd, 0, 0, imm6 << 12);
+            }
+            return;
+        case 4: {
+            int shamt = (bits(w, 12, 12) << 5) | bits(w, 6, 2);
+            switch (bits(w, 11, 10)) {
+            case 0: set(in, RV_OP_SRLI, rs1p, rs1p, 0, shamt); return;
+            case 1: set(in, RV_OP_SRAI, rs1p, rs1p, 0, shamt); return;
+            case 2: set(in, RV_OP_ANDI, rs1p, rs1p, 0, imm6); return;
+            }
+            static const int16_t ops[8] = { RV_OP_SUB, RV_OP_XOR, RV_OP_OR, RV_OP_AND,
+                                            RV_OP_SUBW, RV_OP_ADDW, 0, 0 };
+            int sel = (bits(w, 12, 12) << 2) | bits(w, 6, 5);
+            if (ops[sel]) set(in, (rv_op_t)ops[sel], rs1p, rs1p, rdp, 0);
+            return;
+        }
+        case 5: {
+            int64_t off = sext((bits(w, 12, 12) << 11) | (bits(w, 11, 11) << 4) |
+                               (bits(w, 10, 9) << 8) | (bits(w, 8, 8) << 10) |
+                               (bits(w, 7, 7) << 6) | (bits(w, 6, 6) << 7) |
+                               (bits(w, 5, 3) << 1) | (bits(w, 2, 2) << 5), 12);
+            set(in, RV_OP_JAL, 0, 0, 0, off);
+            return;
+        }
+        case 6:
+        case 7: {
+            int64_t off = sext((bits(w, 12, 12) << 8) | (bits(w, 11, 10) << 3) |
+                               (bits(w, 6, 5) << 6) | (bits(w, 4, 3) << 1) |
+                               (bits(w, 2, 2) << 5), 9);
+            set(in, f3 == 6 ? RV_OP_BEQ : RV_OP_BNE, 0, rs1p, 0, off);
+            return;
+        }
+        }
+        return;
+    case 2:
+        switch (f3) {
+        case 0:
+            set(in, RV_OP_SLLI, rd, rd, 0, (bits(w, 12, 12) << 5) | bits(w, 6, 2));
+            return;
+        case 1:
+            if (capmode && rd) {
+                uint32_t off = (bits(w, 12, 12) << 5) | (bits(w, 6, 6) << 4) | (bits(w, 5, 2) << 6);
+                set(in, RV_OP_CLC, rd, 2, 0, off);
+            } else if (!capmode) {
+                set(in, RV_OP_FLD, RV_FREG + rd, 2, 0,
+                    (bits(w, 12, 12) << 5) | (bits(w, 6, 5) << 3) | (bits(w, 4, 2) << 6));
+            }
+            return;
+        case 2:
+            if (rd) set(in, RV_OP_LW, rd, 2, 0,
+                        (bits(w, 12, 12) << 5) | (bits(w, 6, 4) << 2) | (bits(w, 3, 2) << 6));
+            return;
+        case 3:
+            if (rd) set(in, RV_OP_LD, rd, 2, 0,
+                        (bits(w, 12, 12) << 5) | (bits(w, 6, 5) << 3) | (bits(w, 4, 2) << 6));
+            return;
+        case 4:
+            if (!bits(w, 12, 12)) {
+                if (rs2) set(in, RV_OP_ADD, rd, 0, rs2, 0);
+                else if (rd) set(in, RV_OP_JALR, 0, rd, 0, 0);
+            } else {
+                if (rs2) set(in, RV_OP_ADD, rd, rd, rs2, 0);
+                else if (rd) set(in, RV_OP_JALR, 1, rd, 0, 0);
+                else set(in, RV_OP_EBREAK, 0, 0, 0, 0);
+            }
+            return;
+        case 5:
+            if (capmode)
+                set(in, RV_OP_CSC, 0, 2, rs2, (bits(w, 12, 11) << 4) | (bits(w, 10, 7) << 6));
+            else
+                set(in, RV_OP_FSD, 0, 2, RV_FREG + rs2, (bits(w, 12, 10) << 3) | (bits(w, 9, 7) << 6));
+            return;
+        case 6: set(in, RV_OP_SW, 0, 2, rs2, (bits(w, 12, 9) << 2) | (bits(w, 8, 7) << 6)); return;
+        case 7: set(in, RV_OP_SD, 0, 2, rs2, (bits(w, 12, 10) << 3) | (bits(w, 9, 7) << 6)); return;
+        }
+        return;
+    }
+}
+
+void rv_decode(uint16_t lo, uint16_t hi, int capmode, rv_insn_t *out) {
+    memset(out, 0, sizeof(*out));
+    out->cls = RV_CLS_SYSTEM;
+    if ((lo & 3) == 3) {
+        out->len = 4;
+        decode32((uint32_t)lo | ((uint32_t)hi << 16), out);
+    } else {
+        out->len = 2;
+        decode16(lo, capmode, out);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Disassembly
+// ---------------------------------------------------------------------------
+
+static void lower(char *dst, const char *src, size_t size) {
+    size_t i;
+    for (i = 0; src[i] && i + 1 < size; i++)
+        dst[i] = src[i] == '_' ? '.' : (char)(src[i] >= 'A' && src[i] <= 'Z' ? src[i] + 32 : src[i]);
+    dst[i] = '\0';
+}
+
+int rv_disasm(const rv_insn_t *in, uint64_t pc, char *buf, size_t size) {
+    char name[24];
+    const char *rd = reg_names[in->rd], *rs1 = reg_names[in->rs1], *rs2 = reg_names[in->rs2];
+    rv_op_t op = (rv_op_t)in->op;
+    lower(name, rv_op_name(op), sizeof(name));
+
+    switch (op) {
+    case RV_OP_ILLEGAL:
+        return snprintf(buf, size, "illegal");
+    case RV_OP_LUI: case RV_OP_AUIPC:
+        return snprintf(buf, size, "%s %s, 0x%llx", name, rd,
+                        (unsigned long long)((uint64_t)in->imm >> 12) & 0xfffff);
+    case RV_OP_JAL:
+        return snprintf(buf, size, "%s %s, 0x%llx", name, rd, (unsigned long long)(pc + in->imm));
+    case RV_OP_JALR:
+        return snprintf(buf, size, "%s %s, %lld(%s)", name, rd, (long long)in->imm, rs1);
+    case RV_OP_FENCE: case RV_OP_FENCE_I: case RV_OP_ECALL: case RV_OP_EBREAK: case RV_OP_WFI:
+        return snprintf(buf, size, "%s", name);
+    case RV_OP_CSRRW: case RV_OP_CSRRS: case RV_OP_CSRRC:
+        return snprintf(buf, size, "%s %s, 0x%llx, %s", name, rd, (unsigned long long)in->imm, rs1);
+    case RV_OP_CSRRWI: case RV_OP_CSRRSI: case RV_OP_CSRRCI:
+        return snprintf(buf, size, "%s %s, 0x%llx, %d", name, rd, (unsigned long long)in->imm, in->rs1);
+    case RV_OP_CSPECIALRW:
+        return snprintf(buf, size, "%s %s, scr%lld, %s", name, rd, (long long)in->imm, rs1);
+    default:
+        break;
+    }
+
+    switch ((rv_class_t)in->cls) {
+    case RV_CLS_BRANCH:
+        return snprintf(buf, size, "%s %s, %s, 0x%llx", name, rs1, rs2,
+                        (unsigned long long)(pc + in->imm));
+    case RV_CLS_LOAD: case RV_CLS_CAP_LOAD:
+        return snprintf(buf, size, "%s %s, %lld(%s)", name, rd, (long long)in->imm, rs1);
+    case RV_CLS_STORE: case RV_CLS_CAP_STORE:
+        return snprintf(buf, size, "%s %s, %lld(%s)", name, rs2, (long long)in->imm, rs1);
+    case RV_CLS_AMO:
+        if (op == RV_OP_LR_W || op == RV_OP_LR_D)
+            return snprintf(buf, size, "%s %s, (%s)", name, rd, rs1);
+        return snprintf(buf, size, "%s %s, %s, (%s)", name, rd, rs2, rs1);
+    default:
+        break;
+    }
+
+    switch (op) {
+    case RV_OP_ADDI: case RV_OP_SLTI: case RV_OP_SLTIU: case RV_OP_XORI: case RV_OP_ORI:
+    case RV_OP_ANDI: case RV_OP_SLLI: case RV_OP_SRLI: case RV_OP_SRAI: case RV_OP_ADDIW:
+    case RV_OP_SLLIW: case RV_OP_SRLIW: case RV_OP_SRAIW:
+    case RV_OP_CINCOFFSETIMM: case RV_OP_CSETBOUNDSIMM:
+        return snprintf(buf, size, "%s %s, %s, %lld", name, rd, rs1, (long long)in->imm);
+    case RV_OP_CGETPERM: case RV_OP_CGETTYPE: case RV_OP_CGETBASE: case RV_OP_CGETLEN:
+    case RV_OP_CGETTAG: case RV_OP_CGETSEALED: case RV_OP_CGETOFFSET: case RV_OP_CGETFLAGS:
+    case RV_OP_CGETADDR: case RV_OP_CRRL: case RV_OP_CRAM: case RV_OP_CMOVE:
+    case RV_OP_CCLEARTAG: case RV_OP_CJALR: case RV_OP_CSEALENTRY:
+        return snprintf(buf, size, "%s %s, %s", name, rd, rs1);
+    case RV_OP_FMADD_S: case RV_OP_FMSUB_S: case RV_OP_FNMSUB_S: case RV_OP_FNMADD_S:
+    case RV_OP_FMADD_D: case RV_OP_FMSUB_D: case RV_OP_FNMSUB_D: case RV_OP_FNMADD_D:
+        return snprintf(buf, size, "%s %s, %s, %s, %s", name, rd, rs1, rs2, reg_names[rv_insn_rs3(in)]);
+    default:
+        // Floating-point conversions, moves, classification and square root have one source
+        if (op >= RV_OP_FLW && !in->rs2) return snprintf(buf, size, "%s %s, %s", name, rd, rs1);
+        return snprintf(buf, size, "%s %s, %s, %s", name, rd, rs1, rs2);
+    }
+}
@@ -0,0 +1,251 @@
+/*
+ * rvsim - ELF Loader
+ *
+ * Reads a RISC-V ELF64 executable into an immutable image: loadable
+ * segments, function and object symbols, the __cap_relocs table of purecap
+ * binaries and the predecoded executable text. Position-independent
+ * binaries are placed at RV_PIE_BASE so the null page stays unmapped.
+ * ELF structures are parsed by offset so the loader builds on hosts
+ * without <elf.h>.
+ */
+
+#include "rvsim.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define ET_EXEC         2
+#define ET_DYN          3
+#define EM_RISCV        243
+#define PT_LOAD         1
+#define SHT_SYMTAB      2
+#define STT_OBJECT      1
+#define STT_FUNC        2
+#define EF_RISCV_CHERIABI   0x10000 // Pure-capability ABI
+#define EF_RISCV_CAP_MODE   0x20000 // Code starts in capability mode
+
+static uint16_t rd16(const uint8_t *p) { uint16_t v; memcpy(&v, p, 2); return v; }
+static uint32_t rd32(const uint8_t *p) { uint32_t v; memcpy(&v, p, 4); return v; }
+static uint64_t rd64(const uint8_t *p) { uint64_t v; memcpy(&v, p, 8); return v; }
+
+static int fail(char *err, size_t err_size, const char *path, const char *what) {
+    snprintf(err, err_size, "%s: %s", path, what);
+    return -1;
+}
+
+static int symbol_cmp(const void *a, const void *b) {
+    const rv_symbol_t *x = a, *y = b;
+    if (x->addr != y->addr) return x->addr < y->addr ? -1 : 1;
+    return y->is_func - x->is_func;
+}
+
+static uint8_t *read_file(const char *path, size_t *size) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    uint8_t *buf = NULL;
+    if (fseek(f, 0, SEEK_END) == 0) {
+        long len = ftell(f);
+        if (len > 0 && fseek(f, 0, SEEK_SET) == 0 && (buf = malloc((size_t)len))) {
+            if (fread(buf, 1, (size_t)len, f) != (size_t)len) {
+                free(buf);
+                buf = NULL;
+            } else {
+                *size = (size_t)len;
+            }
+        }
+    }
+    fclose(f);
+    return buf;
+}
+
+static int load_sections(rv_image_t *img, char *err, size_t err_size) {
+    const uint8_t *f = img->file;
+    uint64_t shoff = rd64(f + 0x28);
+    uint16_t shentsize = rd16(f + 0x3a), shnum = rd16(f + 0x3c), shstrndx = rd16(f + 0x3e);
+    if (shoff == 0 || shnum == 0) return 0;
+    if (shoff + (uint64_t)shnum * shentsize > img->file_size || shstrndx >= shnum)
+        return fail(err, err_size, img->path, "truncated section table");
+
+    const uint8_t *shstr = f + shoff + (uint64_t)shstrndx * shentsize;
+    uint64_t shstr_off = rd64(shstr + 0x18);
+
+    for (uint16_t i = 0; i < shnum; i++) {
+        const uint8_t *sh = f + shoff + (uint64_t)i * shentsize;
+        const char *name = (const char *)f + shstr_off + rd32(sh);
+        uint32_t type = rd32(sh + 4);
+        uint64_t off = rd64(sh + 0x18), size = rd64(sh + 0x20);
+        if (off + size > img->file_size && type != 8 /* SHT_NOBITS */) continue;
+
+        if (strcmp(name, "__cap_relocs") == 0) {
+            img->caprel_count = size / 40;
+            img->caprels = calloc(img->caprel_count ? img->caprel_count : 1, sizeof(*img->caprels));
+            if (!img->caprels) return fail(err, err_size, img->path, "out of memory");
+            for (size_t r = 0; r < img->caprel_count; r++) {
+                const uint8_t *e = f + off + r * 40;
+                img->caprels[r].location = rd64(e) + img->bias;
+                img->caprels[r].base = rd64(e + 8) + img->bias;
+                img->caprels[r].offset = rd64(e + 16);
+                img->caprels[r].size = rd64(e + 24);
+                img->caprels[r].perms = rd64(e + 32);
+            }
+        } else if (type == SHT_SYMTAB) {
+            const uint8_t *strsh = f + shoff + (uint64_t)rd32(sh + 0x28) * shentsize;
+            const char *strtab = (const char *)f + rd64(strsh + 0x18);
+            size_t count = size / 24, n = 0;
+            img->symbols = calloc(count ? count : 1, sizeof(*img->symbols));
+            if (!img->symbols) return fail(err, err_size, img->path, "out of memory");
+            for (size_t s = 0; s < count; s++) {
+                const uint8_t *sym = f + off + s * 24;
+                uint8_t info = sym[4];
+                int stype = info & 0xf;
+                uint64_t value = rd64(sym + 8);
+                if ((stype != STT_FUNC && stype != STT_OBJECT) || rd16(sym + 6) == 0) continue;
+                img->symbols[n].addr = value + img->bias;
+                img->symbols[n].size = rd64(sym + 16);
+                img->symbols[n].name = strtab + rd32(sym);
+                img->symbols[n].is_func = stype == STT_FUNC;
+                if (strcmp(img->symbols[n].name, "__global_pointer$") == 0) continue;
+                n++;
+            }
+            img->symbol_count = n;
+            qsort(img->symbols, n, sizeof(*img->symbols), symbol_cmp);
+            // Untyped linker symbols are skipped above; look up the global pointer separately
+            for (size_t s = 0; s < count; s++) {
+                const uint8_t *sym = f + off + s * 24;
+                if (strcmp(strtab + rd32(sym), "__global_pointer$") == 0)
+                    img->gp = rd64(sym + 8) + img->bias;
+            }
+        }
+    }
+    return 0;
+}
+
+static int predecode(rv_image_t *img, char *err, size_t err_size) {
+    img->text_base = UINT64_MAX;
+    img->text_end = 0;
+    for (int i = 0; i < img->segment_count; i++) {
+        const rv_segment_t *s = &img->segments[i];
+        if (!(s->flags & RV_PF_X)) continue;
+        if (s->vaddr < img->text_base) img->text_base = s->vaddr;
+        if (s->vaddr + s->filesz > img->text_end) img->text_end = s->vaddr + s->filesz;
+    }
+    if (img->text_base >= img->text_end) return fail(err, err_size, img->path, "no executable segment");
+    img->text_base &= ~1ull;
+
+    size_t parcels = (size_t)((img->text_end - img->text_base) / 2);
+    img->text = calloc(parcels + 1, sizeof(*img->text));
+    if (!img->text) return fail(err, err_size, img->path, "out of memory");
+
+    // Every parcel is decoded so that any 2-byte-aligned entry point hits the table
+    for (size_t p = 0; p < parcels; p++) {
+        uint64_t addr = img->text_base + 2 * p;
+        uint16_t parcel[2] = { 0, 0 };
+        for (int i = 0; i < img->segment_count; i++) {
+            const rv_segment_t *s = &img->segments[i];
+            for (int k = 0; k < 2; k++) {
+                uint64_t a = addr + 2 * (uint64_t)k;
+                if (a >= s->vaddr && a + 2 <= s->vaddr + s->filesz)
+                    parcel[k] = rd16(s->data + (a - s->vaddr));
+            }
+        }
+        rv_decode(parcel[0], parcel[1], img->purecap, &img->text[p]);
+    }
+    return 0;
+}
+
+int rv_image_load(rv_image_t *img, const char *path, char *err, size_t err_size) {
+    memset(img, 0, sizeof(*img));
+    img->path = strdup(path);
+    img->file = read_file(path, &img->file_size);
+    if (!img->path || !img->file) return fail(err, err_size, path, "cannot read file");
+
+    const uint8_t *f = img->file;
+    if (img->file_size < 64 || memcmp(f, "\177ELF", 4) != 0 || f[4] != 2 || f[5] != 1)
+        return fail(err, err_size, path, "not a little-endian ELF64 file");
+    uint16_t type = rd16(f + 0x10);
+    if (rd16(f + 0x12) != EM_RISCV) return fail(err, err_size, path, "not a RISC-V binary");
+    if (type != ET_EXEC && type != ET_DYN) return fail(err, err_size, path, "not an executable");
+
+    uint32_t eflags = rd32(f + 0x30);
+    img->purecap = (eflags & (EF_RISCV_CHERIABI | EF_RISCV_CAP_MODE)) != 0;
+    img->bias = type == ET_DYN ? RV_PIE_BASE : 0;
+    img->entry = rd64(f + 0x18) + img->bias;
+
+    uint64_t phoff = rd64(f + 0x20);
+    uint16_t phentsize = rd16(f + 0x36), phnum = rd16(f + 0x38);
+    if (phoff + (uint64_t)phnum * phentsize > img->file_size)
+        return fail(err, err_size, path, "truncated program headers");
+    img->phent = phentsize;
+    img->phnum = phnum;
+
+    img->image_base = UINT64_MAX;
+    for (uint16_t i = 0; i < phnum; i++) {
+        const uint8_t *ph = f + phoff + (uint64_t)i * phentsize;
+        if (rd32(ph) != PT_LOAD || rd64(ph + 0x28) == 0) continue;
+        if (img->segment_count == (int)(sizeof(img->segments) / sizeof(img->segments[0])))
+            return fail(err, err_size, path, "too many loadable segments");
+        uint64_t off = rd64(ph + 8), filesz = rd64(ph + 0x20);
+        if (off + filesz > img->file_size) return fail(err, err_size, path, "truncated segment");
+
+        rv_segment_t *s = &img->segments[img->segment_count++];
+        s->vaddr = rd64(ph + 0x10) + img->bias;
+        // AT_PHDR for hosted start-up code: the program headers as loaded
+        if (phoff >= off && phoff + (uint64_t)phnum * phentsize <= off + filesz)
+            img->phdr = s->vaddr + (phoff - off);
+        s->memsz = rd64(ph + 0x28);
+        s->filesz = filesz;
+        s->data = f + off;
+        s->flags = rd32(ph + 4);
+        if (s->vaddr < img->image_base) img->image_base = s->vaddr;
+        if (s->vaddr + s->memsz > img->image_end) img->image_end = s->vaddr + s->memsz;
+    }
+    if (img->segment_count == 0) return fail(err, err_size, path, "no loadable segments");
+
+    if (load_sections(img, err, err_size) != 0) return -1;
+    img->startup = rd64(f + 0x18) != 0;
+    if (!img->startup) {
+        // Linked without start-up code: nothing sets e_entry, so start in main()
+        const rv_symbol_t *main_sym = rv_image_find(img, "main");
+        if (!main_sym) return fail(err, err_size, path, "no entry point");
+        img->entry = main_sym->addr;
+    }
+    // Statically linked against a Linux libc: run under the syscall layer
+    img->hosted = !img->purecap && rv_image_find(img, "__libc_start_main") != NULL;
+    // Bare-metal runtime (extreme-details/runtime): exit code through HTIF tohost
+    const rv_symbol_t *tohost = img->hosted ? NULL : rv_image_find(img, "tohost");
+    img->tohost = tohost ? tohost->addr : 0;
+    return predecode(img, err, err_size);
+}
+
+void rv_image_free(rv_image_t *img) {
+    free(img->path);
+    free(img->file);
+    free(img->symbols);
+    free(img->caprels);
+    free(img->text);
+    memset(img, 0, sizeof(*img));
+}
+
+const rv_symbol_t *rv_image_symbol(const rv_image_t *img, uint64_t addr) {
+    // Last function starting at or below addr, if addr falls inside it
+    size_t lo = 0, hi = img->symbol_count;
+    const rv_symbol_t *best = NULL;
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (img->symbols[mid].addr <= addr) lo = mid + 1;
+        else hi = mid;
+    }
+    for (size_t i = lo; i-- > 0;) {
+        const rv_symbol_t *s = &img->symbols[i];
+        if (!s->is_func) continue;
+        if (addr < s->addr + (s->size ? s->size : 1)) best = s;
+        break;
+    }
+    return best;
+}
+
+const rv_symbol_t *rv_image_find(const rv_image_t *img, const char *name) {
+    for (size_t i = 0; i < img->symbol_count; i++)
+        if (strcmp(img->symbols[i].name, name) == 0) return &img->symbols[i];
+    return NULL;
+}
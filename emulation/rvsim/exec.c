@@ -0,0 +1,822 @@
+/*
+ * rvsim - Functional Execution
+ *
+ * One hart, machine mode, no interrupts. Integer-mode code is authorized
+ * by DDC; capability-mode code (PCC flag) uses the register named by a
+ * load or store as its authority and turns AUIPC, JAL and JALR into their
+ * capability forms. Capability manipulation follows ISAv9: an invalid
+ * derivation clears the result tag, while memory accesses and jumps
+ * through an invalid capability stop the run with the CHERI cause.
+ * Floating-point instructions go to fpu.c; under Linux user mode (hosted
+ * binaries) ECALL goes to syscall.c and faults become signals. Bare-metal
+ * binaries get the semihosting console and exit calls.
+ */
+
+#include "rvsim.h"
+
+#include <string.h>
+
+#define CAP_PERMS_DATA  (CAP_PERM_GLOBAL | CAP_PERM_LOAD | CAP_PERM_STORE | CAP_PERM_LOAD_CAP | \
+                         CAP_PERM_STORE_CAP | CAP_PERM_STORE_LOCAL)
+#define CAP_PERMS_CODE  (CAP_PERM_GLOBAL | CAP_PERM_EXECUTE | CAP_PERM_LOAD | CAP_PERM_LOAD_CAP | \
+                         CAP_PERM_ACCESS_SYS)
+#define CAP_OTYPE_MAX   0x3FFEFull  // Highest non-reserved object type
+
+#define CSR_FFLAGS      0x001
+#define CSR_FRM         0x002
+#define CSR_FCSR        0x003
+#define CSR_CYCLE       0xC00
+#define CSR_TIME        0xC01
+#define CSR_INSTRET     0xC02
+#define CSR_MCYCLE      0xB00
+#define CSR_MINSTRET    0xB02
+
+// Semihosting: an EBREAK between these two hints, operation in a0, argument in a1
+#define SEMIHOST_ENTRY          0x01f01013u     // slli zero, zero, 0x1f
+#define SEMIHOST_EXIT           0x40705013u     // srai zero, zero, 7
+#define SYS_WRITEC              0x03
+#define SYS_WRITE0              0x04
+#define SYS_WRITE               0x05
+#define SYS_EXIT                0x18
+#define SYS_EXIT_EXTENDED       0x20
+#define ADP_STOPPED_EXIT        0x20026         // ADP_Stopped_ApplicationExit
+#define SEMIHOST_MAX_WRITE      4096
+
+// ---------------------------------------------------------------------------
+// Setup
+// ---------------------------------------------------------------------------
+
+static rv_cap_t cap_bounded(uint64_t base, uint64_t top, uint64_t addr, uint32_t perms) {
+    rv_cap_t c = { addr, base, top, CAP_OTYPE_UNSEALED, perms, 0, 1 };
+    return c;
+}
+
+int rv_machine_init(rv_machine_t *m, const rv_image_t *img, uint64_t stack_size) {
+    memset(m, 0, sizeof(*m));
+    m->image = img;
+    m->reservation = UINT64_MAX;
+    if (rv_mem_init(&m->mem) != 0) return -1;
+
+    // Regions are page granular; everything is writable until relocation is done
+    for (int i = 0; i < img->segment_count; i++) {
+        const rv_segment_t *s = &img->segments[i];
+        uint64_t start = s->vaddr & ~(uint64_t)(RV_PAGE_SIZE - 1);
+        uint64_t end = (s->vaddr + s->memsz + RV_PAGE_SIZE - 1) & ~(uint64_t)(RV_PAGE_SIZE - 1);
+        if (rv_mem_map(&m->mem, start, end - start, 1) != 0) return -1;
+        if (s->filesz && rv_mem_poke(&m->mem, s->vaddr, s->data, s->filesz) != 0) return -1;
+    }
+    if (rv_mem_map(&m->mem, RV_STACK_TOP - stack_size, stack_size, 1) != 0) return -1;
+
+    for (int r = 0; r < 32; r++) m->x[r] = rv_cap_null(0);
+    for (int r = 0; r < 32; r++) m->scr[r] = rv_cap_null(0);
+
+    if (img->purecap) {
+        m->pcc = cap_bounded(img->image_base, img->image_end, img->entry, CAP_PERMS_CODE);
+        m->pcc.flags = CAP_FLAG_CAPMODE;
+        // Start-up code finds the root data capability in DDC, as out of reset
+        m->ddc = img->startup ? rv_cap_almighty(0) : rv_cap_null(0);
+        m->x[2] = cap_bounded(RV_STACK_TOP - stack_size, RV_STACK_TOP, RV_STACK_TOP, CAP_PERMS_DATA);
+    } else {
+        m->pcc = rv_cap_almighty(img->entry);
+        m->ddc = rv_cap_almighty(0);
+        m->x[2] = rv_cap_null(RV_STACK_TOP);
+    }
+    // Binaries without start-up code enter at main(); catch its return
+    if (img->purecap) {
+        m->x[1] = rv_cap_almighty(RV_RETURN_PC);
+        m->x[1].flags = CAP_FLAG_CAPMODE;
+        m->x[1].otype = CAP_OTYPE_SENTRY;
+    } else {
+        m->x[1] = rv_cap_null(RV_RETURN_PC);
+    }
+    if (img->gp) m->x[3] = rv_cap_null(img->gp);
+
+    // What the run-time linker would do for __cap_relocs
+    for (size_t i = 0; i < img->caprel_count; i++) {
+        const rv_caprel_t *r = &img->caprels[i];
+        rv_cap_t c;
+        if (r->perms & RV_CAPREL_FUNCTION) {
+            c = m->pcc;
+            c.addr = r->base + r->offset;
+            c.otype = CAP_OTYPE_SENTRY;
+        } else {
+            uint32_t perms = CAP_PERMS_DATA;
+            if (r->perms & RV_CAPREL_CONSTANT) perms &= ~(CAP_PERM_STORE | CAP_PERM_STORE_CAP | CAP_PERM_STORE_LOCAL);
+            c = cap_bounded(r->base, r->base + r->size, r->base + r->offset, perms);
+        }
+        if (rv_mem_write_cap(&m->mem, r->location, &c) != 0) return -1;
+    }
+
+    for (int i = 0; i < img->segment_count; i++)
+        m->mem.regions[i].writable = (img->segments[i].flags & RV_PF_W) != 0;
+    return 0;
+}
+
+void rv_machine_free(rv_machine_t *m) {
+    rv_mem_free(&m->mem);
+}
+
+const char *rv_stop_name(rv_stop_t stop) {
+    static const char *const names[] = {
+        "running", "idle", "wfi", "ebreak", "ecall", "limit", "illegal", "access", "cheri", "return",
+        "exit", "signal",
+    };
+    return stop <= RV_STOP_SIGNAL ? names[stop] : "?";
+}
+
+const char *rv_capx_name(rv_capx_t capx) {
+    static const char *const names[] = {
+        "none", "tag violation", "seal violation", "permission violation",
+        "length violation", "misaligned capability",
+    };
+    return capx <= RV_CAPX_ALIGN ? names[capx] : "?";
+}
+
+// ---------------------------------------------------------------------------
+// Traps
+// ---------------------------------------------------------------------------
+
+static int stop_cap(rv_machine_t *m, rv_capx_t cause, const char *reg, uint64_t addr) {
+    m->stop = RV_STOP_CAP;
+    m->capx = cause;
+    m->stop_pc = m->pcc.addr;
+    m->stop_addr = addr;
+    snprintf(m->stop_detail, sizeof(m->stop_detail), "%s via %s at 0x%llx",
+             rv_capx_name(cause), reg, (unsigned long long)addr);
+    return 1;
+}
+
+static int stop_access(rv_machine_t *m, int rc, int store, uint64_t addr) {
+    m->stop = RV_STOP_ACCESS;
+    m->stop_pc = m->pcc.addr;
+    m->stop_addr = addr;
+    snprintf(m->stop_detail, sizeof(m->stop_detail), "%s %s 0x%llx",
+             store ? "store to" : "load from",
+             rc == RV_MEM_READONLY ? "read-only" : "unmapped", (unsigned long long)addr);
+    return 1;
+}
+
+static int stop_with(rv_machine_t *m, rv_stop_t why, const char *detail) {
+    m->stop = why;
+    m->stop_pc = m->pcc.addr;
+    snprintf(m->stop_detail, sizeof(m->stop_detail), "%s", detail);
+    return 1;
+}
+
+// Bare-metal halt: an HTIF exit ((code << 1) | 1 in tohost) turns it into an exit
+static int stop_halt(rv_machine_t *m, rv_stop_t why, const char *detail) {
+    uint64_t tohost = 0;
+    if (m->image->tohost && rv_mem_read(&m->mem, m->image->tohost, &tohost, 8) == 0 && (tohost & 1)) {
+        stop_with(m, RV_STOP_EXIT, detail);
+        m->exit_code = (int)(tohost >> 1);
+        snprintf(m->stop_detail, sizeof(m->stop_detail), "exit status %d", m->exit_code);
+        return 1;
+    }
+    return stop_with(m, why, detail);
+}
+
+// ---------------------------------------------------------------------------
+// Semihosting (bare-metal runs)
+// ---------------------------------------------------------------------------
+
+static void semihost_out(rv_machine_t *m, uint64_t addr, uint64_t len, int nul) {
+    for (uint64_t i = 0; i < len; i++) {
+        uint8_t c;
+        if (rv_mem_read(&m->mem, addr + i, &c, 1) != 0 || (nul && c == 0)) break;
+        if (m->console) fputc(c, m->console);
+    }
+}
+
+/*
+ * -1 if the EBREAK at pc is not a semihosting call, 1 if the call ended the
+ * run, 0 once it is done and a0 holds its result. Only the console and exit
+ * calls are provided; the rest fail with -1.
+ */
+static int semihost(rv_machine_t *m, uint64_t pc) {
+    uint32_t before = 0, after = 0;
+    if (rv_mem_read(&m->mem, pc - 4, &before, 4) != 0 || before != SEMIHOST_ENTRY) return -1;
+    if (rv_mem_read(&m->mem, pc + 4, &after, 4) != 0 || after != SEMIHOST_EXIT) return -1;
+
+    uint64_t op = m->x[10].addr, arg = m->x[11].addr, block[3] = { 0, 0, 0 }, ret = 0;
+    switch (op) {
+    case SYS_WRITEC: semihost_out(m, arg, 1, 0); break;
+    case SYS_WRITE0: semihost_out(m, arg, SEMIHOST_MAX_WRITE, 1); break;
+    case SYS_WRITE:
+        // { fd, buffer, length }: everything goes to the console; returns the bytes not written
+        if (rv_mem_read(&m->mem, arg, block, sizeof(block)) != 0) ret = (uint64_t)-1;
+        else semihost_out(m, block[1], block[2], 0);
+        break;
+    case SYS_EXIT: case SYS_EXIT_EXTENDED:
+        // { reason, exit code }
+        rv_mem_read(&m->mem, arg, block, 16);
+        stop_with(m, RV_STOP_EXIT, "semihosting exit");
+        m->exit_code = block[0] == ADP_STOPPED_EXIT ? (int)block[1] : 1;
+        snprintf(m->stop_detail, sizeof(m->stop_detail), "exit status %d", m->exit_code);
+        return 1;
+    default: ret = (uint64_t)-1; break;
+    }
+    m->x[10] = rv_cap_null(ret);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Helpers
+// ---------------------------------------------------------------------------
+
+static inline void wr(rv_machine_t *m, int rd, uint64_t v) {
+    if (rd) m->x[rd] = rv_cap_null(v);
+}
+
+static inline void wr_cap(rv_machine_t *m, int rd, const rv_cap_t *c) {
+    if (rd) m->x[rd] = *c;
+}
+
+// Integer source operand; floating-point sources read as zero here
+static inline uint64_t rd_x(const rv_machine_t *m, int r) {
+    return r < RV_FREG ? m->x[r].addr : 0;
+}
+
+static inline int capmode(const rv_machine_t *m) {
+    return m->pcc.flags & CAP_FLAG_CAPMODE;
+}
+
+// rs1 == 0 names DDC in the instructions that take an authority
+static inline const rv_cap_t *cap_or_ddc(const rv_machine_t *m, int r) {
+    return r ? &m->x[r] : &m->ddc;
+}
+
+/*
+ * Authorize a data access of size bytes and compute its address. Returns
+ * the authorizing capability or NULL after stopping the machine.
+ */
+static const rv_cap_t *authorize(rv_machine_t *m, const rv_insn_t *in, uint32_t need,
+                                 uint64_t size, uint64_t *addr) {
+    const rv_cap_t *auth;
+    const char *name;
+    if (capmode(m)) {
+        auth = &m->x[in->rs1];
+        name = rv_reg_name(in->rs1);
+        *addr = auth->addr + (uint64_t)in->imm;
+    } else {
+        auth = &m->ddc;
+        name = "ddc";
+        *addr = m->x[in->rs1].addr + (uint64_t)in->imm;
+    }
+    if (!auth->tag) return stop_cap(m, RV_CAPX_TAG, name, *addr), NULL;
+    if (rv_cap_sealed(auth)) return stop_cap(m, RV_CAPX_SEAL, name, *addr), NULL;
+    if ((auth->perms & need) != need) return stop_cap(m, RV_CAPX_PERM, name, *addr), NULL;
+    if (!rv_cap_in_bounds(auth, *addr, size)) return stop_cap(m, RV_CAPX_BOUNDS, name, *addr), NULL;
+    if (size == RV_CAP_SIZE && (*addr & (RV_CAP_SIZE - 1)))
+        return stop_cap(m, RV_CAPX_ALIGN, name, *addr), NULL;
+    return auth;
+}
+
+static inline uint64_t load_extend(rv_op_t op, uint64_t raw) {
+    switch (op) {
+    case RV_OP_LB: return (uint64_t)(int64_t)(int8_t)raw;
+    case RV_OP_LH: return (uint64_t)(int64_t)(int16_t)raw;
+    case RV_OP_LW: return (uint64_t)(int64_t)(int32_t)raw;
+    case RV_OP_LBU: return raw & 0xff;
+    case RV_OP_LHU: return raw & 0xffff;
+    case RV_OP_LWU: return raw & 0xffffffffu;
+    default: return raw;
+    }
+}
+
+static uint64_t amo_apply(rv_op_t op, uint64_t old, uint64_t src, int word) {
+    int64_t so = word ? (int32_t)old : (int64_t)old, ss = word ? (int32_t)src : (int64_t)src;
+    uint64_t uo = word ? (uint32_t)old : old, us = word ? (uint32_t)src : src;
+    switch (op) {
+    case RV_OP_AMOSWAP_W: case RV_OP_AMOSWAP_D: return src;
+    case RV_OP_AMOADD_W: case RV_OP_AMOADD_D: return old + src;
+    case RV_OP_AMOXOR_W: case RV_OP_AMOXOR_D: return old ^ src;
+    case RV_OP_AMOAND_W: case RV_OP_AMOAND_D: return old & src;
+    case RV_OP_AMOOR_W: case RV_OP_AMOOR_D: return old | src;
+    case RV_OP_AMOMIN_W: case RV_OP_AMOMIN_D: return so < ss ? old : src;
+    case RV_OP_AMOMAX_W: case RV_OP_AMOMAX_D: return so > ss ? old : src;
+    case RV_OP_AMOMINU_W: case RV_OP_AMOMINU_D: return uo < us ? old : src;
+    case RV_OP_AMOMAXU_W: case RV_OP_AMOMAXU_D: return uo > us ? old : src;
+    default: return old;
+    }
+}
+
+static uint64_t csr_read(const rv_machine_t *m, uint64_t csr) {
+    switch (csr) {
+    case CSR_CYCLE: case CSR_TIME: case CSR_MCYCLE:
+        return m->cycle_source ? *m->cycle_source : m->instret;
+    case CSR_INSTRET: case CSR_MINSTRET:
+        return m->instret;
+    case CSR_FFLAGS: return m->fcsr & 0x1f;
+    case CSR_FRM: return (m->fcsr >> 5) & 7;
+    case CSR_FCSR: return m->fcsr;
+    default:
+        return 0;
+    }
+}
+
+// Only the floating-point CSRs are writable; writes to others are ignored
+static void csr_write(rv_machine_t *m, uint64_t csr, uint64_t v) {
+    switch (csr) {
+    case CSR_FFLAGS: m->fcsr = (m->fcsr & ~0x1fu) | (uint32_t)(v & 0x1f); break;
+    case CSR_FRM: m->fcsr = (m->fcsr & 0x1f) | (uint32_t)(v & 7) << 5; break;
+    case CSR_FCSR: m->fcsr = (uint32_t)(v & 0xff); break;
+    default: break;
+    }
+}
+
+// A backward jump over nothing but nops is the bare-metal "halt" idiom
+static int is_idle_loop(const rv_machine_t *m, uint64_t pc, int64_t offset) {
+    const rv_image_t *img = m->image;
+    if (offset > 0) return 0;
+    uint64_t target = pc + (uint64_t)offset;
+    if (target < img->text_base || pc >= img->text_end) return 0;
+    for (uint64_t a = target; a < pc;) {
+        const rv_insn_t *in = &img->text[(a - img->text_base) / 2];
+        if (in->op != RV_OP_ADDI || in->rd != 0) return 0;
+        a += in->len;
+    }
+    return 1;
+}
+
+// Capability jump (CJALR, and JALR in capability mode)
+static int cap_jump(rv_machine_t *m, const rv_insn_t *in, uint64_t *next) {
+    rv_cap_t target = m->x[in->rs1];
+    const char *name = rv_reg_name(in->rs1);
+    uint64_t addr = (target.addr + (uint64_t)in->imm) & ~1ull;
+    if (!target.tag) return stop_cap(m, RV_CAPX_TAG, name, addr);
+    if (rv_cap_sealed(&target) && (target.otype != CAP_OTYPE_SENTRY || in->imm != 0))
+        return stop_cap(m, RV_CAPX_SEAL, name, addr);
+    if (!(target.perms & CAP_PERM_EXECUTE)) return stop_cap(m, RV_CAPX_PERM, name, addr);
+    if (!rv_cap_in_bounds(&target, addr, 2)) return stop_cap(m, RV_CAPX_BOUNDS, name, addr);
+
+    rv_cap_t link = m->pcc;
+    link.addr = *next;
+    link.otype = CAP_OTYPE_SENTRY;
+    target.otype = CAP_OTYPE_UNSEALED;
+    target.addr = addr;
+    m->pcc = target;
+    wr_cap(m, in->rd, &link);
+    *next = addr;
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Capability manipulation
+// ---------------------------------------------------------------------------
+
+static void exec_cap(rv_machine_t *m, const rv_insn_t *in, uint64_t pc) {
+    const rv_cap_t *cs1 = &m->x[in->rs1], *cs2 = &m->x[in->rs2];
+    uint64_t rs2v = cs2->addr;
+    rv_cap_t c = *cs1;
+
+    switch ((rv_op_t)in->op) {
+    case RV_OP_CGETPERM: wr(m, in->rd, cs1->perms); return;
+    case RV_OP_CGETTYPE: wr(m, in->rd, cs1->otype); return;
+    case RV_OP_CGETBASE: wr(m, in->rd, cs1->base); return;
+    case RV_OP_CGETLEN: wr(m, in->rd, rv_cap_length(cs1)); return;
+    case RV_OP_CGETTAG: wr(m, in->rd, cs1->tag); return;
+    case RV_OP_CGETSEALED: wr(m, in->rd, rv_cap_sealed(cs1)); return;
+    case RV_OP_CGETOFFSET: wr(m, in->rd, cs1->addr - cs1->base); return;
+    case RV_OP_CGETFLAGS: wr(m, in->rd, cs1->flags); return;
+    case RV_OP_CGETADDR: wr(m, in->rd, cs1->addr); return;
+    // Bounds are exact, so every length is representable
+    case RV_OP_CRRL: wr(m, in->rd, cs1->addr); return;
+    case RV_OP_CRAM: wr(m, in->rd, UINT64_MAX); return;
+    case RV_OP_CSUB: wr(m, in->rd, cs1->addr - rs2v); return;
+    case RV_OP_CTOPTR: {
+        const rv_cap_t *auth = cap_or_ddc(m, in->rs2);
+        wr(m, in->rd, cs1->tag ? cs1->addr - auth->base : 0);
+        return;
+    }
+    case RV_OP_CTESTSUBSET: {
+        const rv_cap_t *a = cap_or_ddc(m, in->rs1);
+        wr(m, in->rd, a->tag == cs2->tag && cs2->base >= a->base && cs2->top <= a->top &&
+                      (cs2->perms & ~a->perms) == 0);
+        return;
+    }
+    case RV_OP_CSETEQUALEXACT:
+        wr(m, in->rd, cs1->addr == cs2->addr && cs1->base == cs2->base && cs1->top == cs2->top &&
+                      cs1->otype == cs2->otype && cs1->perms == cs2->perms &&
+                      cs1->flags == cs2->flags && cs1->tag == cs2->tag);
+        return;
+
+    case RV_OP_CMOVE: break;
+    case RV_OP_CCLEARTAG: c.tag = 0; break;
+    case RV_OP_CSEALENTRY:
+        if (!c.tag || rv_cap_sealed(&c) || !(c.perms & CAP_PERM_EXECUTE)) c.tag = 0;
+        c.otype = CAP_OTYPE_SENTRY;
+        break;
+    case RV_OP_CSETBOUNDS: case RV_OP_CSETBOUNDSEXACT: case RV_OP_CSETBOUNDSIMM: {
+        uint64_t len = in->op == RV_OP_CSETBOUNDSIMM ? (uint64_t)in->imm : rs2v;
+        if (!c.tag || rv_cap_sealed(&c) || !rv_cap_in_bounds(&c, c.addr, len)) c.tag = 0;
+        c.base = c.addr;
+        c.top = len > CAP_TOP_MAX - c.addr ? CAP_TOP_MAX : c.addr + len;
+        break;
+    }
+    case RV_OP_CSEAL: case RV_OP_CCSEAL:
+        if (in->op == RV_OP_CCSEAL && (!cs2->tag || cs2->addr == UINT64_MAX)) break;
+        if (!c.tag || !cs2->tag || rv_cap_sealed(&c) || rv_cap_sealed(cs2) ||
+            !(cs2->perms & CAP_PERM_SEAL) || !rv_cap_in_bounds(cs2, cs2->addr, 1) ||
+            cs2->addr > CAP_OTYPE_MAX) {
+            c.tag = 0;
+        } else {
+            c.otype = cs2->addr;
+        }
+        break;
+    case RV_OP_CUNSEAL:
+        if (!c.tag || !cs2->tag || !rv_cap_sealed(&c) || c.otype > CAP_OTYPE_MAX ||
+            rv_cap_sealed(cs2) || !(cs2->perms & CAP_PERM_UNSEAL) || cs2->addr != c.otype ||
+            !rv_cap_in_bounds(cs2, cs2->addr, 1))
+            c.tag = 0;
+        c.otype = CAP_OTYPE_UNSEALED;
+        if (!(cs2->perms & CAP_PERM_GLOBAL)) c.perms &= ~CAP_PERM_GLOBAL;
+        break;
+    case RV_OP_CANDPERM:
+        if (rv_cap_sealed(&c)) c.tag = 0;
+        c.perms &= (uint32_t)rs2v;
+        break;
+    case RV_OP_CSETFLAGS:
+        if (rv_cap_sealed(&c)) c.tag = 0;
+        c.flags = (uint8_t)(rs2v & CAP_FLAG_CAPMODE);
+        break;
+    case RV_OP_CSETOFFSET:
+        if (rv_cap_sealed(&c)) c.tag = 0;
+        c.addr = c.base + rs2v;
+        break;
+    case RV_OP_CSETADDR:
+        if (rv_cap_sealed(&c)) c.tag = 0;
+        c.addr = rs2v;
+        break;
+    case RV_OP_CINCOFFSET: case RV_OP_CINCOFFSETIMM:
+        if (rv_cap_sealed(&c)) c.tag = 0;
+        c.addr += in->op == RV_OP_CINCOFFSETIMM ? (uint64_t)in->imm : rs2v;
+        break;
+    case RV_OP_CFROMPTR:
+        if (rs2v == 0) {
+            c = rv_cap_null(0);
+        } else {
+            c = *cap_or_ddc(m, in->rs1);
+            if (rv_cap_sealed(&c)) c.tag = 0;
+            c.addr = c.base + rs2v;
+        }
+        break;
+    case RV_OP_CBUILDCAP: {
+        const rv_cap_t *auth = cap_or_ddc(m, in->rs1);
+        c = *cs2;
+        c.tag = auth->tag && !rv_cap_sealed(auth) && c.base <= c.top && c.base >= auth->base &&
+                c.top <= auth->top && (c.perms & ~auth->perms) == 0;
+        if (c.otype != CAP_OTYPE_SENTRY) c.otype = CAP_OTYPE_UNSEALED;
+        break;
+    }
+    case RV_OP_CCOPYTYPE:
+        if (!rv_cap_sealed(cs2) || cs2->otype > CAP_OTYPE_MAX) {
+            c = rv_cap_null(cs2->otype);
+        } else {
+            if (!c.tag || rv_cap_sealed(&c) || !rv_cap_in_bounds(&c, cs2->otype, 1)) c.tag = 0;
+            c.addr = cs2->otype;
+        }
+        break;
+    case RV_OP_CSPECIALRW: {
+        int scr = (int)in->imm;
+        rv_cap_t old = scr == 0 ? m->pcc : scr == 1 ? m->ddc : m->scr[scr];
+        if (scr == 0) old.addr = pc;
+        if (in->rs1 && scr == 1) m->ddc = *cs1;
+        else if (in->rs1 && scr > 1) m->scr[scr] = *cs1;
+        wr_cap(m, in->rd, &old);
+        return;
+    }
+    default:
+        return;
+    }
+    wr_cap(m, in->rd, &c);
+}
+
+// ---------------------------------------------------------------------------
+// Step
+// ---------------------------------------------------------------------------
+
+static int step(rv_machine_t *m, rv_exec_t *e) {
+    const rv_image_t *img = m->image;
+    uint64_t pc = m->pcc.addr;
+    const rv_insn_t *in;
+    rv_insn_t fetched;
+
+    if (m->stop != RV_STOP_NONE) return 1;
+    if (pc == RV_SIGRETURN_PC && m->os) {
+        // A signal handler returned: resume the interrupted context
+        if (rv_linux_sigreturn(m)) return 1;
+        pc = m->pcc.addr;
+    }
+    if (pc == RV_RETURN_PC) return stop_with(m, RV_STOP_RETURN, "entry point returned");
+    if (!m->pcc.tag) return stop_cap(m, RV_CAPX_TAG, "pcc", pc);
+    if (rv_cap_sealed(&m->pcc)) return stop_cap(m, RV_CAPX_SEAL, "pcc", pc);
+    if (!(m->pcc.perms & CAP_PERM_EXECUTE)) return stop_cap(m, RV_CAPX_PERM, "pcc", pc);
+
+    if (pc >= img->text_base && pc + 2 <= img->text_end && !(pc & 1) &&
+        (capmode(m) != 0) == (img->purecap != 0)) {
+        in = &img->text[(pc - img->text_base) / 2];
+    } else {
+        // Code outside the predecoded text, or in the other encoding mode
+        uint16_t parcel[2] = { 0, 0 };
+        if (pc & 1) return stop_with(m, RV_STOP_ILLEGAL, "misaligned pc");
+        int rc = rv_mem_read(&m->mem, pc, &parcel[0], 2);
+        if (rc) return stop_access(m, rc, 0, pc);
+        if ((parcel[0] & 3) == 3 && (rc = rv_mem_read(&m->mem, pc + 2, &parcel[1], 2)) != 0)
+            return stop_access(m, rc, 0, pc + 2);
+        rv_decode(parcel[0], parcel[1], capmode(m), &fetched);
+        in = &fetched;
+    }
+    if (!rv_cap_in_bounds(&m->pcc, pc, in->len)) return stop_cap(m, RV_CAPX_BOUNDS, "pcc", pc);
+
+    int cm = capmode(m);
+    uint64_t next = pc + in->len;
+    uint64_t rs1 = rd_x(m, in->rs1), rs2 = rd_x(m, in->rs2);
+    e->mem_addr = 0;
+    e->taken = 0;
+    e->cap_checked = 0;
+
+    switch ((rv_op_t)in->op) {
+    case RV_OP_ILLEGAL:
+        return stop_with(m, RV_STOP_ILLEGAL, "illegal instruction");
+
+    case RV_OP_LUI: wr(m, in->rd, (uint64_t)in->imm); break;
+    case RV_OP_AUIPC:
+        if (cm) {
+            rv_cap_t c = m->pcc;
+            c.addr = pc + (uint64_t)in->imm;
+            wr_cap(m, in->rd, &c);
+        } else {
+            wr(m, in->rd, pc + (uint64_t)in->imm);
+        }
+        break;
+
+    case RV_OP_JAL:
+        if (in->rd == 0 && is_idle_loop(m, pc, in->imm))
+            return stop_halt(m, RV_STOP_IDLE, "idle loop");
+        if (cm) {
+            rv_cap_t link = m->pcc;
+            link.addr = next;
+            link.otype = CAP_OTYPE_SENTRY;
+            wr_cap(m, in->rd, &link);
+        } else {
+            wr(m, in->rd, next);
+        }
+        next = pc + (uint64_t)in->imm;
+        e->taken = 1;
+        break;
+    case RV_OP_JALR:
+        if (cm) {
+            if (cap_jump(m, in, &next)) return 1;
+        } else {
+            uint64_t target = (rs1 + (uint64_t)in->imm) & ~1ull;
+            wr(m, in->rd, next);
+            next = target;
+        }
+        e->taken = 1;
+        break;
+    case RV_OP_CJALR:
+        if (cap_jump(m, in, &next)) return 1;
+        e->taken = 1;
+        break;
+
+    case RV_OP_BEQ: e->taken = rs1 == rs2; break;
+    case RV_OP_BNE: e->taken = rs1 != rs2; break;
+    case RV_OP_BLT: e->taken = (int64_t)rs1 < (int64_t)rs2; break;
+    case RV_OP_BGE: e->taken = (int64_t)rs1 >= (int64_t)rs2; break;
+    case RV_OP_BLTU: e->taken = rs1 < rs2; break;
+    case RV_OP_BGEU: e->taken = rs1 >= rs2; break;
+
+    case RV_OP_LB: case RV_OP_LH: case RV_OP_LW: case RV_OP_LD:
+    case RV_OP_LBU: case RV_OP_LHU: case RV_OP_LWU: {
+        uint64_t addr, raw = 0;
+        if (!authorize(m, in, CAP_PERM_LOAD, in->mem_size, &addr)) return 1;
+        int rc = rv_mem_read(&m->mem, addr, &raw, in->mem_size);
+        if (rc) return stop_access(m, rc, 0, addr);
+        wr(m, in->rd, load_extend((rv_op_t)in->op, raw));
+        e->mem_addr = addr;
+        break;
+    }
+    case RV_OP_FLW: case RV_OP_FLD: {
+        uint64_t addr, raw = 0;
+        if (!authorize(m, in, CAP_PERM_LOAD, in->mem_size, &addr)) return 1;
+        int rc = rv_mem_read(&m->mem, addr, &raw, in->mem_size);
+        if (rc) return stop_access(m, rc, 0, addr);
+        m->f[in->rd - RV_FREG] = in->mem_size == 4 ? 0xffffffff00000000ull | raw : raw;
+        e->mem_addr = addr;
+        break;
+    }
+    case RV_OP_FSW: case RV_OP_FSD: {
+        uint64_t addr;
+        if (!authorize(m, in, CAP_PERM_STORE, in->mem_size, &addr)) return 1;
+        int rc = rv_mem_write(&m->mem, addr, &m->f[in->rs2 - RV_FREG], in->mem_size);
+        if (rc) return stop_access(m, rc, 1, addr);
+        if ((addr & ~7ull) == (m->reservation & ~7ull)) m->reservation = UINT64_MAX;
+        e->mem_addr = addr;
+        break;
+    }
+    case RV_OP_SB: case RV_OP_SH: case RV_OP_SW: case RV_OP_SD: {
+        uint64_t addr;
+        if (!authorize(m, in, CAP_PERM_STORE, in->mem_size, &addr)) return 1;
+        int rc = rv_mem_write(&m->mem, addr, &rs2, in->mem_size);
+        if (rc) return stop_access(m, rc, 1, addr);
+        if ((addr & ~7ull) == (m->reservation & ~7ull)) m->reservation = UINT64_MAX;
+        e->mem_addr = addr;
+        break;
+    }
+    case RV_OP_CLC: {
+        uint64_t addr;
+        rv_cap_t c;
+        const rv_cap_t *auth = authorize(m, in, CAP_PERM_LOAD, RV_CAP_SIZE, &addr);
+        if (!auth) return 1;
+        int rc = rv_mem_read_cap(&m->mem, addr, &c);
+        if (rc) return stop_access(m, rc, 0, addr);
+        if (!(auth->perms & CAP_PERM_LOAD_CAP)) c.tag = 0;
+        wr_cap(m, in->rd, &c);
+        e->mem_addr = addr;
+        break;
+    }
+    case RV_OP_CSC: {
+        uint64_t addr;
+        rv_cap_t c = m->x[in->rs2];
+        uint32_t need = CAP_PERM_STORE;
+        if (c.tag) need |= CAP_PERM_STORE_CAP;
+        if (c.tag && !(c.perms & CAP_PERM_GLOBAL)) need |= CAP_PERM_STORE_LOCAL;
+        if (!authorize(m, in, need, RV_CAP_SIZE, &addr)) return 1;
+        int rc = rv_mem_write_cap(&m->mem, addr, &c);
+        if (rc) return stop_access(m, rc, 1, addr);
+        e->mem_addr = addr;
+        break;
+    }
+
+    case RV_OP_ADDI: wr(m, in->rd, rs1 + (uint64_t)in->imm); break;
+    case RV_OP_SLTI: wr(m, in->rd, (int64_t)rs1 < in->imm); break;
+    case RV_OP_SLTIU: wr(m, in->rd, rs1 < (uint64_t)in->imm); break;
+    case RV_OP_XORI: wr(m, in->rd, rs1 ^ (uint64_t)in->imm); break;
+    case RV_OP_ORI: wr(m, in->rd, rs1 | (uint64_t)in->imm); break;
+    case RV_OP_ANDI: wr(m, in->rd, rs1 & (uint64_t)in->imm); break;
+    case RV_OP_SLLI: wr(m, in->rd, rs1 << in->imm); break;
+    case RV_OP_SRLI: wr(m, in->rd, rs1 >> in->imm); break;
+    case RV_OP_SRAI: wr(m, in->rd, (uint64_t)((int64_t)rs1 >> in->imm)); break;
+    case RV_OP_ADD: wr(m, in->rd, rs1 + rs2); break;
+    case RV_OP_SUB: wr(m, in->rd, rs1 - rs2); break;
+    case RV_OP_SLL: wr(m, in->rd, rs1 << (rs2 & 63)); break;
+    case RV_OP_SLT: wr(m, in->rd, (int64_t)rs1 < (int64_t)rs2); break;
+    case RV_OP_SLTU: wr(m, in->rd, rs1 < rs2); break;
+    case RV_OP_XOR: wr(m, in->rd, rs1 ^ rs2); break;
+    case RV_OP_SRL: wr(m, in->rd, rs1 >> (rs2 & 63)); break;
+    case RV_OP_SRA: wr(m, in->rd, (uint64_t)((int64_t)rs1 >> (rs2 & 63))); break;
+    case RV_OP_OR: wr(m, in->rd, rs1 | rs2); break;
+    case RV_OP_AND: wr(m, in->rd, rs1 & rs2); break;
+    case RV_OP_ADDIW: wr(m, in->rd, (uint64_t)(int64_t)(int32_t)(rs1 + (uint64_t)in->imm)); break;
+    case RV_OP_SLLIW: wr(m, in->rd, (uint64_t)(int64_t)(int32_t)((uint32_t)rs1 << in->imm)); break;
+    case RV_OP_SRLIW: wr(m, in->rd, (uint64_t)(int64_t)(int32_t)((uint32_t)rs1 >> in->imm)); break;
+    case RV_OP_SRAIW: wr(m, in->rd, (uint64_t)(int64_t)((int32_t)rs1 >> in->imm)); break;
+    case RV_OP_ADDW: wr(m, in->rd, (uint64_t)(int64_t)(int32_t)(rs1 + rs2)); break;
+    case RV_OP_SUBW: wr(m, in->rd, (uint64_t)(int64_t)(int32_t)(rs1 - rs2)); break;
+    case RV_OP_SLLW: wr(m, in->rd, (uint64_t)(int64_t)(int32_t)((uint32_t)rs1 << (rs2 & 31))); break;
+    case RV_OP_SRLW: wr(m, in->rd, (uint64_t)(int64_t)(int32_t)((uint32_t)rs1 >> (rs2 & 31))); break;
+    case RV_OP_SRAW: wr(m, in->rd, (uint64_t)(int64_t)((int32_t)rs1 >> (rs2 & 31))); break;
+
+    case RV_OP_MUL: wr(m, in->rd, rs1 * rs2); break;
+    case RV_OP_MULH: wr(m, in->rd, (uint64_t)(((__int128)(int64_t)rs1 * (int64_t)rs2) >> 64)); break;
+    case RV_OP_MULHSU:
+        wr(m, in->rd, (uint64_t)(((__int128)(int64_t)rs1 * (unsigned __int128)rs2) >> 64));
+        break;
+    case RV_OP_MULHU: wr(m, in->rd, (uint64_t)(((unsigned __int128)rs1 * rs2) >> 64)); break;
+    case RV_OP_DIV:
+        wr(m, in->rd, rs2 == 0 ? UINT64_MAX
+                      : ((int64_t)rs1 == INT64_MIN && (int64_t)rs2 == -1) ? rs1
+                      : (uint64_t)((int64_t)rs1 / (int64_t)rs2));
+        break;
+    case RV_OP_DIVU: wr(m, in->rd, rs2 == 0 ? UINT64_MAX : rs1 / rs2); break;
+    case RV_OP_REM:
+        wr(m, in->rd, rs2 == 0 ? rs1
+                      : ((int64_t)rs1 == INT64_MIN && (int64_t)rs2 == -1) ? 0
+                      : (uint64_t)((int64_t)rs1 % (int64_t)rs2));
+        break;
+    case RV_OP_REMU: wr(m, in->rd, rs2 == 0 ? rs1 : rs1 % rs2); break;
+    case RV_OP_MULW: wr(m, in->rd, (uint64_t)(int64_t)(int32_t)(rs1 * rs2)); break;
+    case RV_OP_DIVW: {
+        int32_t a = (int32_t)rs1, b = (int32_t)rs2;
+        wr(m, in->rd, (uint64_t)(int64_t)(b == 0 ? -1 : (a == INT32_MIN && b == -1) ? a : a / b));
+        break;
+    }
+    case RV_OP_DIVUW: {
+        uint32_t a = (uint32_t)rs1, b = (uint32_t)rs2;
+        wr(m, in->rd, (uint64_t)(int64_t)(int32_t)(b == 0 ? UINT32_MAX : a / b));
+        break;
+    }
+    case RV_OP_REMW: {
+        int32_t a = (int32_t)rs1, b = (int32_t)rs2;
+        wr(m, in->rd, (uint64_t)(int64_t)(b == 0 ? a : (a == INT32_MIN && b == -1) ? 0 : a % b));
+        break;
+    }
+    case RV_OP_REMUW: {
+        uint32_t a = (uint32_t)rs1, b = (uint32_t)rs2;
+        wr(m, in->rd, (uint64_t)(int64_t)(int32_t)(b == 0 ? a : a % b));
+        break;
+    }
+
+    case RV_OP_LR_W: case RV_OP_LR_D: {
+        uint64_t addr, raw = 0;
+        if (!authorize(m, in, CAP_PERM_LOAD, in->mem_size, &addr)) return 1;
+        int rc = rv_mem_read(&m->mem, addr, &raw, in->mem_size);
+        if (rc) return stop_access(m, rc, 0, addr);
+        wr(m, in->rd, in->mem_size == 4 ? (uint64_t)(int64_t)(int32_t)raw : raw);
+        m->reservation = addr;
+        e->mem_addr = addr;
+        break;
+    }
+    case RV_OP_SC_W: case RV_OP_SC_D: {
+        uint64_t addr;
+        if (!authorize(m, in, CAP_PERM_STORE, in->mem_size, &addr)) return 1;
+        if (m->reservation == addr) {
+            int rc = rv_mem_write(&m->mem, addr, &rs2, in->mem_size);
+            if (rc) return stop_access(m, rc, 1, addr);
+            wr(m, in->rd, 0);
+        } else {
+            wr(m, in->rd, 1);
+        }
+        m->reservation = UINT64_MAX;
+        e->mem_addr = addr;
+        break;
+    }
+    case RV_OP_AMOSWAP_W: case RV_OP_AMOADD_W: case RV_OP_AMOXOR_W: case RV_OP_AMOAND_W:
+    case RV_OP_AMOOR_W: case RV_OP_AMOMIN_W: case RV_OP_AMOMAX_W: case RV_OP_AMOMINU_W:
+    case RV_OP_AMOMAXU_W: case RV_OP_AMOSWAP_D: case RV_OP_AMOADD_D: case RV_OP_AMOXOR_D:
+    case RV_OP_AMOAND_D: case RV_OP_AMOOR_D: case RV_OP_AMOMIN_D: case RV_OP_AMOMAX_D:
+    case RV_OP_AMOMINU_D: case RV_OP_AMOMAXU_D: {
+        uint64_t addr, old = 0;
+        int word = in->mem_size == 4;
+        if (!authorize(m, in, CAP_PERM_LOAD | CAP_PERM_STORE, in->mem_size, &addr)) return 1;
+        int rc = rv_mem_read(&m->mem, addr, &old, in->mem_size);
+        if (rc) return stop_access(m, rc, 0, addr);
+        uint64_t val = amo_apply((rv_op_t)in->op, old, rs2, word);
+        if ((rc = rv_mem_write(&m->mem, addr, &val, in->mem_size)) != 0) return stop_access(m, rc, 1, addr);
+        wr(m, in->rd, word ? (uint64_t)(int64_t)(int32_t)old : old);
+        e->mem_addr = addr;
+        break;
+    }
+
+    case RV_OP_FENCE: case RV_OP_FENCE_I: break;
+    case RV_OP_ECALL:
+        if (!m->os) return stop_with(m, RV_STOP_ECALL, "environment call");
+        if (rv_linux_syscall(m)) return 1;
+        // rt_sigreturn and signals raised by the call redirect the pc
+        if (m->pcc.addr != pc) {
+            next = m->pcc.addr;
+            e->taken = 1;
+        }
+        break;
+    case RV_OP_EBREAK: {
+        int rc = m->os ? -1 : semihost(m, pc);
+        if (rc < 0) return stop_halt(m, RV_STOP_EBREAK, "breakpoint");
+        if (rc > 0) return 1;
+        break;
+    }
+    case RV_OP_WFI: return stop_with(m, RV_STOP_WFI, "wait for interrupt");
+    case RV_OP_CSRRW: case RV_OP_CSRRS: case RV_OP_CSRRC:
+    case RV_OP_CSRRWI: case RV_OP_CSRRSI: case RV_OP_CSRRCI: {
+        // Counters are read-only; CSRs other than fflags/frm/fcsr read as zero
+        uint64_t csr = (uint64_t)in->imm, old = csr_read(m, csr);
+        uint64_t src = in->op >= RV_OP_CSRRWI ? in->rs1 : rs1;
+        if (in->op == RV_OP_CSRRW || in->op == RV_OP_CSRRWI) csr_write(m, csr, src);
+        else if (in->rs1 && (in->op == RV_OP_CSRRS || in->op == RV_OP_CSRRSI)) csr_write(m, csr, old | src);
+        else if (in->rs1) csr_write(m, csr, old & ~src);
+        wr(m, in->rd, old);
+        break;
+    }
+
+    default:
+        if (in->op >= RV_OP_FMADD_S) rv_fpu_exec(m, in);
+        else exec_cap(m, in, pc);
+        break;
+    }
+
+    if (in->cls == RV_CLS_BRANCH && e->taken) next = pc + (uint64_t)in->imm;
+    e->pc = pc;
+    e->next_pc = next;
+    e->insn = in;
+    e->capmode = (uint8_t)cm;
+    e->cap_checked = cm && in->mem_size != 0;
+    m->pcc.addr = next;
+    m->instret++;
+    if (m->max_insns && m->instret >= m->max_insns) {
+        m->stop = RV_STOP_LIMIT;
+        m->stop_pc = next;
+        snprintf(m->stop_detail, sizeof(m->stop_detail), "instruction limit");
+    }
+    return 0;
+}
+
+/*
+ * Under Linux user mode a fault is delivered to the guest's handler as a
+ * signal and execution continues with the handler's first instruction, so
+ * the trap itself retires nothing.
+ */
+int rv_step(rv_machine_t *m, rv_exec_t *e) {
+    for (;;) {
+        if (step(m, e) == 0) return 0;
+        if (!m->os || rv_linux_fault(m) != 0) return 1;
+    }
+}
@@ -0,0 +1,279 @@
+/*
+ * rvsim - Floating-Point Unit
+ *
+ * RV64F and RV64D on the host's IEEE arithmetic. NaN results become the
+ * canonical NaN, singles are NaN-boxed in the 64-bit registers (an
+ * unboxed value reads as the canonical NaN) and the host exception flags
+ * raised by each operation are accumulated into fflags. Arithmetic rounds
+ * to nearest-even whatever rm says; conversions to integers honour every
+ * rounding mode, since C casts (RTZ) and the lrint family depend on them.
+ */
+
+#include "rvsim.h"
+
+#include <fenv.h>
+#include <math.h>
+#include <string.h>
+
+#define FFLAG_NX    0x01
+#define FFLAG_UF    0x02
+#define FFLAG_OF    0x04
+#define FFLAG_DZ    0x08
+#define FFLAG_NV    0x10
+
+#define RM_RNE      0
+#define RM_RTZ      1
+#define RM_RDN      2
+#define RM_RUP      3
+#define RM_RMM      4
+#define RM_DYN      7
+
+#define NAN_S       0x7fc00000u
+#define NAN_D       0x7ff8000000000000ull
+#define BOX         0xffffffff00000000ull
+
+// ---------------------------------------------------------------------------
+// Register access
+// ---------------------------------------------------------------------------
+
+static inline uint32_t bits_s(const rv_machine_t *m, int r) {
+    uint64_t v = m->f[r - RV_FREG];
+    return (v & BOX) == BOX ? (uint32_t)v : NAN_S;
+}
+
+static inline float get_s(const rv_machine_t *m, int r) {
+    uint32_t b = bits_s(m, r);
+    float f;
+    memcpy(&f, &b, sizeof(f));
+    return f;
+}
+
+static inline double get_d(const rv_machine_t *m, int r) {
+    double d;
+    memcpy(&d, &m->f[r - RV_FREG], sizeof(d));
+    return d;
+}
+
+static inline void put_bits_s(rv_machine_t *m, int rd, uint32_t b) {
+    m->f[rd - RV_FREG] = BOX | b;
+}
+
+static inline void put_s(rv_machine_t *m, int rd, float f) {
+    uint32_t b;
+    memcpy(&b, &f, sizeof(b));
+    put_bits_s(m, rd, isnan(f) ? NAN_S : b);
+}
+
+static inline void put_d(rv_machine_t *m, int rd, double d) {
+    uint64_t b;
+    memcpy(&b, &d, sizeof(b));
+    m->f[rd - RV_FREG] = isnan(d) ? NAN_D : b;
+}
+
+static inline void put_x(rv_machine_t *m, int rd, uint64_t v) {
+    if (rd) m->x[rd] = rv_cap_null(v);
+}
+
+static inline int snan_s(uint32_t b) {
+    return (b & 0x7f800000u) == 0x7f800000u && (b & 0x007fffffu) && !(b & 0x00400000u);
+}
+
+static inline int snan_d(uint64_t b) {
+    return (b & 0x7ff0000000000000ull) == 0x7ff0000000000000ull && (b & 0x000fffffffffffffull) &&
+           !(b & 0x0008000000000000ull);
+}
+
+// ---------------------------------------------------------------------------
+// Helpers
+// ---------------------------------------------------------------------------
+
+static void raise_host_flags(rv_machine_t *m) {
+    int host = fetestexcept(FE_ALL_EXCEPT);
+    uint32_t flags = 0;
+    if (host & FE_INEXACT) flags |= FFLAG_NX;
+    if (host & FE_UNDERFLOW) flags |= FFLAG_UF;
+    if (host & FE_OVERFLOW) flags |= FFLAG_OF;
+    if (host & FE_DIVBYZERO) flags |= FFLAG_DZ;
+    if (host & FE_INVALID) flags |= FFLAG_NV;
+    m->fcsr |= flags;
+}
+
+static double round_rm(double x, int rm) {
+    switch (rm) {
+    case RM_RTZ: return trunc(x);
+    case RM_RDN: return floor(x);
+    case RM_RUP: return ceil(x);
+    case RM_RMM: return round(x);
+    default: return nearbyint(x);   // The host stays in round-to-nearest-even
+    }
+}
+
+// Convert to a 32- or 64-bit, signed or unsigned integer with RISC-V saturation
+static uint64_t to_int(rv_machine_t *m, double x, int rm, int is_signed, int wide) {
+    double lo = is_signed ? (wide ? -9223372036854775808.0 : -2147483648.0) : 0.0;
+    double hi = is_signed ? (wide ? 9223372036854775808.0 : 2147483648.0)
+                          : (wide ? 18446744073709551616.0 : 4294967296.0);
+    uint64_t max = is_signed ? (wide ? (uint64_t)INT64_MAX : (uint64_t)INT32_MAX)
+                             : (wide ? UINT64_MAX : (uint64_t)UINT32_MAX);
+    uint64_t min = is_signed ? (wide ? (uint64_t)INT64_MIN : (uint64_t)(int64_t)INT32_MIN) : 0;
+    uint64_t v;
+
+    if (isnan(x)) {
+        m->fcsr |= FFLAG_NV;
+        v = max;
+    } else {
+        double r = round_rm(x, rm);
+        if (r >= hi) {
+            m->fcsr |= FFLAG_NV;
+            v = max;
+        } else if (r < lo) {
+            m->fcsr |= FFLAG_NV;
+            v = min;
+        } else {
+            if (r != x) m->fcsr |= FFLAG_NX;
+            v = is_signed ? (uint64_t)(int64_t)r : (uint64_t)r;
+        }
+    }
+    // 32-bit results are sign-extended, including the unsigned conversions
+    return wide ? v : (uint64_t)(int64_t)(int32_t)(uint32_t)v;
+}
+
+static uint64_t classify(int sign, int is_inf, int is_nan, int is_snan, int is_zero, int is_sub) {
+    if (is_nan) return is_snan ? 1u << 8 : 1u << 9;
+    if (is_inf) return sign ? 1u << 0 : 1u << 7;
+    if (is_zero) return sign ? 1u << 3 : 1u << 4;
+    if (is_sub) return sign ? 1u << 2 : 1u << 5;
+    return sign ? 1u << 1 : 1u << 6;
+}
+
+// ---------------------------------------------------------------------------
+// Execution
+// ---------------------------------------------------------------------------
+
+static void exec_single(rv_machine_t *m, const rv_insn_t *in, int rm) {
+    int rd = in->rd;
+    float a = in->rs1 >= RV_FREG ? get_s(m, in->rs1) : 0.0f;
+    float b = in->rs2 >= RV_FREG ? get_s(m, in->rs2) : 0.0f;
+    uint32_t ab = in->rs1 >= RV_FREG ? bits_s(m, in->rs1) : 0;
+    uint32_t bb = in->rs2 >= RV_FREG ? bits_s(m, in->rs2) : 0;
+    uint64_t xs = in->rs1 < RV_FREG ? m->x[in->rs1].addr : 0;
+
+    switch ((rv_op_t)in->op) {
+    case RV_OP_FMADD_S: put_s(m, rd, fmaf(a, b, get_s(m, rv_insn_rs3(in)))); break;
+    case RV_OP_FMSUB_S: put_s(m, rd, fmaf(a, b, -get_s(m, rv_insn_rs3(in)))); break;
+    case RV_OP_FNMSUB_S: put_s(m, rd, fmaf(-a, b, get_s(m, rv_insn_rs3(in)))); break;
+    case RV_OP_FNMADD_S: put_s(m, rd, fmaf(-a, b, -get_s(m, rv_insn_rs3(in)))); break;
+    case RV_OP_FADD_S: put_s(m, rd, a + b); break;
+    case RV_OP_FSUB_S: put_s(m, rd, a - b); break;
+    case RV_OP_FMUL_S: put_s(m, rd, a * b); break;
+    case RV_OP_FDIV_S: put_s(m, rd, a / b); break;
+    case RV_OP_FSQRT_S: put_s(m, rd, sqrtf(a)); break;
+    case RV_OP_FSGNJ_S: put_bits_s(m, rd, (ab & 0x7fffffffu) | (bb & 0x80000000u)); break;
+    case RV_OP_FSGNJN_S: put_bits_s(m, rd, (ab & 0x7fffffffu) | (~bb & 0x80000000u)); break;
+    case RV_OP_FSGNJX_S: put_bits_s(m, rd, ab ^ (bb & 0x80000000u)); break;
+    case RV_OP_FMIN_S: case RV_OP_FMAX_S: {
+        int max = in->op == RV_OP_FMAX_S;
+        if (snan_s(ab) || snan_s(bb)) m->fcsr |= FFLAG_NV;
+        if (isnan(a) && isnan(b)) put_bits_s(m, rd, NAN_S);
+        else if (isnan(a)) put_bits_s(m, rd, bb);
+        else if (isnan(b)) put_bits_s(m, rd, ab);
+        else if (a == b) put_bits_s(m, rd, max ? (ab & bb) : (ab | bb));    // -0 < +0
+        else put_bits_s(m, rd, (max ? a > b : a < b) ? ab : bb);
+        break;
+    }
+    case RV_OP_FCVT_W_S: put_x(m, rd, to_int(m, a, rm, 1, 0)); break;
+    case RV_OP_FCVT_WU_S: put_x(m, rd, to_int(m, a, rm, 0, 0)); break;
+    case RV_OP_FCVT_L_S: put_x(m, rd, to_int(m, a, rm, 1, 1)); break;
+    case RV_OP_FCVT_LU_S: put_x(m, rd, to_int(m, a, rm, 0, 1)); break;
+    case RV_OP_FCVT_S_W: put_s(m, rd, (float)(int32_t)xs); break;
+    case RV_OP_FCVT_S_WU: put_s(m, rd, (float)(uint32_t)xs); break;
+    case RV_OP_FCVT_S_L: put_s(m, rd, (float)(int64_t)xs); break;
+    case RV_OP_FCVT_S_LU: put_s(m, rd, (float)xs); break;
+    case RV_OP_FMV_X_W: put_x(m, rd, (uint64_t)(int64_t)(int32_t)m->f[in->rs1 - RV_FREG]); break;
+    case RV_OP_FMV_W_X: put_bits_s(m, rd, (uint32_t)xs); break;
+    case RV_OP_FEQ_S:
+        if (snan_s(ab) || snan_s(bb)) m->fcsr |= FFLAG_NV;
+        put_x(m, rd, a == b);
+        break;
+    case RV_OP_FLT_S: case RV_OP_FLE_S:
+        if (isnan(a) || isnan(b)) m->fcsr |= FFLAG_NV;
+        put_x(m, rd, in->op == RV_OP_FLT_S ? a < b : a <= b);
+        break;
+    case RV_OP_FCLASS_S:
+        put_x(m, rd, classify(ab >> 31, isinf(a), isnan(a), snan_s(ab), a == 0.0f,
+                              fpclassify(a) == FP_SUBNORMAL));
+        break;
+    case RV_OP_FCVT_S_D: put_s(m, rd, (float)get_d(m, in->rs1)); break;
+    default: break;
+    }
+}
+
+static void exec_double(rv_machine_t *m, const rv_insn_t *in, int rm) {
+    int rd = in->rd;
+    double a = in->rs1 >= RV_FREG ? get_d(m, in->rs1) : 0.0;
+    double b = in->rs2 >= RV_FREG ? get_d(m, in->rs2) : 0.0;
+    uint64_t ab = in->rs1 >= RV_FREG ? m->f[in->rs1 - RV_FREG] : 0;
+    uint64_t bb = in->rs2 >= RV_FREG ? m->f[in->rs2 - RV_FREG] : 0;
+    uint64_t xs = in->rs1 < RV_FREG ? m->x[in->rs1].addr : 0;
+    const uint64_t sign = 1ull << 63;
+
+    switch ((rv_op_t)in->op) {
+    case RV_OP_FMADD_D: put_d(m, rd, fma(a, b, get_d(m, rv_insn_rs3(in)))); break;
+    case RV_OP_FMSUB_D: put_d(m, rd, fma(a, b, -get_d(m, rv_insn_rs3(in)))); break;
+    case RV_OP_FNMSUB_D: put_d(m, rd, fma(-a, b, get_d(m, rv_insn_rs3(in)))); break;
+    case RV_OP_FNMADD_D: put_d(m, rd, fma(-a, b, -get_d(m, rv_insn_rs3(in)))); break;
+    case RV_OP_FADD_D: put_d(m, rd, a + b); break;
+    case RV_OP_FSUB_D: put_d(m, rd, a - b); break;
+    case RV_OP_FMUL_D: put_d(m, rd, a * b); break;
+    case RV_OP_FDIV_D: put_d(m, rd, a / b); break;
+    case RV_OP_FSQRT_D: put_d(m, rd, sqrt(a)); break;
+    case RV_OP_FSGNJ_D: m->f[rd - RV_FREG] = (ab & ~sign) | (bb & sign); break;
+    case RV_OP_FSGNJN_D: m->f[rd - RV_FREG] = (ab & ~sign) | (~bb & sign); break;
+    case RV_OP_FSGNJX_D: m->f[rd - RV_FREG] = ab ^ (bb & sign); break;
+    case RV_OP_FMIN_D: case RV_OP_FMAX_D: {
+        int max = in->op == RV_OP_FMAX_D;
+        if (snan_d(ab) || snan_d(bb)) m->fcsr |= FFLAG_NV;
+        if (isnan(a) && isnan(b)) m->f[rd - RV_FREG] = NAN_D;
+        else if (isnan(a)) m->f[rd - RV_FREG] = bb;
+        else if (isnan(b)) m->f[rd - RV_FREG] = ab;
+        else if (a == b) m->f[rd - RV_FREG] = max ? (ab & bb) : (ab | bb);
+        else m->f[rd - RV_FREG] = (max ? a > b : a < b) ? ab : bb;
+        break;
+    }
+    case RV_OP_FCVT_W_D: put_x(m, rd, to_int(m, a, rm, 1, 0)); break;
+    case RV_OP_FCVT_WU_D: put_x(m, rd, to_int(m, a, rm, 0, 0)); break;
+    case RV_OP_FCVT_L_D: put_x(m, rd, to_int(m, a, rm, 1, 1)); break;
+    case RV_OP_FCVT_LU_D: put_x(m, rd, to_int(m, a, rm, 0, 1)); break;
+    case RV_OP_FCVT_D_W: put_d(m, rd, (double)(int32_t)xs); break;
+    case RV_OP_FCVT_D_WU: put_d(m, rd, (double)(uint32_t)xs); break;
+    case RV_OP_FCVT_D_L: put_d(m, rd, (double)(int64_t)xs); break;
+    case RV_OP_FCVT_D_LU: put_d(m, rd, (double)xs); break;
+    case RV_OP_FMV_X_D: put_x(m, rd, ab); break;
+    case RV_OP_FMV_D_X: m->f[rd - RV_FREG] = xs; break;
+    case RV_OP_FEQ_D:
+        if (snan_d(ab) || snan_d(bb)) m->fcsr |= FFLAG_NV;
+        put_x(m, rd, a == b);
+        break;
+    case RV_OP_FLT_D: case RV_OP_FLE_D:
+        if (isnan(a) || isnan(b)) m->fcsr |= FFLAG_NV;
+        put_x(m, rd, in->op == RV_OP_FLT_D ? a < b : a <= b);
+        break;
+    case RV_OP_FCLASS_D:
+        put_x(m, rd, classify((int)(ab >> 63), isinf(a), isnan(a), snan_d(ab), a == 0.0,
+                              fpclassify(a) == FP_SUBNORMAL));
+        break;
+    case RV_OP_FCVT_D_S: put_d(m, rd, (double)get_s(m, in->rs1)); break;
+    default: break;
+    }
+}
+
+void rv_fpu_exec(rv_machine_t *m, const rv_insn_t *in) {
+    int rm = (int)(in->imm & 7);
+    if (rm == RM_DYN) rm = (int)((m->fcsr >> 5) & 7);
+
+    feclearexcept(FE_ALL_EXCEPT);
+    int single = (in->op >= RV_OP_FMADD_S && in->op <= RV_OP_FCLASS_S) || in->op == RV_OP_FCVT_S_D;
+    if (single) exec_single(m, in, rm);
+    else exec_double(m, in, rm);
+    raise_host_flags(m);
+}
@@ -0,0 +1,242 @@
+/*
+ * rvsim - Command Line Driver
+ *
+ * Runs each binary once per core configuration (run.c) and prints the
+ * report with its CPI stacks. With -j the (binary, configuration) jobs go
+ * to the batch farm (batch.c) instead: every binary is loaded once, jobs
+ * run concurrently and their RESULT lines stream into one results file.
+ * -S expands the configurations into a sweep, one job per value.
+ */
+
+#include "rvsim.h"
+
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Default configuration
+#define DEFAULT_MAX_INSNS   1000000000ull
+#define MAX_CONFIGS         4096
+#define MAX_OVERRIDES       64
+#define MAX_SWEEPS          8
+#define MAX_GUEST_ARGS      32
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [options] <binary>...\n", prog);
+    fprintf(stderr, "  -c <cfg>     Core configuration: inorder, ooo or a key=value file\n");
+    fprintf(stderr, "               (repeatable; default: inorder and ooo)\n");
+    fprintf(stderr, "  -s key=val   Override a setting in every configuration\n");
+    fprintf(stderr, "  -S key=v,... Sweep a setting: one configuration per value (repeatable)\n");
+    fprintf(stderr, "  -n <count>   Instruction limit (default: %llu)\n", DEFAULT_MAX_INSNS);
+    fprintf(stderr, "  -j <threads> Batch mode on this many threads (0: all host cores)\n");
+    fprintf(stderr, "  -o <file>    Batch results as CSV (default: RESULT lines on stdout)\n");
+    fprintf(stderr, "  -p <symbol>  Print the string at <symbol> after the run\n");
+    fprintf(stderr, "  -A <arg>     Argument for hosted (Linux) binaries (repeatable)\n");
+    fprintf(stderr, "  -f           Functional run only, no timing model\n");
+    fprintf(stderr, "  -d           Disassemble the executable text and exit\n");
+    fprintf(stderr, "  -t           Trace executed instructions to stderr (not in batch mode)\n");
+    fprintf(stderr, "  -P           Print the resolved configurations\n");
+    exit(2);
+}
+
+static const char *base_name(const char *path) {
+    const char *slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+// ---------------------------------------------------------------------------
+// Disassembly
+// ---------------------------------------------------------------------------
+
+static void disassemble(const rv_image_t *img) {
+    const rv_symbol_t *current = NULL;
+    char text[96];
+    uint64_t pc = img->text_base;
+    while (pc < img->text_end) {
+        const rv_insn_t *in = &img->text[(pc - img->text_base) / 2];
+        const rv_symbol_t *sym = rv_image_symbol(img, pc);
+        if (sym && sym != current && sym->addr == pc) printf("\n%016llx <%s>:\n", (unsigned long long)pc, sym->name);
+        current = sym;
+        rv_disasm(in, pc, text, sizeof(text));
+        printf("  %8llx:  %-40s [%s]\n", (unsigned long long)pc, text, rv_class_name((rv_class_t)in->cls));
+        pc += in->len;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Sweeps
+// ---------------------------------------------------------------------------
+
+// Replace each configuration by one copy per value of "key=v1,v2,..."
+static int expand_sweep(rv_config_t *configs, int *count, const char *sweep) {
+    char buf[512];
+    snprintf(buf, sizeof(buf), "%s", sweep);
+    char *eq = strchr(buf, '=');
+    if (!eq) return -1;
+    *eq = '\0';
+    const char *key = buf;
+
+    const char *values[256];
+    int value_count = 0;
+    for (char *v = strtok(eq + 1, ","); v; v = strtok(NULL, ",")) {
+        if (value_count == 256) return -1;
+        values[value_count++] = v;
+    }
+    if (value_count == 0 || *count * value_count > MAX_CONFIGS) return -1;
+
+    // Expand in place from the back so unexpanded entries are never overwritten
+    for (int c = *count - 1; c >= 0; c--) {
+        rv_config_t base = configs[c];
+        for (int v = value_count - 1; v >= 0; v--) {
+            rv_config_t *cfg = &configs[c * value_count + v];
+            *cfg = base;
+            if (rv_config_set(cfg, key, values[v]) != 0) return -1;
+            size_t len = strlen(cfg->name);
+            snprintf(cfg->name + len, sizeof(cfg->name) - len, "+%s=%s", key, values[v]);
+        }
+    }
+    *count *= value_count;
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    rv_config_t *configs = calloc(MAX_CONFIGS, sizeof(*configs));
+    const char *overrides[MAX_OVERRIDES], *sweeps[MAX_SWEEPS], *guest_args[MAX_GUEST_ARGS];
+    int config_count = 0, override_count = 0, sweep_count = 0;
+    rv_run_opts_t opts = { DEFAULT_MAX_INSNS, NULL, 0, 0, guest_args };
+    const char *results_path = NULL;
+    int functional = 0, disasm = 0, print_config = 0, threads = -1;
+    char err[256];
+    int opt;
+
+    if (!configs) {
+        fprintf(stderr, "rvsim: out of memory\n");
+        return 1;
+    }
+    while ((opt = getopt(argc, argv, "c:s:S:n:j:o:p:A:fdtPh")) != -1) {
+        switch (opt) {
+        case 'c':
+            if (config_count == MAX_CONFIGS) usage(argv[0]);
+            if (strcmp(optarg, "inorder") == 0) {
+                rv_config_default(&configs[config_count], RV_CORE_INORDER);
+            } else if (strcmp(optarg, "ooo") == 0) {
+                rv_config_default(&configs[config_count], RV_CORE_OOO);
+            } else {
+                rv_config_default(&configs[config_count], RV_CORE_INORDER);
+                snprintf(configs[config_count].name, sizeof(configs[config_count].name), "%s",
+                         base_name(optarg));
+                if (rv_config_load(&configs[config_count], optarg, err, sizeof(err)) != 0) {
+                    fprintf(stderr, "rvsim: %s\n", err);
+                    return 1;
+                }
+            }
+            config_count++;
+            break;
+        case 's':
+            if (override_count == MAX_OVERRIDES) usage(argv[0]);
+            overrides[override_count++] = optarg;
+            break;
+        case 'S':
+            if (sweep_count == MAX_SWEEPS) usage(argv[0]);
+            sweeps[sweep_count++] = optarg;
+            break;
+        case 'n': opts.max_insns = strtoull(optarg, NULL, 0); break;
+        case 'j': threads = atoi(optarg); break;
+        case 'o': results_path = optarg; break;
+        case 'p': opts.dump = optarg; break;
+        case 'A':
+            if (opts.argc == MAX_GUEST_ARGS) usage(argv[0]);
+            guest_args[opts.argc++] = optarg;
+            break;
+        case 'f': functional = 1; break;
+        case 'd': disasm = 1; break;
+        case 't': opts.trace = 1; break;
+        case 'P': print_config = 1; break;
+        case 'h':
+        default: usage(argv[0]);
+        }
+    }
+    if (optind >= argc) usage(argv[0]);
+    if (results_path && threads < 0) threads = 0;
+
+    if (config_count == 0) {
+        rv_config_default(&configs[config_count++], RV_CORE_INORDER);
+        rv_config_default(&configs[config_count++], RV_CORE_OOO);
+    }
+    for (int c = 0; c < config_count; c++) {
+        for (int o = 0; o < override_count; o++) {
+            if (rv_config_apply(&configs[c], overrides[o]) != 0) {
+                fprintf(stderr, "rvsim: bad setting '%s'\n", overrides[o]);
+                return 1;
+            }
+        }
+    }
+    for (int s = 0; s < sweep_count; s++) {
+        if (expand_sweep(configs, &config_count, sweeps[s]) != 0) {
+            fprintf(stderr, "rvsim: bad sweep '%s'\n", sweeps[s]);
+            return 1;
+        }
+    }
+    if (print_config) {
+        for (int c = 0; c < config_count; c++) {
+            rv_config_print(&configs[c], stdout);
+            printf("\n");
+        }
+    }
+
+    int image_count = argc - optind;
+    rv_image_t *images = calloc((size_t)image_count, sizeof(*images));
+    if (!images) {
+        fprintf(stderr, "rvsim: out of memory\n");
+        return 1;
+    }
+
+    int status = 0;
+    if (threads >= 0 && !disasm) {
+        // Batch: load every binary once up front, then share the images
+        int loaded = 0;
+        for (int i = optind; i < argc; i++) {
+            if (rv_image_load(&images[loaded], argv[i], err, sizeof(err)) != 0) {
+                fprintf(stderr, "rvsim: %s\n", err);
+                rv_image_free(&images[loaded]);
+                status = 1;
+                continue;
+            }
+            loaded++;
+        }
+        FILE *results = stdout;
+        if (results_path && !(results = fopen(results_path, "w"))) {
+            fprintf(stderr, "rvsim: %s: cannot create\n", results_path);
+            return 1;
+        }
+        if (threads == 0) threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+        opts.trace = 0;
+        status |= rv_batch(images, loaded, functional ? NULL : configs, config_count, &opts,
+                           threads, results, results_path != NULL);
+        if (results != stdout) fclose(results);
+        for (int i = 0; i < loaded; i++) rv_image_free(&images[i]);
+    } else {
+        for (int i = optind; i < argc; i++) {
+            rv_image_t *img = &images[0];
+            if (rv_image_load(img, argv[i], err, sizeof(err)) != 0) {
+                fprintf(stderr, "rvsim: %s\n", err);
+                rv_image_free(img);
+                status = 1;
+                continue;
+            }
+            if (disasm) {
+                disassemble(img);
+            } else if (functional) {
+                status |= rv_run(img, NULL, &opts, stdout, NULL);
+            } else {
+                for (int c = 0; c < config_count; c++)
+                    status |= rv_run(img, &configs[c], &opts, stdout, NULL);
+            }
+            rv_image_free(img);
+        }
+    }
+    free(images);
+    free(configs);
+    return status;
+}
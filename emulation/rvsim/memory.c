@@ -0,0 +1,296 @@
+/*
+ * rvsim - Sparse Tagged Memory
+ *
+ * Pages are allocated on first touch inside mapped regions. Each 16-byte
+ * granule has a tag bit; capability metadata (bounds, permissions, object
+ * type, flags) is kept in a side table keyed by granule address while the
+ * capability address occupies the first 8 bytes of the granule as it does
+ * in the 128-bit in-memory format. Data stores clear the tags they touch.
+ * Discarding a range (munmap, a shrinking brk) frees its pages again.
+ */
+
+#include "rvsim.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define META_EMPTY 1
+
+int rv_mem_init(rv_mem_t *m) {
+    memset(m, 0, sizeof(*m));
+    m->page_slots = 256;
+    m->pages = calloc(m->page_slots, sizeof(*m->pages));
+    m->meta_slots = 1024;
+    m->meta = malloc(m->meta_slots * sizeof(*m->meta));
+    if (!m->pages || !m->meta) {
+        free(m->pages);
+        free(m->meta);
+        return -1;
+    }
+    for (size_t i = 0; i < m->meta_slots; i++) m->meta[i].key = META_EMPTY;
+    return 0;
+}
+
+void rv_mem_free(rv_mem_t *m) {
+    for (size_t i = 0; i < m->page_slots; i++) free(m->pages[i].data);
+    free(m->pages);
+    free(m->meta);
+    memset(m, 0, sizeof(*m));
+}
+
+int rv_mem_map(rv_mem_t *m, uint64_t start, uint64_t size, int writable) {
+    if (m->region_count == RV_MAX_REGIONS || size == 0) return -1;
+    m->regions[m->region_count].start = start;
+    m->regions[m->region_count].end = start + size;
+    m->regions[m->region_count].writable = writable;
+    m->region_count++;
+    return 0;
+}
+
+static int region_of(const rv_mem_t *m, uint64_t addr) {
+    for (int i = 0; i < m->region_count; i++)
+        if (addr >= m->regions[i].start && addr < m->regions[i].end) return i;
+    return -1;
+}
+
+// ---------------------------------------------------------------------------
+// Page table
+// ---------------------------------------------------------------------------
+
+static inline size_t page_hash(uint64_t number, size_t slots) {
+    return (size_t)((number * 0x9E3779B97F4A7C15ull) >> 20) & (slots - 1);
+}
+
+static int page_grow(rv_mem_t *m) {
+    size_t slots = m->page_slots * 2;
+    rv_page_t *pages = calloc(slots, sizeof(*pages));
+    if (!pages) return -1;
+    for (size_t i = 0; i < m->page_slots; i++) {
+        if (!m->pages[i].data) continue;
+        size_t h = page_hash(m->pages[i].number, slots);
+        while (pages[h].data) h = (h + 1) & (slots - 1);
+        pages[h] = m->pages[i];
+    }
+    free(m->pages);
+    m->pages = pages;
+    m->page_slots = slots;
+    m->last = NULL;
+    return 0;
+}
+
+// The page, or NULL if it was never touched
+static rv_page_t *page_find(rv_mem_t *m, uint64_t number) {
+    size_t h = page_hash(number, m->page_slots);
+    while (m->pages[h].data) {
+        if (m->pages[h].number == number) return &m->pages[h];
+        h = (h + 1) & (m->page_slots - 1);
+    }
+    return NULL;
+}
+
+static rv_page_t *page_get(rv_mem_t *m, uint64_t addr) {
+    uint64_t number = addr >> RV_PAGE_BITS;
+    if (m->last && m->last->number == number) return m->last;
+
+    rv_page_t *found = page_find(m, number);
+    if (found) return m->last = found;
+    if (region_of(m, addr) < 0) return NULL;
+
+    if ((m->page_count + 1) * 2 > m->page_slots) {
+        if (page_grow(m) != 0) return NULL;
+        return page_get(m, addr);
+    }
+    uint8_t *data = calloc(1, RV_PAGE_SIZE);
+    if (!data) return NULL;
+    size_t h = page_hash(number, m->page_slots);
+    while (m->pages[h].data) h = (h + 1) & (m->page_slots - 1);
+    m->pages[h].number = number;
+    m->pages[h].data = data;
+    memset(m->pages[h].tags, 0, sizeof(m->pages[h].tags));
+    m->page_count++;
+    return m->last = &m->pages[h];
+}
+
+static inline void clear_tags(rv_page_t *p, uint64_t offset, size_t size) {
+    uint64_t first = offset / RV_CAP_SIZE, last = (offset + size - 1) / RV_CAP_SIZE;
+    for (uint64_t g = first; g <= last; g++) p->tags[g / 64] &= ~(1ull << (g % 64));
+}
+
+// Release the page in slot i, shifting later probes back into the hole
+static void page_remove(rv_mem_t *m, size_t i) {
+    size_t mask = m->page_slots - 1;
+    free(m->pages[i].data);
+    m->pages[i].data = NULL;
+    m->page_count--;
+    m->last = NULL;
+    for (size_t j = (i + 1) & mask; m->pages[j].data; j = (j + 1) & mask) {
+        // An entry may move back unless its home slot lies in (i, j]
+        size_t home = page_hash(m->pages[j].number, m->page_slots);
+        int stays = i <= j ? (home > i && home <= j) : (home > i || home <= j);
+        if (stays) continue;
+        m->pages[i] = m->pages[j];
+        m->pages[j].data = NULL;
+        i = j;
+    }
+}
+
+// Zero [offset, offset + size) of an allocated page; untouched pages already read as zeros
+static void page_zero(rv_mem_t *m, uint64_t number, uint64_t offset, uint64_t size) {
+    rv_page_t *p = page_find(m, number);
+    if (!p) return;
+    memset(p->data + offset, 0, size);
+    clear_tags(p, offset, size);
+}
+
+void rv_mem_discard(rv_mem_t *m, uint64_t start, uint64_t size) {
+    if (size == 0) return;
+    uint64_t end = start + size;
+    uint64_t first = (start + RV_PAGE_SIZE - 1) >> RV_PAGE_BITS;  // Whole pages [first, last)
+    uint64_t last = end >> RV_PAGE_BITS;
+
+    if (first > last) {
+        // Inside one page
+        page_zero(m, start >> RV_PAGE_BITS, start & (RV_PAGE_SIZE - 1), size);
+        return;
+    }
+    if (start & (RV_PAGE_SIZE - 1))
+        page_zero(m, start >> RV_PAGE_BITS, start & (RV_PAGE_SIZE - 1), RV_PAGE_SIZE - (start & (RV_PAGE_SIZE - 1)));
+    if (end & (RV_PAGE_SIZE - 1)) page_zero(m, last, 0, end & (RV_PAGE_SIZE - 1));
+
+    if (last - first < m->page_slots) {
+        for (uint64_t n = first; n < last; n++) {
+            rv_page_t *p = page_find(m, n);
+            if (p) page_remove(m, (size_t)(p - m->pages));
+        }
+        return;
+    }
+    // Range larger than the table: walk the table instead, rechecking a slot
+    // after a removal since a later entry may have moved into it
+    for (size_t i = 0; i < m->page_slots;) {
+        if (m->pages[i].data && m->pages[i].number >= first && m->pages[i].number < last) page_remove(m, i);
+        else i++;
+    }
+}
+
+int rv_mem_read(rv_mem_t *m, uint64_t addr, void *out, size_t size) {
+    uint64_t offset = addr & (RV_PAGE_SIZE - 1);
+    if (offset + size <= RV_PAGE_SIZE) {
+        rv_page_t *p = page_get(m, addr);
+        if (!p) return RV_MEM_UNMAPPED;
+        memcpy(out, p->data + offset, size);
+        return 0;
+    }
+    for (size_t i = 0; i < size; i++) {
+        rv_page_t *p = page_get(m, addr + i);
+        if (!p) return RV_MEM_UNMAPPED;
+        ((uint8_t *)out)[i] = p->data[(addr + i) & (RV_PAGE_SIZE - 1)];
+    }
+    return 0;
+}
+
+static int mem_store(rv_mem_t *m, uint64_t addr, const void *in, size_t size, int check) {
+    if (check) {
+        int r = region_of(m, addr), r2 = region_of(m, addr + size - 1);
+        if (r < 0 || r2 < 0) return RV_MEM_UNMAPPED;
+        if (!m->regions[r].writable || !m->regions[r2].writable) return RV_MEM_READONLY;
+    }
+    uint64_t offset = addr & (RV_PAGE_SIZE - 1);
+    if (offset + size <= RV_PAGE_SIZE) {
+        rv_page_t *p = page_get(m, addr);
+        if (!p) return RV_MEM_UNMAPPED;
+        memcpy(p->data + offset, in, size);
+        clear_tags(p, offset, size);
+        return 0;
+    }
+    for (size_t i = 0; i < size; i++) {
+        rv_page_t *p = page_get(m, addr + i);
+        if (!p) return RV_MEM_UNMAPPED;
+        p->data[(addr + i) & (RV_PAGE_SIZE - 1)] = ((const uint8_t *)in)[i];
+        clear_tags(p, (addr + i) & (RV_PAGE_SIZE - 1), 1);
+    }
+    return 0;
+}
+
+int rv_mem_write(rv_mem_t *m, uint64_t addr, const void *in, size_t size) {
+    return mem_store(m, addr, in, size, 1);
+}
+
+int rv_mem_poke(rv_mem_t *m, uint64_t addr, const void *in, size_t size) {
+    return mem_store(m, addr, in, size, 0);
+}
+
+// ---------------------------------------------------------------------------
+// Capability side table
+// ---------------------------------------------------------------------------
+
+static inline size_t meta_hash(uint64_t key, size_t slots) {
+    return (size_t)(((key >> 4) * 0x9E3779B97F4A7C15ull) >> 24) & (slots - 1);
+}
+
+static rv_capmeta_t *meta_find(rv_mem_t *m, uint64_t key, int insert) {
+    size_t h = meta_hash(key, m->meta_slots);
+    while (m->meta[h].key != META_EMPTY) {
+        if (m->meta[h].key == key) return &m->meta[h];
+        h = (h + 1) & (m->meta_slots - 1);
+    }
+    if (!insert) return NULL;
+
+    if ((m->meta_count + 1) * 2 > m->meta_slots) {
+        size_t slots = m->meta_slots * 2;
+        rv_capmeta_t *meta = malloc(slots * sizeof(*meta));
+        if (!meta) return NULL;
+        for (size_t i = 0; i < slots; i++) meta[i].key = META_EMPTY;
+        for (size_t i = 0; i < m->meta_slots; i++) {
+            if (m->meta[i].key == META_EMPTY) continue;
+            size_t j = meta_hash(m->meta[i].key, slots);
+            while (meta[j].key != META_EMPTY) j = (j + 1) & (slots - 1);
+            meta[j] = m->meta[i];
+        }
+        free(m->meta);
+        m->meta = meta;
+        m->meta_slots = slots;
+        return meta_find(m, key, 1);
+    }
+    m->meta[h].key = key;
+    m->meta_count++;
+    return &m->meta[h];
+}
+
+static int cap_is_null_meta(const rv_cap_t *c) {
+    return c->base == 0 && c->top == CAP_TOP_MAX && c->perms == 0 &&
+           c->otype == CAP_OTYPE_UNSEALED && c->flags == 0;
+}
+
+int rv_mem_read_cap(rv_mem_t *m, uint64_t addr, rv_cap_t *out) {
+    uint64_t words[2];
+    int rc = rv_mem_read(m, addr, words, sizeof(words));
+    if (rc) return rc;
+    rv_page_t *p = page_get(m, addr);
+    uint64_t g = (addr & (RV_PAGE_SIZE - 1)) / RV_CAP_SIZE;
+    const rv_capmeta_t *meta = meta_find(m, addr, 0);
+
+    // Untagged granules keep whatever metadata the last capability store left
+    *out = meta ? meta->meta : rv_cap_null(0);
+    out->addr = words[0];
+    out->tag = (uint8_t)((p->tags[g / 64] >> (g % 64)) & 1);
+    return 0;
+}
+
+int rv_mem_write_cap(rv_mem_t *m, uint64_t addr, const rv_cap_t *in) {
+    // The upper word stands in for the compressed bounds of the real format
+    uint64_t words[2] = { in->addr, cap_is_null_meta(in) ? 0 : rv_cap_length(in) ^ in->perms };
+    int rc = rv_mem_write(m, addr, words, sizeof(words));
+    if (rc) return rc;
+
+    rv_capmeta_t *meta = meta_find(m, addr, !cap_is_null_meta(in) || in->tag);
+    if (meta) {
+        meta->meta = *in;
+        meta->meta.tag = 0;
+    }
+    if (in->tag) {
+        rv_page_t *p = page_get(m, addr);
+        uint64_t g = (addr & (RV_PAGE_SIZE - 1)) / RV_CAP_SIZE;
+        p->tags[g / 64] |= 1ull << (g % 64);
+    }
+    return 0;
+}
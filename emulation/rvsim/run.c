@@ -0,0 +1,249 @@
+/*
+ * rvsim - Single Runs
+ *
+ * One (binary, configuration) run: a fresh machine over the shared image,
+ * an optional timing model, and the report with a CPI stack (base, memory,
+ * branch, capability) for the whole run and for each test, where a test is
+ * a function called directly from main(). Time spent in main() itself and
+ * outside it (start-up, the final idle loop) is reported separately.
+ * Machine-readable lines follow the workloads' format:
+ *
+ *   RESULT,<binary>,<config>,<metric>,<value>,<unit>
+ *
+ * Everything is written to the caller's stream, so runs on different
+ * threads never interleave their output. Hosted binaries run under the
+ * Linux user-mode layer (syscall.c) and their console output, like the
+ * semihosting output of bare-metal ones, goes to the same stream, ahead of
+ * the report.
+ */
+
+#include "rvsim.h"
+
+#include <string.h>
+
+#define MAX_GUEST_ARGS      32
+#define REGION_OUTSIDE      0   // Before main() and after it returns
+#define REGION_MAIN         1   // main() itself
+#define REGION_FIRST_TEST   2
+
+static const char *base_name(const char *path) {
+    const char *slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+// ---------------------------------------------------------------------------
+// Test regions
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    const rv_symbol_t *main_sym;
+    const char *names[RV_MAX_REGIONS_TRACKED];
+    uint64_t entries[RV_MAX_REGIONS_TRACKED];
+    int count;
+    int current;                // Test main() last called, or -1
+} regions_t;
+
+static void regions_init(regions_t *r, const rv_image_t *img) {
+    memset(r, 0, sizeof(*r));
+    r->main_sym = rv_image_find(img, "main");
+    r->names[REGION_OUTSIDE] = "outside_main";
+    r->names[REGION_MAIN] = "main";
+    r->count = REGION_FIRST_TEST;
+    r->current = -1;
+}
+
+static inline int in_main(const regions_t *r, uint64_t pc) {
+    return r->main_sym && pc >= r->main_sym->addr && pc < r->main_sym->addr + r->main_sym->size;
+}
+
+static int regions_of(const regions_t *r, uint64_t pc) {
+    if (in_main(r, pc)) return REGION_MAIN;
+    return r->current >= 0 ? r->current : REGION_OUTSIDE;
+}
+
+// Follow calls made by main() to the function they enter
+static void regions_update(regions_t *r, const rv_image_t *img, const rv_exec_t *e) {
+    const rv_insn_t *in = e->insn;
+    if (!in_main(r, e->pc) || !e->taken || in->cls == RV_CLS_BRANCH) return;
+    if (in_main(r, e->next_pc)) return;
+    if (in->rd != 1 && in->rd != 5) {
+        r->current = -1;    // main() returned
+        return;
+    }
+    for (int i = REGION_FIRST_TEST; i < r->count; i++) {
+        if (r->entries[i] == e->next_pc) {
+            r->current = i;
+            return;
+        }
+    }
+    const rv_symbol_t *sym = rv_image_symbol(img, e->next_pc);
+    if (r->count == RV_MAX_REGIONS_TRACKED) {
+        r->current = RV_MAX_REGIONS_TRACKED - 1;
+        r->names[r->current] = "other_tests";
+        return;
+    }
+    r->entries[r->count] = e->next_pc;
+    r->names[r->count] = sym ? sym->name : "unknown";
+    r->current = r->count++;
+}
+
+// ---------------------------------------------------------------------------
+// Runs
+// ---------------------------------------------------------------------------
+
+static void print_string(FILE *out, rv_machine_t *m, const rv_image_t *img, const char *name) {
+    const rv_symbol_t *sym = rv_image_find(img, name);
+    if (!sym) {
+        fprintf(stderr, "rvsim: no symbol '%s'\n", name);
+        return;
+    }
+    fprintf(out, "%s contents:\n", name);
+    for (uint64_t a = sym->addr; a < sym->addr + (sym->size ? sym->size : 4096); a++) {
+        char c;
+        if (rv_mem_read(&m->mem, a, &c, 1) != 0 || c == '\0') break;
+        fputc(c, out);
+    }
+    fprintf(out, "\n");
+}
+
+static void print_stop(FILE *out, const rv_machine_t *m, const rv_image_t *img) {
+    const rv_symbol_t *sym = rv_image_symbol(img, m->stop_pc);
+    fprintf(out, "Stopped: %s (%s) at 0x%llx", rv_stop_name(m->stop), m->stop_detail,
+            (unsigned long long)m->stop_pc);
+    if (sym) fprintf(out, " in %s+0x%llx", sym->name, (unsigned long long)(m->stop_pc - sym->addr));
+    fprintf(out, " after %llu instructions\n", (unsigned long long)m->instret);
+}
+
+static void report_row(FILE *out, const char *name, uint64_t insns, uint64_t cap_insns, const double *cycles) {
+    double total = 0;
+    for (int c = 0; c < RV_CPI_COUNT; c++) total += cycles[c];
+    double n = insns ? (double)insns : 1.0;
+    fprintf(out, "  %-28s %12llu %6.1f%% %14.0f %7.3f", name, (unsigned long long)insns,
+            100.0 * (double)cap_insns / n, total, total / n);
+    for (int c = 0; c < RV_CPI_COUNT; c++) fprintf(out, " %7.3f", cycles[c] / n);
+    fprintf(out, "\n");
+}
+
+static void report_results(FILE *out, const char *binary, const rv_config_t *cfg, const char *region,
+                           uint64_t insns, uint64_t cap_insns, const double *cycles) {
+    double total = 0;
+    for (int c = 0; c < RV_CPI_COUNT; c++) total += cycles[c];
+    double n = insns ? (double)insns : 1.0;
+    fprintf(out, "RESULT,%s,%s,%s_instructions,%llu,count\n", binary, cfg->name, region, (unsigned long long)insns);
+    fprintf(out, "RESULT,%s,%s,%s_cap_instructions,%llu,count\n", binary, cfg->name, region,
+            (unsigned long long)cap_insns);
+    fprintf(out, "RESULT,%s,%s,%s_cycles,%.0f,cycles\n", binary, cfg->name, region, total);
+    fprintf(out, "RESULT,%s,%s,%s_cpi,%.4f,cpi\n", binary, cfg->name, region, total / n);
+    for (int c = 0; c < RV_CPI_COUNT; c++)
+        fprintf(out, "RESULT,%s,%s,%s_cpi_%s,%.4f,cpi\n", binary, cfg->name, region,
+                rv_cpi_name((rv_cpi_t)c), cycles[c] / n);
+}
+
+int rv_run(const rv_image_t *img, const rv_config_t *cfg, const rv_run_opts_t *opts,
+           FILE *out, rv_run_result_t *result) {
+    rv_machine_t m;
+    rv_timing_t *timing = NULL;
+    regions_t regions;
+    rv_exec_t e;
+
+    if (rv_machine_init(&m, img, RV_STACK_SIZE) != 0) {
+        fprintf(stderr, "rvsim: %s: cannot set up memory\n", img->path);
+        rv_machine_free(&m);
+        return 1;
+    }
+    m.max_insns = opts->max_insns;
+    m.console = out;
+    if (img->hosted) {
+        const char *argv[MAX_GUEST_ARGS + 1];
+        int argc = 0;
+        argv[argc++] = base_name(img->path);
+        for (int i = 0; i < opts->argc && argc <= MAX_GUEST_ARGS; i++) argv[argc++] = opts->argv[i];
+        if (rv_linux_init(&m, argc, argv, out) != 0) {
+            fprintf(stderr, "rvsim: %s: cannot set up the process\n", img->path);
+            rv_linux_free(&m);
+            rv_machine_free(&m);
+            return 1;
+        }
+    }
+    if (cfg) {
+        if (!(timing = rv_timing_create(cfg))) {
+            fprintf(stderr, "rvsim: cannot create the timing model\n");
+            rv_linux_free(&m);
+            rv_machine_free(&m);
+            return 1;
+        }
+        m.cycle_source = rv_timing_clock(timing);
+    }
+    regions_init(&regions, img);
+
+    while (rv_step(&m, &e) == 0) {
+        if (opts->trace) {
+            char text[96];
+            rv_disasm(e.insn, e.pc, text, sizeof(text));
+            fprintf(stderr, "%10llu %8llx: %s\n", (unsigned long long)m.instret, (unsigned long long)e.pc, text);
+        }
+        if (timing) rv_timing_account(timing, &e, regions_of(&regions, e.pc));
+        regions_update(&regions, img, &e);
+        if (m.stop != RV_STOP_NONE) break;
+    }
+
+    const char *binary = base_name(img->path);
+    const char *config = cfg ? cfg->name : "functional";
+    fprintf(out, "\nRVSIM RESULTS\n");
+    fprintf(out, "-------------------------------------------\n");
+    fprintf(out, "Binary: %s (%s)\n", binary,
+            img->purecap ? "purecap CHERI" : img->hosted ? "integer RISC-V, Linux user mode" : "integer RISC-V");
+    fprintf(out, "Config: %s\n", config);
+    print_stop(out, &m, img);
+    if (opts->dump) print_string(out, &m, img, opts->dump);
+    if (result) {
+        result->instructions = m.instret;
+        result->cycles = 0;
+        result->stop = m.stop;
+    }
+
+    if (timing) {
+        rv_stats_t stats;
+        rv_timing_finish(timing, &stats);
+        if (result)
+            for (int c = 0; c < RV_CPI_COUNT; c++) result->cycles += stats.cycles[c];
+        fprintf(out, "\n  %-28s %12s %7s %14s %7s", "Region", "Instr", "Cap", "Cycles", "CPI");
+        for (int c = 0; c < RV_CPI_COUNT; c++) fprintf(out, " %7.7s", rv_cpi_name((rv_cpi_t)c));
+        fprintf(out, "\n");
+        for (int r = 0; r < stats.region_count; r++) {
+            if (!stats.regions[r].instructions) continue;
+            report_row(out, regions.names[r], stats.regions[r].instructions,
+                       stats.regions[r].cap_instructions, stats.regions[r].cycles);
+        }
+        report_row(out, "total", stats.instructions, stats.cap_instructions, stats.cycles);
+        fprintf(out, "\n  Branch mispredicts: %llu / %llu   L1I misses: %llu   "
+                "L1D misses: %llu / %llu   L2 misses: %llu\n\n",
+                (unsigned long long)stats.mispredicts, (unsigned long long)stats.branches,
+                (unsigned long long)stats.l1i_misses, (unsigned long long)stats.l1d_misses,
+                (unsigned long long)stats.l1d_accesses, (unsigned long long)stats.l2_misses);
+
+        for (int r = 0; r < stats.region_count; r++) {
+            if (!stats.regions[r].instructions) continue;
+            report_results(out, binary, cfg, regions.names[r], stats.regions[r].instructions,
+                           stats.regions[r].cap_instructions, stats.regions[r].cycles);
+        }
+        report_results(out, binary, cfg, "total", stats.instructions, stats.cap_instructions, stats.cycles);
+        fprintf(out, "RESULT,%s,%s,mispredict_rate,%.4f,ratio\n", binary, cfg->name,
+                stats.branches ? (double)stats.mispredicts / (double)stats.branches : 0.0);
+        fprintf(out, "RESULT,%s,%s,l1d_miss_rate,%.4f,ratio\n", binary, cfg->name,
+                stats.l1d_accesses ? (double)stats.l1d_misses / (double)stats.l1d_accesses : 0.0);
+        rv_timing_free(timing);
+    } else {
+        fprintf(out, "\nRESULT,%s,%s,total_instructions,%llu,count\n", binary, config,
+                (unsigned long long)m.instret);
+    }
+    // How the run ended, with or without a timing model
+    fprintf(out, "RESULT,%s,%s,stop,%d,%s\n", binary, config, (int)m.stop, rv_stop_name(m.stop));
+    if (m.stop == RV_STOP_EXIT || m.stop == RV_STOP_SIGNAL)
+        fprintf(out, "RESULT,%s,%s,%s,%d,%s\n", binary, config,
+                m.stop == RV_STOP_EXIT ? "exit_status" : "signal", m.exit_code,
+                m.stop == RV_STOP_EXIT ? "status" : "signo");
+    rv_linux_free(&m);
+    rv_machine_free(&m);
+    return 0;
+}
@@ -0,0 +1,516 @@
+/*
+ * rvsim - RV64IMAFDC + CHERI-RISC-V Simulator with Core Timing Models
+ *
+ * Runs the statically linked Standard RISC-V builds (integer mode, DDC
+ * covering all of memory) and the purecap CHERI builds (capability mode,
+ * __cap_relocs applied by the loader) of the bare-metal test programs.
+ * Capabilities use a merged register file and exact (uncompressed) bounds;
+ * tags live in a shadow bitmap and the metadata of capabilities stored to
+ * memory in a side table, so memory keeps its 16-byte capability layout.
+ *
+ * Functional execution is instruction by instruction. An optional timing
+ * model (timing.c) consumes each retired instruction in program order and
+ * attributes cycles to a CPI stack: base, memory, branch and capability.
+ */
+
+#ifndef RVSIM_H
+#define RVSIM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// ---------------------------------------------------------------------------
+// Capabilities
+// ---------------------------------------------------------------------------
+
+#define CAP_PERM_GLOBAL         (1u << 0)
+#define CAP_PERM_EXECUTE        (1u << 1)
+#define CAP_PERM_LOAD           (1u << 2)
+#define CAP_PERM_STORE          (1u << 3)
+#define CAP_PERM_LOAD_CAP       (1u << 4)
+#define CAP_PERM_STORE_CAP      (1u << 5)
+#define CAP_PERM_STORE_LOCAL    (1u << 6)
+#define CAP_PERM_SEAL           (1u << 7)
+#define CAP_PERM_CINVOKE        (1u << 8)
+#define CAP_PERM_UNSEAL         (1u << 9)
+#define CAP_PERM_ACCESS_SYS     (1u << 10)
+#define CAP_PERM_SET_CID        (1u << 11)
+#define CAP_PERMS_ALL           0x78FFFu    // Architectural plus the four user permissions
+
+#define CAP_OTYPE_UNSEALED      UINT64_MAX
+#define CAP_OTYPE_SENTRY        (UINT64_MAX - 1)
+#define CAP_FLAG_CAPMODE        1u
+#define CAP_TOP_MAX             UINT64_MAX  // Stands in for 2^64
+
+typedef struct {
+    uint64_t addr;
+    uint64_t base;
+    uint64_t top;               // Exclusive
+    uint64_t otype;
+    uint32_t perms;
+    uint8_t flags;
+    uint8_t tag;
+} rv_cap_t;
+
+static inline rv_cap_t rv_cap_null(uint64_t addr) {
+    rv_cap_t c = { addr, 0, CAP_TOP_MAX, CAP_OTYPE_UNSEALED, 0, 0, 0 };
+    return c;
+}
+
+static inline rv_cap_t rv_cap_almighty(uint64_t addr) {
+    rv_cap_t c = { addr, 0, CAP_TOP_MAX, CAP_OTYPE_UNSEALED, CAP_PERMS_ALL, 0, 1 };
+    return c;
+}
+
+static inline int rv_cap_sealed(const rv_cap_t *c) {
+    return c->otype != CAP_OTYPE_UNSEALED;
+}
+
+static inline int rv_cap_in_bounds(const rv_cap_t *c, uint64_t addr, uint64_t size) {
+    if (addr < c->base) return 0;
+    if (c->top == CAP_TOP_MAX) return size == 0 || size - 1 <= CAP_TOP_MAX - addr;
+    return addr <= c->top && size <= c->top - addr;
+}
+
+static inline uint64_t rv_cap_length(const rv_cap_t *c) {
+    if (c->top == CAP_TOP_MAX) return c->base == 0 ? UINT64_MAX : CAP_TOP_MAX - c->base + 1;
+    return c->top - c->base;
+}
+
+// ---------------------------------------------------------------------------
+// Memory: sparse 4 KB pages, a tag bit per 16-byte granule
+// ---------------------------------------------------------------------------
+
+#define RV_PAGE_BITS    12
+#define RV_PAGE_SIZE    (1u << RV_PAGE_BITS)
+#define RV_CAP_SIZE     16
+#define RV_MAX_REGIONS  16
+
+typedef struct {
+    uint64_t number;
+    uint8_t *data;
+    uint64_t tags[RV_PAGE_SIZE / RV_CAP_SIZE / 64];
+} rv_page_t;
+
+typedef struct {
+    uint64_t key;               // Granule address, 1 when empty (never 16-aligned)
+    rv_cap_t meta;              // Bounds, permissions and type; the address is in memory
+} rv_capmeta_t;
+
+typedef struct {
+    rv_page_t *pages;           // Open-addressed by page number
+    size_t page_slots;
+    size_t page_count;
+    rv_page_t *last;            // One-entry lookup cache
+    rv_capmeta_t *meta;         // Open-addressed by granule address
+    size_t meta_slots;
+    size_t meta_count;
+    struct {
+        uint64_t start, end;
+        int writable;
+    } regions[RV_MAX_REGIONS];  // Accesses outside every region fault
+    int region_count;
+} rv_mem_t;
+
+// Accessors return 0, RV_MEM_UNMAPPED or RV_MEM_READONLY
+#define RV_MEM_UNMAPPED (-1)
+#define RV_MEM_READONLY (-2)
+
+int rv_mem_init(rv_mem_t *m);
+void rv_mem_free(rv_mem_t *m);
+int rv_mem_map(rv_mem_t *m, uint64_t start, uint64_t size, int writable);
+int rv_mem_read(rv_mem_t *m, uint64_t addr, void *out, size_t size);
+int rv_mem_write(rv_mem_t *m, uint64_t addr, const void *in, size_t size);
+int rv_mem_poke(rv_mem_t *m, uint64_t addr, const void *in, size_t size);  // Ignores write protection
+void rv_mem_discard(rv_mem_t *m, uint64_t start, uint64_t size);  // Frees its pages; reads as zeros again
+int rv_mem_read_cap(rv_mem_t *m, uint64_t addr, rv_cap_t *out);
+int rv_mem_write_cap(rv_mem_t *m, uint64_t addr, const rv_cap_t *in);
+
+// ---------------------------------------------------------------------------
+// Instructions
+// ---------------------------------------------------------------------------
+
+// Timing class of each operation
+typedef enum {
+    RV_CLS_ALU = 0,
+    RV_CLS_MUL,
+    RV_CLS_DIV,
+    RV_CLS_LOAD,
+    RV_CLS_STORE,
+    RV_CLS_AMO,
+    RV_CLS_BRANCH,
+    RV_CLS_JUMP,                // Direct: JAL
+    RV_CLS_JUMPR,               // Indirect: JALR, CJALR
+    RV_CLS_SYSTEM,              // CSR access, fences, ecall
+    RV_CLS_FP,                  // Floating-point arithmetic, conversions and moves
+    RV_CLS_CAP,                 // Capability manipulation (offset, address, permissions, move)
+    RV_CLS_CAP_BOUNDS,          // CSetBounds and friends
+    RV_CLS_CAP_INSPECT,         // CGet*
+    RV_CLS_CAP_LOAD,            // CLC
+    RV_CLS_CAP_STORE,           // CSC
+    RV_CLS_COUNT
+} rv_class_t;
+
+#define RV_OPS(X)                                                                         \
+    X(ILLEGAL, SYSTEM)                                                                    \
+    X(LUI, ALU) X(AUIPC, ALU) X(JAL, JUMP) X(JALR, JUMPR)                                 \
+    X(BEQ, BRANCH) X(BNE, BRANCH) X(BLT, BRANCH) X(BGE, BRANCH) X(BLTU, BRANCH)           \
+    X(BGEU, BRANCH)                                                                       \
+    X(LB, LOAD) X(LH, LOAD) X(LW, LOAD) X(LD, LOAD) X(LBU, LOAD) X(LHU, LOAD)             \
+    X(LWU, LOAD) X(SB, STORE) X(SH, STORE) X(SW, STORE) X(SD, STORE)                      \
+    X(ADDI, ALU) X(SLTI, ALU) X(SLTIU, ALU) X(XORI, ALU) X(ORI, ALU) X(ANDI, ALU)         \
+    X(SLLI, ALU) X(SRLI, ALU) X(SRAI, ALU)                                                \
+    X(ADD, ALU) X(SUB, ALU) X(SLL, ALU) X(SLT, ALU) X(SLTU, ALU) X(XOR, ALU) X(SRL, ALU)  \
+    X(SRA, ALU) X(OR, ALU) X(AND, ALU)                                                    \
+    X(ADDIW, ALU) X(SLLIW, ALU) X(SRLIW, ALU) X(SRAIW, ALU)                               \
+    X(ADDW, ALU) X(SUBW, ALU) X(SLLW, ALU) X(SRLW, ALU) X(SRAW, ALU)                      \
+    X(FENCE, SYSTEM) X(FENCE_I, SYSTEM) X(ECALL, SYSTEM) X(EBREAK, SYSTEM) X(WFI, SYSTEM) \
+    X(CSRRW, SYSTEM) X(CSRRS, SYSTEM) X(CSRRC, SYSTEM)                                    \
+    X(CSRRWI, SYSTEM) X(CSRRSI, SYSTEM) X(CSRRCI, SYSTEM)                                 \
+    X(MUL, MUL) X(MULH, MUL) X(MULHSU, MUL) X(MULHU, MUL)                                 \
+    X(DIV, DIV) X(DIVU, DIV) X(REM, DIV) X(REMU, DIV)                                     \
+    X(MULW, MUL) X(DIVW, DIV) X(DIVUW, DIV) X(REMW, DIV) X(REMUW, DIV)                    \
+    X(LR_W, AMO) X(SC_W, AMO) X(AMOSWAP_W, AMO) X(AMOADD_W, AMO) X(AMOXOR_W, AMO)         \
+    X(AMOAND_W, AMO) X(AMOOR_W, AMO) X(AMOMIN_W, AMO) X(AMOMAX_W, AMO)                    \
+    X(AMOMINU_W, AMO) X(AMOMAXU_W, AMO)                                                   \
+    X(LR_D, AMO) X(SC_D, AMO) X(AMOSWAP_D, AMO) X(AMOADD_D, AMO) X(AMOXOR_D, AMO)         \
+    X(AMOAND_D, AMO) X(AMOOR_D, AMO) X(AMOMIN_D, AMO) X(AMOMAX_D, AMO)                    \
+    X(AMOMINU_D, AMO) X(AMOMAXU_D, AMO)                                                   \
+    X(CLC, CAP_LOAD) X(CSC, CAP_STORE)                                                    \
+    X(CGETPERM, CAP_INSPECT) X(CGETTYPE, CAP_INSPECT) X(CGETBASE, CAP_INSPECT)            \
+    X(CGETLEN, CAP_INSPECT) X(CGETTAG, CAP_INSPECT) X(CGETSEALED, CAP_INSPECT)            \
+    X(CGETOFFSET, CAP_INSPECT) X(CGETFLAGS, CAP_INSPECT) X(CGETADDR, CAP_INSPECT)         \
+    X(CRRL, CAP_BOUNDS) X(CRAM, CAP_BOUNDS) X(CMOVE, CAP) X(CCLEARTAG, CAP)               \
+    X(CJALR, JUMPR) X(CSEALENTRY, CAP) X(CSPECIALRW, CAP)                                 \
+    X(CSETBOUNDS, CAP_BOUNDS) X(CSETBOUNDSEXACT, CAP_BOUNDS) X(CSETBOUNDSIMM, CAP_BOUNDS) \
+    X(CSEAL, CAP) X(CUNSEAL, CAP) X(CANDPERM, CAP) X(CSETFLAGS, CAP) X(CSETOFFSET, CAP)   \
+    X(CSETADDR, CAP) X(CINCOFFSET, CAP) X(CINCOFFSETIMM, CAP) X(CTOPTR, CAP)              \
+    X(CFROMPTR, CAP) X(CSUB, CAP) X(CBUILDCAP, CAP) X(CCOPYTYPE, CAP) X(CCSEAL, CAP)      \
+    X(CTESTSUBSET, CAP) X(CSETEQUALEXACT, CAP)                                            \
+    X(FLW, LOAD) X(FLD, LOAD) X(FSW, STORE) X(FSD, STORE)                                 \
+    X(FMADD_S, FP) X(FMSUB_S, FP) X(FNMSUB_S, FP) X(FNMADD_S, FP)                         \
+    X(FADD_S, FP) X(FSUB_S, FP) X(FMUL_S, FP) X(FDIV_S, DIV) X(FSQRT_S, DIV)              \
+    X(FSGNJ_S, FP) X(FSGNJN_S, FP) X(FSGNJX_S, FP) X(FMIN_S, FP) X(FMAX_S, FP)            \
+    X(FCVT_W_S, FP) X(FCVT_WU_S, FP) X(FCVT_L_S, FP) X(FCVT_LU_S, FP)                     \
+    X(FCVT_S_W, FP) X(FCVT_S_WU, FP) X(FCVT_S_L, FP) X(FCVT_S_LU, FP)                     \
+    X(FMV_X_W, FP) X(FMV_W_X, FP) X(FEQ_S, FP) X(FLT_S, FP) X(FLE_S, FP) X(FCLASS_S, FP)  \
+    X(FMADD_D, FP) X(FMSUB_D, FP) X(FNMSUB_D, FP) X(FNMADD_D, FP)                         \
+    X(FADD_D, FP) X(FSUB_D, FP) X(FMUL_D, FP) X(FDIV_D, DIV) X(FSQRT_D, DIV)              \
+    X(FSGNJ_D, FP) X(FSGNJN_D, FP) X(FSGNJX_D, FP) X(FMIN_D, FP) X(FMAX_D, FP)            \
+    X(FCVT_W_D, FP) X(FCVT_WU_D, FP) X(FCVT_L_D, FP) X(FCVT_LU_D, FP)                     \
+    X(FCVT_D_W, FP) X(FCVT_D_WU, FP) X(FCVT_D_L, FP) X(FCVT_D_LU, FP)                     \
+    X(FMV_X_D, FP) X(FMV_D_X, FP) X(FEQ_D, FP) X(FLT_D, FP) X(FLE_D, FP) X(FCLASS_D, FP)  \
+    X(FCVT_S_D, FP) X(FCVT_D_S, FP)
+
+typedef enum {
+#define RV_OP_ENUM(name, cls) RV_OP_##name,
+    RV_OPS(RV_OP_ENUM)
+#undef RV_OP_ENUM
+    RV_OP_COUNT
+} rv_op_t;
+
+typedef struct {
+    uint16_t op;                // rv_op_t
+    uint8_t cls;                // rv_class_t
+    uint8_t len;                // 2 or 4 bytes
+    uint8_t rd, rs1, rs2;       // 0-31 name x registers, RV_FREG + n names f<n>
+    uint8_t mem_size;           // Bytes accessed by loads, stores and AMOs
+    int64_t imm;                // Immediate, CSR number for CSR ops, SCR index for CSpecialRW,
+                                // rounding mode | rs3 << 8 for floating-point arithmetic
+} rv_insn_t;
+
+#define RV_FREG         32
+
+// Third source of the fused multiply-adds, or 0
+static inline int rv_insn_rs3(const rv_insn_t *in) {
+    int fma = (in->op >= RV_OP_FMADD_S && in->op <= RV_OP_FNMADD_S) ||
+              (in->op >= RV_OP_FMADD_D && in->op <= RV_OP_FNMADD_D);
+    return fma ? RV_FREG + (int)((in->imm >> 8) & 31) : 0;
+}
+
+const char *rv_op_name(rv_op_t op);
+const char *rv_reg_name(int reg);
+const char *rv_class_name(rv_class_t cls);
+rv_class_t rv_op_class(rv_op_t op);
+int rv_is_cap_class(rv_class_t cls);
+
+/*
+ * Decode the instruction starting with the 16-bit parcel lo (hi is the
+ * following parcel). capmode selects the CHERI capability-mode meaning of
+ * the compressed encodings that change in that mode.
+ */
+void rv_decode(uint16_t lo, uint16_t hi, int capmode, rv_insn_t *out);
+int rv_disasm(const rv_insn_t *in, uint64_t pc, char *buf, size_t size);
+
+// ---------------------------------------------------------------------------
+// Program images (immutable once loaded, shareable between machines)
+// ---------------------------------------------------------------------------
+
+#define RV_PIE_BASE     0x100000ull
+#define RV_STACK_TOP    0x40000000ull
+#define RV_STACK_SIZE   (8ull << 20)
+#define RV_RETURN_PC    0xfffffffffffff000ull  // Initial ra: returning from the entry point ends the run
+
+typedef struct {
+    uint64_t vaddr;             // Biased
+    uint64_t memsz;
+    const uint8_t *data;        // filesz bytes inside the file image
+    uint64_t filesz;
+    uint32_t flags;             // RV_PF_*
+} rv_segment_t;
+
+#define RV_PF_X         1
+#define RV_PF_W         2
+#define RV_PF_R         4
+
+typedef struct {
+    uint64_t addr;              // Biased
+    uint64_t size;
+    const char *name;
+    int is_func;
+} rv_symbol_t;
+
+typedef struct {
+    uint64_t location, base, offset, size;  // Biased
+    uint64_t perms;                         // __cap_relocs permission bits
+} rv_caprel_t;
+
+#define RV_CAPREL_FUNCTION  (1ull << 63)    // Sentry with PCC bounds
+#define RV_CAPREL_CONSTANT  (1ull << 62)    // Read-only data
+
+typedef struct {
+    char *path;
+    uint8_t *file;
+    size_t file_size;
+    uint64_t bias;
+    uint64_t entry;
+    int purecap;                // Starts in capability mode with __cap_relocs applied
+    uint64_t gp;                // __global_pointer$ or 0
+    int hosted;                 // Static Linux libc binary (has __libc_start_main)
+    int startup;                // Has its own start-up code (e_entry set)
+    uint64_t tohost;            // HTIF exit word of bare-metal images, or 0
+    uint64_t phdr;              // Program headers in the loaded image, or 0
+    int phent, phnum;
+    rv_segment_t segments[8];
+    int segment_count;
+    uint64_t image_base, image_end;
+    rv_symbol_t *symbols;       // Functions and objects, sorted by address
+    size_t symbol_count;
+    rv_caprel_t *caprels;
+    size_t caprel_count;
+    // Predecoded executable text, one entry per 16-bit parcel
+    uint64_t text_base, text_end;
+    rv_insn_t *text;
+} rv_image_t;
+
+int rv_image_load(rv_image_t *img, const char *path, char *err, size_t err_size);
+void rv_image_free(rv_image_t *img);
+const rv_symbol_t *rv_image_symbol(const rv_image_t *img, uint64_t addr);
+const rv_symbol_t *rv_image_find(const rv_image_t *img, const char *name);
+
+// ---------------------------------------------------------------------------
+// Machine
+// ---------------------------------------------------------------------------
+
+typedef enum {
+    RV_STOP_NONE = 0,
+    RV_STOP_IDLE,               // Jumped into an idle loop (bare-metal exit idiom)
+    RV_STOP_WFI,
+    RV_STOP_EBREAK,
+    RV_STOP_ECALL,
+    RV_STOP_LIMIT,              // Instruction limit reached
+    RV_STOP_ILLEGAL,
+    RV_STOP_ACCESS,             // Unmapped memory
+    RV_STOP_CAP,                // CHERI exception
+    RV_STOP_RETURN,             // Entry point returned to RV_RETURN_PC
+    RV_STOP_EXIT,               // exit()/exit_group() under Linux user mode, or HTIF tohost exit
+    RV_STOP_SIGNAL,             // Killed by an unhandled or blocked signal
+} rv_stop_t;
+
+typedef enum {
+    RV_CAPX_NONE = 0,
+    RV_CAPX_TAG,
+    RV_CAPX_SEAL,
+    RV_CAPX_PERM,
+    RV_CAPX_BOUNDS,
+    RV_CAPX_ALIGN,
+} rv_capx_t;
+
+// Dynamic information about one executed instruction, consumed by timing
+typedef struct {
+    uint64_t pc;
+    uint64_t next_pc;
+    const rv_insn_t *insn;
+    uint64_t mem_addr;
+    uint8_t taken;              // Branch or jump redirected the pc
+    uint8_t capmode;            // Executed in capability mode
+    uint8_t cap_checked;        // Memory access authorized by a register capability
+} rv_exec_t;
+
+typedef struct rv_machine {
+    const rv_image_t *image;
+    rv_mem_t mem;
+    rv_cap_t x[32];             // Merged integer/capability register file
+    rv_cap_t pcc;               // pcc.addr is the program counter
+    rv_cap_t ddc;
+    rv_cap_t scr[32];           // Other special capability registers (CSpecialRW)
+    uint64_t f[32];             // Floating-point registers, singles NaN-boxed
+    uint32_t fcsr;              // frm << 5 | fflags
+    struct rv_linux *os;        // Linux user-mode state, NULL for bare-metal runs
+    FILE *console;              // Bare-metal semihosting output, NULL discards it
+    uint64_t instret;
+    uint64_t max_insns;         // 0 for no limit
+    uint64_t reservation;       // LR/SC reservation address, UINT64_MAX when none
+    const uint64_t *cycle_source;   // Timing model cycle count for rdcycle, or NULL
+    rv_stop_t stop;
+    rv_capx_t capx;
+    uint64_t stop_pc;
+    uint64_t stop_addr;         // Data address of an access or CHERI fault
+    int exit_code;              // RV_STOP_EXIT status or RV_STOP_SIGNAL number
+    char stop_detail[96];
+} rv_machine_t;
+
+int rv_machine_init(rv_machine_t *m, const rv_image_t *img, uint64_t stack_size);
+void rv_machine_free(rv_machine_t *m);
+int rv_step(rv_machine_t *m, rv_exec_t *e);     // 0 while running
+const char *rv_stop_name(rv_stop_t stop);
+const char *rv_capx_name(rv_capx_t capx);
+
+// Floating-point arithmetic, conversions and moves (fpu.c)
+void rv_fpu_exec(rv_machine_t *m, const rv_insn_t *in);
+
+// ---------------------------------------------------------------------------
+// Linux user mode (syscall.c)
+// ---------------------------------------------------------------------------
+
+#define RV_SIGRETURN_PC 0xffffffffffffe000ull  // ra of signal handlers: returning runs rt_sigreturn
+
+/*
+ * Hosted (statically linked Linux) integer binaries get an initial stack
+ * with argv, envp and auxv, a program break and anonymous mmap, and the
+ * syscalls a static libc needs. Guest writes to stdout and stderr go to
+ * console (NULL discards them). Time is derived from the modelled clock,
+ * so runs are deterministic.
+ */
+int rv_linux_init(rv_machine_t *m, int argc, const char *const *argv, FILE *console);
+void rv_linux_free(rv_machine_t *m);
+int rv_linux_syscall(rv_machine_t *m);          // ECALL; nonzero once the run stopped
+int rv_linux_fault(rv_machine_t *m);            // Deliver the fault stop as a signal; 0 if handled
+int rv_linux_sigreturn(rv_machine_t *m);        // Fetch from RV_SIGRETURN_PC
+
+// ---------------------------------------------------------------------------
+// Configuration
+// ---------------------------------------------------------------------------
+
+typedef enum { RV_CORE_INORDER = 0, RV_CORE_OOO } rv_core_t;
+
+typedef struct {
+    char name[160];             // Sweeps append "+key=value" for each swept setting
+    int core;                   // rv_core_t
+    int width;                  // OoO fetch/issue/retire width
+    int rob;
+    int lsq;
+    int sb;                     // OoO store buffer entries, drained in order after retirement
+    int frontend;               // OoO fetch-to-dispatch depth
+    int mispredict;             // Extra cycles to refetch after a mispredicted branch
+    // Latencies (cycles until a dependent instruction can use the result)
+    int lat_alu, lat_mul, lat_div, lat_load, lat_csr, lat_fp;
+    // Capability latencies
+    int cap_alu;                // CIncOffset, CSetAddr, CMove, CAndPerm, ...
+    int cap_bounds;             // CSetBounds, CRRL, CRAM
+    int cap_inspect;            // CGet*
+    int cap_load;               // Extra over a data load for CLC (tag fetch)
+    int cap_store;              // Extra over a data store for CSC
+    int cap_check;              // Extra load-to-use for capability-authorized accesses
+    int cap_jump;               // Extra redirect cycles for capability jumps
+    // Memory hierarchy
+    int line;
+    int l1i_size, l1i_assoc;
+    int l1d_size, l1d_assoc;
+    int l2_size, l2_assoc, l2_lat;
+    int mem_lat;
+    // Branch prediction
+    int bp_entries;             // gshare 2-bit counters
+    int btb_entries;
+    int ras;
+} rv_config_t;
+
+void rv_config_default(rv_config_t *cfg, rv_core_t core);
+int rv_config_set(rv_config_t *cfg, const char *key, const char *value);
+int rv_config_apply(rv_config_t *cfg, const char *assignment);  // "key=value"
+int rv_config_load(rv_config_t *cfg, const char *path, char *err, size_t err_size);
+void rv_config_print(const rv_config_t *cfg, FILE *out);
+
+// ---------------------------------------------------------------------------
+// Timing
+// ---------------------------------------------------------------------------
+
+typedef enum {
+    RV_CPI_BASE = 0,
+    RV_CPI_MEMORY,
+    RV_CPI_BRANCH,
+    RV_CPI_CAPABILITY,
+    RV_CPI_COUNT
+} rv_cpi_t;
+
+#define RV_MAX_REGIONS_TRACKED 64
+
+typedef struct {
+    const char *name;
+    uint64_t instructions;
+    uint64_t cap_instructions;
+    double cycles[RV_CPI_COUNT];
+} rv_region_stats_t;
+
+typedef struct {
+    uint64_t instructions;
+    uint64_t cap_instructions;
+    double cycles[RV_CPI_COUNT];
+    uint64_t branches, mispredicts;
+    uint64_t l1i_misses, l1d_accesses, l1d_misses, l2_misses;
+    rv_region_stats_t regions[RV_MAX_REGIONS_TRACKED];
+    int region_count;
+} rv_stats_t;
+
+typedef struct rv_timing rv_timing_t;
+
+rv_timing_t *rv_timing_create(const rv_config_t *cfg);
+void rv_timing_free(rv_timing_t *t);
+void rv_timing_account(rv_timing_t *t, const rv_exec_t *e, int region);
+const uint64_t *rv_timing_clock(const rv_timing_t *t);
+void rv_timing_finish(rv_timing_t *t, rv_stats_t *stats);
+const char *rv_cpi_name(rv_cpi_t c);
+
+// ---------------------------------------------------------------------------
+// Runs (run.c) and the batch farm (batch.c)
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    uint64_t max_insns;
+    const char *dump;           // Symbol whose string is printed after the run, or NULL
+    int trace;                  // Trace executed instructions to stderr
+    int argc;                   // Guest arguments after argv[0] for hosted binaries
+    const char *const *argv;
+} rv_run_opts_t;
+
+typedef struct {
+    uint64_t instructions;
+    double cycles;              // 0 for functional runs
+    rv_stop_t stop;
+} rv_run_result_t;
+
+// One run of img; cfg NULL runs functionally. Report and RESULT lines go to out.
+int rv_run(const rv_image_t *img, const rv_config_t *cfg, const rv_run_opts_t *opts,
+           FILE *out, rv_run_result_t *result);
+
+/*
+ * Run every (image, configuration) pair on a pool of threads sharing the
+ * loaded images. Each job's RESULT lines are appended to results as soon as
+ * the job finishes; csv drops the "RESULT," prefix. configs NULL runs each
+ * image once functionally.
+ */
+int rv_batch(const rv_image_t *images, int image_count, const rv_config_t *configs,
+             int config_count, const rv_run_opts_t *opts, int threads, FILE *results, int csv);
+
+#endif // RVSIM_H
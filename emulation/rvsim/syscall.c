@@ -0,0 +1,665 @@
+/*
+ * rvsim - Linux User Mode
+ *
+ * Enough of the RISC-V Linux ABI for statically linked libc test programs:
+ * the initial stack (argc, argv, envp, auxv), the program break and
+ * anonymous mmap, console output, clocks, process identity and the signal
+ * calls behind signal(), sigaction(), raise() and sigaltstack(). Faults in
+ * the guest are delivered as SIGSEGV/SIGILL/SIGTRAP through the kernel's
+ * rt_sigframe layout, so a handler can inspect the context, longjmp out of
+ * it or return through rt_sigreturn.
+ *
+ * Nothing depends on the host: time is the modelled clock at a nominal
+ * 1 GHz, getrandom is a fixed sequence and there is no file system, so a
+ * run is as deterministic as a bare-metal one. Unknown system calls fail
+ * with ENOSYS.
+ */
+
+#include "rvsim.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// System call numbers (asm-generic, as used by riscv64)
+#define SYS_FACCESSAT           48
+#define SYS_OPENAT              56
+#define SYS_CLOSE               57
+#define SYS_LSEEK               62
+#define SYS_READ                63
+#define SYS_WRITE               64
+#define SYS_WRITEV              66
+#define SYS_READLINKAT          78
+#define SYS_NEWFSTATAT          79
+#define SYS_FSTAT               80
+#define SYS_IOCTL               29
+#define SYS_EXIT                93
+#define SYS_EXIT_GROUP          94
+#define SYS_SET_TID_ADDRESS     96
+#define SYS_FUTEX               98
+#define SYS_SET_ROBUST_LIST     99
+#define SYS_NANOSLEEP           101
+#define SYS_CLOCK_GETTIME       113
+#define SYS_CLOCK_GETRES        114
+#define SYS_CLOCK_NANOSLEEP     115
+#define SYS_SCHED_YIELD         124
+#define SYS_KILL                129
+#define SYS_TKILL               130
+#define SYS_TGKILL              131
+#define SYS_SIGALTSTACK         132
+#define SYS_RT_SIGACTION        134
+#define SYS_RT_SIGPROCMASK      135
+#define SYS_RT_SIGRETURN        139
+#define SYS_UNAME               160
+#define SYS_GETTIMEOFDAY        169
+#define SYS_GETPID              172
+#define SYS_GETPPID             173
+#define SYS_GETUID              174
+#define SYS_GETEUID             175
+#define SYS_GETGID              176
+#define SYS_GETEGID             177
+#define SYS_GETTID              178
+#define SYS_BRK                 214
+#define SYS_MUNMAP              215
+#define SYS_MREMAP              216
+#define SYS_MMAP                222
+#define SYS_MPROTECT            226
+#define SYS_MADVISE             233
+#define SYS_RISCV_FLUSH_ICACHE  259
+#define SYS_PRLIMIT64           261
+#define SYS_GETRANDOM           278
+
+#define E_NOENT     2
+#define E_BADF      9
+#define E_NOMEM     12
+#define E_FAULT     14
+#define E_NODEV     19
+#define E_INVAL     22
+#define E_NOTTY     25
+#define E_SPIPE     29
+#define E_NOSYS     38
+
+#define SIG_COUNT       64
+#define SIGILL          4
+#define SIGTRAP         5
+#define SIGABRT         6
+#define SIGBUS          7
+#define SIGFPE          8
+#define SIGKILL         9
+#define SIGSEGV         11
+#define SIGCHLD         17
+#define SIGCONT         18
+#define SIGSTOP         19
+#define SIGURG          23
+#define SIGWINCH        28
+
+#define SIG_DFL         0
+#define SIG_IGN         1
+#define SA_SIGINFO      0x00000004ull
+#define SA_ONSTACK      0x08000000ull
+#define SA_NODEFER      0x40000000ull
+#define SA_RESETHAND    0x80000000ull
+#define SS_ONSTACK      1
+#define SS_DISABLE      2
+#define SI_USER         0
+#define SI_TKILL        (-6)
+
+// struct rt_sigframe: siginfo, then ucontext with the sigcontext at +176
+#define FRAME_INFO      0
+#define FRAME_UC        128
+#define UC_STACK        16
+#define UC_SIGMASK      40
+#define UC_MCONTEXT     176
+#define MC_FP           256     // After pc and x1-x31
+#define FRAME_SIZE      (FRAME_UC + UC_MCONTEXT + MC_FP + 528)
+
+#define MMAP_TOP        (RV_STACK_TOP - RV_STACK_SIZE - (16ull << 20))
+#define REALTIME_EPOCH  1700000000ull   // CLOCK_REALTIME at cycle 0
+
+#define AT_NULL 0
+#define AT_PHDR 3
+#define AT_PHENT 4
+#define AT_PHNUM 5
+#define AT_PAGESZ 6
+#define AT_BASE 7
+#define AT_ENTRY 9
+#define AT_UID 11
+#define AT_EUID 12
+#define AT_GID 13
+#define AT_EGID 14
+#define AT_PLATFORM 15
+#define AT_HWCAP 16
+#define AT_CLKTCK 17
+#define AT_SECURE 23
+#define AT_RANDOM 25
+#define AT_EXECFN 31
+
+typedef struct {
+    uint64_t handler;
+    uint64_t flags;
+    uint64_t mask;
+} sigaction_t;
+
+struct rv_linux {
+    FILE *console;              // Guest stdout and stderr, or NULL
+    int heap;                   // Region index of the program break
+    uint64_t brk_base, brk;
+    int anon;                   // Region index of anonymous mappings (grows down)
+    sigaction_t actions[SIG_COUNT + 1];
+    uint64_t blocked, pending;  // Bit sig-1 per signal
+    uint64_t altstack_sp, altstack_size;
+    int altstack_disabled;
+    uint64_t random;
+};
+
+static inline uint64_t sigbit(int sig) {
+    return 1ull << (sig - 1);
+}
+
+static inline uint64_t reg(const rv_machine_t *m, int r) {
+    return m->x[r].addr;
+}
+
+static inline void set_reg(rv_machine_t *m, int r, uint64_t v) {
+    if (r) m->x[r] = rv_cap_null(v);
+}
+
+static uint64_t page_up(uint64_t v) {
+    return (v + RV_PAGE_SIZE - 1) & ~(uint64_t)(RV_PAGE_SIZE - 1);
+}
+
+// Guest memory; 0 or -EFAULT
+static int64_t put(rv_machine_t *m, uint64_t addr, const void *data, size_t size) {
+    return rv_mem_write(&m->mem, addr, data, size) ? -E_FAULT : 0;
+}
+
+static int64_t get(rv_machine_t *m, uint64_t addr, void *data, size_t size) {
+    return rv_mem_read(&m->mem, addr, data, size) ? -E_FAULT : 0;
+}
+
+// Nanoseconds since the start of the run: the modelled clock at 1 GHz
+static uint64_t now_ns(const rv_machine_t *m) {
+    return m->cycle_source ? *m->cycle_source : m->instret;
+}
+
+// ---------------------------------------------------------------------------
+// Process setup
+// ---------------------------------------------------------------------------
+
+static int push(rv_machine_t *m, uint64_t *sp, const void *data, size_t size) {
+    *sp -= size;
+    return rv_mem_poke(&m->mem, *sp, data, size);
+}
+
+int rv_linux_init(rv_machine_t *m, int argc, const char *const *argv, FILE *console) {
+    const rv_image_t *img = m->image;
+    struct rv_linux *os = calloc(1, sizeof(*os));
+    if (!os) return -1;
+    os->console = console;
+    os->random = 0x243F6A8885A308D3ull;
+    m->os = os;
+
+    // Program break after the image, anonymous mappings below the stack
+    os->brk_base = os->brk = page_up(img->image_end);
+    os->heap = m->mem.region_count;
+    if (rv_mem_map(&m->mem, os->brk_base, RV_PAGE_SIZE, 1) != 0) return -1;
+    os->anon = m->mem.region_count;
+    if (rv_mem_map(&m->mem, MMAP_TOP - RV_PAGE_SIZE, RV_PAGE_SIZE, 1) != 0) return -1;
+    m->mem.regions[os->anon].start = MMAP_TOP;
+
+    // Strings and AT_RANDOM bytes at the top of the stack
+    uint64_t sp = RV_STACK_TOP, strings[64];
+    static const char platform[] = "riscv64";
+    static const uint8_t random_bytes[16] = {
+        0x9e, 0x37, 0x79, 0xb9, 0x7f, 0x4a, 0x7c, 0x15, 0xf3, 0x9c, 0xc0, 0x60, 0x5c, 0xed, 0xc8, 0x34,
+    };
+    if (argc > 63) argc = 63;
+    for (int i = argc - 1; i >= 0; i--)
+        if (push(m, &sp, argv[i], strlen(argv[i]) + 1) != 0) return -1;
+    uint64_t arg = sp;
+    for (int i = 0; i < argc; i++) {
+        strings[i] = arg;
+        arg += strlen(argv[i]) + 1;
+    }
+    if (push(m, &sp, platform, sizeof(platform)) != 0) return -1;
+    uint64_t platform_addr = sp;
+    sp &= ~15ull;
+    if (push(m, &sp, random_bytes, sizeof(random_bytes)) != 0) return -1;
+    uint64_t random_addr = sp;
+
+    // HWCAP has one bit per single-letter extension: IMAFDC
+    uint64_t hwcap = 0;
+    for (const char *ext = "imafdc"; *ext; ext++) hwcap |= 1ull << (*ext - 'a');
+    const uint64_t auxv[] = {
+        AT_PHDR, img->phdr, AT_PHENT, (uint64_t)img->phent, AT_PHNUM, (uint64_t)img->phnum,
+        AT_PAGESZ, RV_PAGE_SIZE, AT_BASE, 0, AT_ENTRY, img->entry,
+        AT_UID, 0, AT_EUID, 0, AT_GID, 0, AT_EGID, 0,
+        AT_PLATFORM, platform_addr, AT_HWCAP, hwcap, AT_CLKTCK, 100, AT_SECURE, 0,
+        AT_RANDOM, random_addr, AT_EXECFN, argc ? strings[0] : 0, AT_NULL, 0,
+    };
+
+    // argc, argv[], NULL, envp[] (empty), NULL, auxv: 16-byte aligned at argc
+    size_t words = 1 + (size_t)argc + 1 + 1 + sizeof(auxv) / 8;
+    sp = (sp - words * 8) & ~15ull;
+    uint64_t p = sp, v = (uint64_t)argc;
+    if (rv_mem_poke(&m->mem, p, &v, 8) != 0) return -1;
+    p += 8;
+    for (int i = 0; i < argc; i++, p += 8)
+        if (rv_mem_poke(&m->mem, p, &strings[i], 8) != 0) return -1;
+    v = 0;
+    if (rv_mem_poke(&m->mem, p, &v, 8) != 0 || rv_mem_poke(&m->mem, p + 8, &v, 8) != 0) return -1;
+    if (rv_mem_poke(&m->mem, p + 16, auxv, sizeof(auxv)) != 0) return -1;
+
+    set_reg(m, 2, sp);
+    set_reg(m, 10, 0);  // No rtld_fini for a static binary
+    return 0;
+}
+
+void rv_linux_free(rv_machine_t *m) {
+    free(m->os);
+    m->os = NULL;
+}
+
+// ---------------------------------------------------------------------------
+// Memory
+// ---------------------------------------------------------------------------
+
+static uint64_t sys_brk(rv_machine_t *m, uint64_t want) {
+    struct rv_linux *os = m->os;
+    if (want < os->brk_base || page_up(want) > m->mem.regions[os->anon].start) return os->brk;
+    if (want < os->brk) rv_mem_discard(&m->mem, want, os->brk - want);
+    m->mem.regions[os->heap].end = page_up(want) > os->brk_base ? page_up(want) : os->brk_base + RV_PAGE_SIZE;
+    os->brk = want;
+    return os->brk;
+}
+
+// Anonymous private mappings only, allocated downwards from MMAP_TOP
+static int64_t sys_mmap(rv_machine_t *m, uint64_t addr, uint64_t len, uint64_t flags) {
+    struct rv_linux *os = m->os;
+    const uint64_t map_fixed = 0x10, map_anonymous = 0x20;
+    if (len == 0) return -E_INVAL;
+    if (!(flags & map_anonymous)) return -E_NODEV;
+    len = page_up(len);
+    if (flags & map_fixed) {
+        for (int i = 0; i < m->mem.region_count; i++) {
+            if (addr >= m->mem.regions[i].start && addr + len <= m->mem.regions[i].end) {
+                rv_mem_discard(&m->mem, addr, len);
+                return (int64_t)addr;
+            }
+        }
+        return -E_NOMEM;
+    }
+    // Keep 64 MB between the mappings and the program break
+    uint64_t start = m->mem.regions[os->anon].start;
+    if (len > start || start - len < page_up(os->brk) + (64ull << 20)) return -E_NOMEM;
+    uint64_t bottom = start - len;
+    m->mem.regions[os->anon].start = bottom;
+    return (int64_t)bottom;
+}
+
+static int64_t sys_munmap(rv_machine_t *m, uint64_t addr, uint64_t len) {
+    struct rv_linux *os = m->os;
+    if ((addr & (RV_PAGE_SIZE - 1)) || len == 0) return -E_INVAL;
+    len = page_up(len);
+    if (len == 0 || addr + len < addr) return -E_INVAL;    // Wraps around
+    rv_mem_discard(&m->mem, addr, len);
+    // Only the lowest mapping can be returned to the allocator
+    if (addr == m->mem.regions[os->anon].start && addr + len <= MMAP_TOP)
+        m->mem.regions[os->anon].start = addr + len;
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Files
+// ---------------------------------------------------------------------------
+
+static int64_t console_write(rv_machine_t *m, int64_t fd, uint64_t buf, uint64_t len) {
+    char chunk[512];
+    if (fd != 1 && fd != 2) return -E_BADF;
+    for (uint64_t done = 0; done < len;) {
+        size_t n = len - done < sizeof(chunk) ? (size_t)(len - done) : sizeof(chunk);
+        if (get(m, buf + done, chunk, n)) return done ? (int64_t)done : -E_FAULT;
+        if (m->os->console) fwrite(chunk, 1, n, m->os->console);
+        done += n;
+    }
+    return (int64_t)len;
+}
+
+static int64_t sys_writev(rv_machine_t *m, int64_t fd, uint64_t iov, int64_t count) {
+    int64_t total = 0;
+    for (int64_t i = 0; i < count; i++) {
+        uint64_t v[2];
+        if (get(m, iov + (uint64_t)i * 16, v, sizeof(v))) return -E_FAULT;
+        int64_t rc = console_write(m, fd, v[0], v[1]);
+        if (rc < 0) return total ? total : rc;
+        total += rc;
+    }
+    return total;
+}
+
+// struct stat for the console descriptors: a character device
+static int64_t sys_fstat(rv_machine_t *m, int64_t fd, uint64_t buf) {
+    uint8_t st[128];
+    if (fd < 0 || fd > 2) return -E_BADF;
+    memset(st, 0, sizeof(st));
+    uint32_t mode = 0020620, blksize = 1024, nlink = 1;
+    uint64_t rdev = 0x8800 + (uint64_t)fd;
+    memcpy(st + 16, &mode, 4);
+    memcpy(st + 20, &nlink, 4);
+    memcpy(st + 32, &rdev, 8);
+    memcpy(st + 56, &blksize, 4);
+    return put(m, buf, st, sizeof(st));
+}
+
+static int64_t sys_uname(rv_machine_t *m, uint64_t buf) {
+    static const char *const fields[6] = { "Linux", "rvsim", "6.1.0", "#1", "riscv64", "(none)" };
+    char uts[6 * 65];
+    memset(uts, 0, sizeof(uts));
+    for (int i = 0; i < 6; i++) snprintf(uts + i * 65, 65, "%s", fields[i]);
+    return put(m, buf, uts, sizeof(uts));
+}
+
+// ---------------------------------------------------------------------------
+// Signals
+// ---------------------------------------------------------------------------
+
+static const char *signal_name(int sig) {
+    switch (sig) {
+    case SIGILL: return "SIGILL";
+    case SIGTRAP: return "SIGTRAP";
+    case SIGABRT: return "SIGABRT";
+    case SIGBUS: return "SIGBUS";
+    case SIGFPE: return "SIGFPE";
+    case SIGKILL: return "SIGKILL";
+    case SIGSEGV: return "SIGSEGV";
+    default: return "signal";
+    }
+}
+
+static int default_ignored(int sig) {
+    return sig == SIGCHLD || sig == SIGCONT || sig == SIGURG || sig == SIGWINCH;
+}
+
+static int kill_process(rv_machine_t *m, int sig, uint64_t pc, const char *why) {
+    m->stop = RV_STOP_SIGNAL;
+    m->stop_pc = pc;
+    m->exit_code = sig;
+    snprintf(m->stop_detail, sizeof(m->stop_detail), "%s %d%s%s", signal_name(sig), sig,
+             why[0] ? ", " : "", why);
+    return 1;
+}
+
+/*
+ * Build an rt_sigframe for sig on the current (or alternate) stack and
+ * enter the handler. pc is where sigreturn resumes. Returns nonzero after
+ * stopping the run if the frame cannot be written.
+ */
+static int enter_handler(rv_machine_t *m, int sig, int code, uint64_t addr, uint64_t pc) {
+    struct rv_linux *os = m->os;
+    sigaction_t *act = &os->actions[sig];
+    uint64_t sp = reg(m, 2);
+    int on_altstack = !os->altstack_disabled && os->altstack_size &&
+                      sp > os->altstack_sp && sp <= os->altstack_sp + os->altstack_size;
+    if ((act->flags & SA_ONSTACK) && !os->altstack_disabled && os->altstack_size && !on_altstack)
+        sp = os->altstack_sp + os->altstack_size;
+    uint64_t frame = (sp - FRAME_SIZE) & ~15ull;
+
+    uint8_t buf[FRAME_SIZE];
+    memset(buf, 0, sizeof(buf));
+    int32_t info[4] = { sig, 0, code, 0 };
+    memcpy(buf + FRAME_INFO, info, sizeof(info));
+    if (code == SI_USER || code == SI_TKILL) {
+        uint32_t pid = 1;
+        memcpy(buf + FRAME_INFO + 16, &pid, 4);
+    } else {
+        memcpy(buf + FRAME_INFO + 16, &addr, 8);
+    }
+    uint8_t *uc = buf + FRAME_UC;
+    uint32_t ss_flags = os->altstack_disabled ? SS_DISABLE : on_altstack ? SS_ONSTACK : 0;
+    memcpy(uc + UC_STACK, &os->altstack_sp, 8);
+    memcpy(uc + UC_STACK + 8, &ss_flags, 4);
+    memcpy(uc + UC_STACK + 16, &os->altstack_size, 8);
+    memcpy(uc + UC_SIGMASK, &os->blocked, 8);
+    uint8_t *mc = uc + UC_MCONTEXT;
+    memcpy(mc, &pc, 8);
+    for (int r = 1; r < 32; r++) memcpy(mc + r * 8, &m->x[r].addr, 8);
+    memcpy(mc + MC_FP, m->f, sizeof(m->f));
+    memcpy(mc + MC_FP + sizeof(m->f), &m->fcsr, 4);
+    if (put(m, frame, buf, sizeof(buf)))
+        return kill_process(m, SIGSEGV, pc, "cannot write the signal frame");
+
+    os->blocked |= act->mask;
+    if (!(act->flags & SA_NODEFER)) os->blocked |= sigbit(sig);
+    os->blocked &= ~(sigbit(SIGKILL) | sigbit(SIGSTOP));
+    uint64_t handler = act->handler;
+    if (act->flags & SA_RESETHAND) act->handler = SIG_DFL;
+
+    set_reg(m, 1, RV_SIGRETURN_PC);
+    set_reg(m, 2, frame);
+    set_reg(m, 10, (uint64_t)sig);
+    set_reg(m, 11, frame + FRAME_INFO);
+    set_reg(m, 12, frame + FRAME_UC);
+    m->pcc.addr = handler;
+    return 0;
+}
+
+// Signals sent by the guest (kill, tgkill): may stay pending while blocked
+static int raise_signal(rv_machine_t *m, int sig, int code, uint64_t pc) {
+    struct rv_linux *os = m->os;
+    uint64_t handler = os->actions[sig].handler;
+    if (handler == SIG_IGN || (handler == SIG_DFL && default_ignored(sig))) return 0;
+    if ((os->blocked & sigbit(sig)) && sig != SIGKILL && sig != SIGSTOP) {
+        os->pending |= sigbit(sig);
+        return 0;
+    }
+    if (handler == SIG_DFL || sig == SIGKILL || sig == SIGSTOP) return kill_process(m, sig, pc, "raised");
+    return enter_handler(m, sig, code, 0, pc);
+}
+
+// Deliver the lowest pending signal that is no longer blocked
+static int deliver_pending(rv_machine_t *m, uint64_t pc) {
+    struct rv_linux *os = m->os;
+    uint64_t ready = os->pending & ~os->blocked;
+    if (!ready) return 0;
+    int sig = __builtin_ctzll(ready) + 1;
+    os->pending &= ~sigbit(sig);
+    return raise_signal(m, sig, SI_USER, pc);
+}
+
+int rv_linux_fault(rv_machine_t *m) {
+    struct rv_linux *os = m->os;
+    int sig, code = 1;  // SEGV_MAPERR, ILL_ILLOPC, TRAP_BRKPT
+    switch (m->stop) {
+    case RV_STOP_ACCESS:
+        sig = SIGSEGV;
+        if (strstr(m->stop_detail, "read-only")) code = 2;  // SEGV_ACCERR
+        break;
+    case RV_STOP_CAP: sig = SIGSEGV; code = 2; break;
+    case RV_STOP_ILLEGAL: sig = SIGILL; break;
+    case RV_STOP_EBREAK: sig = SIGTRAP; break;
+    default: return 1;
+    }
+    // A blocked or ignored synchronous fault kills the process, as in Linux
+    uint64_t handler = os->actions[sig].handler;
+    if (handler == SIG_DFL || handler == SIG_IGN || (os->blocked & sigbit(sig))) {
+        char why[sizeof(m->stop_detail)];
+        snprintf(why, sizeof(why), "%s", m->stop_detail);
+        return kill_process(m, sig, m->stop_pc, why);
+    }
+    uint64_t pc = m->stop_pc;
+    m->stop = RV_STOP_NONE;
+    m->capx = RV_CAPX_NONE;
+    m->stop_detail[0] = '\0';
+    return enter_handler(m, sig, code, m->stop_addr, pc);
+}
+
+int rv_linux_sigreturn(rv_machine_t *m) {
+    struct rv_linux *os = m->os;
+    uint64_t frame = reg(m, 2);
+    uint8_t mc[MC_FP + 260];
+    uint64_t mask;
+    if (get(m, frame + FRAME_UC + UC_MCONTEXT, mc, sizeof(mc)) ||
+        get(m, frame + FRAME_UC + UC_SIGMASK, &mask, 8))
+        return kill_process(m, SIGSEGV, m->pcc.addr, "bad signal frame");
+    uint64_t pc;
+    memcpy(&pc, mc, 8);
+    for (int r = 1; r < 32; r++) {
+        uint64_t v;
+        memcpy(&v, mc + r * 8, 8);
+        set_reg(m, r, v);
+    }
+    memcpy(m->f, mc + MC_FP, sizeof(m->f));
+    memcpy(&m->fcsr, mc + MC_FP + sizeof(m->f), 4);
+    m->fcsr &= 0xff;
+    os->blocked = mask & ~(sigbit(SIGKILL) | sigbit(SIGSTOP));
+    m->pcc.addr = pc;
+    return deliver_pending(m, pc);
+}
+
+static int64_t sys_sigaction(rv_machine_t *m, int64_t sig, uint64_t act, uint64_t old) {
+    struct rv_linux *os = m->os;
+    if (sig < 1 || sig > SIG_COUNT) return -E_INVAL;
+    if (old && put(m, old, &os->actions[sig], sizeof(sigaction_t))) return -E_FAULT;
+    if (act) {
+        if (sig == SIGKILL || sig == SIGSTOP) return -E_INVAL;
+        sigaction_t a;
+        if (get(m, act, &a, sizeof(a))) return -E_FAULT;
+        os->actions[sig] = a;
+        if (a.handler == SIG_IGN) os->pending &= ~sigbit((int)sig);
+    }
+    return 0;
+}
+
+static int64_t sys_sigprocmask(rv_machine_t *m, int64_t how, uint64_t set, uint64_t old) {
+    struct rv_linux *os = m->os;
+    uint64_t mask;
+    if (old && put(m, old, &os->blocked, 8)) return -E_FAULT;
+    if (!set) return 0;
+    if (get(m, set, &mask, 8)) return -E_FAULT;
+    switch (how) {
+    case 0: os->blocked |= mask; break;
+    case 1: os->blocked &= ~mask; break;
+    case 2: os->blocked = mask; break;
+    default: return -E_INVAL;
+    }
+    os->blocked &= ~(sigbit(SIGKILL) | sigbit(SIGSTOP));
+    return 0;
+}
+
+static int64_t sys_sigaltstack(rv_machine_t *m, uint64_t ss, uint64_t old) {
+    struct rv_linux *os = m->os;
+    if (old) {
+        uint64_t sp = reg(m, 2);
+        uint32_t flags = os->altstack_disabled || !os->altstack_size ? SS_DISABLE
+                         : sp > os->altstack_sp && sp <= os->altstack_sp + os->altstack_size ? SS_ONSTACK : 0;
+        uint8_t st[24];
+        memset(st, 0, sizeof(st));
+        memcpy(st, &os->altstack_sp, 8);
+        memcpy(st + 8, &flags, 4);
+        memcpy(st + 16, &os->altstack_size, 8);
+        if (put(m, old, st, sizeof(st))) return -E_FAULT;
+    }
+    if (ss) {
+        uint8_t st[24];
+        uint32_t flags;
+        if (get(m, ss, st, sizeof(st))) return -E_FAULT;
+        memcpy(&flags, st + 8, 4);
+        os->altstack_disabled = (flags & SS_DISABLE) != 0;
+        if (!os->altstack_disabled) {
+            memcpy(&os->altstack_sp, st, 8);
+            memcpy(&os->altstack_size, st + 16, 8);
+        }
+    }
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Dispatch
+// ---------------------------------------------------------------------------
+
+static int64_t put_time(rv_machine_t *m, uint64_t addr, uint64_t ns, uint64_t sub_unit) {
+    uint64_t t[2] = { ns / 1000000000ull, ns % 1000000000ull / sub_unit };
+    return put(m, addr, t, sizeof(t));
+}
+
+int rv_linux_syscall(rv_machine_t *m) {
+    struct rv_linux *os = m->os;
+    uint64_t pc = m->pcc.addr;
+    uint64_t a0 = reg(m, 10), a1 = reg(m, 11), a2 = reg(m, 12), a3 = reg(m, 13);
+    int64_t rc;
+
+    switch (reg(m, 17)) {
+    case SYS_EXIT: case SYS_EXIT_GROUP:
+        m->stop = RV_STOP_EXIT;
+        m->stop_pc = pc;
+        m->exit_code = (int)(a0 & 0xff);
+        snprintf(m->stop_detail, sizeof(m->stop_detail), "exit status %d", m->exit_code);
+        return 1;
+
+    case SYS_WRITE: rc = console_write(m, (int64_t)a0, a1, a2); break;
+    case SYS_WRITEV: rc = sys_writev(m, (int64_t)a0, a1, (int64_t)a2); break;
+    case SYS_READ: rc = a0 == 0 ? 0 : -E_BADF; break;
+    case SYS_OPENAT: case SYS_FACCESSAT: case SYS_READLINKAT: rc = -E_NOENT; break;
+    case SYS_CLOSE: rc = a0 <= 2 ? 0 : -E_BADF; break;
+    case SYS_LSEEK: rc = a0 <= 2 ? -E_SPIPE : -E_BADF; break;
+    case SYS_IOCTL: rc = a0 <= 2 ? -E_NOTTY : -E_BADF; break;
+    case SYS_FSTAT: rc = sys_fstat(m, (int64_t)a0, a1); break;
+    case SYS_NEWFSTATAT: rc = sys_fstat(m, (int64_t)a0, a2); break;
+
+    case SYS_BRK: rc = (int64_t)sys_brk(m, a0); break;
+    case SYS_MMAP: rc = sys_mmap(m, a0, a1, a3); break;
+    case SYS_MUNMAP: rc = sys_munmap(m, a0, a1); break;
+    case SYS_MREMAP: rc = -E_NOMEM; break;
+    case SYS_MPROTECT: case SYS_MADVISE: case SYS_RISCV_FLUSH_ICACHE: rc = 0; break;
+
+    case SYS_CLOCK_GETTIME:
+        rc = put_time(m, a1, now_ns(m) + (a0 == 0 ? REALTIME_EPOCH * 1000000000ull : 0), 1);
+        break;
+    case SYS_CLOCK_GETRES: rc = a1 ? put_time(m, a1, 1, 1) : 0; break;
+    case SYS_GETTIMEOFDAY: rc = a0 ? put_time(m, a0, now_ns(m) + REALTIME_EPOCH * 1000000000ull, 1000) : 0; break;
+    case SYS_NANOSLEEP: case SYS_CLOCK_NANOSLEEP: case SYS_SCHED_YIELD: rc = 0; break;
+
+    case SYS_GETPID: case SYS_GETTID: case SYS_SET_TID_ADDRESS: rc = 1; break;
+    case SYS_GETPPID: case SYS_GETUID: case SYS_GETEUID: case SYS_GETGID: case SYS_GETEGID: rc = 0; break;
+    case SYS_SET_ROBUST_LIST: case SYS_FUTEX: rc = 0; break;
+    case SYS_UNAME: rc = sys_uname(m, a0); break;
+    case SYS_PRLIMIT64:
+        if (a3) {
+            uint64_t lim[2] = { a1 == 3 ? RV_STACK_SIZE : UINT64_MAX, UINT64_MAX };  // RLIMIT_STACK
+            rc = put(m, a3, lim, sizeof(lim));
+        } else {
+            rc = 0;
+        }
+        break;
+    case SYS_GETRANDOM:
+        rc = (int64_t)a1;
+        for (uint64_t i = 0; i < a1 && rc >= 0; i++) {
+            os->random ^= os->random << 13;
+            os->random ^= os->random >> 7;
+            os->random ^= os->random << 17;
+            uint8_t b = (uint8_t)os->random;
+            if (put(m, a0 + i, &b, 1)) rc = -E_FAULT;
+        }
+        break;
+
+    case SYS_RT_SIGACTION: rc = sys_sigaction(m, (int64_t)a0, a1, a2); break;
+    case SYS_RT_SIGPROCMASK:
+        rc = sys_sigprocmask(m, (int64_t)a0, a1, a2);
+        set_reg(m, 10, (uint64_t)rc);
+        return deliver_pending(m, pc + 4);
+    case SYS_SIGALTSTACK: rc = sys_sigaltstack(m, a0, a1); break;
+    case SYS_RT_SIGRETURN: return rv_linux_sigreturn(m);
+    case SYS_KILL: case SYS_TKILL: case SYS_TGKILL: {
+        int64_t sig = (int64_t)(reg(m, 17) == SYS_TGKILL ? a2 : a1);
+        if (sig < 0 || sig > SIG_COUNT) {
+            rc = -E_INVAL;
+            break;
+        }
+        set_reg(m, 10, 0);
+        return sig ? raise_signal(m, (int)sig, reg(m, 17) == SYS_KILL ? SI_USER : SI_TKILL, pc + 4) : 0;
+    }
+
+    default: rc = -E_NOSYS; break;
+    }
+    set_reg(m, 10, (uint64_t)rc);
+    return 0;
+}
@@ -0,0 +1,593 @@
+/*
+ * rvsim - Core Timing Models and CPI Stacks
+ *
+ * Trace-driven: the functional core hands over each instruction as it
+ * retires, in program order, together with its memory address and branch
+ * outcome. Two cores are modelled on the same caches and predictors:
+ *
+ *   inorder  Single-issue 5-stage pipeline. A register scoreboard with
+ *            full forwarding, blocking data-cache misses, an unpipelined
+ *            divider and branches that resolve in EX.
+ *   ooo      Fetch, dispatch, issue, complete and retire stages with a
+ *            reorder buffer, load/store queue, issue width and a bounded
+ *            store buffer. Retired stores drain from it in order, their
+ *            misses overlapping, and a store cannot dispatch until the
+ *            entry it will take has drained, so store-miss bandwidth
+ *            stalls the pipeline once the buffer fills.
+ *
+ * CPI stacks are built from "ready" records: the cycle a value or pipeline
+ * slot becomes available plus the trailing cycles owed to each cause. When
+ * an instruction stalls, the record that bound it says where the stall
+ * cycles go; causes propagate through dependences, so a chain of ALU ops
+ * behind a cache miss is charged to memory. Every instruction also charges
+ * one base cycle when it issues (inorder) or opens a retire cycle (ooo);
+ * for capability instructions that base cycle is a capability cycle.
+ */
+
+#include "rvsim.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define ISSUE_WINDOW    (1u << 16)  // Cycles of issue-slot bookkeeping
+#define STORE_TABLE     1024        // Recent stores for store-to-load forwarding
+
+typedef struct {
+    uint64_t time;                  // First cycle the value or slot is usable
+    uint32_t part[RV_CPI_COUNT];    // Trailing cycles before time owed to each cause
+    uint8_t rest;                   // Cause of everything earlier
+} ready_t;
+
+typedef struct {
+    uint64_t *tags;                 // UINT64_MAX marks an invalid way
+    uint64_t *stamp;
+    uint32_t sets, ways;
+    uint64_t clock;
+} cache_t;
+
+typedef struct {
+    uint64_t cycle;
+    uint32_t count;
+} slot_t;
+
+struct rv_timing {
+    rv_config_t cfg;
+    int line_bits;
+    cache_t l1i, l1d, l2;
+    uint64_t last_fetch_line;
+
+    // Branch prediction: gshare, direct-mapped BTB, return address stack
+    uint8_t *counters;
+    uint32_t bp_mask;
+    uint32_t history;
+    uint64_t *btb_pc, *btb_target;
+    uint32_t btb_mask;
+    uint64_t *ras;
+    int ras_top, ras_depth;
+
+    ready_t reg[64];                // x0-x31, then f0-f31
+    ready_t front;                  // Earliest fetch (ooo) or issue (inorder) of the next instruction
+    ready_t div_free;
+    uint64_t clock;                 // Exported for rdcycle
+    uint64_t count;                 // Instructions seen
+
+    // In-order pipeline
+    uint64_t last_issue;
+
+    // Out-of-order pipeline
+    uint64_t fetch_cycle;
+    uint32_t fetch_count;
+    uint64_t dispatch_cycle;
+    uint32_t dispatch_count;
+    uint64_t retire_cycle;
+    uint32_t retire_count;
+    ready_t *rob_ring;              // Retire record of the instruction occupying each ROB slot
+    ready_t *lsq_ring;
+    uint64_t lsq_count;
+    ready_t *sb_ring;               // Drain record of the store occupying each store-buffer entry
+    uint64_t sb_count;
+    uint64_t sb_drained;            // Cycle the youngest buffered store leaves
+    slot_t *issue_slots;
+    struct {
+        uint64_t addr;
+        ready_t data;
+    } stores[STORE_TABLE];
+
+    rv_stats_t stats;
+};
+
+static const rv_cpi_t tail_order[] = { RV_CPI_CAPABILITY, RV_CPI_MEMORY, RV_CPI_BRANCH, RV_CPI_BASE };
+
+const char *rv_cpi_name(rv_cpi_t c) {
+    static const char *const names[RV_CPI_COUNT] = { "base", "memory", "branch", "capability" };
+    return c < RV_CPI_COUNT ? names[c] : "?";
+}
+
+// ---------------------------------------------------------------------------
+// Ready records
+// ---------------------------------------------------------------------------
+
+static inline ready_t ready_at(uint64_t time, rv_cpi_t cause) {
+    ready_t r;
+    memset(&r, 0, sizeof(r));
+    r.time = time;
+    r.rest = (uint8_t)cause;
+    return r;
+}
+
+// Cause a dependent instruction inherits from this record
+static inline rv_cpi_t dominant(const ready_t *r) {
+    for (int i = 0; i < 3; i++)
+        if (r->part[tail_order[i]]) return tail_order[i];
+    return (rv_cpi_t)r->rest;
+}
+
+static inline const ready_t *later(const ready_t *a, const ready_t *b) {
+    return b->time > a->time ? b : a;
+}
+
+static void charge(rv_timing_t *t, int region, rv_cpi_t cause, uint64_t cycles) {
+    t->stats.cycles[cause] += (double)cycles;
+    if (region >= 0) t->stats.regions[region].cycles[cause] += (double)cycles;
+}
+
+// Charge the stall cycles that end where the binding record becomes ready
+static void charge_stall(rv_timing_t *t, int region, uint64_t stall, const ready_t *r) {
+    for (int i = 0; i < 4 && stall; i++) {
+        uint64_t take = r->part[tail_order[i]] < stall ? r->part[tail_order[i]] : stall;
+        charge(t, region, tail_order[i], take);
+        stall -= take;
+    }
+    if (stall) charge(t, region, (rv_cpi_t)r->rest, stall);
+}
+
+// ---------------------------------------------------------------------------
+// Caches
+// ---------------------------------------------------------------------------
+
+static int cache_init(cache_t *c, int size, int assoc, int line) {
+    memset(c, 0, sizeof(*c));
+    if (size <= 0) return 0;
+    uint32_t sets = (uint32_t)(size / line / assoc);
+    uint32_t pow2 = 1;
+    while (pow2 * 2 <= sets) pow2 *= 2;
+    c->sets = pow2 ? pow2 : 1;
+    c->ways = (uint32_t)assoc;
+    c->tags = malloc((size_t)c->sets * c->ways * sizeof(*c->tags));
+    c->stamp = calloc((size_t)c->sets * c->ways, sizeof(*c->stamp));
+    if (!c->tags || !c->stamp) return -1;
+    for (size_t i = 0; i < (size_t)c->sets * c->ways; i++) c->tags[i] = UINT64_MAX;
+    return 0;
+}
+
+static void cache_free(cache_t *c) {
+    free(c->tags);
+    free(c->stamp);
+}
+
+// Returns 1 on a hit; a miss allocates the line, replacing the LRU way
+static int cache_access(cache_t *c, uint64_t line) {
+    if (!c->sets) return 0;
+    uint64_t *tags = c->tags + (size_t)(line & (c->sets - 1)) * c->ways;
+    uint64_t *stamp = c->stamp + (size_t)(line & (c->sets - 1)) * c->ways;
+    uint32_t victim = 0;
+    c->clock++;
+    for (uint32_t w = 0; w < c->ways; w++) {
+        if (tags[w] == line) {
+            stamp[w] = c->clock;
+            return 1;
+        }
+        if (stamp[w] < stamp[victim]) victim = w;
+    }
+    tags[victim] = line;
+    stamp[victim] = c->clock;
+    return 0;
+}
+
+// Extra cycles beyond an L1 hit
+static uint32_t miss_penalty(rv_timing_t *t, cache_t *l1, uint64_t addr, uint64_t *l1_misses) {
+    uint64_t line = addr >> t->line_bits;
+    if (cache_access(l1, line)) return 0;
+    (*l1_misses)++;
+    if (cache_access(&t->l2, line)) return (uint32_t)t->cfg.l2_lat;
+    t->stats.l2_misses++;
+    return (uint32_t)(t->cfg.l2_lat + t->cfg.mem_lat);
+}
+
+// ---------------------------------------------------------------------------
+// Branch prediction
+// ---------------------------------------------------------------------------
+
+static uint32_t pow2_floor(int n) {
+    uint32_t p = 1;
+    while ((int)(p * 2) <= n) p *= 2;
+    return p;
+}
+
+static inline int is_link(int r) {
+    return r == 1 || r == 5;
+}
+
+// Returns 1 when the front end would have fetched the wrong path
+static int predict(rv_timing_t *t, const rv_exec_t *e) {
+    const rv_insn_t *in = e->insn;
+    int wrong = 0;
+
+    if (in->cls == RV_CLS_BRANCH) {
+        uint32_t idx = ((uint32_t)(e->pc >> 1) ^ t->history) & t->bp_mask;
+        int predicted = t->counters[idx] >= 2;
+        wrong = predicted != e->taken;
+        if (e->taken && t->counters[idx] < 3) t->counters[idx]++;
+        if (!e->taken && t->counters[idx] > 0) t->counters[idx]--;
+        t->history = ((t->history << 1) | e->taken) & t->bp_mask;
+        t->stats.branches++;
+    } else if (in->cls == RV_CLS_JUMP) {
+        if (is_link(in->rd) && t->ras_depth) {
+            t->ras_top = (t->ras_top + 1) % t->ras_depth;
+            t->ras[t->ras_top] = e->pc + in->len;
+        }
+    } else if (in->cls == RV_CLS_JUMPR) {
+        uint64_t guess = 0;
+        int is_return = in->rd == 0 && is_link(in->rs1);
+        if (is_return && t->ras_depth) {
+            guess = t->ras[t->ras_top];
+            t->ras_top = (t->ras_top + t->ras_depth - 1) % t->ras_depth;
+        } else {
+            uint32_t idx = (uint32_t)(e->pc >> 1) & t->btb_mask;
+            if (t->btb_pc[idx] == e->pc) guess = t->btb_target[idx];
+            t->btb_pc[idx] = e->pc;
+            t->btb_target[idx] = e->next_pc;
+        }
+        if (is_link(in->rd) && t->ras_depth) {
+            t->ras_top = (t->ras_top + 1) % t->ras_depth;
+            t->ras[t->ras_top] = e->pc + in->len;
+        }
+        wrong = guess != e->next_pc;
+        t->stats.branches++;
+    }
+    if (wrong) t->stats.mispredicts++;
+    return wrong;
+}
+
+// ---------------------------------------------------------------------------
+// Latencies
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    uint32_t base, mem, cap;        // Result latency split by cause
+    uint32_t miss;                  // Data-cache miss penalty included in mem
+} latency_t;
+
+static latency_t latency(rv_timing_t *t, const rv_exec_t *e) {
+    const rv_config_t *cfg = &t->cfg;
+    const rv_insn_t *in = e->insn;
+    latency_t l = { (uint32_t)cfg->lat_alu, 0, 0, 0 };
+
+    switch ((rv_class_t)in->cls) {
+    case RV_CLS_MUL: l.base = (uint32_t)cfg->lat_mul; break;
+    case RV_CLS_DIV: l.base = (uint32_t)cfg->lat_div; break;
+    case RV_CLS_SYSTEM: l.base = (uint32_t)cfg->lat_csr; break;
+    case RV_CLS_FP: l.base = (uint32_t)cfg->lat_fp; break;
+    case RV_CLS_CAP: l.base = 0; l.cap = (uint32_t)cfg->cap_alu; break;
+    case RV_CLS_CAP_BOUNDS: l.base = 0; l.cap = (uint32_t)cfg->cap_bounds; break;
+    case RV_CLS_CAP_INSPECT: l.base = 0; l.cap = (uint32_t)cfg->cap_inspect; break;
+    case RV_CLS_LOAD: case RV_CLS_AMO: case RV_CLS_CAP_LOAD:
+    case RV_CLS_STORE: case RV_CLS_CAP_STORE: {
+        int load = in->cls == RV_CLS_LOAD || in->cls == RV_CLS_AMO || in->cls == RV_CLS_CAP_LOAD;
+        t->stats.l1d_accesses++;
+        l.miss = miss_penalty(t, &t->l1d, e->mem_addr, &t->stats.l1d_misses);
+        if (in->mem_size > 1 && ((e->mem_addr + in->mem_size - 1) >> t->line_bits) != (e->mem_addr >> t->line_bits))
+            l.miss += miss_penalty(t, &t->l1d, e->mem_addr + in->mem_size - 1, &t->stats.l1d_misses);
+        l.base = 1;
+        if (load) {
+            l.mem = (uint32_t)cfg->lat_load - 1 + l.miss;
+            if (e->cap_checked) l.cap += (uint32_t)cfg->cap_check;
+            if (in->cls == RV_CLS_CAP_LOAD) l.cap += (uint32_t)cfg->cap_load;
+        } else {
+            l.mem = l.miss;
+        }
+        break;
+    }
+    default:
+        break;
+    }
+    return l;
+}
+
+static ready_t result(uint64_t start, rv_cpi_t start_cause, const latency_t *l, int cap_class) {
+    ready_t r = ready_at(start + l->base + l->mem + l->cap, start_cause);
+    r.part[cap_class ? RV_CPI_CAPABILITY : RV_CPI_BASE] += l->base;
+    r.part[RV_CPI_MEMORY] += l->mem;
+    r.part[RV_CPI_CAPABILITY] += l->cap;
+    return r;
+}
+
+static int is_cap_jump(const rv_exec_t *e, const rv_insn_t *in) {
+    return in->op == RV_OP_CJALR || (in->op == RV_OP_JALR && e->capmode);
+}
+
+// The decoder leaves rs2 zero for instructions without a second source
+static inline int reads_rs1(const rv_insn_t *in) {
+    return in->rs1 && !(in->op >= RV_OP_CSRRWI && in->op <= RV_OP_CSRRCI);
+}
+
+// ---------------------------------------------------------------------------
+// In-order pipeline
+// ---------------------------------------------------------------------------
+
+static void account_inorder(rv_timing_t *t, const rv_exec_t *e, int region) {
+    const rv_config_t *cfg = &t->cfg;
+    const rv_insn_t *in = e->insn;
+    int cap_class = rv_is_cap_class((rv_class_t)in->cls);
+    uint64_t ideal = t->count ? t->last_issue + 1 : 0;
+
+    // Instruction fetch: a new line may miss in the I-cache
+    ready_t front = t->front;
+    if (front.time < ideal) front = ready_at(ideal, RV_CPI_BASE);
+    uint64_t fetch_line = e->pc >> t->line_bits;
+    if (fetch_line != t->last_fetch_line) {
+        uint32_t pen = miss_penalty(t, &t->l1i, e->pc, &t->stats.l1i_misses);
+        t->last_fetch_line = fetch_line;
+        if (pen) {
+            front.time += pen;
+            front.part[RV_CPI_MEMORY] += pen;
+        }
+    }
+
+    const ready_t *bind = &front;
+    if (reads_rs1(in)) bind = later(bind, &t->reg[in->rs1]);
+    if (in->rs2) bind = later(bind, &t->reg[in->rs2]);
+    if (rv_insn_rs3(in)) bind = later(bind, &t->reg[rv_insn_rs3(in)]);
+    if (in->cls == RV_CLS_DIV) bind = later(bind, &t->div_free);
+
+    uint64_t issue = bind->time > ideal ? bind->time : ideal;
+    if (issue > ideal) charge_stall(t, region, issue - ideal, bind);
+    charge(t, region, cap_class ? RV_CPI_CAPABILITY : RV_CPI_BASE, 1);
+
+    rv_cpi_t cause = issue > ideal ? dominant(bind) : RV_CPI_BASE;
+    latency_t l = latency(t, e);
+    if (in->rd)
+        t->reg[in->rd] = result(issue, cause, &l, cap_class);
+    if (in->cls == RV_CLS_DIV) {
+        t->div_free = ready_at(issue + l.base, RV_CPI_BASE);
+        t->div_free.part[RV_CPI_BASE] = l.base - 1;
+    }
+
+    // What holds up the next instruction: blocking misses, capability stores, redirects
+    t->front = ready_at(issue + 1, RV_CPI_BASE);
+    if (l.miss) {
+        t->front.time += l.miss;
+        t->front.part[RV_CPI_MEMORY] += l.miss;
+    }
+    if (in->cls == RV_CLS_CAP_STORE && cfg->cap_store) {
+        t->front.time += (uint64_t)cfg->cap_store;
+        t->front.part[RV_CPI_CAPABILITY] += (uint32_t)cfg->cap_store;
+    }
+    if (predict(t, e)) {
+        t->front.time += (uint64_t)cfg->mispredict;
+        t->front.part[RV_CPI_BRANCH] += (uint32_t)cfg->mispredict;
+    }
+    if (is_cap_jump(e, in) && cfg->cap_jump) {
+        t->front.time += (uint64_t)cfg->cap_jump;
+        t->front.part[RV_CPI_CAPABILITY] += (uint32_t)cfg->cap_jump;
+    }
+
+    t->last_issue = issue;
+    t->clock = issue;
+}
+
+// ---------------------------------------------------------------------------
+// Out-of-order pipeline
+// ---------------------------------------------------------------------------
+
+static uint64_t issue_slot(rv_timing_t *t, uint64_t cycle) {
+    for (;; cycle++) {
+        slot_t *s = &t->issue_slots[cycle & (ISSUE_WINDOW - 1)];
+        if (s->cycle != cycle) {
+            s->cycle = cycle;
+            s->count = 0;
+        }
+        if (s->count < (uint32_t)t->cfg.width) {
+            s->count++;
+            return cycle;
+        }
+    }
+}
+
+static void account_ooo(rv_timing_t *t, const rv_exec_t *e, int region) {
+    const rv_config_t *cfg = &t->cfg;
+    const rv_insn_t *in = e->insn;
+    int cap_class = rv_is_cap_class((rv_class_t)in->cls);
+    int is_mem = in->mem_size != 0;
+    int loads = in->cls == RV_CLS_LOAD || in->cls == RV_CLS_CAP_LOAD || in->cls == RV_CLS_AMO;
+    int is_store = is_mem && !loads;
+    uint32_t width = (uint32_t)cfg->width;
+
+    // Fetch, up to width per cycle and ending a group at a taken transfer
+    ready_t fetch = t->front;
+    if (fetch.time <= t->fetch_cycle) {
+        fetch = ready_at(t->fetch_cycle, RV_CPI_BASE);
+        if (t->fetch_count >= width) fetch.time++;
+    }
+    if (fetch.time != t->fetch_cycle) t->fetch_count = 0;
+    uint64_t fetch_line = e->pc >> t->line_bits;
+    if (fetch_line != t->last_fetch_line) {
+        uint32_t pen = miss_penalty(t, &t->l1i, e->pc, &t->stats.l1i_misses);
+        t->last_fetch_line = fetch_line;
+        if (pen) {
+            fetch.time += pen;
+            fetch.part[RV_CPI_MEMORY] += pen;
+            t->fetch_count = 0;
+        }
+    }
+    t->fetch_cycle = fetch.time;
+    t->fetch_count++;
+    if (e->taken) t->fetch_count = width;
+
+    // Dispatch into the ROB and, for memory operations, the LSQ and store buffer
+    ready_t dispatch = fetch;
+    dispatch.time += (uint64_t)cfg->frontend;
+    const ready_t *bind = &dispatch;
+    const ready_t *rob_slot = &t->rob_ring[t->count % (uint64_t)cfg->rob];
+    bind = later(bind, rob_slot);
+    if (is_mem) bind = later(bind, &t->lsq_ring[t->lsq_count % (uint64_t)cfg->lsq]);
+    if (is_store) bind = later(bind, &t->sb_ring[t->sb_count % (uint64_t)cfg->sb]);
+    ready_t disp = *bind;
+    if (disp.time < t->dispatch_cycle) disp = ready_at(t->dispatch_cycle, RV_CPI_BASE);
+    if (disp.time == t->dispatch_cycle && t->dispatch_count >= width) disp = ready_at(disp.time + 1, RV_CPI_BASE);
+    if (disp.time != t->dispatch_cycle) t->dispatch_count = 0;
+    t->dispatch_cycle = disp.time;
+    t->dispatch_count++;
+
+    // Issue once operands are ready and a slot is free
+    ready_t earliest = disp;
+    earliest.time++;
+    bind = &earliest;
+    if (reads_rs1(in)) bind = later(bind, &t->reg[in->rs1]);
+    if (in->rs2) bind = later(bind, &t->reg[in->rs2]);
+    if (rv_insn_rs3(in)) bind = later(bind, &t->reg[rv_insn_rs3(in)]);
+    if (in->cls == RV_CLS_DIV) bind = later(bind, &t->div_free);
+    size_t st = (size_t)(e->mem_addr >> 3) & (STORE_TABLE - 1);
+    if (loads && t->stores[st].addr == (e->mem_addr >> 3)) bind = later(bind, &t->stores[st].data);
+    uint64_t issue = issue_slot(t, bind->time);
+    rv_cpi_t cause = dominant(bind);
+
+    latency_t l = latency(t, e);
+    uint32_t store_miss = 0;
+    if (is_store) {
+        // Stores complete into the store buffer and pay their miss when they drain
+        store_miss = l.miss;
+        l.mem = 0;
+        l.miss = 0;
+    }
+    ready_t complete = result(issue, cause, &l, cap_class);
+    if (in->rd)
+        t->reg[in->rd] = complete;
+    if (in->cls == RV_CLS_DIV) {
+        t->div_free = ready_at(issue + l.base, RV_CPI_BASE);
+        t->div_free.part[RV_CPI_BASE] = l.base - 1;
+    }
+    if (is_store) {
+        t->stores[st].addr = e->mem_addr >> 3;
+        t->stores[st].data = complete;
+    }
+
+    // Redirects
+    t->front = ready_at(0, RV_CPI_BASE);
+    if (predict(t, e)) {
+        t->front = ready_at(complete.time + (uint64_t)cfg->mispredict, RV_CPI_BASE);
+        t->front.part[RV_CPI_BRANCH] = (uint32_t)(t->front.time - fetch.time);
+    }
+    if (is_cap_jump(e, in) && cfg->cap_jump) {
+        uint64_t when = fetch.time + 1 + (uint64_t)cfg->cap_jump;
+        if (when > t->front.time) {
+            t->front = ready_at(when, RV_CPI_BASE);
+            t->front.part[RV_CPI_CAPABILITY] = (uint32_t)cfg->cap_jump;
+        }
+    }
+
+    // Retire in order, width per cycle
+    uint64_t retire = complete.time + 1;
+    if (retire < t->retire_cycle) retire = t->retire_cycle;
+    if (retire == t->retire_cycle && t->retire_count >= width) retire++;
+    uint64_t gap = t->count ? retire - t->retire_cycle : retire;
+    if (gap) {
+        ready_t tail = complete;
+        tail.time++;
+        charge(t, region, cap_class ? RV_CPI_CAPABILITY : RV_CPI_BASE, 1);
+        if (gap > 1) charge_stall(t, region, gap - 1, &tail);
+        t->retire_count = 0;
+    }
+    t->retire_cycle = retire;
+    t->retire_count++;
+
+    ready_t held = complete;
+    held.time = retire;
+    t->rob_ring[t->count % (uint64_t)cfg->rob] = held;
+    if (is_mem) t->lsq_ring[t->lsq_count++ % (uint64_t)cfg->lsq] = held;
+    if (is_store) {
+        // One store leaves per cycle, in order; a miss holds its entry and those behind it
+        uint64_t drained = retire + 1 + store_miss;
+        if (drained <= t->sb_drained) drained = t->sb_drained + 1;
+        t->sb_drained = drained;
+        t->sb_ring[t->sb_count++ % (uint64_t)cfg->sb] = ready_at(drained, RV_CPI_MEMORY);
+    }
+    t->clock = retire;
+}
+
+// ---------------------------------------------------------------------------
+// Interface
+// ---------------------------------------------------------------------------
+
+rv_timing_t *rv_timing_create(const rv_config_t *cfg) {
+    rv_timing_t *t = calloc(1, sizeof(*t));
+    if (!t) return NULL;
+    t->cfg = *cfg;
+    while ((1 << t->line_bits) < cfg->line) t->line_bits++;
+    t->last_fetch_line = UINT64_MAX;
+
+    int ok = cache_init(&t->l1i, cfg->l1i_size, cfg->l1i_assoc, 1 << t->line_bits) == 0 &&
+             cache_init(&t->l1d, cfg->l1d_size, cfg->l1d_assoc, 1 << t->line_bits) == 0 &&
+             cache_init(&t->l2, cfg->l2_size, cfg->l2_assoc, 1 << t->line_bits) == 0;
+
+    t->bp_mask = pow2_floor(cfg->bp_entries) - 1;
+    t->counters = malloc(t->bp_mask + 1);
+    t->btb_mask = pow2_floor(cfg->btb_entries) - 1;
+    t->btb_pc = calloc(t->btb_mask + 1, sizeof(*t->btb_pc));
+    t->btb_target = calloc(t->btb_mask + 1, sizeof(*t->btb_target));
+    t->ras_depth = cfg->ras;
+    t->ras = calloc(cfg->ras ? (size_t)cfg->ras : 1, sizeof(*t->ras));
+    t->rob_ring = calloc((size_t)cfg->rob, sizeof(*t->rob_ring));
+    t->lsq_ring = calloc((size_t)cfg->lsq, sizeof(*t->lsq_ring));
+    t->sb_ring = calloc((size_t)cfg->sb, sizeof(*t->sb_ring));
+    t->issue_slots = calloc(ISSUE_WINDOW, sizeof(*t->issue_slots));
+    if (!ok || !t->counters || !t->btb_pc || !t->btb_target || !t->ras || !t->rob_ring ||
+        !t->lsq_ring || !t->sb_ring || !t->issue_slots) {
+        rv_timing_free(t);
+        return NULL;
+    }
+    memset(t->counters, 1, t->bp_mask + 1);     // Weakly not-taken
+    for (size_t i = 0; i < STORE_TABLE; i++) t->stores[i].addr = UINT64_MAX;
+    for (size_t i = 0; i < ISSUE_WINDOW; i++) t->issue_slots[i].cycle = UINT64_MAX;
+    return t;
+}
+
+void rv_timing_free(rv_timing_t *t) {
+    if (!t) return;
+    cache_free(&t->l1i);
+    cache_free(&t->l1d);
+    cache_free(&t->l2);
+    free(t->counters);
+    free(t->btb_pc);
+    free(t->btb_target);
+    free(t->ras);
+    free(t->rob_ring);
+    free(t->lsq_ring);
+    free(t->sb_ring);
+    free(t->issue_slots);
+    free(t);
+}
+
+void rv_timing_account(rv_timing_t *t, const rv_exec_t *e, int region) {
+    if (region >= RV_MAX_REGIONS_TRACKED) region = RV_MAX_REGIONS_TRACKED - 1;
+    if (t->cfg.core == RV_CORE_OOO) account_ooo(t, e, region);
+    else account_inorder(t, e, region);
+
+    int cap = rv_is_cap_class((rv_class_t)e->insn->cls);
+    t->count++;
+    t->stats.instructions++;
+    t->stats.cap_instructions += (uint64_t)cap;
+    if (region >= 0) {
+        t->stats.regions[region].instructions++;
+        t->stats.regions[region].cap_instructions += (uint64_t)cap;
+        if (region >= t->stats.region_count) t->stats.region_count = region + 1;
+    }
+}
+
+const uint64_t *rv_timing_clock(const rv_timing_t *t) {
+    return &t->clock;
+}
+
+void rv_timing_finish(rv_timing_t *t, rv_stats_t *stats) {
+    *stats = t->stats;
+}
@@ -0,0 +1,263 @@
+/*
+ * Binary Logging - Deferred printf for measured loops
+ *
+ * BINLOG(fmt, ...) does not format anything. It appends a record (format
+ * string ID plus the raw arguments) to a lock-free ring owned by the
+ * calling thread, so a log call in a timed loop costs a few stores instead
+ * of a printf. Each thread is the single producer of its ring; the rings
+ * sit on a lock-free list that binlog_flush() walks as the single
+ * consumer, formatting records and printing them outside the timed region.
+ * Records are printed per thread in the order they were logged.
+ *
+ * Supported conversions: d i u x X o c (with hh h l ll z j t), e f g a,
+ * p (printed as an address) and s (copied into the record, truncated to
+ * BINLOG_MAX_STRING bytes). Width and precision must be literal (no '*').
+ * A full ring drops the record and counts it instead of blocking.
+ */
+
+#ifndef BINLOG_H
+#define BINLOG_H
+
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BINLOG_RING_WORDS   (1 << 16)   // Per thread, 512 KB
+#define BINLOG_MAX_ARGS     8
+#define BINLOG_MAX_SITES    1024
+#define BINLOG_MAX_STRING   64
+#define BINLOG_SITE_PENDING UINT32_MAX         // Being registered by another thread
+#define BINLOG_SITE_INVALID (UINT32_MAX - 1)   // Unsupported format or table full
+
+// Argument classes, i.e. how the producer reads each argument
+enum {
+    BINLOG_ARG_INT = 1, BINLOG_ARG_LONG, BINLOG_ARG_LLONG, BINLOG_ARG_SIZE,
+    BINLOG_ARG_MAX, BINLOG_ARG_PTRDIFF, BINLOG_ARG_DOUBLE, BINLOG_ARG_PTR, BINLOG_ARG_STRING
+};
+
+// One per BINLOG() call site, parsed on first use
+typedef struct {
+    const char *fmt;
+    _Atomic uint32_t id;                // 0 until registered
+    uint8_t nargs;
+    uint8_t types[BINLOG_MAX_ARGS];
+} binlog_site_t;
+
+// Single-producer ring of 64-bit words; record = header word + argument words
+typedef struct binlog_ring {
+    _Atomic uint64_t head;              // Written by the owning thread
+    _Atomic uint64_t tail;              // Written by the consumer
+    _Atomic uint64_t dropped;           // Written by the owning thread
+    uint64_t dropped_reported;          // Consumer's copy
+    struct binlog_ring *next;
+    uint64_t words[BINLOG_RING_WORDS];
+} binlog_ring_t;
+
+static binlog_site_t *binlog_sites[BINLOG_MAX_SITES + 1];
+static _Atomic uint32_t binlog_site_count;
+static _Atomic(binlog_ring_t *) binlog_rings;
+static __thread binlog_ring_t *binlog_local;
+
+// Classify the conversions of fmt; returns -1 if one is unsupported
+static inline int binlog_parse(const char *fmt, uint8_t *types) {
+    int n = 0;
+    for (const char *p = fmt; *p; p++) {
+        if (*p != '%') continue;
+        p++;
+        if (*p == '%') continue;
+        while (*p && strchr("-+ #0123456789.", *p)) p++;
+        int length = 0;     // 0 int, 1 l, 2 ll, 3 z, 4 j, 5 t
+        if (*p == 'h') { p++; if (*p == 'h') p++; }
+        else if (*p == 'l') { p++; length = 1; if (*p == 'l') { p++; length = 2; } }
+        else if (*p == 'z') { p++; length = 3; }
+        else if (*p == 'j') { p++; length = 4; }
+        else if (*p == 't') { p++; length = 5; }
+        if (!*p || n == BINLOG_MAX_ARGS) return -1;
+        static const uint8_t integer[] = {
+            BINLOG_ARG_INT, BINLOG_ARG_LONG, BINLOG_ARG_LLONG, BINLOG_ARG_SIZE, BINLOG_ARG_MAX, BINLOG_ARG_PTRDIFF
+        };
+        if (strchr("diuxXoc", *p)) types[n++] = integer[length];
+        else if (strchr("eEfFgGaA", *p) && length == 0) types[n++] = BINLOG_ARG_DOUBLE;
+        else if (*p == 'p') types[n++] = BINLOG_ARG_PTR;
+        else if (*p == 's' && length == 0) types[n++] = BINLOG_ARG_STRING;
+        else return -1;
+    }
+    return n;
+}
+
+// Give the site an ID; concurrent first uses wait for the winner
+static inline uint32_t binlog_register(binlog_site_t *site) {
+    uint32_t id = 0;
+    if (atomic_compare_exchange_strong(&site->id, &id, BINLOG_SITE_PENDING)) {
+        int n = binlog_parse(site->fmt, site->types);
+        site->nargs = (uint8_t)(n < 0 ? 0 : n);
+        id = atomic_fetch_add(&binlog_site_count, 1) + 1;
+        if (n < 0 || id > BINLOG_MAX_SITES) {
+            id = BINLOG_SITE_INVALID;
+        } else {
+            binlog_sites[id] = site;
+        }
+        atomic_store_explicit(&site->id, id, memory_order_release);
+        return id;
+    }
+    while ((id = atomic_load_explicit(&site->id, memory_order_acquire)) == BINLOG_SITE_PENDING) {
+    }
+    return id;
+}
+
+// The calling thread's ring, created and published on first use
+static inline binlog_ring_t *binlog_ring(void) {
+    binlog_ring_t *ring = calloc(1, sizeof(binlog_ring_t));
+    if (!ring) return NULL;
+    ring->next = atomic_load(&binlog_rings);
+    while (!atomic_compare_exchange_weak(&binlog_rings, &ring->next, ring)) {
+    }
+    binlog_local = ring;
+    return ring;
+}
+
+static inline void binlog_write(binlog_site_t *site, ...) {
+    uint32_t id = atomic_load_explicit(&site->id, memory_order_acquire);
+    if (id == 0 || id == BINLOG_SITE_PENDING) id = binlog_register(site);
+    binlog_ring_t *ring = binlog_local ? binlog_local : binlog_ring();
+    if (!ring) return;
+    if (id == BINLOG_SITE_INVALID) {
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    // Worst case: every argument a maximal string
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    size_t need = 1 + (size_t)site->nargs * (1 + BINLOG_MAX_STRING / 8);
+    if (BINLOG_RING_WORDS - (head - tail) < need) {
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        return;
+    }
+
+    uint64_t *w = ring->words;
+    const uint64_t mask = BINLOG_RING_WORDS - 1;
+    uint64_t pos = head + 1;
+    va_list ap;
+    va_start(ap, site);
+    for (int i = 0; i < site->nargs; i++) {
+        uint64_t v;
+        switch (site->types[i]) {
+        case BINLOG_ARG_INT:     v = (uint64_t)(int64_t)va_arg(ap, int); break;
+        case BINLOG_ARG_LONG:    v = (uint64_t)va_arg(ap, long); break;
+        case BINLOG_ARG_LLONG:   v = (uint64_t)va_arg(ap, long long); break;
+        case BINLOG_ARG_SIZE:    v = (uint64_t)va_arg(ap, size_t); break;
+        case BINLOG_ARG_MAX:     v = (uint64_t)va_arg(ap, intmax_t); break;
+        case BINLOG_ARG_PTRDIFF: v = (uint64_t)va_arg(ap, ptrdiff_t); break;
+        case BINLOG_ARG_PTR:     v = (uint64_t)(uintptr_t)va_arg(ap, void *); break;
+        case BINLOG_ARG_DOUBLE: {
+            double d = va_arg(ap, double);
+            memcpy(&v, &d, sizeof(v));
+            break;
+        }
+        default: {
+            // Length word, then the bytes packed into following words
+            const char *s = va_arg(ap, const char *);
+            size_t len = s ? strnlen(s, BINLOG_MAX_STRING) : 0;
+            w[pos++ & mask] = len;
+            for (size_t off = 0; off < len; off += 8) {
+                uint64_t chunk = 0;
+                memcpy(&chunk, s + off, len - off < 8 ? len - off : 8);
+                w[pos++ & mask] = chunk;
+            }
+            continue;
+        }
+        }
+        w[pos++ & mask] = v;
+    }
+    va_end(ap);
+    w[head & mask] = (uint64_t)id | (pos - head) << 32;
+    atomic_store_explicit(&ring->head, pos, memory_order_release);
+}
+
+#define BINLOG(fmt, ...) do {                                   \
+        static binlog_site_t binlog_site_ = { fmt, 0, 0, { 0 } };  \
+        binlog_write(&binlog_site_, ##__VA_ARGS__);             \
+    } while (0)
+
+// Print one record; pos is the word after its header
+static inline void binlog_format(FILE *out, const binlog_site_t *site, const uint64_t *w, uint64_t pos) {
+    const uint64_t mask = BINLOG_RING_WORDS - 1;
+    char spec[32];
+    int arg = 0;
+    for (const char *p = site->fmt; *p; p++) {
+        if (*p != '%') {
+            fputc(*p, out);
+            continue;
+        }
+        if (p[1] == '%') {
+            fputc('%', out);
+            p++;
+            continue;
+        }
+        // Copy the conversion spec, which binlog_parse() has already vetted
+        size_t len = strcspn(p + 1, "diuxXocCeEfFgGaApsS") + 2;
+        if (len >= sizeof(spec)) len = sizeof(spec) - 1;
+        memcpy(spec, p, len);
+        spec[len] = '\0';
+        p += len - 1;
+
+        uint64_t v = w[pos++ & mask];
+        switch (site->types[arg++]) {
+        case BINLOG_ARG_INT:     fprintf(out, spec, (int)v); break;
+        case BINLOG_ARG_LONG:    fprintf(out, spec, (long)v); break;
+        case BINLOG_ARG_LLONG:   fprintf(out, spec, (long long)v); break;
+        case BINLOG_ARG_SIZE:    fprintf(out, spec, (size_t)v); break;
+        case BINLOG_ARG_MAX:     fprintf(out, spec, (intmax_t)v); break;
+        case BINLOG_ARG_PTRDIFF: fprintf(out, spec, (ptrdiff_t)v); break;
+        case BINLOG_ARG_PTR:     fprintf(out, "0x%llx", (unsigned long long)v); break;
+        case BINLOG_ARG_DOUBLE: {
+            double d;
+            memcpy(&d, &v, sizeof(d));
+            fprintf(out, spec, d);
+            break;
+        }
+        default: {
+            char text[BINLOG_MAX_STRING + 8];
+            for (size_t off = 0; off < v; off += 8) {
+                uint64_t chunk = w[pos++ & mask];
+                memcpy(text + off, &chunk, 8);
+            }
+            text[v] = '\0';
+            fprintf(out, spec, text);
+            break;
+        }
+        }
+    }
+}
+
+// Format every pending record of every thread (discard them if out is NULL);
+// returns the number of records consumed
+static inline size_t binlog_flush(FILE *out) {
+    size_t printed = 0;
+    for (binlog_ring_t *ring = atomic_load(&binlog_rings); ring; ring = ring->next) {
+        uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+        while (tail != head) {
+            uint64_t header = ring->words[tail & (BINLOG_RING_WORDS - 1)];
+            if (out) binlog_format(out, binlog_sites[(uint32_t)header], ring->words, tail + 1);
+            tail += header >> 32;
+            printed++;
+        }
+        atomic_store_explicit(&ring->tail, tail, memory_order_release);
+        uint64_t dropped = atomic_load_explicit(&ring->dropped, memory_order_relaxed);
+        if (out && dropped != ring->dropped_reported) {
+            fprintf(out, "[binlog: %llu records dropped]\n",
+                    (unsigned long long)(dropped - ring->dropped_reported));
+            ring->dropped_reported = dropped;
+        }
+    }
+    if (out) fflush(out);
+    return printed;
+}
+
+#endif // BINLOG_H
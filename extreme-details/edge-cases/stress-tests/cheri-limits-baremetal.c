@@ -4,6 +4,8 @@
  * This test pushes CHERI to its limits without requiring standard library
  */
 
+#include "baremetal.h"
+
 #ifdef __CHERI__
 #include <cheriintrin.h>
 typedef void* __capability cap_ptr_t;
@@ -14,14 +16,14 @@ typedef void* cap_ptr_t;
 #define cheri_tag_get(cap) 1
 #endif
 
-// Bare metal heap simulation
-static char heap_memory[8192];
+// Bare metal heap from the runtime's linker script
 static int heap_offset = 0;
 
 // Simple malloc replacement
 void* simple_malloc(int size) {
-    if (heap_offset + size >= 8192) return 0;
-    void* ptr = &heap_memory[heap_offset];
+    size = (size + (int)sizeof(void*) - 1) & ~((int)sizeof(void*) - 1);
+    if ((unsigned long)(heap_offset + size) >= bm_heap_size) return 0;
+    void* ptr = &bm_heap[heap_offset];
     heap_offset += size;
     return ptr;
 }
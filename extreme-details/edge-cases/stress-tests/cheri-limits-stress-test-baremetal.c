@@ -7,6 +7,8 @@
 
 #include <stdint.h>
 
+#include "baremetal.h"
+
 // Define size_t for bare-metal
 typedef unsigned long size_t;
 
@@ -37,14 +39,16 @@ void simple_print(const char* str) {
 }
 
 void* simple_malloc(size_t size) {
-    static char heap[1024 * 1024]; // 1MB heap
     static size_t heap_pos = 0;
     
-    if (heap_pos + size > sizeof(heap)) {
+    // Align for pointers (16-byte capabilities under CHERI)
+    size = (size + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+    
+    if (heap_pos + size > bm_heap_size) {
         return (void*)0; // NULL
     }
     
-    void* ptr = &heap[heap_pos];
+    void* ptr = &bm_heap[heap_pos];
     heap_pos += size;
     return ptr;
 }
@@ -287,13 +291,3 @@ int main() {
     
     return 0;
 }
-
-// Entry point for bare-metal
-void _start() {
-    main();
-    
-    // Infinite loop to prevent return
-    while (1) {
-        asm volatile("nop");
-    }
-}
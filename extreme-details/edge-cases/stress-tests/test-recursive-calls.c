@@ -7,19 +7,24 @@
 #include <string.h>
 #include <signal.h>
 #include <setjmp.h>
+#include <time.h>
+
+#include "binlog.h"
 
 // Global variables for tracking recursion
 static int max_depth = 0;
 static int current_depth = 0;
-static jmp_buf recovery_point;
+static sigjmp_buf recovery_point;
+static char handler_stack[64 * 1024];  // The overflowed stack cannot run the handler
 static volatile int stack_overflow_detected = 0;
 
 // Signal handler for segmentation faults (stack overflow)
 void segfault_handler(int sig) {
     stack_overflow_detected = 1;
-    printf("\nStack overflow detected at depth %d!\n", current_depth);
-    printf("Maximum safe depth reached: %d\n", max_depth);
-    longjmp(recovery_point, 1);
+    // Logged rather than printed, so it lands after the records already pending
+    BINLOG("\nStack overflow detected at depth %d!\n", current_depth);
+    BINLOG("Maximum safe depth reached: %d\n", max_depth);
+    siglongjmp(recovery_point, 1);  // Also unblocks SIGSEGV for the next test
 }
 
 // Simple recursive function with small stack frame
@@ -32,9 +37,9 @@ int simple_recursion(int depth) {
     // Small local variables
     int local_var = depth;
     
-    // Print progress every 1000 calls
+    // Log progress every 1000 calls (formatted after the test, see binlog.h)
     if (depth % 1000 == 0) {
-        printf("Recursion depth: %d, stack local at: %p\n", depth, &local_var);
+        BINLOG("Recursion depth: %d, stack local at: %p\n", depth, &local_var);
     }
     
     // Recurse deeper
@@ -59,9 +64,9 @@ int large_frame_recursion(int depth) {
         locals[i] = depth * 3.14159 * i;
     }
     
-    // Print progress every 100 calls (more frequent due to larger frames)
+    // Log progress every 100 calls (more frequent due to larger frames)
     if (depth % 100 == 0) {
-        printf("Large frame depth: %d, buffer at: %p, locals at: %p\n", 
+        BINLOG("Large frame depth: %d, buffer at: %p, locals at: %p\n", 
                depth, large_buffer, locals);
     }
     
@@ -83,7 +88,7 @@ int heap_allocating_recursion(int depth) {
     // Allocate heap memory at each level
     char *heap_data = malloc(512);
     if (!heap_data) {
-        printf("Heap allocation failed at depth %d\n", depth);
+        BINLOG("Heap allocation failed at depth %d\n", depth);
         return depth;
     }
     
@@ -97,7 +102,7 @@ int heap_allocating_recursion(int depth) {
     }
     
     if (depth % 500 == 0) {
-        printf("Heap+Stack depth: %d, heap: %p, stack: %p\n", 
+        BINLOG("Heap+Stack depth: %d, heap: %p, stack: %p\n", 
                depth, heap_data, stack_locals);
     }
     
@@ -124,7 +129,7 @@ int function_a(int depth) {
     sprintf(buffer_a, "Function A at depth %d", depth);
     
     if (depth % 1000 == 0) {
-        printf("Function A depth: %d, buffer at: %p\n", depth, buffer_a);
+        BINLOG("Function A depth: %d, buffer at: %p\n", depth, buffer_a);
     }
     
     return function_b(depth + 1) + strlen(buffer_a);
@@ -141,7 +146,7 @@ int function_b(int depth) {
     buffer_b[511] = '\0';
     
     if (depth % 1000 == 0) {
-        printf("Function B depth: %d, buffer at: %p\n", depth, buffer_b);
+        BINLOG("Function B depth: %d, buffer at: %p\n", depth, buffer_b);
     }
     
     return function_a(depth + 1) + (int)strlen(buffer_b);
@@ -155,13 +160,15 @@ void test_call_chain_patterns() {
     printf("Test 1: Simple tail recursion simulation\n");
     for (int i = 0; i < 10000; i++) {
         if (i % 2000 == 0) {
-            printf("Simulated tail call iteration: %d\n", i);
+            BINLOG("Simulated tail call iteration: %d\n", i);
         }
         // Simulate work without actual recursion
         volatile int work = i * 2 + 1;
         (void)work; // Prevent optimization
     }
     
+    binlog_flush(stdout);
+    
     // Test 2: Call stack with varying frame sizes
     printf("\nTest 2: Varying frame sizes\n");
     void (*test_functions[])(int) = {
@@ -172,7 +179,7 @@ void test_call_chain_patterns() {
     // Alternate between different frame sizes
     for (int i = 0; i < 100; i++) {
         int func_idx = i % 2;
-        printf("Calling function %d at iteration %d\n", func_idx, i);
+        BINLOG("Calling function %d at iteration %d\n", func_idx, i);
         
         // Simulate call with controlled depth to avoid overflow
         if (func_idx == 0) {
@@ -187,6 +194,7 @@ void test_call_chain_patterns() {
             (void)check;
         }
     }
+    binlog_flush(stdout);
 }
 
 // Test CHERI capability stack behavior under stress
@@ -212,7 +220,7 @@ void test_capability_stack_stress() {
         }
         
         if (level % 200 == 0) {
-            printf("Capability stress level: %d, allocated %d objects\n", level, 16);
+            BINLOG("Capability stress level: %d, allocated %d objects\n", level, 16);
         }
         
         // Free allocations
@@ -223,9 +231,55 @@ void test_capability_stack_stress() {
         }
     }
     
+    binlog_flush(stdout);
     printf("Capability stack stress test completed\n");
 }
 
+static double elapsed_ns(struct timespec start, struct timespec end) {
+    return (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+}
+
+// Cost of one progress message: binary record vs formatting it in place
+void test_logging_cost() {
+    printf("\n=== Logging Cost Per Call ===\n");
+    
+    const int batch = 10000;    // Fits in one thread's ring
+    const int rounds = 10;
+    double binlog_ns = 0, format_ns = 0, flush_ns = 0;
+    char line[128];
+    volatile size_t sink = 0;
+    struct timespec start, end;
+    
+    for (int r = 0; r < rounds; r++) {
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int i = 0; i < batch; i++) {
+            BINLOG("Recursion depth: %d, stack local at: %p\n", i, &line[i & 63]);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        binlog_ns += elapsed_ns(start, end);
+        
+        // Dropping the records here; decoding cost is the flush below
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        binlog_flush(NULL);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        flush_ns += elapsed_ns(start, end);
+        
+        // What printf spends before it even reaches stdout
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int i = 0; i < batch; i++) {
+            sink += snprintf(line, sizeof(line), "Recursion depth: %d, stack local at: %p\n", i, &line[i & 63]);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        format_ns += elapsed_ns(start, end);
+    }
+    (void)sink;
+    
+    int calls = batch * rounds;
+    printf("binlog record:       %.1f ns/call\n", binlog_ns / calls);
+    printf("binlog drain:        %.1f ns/record (outside timed loops)\n", flush_ns / calls);
+    printf("snprintf formatting: %.1f ns/call (lower bound for printf)\n", format_ns / calls);
+}
+
 // Main test function with different recursion patterns
 void run_recursion_tests() {
     printf("=== RECURSIVE FUNCTION CALL STRESS TESTS ===\n");
@@ -234,7 +288,14 @@ void run_recursion_tests() {
     printf("CHERI: Stack capability bounds should provide early detection\n\n");
     
     // Set up signal handler for stack overflow detection
-    signal(SIGSEGV, segfault_handler);
+    stack_t alt = { .ss_sp = handler_stack, .ss_size = sizeof(handler_stack), .ss_flags = 0 };
+    sigaltstack(&alt, NULL);
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = segfault_handler;
+    sa.sa_flags = SA_ONSTACK;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGSEGV, &sa, NULL);
     
     // Test 1: Simple recursion
     printf("Test 1: Simple recursion with small stack frames\n");
@@ -242,9 +303,11 @@ void run_recursion_tests() {
     current_depth = 0;
     stack_overflow_detected = 0;
     
-    if (setjmp(recovery_point) == 0) {
+    if (sigsetjmp(recovery_point, 1) == 0) {
         simple_recursion(1);
-    } else {
+    }
+    binlog_flush(stdout);
+    if (stack_overflow_detected) {
         printf("Recovered from stack overflow in simple recursion\n");
     }
     
@@ -254,9 +317,11 @@ void run_recursion_tests() {
     current_depth = 0;
     stack_overflow_detected = 0;
     
-    if (setjmp(recovery_point) == 0) {
+    if (sigsetjmp(recovery_point, 1) == 0) {
         large_frame_recursion(1);
-    } else {
+    }
+    binlog_flush(stdout);
+    if (stack_overflow_detected) {
         printf("Recovered from stack overflow in large frame recursion\n");
     }
     
@@ -266,9 +331,11 @@ void run_recursion_tests() {
     current_depth = 0;
     stack_overflow_detected = 0;
     
-    if (setjmp(recovery_point) == 0) {
+    if (sigsetjmp(recovery_point, 1) == 0) {
         heap_allocating_recursion(1);
-    } else {
+    }
+    binlog_flush(stdout);
+    if (stack_overflow_detected) {
         printf("Recovered from stack overflow in heap allocating recursion\n");
     }
     
@@ -278,15 +345,18 @@ void run_recursion_tests() {
     current_depth = 0;
     stack_overflow_detected = 0;
     
-    if (setjmp(recovery_point) == 0) {
+    if (sigsetjmp(recovery_point, 1) == 0) {
         function_a(1);
-    } else {
+    }
+    binlog_flush(stdout);
+    if (stack_overflow_detected) {
         printf("Recovered from stack overflow in mutual recursion\n");
     }
     
     // Additional tests
     test_call_chain_patterns();
     test_capability_stack_stress();
+    test_logging_cost();
 }
 
 int main() {
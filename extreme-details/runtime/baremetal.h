@@ -0,0 +1,33 @@
+/*
+ * Bare-Metal Runtime - C interface to crt0.S and baremetal.ld
+ *
+ * Tests linked with the runtime get their heap from the linker script
+ * instead of a fixed static array: bm_heap points at its first byte (a
+ * capability bounded to exactly the heap in a purecap build) and
+ * bm_heap_size is its length, set at link time with
+ * -Wl,--defsym=__heap_size=N. main()'s return value, or the code passed
+ * to bm_exit(), becomes the exit code of the QEMU or simulator run.
+ *
+ * bm_catch() arms trap recovery: it returns 0, and returns again with
+ * BM_TRAP_EXIT + mcause if a later trap (a CHERI fault, say) unwinds to it.
+ * bm_semihost() makes a semihosting call (QEMU -semihosting, rvsim).
+ */
+
+#ifndef BAREMETAL_H
+#define BAREMETAL_H
+
+#define BM_TRAP_EXIT        128     // Exit code of an unhandled trap: BM_TRAP_EXIT + mcause
+
+// Semihosting operations
+#define BM_SYS_WRITEC       0x03    // arg: the character
+#define BM_SYS_WRITE0       0x04    // arg: NUL-terminated string
+#define BM_SYS_EXIT         0x18    // arg: { reason, exit code }
+
+extern char *bm_heap;
+extern unsigned long bm_heap_size;
+
+void bm_exit(int code) __attribute__((noreturn));
+int bm_catch(void) __attribute__((returns_twice));
+long bm_semihost(long op, void *arg);
+
+#endif // BAREMETAL_H
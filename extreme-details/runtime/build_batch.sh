@@ -0,0 +1,84 @@
+#!/bin/bash
+
+# Bare-Metal Batch Image Builder
+# Links several *-baremetal tests into one image that runs them all in a
+# single boot (dispatch.c) and streams their RESULT lines over semihosting.
+#
+# Usage: build_batch.sh <output> <test.c>...
+#
+# The toolchain comes from the environment, as the Makefile passes it:
+#   CC        compiler driver (riscv64-elf-gcc, or the CHERI SDK clang)
+#   CFLAGS    flags for every source, including -I for this directory
+#   LDFLAGS   link flags, including -T baremetal.ld
+#   OBJCOPY   objcopy matching CC
+#
+# Each test's main() becomes <test>_main (dashes as underscores) and every
+# other global symbol of the test is made local, so helpers with the same
+# name in different tests do not clash.
+
+set -e
+
+# Colors for output
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+BLUE='\033[0;34m'
+NC='\033[0m' # No Color
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+
+log_info() {
+    echo -e "${BLUE}[INFO]${NC} $1"
+}
+
+log_success() {
+    echo -e "${GREEN}[SUCCESS]${NC} $1"
+}
+
+log_error() {
+    echo -e "${RED}[ERROR]${NC} $1"
+}
+
+if [ $# -lt 2 ] || [ -z "$CC" ] || [ -z "$OBJCOPY" ]; then
+    log_error "usage: CC=... OBJCOPY=... [CFLAGS=...] [LDFLAGS=...] $0 <output> <test.c>..."
+    exit 1
+fi
+
+OUTPUT="$1"
+shift
+
+WORK_DIR=$(mktemp -d)
+trap 'rm -rf "$WORK_DIR"' EXIT
+
+TABLE="$WORK_DIR/bm_tests.c"
+OBJECTS=""
+ENTRIES=""
+COUNT=0
+
+for source in "$@"; do
+    test=$(basename "$source" .c)
+    id="${test//-/_}"
+    log_info "Compiling $test"
+    $CC $CFLAGS -c "$source" -o "$WORK_DIR/$id.o"
+    $OBJCOPY --redefine-sym "main=${id}_main" --keep-global-symbol="${id}_main" "$WORK_DIR/$id.o"
+    OBJECTS="$OBJECTS $WORK_DIR/$id.o"
+    ENTRIES="$ENTRIES    { \"$test\", ${id}_main },"$'\n'
+    echo "int ${id}_main(void);" >> "$TABLE"
+    COUNT=$((COUNT + 1))
+done
+
+cat >> "$TABLE" << EOF
+
+typedef struct {
+    const char *name;
+    int (*main)(void);
+} bm_test_t;
+
+const bm_test_t bm_tests[] = {
+$ENTRIES};
+const int bm_test_count = $COUNT;
+EOF
+
+log_info "Linking $COUNT tests into $OUTPUT"
+$CC $CFLAGS -DBM_SEMIHOSTING "$SCRIPT_DIR/crt0.S" "$SCRIPT_DIR/string.c" "$SCRIPT_DIR/dispatch.c" \
+    "$TABLE" $OBJECTS $LDFLAGS -o "$OUTPUT"
+log_success "Built $OUTPUT"
@@ -0,0 +1,99 @@
+/*
+ * Bare-Metal Runtime - Dispatcher for batched test images
+ *
+ * build_batch.sh links several *-baremetal tests into one image, renaming
+ * each test's main() and listing it in bm_tests[]. This main() runs them
+ * back to back in a single boot, each under bm_catch() so a trapping test
+ * (a CHERI fault is the point of several of them) is recorded and the
+ * next one still runs. After every test one record per metric is streamed
+ * over the semihosting console, in the workloads' format:
+ *
+ *   RESULT,<test>,<riscv|cheri>,<cycles|instret|exit_status>,<value>,<unit>
+ *
+ * The image exits with the number of tests whose exit status was not 0.
+ */
+
+#include "baremetal.h"
+
+#include <stdint.h>
+
+#ifdef __CHERI_PURE_CAPABILITY__
+#define BM_ARCH "cheri"
+#else
+#define BM_ARCH "riscv"
+#endif
+
+typedef struct {
+    const char *name;
+    int (*main)(void);
+} bm_test_t;
+
+// Generated by build_batch.sh
+extern const bm_test_t bm_tests[];
+extern const int bm_test_count;
+
+static inline uint64_t read_cycles(void) {
+    uint64_t v;
+    asm volatile("rdcycle %0" : "=r"(v));
+    return v;
+}
+
+static inline uint64_t read_instret(void) {
+    uint64_t v;
+    asm volatile("rdinstret %0" : "=r"(v));
+    return v;
+}
+
+static char *put_str(char *p, const char *s) {
+    while (*s) *p++ = *s++;
+    return p;
+}
+
+static char *put_u64(char *p, uint64_t v) {
+    char digits[20];
+    int n = 0;
+    do {
+        digits[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    while (n) *p++ = digits[--n];
+    return p;
+}
+
+static void report(const char *test, const char *metric, uint64_t value, const char *unit) {
+    char line[160], *p = line;
+    p = put_str(p, "RESULT,");
+    p = put_str(p, test);
+    p = put_str(p, "," BM_ARCH ",");
+    p = put_str(p, metric);
+    *p++ = ',';
+    p = put_u64(p, value);
+    *p++ = ',';
+    p = put_str(p, unit);
+    *p++ = '\n';
+    *p = '\0';
+    bm_semihost(BM_SYS_WRITE0, line);
+}
+
+int main(void) {
+    int failed = 0;
+
+    for (int i = 0; i < bm_test_count; i++) {
+        // Live across bm_catch()'s second return
+        volatile uint64_t start_cycles, start_instret;
+        volatile int status;
+
+        start_cycles = read_cycles();
+        start_instret = read_instret();
+        status = bm_catch();
+        if (status == 0) status = bm_tests[i].main();
+        uint64_t cycles = read_cycles() - start_cycles;
+        uint64_t instret = read_instret() - start_instret;
+
+        report(bm_tests[i].name, "cycles", cycles, "cycles");
+        report(bm_tests[i].name, "instret", instret, "count");
+        report(bm_tests[i].name, "exit_status", (uint64_t)(unsigned)status, "status");
+        if (status != 0) failed++;
+    }
+    return failed;
+}
@@ -0,0 +1,110 @@
+#!/bin/bash
+
+# Bare-Metal Batch Runner
+# Boots batch images (build_batch.sh) in QEMU, several at once, and collects
+# the RESULT lines they stream over semihosting into one CSV.
+#
+# Usage: run_batch.sh <image>...
+#   Images ending in _cheri run on $QEMU_CHERI, the others on $QEMU_RISCV.
+#
+# Environment:
+#   JOBS          concurrent QEMU instances (default: number of host cores)
+#   QEMU_RISCV    default qemu-system-riscv64
+#   QEMU_CHERI    default qemu-system-riscv64cheri
+#   QEMU_FLAGS    default "-M spike -bios none -nographic"
+
+set -e
+
+# Colors for output
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+YELLOW='\033[1;33m'
+BLUE='\033[0;34m'
+NC='\033[0m' # No Color
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+PROJECT_ROOT="$(cd "$SCRIPT_DIR/../.." && pwd)"
+TIMESTAMP=$(date +"%Y%m%d_%H%M%S")
+RESULTS_DIR="$PROJECT_ROOT/results/baremetal_batch_$TIMESTAMP"
+
+JOBS="${JOBS:-$(nproc 2> /dev/null || echo 1)}"
+QEMU_RISCV="${QEMU_RISCV:-qemu-system-riscv64}"
+QEMU_CHERI="${QEMU_CHERI:-qemu-system-riscv64cheri}"
+QEMU_FLAGS="${QEMU_FLAGS:--M spike -bios none -nographic}"
+SEMIHOSTING_FLAGS="-semihosting-config enable=on,target=native"
+
+log_info() {
+    echo -e "${BLUE}[INFO]${NC} $1"
+}
+
+log_success() {
+    echo -e "${GREEN}[SUCCESS]${NC} $1"
+}
+
+log_warning() {
+    echo -e "${YELLOW}[WARNING]${NC} $1"
+}
+
+log_error() {
+    echo -e "${RED}[ERROR]${NC} $1"
+}
+
+# One boot: every test's records, then the image's own exit status and wall time
+run_image() {
+    local image="$1"
+    local name
+    name=$(basename "$image")
+    local arch="${name##*_}"
+    local qemu="$QEMU_RISCV"
+    [ "$arch" = cheri ] && qemu="$QEMU_CHERI"
+    local log="$RESULTS_DIR/$name.log"
+
+    local start end status=0
+    start=$(date +%s%N)
+    $qemu $QEMU_FLAGS $SEMIHOSTING_FLAGS -kernel "$image" > "$log" 2>&1 < /dev/null || status=$?
+    end=$(date +%s%N)
+    echo "RESULT,$name,$arch,exit_status,$status,status" >> "$log"
+    echo "RESULT,$name,$arch,wall_ms,$(( (end - start) / 1000000 )),ms" >> "$log"
+
+    if [ "$status" -eq 0 ]; then
+        log_success "$name: every test exited with 0"
+    else
+        log_warning "$name: $status test(s) exited with a nonzero status - see $log"
+    fi
+}
+
+if [ $# -eq 0 ]; then
+    log_error "usage: $0 <image>..."
+    exit 1
+fi
+
+mkdir -p "$RESULTS_DIR"
+CSV="$RESULTS_DIR/results.csv"
+echo "test,model,metric,value,unit,image" > "$CSV"
+
+log_info "Booting $# images, $JOBS at a time"
+log_info "Results will be saved to: $RESULTS_DIR"
+
+running=0
+for image in "$@"; do
+    if [ ! -f "$image" ]; then
+        log_warning "$image not built - skipping"
+        continue
+    fi
+    if [ "$running" -ge "$JOBS" ]; then
+        wait -n || true
+        running=$((running - 1))
+    fi
+    run_image "$image" &
+    running=$((running + 1))
+done
+wait
+
+for image in "$@"; do
+    name=$(basename "$image")
+    log="$RESULTS_DIR/$name.log"
+    [ -f "$log" ] || continue
+    grep '^RESULT,' "$log" | tr -d '\r' | sed -e 's/^RESULT,//' -e "s/\$/,$name/" >> "$CSV" || true
+done
+
+log_success "Batch results collected in $CSV"
@@ -0,0 +1,78 @@
+/*
+ * Bare-Metal Runtime - memcpy, memmove, memset and memcmp
+ *
+ * GCC and Clang emit calls to these four even with -ffreestanding (struct
+ * copies, zeroed locals, recognized loops), so a -nostdlib link needs them.
+ * Aligned copies move whole pointer-sized words, which are capabilities in
+ * a purecap build, so copying a structure that holds pointers keeps their
+ * tags.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Keep GCC from turning these loops back into calls to themselves
+#if defined(__GNUC__) && !defined(__clang__)
+#define BM_NO_LIBCALLS __attribute__((optimize("no-tree-loop-distribute-patterns")))
+#else
+#define BM_NO_LIBCALLS
+#endif
+
+// Word accesses may alias whatever the caller's buffers hold
+typedef uintptr_t __attribute__((may_alias)) bm_word_t;
+typedef uint64_t __attribute__((may_alias)) bm_u64_t;
+
+#define WORD sizeof(bm_word_t)
+
+static inline int word_aligned(const void *a, const void *b) {
+    return (((size_t)(uintptr_t)a | (size_t)(uintptr_t)b) & (WORD - 1)) == 0;
+}
+
+BM_NO_LIBCALLS void *memcpy(void *dest, const void *src, size_t n) {
+    char *d = dest;
+    const char *s = src;
+    if (word_aligned(d, s)) {
+        for (; n >= WORD; n -= WORD, d += WORD, s += WORD) *(bm_word_t *)d = *(const bm_word_t *)s;
+    }
+    while (n--) *d++ = *s++;
+    return dest;
+}
+
+BM_NO_LIBCALLS void *memmove(void *dest, const void *src, size_t n) {
+    char *d = dest;
+    const char *s = src;
+    if ((size_t)(uintptr_t)d - (size_t)(uintptr_t)s >= n) return memcpy(dest, src, n);
+
+    // Overlapping with dest above src: copy from the end
+    d += n;
+    s += n;
+    if (word_aligned(d, s)) {
+        for (; n >= WORD; n -= WORD) {
+            d -= WORD;
+            s -= WORD;
+            *(bm_word_t *)d = *(const bm_word_t *)s;
+        }
+    }
+    while (n--) *--d = *--s;
+    return dest;
+}
+
+BM_NO_LIBCALLS void *memset(void *dest, int c, size_t n) {
+    unsigned char *d = dest;
+    while (n && ((size_t)(uintptr_t)d & 7)) {
+        *d++ = (unsigned char)c;
+        n--;
+    }
+    uint64_t fill = (uint64_t)(unsigned char)c * 0x0101010101010101ull;
+    for (; n >= 8; n -= 8, d += 8) *(bm_u64_t *)d = fill;
+    while (n--) *d++ = (unsigned char)c;
+    return dest;
+}
+
+BM_NO_LIBCALLS int memcmp(const void *a, const void *b, size_t n) {
+    const unsigned char *p = a, *q = b;
+    for (; n; n--, p++, q++) {
+        if (*p != *q) return *p - *q;
+    }
+    return 0;
+}
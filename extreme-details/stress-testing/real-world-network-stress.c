@@ -50,22 +50,36 @@ struct tcp_header {
     unsigned short urgent_pointer;
 };
 
-// Global packet buffer
-static char packet_buffer[MAX_PACKET_SIZE * 100];  // Buffer for multiple packets
-static int buffer_offset = 0;
+// Per-packet region: everything allocated for a packet dies with it.
+// Freestanding build (no malloc), so this is a fixed buffer rather than
+// the chunked region_t of workloads/common/region.h.
+#define PACKET_REGION_SIZE (MAX_PACKET_SIZE * 4)
+static char packet_region[PACKET_REGION_SIZE] __attribute__((aligned(16)));
+static int packet_region_offset = 0;
 
-// Packet allocator
-cap_ptr_t allocate_packet(int size) {
-    if (buffer_offset + size > sizeof(packet_buffer)) {
-        buffer_offset = 0;  // Wrap around (circular buffer)
+// Bump-allocate a bounded object from the region (capability-aligned)
+static cap_ptr_t packet_region_alloc(int size) {
+    int aligned = (size + (int)sizeof(cap_ptr_t) - 1) & ~((int)sizeof(cap_ptr_t) - 1);
+    if (size <= 0 || packet_region_offset + aligned > (int)sizeof(packet_region)) {
+        return (cap_ptr_t)0;
     }
     
-    void* ptr = &packet_buffer[buffer_offset];
-    buffer_offset += size;
+    void* ptr = &packet_region[packet_region_offset];
+    packet_region_offset += aligned;
     
     return cheri_bounds_set(ptr, size);
 }
 
+// Release every object of the packet at once (O(1), no per-object free)
+static void packet_region_reset(void) {
+    packet_region_offset = 0;
+}
+
+// Packet allocator
+cap_ptr_t allocate_packet(int size) {
+    return packet_region_alloc(size);
+}
+
 // Network Protocol Parsing Functions
 
 // Parse Ethernet header
@@ -278,6 +292,7 @@ void test_network_processing_stress() {
         
         packets_processed++;
         total_bytes += packet_size;
+        packet_region_reset();
     }
     
     // Network processing markers
@@ -334,6 +349,7 @@ void test_deep_packet_inspection() {
                 detections++;
             }
         }
+        packet_region_reset();
     }
     
     // DPI results marker
@@ -0,0 +1,152 @@
+/*
+ * Benchmark Helpers - Timing, percentiles and result reporting
+ *
+ * Results are printed as a human-readable table and, at bench_finish(), as
+ * "RESULT,<workload>,<model>,<metric>,<value>,<unit>" lines that
+ * run_workloads.sh collects into a single CSV per run.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include "capmodel.h"
+
+#ifdef __CHERI__
+#define ARCH_NAME "CHERI-RISC-V"
+#elif defined(__riscv)
+#define ARCH_NAME "Standard RISC-V"
+#else
+#define ARCH_NAME "Host"
+#endif
+
+#define BENCH_MAX_RESULTS 128
+
+typedef struct {
+    char metric[48];
+    double value;
+    const char *unit;
+} bench_result_t;
+
+static const char *bench_workload = "unknown";
+static bench_result_t bench_results[BENCH_MAX_RESULTS];
+static int bench_result_count = 0;
+
+// Monotonic wall clock in nanoseconds
+static inline uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Cycle counter where user mode can read one, nanoseconds otherwise
+static inline uint64_t bench_cycles(void) {
+#if defined(__riscv) && !defined(BENCH_NO_RDCYCLE)
+    uint64_t cycles;
+    asm volatile("rdcycle %0" : "=r"(cycles));
+    return cycles;
+#elif defined(__x86_64__)
+    uint32_t lo, hi;
+    asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+#else
+    return bench_now_ns();
+#endif
+}
+
+// xorshift64* step for reproducible workload data; state must be non-zero
+static inline uint64_t bench_rng_next(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1Dull;
+}
+
+/*
+ * Comma-separated sizes for -n ("1e6,1e7" as well as "1000000,10000000"),
+ * each in [2, max_value]; returns how many were stored, or -1 if malformed
+ * or longer than max_sizes
+ */
+static inline int bench_parse_sizes(const char *list, size_t *sizes, int max_sizes, double max_value) {
+    int count = 0;
+    const char *p = list;
+    while (*p && count < max_sizes) {
+        char *end;
+        double v = strtod(p, &end);
+        if (end == p || v < 2 || v > max_value) return -1;
+        sizes[count++] = (size_t)v;
+        p = *end == ',' ? end + 1 : end;
+        if (*end && *end != ',') return -1;
+    }
+    return *p ? -1 : count;
+}
+
+static inline double bench_seconds(uint64_t start_ns, uint64_t end_ns) {
+    return (double)(end_ns - start_ns) / 1e9;
+}
+
+static int bench_u64_compare(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Percentile of a sample array (sorts the array in place)
+static inline uint64_t bench_percentile(uint64_t *samples, size_t count, double pct) {
+    if (count == 0) return 0;
+    qsort(samples, count, sizeof(uint64_t), bench_u64_compare);
+    size_t rank = (size_t)(pct / 100.0 * (double)(count - 1) + 0.5);
+    return samples[rank < count ? rank : count - 1];
+}
+
+// Peak resident set size in bytes
+static inline size_t bench_max_rss_bytes(void) {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+    return (size_t)usage.ru_maxrss;
+#else
+    return (size_t)usage.ru_maxrss * 1024;
+#endif
+}
+
+// Print system information
+static inline void bench_print_header(const char *workload, const char *title) {
+    bench_workload = workload;
+    printf("%s\n", title);
+    printf("===========================================\n");
+    printf("Architecture: " ARCH_NAME "\n");
+    printf("Pointer model: " CAP_MODEL_NAME "\n");
+    printf("Pointer width: %zu bytes\n", sizeof(cap_ptr_t));
+    printf("\n");
+}
+
+// Record and print one metric
+static inline void bench_report(const char *metric, double value, const char *unit) {
+    printf("  %-36s %16.2f %s\n", metric, value, unit);
+    if (bench_result_count < BENCH_MAX_RESULTS) {
+        bench_result_t *r = &bench_results[bench_result_count++];
+        snprintf(r->metric, sizeof(r->metric), "%s", metric);
+        r->value = value;
+        r->unit = unit;
+    }
+}
+
+// Emit machine-readable results for run_workloads.sh
+static inline void bench_finish(void) {
+    printf("\n");
+    for (int i = 0; i < bench_result_count; i++) {
+        printf("RESULT,%s,%s,%s,%.4f,%s\n", bench_workload, CAP_MODEL_NAME,
+               bench_results[i].metric, bench_results[i].value, bench_results[i].unit);
+    }
+}
+
+#endif // BENCH_H
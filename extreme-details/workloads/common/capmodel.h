@@ -0,0 +1,206 @@
+/*
+ * Pointer Representation Model - Shared by the hosted workloads
+ *
+ * Every workload is compiled three ways from the same source:
+ *   pointer - plain 64-bit pointers, no bounds (Standard RISC-V)
+ *   softcap - 16-byte software fat pointers, bounds checked in software
+ *             (-DCAP_MODEL_SOFTCAP); capability width without CHERI hardware
+ *   cheri   - hardware capabilities (CHERI-LLVM purecap)
+ *
+ * Workloads store object references as cap_ptr_t and dereference them only
+ * through CAP_OBJ()/CAP_AT()/cap_check(), so the three builds differ only in
+ * pointer width and in who enforces the bounds.
+ */
+
+#ifndef CAPMODEL_H
+#define CAPMODEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef __CHERI__
+#include <cheriintrin.h>
+#define CAP_MODEL_NAME "cheri"
+typedef void* __capability cap_ptr_t;
+#define CAP_NULL ((cap_ptr_t)0)
+
+// Root capability for a fresh allocation
+static inline cap_ptr_t cap_make(void *ptr, size_t length) {
+    return ptr ? cheri_bounds_set(ptr, length) : CAP_NULL;
+}
+
+// Derive a narrower capability; CSetBounds enforces monotonicity
+static inline cap_ptr_t cap_sub(cap_ptr_t cap, size_t offset, size_t length) {
+    return cheri_bounds_set((char *)cap + offset, length);
+}
+
+static inline void *cap_addr(cap_ptr_t cap) { return (void *)cap; }
+static inline size_t cap_len(cap_ptr_t cap) { return cheri_length_get(cap); }
+static inline int cap_is_null(cap_ptr_t cap) { return cap == CAP_NULL; }
+
+// Hardware checks the access itself
+static inline void *cap_check(cap_ptr_t cap, size_t offset, size_t size) {
+    (void)size;
+    return (char *)cap + offset;
+}
+
+#elif defined(CAP_MODEL_SOFTCAP)
+#define CAP_MODEL_NAME "softcap"
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+typedef struct {
+    char *base;      // Lowest accessible byte (NULL for an untagged capability)
+    size_t length;   // Bytes accessible from base
+} cap_ptr_t;
+#define CAP_NULL ((cap_ptr_t){ 0, 0 })
+
+static void cap_fault(cap_ptr_t cap, size_t offset, size_t size) __attribute__((noreturn, cold, noinline));
+static void cap_fault(cap_ptr_t cap, size_t offset, size_t size) {
+    fprintf(stderr, "softcap: bounds violation: base=%p length=%zu access=[%zu, +%zu)\n",
+            (void *)cap.base, cap.length, offset, size);
+    abort();
+}
+
+static inline cap_ptr_t cap_make(void *ptr, size_t length) {
+    cap_ptr_t cap = { (char *)ptr, ptr ? length : 0 };
+    return cap;
+}
+
+// Out-of-bounds derivation yields an untagged capability, like CSetBounds
+static inline cap_ptr_t cap_sub(cap_ptr_t cap, size_t offset, size_t length) {
+    if (offset > cap.length || length > cap.length - offset) {
+        return CAP_NULL;
+    }
+    cap_ptr_t derived = { cap.base + offset, length };
+    return derived;
+}
+
+static inline void *cap_addr(cap_ptr_t cap) { return cap.base; }
+static inline size_t cap_len(cap_ptr_t cap) { return cap.length; }
+static inline int cap_is_null(cap_ptr_t cap) { return cap.base == NULL; }
+
+// Software bounds check on every dereference
+static inline void *cap_check(cap_ptr_t cap, size_t offset, size_t size) {
+    if (__builtin_expect(offset > cap.length || size > cap.length - offset, 0)) {
+        cap_fault(cap, offset, size);
+    }
+    return cap.base + offset;
+}
+
+#else
+#define CAP_MODEL_NAME "pointer"
+typedef void* cap_ptr_t;
+#define CAP_NULL ((cap_ptr_t)0)
+
+static inline cap_ptr_t cap_make(void *ptr, size_t length) { (void)length; return ptr; }
+
+static inline cap_ptr_t cap_sub(cap_ptr_t cap, size_t offset, size_t length) {
+    (void)length;
+    return (char *)cap + offset;
+}
+
+static inline void *cap_addr(cap_ptr_t cap) { return cap; }
+static inline size_t cap_len(cap_ptr_t cap) { (void)cap; return SIZE_MAX; }
+static inline int cap_is_null(cap_ptr_t cap) { return cap == CAP_NULL; }
+
+static inline void *cap_check(cap_ptr_t cap, size_t offset, size_t size) {
+    (void)size;
+    return (char *)cap + offset;
+}
+#endif
+
+// Typed dereference helpers (checked in softcap, hardware-checked in CHERI)
+#define CAP_OBJ(cap, type) ((type *)cap_check((cap), 0, sizeof(type)))
+#define CAP_AT(cap, type, index) \
+    (*(type *)cap_check((cap), (size_t)(index) * sizeof(type), sizeof(type)))
+
+static inline int cap_same(cap_ptr_t a, cap_ptr_t b) {
+    return cap_addr(a) == cap_addr(b);
+}
+
+/*
+ * Derive count bounded views of parent in one call, view i covering
+ * [offsets[i], offsets[i] + lengths[i]). Same result as cap_sub() per entry
+ * (out-of-bounds entries come back untagged). softcap writes every view
+ * while checking the whole batch branch-free, two entries per SSE2 step,
+ * and only redoes the batch one entry at a time if a check failed; CHERI
+ * issues independent CSetBounds four at a time. Returns the number of
+ * tagged views.
+ */
+static inline size_t cap_sub_bulk(cap_ptr_t parent, const size_t *offsets, const size_t *lengths,
+                                  size_t count, cap_ptr_t *views) {
+#ifdef __CHERI__
+    size_t i = 0, valid = 0;
+    for (; i + 4 <= count; i += 4) {
+        views[i] = cheri_bounds_set((char *)parent + offsets[i], lengths[i]);
+        views[i + 1] = cheri_bounds_set((char *)parent + offsets[i + 1], lengths[i + 1]);
+        views[i + 2] = cheri_bounds_set((char *)parent + offsets[i + 2], lengths[i + 2]);
+        views[i + 3] = cheri_bounds_set((char *)parent + offsets[i + 3], lengths[i + 3]);
+    }
+    for (; i < count; i++) views[i] = cheri_bounds_set((char *)parent + offsets[i], lengths[i]);
+    for (i = 0; i < count; i++) valid += cheri_tag_get(views[i]);
+    return valid;
+#elif defined(CAP_MODEL_SOFTCAP)
+    // With every offset, length, end (offset + size) and the parent length
+    // below 2^63, a view is in bounds exactly when length - end keeps its top
+    // bit clear, so one sub and a few ors check it. Larger values, including
+    // ends that only reach 2^63 through the sum, take the exact per-entry
+    // path. SSE2 has 64-bit add/sub/or but no 64-bit compare.
+    uint64_t limit = parent.length;
+    uint64_t bad = limit | (cap_is_null(parent) ? 1ull << 63 : 0);
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128i limit2 = _mm_set1_epi64x((long long)limit);
+    const __m128i base2 = _mm_set1_epi64x((long long)(uintptr_t)parent.base);
+    __m128i acc = _mm_setzero_si128();
+    for (; i + 2 <= count; i += 2) {
+        __m128i offset = _mm_loadu_si128((const __m128i *)(offsets + i));
+        __m128i length = _mm_loadu_si128((const __m128i *)(lengths + i));
+        __m128i end = _mm_add_epi64(offset, length);
+        __m128i slack = _mm_sub_epi64(limit2, end);
+        acc = _mm_or_si128(acc, _mm_or_si128(_mm_or_si128(slack, end), _mm_or_si128(offset, length)));
+        __m128i start = _mm_add_epi64(base2, offset);
+        _mm_storeu_si128((__m128i *)&views[i], _mm_unpacklo_epi64(start, length));
+        _mm_storeu_si128((__m128i *)&views[i + 1], _mm_unpackhi_epi64(start, length));
+    }
+    bad |= (uint64_t)(_mm_movemask_pd(_mm_castsi128_pd(acc)) != 0) << 63;
+#endif
+    for (; i < count; i++) {
+        uint64_t offset = offsets[i], length = lengths[i];
+        uint64_t end = offset + length;
+        bad |= (limit - end) | end | offset | length;
+        views[i].base = parent.base + offset;
+        views[i].length = length;
+    }
+    if (__builtin_expect(!(bad >> 63), 1)) return count;
+
+    size_t valid = 0;
+    for (i = 0; i < count; i++) {
+        views[i] = cap_sub(parent, offsets[i], lengths[i]);
+        valid += !cap_is_null(views[i]);
+    }
+    return valid;
+#else
+    (void)lengths;
+    for (size_t i = 0; i < count; i++) views[i] = (char *)parent + offsets[i];
+    return count;
+#endif
+}
+
+// Allocation returning a capability bounded to the requested size
+static inline cap_ptr_t cap_malloc(size_t size) {
+#ifdef __CHERI__
+    return malloc(size);  // CheriBSD malloc already returns bounded capabilities
+#else
+    return cap_make(malloc(size), size);
+#endif
+}
+
+static inline void cap_free(cap_ptr_t cap) {
+    free(cap_addr(cap));
+}
+
+#endif // CAPMODEL_H
@@ -0,0 +1,279 @@
+/*
+ * HTTP/1.1 Request Parser - picohttpparser-style structural parsing
+ *
+ * Locates spaces, colons and line endings with AVX2/SSE2 on x86, SWAR
+ * (8 bytes per step) everywhere else, or one byte at a time as a baseline.
+ * Method, path, header names/values and body are returned as bounded
+ * sub-views (cap_sub) of the payload capability, so downstream inspection
+ * can never read past the field it was handed.
+ *
+ * Vector loads are only issued while a full vector fits inside the payload;
+ * the tail is scanned bytewise, so no scan mode over-reads its capability.
+ */
+
+#ifndef HTTP_PARSER_H
+#define HTTP_PARSER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "capmodel.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define HTTP_HAVE_X86_SIMD 1
+#endif
+
+#define HTTP_MAX_HEADERS 64
+
+#define HTTP_PARSE_ERROR      (-1)
+#define HTTP_PARSE_INCOMPLETE (-2)
+
+typedef enum {
+    HTTP_SCAN_SCALAR = 0,   // One byte per step
+    HTTP_SCAN_SWAR,         // 8 bytes per step in a general-purpose register
+    HTTP_SCAN_SSE2,         // 16 bytes per step
+    HTTP_SCAN_AVX2,         // 32 bytes per step
+    HTTP_SCAN_MODES
+} http_scan_t;
+
+static inline const char *http_scan_name(http_scan_t scan) {
+    static const char *const names[HTTP_SCAN_MODES] = { "scalar", "swar", "sse2", "avx2" };
+    return scan < HTTP_SCAN_MODES ? names[scan] : "unknown";
+}
+
+typedef struct {
+    cap_ptr_t name;
+    cap_ptr_t value;
+    uint32_t name_len;
+    uint32_t value_len;
+} http_header_t;
+
+typedef struct {
+    cap_ptr_t method;
+    cap_ptr_t path;
+    cap_ptr_t body;
+    uint32_t method_len;
+    uint32_t path_len;
+    uint32_t body_len;
+    int minor_version;
+    size_t num_headers;
+    http_header_t headers[HTTP_MAX_HEADERS];
+} http_request_t;
+
+// ---------------------------------------------------------------------------
+// Delimiter scanning: index of the first byte equal to a or b in [pos, end)
+// ---------------------------------------------------------------------------
+
+static inline size_t http_find2_scalar(const char *p, size_t pos, size_t end, char a, char b) {
+    while (pos < end && p[pos] != a && p[pos] != b) pos++;
+    return pos;
+}
+
+#define HTTP_SWAR_ONES  0x0101010101010101ull
+#define HTTP_SWAR_HIGHS 0x8080808080808080ull
+
+// High bit set in each byte lane of v that equals the broadcast byte
+static inline uint64_t http_swar_match(uint64_t v, uint64_t pattern) {
+    uint64_t x = v ^ pattern;
+    return (x - HTTP_SWAR_ONES) & ~x & HTTP_SWAR_HIGHS;
+}
+
+static inline size_t http_find2_swar(const char *p, size_t pos, size_t end, char a, char b) {
+    uint64_t pa = HTTP_SWAR_ONES * (unsigned char)a;
+    uint64_t pb = HTTP_SWAR_ONES * (unsigned char)b;
+
+    while (pos + 8 <= end) {
+        uint64_t v;
+        memcpy(&v, p + pos, 8);
+        uint64_t m = http_swar_match(v, pa) | http_swar_match(v, pb);
+        if (m) return pos + (size_t)(__builtin_ctzll(m) >> 3);  // Lowest lane is exact
+        pos += 8;
+    }
+    return http_find2_scalar(p, pos, end, a, b);
+}
+
+#ifdef HTTP_HAVE_X86_SIMD
+static inline size_t http_find2_sse2(const char *p, size_t pos, size_t end, char a, char b) {
+    const __m128i va = _mm_set1_epi8(a);
+    const __m128i vb = _mm_set1_epi8(b);
+
+    while (pos + 16 <= end) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + pos));
+        int m = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)));
+        if (m) return pos + (size_t)__builtin_ctz((unsigned)m);
+        pos += 16;
+    }
+    return http_find2_scalar(p, pos, end, a, b);
+}
+
+__attribute__((target("avx2")))
+static inline size_t http_find2_avx2(const char *p, size_t pos, size_t end, char a, char b) {
+    const __m256i va = _mm256_set1_epi8(a);
+    const __m256i vb = _mm256_set1_epi8(b);
+
+    while (pos + 32 <= end) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(p + pos));
+        unsigned m = (unsigned)_mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, va), _mm256_cmpeq_epi8(v, vb)));
+        if (m) return pos + (size_t)__builtin_ctz(m);
+        pos += 32;
+    }
+    return http_find2_sse2(p, pos, end, a, b);
+}
+#endif
+
+// Whether a scan mode can run on this machine
+static inline int http_scan_supported(http_scan_t scan) {
+    switch (scan) {
+    case HTTP_SCAN_SCALAR:
+    case HTTP_SCAN_SWAR:
+        return 1;
+#ifdef HTTP_HAVE_X86_SIMD
+    case HTTP_SCAN_SSE2:
+        return 1;
+    case HTTP_SCAN_AVX2:
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return 0;
+    }
+}
+
+static inline size_t http_find2(const char *p, size_t pos, size_t end, char a, char b,
+                                http_scan_t scan) {
+    switch (scan) {
+    case HTTP_SCAN_SWAR:
+        return http_find2_swar(p, pos, end, a, b);
+#ifdef HTTP_HAVE_X86_SIMD
+    case HTTP_SCAN_SSE2:
+        return http_find2_sse2(p, pos, end, a, b);
+    case HTTP_SCAN_AVX2:
+        return http_find2_avx2(p, pos, end, a, b);
+#endif
+    default:
+        return http_find2_scalar(p, pos, end, a, b);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Request parsing
+// ---------------------------------------------------------------------------
+
+static inline int http_name_equals(const char *name, size_t len, const char *lower) {
+    for (size_t i = 0; i < len; i++) {
+        char c = name[i];
+        if (c >= 'A' && c <= 'Z') c = (char)(c + ('a' - 'A'));
+        if (c != lower[i] || lower[i] == '\0') return 0;
+    }
+    return lower[len] == '\0';
+}
+
+// Advance past "\r\n" or "\n" at pos; returns new position or 0 if malformed
+static inline size_t http_skip_eol(const char *p, size_t pos, size_t end) {
+    if (pos < end && p[pos] == '\r') {
+        if (pos + 1 >= end) return end + 1;   // Incomplete
+        return p[pos + 1] == '\n' ? pos + 2 : 0;
+    }
+    return (pos < end && p[pos] == '\n') ? pos + 1 : 0;
+}
+
+/*
+ * Parse one request from the first len bytes of buf.
+ * Returns the total request length (headers plus body), HTTP_PARSE_INCOMPLETE
+ * when more bytes are needed, or HTTP_PARSE_ERROR.
+ */
+static inline long http_parse_request(cap_ptr_t buf, size_t len, http_request_t *req,
+                                      http_scan_t scan) {
+    const char *p = (const char *)cap_check(buf, 0, len);  // One check for the whole scan
+    size_t pos, mark;
+
+    req->num_headers = 0;
+    req->body = CAP_NULL;
+    req->body_len = 0;
+
+    // Request line: METHOD SP PATH SP HTTP/1.x EOL
+    pos = http_find2(p, 0, len, ' ', '\n', scan);
+    if (pos >= len) return HTTP_PARSE_INCOMPLETE;
+    if (pos == 0 || p[pos] != ' ') return HTTP_PARSE_ERROR;
+    req->method = cap_sub(buf, 0, pos);
+    req->method_len = (uint32_t)pos;
+
+    mark = pos + 1;
+    pos = http_find2(p, mark, len, ' ', '\n', scan);
+    if (pos >= len) return HTTP_PARSE_INCOMPLETE;
+    if (pos == mark || p[pos] != ' ') return HTTP_PARSE_ERROR;
+    req->path = cap_sub(buf, mark, pos - mark);
+    req->path_len = (uint32_t)(pos - mark);
+
+    mark = pos + 1;
+    pos = http_find2(p, mark, len, '\r', '\n', scan);
+    if (pos >= len) return HTTP_PARSE_INCOMPLETE;
+    if (pos - mark != 8 || memcmp(p + mark, "HTTP/1.", 7) != 0 ||
+        p[mark + 7] < '0' || p[mark + 7] > '9') {
+        return HTTP_PARSE_ERROR;
+    }
+    req->minor_version = p[mark + 7] - '0';
+    pos = http_skip_eol(p, pos, len);
+    if (pos == 0) return HTTP_PARSE_ERROR;
+    if (pos > len) return HTTP_PARSE_INCOMPLETE;
+
+    // Header fields until the empty line
+    size_t content_length = 0;
+    for (;;) {
+        if (pos >= len) return HTTP_PARSE_INCOMPLETE;
+        if (p[pos] == '\r' || p[pos] == '\n') {
+            pos = http_skip_eol(p, pos, len);
+            if (pos == 0) return HTTP_PARSE_ERROR;
+            if (pos > len) return HTTP_PARSE_INCOMPLETE;
+            break;
+        }
+        if (req->num_headers == HTTP_MAX_HEADERS) return HTTP_PARSE_ERROR;
+
+        mark = pos;
+        pos = http_find2(p, mark, len, ':', '\n', scan);
+        if (pos >= len) return HTTP_PARSE_INCOMPLETE;
+        if (pos == mark || p[pos] != ':') return HTTP_PARSE_ERROR;
+        size_t name_len = pos - mark;
+        http_header_t *h = &req->headers[req->num_headers++];
+        h->name = cap_sub(buf, mark, name_len);
+        h->name_len = (uint32_t)name_len;
+
+        pos++;
+        while (pos < len && (p[pos] == ' ' || p[pos] == '\t')) pos++;
+        size_t value_start = pos;
+        pos = http_find2(p, value_start, len, '\r', '\n', scan);
+        if (pos >= len) return HTTP_PARSE_INCOMPLETE;
+        size_t value_end = pos;
+        while (value_end > value_start && (p[value_end - 1] == ' ' || p[value_end - 1] == '\t')) {
+            value_end--;
+        }
+        h->value = cap_sub(buf, value_start, value_end - value_start);
+        h->value_len = (uint32_t)(value_end - value_start);
+
+        if (http_name_equals(p + mark, name_len, "content-length")) {
+            content_length = 0;
+            for (size_t i = value_start; i < value_end; i++) {
+                if (p[i] < '0' || p[i] > '9') return HTTP_PARSE_ERROR;
+                content_length = content_length * 10 + (size_t)(p[i] - '0');
+                if (content_length > (size_t)1 << 40) return HTTP_PARSE_ERROR;
+            }
+        }
+
+        pos = http_skip_eol(p, pos, len);
+        if (pos == 0) return HTTP_PARSE_ERROR;
+        if (pos > len) return HTTP_PARSE_INCOMPLETE;
+    }
+
+    // Body bounded to exactly Content-Length bytes
+    if (content_length > 0) {
+        if (content_length > len - pos) return HTTP_PARSE_INCOMPLETE;
+        req->body = cap_sub(buf, pos, content_length);
+        req->body_len = (uint32_t)content_length;
+        pos += content_length;
+    }
+    return (long)pos;
+}
+
+#endif // HTTP_PARSER_H
@@ -0,0 +1,700 @@
+/*
+ * JSON Parser - simdjson-style two-stage structural indexing
+ *
+ * Stage 1 classifies the input 64 bytes at a time into bitmasks (quotes,
+ * backslashes, structural operators, whitespace), resolves escapes and
+ * string interiors with carry-propagating bit arithmetic, and flattens the
+ * result into an array of structural indices.
+ *
+ * Stage 2 walks the indices, validates the grammar and builds a tape: one
+ * node per value, with containers linked to their matching end node. String
+ * nodes hold a bounded view (cap_sub) of the input, or of the unescape
+ * buffer when the string contains escapes, so a consumer can only read the
+ * string it was handed.
+ *
+ * Classification runs byte-at-a-time, SWAR (8 bytes per step), SSE2 or
+ * AVX2. The final partial block is copied into a padded local block, so no
+ * mode reads past the input capability.
+ */
+
+#ifndef JSON_PARSER_H
+#define JSON_PARSER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "capmodel.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define JSON_HAVE_X86_SIMD 1
+#endif
+
+#define JSON_MAX_DEPTH 1024
+
+#define JSON_OK            0
+#define JSON_ERROR_SYNTAX  (-1)
+#define JSON_ERROR_STRING  (-2)   // Unterminated string or bad escape
+#define JSON_ERROR_NUMBER  (-3)
+#define JSON_ERROR_DEPTH   (-4)
+#define JSON_ERROR_MEMORY  (-5)
+
+typedef enum {
+    JSON_SCAN_SCALAR = 0,   // One byte per step
+    JSON_SCAN_SWAR,         // 8 bytes per step in a general-purpose register
+    JSON_SCAN_SSE2,         // 16 bytes per step
+    JSON_SCAN_AVX2,         // 32 bytes per step
+    JSON_SCAN_MODES
+} json_scan_t;
+
+static inline const char *json_scan_name(json_scan_t scan) {
+    static const char *const names[JSON_SCAN_MODES] = { "scalar", "swar", "sse2", "avx2" };
+    return scan < JSON_SCAN_MODES ? names[scan] : "unknown";
+}
+
+typedef enum {
+    JSON_NULL = 0,
+    JSON_TRUE,
+    JSON_FALSE,
+    JSON_INT,
+    JSON_DOUBLE,
+    JSON_STRING,
+    JSON_ARRAY,     // aux = tape index of the matching JSON_END, u.count = elements
+    JSON_OBJECT,    // aux = tape index of the matching JSON_END, u.count = members
+    JSON_END        // aux = tape index of the opening node
+} json_type_t;
+
+// One tape node; string views make the node as wide as a capability
+typedef struct {
+    uint32_t type;
+    uint32_t aux;           // Container link or string length
+    union {
+        int64_t i;
+        double d;
+        uint64_t count;
+        cap_ptr_t str;      // Bounded to exactly the string bytes
+    } u;
+} json_node_t;
+
+typedef struct {
+    json_node_t *tape;
+    size_t tape_len;
+    size_t tape_capacity;
+    uint32_t *indices;      // Stage 1 output
+    size_t index_count;
+    size_t index_capacity;
+    cap_ptr_t strings;      // Unescaped copies of strings that contained escapes
+    size_t strings_len;
+    size_t strings_capacity;
+} json_doc_t;
+
+// ---------------------------------------------------------------------------
+// Stage 1: per-block classification
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    uint64_t quote;
+    uint64_t backslash;
+    uint64_t op;            // { } [ ] : ,
+    uint64_t ws;            // space, tab, CR, LF
+} json_block_t;
+
+static inline void json_classify_scalar(const unsigned char *b, json_block_t *m) {
+    uint64_t quote = 0, backslash = 0, op = 0, ws = 0;
+    for (int i = 0; i < 64; i++) {
+        uint64_t bit = 1ull << i;
+        switch (b[i]) {
+        case '"': quote |= bit; break;
+        case '\\': backslash |= bit; break;
+        case '{': case '}': case '[': case ']': case ':': case ',': op |= bit; break;
+        case ' ': case '\t': case '\n': case '\r': ws |= bit; break;
+        default: break;
+        }
+    }
+    m->quote = quote;
+    m->backslash = backslash;
+    m->op = op;
+    m->ws = ws;
+}
+
+#define JSON_SWAR_ONES  0x0101010101010101ull
+#define JSON_SWAR_LOWS  0x7F7F7F7F7F7F7F7Full
+#define JSON_SWAR_HIGHS 0x8080808080808080ull
+
+// High bit set in exactly the byte lanes of v equal to c; unlike the
+// subtract-borrow zero test no borrow crosses lanes, so every lane is exact
+static inline uint64_t json_swar_eq(uint64_t v, unsigned char c) {
+    uint64_t x = v ^ (JSON_SWAR_ONES * c);
+    return ~(((x & JSON_SWAR_LOWS) + JSON_SWAR_LOWS) | x) & JSON_SWAR_HIGHS;
+}
+
+// Gather the eight lane high bits into the low byte (SWAR movemask)
+static inline uint64_t json_swar_movemask(uint64_t highs) {
+    return ((highs >> 7) * 0x0102040810204080ull) >> 56;
+}
+
+static inline void json_classify_swar(const unsigned char *b, json_block_t *m) {
+    uint64_t quote = 0, backslash = 0, op = 0, ws = 0;
+    for (int i = 0; i < 64; i += 8) {
+        uint64_t v;
+        memcpy(&v, b + i, 8);
+        uint64_t q = json_swar_eq(v, '"');
+        uint64_t s = json_swar_eq(v, '\\');
+        uint64_t o = json_swar_eq(v, '{') | json_swar_eq(v, '}') | json_swar_eq(v, '[') |
+                     json_swar_eq(v, ']') | json_swar_eq(v, ':') | json_swar_eq(v, ',');
+        uint64_t w = json_swar_eq(v, ' ') | json_swar_eq(v, '\t') |
+                     json_swar_eq(v, '\n') | json_swar_eq(v, '\r');
+        quote |= json_swar_movemask(q) << i;
+        backslash |= json_swar_movemask(s) << i;
+        op |= json_swar_movemask(o) << i;
+        ws |= json_swar_movemask(w) << i;
+    }
+    m->quote = quote;
+    m->backslash = backslash;
+    m->op = op;
+    m->ws = ws;
+}
+
+#ifdef JSON_HAVE_X86_SIMD
+static inline void json_classify_sse2(const unsigned char *b, json_block_t *m) {
+    uint64_t quote = 0, backslash = 0, op = 0, ws = 0;
+    for (int i = 0; i < 64; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(b + i));
+        // Map [ ] { } onto one value each: '[' | 0x20 == '{', ']' | 0x20 == '}'
+        __m128i folded = _mm_or_si128(v, _mm_set1_epi8(0x20));
+        __m128i o = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(folded, _mm_set1_epi8('{')),
+                         _mm_cmpeq_epi8(folded, _mm_set1_epi8('}'))),
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(':')),
+                         _mm_cmpeq_epi8(v, _mm_set1_epi8(','))));
+        __m128i w = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                         _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\n')),
+                         _mm_cmpeq_epi8(v, _mm_set1_epi8('\r'))));
+        quote |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('"'))) << i;
+        backslash |= (uint64_t)(unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))) << i;
+        op |= (uint64_t)(unsigned)_mm_movemask_epi8(o) << i;
+        ws |= (uint64_t)(unsigned)_mm_movemask_epi8(w) << i;
+    }
+    m->quote = quote;
+    m->backslash = backslash;
+    m->op = op;
+    m->ws = ws;
+}
+
+__attribute__((target("avx2")))
+static inline void json_classify_avx2(const unsigned char *b, json_block_t *m) {
+    uint64_t quote = 0, backslash = 0, op = 0, ws = 0;
+    for (int i = 0; i < 64; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(b + i));
+        __m256i folded = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+        __m256i o = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(folded, _mm256_set1_epi8('{')),
+                            _mm256_cmpeq_epi8(folded, _mm256_set1_epi8('}'))),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(':')),
+                            _mm256_cmpeq_epi8(v, _mm256_set1_epi8(','))));
+        __m256i w = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                            _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')),
+                            _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r'))));
+        quote |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"'))) << i;
+        backslash |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'))) << i;
+        op |= (uint64_t)(uint32_t)_mm256_movemask_epi8(o) << i;
+        ws |= (uint64_t)(uint32_t)_mm256_movemask_epi8(w) << i;
+    }
+    m->quote = quote;
+    m->backslash = backslash;
+    m->op = op;
+    m->ws = ws;
+}
+#endif
+
+// Whether a scan mode can run on this machine
+static inline int json_scan_supported(json_scan_t scan) {
+    switch (scan) {
+    case JSON_SCAN_SCALAR:
+    case JSON_SCAN_SWAR:
+        return 1;
+#ifdef JSON_HAVE_X86_SIMD
+    case JSON_SCAN_SSE2:
+        return 1;
+    case JSON_SCAN_AVX2:
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return 0;
+    }
+}
+
+static inline void json_classify(const unsigned char *b, json_block_t *m, json_scan_t scan) {
+    switch (scan) {
+    case JSON_SCAN_SWAR:
+        json_classify_swar(b, m);
+        break;
+#ifdef JSON_HAVE_X86_SIMD
+    case JSON_SCAN_SSE2:
+        json_classify_sse2(b, m);
+        break;
+    case JSON_SCAN_AVX2:
+        json_classify_avx2(b, m);
+        break;
+#endif
+    default:
+        json_classify_scalar(b, m);
+        break;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Stage 1: bit arithmetic across blocks
+// ---------------------------------------------------------------------------
+
+// Bit i of the result is the XOR of bits 0..i (carry-less multiply by all-ones)
+static inline uint64_t json_prefix_xor(uint64_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+/*
+ * Characters preceded by an odd-length run of backslashes. Subtracting the
+ * run starts from the odd-bit pattern makes the borrow flip exactly the
+ * positions that follow an odd run; *carry holds "first byte of the next
+ * block is escaped".
+ */
+static inline uint64_t json_find_escaped(uint64_t backslash, uint64_t *carry) {
+    const uint64_t odd_bits = 0xAAAAAAAAAAAAAAAAull;
+    if (!backslash) {
+        uint64_t escaped = *carry;
+        *carry = 0;
+        return escaped;
+    }
+    uint64_t potential = backslash & ~*carry;
+    uint64_t maybe_escaped = potential << 1;
+    uint64_t codes = ((maybe_escaped | odd_bits) - potential) ^ odd_bits;
+    uint64_t escaped = codes ^ (backslash | *carry);
+    *carry = (codes & backslash) >> 63;
+    return escaped;
+}
+
+static inline int json_doc_reserve_indices(json_doc_t *doc, size_t needed) {
+    if (needed <= doc->index_capacity) return 0;
+    size_t capacity = doc->index_capacity ? doc->index_capacity : 4096;
+    while (capacity < needed) capacity *= 2;
+    uint32_t *indices = realloc(doc->indices, capacity * sizeof(uint32_t));
+    if (!indices) return -1;
+    doc->indices = indices;
+    doc->index_capacity = capacity;
+    return 0;
+}
+
+// Structural indices of the first len bytes of input into doc->indices
+static inline int json_stage1(cap_ptr_t input, size_t len, json_doc_t *doc, json_scan_t scan) {
+    const unsigned char *p = (const unsigned char *)cap_check(input, 0, len);
+    uint64_t escape_carry = 0, in_string_carry = 0, scalar_carry = 0;
+    size_t n = 0;
+
+    if (len > UINT32_MAX) return JSON_ERROR_MEMORY;
+    // At most one structural per byte; reserve the worst case for the block loop
+    if (json_doc_reserve_indices(doc, len + 64) != 0) return JSON_ERROR_MEMORY;
+    uint32_t *out = doc->indices;
+
+    for (size_t base = 0; base < len; base += 64) {
+        unsigned char tail[64];
+        const unsigned char *block = p + base;
+        if (len - base < 64) {  // Pad the final block instead of reading past the input
+            memset(tail, ' ', sizeof(tail));
+            memcpy(tail, p + base, len - base);
+            block = tail;
+        }
+
+        json_block_t m;
+        json_classify(block, &m, scan);
+
+        uint64_t escaped = json_find_escaped(m.backslash, &escape_carry);
+        uint64_t quote = m.quote & ~escaped;
+        uint64_t in_string = json_prefix_xor(quote) ^ in_string_carry;
+        in_string_carry = (uint64_t)((int64_t)in_string >> 63);
+
+        // A scalar (number, literal, opening quote) starts where a non-quote
+        // scalar byte does not precede it
+        uint64_t scalar = ~(m.op | m.ws);
+        uint64_t nonquote_scalar = scalar & ~quote;
+        uint64_t follows_scalar = (nonquote_scalar << 1) | scalar_carry;
+        scalar_carry = nonquote_scalar >> 63;
+        uint64_t scalar_start = scalar & ~follows_scalar;
+
+        // String interiors and closing quotes are not structural
+        uint64_t string_tail = in_string ^ quote;
+        uint64_t structurals = (m.op | scalar_start) & ~string_tail;
+
+        while (structurals) {
+            out[n++] = (uint32_t)(base + (size_t)__builtin_ctzll(structurals));
+            structurals &= structurals - 1;
+        }
+    }
+    doc->index_count = n;
+    return in_string_carry ? JSON_ERROR_STRING : JSON_OK;
+}
+
+// ---------------------------------------------------------------------------
+// Stage 2: tape construction
+// ---------------------------------------------------------------------------
+
+static inline int json_is_value_end(const unsigned char *p, size_t pos, size_t len) {
+    if (pos >= len) return 1;
+    switch (p[pos]) {
+    case ' ': case '\t': case '\n': case '\r':
+    case ',': case ']': case '}': case ':':
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+static inline size_t json_utf8_encode(unsigned char *out, uint32_t cp) {
+    if (cp < 0x80) {
+        out[0] = (unsigned char)cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = (unsigned char)(0xC0 | (cp >> 6));
+        out[1] = (unsigned char)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = (unsigned char)(0xE0 | (cp >> 12));
+        out[1] = (unsigned char)(0x80 | ((cp >> 6) & 0x3F));
+        out[2] = (unsigned char)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = (unsigned char)(0xF0 | (cp >> 18));
+    out[1] = (unsigned char)(0x80 | ((cp >> 12) & 0x3F));
+    out[2] = (unsigned char)(0x80 | ((cp >> 6) & 0x3F));
+    out[3] = (unsigned char)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+static inline int json_hex4(const unsigned char *p, uint32_t *out) {
+    uint32_t v = 0;
+    for (int i = 0; i < 4; i++) {
+        unsigned char c = p[i];
+        v <<= 4;
+        if (c >= '0' && c <= '9') v |= (uint32_t)(c - '0');
+        else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f') v |= (uint32_t)((c | 0x20) - 'a' + 10);
+        else return -1;
+    }
+    *out = v;
+    return 0;
+}
+
+// Unescape p[start, end) into the string buffer; returns the view or CAP_NULL
+static inline cap_ptr_t json_unescape(json_doc_t *doc, const unsigned char *p, size_t start,
+                                      size_t end, uint32_t *len_out) {
+    // Unescaping never grows a string, and the buffer holds the whole input
+    size_t out_start = doc->strings_len;
+    unsigned char *out = (unsigned char *)cap_check(doc->strings, out_start, end - start);
+    size_t o = 0;
+
+    for (size_t i = start; i < end; i++) {
+        if (p[i] != '\\') {
+            out[o++] = p[i];
+            continue;
+        }
+        if (++i >= end) return CAP_NULL;
+        switch (p[i]) {
+        case '"': out[o++] = '"'; break;
+        case '\\': out[o++] = '\\'; break;
+        case '/': out[o++] = '/'; break;
+        case 'b': out[o++] = '\b'; break;
+        case 'f': out[o++] = '\f'; break;
+        case 'n': out[o++] = '\n'; break;
+        case 'r': out[o++] = '\r'; break;
+        case 't': out[o++] = '\t'; break;
+        case 'u': {
+            uint32_t cp;
+            if (i + 4 >= end || json_hex4(p + i + 1, &cp) != 0) return CAP_NULL;
+            i += 4;
+            if (cp >= 0xD800 && cp < 0xDC00) {  // High surrogate needs its low half
+                uint32_t low;
+                if (i + 6 >= end || p[i + 1] != '\\' || p[i + 2] != 'u' ||
+                    json_hex4(p + i + 3, &low) != 0 || low < 0xDC00 || low >= 0xE000) {
+                    return CAP_NULL;
+                }
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                i += 6;
+            }
+            o += json_utf8_encode(out + o, cp);
+            break;
+        }
+        default:
+            return CAP_NULL;
+        }
+    }
+    doc->strings_len += o;
+    *len_out = (uint32_t)o;
+    return cap_sub(doc->strings, out_start, o);
+}
+
+// Parse the string whose opening quote is at pos into node
+static inline int json_parse_string(json_doc_t *doc, cap_ptr_t input, const unsigned char *p,
+                                    size_t pos, size_t len, json_node_t *node) {
+    size_t start = pos + 1;
+    size_t end = start;
+    int has_escape = 0;
+
+    for (;;) {
+        const unsigned char *q = memchr(p + end, '"', len - end);
+        if (!q) return JSON_ERROR_STRING;
+        end = (size_t)(q - p);
+        size_t run = 0;
+        while (end - run > start && p[end - run - 1] == '\\') run++;
+        if (run) has_escape = 1;
+        if ((run & 1) == 0) break;
+        end++;
+    }
+    if (!has_escape && memchr(p + start, '\\', end - start)) has_escape = 1;
+
+    node->type = JSON_STRING;
+    if (has_escape) {
+        node->u.str = json_unescape(doc, p, start, end, &node->aux);
+        if (cap_is_null(node->u.str)) return JSON_ERROR_STRING;
+    } else {
+        node->u.str = cap_sub(input, start, end - start);   // Zero-copy view of the input
+        node->aux = (uint32_t)(end - start);
+    }
+    return JSON_OK;
+}
+
+static inline int json_parse_number(const unsigned char *p, size_t pos, size_t len,
+                                    json_node_t *node) {
+    size_t i = pos;
+    int negative = 0;
+    if (i < len && p[i] == '-') {
+        negative = 1;
+        i++;
+    }
+    if (i >= len || p[i] < '0' || p[i] > '9') return JSON_ERROR_NUMBER;
+    if (p[i] == '0' && i + 1 < len && p[i + 1] >= '0' && p[i + 1] <= '9') return JSON_ERROR_NUMBER;
+
+    uint64_t mantissa = 0;
+    size_t digits = 0;
+    while (i < len && p[i] >= '0' && p[i] <= '9') {
+        mantissa = mantissa * 10 + (uint64_t)(p[i] - '0');   // Wraps past 19 digits; see below
+        digits++;
+        i++;
+    }
+    int is_float = i < len && (p[i] == '.' || p[i] == 'e' || p[i] == 'E');
+
+    if (!is_float && digits <= 18) {   // Fits int64 without overflow checks
+        if (!json_is_value_end(p, i, len)) return JSON_ERROR_NUMBER;
+        node->type = JSON_INT;
+        node->u.i = negative ? -(int64_t)mantissa : (int64_t)mantissa;
+        return JSON_OK;
+    }
+
+    long exponent = 0;
+    if (i < len && p[i] == '.') {
+        i++;
+        if (i >= len || p[i] < '0' || p[i] > '9') return JSON_ERROR_NUMBER;
+        while (i < len && p[i] >= '0' && p[i] <= '9') {
+            mantissa = mantissa * 10 + (uint64_t)(p[i] - '0');
+            digits++;
+            exponent--;
+            i++;
+        }
+    }
+    if (i < len && (p[i] == 'e' || p[i] == 'E')) {
+        int exp_negative = 0;
+        long e = 0;
+        i++;
+        if (i < len && (p[i] == '+' || p[i] == '-')) exp_negative = p[i++] == '-';
+        if (i >= len || p[i] < '0' || p[i] > '9') return JSON_ERROR_NUMBER;
+        while (i < len && p[i] >= '0' && p[i] <= '9') {
+            if (e < 100000) e = e * 10 + (p[i] - '0');
+            i++;
+        }
+        exponent += exp_negative ? -e : e;
+    }
+    if (!json_is_value_end(p, i, len)) return JSON_ERROR_NUMBER;
+
+    node->type = JSON_DOUBLE;
+    // Clinger's fast path: both operands exact in a double, so one rounding
+    static const double pow10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+    };
+    if (digits <= 19 && mantissa <= (1ull << 53) && exponent >= -22 && exponent <= 22) {
+        double d = (double)mantissa;
+        d = exponent < 0 ? d / pow10[-exponent] : d * pow10[exponent];
+        node->u.d = negative ? -d : d;
+        return JSON_OK;
+    }
+
+    // Slow path: convert a NUL-terminated copy
+    char copy[64];
+    size_t n = i - pos;
+    if (n >= sizeof(copy)) return JSON_ERROR_NUMBER;
+    memcpy(copy, p + pos, n);
+    copy[n] = '\0';
+    node->u.d = strtod(copy, NULL);
+    return JSON_OK;
+}
+
+static inline int json_parse_literal(const unsigned char *p, size_t pos, size_t len,
+                                     json_node_t *node) {
+    static const struct { const char *text; size_t len; json_type_t type; } literals[] = {
+        { "true", 4, JSON_TRUE }, { "false", 5, JSON_FALSE }, { "null", 4, JSON_NULL },
+    };
+    for (size_t l = 0; l < 3; l++) {
+        if (p[pos] == literals[l].text[0]) {
+            if (len - pos < literals[l].len || memcmp(p + pos, literals[l].text, literals[l].len) != 0 ||
+                !json_is_value_end(p, pos + literals[l].len, len)) {
+                return JSON_ERROR_SYNTAX;
+            }
+            node->type = literals[l].type;
+            node->u.i = 0;
+            return JSON_OK;
+        }
+    }
+    return JSON_ERROR_SYNTAX;
+}
+
+static inline int json_doc_reserve(json_doc_t *doc, size_t len) {
+    size_t tape_needed = doc->index_count + 2;
+    if (tape_needed > doc->tape_capacity) {
+        json_node_t *tape = realloc(doc->tape, tape_needed * sizeof(json_node_t));
+        if (!tape) return -1;
+        doc->tape = tape;
+        doc->tape_capacity = tape_needed;
+    }
+    if (len > doc->strings_capacity || cap_is_null(doc->strings)) {
+        cap_free(doc->strings);
+        doc->strings_capacity = len ? len : 1;
+        doc->strings = cap_malloc(doc->strings_capacity);
+        if (cap_is_null(doc->strings)) return -1;
+    }
+    return 0;
+}
+
+typedef enum {
+    JSON_EXPECT_VALUE,          // Document start, after ':' or an array ','
+    JSON_EXPECT_VALUE_OR_CLOSE, // After '['
+    JSON_EXPECT_KEY_OR_CLOSE,   // After '{'
+    JSON_EXPECT_KEY,            // After an object ','
+    JSON_EXPECT_COLON,
+    JSON_EXPECT_COMMA_OR_CLOSE,
+    JSON_EXPECT_NOTHING         // Document complete
+} json_expect_t;
+
+// Build the tape from doc->indices
+static inline int json_stage2(cap_ptr_t input, size_t len, json_doc_t *doc) {
+    const unsigned char *p = (const unsigned char *)cap_check(input, 0, len);
+    uint32_t stack[JSON_MAX_DEPTH];
+    size_t depth = 0;
+    json_expect_t expect = JSON_EXPECT_VALUE;
+
+    if (json_doc_reserve(doc, len) != 0) return JSON_ERROR_MEMORY;
+    json_node_t *tape = doc->tape;
+    size_t t = 0;
+    doc->strings_len = 0;
+
+    for (size_t k = 0; k < doc->index_count; k++) {
+        size_t pos = doc->indices[k];
+        unsigned char c = p[pos];
+        int is_key = expect == JSON_EXPECT_KEY || expect == JSON_EXPECT_KEY_OR_CLOSE;
+
+        switch (c) {
+        case ':':
+            if (expect != JSON_EXPECT_COLON) return JSON_ERROR_SYNTAX;
+            expect = JSON_EXPECT_VALUE;
+            continue;
+        case ',':
+            if (expect != JSON_EXPECT_COMMA_OR_CLOSE || depth == 0) return JSON_ERROR_SYNTAX;
+            expect = tape[stack[depth - 1]].type == JSON_OBJECT ? JSON_EXPECT_KEY : JSON_EXPECT_VALUE;
+            continue;
+        case ']':
+        case '}': {
+            json_type_t open = c == ']' ? JSON_ARRAY : JSON_OBJECT;
+            if (depth == 0 || tape[stack[depth - 1]].type != open) return JSON_ERROR_SYNTAX;
+            if (expect != JSON_EXPECT_COMMA_OR_CLOSE &&
+                expect != (open == JSON_ARRAY ? JSON_EXPECT_VALUE_OR_CLOSE : JSON_EXPECT_KEY_OR_CLOSE)) {
+                return JSON_ERROR_SYNTAX;
+            }
+            uint32_t start = stack[--depth];
+            tape[start].aux = (uint32_t)t;
+            tape[t].type = JSON_END;
+            tape[t].aux = start;
+            tape[t].u.count = 0;
+            t++;
+            expect = depth ? JSON_EXPECT_COMMA_OR_CLOSE : JSON_EXPECT_NOTHING;
+            continue;
+        }
+        default:
+            break;
+        }
+
+        // A value (or an object key)
+        if (is_key) {
+            if (c != '"') return JSON_ERROR_SYNTAX;
+        } else if (expect != JSON_EXPECT_VALUE && expect != JSON_EXPECT_VALUE_OR_CLOSE) {
+            return JSON_ERROR_SYNTAX;
+        }
+        if (depth && !is_key) tape[stack[depth - 1]].u.count++;   // Members, not keys
+
+        json_node_t *node = &tape[t];
+        int rc = JSON_OK;
+        switch (c) {
+        case '[':
+        case '{':
+            if (depth == JSON_MAX_DEPTH) return JSON_ERROR_DEPTH;
+            node->type = c == '[' ? JSON_ARRAY : JSON_OBJECT;
+            node->u.count = 0;
+            stack[depth++] = (uint32_t)t;
+            t++;
+            expect = c == '[' ? JSON_EXPECT_VALUE_OR_CLOSE : JSON_EXPECT_KEY_OR_CLOSE;
+            continue;
+        case '"':
+            rc = json_parse_string(doc, input, p, pos, len, node);
+            break;
+        case 't':
+        case 'f':
+        case 'n':
+            rc = json_parse_literal(p, pos, len, node);
+            break;
+        default:
+            rc = json_parse_number(p, pos, len, node);
+            break;
+        }
+        if (rc != JSON_OK) return rc;
+        t++;
+        if (is_key) expect = JSON_EXPECT_COLON;
+        else expect = depth ? JSON_EXPECT_COMMA_OR_CLOSE : JSON_EXPECT_NOTHING;
+    }
+
+    doc->tape_len = t;
+    return expect == JSON_EXPECT_NOTHING ? JSON_OK : JSON_ERROR_SYNTAX;
+}
+
+// Parse the first len bytes of input; doc buffers are reused across calls
+static inline int json_parse(cap_ptr_t input, size_t len, json_doc_t *doc, json_scan_t scan) {
+    int rc = json_stage1(input, len, doc, scan);
+    return rc != JSON_OK ? rc : json_stage2(input, len, doc);
+}
+
+static inline void json_doc_free(json_doc_t *doc) {
+    free(doc->tape);
+    free(doc->indices);
+    cap_free(doc->strings);
+    memset(doc, 0, sizeof(*doc));
+}
+
+#endif // JSON_PARSER_H
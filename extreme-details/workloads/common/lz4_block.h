@@ -0,0 +1,308 @@
+/*
+ * LZ4 Block Codec - LZ4-compatible block format with a hash-chain match finder
+ *
+ * Compression walks 4-byte hash chains over a 64KB window (LZ4HC-style
+ * search depth) and emits standard LZ4 sequences, so the output decodes
+ * with any LZ4 block decompressor and vice versa.
+ *
+ * Two safe decoders are provided:
+ *   exact - every literal run and match copy is a bounds-checked access
+ *           through the destination capability, copying exactly its length
+ *   wild  - the reference decoder's fast path: literals and matches are
+ *           copied in whole 8-byte words and may run past the end of the
+ *           sequence, but only while the over-copy stays inside the
+ *           destination (and source) capability; near the end it falls back
+ *           to exact copies
+ * Overlapping matches (offset < 8) are widened to a multiple of the offset
+ * of at least 8 bytes so the word copies stay correct.
+ */
+
+#ifndef LZ4_BLOCK_H
+#define LZ4_BLOCK_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "capmodel.h"
+
+#define LZ4_MIN_MATCH     4
+#define LZ4_LAST_LITERALS 5     // The last 5 bytes are always literals
+#define LZ4_MF_LIMIT      12    // The last match starts at least 12 bytes before the end
+#define LZ4_MAX_OFFSET    65535
+#define LZ4_HASH_LOG      16
+#define LZ4_WILD_COPY     8     // Bytes moved per wild-copy step
+
+#define LZ4_ERROR (-1)
+
+// Worst-case compressed size of n input bytes
+#define LZ4_COMPRESS_BOUND(n) ((n) + (n) / 255 + 16)
+
+typedef enum {
+    LZ4_DECODE_EXACT = 0,
+    LZ4_DECODE_WILD,
+    LZ4_DECODE_MODES
+} lz4_decode_t;
+
+static inline const char *lz4_decode_name(lz4_decode_t mode) {
+    static const char *const names[LZ4_DECODE_MODES] = { "exact", "wild" };
+    return mode < LZ4_DECODE_MODES ? names[mode] : "unknown";
+}
+
+// Match finder state, reusable across calls
+typedef struct {
+    int32_t head[1 << LZ4_HASH_LOG];    // Most recent position per hash
+    uint16_t chain[LZ4_MAX_OFFSET + 1]; // Distance to the previous position with the same hash
+    int search_depth;                   // Candidates examined per position
+} lz4_matcher_t;
+
+static inline uint32_t lz4_read32(const unsigned char *p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static inline uint32_t lz4_hash(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - LZ4_HASH_LOG);
+}
+
+// ---------------------------------------------------------------------------
+// Compression
+// ---------------------------------------------------------------------------
+
+static inline void lz4_matcher_insert(lz4_matcher_t *m, const unsigned char *in, int32_t pos) {
+    uint32_t h = lz4_hash(lz4_read32(in + pos));
+    int32_t prev = m->head[h];
+    size_t delta = prev >= 0 ? (size_t)(pos - prev) : 0;
+    m->chain[pos & LZ4_MAX_OFFSET] = delta > LZ4_MAX_OFFSET ? 0 : (uint16_t)delta;
+    m->head[h] = pos;
+}
+
+// Longest match for pos within the window; returns its length (0 if < MIN_MATCH)
+static inline size_t lz4_find_match(const lz4_matcher_t *m, const unsigned char *in, int32_t pos,
+                                    size_t match_limit, int32_t *match_pos) {
+    uint32_t sequence = lz4_read32(in + pos);
+    int32_t candidate = m->head[lz4_hash(sequence)];
+    size_t best = 0;
+
+    for (int attempts = m->search_depth; attempts > 0 && candidate >= 0; attempts--) {
+        if (pos - candidate > LZ4_MAX_OFFSET) break;
+        if (lz4_read32(in + candidate) == sequence && in[candidate + best] == in[pos + best]) {
+            size_t len = LZ4_MIN_MATCH;
+            while (pos + len < match_limit && in[candidate + len] == in[pos + len]) len++;
+            if (len > best) {
+                best = len;
+                *match_pos = candidate;
+            }
+        }
+        uint16_t delta = m->chain[candidate & LZ4_MAX_OFFSET];
+        if (delta == 0) break;
+        candidate -= delta;
+    }
+    return best >= LZ4_MIN_MATCH ? best : 0;
+}
+
+static inline unsigned char *lz4_write_length(unsigned char *op, size_t len) {
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = (unsigned char)len;
+    return op;
+}
+
+static inline unsigned char *lz4_emit_sequence(unsigned char *op, const unsigned char *literals,
+                                               size_t literal_len, size_t offset, size_t match_len) {
+    unsigned char *token = op++;
+    *token = (unsigned char)((literal_len >= 15 ? 15 : literal_len) << 4);
+    if (literal_len >= 15) op = lz4_write_length(op, literal_len - 15);
+    memcpy(op, literals, literal_len);
+    op += literal_len;
+    if (match_len == 0) return op;   // Final literal-only sequence
+
+    *op++ = (unsigned char)(offset & 0xFF);
+    *op++ = (unsigned char)(offset >> 8);
+    size_t ml = match_len - LZ4_MIN_MATCH;
+    *token |= (unsigned char)(ml >= 15 ? 15 : ml);
+    if (ml >= 15) op = lz4_write_length(op, ml - 15);
+    return op;
+}
+
+/*
+ * Compress src[0, src_len) into dst, which must hold LZ4_COMPRESS_BOUND(src_len)
+ * bytes. Returns the compressed size or LZ4_ERROR.
+ */
+static inline long lz4_compress(lz4_matcher_t *m, cap_ptr_t src, size_t src_len,
+                                cap_ptr_t dst, size_t dst_capacity) {
+    if (src_len > INT32_MAX || dst_capacity < LZ4_COMPRESS_BOUND(src_len)) return LZ4_ERROR;
+    const unsigned char *in = (const unsigned char *)cap_check(src, 0, src_len);
+    unsigned char *out = (unsigned char *)cap_check(dst, 0, dst_capacity);
+    unsigned char *op = out;
+    size_t anchor = 0;
+
+    memset(m->head, 0xFF, sizeof(m->head));   // Every head = -1
+
+    if (src_len > LZ4_MF_LIMIT) {
+        size_t mf_limit = src_len - LZ4_MF_LIMIT;
+        size_t match_limit = src_len - LZ4_LAST_LITERALS;
+        size_t inserted = 0;
+        size_t pos = 0;
+
+        while (pos < mf_limit) {
+            while (inserted < pos) lz4_matcher_insert(m, in, (int32_t)inserted++);
+
+            int32_t match_pos = 0;
+            size_t len = lz4_find_match(m, in, (int32_t)pos, match_limit, &match_pos);
+            if (len == 0) {
+                pos++;
+                continue;
+            }
+            // Extend backwards into the pending literals
+            while (pos > anchor && match_pos > 0 && in[pos - 1] == in[match_pos - 1]) {
+                pos--;
+                match_pos--;
+                len++;
+            }
+            op = lz4_emit_sequence(op, in + anchor, pos - anchor, pos - (size_t)match_pos, len);
+            pos += len;
+            anchor = pos;
+        }
+    }
+    op = lz4_emit_sequence(op, in + anchor, src_len - anchor, 0, 0);
+    return (long)(op - out);
+}
+
+// ---------------------------------------------------------------------------
+// Decompression
+// ---------------------------------------------------------------------------
+
+// Read a 255-continued length extension; returns 0 on truncated input
+static inline int lz4_read_length(const unsigned char *in, size_t *ip, size_t in_len, size_t *len) {
+    unsigned char b;
+    do {
+        if (*ip >= in_len) return 0;
+        b = in[(*ip)++];
+        *len += b;
+    } while (b == 255);
+    return 1;
+}
+
+/*
+ * Every copy goes through cap_check with its exact length: the
+ * straightforward port of a decoder onto bounded pointers.
+ */
+static inline long lz4_decompress_exact(cap_ptr_t src, size_t src_len, cap_ptr_t dst,
+                                        size_t dst_capacity) {
+    size_t ip = 0, op = 0;
+
+    while (ip < src_len) {
+        unsigned char token = *(const unsigned char *)cap_check(src, ip++, 1);
+        size_t literal_len = token >> 4;
+        if (literal_len == 15 &&
+            !lz4_read_length((const unsigned char *)cap_check(src, 0, src_len), &ip, src_len, &literal_len)) {
+            return LZ4_ERROR;
+        }
+        if (literal_len > src_len - ip || literal_len > dst_capacity - op) return LZ4_ERROR;
+        memcpy(cap_check(dst, op, literal_len), cap_check(src, ip, literal_len), literal_len);
+        ip += literal_len;
+        op += literal_len;
+        if (ip == src_len) break;   // Final literal-only sequence
+
+        if (src_len - ip < 2) return LZ4_ERROR;
+        const unsigned char *o = (const unsigned char *)cap_check(src, ip, 2);
+        size_t offset = (size_t)o[0] | ((size_t)o[1] << 8);
+        ip += 2;
+        size_t match_len = token & 15;
+        if (match_len == 15 &&
+            !lz4_read_length((const unsigned char *)cap_check(src, 0, src_len), &ip, src_len, &match_len)) {
+            return LZ4_ERROR;
+        }
+        match_len += LZ4_MIN_MATCH;
+        if (offset == 0 || offset > op || match_len > dst_capacity - op) return LZ4_ERROR;
+
+        unsigned char *d = (unsigned char *)cap_check(dst, op, match_len);
+        const unsigned char *s = (const unsigned char *)cap_check(dst, op - offset, match_len);
+        if (offset >= match_len) {
+            memcpy(d, s, match_len);
+        } else {
+            for (size_t i = 0; i < match_len; i++) d[i] = s[i];   // Source is written as it is read
+        }
+        op += match_len;
+    }
+    return (long)op;
+}
+
+static inline void lz4_copy8(unsigned char *d, const unsigned char *s) {
+    memcpy(d, s, 8);
+}
+
+/*
+ * Wild-copy fast path. Bounds are established once per buffer; each copy
+ * then moves whole words past the end of the run when, and only when, the
+ * over-copy still lies inside the destination capability (dst_capacity is
+ * checked against the capability on entry).
+ */
+static inline long lz4_decompress_wild(cap_ptr_t src, size_t src_len, cap_ptr_t dst,
+                                       size_t dst_capacity) {
+    const unsigned char *in = (const unsigned char *)cap_check(src, 0, src_len);
+    unsigned char *out = (unsigned char *)cap_check(dst, 0, dst_capacity);
+    size_t ip = 0, op = 0;
+
+    while (ip < src_len) {
+        unsigned char token = in[ip++];
+        size_t literal_len = token >> 4;
+        if (literal_len == 15 && !lz4_read_length(in, &ip, src_len, &literal_len)) return LZ4_ERROR;
+        if (literal_len > src_len - ip || literal_len > dst_capacity - op) return LZ4_ERROR;
+
+        // Round the copy up to whole words if both sides have the slack
+        size_t wild_len = (literal_len + LZ4_WILD_COPY - 1) & ~(size_t)(LZ4_WILD_COPY - 1);
+        if (wild_len <= src_len - ip && wild_len <= dst_capacity - op) {
+            for (size_t i = 0; i < wild_len; i += LZ4_WILD_COPY) lz4_copy8(out + op + i, in + ip + i);
+        } else {
+            memcpy(out + op, in + ip, literal_len);
+        }
+        ip += literal_len;
+        op += literal_len;
+        if (ip == src_len) break;
+
+        if (src_len - ip < 2) return LZ4_ERROR;
+        size_t offset = (size_t)in[ip] | ((size_t)in[ip + 1] << 8);
+        ip += 2;
+        size_t match_len = token & 15;
+        if (match_len == 15 && !lz4_read_length(in, &ip, src_len, &match_len)) return LZ4_ERROR;
+        match_len += LZ4_MIN_MATCH;
+        if (offset == 0 || offset > op || match_len > dst_capacity - op) return LZ4_ERROR;
+
+        unsigned char *d = out + op;
+        const unsigned char *s = d - offset;
+        wild_len = (match_len + LZ4_WILD_COPY - 1) & ~(size_t)(LZ4_WILD_COPY - 1);
+        if (wild_len > dst_capacity - op) {
+            for (size_t i = 0; i < match_len; i++) d[i] = s[i];   // Tail: exact, overlap-safe
+        } else {
+            size_t i = 0, distance = offset;
+            if (offset < LZ4_WILD_COPY) {
+                // Seed one word bytewise, then copy from the smallest multiple
+                // of offset that is at least a word: same pattern, and no word
+                // copy overlaps itself
+                for (; i < LZ4_WILD_COPY; i++) d[i] = s[i];
+                distance = offset * ((LZ4_WILD_COPY + offset - 1) / offset);
+            }
+            for (; i < wild_len; i += LZ4_WILD_COPY) lz4_copy8(d + i, d + i - distance);
+        }
+        op += match_len;
+    }
+    return (long)op;
+}
+
+/*
+ * Decode src into dst; dst_capacity may not exceed the destination
+ * capability. Returns the decompressed size or LZ4_ERROR on malformed input.
+ */
+static inline long lz4_decompress(cap_ptr_t src, size_t src_len, cap_ptr_t dst,
+                                  size_t dst_capacity, lz4_decode_t mode) {
+    if (mode == LZ4_DECODE_WILD) return lz4_decompress_wild(src, src_len, dst, dst_capacity);
+    return lz4_decompress_exact(src, src_len, dst, dst_capacity);
+}
+
+#endif // LZ4_BLOCK_H
@@ -0,0 +1,147 @@
+/*
+ * Type-Stable Node Pool - Fixed-size nodes carved from large chunks
+ *
+ * Every slot of a pool holds one node type for the pool's lifetime: freed
+ * nodes go onto the pool's free list and are only ever handed out again as
+ * the same type, never back to malloc, so a stale capability still points
+ * at a well-formed node. Each node is returned as a capability bounded to
+ * its slot, carved out of a chunk of NP_CHUNK_BYTES or more.
+ *
+ * np_relinearize() copies a linked list into fresh, consecutive slots in
+ * traversal order and rewrites each next capability to the following
+ * copy, so a later walk streams through memory instead of chasing
+ * pointers across the heap.
+ */
+
+#ifndef NODE_POOL_H
+#define NODE_POOL_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "capmodel.h"
+
+#define NP_CHUNK_BYTES  (4u << 20)
+
+typedef struct {
+    size_t object_size;     // Bytes copied when a node moves
+    size_t slot_size;       // object_size rounded up to capability alignment
+    size_t chunk_slots;     // Slots per chunk
+    size_t last_slots;      // Slots in the last chunk (larger for np_relinearize)
+    cap_ptr_t *chunks;
+    size_t chunk_count;
+    size_t chunk_capacity;
+    size_t bump;            // Next never-used slot in the last chunk
+    cap_ptr_t free_list;    // Freed slots, linked through their first word
+    size_t live;            // Nodes handed out and not freed
+} np_pool_t;
+
+static inline void np_init(np_pool_t *p, size_t object_size) {
+    size_t align = sizeof(cap_ptr_t);
+    memset(p, 0, sizeof(*p));
+    p->object_size = object_size;
+    p->slot_size = (object_size < align ? align : object_size + align - 1) / align * align;
+    p->chunk_slots = NP_CHUNK_BYTES / p->slot_size;
+    if (p->chunk_slots == 0) p->chunk_slots = 1;
+    p->free_list = CAP_NULL;
+}
+
+// Add a chunk of at least min_slots slots; returns 0 on success
+static inline int np_grow(np_pool_t *p, size_t min_slots) {
+    size_t slots = min_slots > p->chunk_slots ? min_slots : p->chunk_slots;
+    if (p->chunk_count == p->chunk_capacity) {
+        size_t capacity = p->chunk_capacity ? 2 * p->chunk_capacity : 16;
+        cap_ptr_t *chunks = (cap_ptr_t *)realloc(p->chunks, capacity * sizeof(cap_ptr_t));
+        if (!chunks) return -1;
+        p->chunks = chunks;
+        p->chunk_capacity = capacity;
+    }
+    cap_ptr_t chunk = cap_malloc(slots * p->slot_size);
+    if (cap_is_null(chunk)) return -1;
+    p->chunks[p->chunk_count++] = chunk;
+    p->last_slots = slots;
+    p->bump = 0;
+    return 0;
+}
+
+// Next never-used slot; consecutive calls return adjacent slots within a chunk
+static inline cap_ptr_t np_alloc_fresh(np_pool_t *p) {
+    if (p->bump == p->last_slots && np_grow(p, 0) != 0) return CAP_NULL;
+    cap_ptr_t chunk = p->chunks[p->chunk_count - 1];
+    cap_ptr_t node = cap_sub(chunk, p->bump * p->slot_size, p->slot_size);
+    p->bump++;
+    p->live++;
+    return node;
+}
+
+// A recycled slot if there is one, otherwise a fresh one
+static inline cap_ptr_t np_alloc(np_pool_t *p) {
+    if (!cap_is_null(p->free_list)) {
+        cap_ptr_t node = p->free_list;
+        p->free_list = *(cap_ptr_t *)cap_check(node, 0, sizeof(cap_ptr_t));
+        p->live++;
+        return node;
+    }
+    return np_alloc_fresh(p);
+}
+
+static inline void np_free(np_pool_t *p, cap_ptr_t node) {
+    *(cap_ptr_t *)cap_check(node, 0, sizeof(cap_ptr_t)) = p->free_list;
+    p->free_list = node;
+    p->live--;
+}
+
+// Release every chunk; all nodes of the pool become invalid
+static inline void np_destroy(np_pool_t *p) {
+    for (size_t i = 0; i < p->chunk_count; i++) cap_free(p->chunks[i]);
+    free(p->chunks);
+    memset(p, 0, sizeof(*p));
+}
+
+/*
+ * Copy the list starting at head into consecutive fresh slots of dst, in
+ * traversal order, linking each copy to the next through the capability
+ * at next_offset. Each original node is released to src, or with
+ * cap_free() when src is NULL (malloc-built lists). count, if known, lets
+ * the copies go into one chunk. Returns the new head; on allocation
+ * failure the original list is left intact and CAP_NULL is returned.
+ */
+static inline cap_ptr_t np_relinearize(np_pool_t *dst, np_pool_t *src, cap_ptr_t head,
+                                       size_t next_offset, size_t count) {
+    if (cap_is_null(head)) return CAP_NULL;
+    if (count > dst->last_slots - dst->bump && np_grow(dst, count) != 0) return CAP_NULL;
+
+    // First pass copies, so a failure part-way leaves the original untouched
+    cap_ptr_t new_head = CAP_NULL, prev = CAP_NULL;
+    size_t copied = 0;
+    for (cap_ptr_t p = head; !cap_is_null(p);
+         p = *(cap_ptr_t *)cap_check(p, next_offset, sizeof(cap_ptr_t))) {
+        cap_ptr_t copy = np_alloc_fresh(dst);
+        if (cap_is_null(copy)) {
+            // Roll back: copies are never handed out, so freeing them is enough
+            for (cap_ptr_t c = new_head; copied--; ) {
+                cap_ptr_t next = *(cap_ptr_t *)cap_check(c, next_offset, sizeof(cap_ptr_t));
+                np_free(dst, c);
+                c = next;
+            }
+            return CAP_NULL;
+        }
+        memcpy(cap_check(copy, 0, dst->object_size), cap_check(p, 0, dst->object_size), dst->object_size);
+        if (cap_is_null(prev)) new_head = copy;
+        else *(cap_ptr_t *)cap_check(prev, next_offset, sizeof(cap_ptr_t)) = copy;
+        prev = copy;
+        copied++;
+    }
+    *(cap_ptr_t *)cap_check(prev, next_offset, sizeof(cap_ptr_t)) = CAP_NULL;
+
+    for (cap_ptr_t p = head; !cap_is_null(p); ) {
+        cap_ptr_t next = *(cap_ptr_t *)cap_check(p, next_offset, sizeof(cap_ptr_t));
+        if (src) np_free(src, p);
+        else cap_free(p);
+        p = next;
+    }
+    return new_head;
+}
+
+#endif // NODE_POOL_H
@@ -0,0 +1,227 @@
+/*
+ * Minimal pcap Reader - Classic libpcap capture files, no libpcap dependency
+ *
+ * Iterates over records of an in-memory capture and extracts TCP payloads
+ * from Ethernet/IPv4 frames (optionally 802.1Q tagged). The synthetic side,
+ * shared by the workloads that run without a capture, builds such frames
+ * around generated browser/API-style HTTP requests.
+ */
+
+#ifndef PCAP_H
+#define PCAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bench.h"
+
+#define PCAP_GLOBAL_HEADER_LEN 24
+#define PCAP_RECORD_HEADER_LEN 16
+#define PCAP_LINKTYPE_ETHERNET 1
+#define PCAP_FRAME_HEADER_LEN  54     // Ethernet + IPv4 + TCP, no options
+
+typedef struct {
+    int swapped;        // File written with the opposite byte order
+    uint32_t linktype;
+    size_t pos;         // Offset of the next record
+} pcap_reader_t;
+
+typedef struct {
+    uint32_t ts_sec;
+    uint32_t ts_frac;   // Microseconds (or nanoseconds for 0xa1b23c4d files)
+    const unsigned char *frame;
+    size_t caplen;
+} pcap_record_t;
+
+static inline uint32_t pcap_u32(const unsigned char *p, int swapped) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return swapped ? __builtin_bswap32(v) : v;
+}
+
+// Validate the global header; returns 0 on success
+static inline int pcap_open(pcap_reader_t *r, const unsigned char *data, size_t len) {
+    if (len < PCAP_GLOBAL_HEADER_LEN) return -1;
+    uint32_t magic;
+    memcpy(&magic, data, 4);
+    if (magic == 0xa1b2c3d4u || magic == 0xa1b23c4du) {
+        r->swapped = 0;
+    } else if (magic == 0xd4c3b2a1u || magic == 0x4d3cb2a1u) {
+        r->swapped = 1;
+    } else {
+        return -1;
+    }
+    r->linktype = pcap_u32(data + 20, r->swapped);
+    r->pos = PCAP_GLOBAL_HEADER_LEN;
+    return 0;
+}
+
+// Fetch the next record; returns 1 if one was read, 0 at end of data
+static inline int pcap_next(pcap_reader_t *r, const unsigned char *data, size_t len,
+                            pcap_record_t *rec) {
+    if (r->pos + PCAP_RECORD_HEADER_LEN > len) return 0;
+    const unsigned char *h = data + r->pos;
+    uint32_t caplen = pcap_u32(h + 8, r->swapped);
+    if (caplen > len - r->pos - PCAP_RECORD_HEADER_LEN) return 0;  // Truncated capture
+
+    rec->ts_sec = pcap_u32(h, r->swapped);
+    rec->ts_frac = pcap_u32(h + 4, r->swapped);
+    rec->frame = h + PCAP_RECORD_HEADER_LEN;
+    rec->caplen = caplen;
+    r->pos += PCAP_RECORD_HEADER_LEN + caplen;
+    return 1;
+}
+
+// Locate the TCP payload of an Ethernet frame; returns 0 and fills off/len on success
+static inline int pcap_tcp_payload(const unsigned char *frame, size_t caplen,
+                                   size_t *payload_off, size_t *payload_len) {
+    size_t pos = 14;
+    if (caplen < pos) return -1;
+    uint16_t ethertype = (uint16_t)((frame[12] << 8) | frame[13]);
+    if (ethertype == 0x8100) {  // 802.1Q VLAN tag
+        if (caplen < pos + 4) return -1;
+        ethertype = (uint16_t)((frame[16] << 8) | frame[17]);
+        pos += 4;
+    }
+    if (ethertype != 0x0800 || caplen < pos + 20) return -1;
+
+    const unsigned char *ip = frame + pos;
+    size_t ip_header_len = (size_t)(ip[0] & 0x0F) * 4;
+    size_t ip_total_len = (size_t)((ip[2] << 8) | ip[3]);
+    if ((ip[0] >> 4) != 4 || ip[9] != 6 || ip_header_len < 20 ||
+        ip_total_len < ip_header_len || caplen < pos + ip_header_len + 20) {
+        return -1;
+    }
+
+    const unsigned char *tcp = ip + ip_header_len;
+    size_t tcp_header_len = (size_t)(tcp[12] >> 4) * 4;
+    size_t start = pos + ip_header_len + tcp_header_len;
+    size_t end = pos + ip_total_len;   // Excludes Ethernet padding
+    if (tcp_header_len < 20 || start > end) return -1;
+    if (end > caplen) end = caplen;
+    if (start > end) return -1;
+
+    *payload_off = start;
+    *payload_len = end - start;
+    return 0;
+}
+
+// Payload starts with an HTTP request method
+static inline int pcap_is_http_request(const unsigned char *p, size_t len) {
+    static const char *const methods[] = { "GET ", "POST ", "PUT ", "HEAD ", "DELETE ", "OPTIONS ", "PATCH " };
+    for (size_t i = 0; i < sizeof(methods) / sizeof(methods[0]); i++) {
+        size_t m = strlen(methods[i]);
+        if (len > m && memcmp(p, methods[i], m) == 0) return 1;
+    }
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Synthetic traffic
+// ---------------------------------------------------------------------------
+
+static inline void pcap_put_be16(unsigned char *p, unsigned v) {
+    p[0] = (unsigned char)(v >> 8);
+    p[1] = (unsigned char)v;
+}
+
+// Ethernet/IPv4/TCP frame around payload; returns the frame length
+static inline size_t pcap_build_frame(unsigned char *frame, const char *payload, size_t payload_len,
+                                      unsigned port) {
+    memset(frame, 0, PCAP_FRAME_HEADER_LEN);
+    memcpy(frame, "\x02\x00\x00\x00\x00\x01\x02\x00\x00\x00\x00\x02", 12);
+    pcap_put_be16(frame + 12, 0x0800);
+    unsigned char *ip = frame + 14;
+    ip[0] = 0x45;
+    pcap_put_be16(ip + 2, (unsigned)(20 + 20 + payload_len));
+    ip[8] = 64;
+    ip[9] = 6;
+    memcpy(ip + 12, "\x0a\x00\x00\x01\x0a\x00\x00\x02", 8);
+    unsigned char *tcp = ip + 20;
+    pcap_put_be16(tcp, port);
+    pcap_put_be16(tcp + 2, 80);
+    tcp[12] = 5 << 4;
+    tcp[13] = 0x18;  // PSH|ACK
+    memcpy(frame + PCAP_FRAME_HEADER_LEN, payload, payload_len);
+    return PCAP_FRAME_HEADER_LEN + payload_len;
+}
+
+static inline size_t pcap_append(char *buf, size_t cap, size_t pos, const char *text) {
+    size_t len = strlen(text);
+    if (pos + len < cap) {
+        memcpy(buf + pos, text, len);
+        pos += len;
+    }
+    return pos;
+}
+
+static inline size_t pcap_append_random(char *buf, size_t cap, size_t pos, size_t count, uint64_t *rng) {
+    static const char alphabet[] =
+        "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789-_=";
+    for (size_t i = 0; i < count && pos + 1 < cap; i++) {
+        buf[pos++] = alphabet[bench_rng_next(rng) % (sizeof(alphabet) - 1)];
+    }
+    return pos;
+}
+
+// Browser/API-style request into buf (cap bytes, at least 2 KB); returns its length
+static inline size_t pcap_generate_request(char *buf, size_t cap, uint64_t *rng) {
+    static const char *const user_agents[] = {
+        "Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/120.0.0.0 Safari/537.36",
+        "Mozilla/5.0 (Macintosh; Intel Mac OS X 14_2) AppleWebKit/605.1.15 (KHTML, like Gecko) Version/17.2 Safari/605.1.15",
+        "curl/8.5.0",
+        "python-requests/2.31.0",
+    };
+    char line[256];
+    size_t pos = 0;
+    unsigned pick = (unsigned)(bench_rng_next(rng) % 100);
+    int is_post = pick >= 70 && pick < 90;
+    const char *method = pick < 70 ? "GET" : is_post ? "POST" : pick < 95 ? "PUT" : "DELETE";
+
+    snprintf(line, sizeof(line), "%s /api/v%u/users/%u/items", method,
+             (unsigned)(bench_rng_next(rng) % 3) + 1, (unsigned)(bench_rng_next(rng) % 1000000));
+    pos = pcap_append(buf, cap, pos, line);
+    if (bench_rng_next(rng) % 2) {
+        pos = pcap_append(buf, cap, pos, "?page=");
+        pos = pcap_append_random(buf, cap, pos, 1 + bench_rng_next(rng) % 3, rng);
+        pos = pcap_append(buf, cap, pos, "&sort=");
+        pos = pcap_append_random(buf, cap, pos, 4 + bench_rng_next(rng) % 24, rng);
+    }
+    pos = pcap_append(buf, cap, pos, " HTTP/1.1\r\nHost: service.example.com\r\n");
+    pos = pcap_append(buf, cap, pos, "User-Agent: ");
+    pos = pcap_append(buf, cap, pos, user_agents[bench_rng_next(rng) % 4]);
+    pos = pcap_append(buf, cap, pos, "\r\nAccept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+                                     "Accept-Language: en-US,en;q=0.5\r\n"
+                                     "Accept-Encoding: gzip, deflate, br\r\n"
+                                     "Connection: keep-alive\r\n");
+    if (bench_rng_next(rng) % 3 != 0) {
+        pos = pcap_append(buf, cap, pos, "Cookie: session=");
+        pos = pcap_append_random(buf, cap, pos, 16 + bench_rng_next(rng) % 400, rng);
+        pos = pcap_append(buf, cap, pos, "\r\n");
+    }
+    if (bench_rng_next(rng) % 2) {
+        pos = pcap_append(buf, cap, pos, "Authorization: Bearer ");
+        pos = pcap_append_random(buf, cap, pos, 64 + bench_rng_next(rng) % 96, rng);
+        pos = pcap_append(buf, cap, pos, "\r\n");
+    }
+    pos = pcap_append(buf, cap, pos, "X-Request-Id: ");
+    pos = pcap_append_random(buf, cap, pos, 32, rng);
+    pos = pcap_append(buf, cap, pos, "\r\n");
+
+    if (is_post) {
+        size_t body_len = 20 + bench_rng_next(rng) % 2000;
+        snprintf(line, sizeof(line), "Content-Type: application/json\r\nContent-Length: %zu\r\n\r\n",
+                 body_len);
+        pos = pcap_append(buf, cap, pos, line);
+        buf[pos++] = '{';
+        pos = pcap_append_random(buf, cap, pos, body_len - 2, rng);
+        buf[pos++] = '}';
+    } else {
+        pos = pcap_append(buf, cap, pos, "\r\n");
+    }
+    return pos;
+}
+
+#endif // PCAP_H
@@ -0,0 +1,134 @@
+/*
+ * Region Allocator - Bump allocation for objects that die together
+ *
+ * Per-packet and per-request objects are carved from large chunks by
+ * bumping an offset, each as a capability bounded to exactly its bytes,
+ * and are all released at once by region_reset(). Two reset flavours:
+ *   plain    - O(1): rewind to the first chunk and keep every chunk, so
+ *              the next request reuses the same (cache-warm) memory.
+ *              Capabilities from before the reset stay dereferenceable.
+ *   revoking - hand the chunks back to malloc and start over with fresh
+ *              ones. Under CheriBSD's heap temporal safety, free()
+ *              quarantines the chunks and revocation sweeps away every
+ *              capability still pointing into them before they can be
+ *              reused, so the whole region is revoked in one step.
+ * Objects larger than a quarter chunk get a chunk of their own, which is
+ * released by either kind of reset.
+ */
+
+#ifndef REGION_H
+#define REGION_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "capmodel.h"
+
+#define REGION_DEFAULT_CHUNK    (64 * 1024)
+#define REGION_ALIGN            sizeof(cap_ptr_t)   // Objects may hold capabilities
+
+typedef struct {
+    size_t chunk_size;
+    int revoke_on_reset;
+    cap_ptr_t *chunks;          // Standard chunks, reused in order after a plain reset
+    size_t chunk_count;
+    size_t chunk_capacity;
+    size_t current;             // Chunk being carved
+    size_t offset;              // Next free byte in it
+    cap_ptr_t *large;           // Dedicated chunks for oversized objects
+    size_t large_count;
+    size_t large_capacity;
+
+    // Statistics
+    uint64_t allocations;
+    uint64_t bytes;             // Requested bytes, before alignment
+    uint64_t fresh_bytes;       // Chunk bytes obtained from malloc
+    uint64_t resets;
+    size_t held_bytes;          // Chunk bytes currently owned
+    size_t peak_bytes;
+} region_t;
+
+static inline void region_init(region_t *r, size_t chunk_size, int revoke_on_reset) {
+    memset(r, 0, sizeof(*r));
+    r->chunk_size = chunk_size ? chunk_size : REGION_DEFAULT_CHUNK;
+    r->revoke_on_reset = revoke_on_reset;
+}
+
+static inline int region_push(cap_ptr_t **list, size_t *count, size_t *capacity, cap_ptr_t chunk) {
+    if (*count == *capacity) {
+        size_t grown = *capacity ? 2 * *capacity : 8;
+        cap_ptr_t *bigger = (cap_ptr_t *)realloc(*list, grown * sizeof(cap_ptr_t));
+        if (!bigger) return -1;
+        *list = bigger;
+        *capacity = grown;
+    }
+    (*list)[(*count)++] = chunk;
+    return 0;
+}
+
+static inline cap_ptr_t region_new_chunk(region_t *r, size_t size, cap_ptr_t **list, size_t *count,
+                                         size_t *capacity) {
+    cap_ptr_t chunk = cap_malloc(size);
+    if (cap_is_null(chunk)) return CAP_NULL;
+    if (region_push(list, count, capacity, chunk) != 0) {
+        cap_free(chunk);
+        return CAP_NULL;
+    }
+    r->fresh_bytes += size;
+    r->held_bytes += size;
+    if (r->held_bytes > r->peak_bytes) r->peak_bytes = r->held_bytes;
+    return chunk;
+}
+
+// Object of size bytes, bounded to exactly that size; CAP_NULL if out of memory
+static inline cap_ptr_t region_alloc(region_t *r, size_t size) {
+    size_t need = (size + REGION_ALIGN - 1) & ~(REGION_ALIGN - 1);
+    r->allocations++;
+    r->bytes += size;
+    if (need > r->chunk_size / 4) {
+        cap_ptr_t chunk = region_new_chunk(r, need ? need : REGION_ALIGN, &r->large, &r->large_count,
+                                           &r->large_capacity);
+        return cap_is_null(chunk) ? CAP_NULL : cap_sub(chunk, 0, size);
+    }
+    if (r->chunk_count == 0 || r->offset + need > r->chunk_size) {
+        // Move on to the next retained chunk, or grow the region
+        if (r->chunk_count > 0 && r->current + 1 < r->chunk_count) {
+            r->current++;
+        } else if (cap_is_null(region_new_chunk(r, r->chunk_size, &r->chunks, &r->chunk_count,
+                                                &r->chunk_capacity))) {
+            return CAP_NULL;
+        } else {
+            r->current = r->chunk_count - 1;
+        }
+        r->offset = 0;
+    }
+    cap_ptr_t object = cap_sub(r->chunks[r->current], r->offset, size);
+    r->offset += need;
+    return object;
+}
+
+// Free every object of the region at once
+static inline void region_reset(region_t *r) {
+    for (size_t i = 0; i < r->large_count; i++) cap_free(r->large[i]);
+    r->large_count = 0;
+    if (r->revoke_on_reset) {
+        for (size_t i = 0; i < r->chunk_count; i++) cap_free(r->chunks[i]);
+        r->chunk_count = 0;
+    }
+    r->held_bytes = r->chunk_count * r->chunk_size;
+    r->current = 0;
+    r->offset = 0;
+    r->resets++;
+}
+
+static inline void region_destroy(region_t *r) {
+    r->revoke_on_reset = 1;
+    region_reset(r);
+    free(r->chunks);
+    free(r->large);
+    r->chunks = r->large = NULL;
+    r->chunk_capacity = r->large_capacity = 0;
+}
+
+#endif // REGION_H
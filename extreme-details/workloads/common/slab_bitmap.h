@@ -0,0 +1,186 @@
+/*
+ * Slab Allocator with Allocation-State Bitmaps - O(1) free() validation
+ *
+ * One contiguous arena is split into SLAB_CHUNK_BYTES chunks, and each
+ * chunk serves one power-of-two size class (16 B to 4 KB). The state of
+ * every slot lives out of line, one bit per slot in a bitmap beside the
+ * arena, so nothing a program writes through a stale or forged reference
+ * can corrupt it, and slab_free() validates its argument in constant time
+ * with no search:
+ *   - the address must be inside the arena, in a chunk that is in use,
+ *     and on a slot boundary of that chunk's class
+ *   - capability builds: the capability must carry exactly the slot's
+ *     bounds, with offset 0 (CHERI) or length (softcap) matching, so an
+ *     interior or narrowed view cannot free the object
+ *   - the slot's bit must be set; a clear bit is a double free
+ * Allocation takes the first clear bit of a chunk with free slots (each
+ * class keeps a list of them), and every object comes back as a
+ * capability bounded to its slot. Chunks stay with their class once used.
+ */
+
+#ifndef SLAB_BITMAP_H
+#define SLAB_BITMAP_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "capmodel.h"
+
+#define SLAB_CHUNK_SHIFT    20                          // 1 MB chunks
+#define SLAB_CHUNK_BYTES    ((size_t)1 << SLAB_CHUNK_SHIFT)
+#define SLAB_MIN_SHIFT      4                           // 16-byte slots hold a capability
+#define SLAB_MAX_SHIFT      12                          // 4 KB slots
+#define SLAB_CLASS_COUNT    (SLAB_MAX_SHIFT - SLAB_MIN_SHIFT + 1)
+#define SLAB_CHUNK_WORDS    ((SLAB_CHUNK_BYTES >> SLAB_MIN_SHIFT) / 64)   // Bitmap words per chunk
+#define SLAB_NONE           UINT32_MAX
+
+typedef enum {
+    SLAB_OK = 0,
+    SLAB_INVALID_FREE,      // Not the start of a slot handed out by this slab
+    SLAB_DOUBLE_FREE        // Slot already free
+} slab_status_t;
+
+typedef struct {
+    uint32_t slot_shift;    // log2 of the slot size, 0 while the chunk is unused
+    uint32_t free_slots;
+    uint32_t hint;          // No clear bit in the bitmap words before this one
+    uint32_t next_partial;  // Next chunk of the class with free slots
+} slab_chunk_t;
+
+typedef struct {
+    cap_ptr_t arena;
+    size_t base;            // Arena address
+    size_t chunk_count;
+    size_t chunks_used;
+    slab_chunk_t *chunks;
+    uint64_t *bitmap;       // SLAB_CHUNK_WORDS per chunk; set = allocated
+    uint32_t partial[SLAB_CLASS_COUNT];     // First chunk of each class with free slots
+    size_t live;
+    uint64_t invalid_frees;
+    uint64_t double_frees;
+} slab_t;
+
+// Reserve an arena of at least bytes; pages are only touched as slots are used
+static inline int slab_init(slab_t *s, size_t bytes) {
+    memset(s, 0, sizeof(*s));
+    s->chunk_count = (bytes + SLAB_CHUNK_BYTES - 1) >> SLAB_CHUNK_SHIFT;
+    if (s->chunk_count == 0 || s->chunk_count >= SLAB_NONE) return -1;
+    s->arena = cap_malloc(s->chunk_count << SLAB_CHUNK_SHIFT);
+    s->chunks = (slab_chunk_t *)calloc(s->chunk_count, sizeof(slab_chunk_t));
+    s->bitmap = (uint64_t *)calloc(s->chunk_count * SLAB_CHUNK_WORDS, sizeof(uint64_t));
+    if (cap_is_null(s->arena) || !s->chunks || !s->bitmap) {
+        if (!cap_is_null(s->arena)) cap_free(s->arena);
+        free(s->chunks);
+        free(s->bitmap);
+        return -1;
+    }
+    s->base = (size_t)(uintptr_t)cap_addr(s->arena);
+    for (int c = 0; c < SLAB_CLASS_COUNT; c++) s->partial[c] = SLAB_NONE;
+    return 0;
+}
+
+static inline void slab_destroy(slab_t *s) {
+    cap_free(s->arena);
+    free(s->chunks);
+    free(s->bitmap);
+    memset(s, 0, sizeof(*s));
+}
+
+// Size class of a request, or -1 when it is larger than the biggest slot
+static inline int slab_class(size_t size) {
+    if (size <= ((size_t)1 << SLAB_MIN_SHIFT)) return 0;
+    int shift = 64 - __builtin_clzll((unsigned long long)(size - 1));
+    return shift <= SLAB_MAX_SHIFT ? shift - SLAB_MIN_SHIFT : -1;
+}
+
+static inline cap_ptr_t slab_alloc(slab_t *s, size_t size) {
+    int cls = slab_class(size);
+    if (cls < 0) return CAP_NULL;
+    uint32_t index = s->partial[cls];
+    if (index == SLAB_NONE) {
+        if (s->chunks_used == s->chunk_count) return CAP_NULL;
+        index = (uint32_t)s->chunks_used++;
+        slab_chunk_t *fresh = &s->chunks[index];
+        fresh->slot_shift = (uint32_t)(cls + SLAB_MIN_SHIFT);
+        fresh->free_slots = (uint32_t)(SLAB_CHUNK_BYTES >> fresh->slot_shift);
+        fresh->next_partial = SLAB_NONE;
+        s->partial[cls] = index;
+    }
+
+    slab_chunk_t *c = &s->chunks[index];
+    uint64_t *words = s->bitmap + (size_t)index * SLAB_CHUNK_WORDS;
+    uint32_t w = c->hint;
+    while (words[w] == UINT64_MAX) w++;     // free_slots > 0, so a clear bit exists
+    uint32_t bit = (uint32_t)__builtin_ctzll(~words[w]);
+    words[w] |= 1ull << bit;
+    c->hint = w;
+    if (--c->free_slots == 0) s->partial[cls] = c->next_partial;
+    s->live++;
+
+    size_t slot = (size_t)w * 64 + bit;
+    return cap_sub(s->arena, ((size_t)index << SLAB_CHUNK_SHIFT) + (slot << c->slot_shift),
+                   (size_t)1 << c->slot_shift);
+}
+
+// Bounds of the reference being freed match the slot exactly
+static inline int slab_bounds_match(cap_ptr_t obj, size_t slot_size) {
+#ifdef __CHERI__
+    return cheri_tag_get(obj) && cheri_offset_get(obj) == 0 && cheri_length_get(obj) == slot_size;
+#elif defined(CAP_MODEL_SOFTCAP)
+    return cap_len(obj) == slot_size;
+#else
+    (void)obj;
+    (void)slot_size;
+    return 1;
+#endif
+}
+
+// Mark the slot free; a chunk that was full goes back on its class's list
+static inline void slab_release(slab_t *s, size_t index, uint64_t *word, uint64_t mask, uint32_t w) {
+    slab_chunk_t *c = &s->chunks[index];
+    *word &= ~mask;
+    if (w < c->hint) c->hint = w;
+    if (c->free_slots++ == 0) {
+        int cls = (int)c->slot_shift - SLAB_MIN_SHIFT;
+        c->next_partial = s->partial[cls];
+        s->partial[cls] = (uint32_t)index;
+    }
+    s->live--;
+}
+
+// Validated free in constant time; slot state only changes when it returns SLAB_OK
+static inline slab_status_t slab_free(slab_t *s, cap_ptr_t obj) {
+    size_t offset = (size_t)(uintptr_t)cap_addr(obj) - s->base;
+    size_t index = offset >> SLAB_CHUNK_SHIFT;
+    if (cap_is_null(obj) || index >= s->chunks_used) {
+        s->invalid_frees++;
+        return SLAB_INVALID_FREE;
+    }
+    uint32_t shift = s->chunks[index].slot_shift;
+    size_t in_chunk = offset & (SLAB_CHUNK_BYTES - 1);
+    if ((in_chunk & (((size_t)1 << shift) - 1)) != 0 || !slab_bounds_match(obj, (size_t)1 << shift)) {
+        s->invalid_frees++;
+        return SLAB_INVALID_FREE;
+    }
+    size_t slot = in_chunk >> shift;
+    uint64_t *word = s->bitmap + index * SLAB_CHUNK_WORDS + slot / 64;
+    uint64_t mask = 1ull << (slot % 64);
+    if (!(*word & mask)) {
+        s->double_frees++;
+        return SLAB_DOUBLE_FREE;
+    }
+    slab_release(s, index, word, mask, (uint32_t)(slot / 64));
+    return SLAB_OK;
+}
+
+// The same bookkeeping with no checks: obj must be a live object of this slab
+static inline void slab_free_unchecked(slab_t *s, cap_ptr_t obj) {
+    size_t offset = (size_t)(uintptr_t)cap_addr(obj) - s->base;
+    size_t index = offset >> SLAB_CHUNK_SHIFT;
+    size_t slot = (offset & (SLAB_CHUNK_BYTES - 1)) >> s->chunks[index].slot_shift;
+    slab_release(s, index, s->bitmap + index * SLAB_CHUNK_WORDS + slot / 64, 1ull << (slot % 64),
+                 (uint32_t)(slot / 64));
+}
+
+#endif // SLAB_BITMAP_H
@@ -0,0 +1,463 @@
+/*
+ * Sort Template - pdqsort, LSD radix sort and parallel sample sort
+ *
+ * Included once per element type (klib-style). Before including, define:
+ *   SORT_T             element type (cap_ptr_t, an index type or a record)
+ *   SORT_KEY(ctx, e)   uint64_t sort key of element e; ctx is the sort_ctx_t *
+ *                      (ctx->base is a capability, e.g. to the records indexed)
+ *   SORT_NAME(x)       prefix for the generated functions, e.g. ptr_##x
+ *   SORT_COUNT_MOVES   optional: count element writes in ctx->moved
+ * The parameters are undefined again at the end of the file.
+ *
+ * Generated functions (n elements at a, ctx->base available to SORT_KEY):
+ *   SORT_NAME(pdqsort)(a, n, ctx)
+ *   SORT_NAME(radix)(a, tmp, n, ctx)            LSD, 8-bit digits, tmp holds n
+ *   SORT_NAME(sample)(a, tmp, n, ctx, threads)  tmp holds n
+ * An instantiation may use any subset of them.
+ */
+
+#ifndef SORT_TEMPLATE_ONCE
+#define SORT_TEMPLATE_ONCE
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "capmodel.h"
+
+#define SORT_INSERTION_THRESHOLD 24
+#define SORT_NINTHER_THRESHOLD   128
+#define SORT_PARTIAL_LIMIT       8
+#define SORT_SAMPLE_MIN          (1 << 16)  // Below this the sample sort runs pdqsort
+#define SORT_SAMPLE_OVERSAMPLE   64
+#define SORT_MAX_THREADS         256
+
+typedef struct {
+    cap_ptr_t base;         // What SORT_KEY needs to reach the key (record array)
+    uint64_t moved;         // Element writes (SORT_COUNT_MOVES builds only)
+} sort_ctx_t;
+
+static inline int sort_log2(size_t n) {
+    int log = 0;
+    while (n >>= 1) log++;
+    return log;
+}
+
+#endif // SORT_TEMPLATE_ONCE
+
+#ifdef SORT_COUNT_MOVES
+#define SORT_MOVED(ctx, n) ((ctx)->moved += (n))
+#else
+#define SORT_MOVED(ctx, n) ((void)0)
+#endif
+
+#define SORT_LESS(ctx, x, y) (SORT_KEY(ctx, x) < SORT_KEY(ctx, y))
+
+static inline void SORT_NAME(swap)(SORT_T *x, SORT_T *y, sort_ctx_t *ctx) {
+    SORT_T t = *x;
+    *x = *y;
+    *y = t;
+    SORT_MOVED(ctx, 2);
+    (void)ctx;
+}
+
+// ---------------------------------------------------------------------------
+// pdqsort: introsort with pattern detection and a heapsort fallback
+// ---------------------------------------------------------------------------
+
+static void SORT_NAME(insertion)(SORT_T *begin, SORT_T *end, sort_ctx_t *ctx, int leftmost) {
+    (void)ctx;
+    if (begin == end) return;
+    for (SORT_T *cur = begin + 1; cur != end; cur++) {
+        SORT_T *sift = cur;
+        SORT_T tmp = *sift;
+        uint64_t key = SORT_KEY(ctx, tmp);
+        if (key < SORT_KEY(ctx, *(sift - 1))) {
+            // Not leftmost: the element before begin bounds the scan
+            do {
+                *sift = *(sift - 1);
+                sift--;
+                SORT_MOVED(ctx, 1);
+            } while ((leftmost ? sift != begin : 1) && key < SORT_KEY(ctx, *(sift - 1)));
+            *sift = tmp;
+            SORT_MOVED(ctx, 1);
+        }
+    }
+}
+
+// Insertion sort that gives up after SORT_PARTIAL_LIMIT element moves
+static int SORT_NAME(partial_insertion)(SORT_T *begin, SORT_T *end, sort_ctx_t *ctx) {
+    size_t limit = 0;
+    (void)ctx;
+    if (begin == end) return 1;
+    for (SORT_T *cur = begin + 1; cur != end; cur++) {
+        SORT_T *sift = cur;
+        SORT_T tmp = *sift;
+        uint64_t key = SORT_KEY(ctx, tmp);
+        if (key < SORT_KEY(ctx, *(sift - 1))) {
+            do {
+                *sift = *(sift - 1);
+                sift--;
+                SORT_MOVED(ctx, 1);
+            } while (sift != begin && key < SORT_KEY(ctx, *(sift - 1)));
+            *sift = tmp;
+            SORT_MOVED(ctx, 1);
+            limit += (size_t)(cur - sift);
+        }
+        if (limit > SORT_PARTIAL_LIMIT) return 0;
+    }
+    return 1;
+}
+
+static void SORT_NAME(sift_down)(SORT_T *a, size_t root, size_t n, sort_ctx_t *ctx) {
+    SORT_T tmp = a[root];
+    uint64_t key = SORT_KEY(ctx, tmp);
+    (void)ctx;
+    for (;;) {
+        size_t child = 2 * root + 1;
+        if (child >= n) break;
+        if (child + 1 < n && SORT_LESS(ctx, a[child], a[child + 1])) child++;
+        if (SORT_KEY(ctx, a[child]) <= key) break;
+        a[root] = a[child];
+        SORT_MOVED(ctx, 1);
+        root = child;
+    }
+    a[root] = tmp;
+    SORT_MOVED(ctx, 1);
+}
+
+static void SORT_NAME(heapsort)(SORT_T *a, size_t n, sort_ctx_t *ctx) {
+    for (size_t i = n / 2; i-- > 0;) SORT_NAME(sift_down)(a, i, n, ctx);
+    for (size_t i = n; i-- > 1;) {
+        SORT_NAME(swap)(&a[0], &a[i], ctx);
+        SORT_NAME(sift_down)(a, 0, i, ctx);
+    }
+}
+
+static inline void SORT_NAME(sort2)(SORT_T *a, SORT_T *b, sort_ctx_t *ctx) {
+    if (SORT_LESS(ctx, *b, *a)) SORT_NAME(swap)(a, b, ctx);
+}
+
+static inline void SORT_NAME(sort3)(SORT_T *a, SORT_T *b, SORT_T *c, sort_ctx_t *ctx) {
+    SORT_NAME(sort2)(a, b, ctx);
+    SORT_NAME(sort2)(b, c, ctx);
+    SORT_NAME(sort2)(a, b, ctx);
+}
+
+// Partition around *begin; elements equal to the pivot go right
+static SORT_T *SORT_NAME(partition_right)(SORT_T *begin, SORT_T *end, sort_ctx_t *ctx,
+                                          int *already_partitioned) {
+    SORT_T pivot = *begin;
+    uint64_t pivot_key = SORT_KEY(ctx, pivot);
+    SORT_T *first = begin, *last = end;
+
+    // Median-of-3 guarantees an element >= pivot exists on the right
+    while (SORT_KEY(ctx, *++first) < pivot_key) {}
+    if (first - 1 == begin) {
+        while (first < last && !(SORT_KEY(ctx, *--last) < pivot_key)) {}
+    } else {
+        while (!(SORT_KEY(ctx, *--last) < pivot_key)) {}
+    }
+    *already_partitioned = first >= last;
+
+    while (first < last) {
+        SORT_NAME(swap)(first, last, ctx);
+        while (SORT_KEY(ctx, *++first) < pivot_key) {}
+        while (!(SORT_KEY(ctx, *--last) < pivot_key)) {}
+    }
+    SORT_T *pivot_pos = first - 1;
+    *begin = *pivot_pos;
+    *pivot_pos = pivot;
+    SORT_MOVED(ctx, 2);
+    return pivot_pos;
+}
+
+// Partition around *begin with equal elements left; used when many keys repeat
+static SORT_T *SORT_NAME(partition_left)(SORT_T *begin, SORT_T *end, sort_ctx_t *ctx) {
+    SORT_T pivot = *begin;
+    uint64_t pivot_key = SORT_KEY(ctx, pivot);
+    SORT_T *first = begin, *last = end;
+
+    while (pivot_key < SORT_KEY(ctx, *--last)) {}
+    if (last + 1 == end) {
+        while (first < last && !(pivot_key < SORT_KEY(ctx, *++first))) {}
+    } else {
+        while (!(pivot_key < SORT_KEY(ctx, *++first))) {}
+    }
+    while (first < last) {
+        SORT_NAME(swap)(first, last, ctx);
+        while (pivot_key < SORT_KEY(ctx, *--last)) {}
+        while (!(pivot_key < SORT_KEY(ctx, *++first))) {}
+    }
+    *begin = *last;
+    *last = pivot;
+    SORT_MOVED(ctx, 2);
+    return last;
+}
+
+static void SORT_NAME(pdq_loop)(SORT_T *begin, SORT_T *end, sort_ctx_t *ctx, int bad_allowed,
+                                int leftmost) {
+    for (;;) {
+        size_t size = (size_t)(end - begin);
+        if (size < SORT_INSERTION_THRESHOLD) {
+            SORT_NAME(insertion)(begin, end, ctx, leftmost);
+            return;
+        }
+
+        // Pivot: median of 3, or pseudo-median of 9 for large ranges
+        size_t s2 = size / 2;
+        if (size > SORT_NINTHER_THRESHOLD) {
+            SORT_NAME(sort3)(begin, begin + s2, end - 1, ctx);
+            SORT_NAME(sort3)(begin + 1, begin + (s2 - 1), end - 2, ctx);
+            SORT_NAME(sort3)(begin + 2, begin + (s2 + 1), end - 3, ctx);
+            SORT_NAME(sort3)(begin + (s2 - 1), begin + s2, begin + (s2 + 1), ctx);
+            SORT_NAME(swap)(begin, begin + s2, ctx);
+        } else {
+            SORT_NAME(sort3)(begin + s2, begin, end - 1, ctx);
+        }
+
+        // Pivot equal to the element before the range: put the equal run left
+        if (!leftmost && !SORT_LESS(ctx, *(begin - 1), *begin)) {
+            begin = SORT_NAME(partition_left)(begin, end, ctx) + 1;
+            continue;
+        }
+
+        int already_partitioned;
+        SORT_T *pivot_pos = SORT_NAME(partition_right)(begin, end, ctx, &already_partitioned);
+        size_t l_size = (size_t)(pivot_pos - begin);
+        size_t r_size = (size_t)(end - (pivot_pos + 1));
+
+        if (l_size < size / 8 || r_size < size / 8) {
+            // Unbalanced: shuffle to break the pattern, heapsort if it persists
+            if (--bad_allowed == 0) {
+                SORT_NAME(heapsort)(begin, size, ctx);
+                return;
+            }
+            if (l_size >= SORT_INSERTION_THRESHOLD) {
+                SORT_NAME(swap)(begin, begin + l_size / 4, ctx);
+                SORT_NAME(swap)(pivot_pos - 1, pivot_pos - l_size / 4, ctx);
+                if (l_size > SORT_NINTHER_THRESHOLD) {
+                    SORT_NAME(swap)(begin + 1, begin + (l_size / 4 + 1), ctx);
+                    SORT_NAME(swap)(begin + 2, begin + (l_size / 4 + 2), ctx);
+                    SORT_NAME(swap)(pivot_pos - 2, pivot_pos - (l_size / 4 + 1), ctx);
+                    SORT_NAME(swap)(pivot_pos - 3, pivot_pos - (l_size / 4 + 2), ctx);
+                }
+            }
+            if (r_size >= SORT_INSERTION_THRESHOLD) {
+                SORT_NAME(swap)(pivot_pos + 1, pivot_pos + (1 + r_size / 4), ctx);
+                SORT_NAME(swap)(end - 1, end - r_size / 4, ctx);
+                if (r_size > SORT_NINTHER_THRESHOLD) {
+                    SORT_NAME(swap)(pivot_pos + 2, pivot_pos + (2 + r_size / 4), ctx);
+                    SORT_NAME(swap)(pivot_pos + 3, pivot_pos + (3 + r_size / 4), ctx);
+                    SORT_NAME(swap)(end - 2, end - (1 + r_size / 4), ctx);
+                    SORT_NAME(swap)(end - 3, end - (2 + r_size / 4), ctx);
+                }
+            }
+        } else if (already_partitioned &&
+                   SORT_NAME(partial_insertion)(begin, pivot_pos, ctx) &&
+                   SORT_NAME(partial_insertion)(pivot_pos + 1, end, ctx)) {
+            return;   // Input was (nearly) sorted
+        }
+
+        // Recurse left, loop right
+        SORT_NAME(pdq_loop)(begin, pivot_pos, ctx, bad_allowed, leftmost);
+        begin = pivot_pos + 1;
+        leftmost = 0;
+    }
+}
+
+static __attribute__((unused)) void SORT_NAME(pdqsort)(SORT_T *a, size_t n, sort_ctx_t *ctx) {
+    if (n > 1) SORT_NAME(pdq_loop)(a, a + n, ctx, sort_log2(n), 1);
+}
+
+// ---------------------------------------------------------------------------
+// LSD radix sort: one histogram pass, then a scatter per non-trivial digit
+// ---------------------------------------------------------------------------
+
+static __attribute__((unused)) void SORT_NAME(radix)(SORT_T *a, SORT_T *tmp, size_t n, sort_ctx_t *ctx) {
+    size_t (*counts)[256] = calloc(8, sizeof(*counts));
+    if (!counts) {
+        SORT_NAME(pdqsort)(a, n, ctx);
+        return;
+    }
+    for (size_t i = 0; i < n; i++) {
+        uint64_t key = SORT_KEY(ctx, a[i]);
+        for (int d = 0; d < 8; d++) counts[d][(key >> (8 * d)) & 0xFF]++;
+    }
+
+    SORT_T *src = a, *dst = tmp;
+    for (int d = 0; d < 8; d++) {
+        size_t offset = 0;
+        int trivial = 0;
+        for (int b = 0; b < 256; b++) {
+            size_t c = counts[d][b];
+            if (c == n) trivial = 1;   // Every key shares this digit: skip the pass
+            counts[d][b] = offset;
+            offset += c;
+        }
+        if (trivial) continue;
+
+        for (size_t i = 0; i < n; i++) {
+            uint64_t key = SORT_KEY(ctx, src[i]);
+            dst[counts[d][(key >> (8 * d)) & 0xFF]++] = src[i];
+        }
+        SORT_MOVED(ctx, n);
+        SORT_T *t = src;
+        src = dst;
+        dst = t;
+    }
+    if (src != a) {
+        memcpy(a, src, n * sizeof(SORT_T));
+        SORT_MOVED(ctx, n);
+    }
+    free(counts);
+}
+
+// ---------------------------------------------------------------------------
+// Parallel sample sort: sample splitters, scatter into buckets, sort buckets
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    SORT_T *a;
+    SORT_T *tmp;
+    size_t n;
+    const sort_ctx_t *ctx;
+    int threads;
+    size_t buckets;
+    uint64_t *splitters;        // buckets - 1 keys
+    size_t *counts;             // [thread][bucket], then scatter offsets
+    size_t *bucket_start;       // buckets + 1
+    size_t next_bucket;
+    uint64_t moved;
+    pthread_barrier_t barrier;
+} SORT_NAME(sample_job_t);
+
+typedef struct {
+    SORT_NAME(sample_job_t) *job;
+    int id;
+} SORT_NAME(sample_worker_t);
+
+static inline size_t SORT_NAME(bucket_of)(const SORT_NAME(sample_job_t) *job, uint64_t key) {
+    size_t lo = 0, hi = job->buckets - 1;   // First splitter > key
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (job->splitters[mid] <= key) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static void *SORT_NAME(sample_worker)(void *arg) {
+    SORT_NAME(sample_worker_t) *w = arg;
+    SORT_NAME(sample_job_t) *job = w->job;
+    sort_ctx_t ctx = { job->ctx->base, 0 };
+    size_t from = job->n * (size_t)w->id / (size_t)job->threads;
+    size_t to = job->n * (size_t)(w->id + 1) / (size_t)job->threads;
+    size_t *counts = job->counts + (size_t)w->id * job->buckets;
+
+    for (size_t i = from; i < to; i++) counts[SORT_NAME(bucket_of)(job, SORT_KEY(&ctx, job->a[i]))]++;
+    pthread_barrier_wait(&job->barrier);
+
+    if (w->id == 0) {   // Bucket-major prefix sum over all threads' counts
+        size_t offset = 0;
+        for (size_t b = 0; b < job->buckets; b++) {
+            job->bucket_start[b] = offset;
+            for (int t = 0; t < job->threads; t++) {
+                size_t c = job->counts[(size_t)t * job->buckets + b];
+                job->counts[(size_t)t * job->buckets + b] = offset;
+                offset += c;
+            }
+        }
+        job->bucket_start[job->buckets] = offset;
+    }
+    pthread_barrier_wait(&job->barrier);
+
+    for (size_t i = from; i < to; i++) {
+        job->tmp[counts[SORT_NAME(bucket_of)(job, SORT_KEY(&ctx, job->a[i]))]++] = job->a[i];
+    }
+    SORT_MOVED(&ctx, to - from);
+    pthread_barrier_wait(&job->barrier);
+
+    // Buckets are handed out dynamically; each is sorted and copied back
+    for (;;) {
+        size_t b = __atomic_fetch_add(&job->next_bucket, 1, __ATOMIC_RELAXED);
+        if (b >= job->buckets) break;
+        size_t start = job->bucket_start[b], len = job->bucket_start[b + 1] - start;
+        SORT_NAME(pdqsort)(job->tmp + start, len, &ctx);
+        memcpy(job->a + start, job->tmp + start, len * sizeof(SORT_T));
+        SORT_MOVED(&ctx, len);
+    }
+    __atomic_fetch_add(&job->moved, ctx.moved, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+static __attribute__((unused)) void SORT_NAME(sample)(SORT_T *a, SORT_T *tmp, size_t n, sort_ctx_t *ctx, int threads) {
+    if (threads > SORT_MAX_THREADS) threads = SORT_MAX_THREADS;
+    if (threads <= 1 || n < SORT_SAMPLE_MIN) {
+        SORT_NAME(pdqsort)(a, n, ctx);
+        return;
+    }
+
+    SORT_NAME(sample_job_t) job;
+    memset(&job, 0, sizeof(job));
+    job.a = a;
+    job.tmp = tmp;
+    job.n = n;
+    job.ctx = ctx;
+    job.threads = threads;
+    job.buckets = (size_t)threads * 4;   // Oversubscribed for load balance
+
+    size_t samples = job.buckets * SORT_SAMPLE_OVERSAMPLE;
+    uint64_t *keys = malloc(samples * sizeof(uint64_t));
+    job.splitters = malloc(job.buckets * sizeof(uint64_t));
+    job.counts = calloc((size_t)threads * job.buckets, sizeof(size_t));
+    job.bucket_start = malloc((job.buckets + 1) * sizeof(size_t));
+    if (!keys || !job.splitters || !job.counts || !job.bucket_start) {
+        free(keys);
+        free(job.splitters);
+        free(job.counts);
+        free(job.bucket_start);
+        SORT_NAME(pdqsort)(a, n, ctx);
+        return;
+    }
+
+    // Evenly strided sample (deterministic; inputs are already shuffled)
+    for (size_t s = 0; s < samples; s++) keys[s] = SORT_KEY(ctx, a[(s * (n / samples)) + (n / samples) / 2]);
+    for (size_t i = 1; i < samples; i++) {   // Small: insertion sort
+        uint64_t k = keys[i];
+        size_t j = i;
+        while (j > 0 && keys[j - 1] > k) {
+            keys[j] = keys[j - 1];
+            j--;
+        }
+        keys[j] = k;
+    }
+    for (size_t b = 1; b < job.buckets; b++) job.splitters[b - 1] = keys[b * SORT_SAMPLE_OVERSAMPLE];
+
+    pthread_t tids[SORT_MAX_THREADS];
+    SORT_NAME(sample_worker_t) workers[SORT_MAX_THREADS];
+    pthread_barrier_init(&job.barrier, NULL, (unsigned)threads);
+    for (int t = 0; t < threads; t++) {
+        workers[t].job = &job;
+        workers[t].id = t;
+        if (t > 0) pthread_create(&tids[t], NULL, SORT_NAME(sample_worker), &workers[t]);
+    }
+    SORT_NAME(sample_worker)(&workers[0]);
+    for (int t = 1; t < threads; t++) pthread_join(tids[t], NULL);
+    pthread_barrier_destroy(&job.barrier);
+
+    ctx->moved += job.moved;
+    free(keys);
+    free(job.splitters);
+    free(job.counts);
+    free(job.bucket_start);
+}
+
+#undef SORT_LESS
+#undef SORT_MOVED
+#undef SORT_T
+#undef SORT_KEY
+#undef SORT_NAME
+#undef SORT_COUNT_MOVES
@@ -0,0 +1,530 @@
+/*
+ * Asynchronous Trace Reader - io_uring or pread threads feeding one consumer
+ *
+ * Streams a file in fixed-size blocks through a ring of `depth` buffers so
+ * the consumer (a parser or replay stage) works on one block while the
+ * others are being read. Block b always lands in slot b % depth; each slot
+ * carries two sequence numbers that form the lock-free handoff:
+ *   ready     - block whose data the slot holds (published by the reader)
+ *   free_for  - next block that may be read into it (published by the
+ *               consumer when it releases the previous one)
+ * so readers and the consumer never take a lock and never wait on each
+ * other except when the ring is genuinely full or empty.
+ *
+ * Backends:
+ *   uring - one thread driving an io_uring (raw system calls, no liburing)
+ *           with up to `depth` reads in flight. The ring buffers are
+ *           registered as fixed buffers (READ_FIXED) when the memlock
+ *           limit allows, READV otherwise.
+ *   pread - `threads` threads, each claiming the next block and reading
+ *           it with pread(); used wherever io_uring is missing (CheriBSD,
+ *           old kernels, seccomp-filtered containers).
+ *
+ * Each block reaches the consumer as a capability bounded to its bytes.
+ * The reader accounts consumer idle time (waiting for data) and reader
+ * stall time (waiting for a free buffer) separately. O_DIRECT needs
+ * _GNU_SOURCE on glibc, defined before the first include.
+ */
+
+#ifndef TRACE_READER_H
+#define TRACE_READER_H
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#include "capmodel.h"
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && defined(__NR_io_uring_register)
+#define TR_HAVE_URING 1
+#endif
+#endif
+#endif
+
+#define TR_MAX_DEPTH        256
+#define TR_MAX_THREADS      64
+#define TR_IDLE_SPINS       256     // Polls before yielding the CPU while waiting
+#define TR_BUFFER_ALIGN     4096    // O_DIRECT needs sector-aligned buffers
+#define TR_CACHE_LINE       64
+
+#if defined(__x86_64__) || defined(__i386__)
+#define TR_CPU_RELAX() __builtin_ia32_pause()
+#else
+#define TR_CPU_RELAX() ((void)0)
+#endif
+
+typedef enum {
+    TR_BACKEND_URING = 0,
+    TR_BACKEND_PREAD,
+    TR_BACKENDS
+} tr_backend_t;
+
+typedef struct {
+    int64_t ready;              // Block held by the slot, -1 before the first
+    char pad0[TR_CACHE_LINE - sizeof(int64_t)];
+    int64_t free_for;           // Block the slot may be filled with next
+    char pad1[TR_CACHE_LINE - sizeof(int64_t)];
+    size_t length;              // Bytes of the block (short at end of file)
+    size_t filled;              // Reader-side progress of a partial read
+} tr_slot_t;
+
+#ifdef TR_HAVE_URING
+typedef struct {
+    int fd;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+    void *sq_ring, *cq_ring;
+    size_t sq_ring_size, cq_ring_size, sqes_size;
+    struct iovec *iov;          // One per slot (fixed buffers or READV vectors)
+} tr_uring_t;
+#endif
+
+typedef struct {
+    int fd;
+    tr_backend_t backend;
+    int direct;                 // Opened with O_DIRECT
+    int registered;             // uring: ring buffers registered as fixed buffers
+    size_t block_size;
+    int depth;
+    int threads;                // pread threads
+    uint64_t file_size;
+    int64_t block_count;
+
+    void *memory;               // Allocation behind buffers
+    cap_ptr_t buffers;          // depth * block_size, one block per slot
+    tr_slot_t *slots;
+    pthread_t workers[TR_MAX_THREADS];
+    int worker_count;
+
+    int64_t claimed;            // pread: next block to claim
+    int64_t consumed;           // Consumer: next block to hand out
+    int stop;                   // Consumer gave up early
+    int error;                  // errno of a failed read, 0 if none
+
+    uint64_t start_ns, end_ns;
+    uint64_t consumer_wait_ns;  // Consumer waiting for data
+    uint64_t reader_wait_ns;    // Readers waiting for a free buffer (summed over threads)
+#ifdef TR_HAVE_URING
+    tr_uring_t ring;
+#endif
+} tr_reader_t;
+
+static inline const char *tr_backend_name(tr_backend_t backend) {
+    return backend == TR_BACKEND_URING ? "uring" : "pread";
+}
+
+static inline uint64_t tr_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Spin, then yield, until *seq reaches want; returns nanoseconds waited
+static inline uint64_t tr_wait_for(const int64_t *seq, int64_t want, const int *abort_flag) {
+    if (__atomic_load_n(seq, __ATOMIC_ACQUIRE) == want) return 0;
+    uint64_t start = tr_now_ns();
+    for (int spins = 0; __atomic_load_n(seq, __ATOMIC_ACQUIRE) != want; spins++) {
+        if (__atomic_load_n(abort_flag, __ATOMIC_RELAXED)) break;
+        if (spins < TR_IDLE_SPINS) TR_CPU_RELAX();
+        else sched_yield();
+    }
+    return tr_now_ns() - start;
+}
+
+static inline void tr_fail(tr_reader_t *r, int err) {
+    int none = 0;
+    __atomic_compare_exchange_n(&r->error, &none, err ? err : EIO, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+    __atomic_store_n(&r->stop, 1, __ATOMIC_RELEASE);
+}
+
+static inline size_t tr_block_length(const tr_reader_t *r, int64_t block) {
+    uint64_t offset = (uint64_t)block * r->block_size;
+    uint64_t left = r->file_size - offset;
+    return left < r->block_size ? (size_t)left : r->block_size;
+}
+
+static inline void tr_publish(tr_reader_t *r, tr_slot_t *slot, int64_t block) {
+    slot->length = slot->filled;
+    __atomic_store_n(&slot->ready, block, __ATOMIC_RELEASE);
+    (void)r;
+}
+
+// ---------------------------------------------------------------------------
+// pread backend
+// ---------------------------------------------------------------------------
+
+static void *tr_pread_main(void *arg) {
+    tr_reader_t *r = (tr_reader_t *)arg;
+    uint64_t waited = 0;
+    for (;;) {
+        int64_t block = __atomic_fetch_add(&r->claimed, 1, __ATOMIC_RELAXED);
+        if (block >= r->block_count || __atomic_load_n(&r->stop, __ATOMIC_ACQUIRE)) break;
+        int index = (int)(block % r->depth);
+        tr_slot_t *slot = &r->slots[index];
+        waited += tr_wait_for(&slot->free_for, block, &r->stop);
+        if (__atomic_load_n(&r->stop, __ATOMIC_ACQUIRE)) break;
+
+        size_t want = tr_block_length(r, block);
+        char *buf = (char *)cap_check(r->buffers, (size_t)index * r->block_size, r->block_size);
+        off_t offset = (off_t)((uint64_t)block * r->block_size);
+        slot->filled = 0;
+        while (slot->filled < want) {
+            ssize_t n = pread(r->fd, buf + slot->filled, r->direct ? r->block_size - slot->filled
+                                                                   : want - slot->filled,
+                              offset + (off_t)slot->filled);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) {
+                tr_fail(r, n < 0 ? errno : EIO);
+                break;
+            }
+            slot->filled += (size_t)n;
+        }
+        if (slot->filled > want) slot->filled = want;  // O_DIRECT reads whole blocks
+        if (__atomic_load_n(&r->stop, __ATOMIC_ACQUIRE)) break;
+        tr_publish(r, slot, block);
+    }
+    __atomic_fetch_add(&r->reader_wait_ns, waited, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+// ---------------------------------------------------------------------------
+// io_uring backend
+// ---------------------------------------------------------------------------
+
+#ifdef TR_HAVE_URING
+static int tr_uring_setup(tr_reader_t *r) {
+    tr_uring_t *u = &r->ring;
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    memset(u, 0, sizeof(*u));
+    u->fd = (int)syscall(__NR_io_uring_setup, (unsigned)r->depth, &p);
+    if (u->fd < 0) return -1;
+
+    u->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    u->cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (u->cq_ring_size > u->sq_ring_size) u->sq_ring_size = u->cq_ring_size;
+        u->cq_ring_size = u->sq_ring_size;
+    }
+    u->sq_ring = mmap(NULL, u->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      u->fd, IORING_OFF_SQ_RING);
+    if (u->sq_ring == MAP_FAILED) goto fail;
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        u->cq_ring = u->sq_ring;
+    } else {
+        u->cq_ring = mmap(NULL, u->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          u->fd, IORING_OFF_CQ_RING);
+        if (u->cq_ring == MAP_FAILED) goto fail;
+    }
+    u->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    u->sqes = (struct io_uring_sqe *)mmap(NULL, u->sqes_size, PROT_READ | PROT_WRITE,
+                                          MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQES);
+    if (u->sqes == MAP_FAILED) goto fail;
+
+    char *sq = (char *)u->sq_ring, *cq = (char *)u->cq_ring;
+    u->sq_head = (unsigned *)(sq + p.sq_off.head);
+    u->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+    u->sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+    u->sq_array = (unsigned *)(sq + p.sq_off.array);
+    u->cq_head = (unsigned *)(cq + p.cq_off.head);
+    u->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+    u->cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+    u->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+
+    // Fixed buffers pin the ring; fall back to READV if RLIMIT_MEMLOCK is too small
+    u->iov = (struct iovec *)calloc((size_t)r->depth, sizeof(struct iovec));
+    if (!u->iov) goto fail;
+    for (int i = 0; i < r->depth; i++) {
+        u->iov[i].iov_base = cap_check(r->buffers, (size_t)i * r->block_size, r->block_size);
+        u->iov[i].iov_len = r->block_size;
+    }
+    r->registered = syscall(__NR_io_uring_register, u->fd, IORING_REGISTER_BUFFERS, u->iov,
+                            (unsigned)r->depth) == 0;
+    return 0;
+
+fail:
+    if (u->sq_ring && u->sq_ring != MAP_FAILED) munmap(u->sq_ring, u->sq_ring_size);
+    if (u->cq_ring && u->cq_ring != MAP_FAILED && u->cq_ring != u->sq_ring) munmap(u->cq_ring, u->cq_ring_size);
+    if (u->sqes && u->sqes != MAP_FAILED) munmap(u->sqes, u->sqes_size);
+    close(u->fd);
+    u->fd = -1;
+    return -1;
+}
+
+static void tr_uring_teardown(tr_reader_t *r) {
+    tr_uring_t *u = &r->ring;
+    if (u->fd < 0) return;
+    munmap(u->sqes, u->sqes_size);
+    if (u->cq_ring != u->sq_ring) munmap(u->cq_ring, u->cq_ring_size);
+    munmap(u->sq_ring, u->sq_ring_size);
+    close(u->fd);
+    free(u->iov);
+    u->fd = -1;
+}
+
+// Queue the unread remainder of the slot's block; the caller submits
+static void tr_uring_queue(tr_reader_t *r, int index, int64_t block) {
+    tr_uring_t *u = &r->ring;
+    tr_slot_t *slot = &r->slots[index];
+    unsigned tail = *u->sq_tail;
+    unsigned i = tail & *u->sq_mask;
+    struct io_uring_sqe *sqe = &u->sqes[i];
+    size_t want = r->direct ? r->block_size : tr_block_length(r, block);
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->fd = r->fd;
+    sqe->off = (uint64_t)block * r->block_size + slot->filled;
+    sqe->user_data = (uint64_t)index;
+    if (r->registered) {
+        sqe->opcode = IORING_OP_READ_FIXED;
+        sqe->addr = (uint64_t)(uintptr_t)((char *)u->iov[index].iov_base + slot->filled);
+        sqe->len = (unsigned)(want - slot->filled);
+        sqe->buf_index = (uint16_t)index;
+    } else {
+        // The vector is rewritten per submission so a short read can resume
+        u->iov[index].iov_base = (char *)cap_check(r->buffers, (size_t)index * r->block_size, r->block_size) +
+                                 slot->filled;
+        u->iov[index].iov_len = want - slot->filled;
+        sqe->opcode = IORING_OP_READV;
+        sqe->addr = (uint64_t)(uintptr_t)&u->iov[index];
+        sqe->len = 1;
+    }
+    u->sq_array[i] = i;
+    __atomic_store_n(u->sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+static void *tr_uring_main(void *arg) {
+    tr_reader_t *r = (tr_reader_t *)arg;
+    tr_uring_t *u = &r->ring;
+    int64_t next = 0, done = 0, in_slot[TR_MAX_DEPTH];
+    int inflight = 0;
+    unsigned queued = 0;
+    uint64_t waited = 0;
+
+    while (done < r->block_count && !__atomic_load_n(&r->stop, __ATOMIC_ACQUIRE)) {
+        // Fill every slot the consumer has handed back
+        while (next < r->block_count && inflight < r->depth) {
+            int index = (int)(next % r->depth);
+            if (__atomic_load_n(&r->slots[index].free_for, __ATOMIC_ACQUIRE) != next) break;
+            r->slots[index].filled = 0;
+            in_slot[index] = next;
+            tr_uring_queue(r, index, next);
+            next++;
+            inflight++;
+            queued++;
+        }
+        if (inflight == 0) {
+            // Ring full of unconsumed data: wait for the consumer
+            waited += tr_wait_for(&r->slots[next % r->depth].free_for, next, &r->stop);
+            continue;
+        }
+
+        int rc = (int)syscall(__NR_io_uring_enter, u->fd, queued, 1u, IORING_ENTER_GETEVENTS, NULL, 0);
+        if (rc < 0) {
+            if (errno == EINTR) continue;
+            tr_fail(r, errno);
+            break;
+        }
+        queued -= (unsigned)rc < queued ? (unsigned)rc : queued;
+
+        unsigned head = *u->cq_head;
+        while (head != __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE)) {
+            struct io_uring_cqe *cqe = &u->cqes[head & *u->cq_mask];
+            int index = (int)cqe->user_data;
+            int res = cqe->res;
+            head++;
+            tr_slot_t *slot = &r->slots[index];
+            int64_t block = in_slot[index];
+            size_t want = tr_block_length(r, block);
+            if (res == -EAGAIN || res == -EINTR) {
+                tr_uring_queue(r, index, block);
+                queued++;
+                continue;
+            }
+            if (res < 0 || (res == 0 && slot->filled < want)) {
+                tr_fail(r, res < 0 ? -res : EIO);
+                inflight--;
+                break;
+            }
+            slot->filled += (size_t)res;
+            if (slot->filled < want) {
+                tr_uring_queue(r, index, block);  // Short read: fetch the rest
+                queued++;
+                continue;
+            }
+            if (slot->filled > want) slot->filled = want;
+            tr_publish(r, slot, block);
+            inflight--;
+            done++;
+        }
+        __atomic_store_n(u->cq_head, head, __ATOMIC_RELEASE);
+    }
+
+    // Stopped early: the kernel must be done with the buffers before they are freed
+    while (inflight > 0) {
+        int rc = (int)syscall(__NR_io_uring_enter, u->fd, queued, 1u, IORING_ENTER_GETEVENTS, NULL, 0);
+        if (rc < 0 && errno != EINTR) break;
+        if (rc > 0) queued -= (unsigned)rc < queued ? (unsigned)rc : queued;
+        unsigned head = *u->cq_head;
+        for (; head != __atomic_load_n(u->cq_tail, __ATOMIC_ACQUIRE); head++) inflight--;
+        __atomic_store_n(u->cq_head, head, __ATOMIC_RELEASE);
+    }
+    __atomic_fetch_add(&r->reader_wait_ns, waited, __ATOMIC_RELAXED);
+    return NULL;
+}
+#endif
+
+// ---------------------------------------------------------------------------
+// Interface
+// ---------------------------------------------------------------------------
+
+// Whether the backend can run here (io_uring may be compiled out or refused)
+static inline int tr_backend_available(tr_backend_t backend) {
+    if (backend == TR_BACKEND_PREAD) return 1;
+#ifdef TR_HAVE_URING
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    int fd = (int)syscall(__NR_io_uring_setup, 2u, &p);
+    if (fd < 0) return 0;
+    close(fd);
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+/*
+ * Open path and start reading it. direct asks for O_DIRECT (silently
+ * dropped where the file system refuses it); block_size must then be a
+ * multiple of TR_BUFFER_ALIGN. Returns 0, or -1 with errno set; call
+ * tr_close() either way.
+ */
+static inline int tr_open(tr_reader_t *r, const char *path, tr_backend_t backend, size_t block_size,
+                          int depth, int threads, int direct) {
+    memset(r, 0, sizeof(*r));
+    r->fd = -1;
+#ifdef TR_HAVE_URING
+    r->ring.fd = -1;
+#endif
+    if (block_size == 0 || depth < 2 || depth > TR_MAX_DEPTH || threads < 1 || threads > TR_MAX_THREADS ||
+        (direct && block_size % TR_BUFFER_ALIGN)) {
+        errno = EINVAL;
+        return -1;
+    }
+    r->backend = backend;
+    r->block_size = block_size;
+    r->depth = depth;
+    r->threads = backend == TR_BACKEND_PREAD ? threads : 1;
+
+#ifdef O_DIRECT
+    if (direct) {
+        r->fd = open(path, O_RDONLY | O_DIRECT);
+        r->direct = r->fd >= 0;
+    }
+#endif
+    if (r->fd < 0) r->fd = open(path, O_RDONLY);
+    struct stat st;
+    if (r->fd < 0 || fstat(r->fd, &st) != 0) return -1;
+    r->file_size = (uint64_t)st.st_size;
+    r->block_count = (int64_t)((r->file_size + block_size - 1) / block_size);
+
+    if (posix_memalign(&r->memory, TR_BUFFER_ALIGN, (size_t)depth * block_size) != 0) {
+        r->memory = NULL;
+        errno = ENOMEM;
+        return -1;
+    }
+    r->buffers = cap_make(r->memory, (size_t)depth * block_size);
+    r->slots = (tr_slot_t *)calloc((size_t)depth, sizeof(tr_slot_t));
+    if (!r->slots) {
+        errno = ENOMEM;
+        return -1;
+    }
+    for (int i = 0; i < depth; i++) {
+        r->slots[i].ready = -1;
+        r->slots[i].free_for = i;
+    }
+
+    r->start_ns = tr_now_ns();
+    if (backend == TR_BACKEND_URING) {
+#ifdef TR_HAVE_URING
+        if (tr_uring_setup(r) != 0) return -1;
+        if (pthread_create(&r->workers[0], NULL, tr_uring_main, r) != 0) return -1;
+        r->worker_count = 1;
+        return 0;
+#else
+        errno = ENOSYS;
+        return -1;
+#endif
+    }
+    for (int t = 0; t < r->threads; t++) {
+        if (pthread_create(&r->workers[t], NULL, tr_pread_main, r) != 0) {
+            tr_fail(r, EAGAIN);
+            return -1;
+        }
+        r->worker_count++;
+    }
+    return 0;
+}
+
+/*
+ * Next block in file order, bounded to its bytes; CAP_NULL at end of file
+ * or after a read error (r->error). The block stays valid until
+ * tr_release(); one block is held at a time.
+ */
+static inline cap_ptr_t tr_next(tr_reader_t *r, size_t *length) {
+    if (r->consumed >= r->block_count || __atomic_load_n(&r->error, __ATOMIC_ACQUIRE)) {
+        if (!r->end_ns) r->end_ns = tr_now_ns();
+        return CAP_NULL;
+    }
+    int index = (int)(r->consumed % r->depth);
+    tr_slot_t *slot = &r->slots[index];
+    r->consumer_wait_ns += tr_wait_for(&slot->ready, r->consumed, &r->stop);
+    if (__atomic_load_n(&slot->ready, __ATOMIC_ACQUIRE) != r->consumed) {
+        if (!r->end_ns) r->end_ns = tr_now_ns();
+        return CAP_NULL;
+    }
+    *length = slot->length;
+    return cap_sub(r->buffers, (size_t)index * r->block_size, slot->length);
+}
+
+// Hand the block returned by tr_next() back to the readers
+static inline void tr_release(tr_reader_t *r) {
+    tr_slot_t *slot = &r->slots[r->consumed % r->depth];
+    __atomic_store_n(&slot->free_for, r->consumed + r->depth, __ATOMIC_RELEASE);
+    r->consumed++;
+}
+
+// Stop the readers (also mid-file) and free everything; returns r->error
+static inline int tr_close(tr_reader_t *r) {
+    if (!r->end_ns) r->end_ns = tr_now_ns();
+    if (r->consumed < r->block_count) __atomic_store_n(&r->stop, 1, __ATOMIC_RELEASE);
+    for (int t = 0; t < r->worker_count; t++) pthread_join(r->workers[t], NULL);
+#ifdef TR_HAVE_URING
+    tr_uring_teardown(r);
+#endif
+    if (r->fd >= 0) close(r->fd);
+    free(r->slots);
+    free(r->memory);
+    r->slots = NULL;
+    r->memory = NULL;
+    r->buffers = CAP_NULL;
+    r->fd = -1;
+    return r->error;
+}
+
+#endif // TRACE_READER_H
@@ -0,0 +1,260 @@
+/*
+ * Bytecode VM - Stack machine with a bounded operand stack and object heap
+ *
+ * Instructions are 32-bit words: opcode in the low byte, a signed 24-bit
+ * operand above it. Values are tagged 64-bit scalars or capabilities to
+ * heap objects, so a value is as wide as a capability plus its tag. The
+ * code, constants, operand stack, call frames and every heap object are
+ * separate bounded capabilities; each heap object is carved out of the
+ * heap arena with cap_sub and bounded to its header and payload.
+ *
+ * The interpreter loop is generated by common/vm_interp.h; this header
+ * holds the encoding, the VM state and a small assembler.
+ */
+
+#ifndef VM_H
+#define VM_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "capmodel.h"
+
+#define VM_MAX_FUNCS        32
+#define VM_FRAME_HEADROOM   64      // Operand slots a call may use beyond its locals
+#define VM_ARG_MIN          (-(1 << 23))
+#define VM_ARG_MAX          ((1 << 23) - 1)
+#define VM_RETURN_TO_HOST   UINT32_MAX
+
+#define VM_OPCODES(X)                                                          \
+    X(PUSHI) X(PUSHK) X(NIL) X(POP) X(DUP) X(LOAD) X(STORE)                    \
+    X(ADD) X(SUB) X(MUL) X(DIV) X(MOD) X(LT) X(LE) X(EQ) X(SQRT)               \
+    X(JMP) X(JF) X(CALL) X(RET) X(HALT)                                        \
+    X(NEWARR) X(AGET) X(ASET) X(ALEN)                                          \
+    X(NEWSTR) X(SPUSH) X(SAPP) X(SLEN) X(SGET)
+
+typedef enum {
+#define VM_OP_ENUM(name) VM_OP_##name,
+    VM_OPCODES(VM_OP_ENUM)
+#undef VM_OP_ENUM
+    VM_OP_COUNT
+} vm_opcode_t;
+
+#define VM_INSN(op, arg)    ((uint32_t)(op) | ((uint32_t)(arg) << 8))
+#define VM_INSN_OP(insn)    ((insn) & 0xFF)
+#define VM_INSN_ARG(insn)   ((int32_t)(insn) >> 8)
+
+typedef enum { VM_NIL = 0, VM_INT, VM_NUM, VM_ARR, VM_STR } vm_tag_t;
+
+typedef struct {
+    uint64_t tag;
+    union {
+        int64_t i;
+        double d;
+        cap_ptr_t ref;          // VM_ARR / VM_STR object
+    } as;
+} vm_value_t;
+
+// Object header; the payload (vm_value_t[] or bytes) follows it
+typedef struct {
+    uint32_t kind;
+    uint32_t length;            // Elements or bytes in use
+    uint32_t capacity;
+    uint32_t reserved;
+} vm_obj_t;
+
+typedef struct {
+    uint32_t entry;
+    uint16_t args;
+    uint16_t locals;            // Slots beyond the arguments, initialized to nil
+} vm_func_t;
+
+typedef struct {
+    uint32_t ret_pc;            // VM_RETURN_TO_HOST for the outermost call
+    uint32_t fp;
+} vm_frame_t;
+
+typedef struct {
+    cap_ptr_t code;             // uint32_t[code_len]
+    uint32_t code_len;
+    cap_ptr_t consts;           // vm_value_t[const_count]
+    uint32_t const_count;
+    cap_ptr_t funcs;            // vm_func_t[func_count]
+    uint32_t func_count;
+} vm_program_t;
+
+typedef struct {
+    const vm_program_t *prog;
+    cap_ptr_t stack;            // vm_value_t[stack_slots]
+    uint32_t stack_slots;
+    cap_ptr_t frames;           // vm_frame_t[frame_slots]
+    uint32_t frame_slots;
+    cap_ptr_t heap;             // Bump-allocated object arena, no collector
+    size_t heap_size;
+    size_t heap_used;
+    uint64_t ops;               // Instructions dispatched by the last run
+    vm_value_t result;
+    const char *error;
+} vm_t;
+
+static inline int vm_init(vm_t *vm, const vm_program_t *prog, uint32_t stack_slots, uint32_t frame_slots,
+                          size_t heap_size) {
+    memset(vm, 0, sizeof(*vm));
+    vm->prog = prog;
+    vm->stack_slots = stack_slots;
+    vm->frame_slots = frame_slots;
+    vm->heap_size = heap_size;
+    vm->stack = cap_malloc((size_t)stack_slots * sizeof(vm_value_t));
+    vm->frames = cap_malloc((size_t)frame_slots * sizeof(vm_frame_t));
+    vm->heap = cap_malloc(heap_size);
+    return cap_is_null(vm->stack) || cap_is_null(vm->frames) || cap_is_null(vm->heap) ? -1 : 0;
+}
+
+// Drop every heap object between runs
+static inline void vm_reset(vm_t *vm) {
+    vm->heap_used = 0;
+    vm->ops = 0;
+    vm->error = NULL;
+}
+
+static inline void vm_free(vm_t *vm) {
+    cap_free(vm->stack);
+    cap_free(vm->frames);
+    cap_free(vm->heap);
+}
+
+static inline vm_obj_t *vm_obj_header(cap_ptr_t obj) {
+    return CAP_OBJ(obj, vm_obj_t);
+}
+
+// Checked view of a string object's bytes, for the host side
+static inline const char *vm_str_bytes(cap_ptr_t obj, uint32_t *length) {
+    *length = vm_obj_header(obj)->length;
+    return (const char *)cap_check(obj, sizeof(vm_obj_t), *length);
+}
+
+static inline vm_value_t vm_elem(cap_ptr_t obj, uint32_t i) {
+    return *(vm_value_t *)cap_check(obj, sizeof(vm_obj_t) + (size_t)i * sizeof(vm_value_t), sizeof(vm_value_t));
+}
+
+// ---------------------------------------------------------------------------
+// Assembler
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    uint32_t *code;
+    uint32_t len, capacity;
+    vm_value_t *consts;
+    uint32_t const_count, const_capacity;
+    vm_func_t funcs[VM_MAX_FUNCS];
+    uint32_t func_count;
+    int failed;                 // Allocation failure or operand out of range
+} vm_asm_t;
+
+static inline void vm_emit(vm_asm_t *a, vm_opcode_t op, int32_t arg) {
+    if (arg < VM_ARG_MIN || arg > VM_ARG_MAX) a->failed = 1;
+    if (a->len == a->capacity) {
+        uint32_t capacity = a->capacity ? a->capacity * 2 : 256;
+        uint32_t *code = realloc(a->code, capacity * sizeof(uint32_t));
+        if (!code) {
+            a->failed = 1;
+            return;
+        }
+        a->code = code;
+        a->capacity = capacity;
+    }
+    a->code[a->len++] = VM_INSN(op, arg);
+}
+
+static inline uint32_t vm_here(const vm_asm_t *a) {
+    return a->len;
+}
+
+// Forward jump; returns the site to patch once the target is known
+static inline uint32_t vm_emit_jump(vm_asm_t *a, vm_opcode_t op) {
+    vm_emit(a, op, 0);
+    return a->len - 1;
+}
+
+static inline void vm_patch(vm_asm_t *a, uint32_t site, uint32_t target) {
+    if (a->failed) return;
+    int32_t offset = (int32_t)target - (int32_t)(site + 1);
+    a->code[site] = VM_INSN(VM_INSN_OP(a->code[site]), offset);
+}
+
+// Backward jump to an already emitted target
+static inline void vm_emit_jump_to(vm_asm_t *a, vm_opcode_t op, uint32_t target) {
+    vm_emit(a, op, (int32_t)target - (int32_t)(a->len + 1));
+}
+
+static inline int32_t vm_const_num(vm_asm_t *a, double d) {
+    if (a->const_count == a->const_capacity) {
+        uint32_t capacity = a->const_capacity ? a->const_capacity * 2 : 64;
+        vm_value_t *consts = realloc(a->consts, capacity * sizeof(vm_value_t));
+        if (!consts) {
+            a->failed = 1;
+            return 0;
+        }
+        a->consts = consts;
+        a->const_capacity = capacity;
+    }
+    vm_value_t *v = &a->consts[a->const_count];
+    memset(v, 0, sizeof(*v));
+    v->tag = VM_NUM;
+    v->as.d = d;
+    return (int32_t)a->const_count++;
+}
+
+// Declare first so calls can be emitted before the body
+static inline int32_t vm_declare_func(vm_asm_t *a, uint16_t args, uint16_t locals) {
+    if (a->func_count == VM_MAX_FUNCS) {
+        a->failed = 1;
+        return 0;
+    }
+    vm_func_t *f = &a->funcs[a->func_count];
+    f->entry = 0;
+    f->args = args;
+    f->locals = locals;
+    return (int32_t)a->func_count++;
+}
+
+static inline void vm_begin_func(vm_asm_t *a, int32_t func) {
+    a->funcs[func].entry = a->len;
+}
+
+// Copies the program into bounded allocations and frees the assembler
+static inline int vm_asm_finish(vm_asm_t *a, vm_program_t *prog) {
+    int failed = a->failed || a->len == 0;
+    memset(prog, 0, sizeof(*prog));
+    if (!failed) {
+        prog->code_len = a->len;
+        prog->const_count = a->const_count;
+        prog->func_count = a->func_count;
+        prog->code = cap_malloc(a->len * sizeof(uint32_t));
+        prog->consts = cap_malloc((a->const_count ? a->const_count : 1) * sizeof(vm_value_t));
+        prog->funcs = cap_malloc((a->func_count ? a->func_count : 1) * sizeof(vm_func_t));
+        failed = cap_is_null(prog->code) || cap_is_null(prog->consts) || cap_is_null(prog->funcs);
+    }
+    if (!failed) {
+        memcpy(cap_check(prog->code, 0, a->len * sizeof(uint32_t)), a->code, a->len * sizeof(uint32_t));
+        if (a->const_count) {
+            memcpy(cap_check(prog->consts, 0, a->const_count * sizeof(vm_value_t)), a->consts,
+                   a->const_count * sizeof(vm_value_t));
+        }
+        memcpy(cap_check(prog->funcs, 0, a->func_count * sizeof(vm_func_t)), a->funcs,
+               a->func_count * sizeof(vm_func_t));
+    }
+    free(a->code);
+    free(a->consts);
+    memset(a, 0, sizeof(*a));
+    return failed ? -1 : 0;
+}
+
+static inline void vm_program_free(vm_program_t *prog) {
+    cap_free(prog->code);
+    cap_free(prog->consts);
+    cap_free(prog->funcs);
+}
+
+#endif // VM_H
@@ -0,0 +1,405 @@
+/*
+ * Bytecode VM - Interpreter loop template
+ *
+ * Included once per variant (klib-style) after common/vm.h. Define:
+ *   VM_NAME(x)          prefix for the generated functions, e.g. vm_goto_##x
+ *   VM_COMPUTED_GOTO    1: threaded dispatch through a label table
+ *                       0: a switch in a loop
+ *   VM_CHECKED          1: every code, stack, frame and heap access goes
+ *                       through cap_check (bounds enforced in softcap)
+ *                       0: the same capabilities dereferenced unchecked,
+ *                       to measure what the software checks cost
+ * The parameters are undefined again at the end of the file.
+ *
+ * Generated: int VM_NAME(run)(vm_t *vm, uint32_t func)
+ *   Calls func (no arguments) with a fresh stack; 0 and vm->result on
+ *   return or HALT, -1 with vm->error on a VM error. vm->ops counts the
+ *   instructions dispatched.
+ */
+
+#include <math.h>
+
+#if VM_CHECKED
+#define VM_PTR(cap, offset, size) cap_check((cap), (offset), (size))
+#else
+#define VM_PTR(cap, offset, size) ((void *)((char *)cap_addr(cap) + (offset)))
+#endif
+#define VM_AT(cap, type, i) (*(type *)VM_PTR((cap), (size_t)(i) * sizeof(type), sizeof(type)))
+#define VM_HDR(obj) ((vm_obj_t *)VM_PTR((obj), 0, sizeof(vm_obj_t)))
+#define VM_ELEM(obj, type, i) \
+    (*(type *)VM_PTR((obj), sizeof(vm_obj_t) + (size_t)(i) * sizeof(type), sizeof(type)))
+
+static cap_ptr_t VM_NAME(alloc)(vm_t *vm, uint32_t kind, uint32_t capacity, size_t payload) {
+    size_t size = sizeof(vm_obj_t) + payload;
+    size_t at = (vm->heap_used + 15) & ~(size_t)15;
+    if (at > vm->heap_size || size > vm->heap_size - at) return CAP_NULL;
+    vm->heap_used = at + size;
+    cap_ptr_t obj = cap_sub(vm->heap, at, size);
+    vm_obj_t *h = VM_HDR(obj);
+    h->kind = kind;
+    h->length = 0;
+    h->capacity = capacity;
+    h->reserved = 0;
+    return obj;
+}
+
+// String with room for need bytes: s itself, or a grown copy (CAP_NULL when
+// the heap is exhausted)
+static cap_ptr_t VM_NAME(str_reserve)(vm_t *vm, cap_ptr_t s, uint32_t need) {
+    vm_obj_t *h = VM_HDR(s);
+    if (need <= h->capacity) return s;
+    uint32_t capacity = h->capacity * 2 > need ? h->capacity * 2 : need;
+    if (capacity < 16) capacity = 16;
+    cap_ptr_t grown = VM_NAME(alloc)(vm, VM_STR, capacity, capacity);
+    if (cap_is_null(grown)) return CAP_NULL;
+    uint32_t length = h->length;
+    if (length) {
+        memcpy(VM_PTR(grown, sizeof(vm_obj_t), length), VM_PTR(s, sizeof(vm_obj_t), length), length);
+    }
+    VM_HDR(grown)->length = length;
+    return grown;
+}
+
+static inline int VM_NAME(to_num)(vm_value_t v, double *out) {
+    if (v.tag == VM_INT) *out = (double)v.as.i;
+    else if (v.tag == VM_NUM) *out = v.as.d;
+    else return 0;
+    return 1;
+}
+
+static int VM_NAME(run)(vm_t *vm, uint32_t func) {
+    const vm_program_t *p = vm->prog;
+    const cap_ptr_t code = p->code, stack = vm->stack, frames = vm->frames;
+    const vm_value_t nil = { VM_NIL, { 0 } };
+    uint32_t pc, insn, sp = 0, fp = 0, depth = 0;
+    uint64_t ops = 0;
+    vm_value_t a, b, c;
+    double x, y;
+
+#define PUSH(v) (VM_AT(stack, vm_value_t, sp++) = (v))
+#define POP() VM_AT(stack, vm_value_t, --sp)
+#define TOP() VM_AT(stack, vm_value_t, sp - 1)
+#define ARG() VM_INSN_ARG(insn)
+#define FAIL(msg)           \
+    do {                    \
+        vm->error = (msg);  \
+        goto fail;          \
+    } while (0)
+
+    vm_func_t f = VM_AT(p->funcs, vm_func_t, func);
+    vm_frame_t host = { VM_RETURN_TO_HOST, 0 };
+    VM_AT(frames, vm_frame_t, depth++) = host;
+    for (uint32_t l = 0; l < f.locals; l++) PUSH(nil);
+    pc = f.entry;
+
+#if VM_COMPUTED_GOTO
+    static const void *const dispatch[VM_OP_COUNT] = {
+#define VM_LABEL_ADDR(name) &&op_##name,
+        VM_OPCODES(VM_LABEL_ADDR)
+#undef VM_LABEL_ADDR
+    };
+#define OP(name) op_##name:
+#define NEXT()                                  \
+    do {                                        \
+        insn = VM_AT(code, uint32_t, pc++);     \
+        ops++;                                  \
+        goto *dispatch[VM_INSN_OP(insn)];       \
+    } while (0)
+    NEXT();
+#else
+#define OP(name) case VM_OP_##name:
+#define NEXT() continue
+    for (;;) {
+        insn = VM_AT(code, uint32_t, pc++);
+        ops++;
+        switch (VM_INSN_OP(insn)) {
+#endif
+
+    OP(PUSHI) {
+        a.tag = VM_INT;
+        a.as.i = ARG();
+        PUSH(a);
+        NEXT();
+    }
+    OP(PUSHK) {
+        a = VM_AT(p->consts, vm_value_t, ARG());
+        PUSH(a);
+        NEXT();
+    }
+    OP(NIL) {
+        PUSH(nil);
+        NEXT();
+    }
+    OP(POP) {
+        sp--;
+        NEXT();
+    }
+    OP(DUP) {
+        a = TOP();
+        PUSH(a);
+        NEXT();
+    }
+    OP(LOAD) {
+        a = VM_AT(stack, vm_value_t, fp + ARG());
+        PUSH(a);
+        NEXT();
+    }
+    OP(STORE) {
+        a = POP();
+        VM_AT(stack, vm_value_t, fp + ARG()) = a;
+        NEXT();
+    }
+
+#define VM_ARITH(name, operator)                                            \
+    OP(name) {                                                              \
+        b = POP();                                                          \
+        a = TOP();                                                          \
+        if (a.tag == VM_INT && b.tag == VM_INT) {                           \
+            a.as.i = (int64_t)((uint64_t)a.as.i operator (uint64_t)b.as.i); \
+        } else {                                                            \
+            if (!VM_NAME(to_num)(a, &x) || !VM_NAME(to_num)(b, &y)) {       \
+                FAIL("arithmetic on a non-number");                         \
+            }                                                               \
+            a.tag = VM_NUM;                                                 \
+            a.as.d = x operator y;                                          \
+        }                                                                   \
+        TOP() = a;                                                          \
+        NEXT();                                                             \
+    }
+    VM_ARITH(ADD, +)
+    VM_ARITH(SUB, -)
+    VM_ARITH(MUL, *)
+#undef VM_ARITH
+
+    OP(DIV) {
+        b = POP();
+        a = TOP();
+        if (a.tag == VM_INT && b.tag == VM_INT) {
+            if (b.as.i == 0) FAIL("division by zero");
+            a.as.i /= b.as.i;
+        } else {
+            if (!VM_NAME(to_num)(a, &x) || !VM_NAME(to_num)(b, &y)) FAIL("arithmetic on a non-number");
+            a.tag = VM_NUM;
+            a.as.d = x / y;
+        }
+        TOP() = a;
+        NEXT();
+    }
+    OP(MOD) {
+        b = POP();
+        a = TOP();
+        if (a.tag != VM_INT || b.tag != VM_INT) FAIL("modulo of a non-integer");
+        if (b.as.i == 0) FAIL("division by zero");
+        a.as.i %= b.as.i;
+        TOP() = a;
+        NEXT();
+    }
+
+#define VM_COMPARE(name, operator)                                          \
+    OP(name) {                                                              \
+        b = POP();                                                          \
+        a = TOP();                                                          \
+        if (a.tag == VM_INT && b.tag == VM_INT) {                           \
+            a.as.i = a.as.i operator b.as.i;                                \
+        } else {                                                            \
+            if (!VM_NAME(to_num)(a, &x) || !VM_NAME(to_num)(b, &y)) {       \
+                FAIL("comparison of a non-number");                         \
+            }                                                               \
+            a.as.i = x operator y;                                          \
+        }                                                                   \
+        a.tag = VM_INT;                                                     \
+        TOP() = a;                                                          \
+        NEXT();                                                             \
+    }
+    VM_COMPARE(LT, <)
+    VM_COMPARE(LE, <=)
+#undef VM_COMPARE
+
+    OP(EQ) {
+        b = POP();
+        a = TOP();
+        if ((a.tag == VM_ARR || a.tag == VM_STR) && a.tag == b.tag) {
+            a.as.i = cap_same(a.as.ref, b.as.ref);
+        } else if (a.tag == VM_NIL || b.tag == VM_NIL) {
+            a.as.i = a.tag == b.tag;
+        } else if (a.tag == VM_INT && b.tag == VM_INT) {
+            a.as.i = a.as.i == b.as.i;
+        } else {
+            a.as.i = VM_NAME(to_num)(a, &x) && VM_NAME(to_num)(b, &y) && x == y;
+        }
+        a.tag = VM_INT;
+        TOP() = a;
+        NEXT();
+    }
+    OP(SQRT) {
+        a = TOP();
+        if (!VM_NAME(to_num)(a, &x)) FAIL("arithmetic on a non-number");
+        a.tag = VM_NUM;
+        a.as.d = sqrt(x);
+        TOP() = a;
+        NEXT();
+    }
+
+    OP(JMP) {
+        pc += (uint32_t)ARG();
+        NEXT();
+    }
+    OP(JF) {
+        a = POP();
+        if (a.tag == VM_NIL || (a.tag == VM_INT && a.as.i == 0)) pc += (uint32_t)ARG();
+        NEXT();
+    }
+    OP(CALL) {
+        f = VM_AT(p->funcs, vm_func_t, ARG());
+        if (depth == vm->frame_slots || sp + f.locals + VM_FRAME_HEADROOM > vm->stack_slots) {
+            FAIL("stack overflow");
+        }
+        vm_frame_t frame = { pc, fp };
+        VM_AT(frames, vm_frame_t, depth++) = frame;
+        fp = sp - f.args;
+        for (uint32_t l = 0; l < f.locals; l++) PUSH(nil);
+        pc = f.entry;
+        NEXT();
+    }
+    OP(RET) {
+        a = POP();
+        vm_frame_t frame = VM_AT(frames, vm_frame_t, --depth);
+        sp = fp;
+        fp = frame.fp;
+        pc = frame.ret_pc;
+        if (pc == VM_RETURN_TO_HOST) {
+            vm->result = a;
+            goto done;
+        }
+        PUSH(a);
+        NEXT();
+    }
+    OP(HALT) {
+        vm->result = sp > 0 ? TOP() : nil;
+        goto done;
+    }
+
+    OP(NEWARR) {
+        a = TOP();
+        if (a.tag != VM_INT || a.as.i < 0 || a.as.i > UINT32_MAX) FAIL("bad array length");
+        uint32_t n = (uint32_t)a.as.i;
+        a.as.ref = VM_NAME(alloc)(vm, VM_ARR, n, (size_t)n * sizeof(vm_value_t));
+        if (cap_is_null(a.as.ref)) FAIL("heap exhausted");
+        for (uint32_t i = 0; i < n; i++) VM_ELEM(a.as.ref, vm_value_t, i) = nil;
+        VM_HDR(a.as.ref)->length = n;
+        a.tag = VM_ARR;
+        TOP() = a;
+        NEXT();
+    }
+    OP(AGET) {
+        b = POP();
+        a = TOP();
+        if (a.tag != VM_ARR || b.tag != VM_INT) FAIL("bad array access");
+        if ((uint64_t)b.as.i >= VM_HDR(a.as.ref)->length) FAIL("array index out of range");
+        c = VM_ELEM(a.as.ref, vm_value_t, b.as.i);
+        TOP() = c;
+        NEXT();
+    }
+    OP(ASET) {
+        c = POP();
+        b = POP();
+        a = POP();
+        if (a.tag != VM_ARR || b.tag != VM_INT) FAIL("bad array access");
+        if ((uint64_t)b.as.i >= VM_HDR(a.as.ref)->length) FAIL("array index out of range");
+        VM_ELEM(a.as.ref, vm_value_t, b.as.i) = c;
+        NEXT();
+    }
+    OP(ALEN) {
+        a = TOP();
+        if (a.tag != VM_ARR) FAIL("length of a non-array");
+        a.as.i = VM_HDR(a.as.ref)->length;
+        a.tag = VM_INT;
+        TOP() = a;
+        NEXT();
+    }
+
+    OP(NEWSTR) {
+        a = TOP();
+        if (a.tag != VM_INT || a.as.i < 0 || a.as.i > UINT32_MAX) FAIL("bad string capacity");
+        a.as.ref = VM_NAME(alloc)(vm, VM_STR, (uint32_t)a.as.i, (size_t)a.as.i);
+        if (cap_is_null(a.as.ref)) FAIL("heap exhausted");
+        a.tag = VM_STR;
+        TOP() = a;
+        NEXT();
+    }
+    OP(SPUSH) {
+        b = POP();
+        a = TOP();
+        if (a.tag != VM_STR || b.tag != VM_INT) FAIL("bad string append");
+        uint32_t length = VM_HDR(a.as.ref)->length;
+        a.as.ref = VM_NAME(str_reserve)(vm, a.as.ref, length + 1);
+        if (cap_is_null(a.as.ref)) FAIL("heap exhausted");
+        VM_ELEM(a.as.ref, uint8_t, length) = (uint8_t)b.as.i;
+        VM_HDR(a.as.ref)->length = length + 1;
+        TOP() = a;
+        NEXT();
+    }
+    OP(SAPP) {
+        b = POP();
+        a = TOP();
+        if (a.tag != VM_STR || b.tag != VM_STR) FAIL("bad string append");
+        uint32_t length = VM_HDR(a.as.ref)->length, extra = VM_HDR(b.as.ref)->length;
+        a.as.ref = VM_NAME(str_reserve)(vm, a.as.ref, length + extra);
+        if (cap_is_null(a.as.ref)) FAIL("heap exhausted");
+        if (extra) {
+            memcpy(VM_PTR(a.as.ref, sizeof(vm_obj_t) + length, extra), VM_PTR(b.as.ref, sizeof(vm_obj_t), extra),
+                   extra);
+        }
+        VM_HDR(a.as.ref)->length = length + extra;
+        TOP() = a;
+        NEXT();
+    }
+    OP(SLEN) {
+        a = TOP();
+        if (a.tag != VM_STR) FAIL("length of a non-string");
+        a.as.i = VM_HDR(a.as.ref)->length;
+        a.tag = VM_INT;
+        TOP() = a;
+        NEXT();
+    }
+    OP(SGET) {
+        b = POP();
+        a = TOP();
+        if (a.tag != VM_STR || b.tag != VM_INT) FAIL("bad string access");
+        if ((uint64_t)b.as.i >= VM_HDR(a.as.ref)->length) FAIL("string index out of range");
+        a.as.i = VM_ELEM(a.as.ref, uint8_t, b.as.i);
+        a.tag = VM_INT;
+        TOP() = a;
+        NEXT();
+    }
+
+#if !VM_COMPUTED_GOTO
+        default:
+            FAIL("bad opcode");
+        }
+    }
+#endif
+
+done:
+    vm->ops = ops;
+    return 0;
+fail:
+    vm->ops = ops;
+    return -1;
+
+#undef PUSH
+#undef POP
+#undef TOP
+#undef ARG
+#undef FAIL
+#undef OP
+#undef NEXT
+}
+
+#undef VM_PTR
+#undef VM_AT
+#undef VM_HDR
+#undef VM_ELEM
+#undef VM_NAME
+#undef VM_COMPUTED_GOTO
+#undef VM_CHECKED
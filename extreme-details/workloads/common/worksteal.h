@@ -0,0 +1,440 @@
+/*
+ * Work-Stealing Runtime - Chase-Lev deques, fork-join, parallel_for/reduce
+ *
+ * A fixed pool of workers, each owning a Chase-Lev deque (Le et al.,
+ * "Correct and Efficient Work-Stealing for Weak Memory Models", PPoPP'13).
+ * The owner pushes and pops at the bottom; idle workers steal from the top
+ * of a random victim. Tasks are strictly nested fork-join: a task is
+ * spawned into a caller-owned ws_task_t and joined with ws_sync before
+ * the caller returns, so task records live on the spawner's stack and the
+ * runtime never allocates.
+ *
+ * Capability discipline: a task carries one capture capability bounded to
+ * the data it was handed, and reaches everything else through it. Range
+ * tasks hand each half a capture bounded to its own split record. Deque
+ * slots hold task pointers (capabilities under purecap CHERI); the softcap
+ * build keeps them pointer-wide because a 16-byte fat pointer cannot be
+ * loaded atomically without cmpxchg16b/libatomic.
+ *
+ * ws_parallel_for/ws_parallel_reduce use lazy binary splitting: a range is
+ * consumed in grain-sized chunks and the remainder is halved only while the
+ * worker's own deque is empty, i.e. when nobody has spare work to steal.
+ * The grain therefore adapts to the load; grain 0 picks a floor of about
+ * WS_CHUNKS_PER_THREAD chunks per worker.
+ */
+
+#ifndef WORKSTEAL_H
+#define WORKSTEAL_H
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "capmodel.h"
+
+#define WS_MAX_THREADS          256
+#define WS_DEQUE_SLOTS          4096    // Power of two; a full deque runs the task inline
+#define WS_CHUNKS_PER_THREAD    64      // Auto grain floor: n / (threads * this)
+#define WS_IDLE_SPINS           64      // Failed steal rounds before yielding the CPU
+#define WS_CACHE_LINE           64
+
+#if defined(__x86_64__) || defined(__i386__)
+#define WS_CPU_RELAX() __builtin_ia32_pause()
+#else
+#define WS_CPU_RELAX() ((void)0)
+#endif
+
+typedef struct ws_worker ws_worker_t;
+typedef struct ws_pool ws_pool_t;
+
+typedef void (*ws_task_fn)(ws_worker_t *w, cap_ptr_t capture);
+
+typedef struct {
+    ws_task_fn fn;
+    cap_ptr_t capture;          // Bounded to the task's data
+    int done;                   // Released once fn has returned
+} ws_task_t;
+
+typedef union {
+    int64_t i;
+    uint64_t u;
+    double d;
+} ws_value_t;
+
+typedef void (*ws_range_fn)(ws_worker_t *w, cap_ptr_t capture, size_t lo, size_t hi);
+typedef ws_value_t (*ws_reduce_fn)(ws_worker_t *w, cap_ptr_t capture, size_t lo, size_t hi);
+typedef ws_value_t (*ws_combine_fn)(ws_value_t a, ws_value_t b);
+
+typedef struct {
+    int64_t top;                // Thieves advance with CAS
+    char pad0[WS_CACHE_LINE - sizeof(int64_t)];
+    int64_t bottom;             // Written only by the owner
+    char pad1[WS_CACHE_LINE - sizeof(int64_t)];
+    ws_task_t *slots[WS_DEQUE_SLOTS];
+} ws_deque_t;
+
+typedef struct {
+    uint64_t spawned;           // Tasks pushed
+    uint64_t inlined;           // Spawns run immediately because the deque was full
+    uint64_t stolen;            // Tasks this worker took from a victim
+    uint64_t steal_attempts;
+} ws_stats_t;
+
+struct ws_worker {
+    ws_deque_t deque;
+    ws_pool_t *pool;
+    int id;
+    uint64_t rng;               // Victim selection
+    ws_stats_t stats;
+    pthread_t thread;
+} __attribute__((aligned(WS_CACHE_LINE)));
+
+struct ws_pool {
+    ws_worker_t *workers;       // workers[0] is whichever thread calls ws_run
+    int threads;
+    int active;                 // Helpers steal while set
+    int shutdown;
+    uint64_t epoch;             // Bumped by every ws_run
+    int pending;                // Helpers that have not yet parked after this epoch
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t parked;
+};
+
+// ---------------------------------------------------------------------------
+// Chase-Lev deque
+// ---------------------------------------------------------------------------
+
+static inline int ws_deque_push(ws_deque_t *d, ws_task_t *task) {
+    int64_t b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED);
+    int64_t t = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+    if (b - t >= WS_DEQUE_SLOTS) return -1;
+    __atomic_store_n(&d->slots[b & (WS_DEQUE_SLOTS - 1)], task, __ATOMIC_RELAXED);
+    __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELEASE);  // Publishes the task to thieves
+    return 0;
+}
+
+static inline ws_task_t *ws_deque_pop(ws_deque_t *d) {
+    int64_t b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED) - 1;
+    __atomic_store_n(&d->bottom, b, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int64_t t = __atomic_load_n(&d->top, __ATOMIC_RELAXED);
+    if (t > b) {
+        __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+        return NULL;
+    }
+    ws_task_t *task = __atomic_load_n(&d->slots[b & (WS_DEQUE_SLOTS - 1)], __ATOMIC_RELAXED);
+    if (t == b) {
+        // Last task: race the thieves for it
+        if (!__atomic_compare_exchange_n(&d->top, &t, t + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+            task = NULL;
+        }
+        __atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+    }
+    return task;
+}
+
+static inline ws_task_t *ws_deque_steal(ws_deque_t *d) {
+    int64_t t = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    int64_t b = __atomic_load_n(&d->bottom, __ATOMIC_ACQUIRE);
+    if (t >= b) return NULL;
+    ws_task_t *task = __atomic_load_n(&d->slots[t & (WS_DEQUE_SLOTS - 1)], __ATOMIC_RELAXED);
+    if (!__atomic_compare_exchange_n(&d->top, &t, t + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+        return NULL;            // Lost to the owner or another thief
+    }
+    return task;
+}
+
+static inline int ws_deque_empty(ws_deque_t *d) {
+    int64_t b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED);
+    int64_t t = __atomic_load_n(&d->top, __ATOMIC_RELAXED);
+    return b <= t;
+}
+
+// ---------------------------------------------------------------------------
+// Scheduling
+// ---------------------------------------------------------------------------
+
+static inline int ws_worker_id(const ws_worker_t *w) {
+    return w->id;
+}
+
+static inline int ws_worker_count(const ws_worker_t *w) {
+    return w->pool->threads;
+}
+
+static inline void ws_execute(ws_worker_t *w, ws_task_t *task) {
+    task->fn(w, task->capture);
+    __atomic_store_n(&task->done, 1, __ATOMIC_RELEASE);
+}
+
+// One pass over the other workers, starting at a random victim
+static inline ws_task_t *ws_steal_any(ws_worker_t *w) {
+    int threads = w->pool->threads;
+    if (threads < 2) return NULL;
+    w->rng ^= w->rng >> 12;
+    w->rng ^= w->rng << 25;
+    w->rng ^= w->rng >> 27;
+    int start = (int)((w->rng * 0x2545F4914F6CDD1Dull) >> 33) % threads;
+    for (int i = 0; i < threads; i++) {
+        int victim = (start + i) % threads;
+        if (victim == w->id) continue;
+        w->stats.steal_attempts++;
+        ws_task_t *task = ws_deque_steal(&w->pool->workers[victim].deque);
+        if (task) {
+            w->stats.stolen++;
+            return task;
+        }
+    }
+    return NULL;
+}
+
+// Make fn(capture) available to thieves; join it with ws_sync
+static inline void ws_spawn(ws_worker_t *w, ws_task_t *task, ws_task_fn fn, cap_ptr_t capture) {
+    task->fn = fn;
+    task->capture = capture;
+    task->done = 0;
+    if (ws_deque_push(&w->deque, task) != 0) {
+        w->stats.inlined++;
+        ws_execute(w, task);
+        return;
+    }
+    w->stats.spawned++;
+}
+
+/*
+ * Wait for a spawned task. Spawns are strictly nested, so an unstolen task
+ * is still at the bottom of our deque and runs inline; a stolen one is
+ * waited for by stealing other work in the meantime.
+ */
+static inline void ws_sync(ws_worker_t *w, ws_task_t *task) {
+    if (__atomic_load_n(&task->done, __ATOMIC_ACQUIRE)) return;
+    ws_task_t *own = ws_deque_pop(&w->deque);
+    if (own == task) {
+        ws_execute(w, task);
+        return;
+    }
+    if (own) ws_execute(w, own);    // Only reachable if a caller skipped a sync
+    while (!__atomic_load_n(&task->done, __ATOMIC_ACQUIRE)) {
+        ws_task_t *other = ws_steal_any(w);
+        if (other) {
+            ws_execute(w, other);
+        } else {
+            WS_CPU_RELAX();
+        }
+    }
+}
+
+static void *ws_helper_main(void *arg) {
+    ws_worker_t *w = arg;
+    ws_pool_t *pool = w->pool;
+    uint64_t seen = 0;
+
+    for (;;) {
+        pthread_mutex_lock(&pool->lock);
+        while (!pool->shutdown && pool->epoch == seen) pthread_cond_wait(&pool->wake, &pool->lock);
+        if (pool->shutdown) {
+            pthread_mutex_unlock(&pool->lock);
+            return NULL;
+        }
+        seen = pool->epoch;
+        pthread_mutex_unlock(&pool->lock);
+
+        int idle = 0;
+        while (__atomic_load_n(&pool->active, __ATOMIC_ACQUIRE)) {
+            ws_task_t *task = ws_steal_any(w);
+            if (task) {
+                ws_execute(w, task);
+                idle = 0;
+            } else if (++idle >= WS_IDLE_SPINS) {
+                sched_yield();
+                idle = 0;
+            } else {
+                WS_CPU_RELAX();
+            }
+        }
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->pending == 0) pthread_cond_signal(&pool->parked);
+        pthread_mutex_unlock(&pool->lock);
+    }
+}
+
+// Returns 0 on success; helper threads park until the first ws_run
+static inline int ws_pool_init(ws_pool_t *pool, int threads) {
+    memset(pool, 0, sizeof(*pool));
+    if (threads < 1 || threads > WS_MAX_THREADS) return -1;
+    pool->workers = aligned_alloc(WS_CACHE_LINE, (size_t)threads * sizeof(ws_worker_t));
+    if (!pool->workers) return -1;
+    memset(pool->workers, 0, (size_t)threads * sizeof(ws_worker_t));
+    pool->threads = threads;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->parked, NULL);
+    for (int i = 0; i < threads; i++) {
+        ws_worker_t *w = &pool->workers[i];
+        w->pool = pool;
+        w->id = i;
+        w->rng = 0x9E3779B97F4A7C15ull * (uint64_t)(i + 1);
+    }
+    for (int i = 1; i < threads; i++) {
+        if (pthread_create(&pool->workers[i].thread, NULL, ws_helper_main, &pool->workers[i]) != 0) {
+            pool->threads = i;  // Destroy joins the helpers that did start
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static inline void ws_pool_destroy(ws_pool_t *pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->shutdown = 1;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    for (int i = 1; i < pool->threads; i++) pthread_join(pool->workers[i].thread, NULL);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->wake);
+    pthread_cond_destroy(&pool->parked);
+    free(pool->workers);
+    pool->workers = NULL;
+}
+
+/*
+ * Run fn(capture) as the root task on the calling thread (worker 0) with
+ * the helpers stealing. Returns once every helper has parked again, so
+ * worker statistics are stable between runs. Not reentrant.
+ */
+static inline void ws_run(ws_pool_t *pool, ws_task_fn fn, cap_ptr_t capture) {
+    pthread_mutex_lock(&pool->lock);
+    pool->pending = pool->threads - 1;
+    __atomic_store_n(&pool->active, 1, __ATOMIC_RELEASE);
+    pool->epoch++;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    ws_task_t root = { fn, capture, 0 };
+    ws_execute(&pool->workers[0], &root);
+
+    __atomic_store_n(&pool->active, 0, __ATOMIC_RELEASE);
+    pthread_mutex_lock(&pool->lock);
+    while (pool->pending > 0) pthread_cond_wait(&pool->parked, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+static inline void ws_pool_stats(const ws_pool_t *pool, ws_stats_t *total) {
+    memset(total, 0, sizeof(*total));
+    for (int i = 0; i < pool->threads; i++) {
+        const ws_stats_t *s = &pool->workers[i].stats;
+        total->spawned += s->spawned;
+        total->inlined += s->inlined;
+        total->stolen += s->stolen;
+        total->steal_attempts += s->steal_attempts;
+    }
+}
+
+static inline void ws_pool_reset_stats(ws_pool_t *pool) {
+    for (int i = 0; i < pool->threads; i++) memset(&pool->workers[i].stats, 0, sizeof(ws_stats_t));
+}
+
+// ---------------------------------------------------------------------------
+// parallel_for / parallel_reduce
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    ws_range_fn for_body;       // Exactly one of the two bodies is set
+    ws_reduce_fn reduce_body;
+    ws_combine_fn combine;
+    ws_value_t identity;
+    cap_ptr_t capture;          // Handed to every body call
+    size_t grain;
+} ws_range_job_t;
+
+typedef struct {
+    cap_ptr_t job;              // ws_range_job_t
+    size_t lo, hi;
+    ws_value_t result;
+} ws_range_split_t;
+
+static inline ws_value_t ws_range_chunk(ws_worker_t *w, const ws_range_job_t *job, size_t lo, size_t hi) {
+    if (job->reduce_body) return job->reduce_body(w, job->capture, lo, hi);
+    job->for_body(w, job->capture, lo, hi);
+    return job->identity;
+}
+
+static ws_value_t ws_range_run(ws_worker_t *w, cap_ptr_t job_cap, size_t lo, size_t hi);
+
+static void ws_range_task(ws_worker_t *w, cap_ptr_t capture) {
+    ws_range_split_t *split = CAP_OBJ(capture, ws_range_split_t);
+    split->result = ws_range_run(w, split->job, split->lo, split->hi);
+}
+
+// Lazy binary splitting: halve the remainder only while our deque is empty
+static ws_value_t ws_range_run(ws_worker_t *w, cap_ptr_t job_cap, size_t lo, size_t hi) {
+    const ws_range_job_t *job = CAP_OBJ(job_cap, ws_range_job_t);
+    ws_value_t acc = job->identity;
+
+    while (hi - lo > job->grain) {
+        if (w->pool->threads > 1 && ws_deque_empty(&w->deque)) {
+            size_t mid = lo + (hi - lo) / 2;
+            ws_range_split_t split = { job_cap, mid, hi, job->identity };
+            ws_task_t task;
+            ws_spawn(w, &task, ws_range_task, cap_make(&split, sizeof(split)));
+            ws_value_t left = ws_range_run(w, job_cap, lo, mid);
+            ws_sync(w, &task);
+            if (job->reduce_body) {
+                acc = job->combine(acc, job->combine(left, split.result));
+            }
+            return acc;
+        }
+        ws_value_t part = ws_range_chunk(w, job, lo, lo + job->grain);
+        if (job->reduce_body) acc = job->combine(acc, part);
+        lo += job->grain;
+    }
+    if (hi > lo) {
+        ws_value_t part = ws_range_chunk(w, job, lo, hi);
+        if (job->reduce_body) acc = job->combine(acc, part);
+    }
+    return acc;
+}
+
+static inline size_t ws_auto_grain(const ws_worker_t *w, size_t n, size_t grain) {
+    if (grain) return grain;
+    grain = n / ((size_t)w->pool->threads * WS_CHUNKS_PER_THREAD);
+    return grain ? grain : 1;
+}
+
+// body(w, capture, lo, hi) over disjoint chunks of [lo, hi); call from a task
+static inline void ws_parallel_for(ws_worker_t *w, size_t lo, size_t hi, size_t grain,
+                                   ws_range_fn body, cap_ptr_t capture) {
+    if (hi <= lo) return;
+    ws_range_job_t job;
+    memset(&job, 0, sizeof(job));
+    job.for_body = body;
+    job.capture = capture;
+    job.grain = ws_auto_grain(w, hi - lo, grain);
+    ws_range_run(w, cap_make(&job, sizeof(job)), lo, hi);
+}
+
+/*
+ * Fold body results over [lo, hi) with an associative combine. Chunks are
+ * combined in range order, but the chunk boundaries depend on stealing, so
+ * floating-point sums may differ in the last bits between runs.
+ */
+static inline ws_value_t ws_parallel_reduce(ws_worker_t *w, size_t lo, size_t hi, size_t grain,
+                                            ws_reduce_fn body, ws_combine_fn combine,
+                                            ws_value_t identity, cap_ptr_t capture) {
+    if (hi <= lo) return identity;
+    ws_range_job_t job;
+    memset(&job, 0, sizeof(job));
+    job.reduce_body = body;
+    job.combine = combine;
+    job.identity = identity;
+    job.capture = capture;
+    job.grain = ws_auto_grain(w, hi - lo, grain);
+    return ws_range_run(w, cap_make(&job, sizeof(job)), lo, hi);
+}
+
+#endif // WORKSTEAL_H
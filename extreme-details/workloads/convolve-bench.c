@@ -0,0 +1,498 @@
+/*
+ * Real-World Application Stress Test - 2D Image Convolution
+ *
+ * Gaussian blurs from 3x3 to 15x15, both as a separable pair of 1D passes
+ * and as a general 2D kernel, over 8-bit grayscale images in two layouts:
+ *   rows  - an array of row capabilities, each bounded to its row, as in
+ *           `unsigned char **rows` code (libpng row_pointers and friends)
+ *   flat  - one strided buffer with a single capability for the image
+ * Two kernel styles run on each:
+ *   scalar - per-pixel accessor with clamped coordinates; every read derives
+ *            through the row pointer (rows) or the image capability (flat)
+ *   simd   - row pointers hoisted once per row, rows converted to float with
+ *            replicated edge pixels in a small ring buffer, and 8-wide vector
+ *            inner loops (GCC vector extensions, lowered to the target ISA)
+ * Edge handling never reads outside the image: out-of-range coordinates
+ * are clamped in the scalar style and padded from edge pixels in simd.
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "capmodel.h"
+#include "bench.h"
+
+// Benchmark configuration
+#define DEFAULT_WIDTH       1920
+#define DEFAULT_HEIGHT      1080
+#define DEFAULT_KERNELS     "3,7,15"
+#define DEFAULT_ITERATIONS  3
+#define MAX_KERNEL          15
+#define MAX_KERNEL_SIZES    7
+#define FLAT_ALIGN          64      // Flat layout row stride alignment
+#define VEC_LANES           8
+
+typedef float conv_vf __attribute__((vector_size(VEC_LANES * sizeof(float))));
+
+typedef enum { LAYOUT_ROWS = 0, LAYOUT_FLAT, LAYOUT_COUNT } layout_t;
+typedef enum { KIND_SEPARABLE = 0, KIND_GENERAL, KIND_COUNT } kind_t;
+typedef enum { STYLE_SCALAR = 0, STYLE_SIMD, STYLE_COUNT } style_t;
+
+static const char *const layout_names[LAYOUT_COUNT] = { "rows", "flat" };
+static const char *const kind_names[KIND_COUNT] = { "separable", "general" };
+static const char *const style_names[STYLE_COUNT] = { "scalar", "simd" };
+
+typedef struct {
+    layout_t layout;
+    uint32_t width, height;
+    size_t stride;              // flat: bytes between rows
+    cap_ptr_t pixels;           // flat: the whole image; rows: backing store
+    cap_ptr_t rows;             // rows: cap_ptr_t[height], each bounded to one row
+} image_t;
+
+typedef struct {
+    int size, radius;
+    float taps[MAX_KERNEL];                 // 1D Gaussian
+    float taps2d[MAX_KERNEL * MAX_KERNEL];  // Outer product of taps
+} kernel_t;
+
+// Float rows keyed by source row; a window of `size` consecutive rows never
+// maps two rows to one slot
+typedef struct {
+    float *buf;
+    size_t pitch;               // Floats per slot
+    int32_t tag[MAX_KERNEL];
+} ring_t;
+
+static uint64_t rng_state = 0x853C49E6748FEA9Bull;
+
+// ---------------------------------------------------------------------------
+// Images
+// ---------------------------------------------------------------------------
+
+static int image_alloc(image_t *img, layout_t layout, uint32_t width, uint32_t height) {
+    img->layout = layout;
+    img->width = width;
+    img->height = height;
+    img->stride = layout == LAYOUT_FLAT ? (width + FLAT_ALIGN - 1) / FLAT_ALIGN * FLAT_ALIGN : width;
+    img->pixels = cap_malloc(img->stride * height);
+    img->rows = CAP_NULL;
+    if (cap_is_null(img->pixels)) return -1;
+    if (layout == LAYOUT_ROWS) {
+        img->rows = cap_malloc((size_t)height * sizeof(cap_ptr_t));
+        if (cap_is_null(img->rows)) return -1;
+        for (uint32_t y = 0; y < height; y++) {
+            CAP_AT(img->rows, cap_ptr_t, y) = cap_sub(img->pixels, (size_t)y * width, width);
+        }
+    }
+    return 0;
+}
+
+static void image_free(image_t *img) {
+    cap_free(img->pixels);
+    if (!cap_is_null(img->rows)) cap_free(img->rows);
+}
+
+// Whole row, checked once
+static inline uint8_t *image_row(const image_t *img, uint32_t y) {
+    if (img->layout == LAYOUT_ROWS) return (uint8_t *)cap_check(CAP_AT(img->rows, cap_ptr_t, y), 0, img->width);
+    return (uint8_t *)cap_check(img->pixels, (size_t)y * img->stride, img->width);
+}
+
+// One pixel, checked on every access
+static inline uint8_t *image_px(const image_t *img, uint32_t x, uint32_t y) {
+    if (img->layout == LAYOUT_ROWS) return &CAP_AT(CAP_AT(img->rows, cap_ptr_t, y), uint8_t, x);
+    return &CAP_AT(img->pixels, uint8_t, (size_t)y * img->stride + x);
+}
+
+static void image_copy(image_t *dst, const image_t *src) {
+    for (uint32_t y = 0; y < src->height; y++) memcpy(image_row(dst, y), image_row(src, y), src->width);
+}
+
+// Smooth gradients, hard-edged blocks and sensor-like noise
+static void generate_image(image_t *img) {
+    for (uint32_t y = 0; y < img->height; y++) {
+        uint8_t *row = image_row(img, y);
+        for (uint32_t x = 0; x < img->width; x++) {
+            double v = 128.0 + 60.0 * sin(x * 0.013) * cos(y * 0.021);
+            if (((x / 97) ^ (y / 61)) % 5 == 0) v += 50.0;
+            v += (double)(bench_rng_next(&rng_state) % 33) - 16.0;
+            row[x] = (uint8_t)(v < 0.0 ? 0.0 : v > 255.0 ? 255.0 : v);
+        }
+    }
+}
+
+// Binary PGM (P5, maxval <= 255)
+static int load_pgm(const char *path, image_t *img) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    char magic[3];
+    unsigned width, height, maxval;
+    if (fscanf(f, "%2s %u %u %u", magic, &width, &height, &maxval) != 4 || strcmp(magic, "P5") != 0 ||
+        maxval == 0 || maxval > 255 || width == 0 || height == 0 || width > 65536 || height > 65536) {
+        fprintf(stderr, "%s: not an 8-bit binary PGM\n", path);
+        fclose(f);
+        return -1;
+    }
+    fgetc(f);   // Single whitespace before the raster
+    if (image_alloc(img, LAYOUT_FLAT, width, height) != 0) {
+        fclose(f);
+        return -1;
+    }
+    for (uint32_t y = 0; y < height; y++) {
+        if (fread(image_row(img, y), 1, width, f) != width) {
+            fprintf(stderr, "%s: truncated raster\n", path);
+            fclose(f);
+            return -1;
+        }
+    }
+    fclose(f);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Kernels
+// ---------------------------------------------------------------------------
+
+static void make_gaussian(kernel_t *k, int size) {
+    double sigma = size == 3 ? 0.8 : size / 6.0 + 0.5;
+    double sum = 0.0, taps[MAX_KERNEL];
+    k->size = size;
+    k->radius = size / 2;
+    for (int i = 0; i < size; i++) {
+        double d = i - k->radius;
+        taps[i] = exp(-d * d / (2.0 * sigma * sigma));
+        sum += taps[i];
+    }
+    for (int i = 0; i < size; i++) k->taps[i] = (float)(taps[i] / sum);
+    for (int i = 0; i < size; i++) {
+        for (int j = 0; j < size; j++) k->taps2d[i * size + j] = k->taps[i] * k->taps[j];
+    }
+}
+
+static inline uint32_t clamp_coord(int64_t v, uint32_t limit) {
+    return v < 0 ? 0 : v >= limit ? limit - 1 : (uint32_t)v;
+}
+
+static inline uint8_t to_u8(float v) {
+    v += 0.5f;
+    return v <= 0.0f ? 0 : v >= 255.0f ? 255 : (uint8_t)v;
+}
+
+// Vectors stay in macros and behind pointers so no vector crosses a call ABI
+#define LOAD_VF(v, p) memcpy(&(v), (p), sizeof(conv_vf))
+
+static inline void store_u8(uint8_t *dst, const conv_vf *acc) {
+    for (int i = 0; i < VEC_LANES; i++) dst[i] = to_u8((*acc)[i]);
+}
+
+// Scalar style: clamped coordinates, checked access per tap
+
+static void general_scalar(const image_t *in, image_t *out, const kernel_t *k) {
+    int r = k->radius;
+    for (uint32_t y = 0; y < in->height; y++) {
+        for (uint32_t x = 0; x < in->width; x++) {
+            float acc = 0.0f;
+            for (int ky = 0; ky < k->size; ky++) {
+                uint32_t sy = clamp_coord((int64_t)y + ky - r, in->height);
+                for (int kx = 0; kx < k->size; kx++) {
+                    uint32_t sx = clamp_coord((int64_t)x + kx - r, in->width);
+                    acc += k->taps2d[ky * k->size + kx] * (float)*image_px(in, sx, sy);
+                }
+            }
+            *image_px(out, x, y) = to_u8(acc);
+        }
+    }
+}
+
+static void separable_scalar(const image_t *in, image_t *out, const kernel_t *k, float *tmp) {
+    int r = k->radius;
+    uint32_t w = in->width;
+    for (uint32_t y = 0; y < in->height; y++) {
+        for (uint32_t x = 0; x < w; x++) {
+            float acc = 0.0f;
+            for (int kx = 0; kx < k->size; kx++) {
+                acc += k->taps[kx] * (float)*image_px(in, clamp_coord((int64_t)x + kx - r, w), y);
+            }
+            tmp[(size_t)y * w + x] = acc;
+        }
+    }
+    for (uint32_t y = 0; y < in->height; y++) {
+        for (uint32_t x = 0; x < w; x++) {
+            float acc = 0.0f;
+            for (int ky = 0; ky < k->size; ky++) {
+                acc += k->taps[ky] * tmp[(size_t)clamp_coord((int64_t)y + ky - r, in->height) * w + x];
+            }
+            *image_px(out, x, y) = to_u8(acc);
+        }
+    }
+}
+
+// SIMD style: rows hoisted and padded, vector interior
+
+static void ring_reset(ring_t *ring) {
+    for (int i = 0; i < MAX_KERNEL; i++) ring->tag[i] = -1;
+}
+
+// Row y as floats with `radius` replicated edge pixels on both sides
+static void pad_row(const image_t *in, uint32_t y, int radius, float *dst) {
+    const uint8_t *src = image_row(in, y);
+    uint32_t w = in->width;
+    for (int i = 0; i < radius; i++) dst[i] = src[0];
+    for (uint32_t x = 0; x < w; x++) dst[radius + x] = src[x];
+    for (int i = 0; i < radius; i++) dst[radius + w + i] = src[w - 1];
+}
+
+static void general_simd(const image_t *in, image_t *out, const kernel_t *k, ring_t *ring) {
+    int r = k->radius, size = k->size;
+    uint32_t w = in->width;
+    const float *src[MAX_KERNEL];
+    ring_reset(ring);
+    for (uint32_t y = 0; y < in->height; y++) {
+        for (int ky = 0; ky < size; ky++) {
+            uint32_t sy = clamp_coord((int64_t)y + ky - r, in->height);
+            float *slot = ring->buf + (sy % (uint32_t)size) * ring->pitch;
+            if (ring->tag[sy % (uint32_t)size] != (int32_t)sy) {
+                pad_row(in, sy, r, slot);
+                ring->tag[sy % (uint32_t)size] = (int32_t)sy;
+            }
+            src[ky] = slot;
+        }
+        uint8_t *dst = image_row(out, y);
+        uint32_t x = 0;
+        for (; x + VEC_LANES <= w; x += VEC_LANES) {
+            conv_vf acc = { 0 };
+            for (int ky = 0; ky < size; ky++) {
+                const float *s = src[ky] + x;
+                const float *t = k->taps2d + ky * size;
+                for (int kx = 0; kx < size; kx++) {
+                    conv_vf v;
+                    LOAD_VF(v, s + kx);
+                    acc += t[kx] * v;
+                }
+            }
+            store_u8(dst + x, &acc);
+        }
+        for (; x < w; x++) {
+            float acc = 0.0f;
+            for (int ky = 0; ky < size; ky++) {
+                for (int kx = 0; kx < size; kx++) acc += k->taps2d[ky * size + kx] * src[ky][x + kx];
+            }
+            dst[x] = to_u8(acc);
+        }
+    }
+}
+
+// Ring slots hold horizontally filtered rows; line is one padded input row
+static void separable_simd(const image_t *in, image_t *out, const kernel_t *k, ring_t *ring, float *line) {
+    int r = k->radius, size = k->size;
+    uint32_t w = in->width;
+    const float *src[MAX_KERNEL];
+    ring_reset(ring);
+    for (uint32_t y = 0; y < in->height; y++) {
+        for (int ky = 0; ky < size; ky++) {
+            uint32_t sy = clamp_coord((int64_t)y + ky - r, in->height);
+            float *slot = ring->buf + (sy % (uint32_t)size) * ring->pitch;
+            if (ring->tag[sy % (uint32_t)size] != (int32_t)sy) {
+                pad_row(in, sy, r, line);
+                uint32_t x = 0;
+                for (; x + VEC_LANES <= w; x += VEC_LANES) {
+                    conv_vf acc = { 0 };
+                    for (int kx = 0; kx < size; kx++) {
+                        conv_vf v;
+                        LOAD_VF(v, line + x + kx);
+                        acc += k->taps[kx] * v;
+                    }
+                    memcpy(slot + x, &acc, sizeof(acc));
+                }
+                for (; x < w; x++) {
+                    float acc = 0.0f;
+                    for (int kx = 0; kx < size; kx++) acc += k->taps[kx] * line[x + kx];
+                    slot[x] = acc;
+                }
+                ring->tag[sy % (uint32_t)size] = (int32_t)sy;
+            }
+            src[ky] = slot;
+        }
+        uint8_t *dst = image_row(out, y);
+        uint32_t x = 0;
+        for (; x + VEC_LANES <= w; x += VEC_LANES) {
+            conv_vf acc = { 0 };
+            for (int ky = 0; ky < size; ky++) {
+                conv_vf v;
+                LOAD_VF(v, src[ky] + x);
+                acc += k->taps[ky] * v;
+            }
+            store_u8(dst + x, &acc);
+        }
+        for (; x < w; x++) {
+            float acc = 0.0f;
+            for (int ky = 0; ky < size; ky++) acc += k->taps[ky] * src[ky][x];
+            dst[x] = to_u8(acc);
+        }
+    }
+}
+
+typedef struct {
+    ring_t ring;
+    float *line;
+    float *tmp;                 // Full-image intermediate for separable_scalar
+} scratch_t;
+
+static void convolve(const image_t *in, image_t *out, const kernel_t *k, kind_t kind, style_t style,
+                     scratch_t *s) {
+    if (kind == KIND_GENERAL) {
+        if (style == STYLE_SCALAR) general_scalar(in, out, k);
+        else general_simd(in, out, k, &s->ring);
+    } else {
+        if (style == STYLE_SCALAR) separable_scalar(in, out, k, s->tmp);
+        else separable_simd(in, out, k, &s->ring, s->line);
+    }
+}
+
+// Largest per-pixel difference; float summation order may differ by one step
+static int max_difference(const image_t *a, const image_t *b) {
+    int worst = 0;
+    for (uint32_t y = 0; y < a->height; y++) {
+        const uint8_t *ra = image_row(a, y), *rb = image_row(b, y);
+        for (uint32_t x = 0; x < a->width; x++) {
+            int d = abs((int)ra[x] - (int)rb[x]);
+            if (d > worst) worst = d;
+        }
+    }
+    return worst;
+}
+
+// ---------------------------------------------------------------------------
+// Benchmark
+// ---------------------------------------------------------------------------
+
+static int parse_kernels(const char *list, int *sizes) {
+    int count = 0;
+    const char *p = list;
+    while (*p && count < MAX_KERNEL_SIZES) {
+        char *end;
+        long v = strtol(p, &end, 10);
+        if (end == p || v < 3 || v > MAX_KERNEL || v % 2 == 0) return -1;
+        sizes[count++] = (int)v;
+        if (*end && *end != ',') return -1;
+        p = *end == ',' ? end + 1 : end;
+    }
+    return count;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-s WIDTHxHEIGHT] [-k size[,size...]] [-i iterations] [-f image.pgm]\n", prog);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    unsigned width = DEFAULT_WIDTH, height = DEFAULT_HEIGHT;
+    const char *kernel_list = DEFAULT_KERNELS;
+    int iterations = DEFAULT_ITERATIONS;
+    const char *path = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:k:i:f:h")) != -1) {
+        switch (opt) {
+        case 's':
+            if (sscanf(optarg, "%ux%u", &width, &height) != 2) usage(argv[0]);
+            break;
+        case 'k': kernel_list = optarg; break;
+        case 'i': iterations = atoi(optarg); break;
+        case 'f': path = optarg; break;
+        default: usage(argv[0]);
+        }
+    }
+    int kernel_sizes[MAX_KERNEL_SIZES];
+    int kernel_count = parse_kernels(kernel_list, kernel_sizes);
+    if (kernel_count <= 0 || width == 0 || height == 0 || width > 65536 || height > 65536 || iterations <= 0) {
+        usage(argv[0]);
+    }
+
+    bench_print_header("convolve", "2D IMAGE CONVOLUTION WORKLOAD");
+
+    image_t source;
+    memset(&source, 0, sizeof(source));
+    if (path) {
+        if (load_pgm(path, &source) != 0) return 1;
+    } else {
+        if (image_alloc(&source, LAYOUT_FLAT, width, height) != 0) {
+            fprintf(stderr, "Out of memory\n");
+            return 1;
+        }
+        generate_image(&source);
+    }
+    uint32_t w = source.width, h = source.height;
+    double mpix = (double)w * h / 1e6;
+
+    image_t in[LAYOUT_COUNT], out[LAYOUT_COUNT], ref;
+    scratch_t scratch;
+    scratch.ring.pitch = (size_t)w + MAX_KERNEL;
+    scratch.ring.buf = malloc(MAX_KERNEL * scratch.ring.pitch * sizeof(float));
+    scratch.line = malloc(scratch.ring.pitch * sizeof(float));
+    scratch.tmp = malloc((size_t)w * h * sizeof(float));
+    int alloc_failed = !scratch.ring.buf || !scratch.line || !scratch.tmp ||
+                       image_alloc(&ref, LAYOUT_FLAT, w, h) != 0;
+    for (int l = 0; l < LAYOUT_COUNT; l++) {
+        alloc_failed |= image_alloc(&in[l], (layout_t)l, w, h) != 0 || image_alloc(&out[l], (layout_t)l, w, h) != 0;
+        if (!alloc_failed) image_copy(&in[l], &source);
+    }
+    if (alloc_failed) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    printf("Image: %ux%u (%.2f MP) %s, %d iterations, row pointer array %zu bytes\n\n", w, h, mpix,
+           path ? path : "synthetic", iterations, (size_t)h * sizeof(cap_ptr_t));
+
+    printf("CONVOLUTION RESULTS\n");
+    printf("-------------------------------------------\n");
+    int failed = 0;
+    char metric[48];
+    for (int ks = 0; ks < kernel_count; ks++) {
+        kernel_t k;
+        make_gaussian(&k, kernel_sizes[ks]);
+        // Flat general scalar is the reference for every other combination
+        convolve(&in[LAYOUT_FLAT], &ref, &k, KIND_GENERAL, STYLE_SCALAR, &scratch);
+
+        for (int l = 0; l < LAYOUT_COUNT; l++) {
+            for (int kind = 0; kind < KIND_COUNT; kind++) {
+                for (int style = 0; style < STYLE_COUNT; style++) {
+                    uint64_t start = bench_now_ns();
+                    for (int it = 0; it < iterations; it++) {
+                        convolve(&in[l], &out[l], &k, (kind_t)kind, (style_t)style, &scratch);
+                    }
+                    double seconds = bench_seconds(start, bench_now_ns());
+                    if (max_difference(&out[l], &ref) > 1) {
+                        fprintf(stderr, "%s %s %dx%d %s output differs from reference\n", layout_names[l],
+                                kind_names[kind], k.size, k.size, style_names[style]);
+                        failed = 1;
+                    }
+                    snprintf(metric, sizeof(metric), "%s_%s_%dx%d_%s_mpix_per_sec", layout_names[l],
+                             kind_names[kind], k.size, k.size, style_names[style]);
+                    bench_report(metric, mpix * iterations / seconds, "MP/s");
+                }
+            }
+        }
+    }
+    bench_report("row_pointer_bytes", (double)h * sizeof(cap_ptr_t), "bytes");
+
+    for (int l = 0; l < LAYOUT_COUNT; l++) {
+        image_free(&in[l]);
+        image_free(&out[l]);
+    }
+    image_free(&ref);
+    image_free(&source);
+    free(scratch.ring.buf);
+    free(scratch.line);
+    free(scratch.tmp);
+    bench_finish();
+    return failed;
+}
@@ -0,0 +1,77 @@
+#!/bin/bash
+
+# Bounds Instruction Counter
+# Counts the bounds-setting instructions (CSetBounds, CSetBoundsExact,
+# CSetBoundsImm, CRRL, CRAM) in each frame_* function of a workload's
+# generated assembly, one RESULT line per function:
+#   RESULT,<workload>,<model>,<frame>_bounds_insns,<count>,insns
+# where <frame> is the function name without "frame_", matching the
+# workload's own <frame>_cycles_per_call metrics.
+#
+# Usage: count_bounds_insns.sh <workload>_<variant>.s...
+#   variants: riscv softcap cheri host host_softcap, as in run_workloads.sh
+
+set -e
+
+# Colors for output
+RED='\033[0;31m'
+BLUE='\033[0;34m'
+NC='\033[0m' # No Color
+
+log_info() {
+    echo -e "${BLUE}[INFO]${NC} $1" >&2
+}
+
+log_error() {
+    echo -e "${RED}[ERROR]${NC} $1" >&2
+}
+
+# Pointer model of a variant, as reported by the workloads themselves
+model_for() {
+    case "$1" in
+        riscv|host) echo "pointer" ;;
+        softcap|host_softcap) echo "softcap" ;;
+        cheri) echo "cheri" ;;
+        *) return 1 ;;
+    esac
+}
+
+if [ $# -eq 0 ]; then
+    log_error "Usage: $0 <workload>_<variant>.s..."
+    exit 2
+fi
+
+for asm in "$@"; do
+    if [ ! -f "$asm" ]; then
+        log_error "$asm: not found"
+        exit 1
+    fi
+    name=$(basename "$asm" .s)
+    variant=${name#*_}
+    workload=${name%%_*}
+    workload=${workload%-bench}
+    if ! model=$(model_for "$variant"); then
+        log_error "$asm: unknown variant '$variant'"
+        exit 1
+    fi
+    log_info "Counting bounds instructions in $asm ($model)"
+
+    # A function runs from its label to its .size directive (GCC) or
+    # .Lfunc_end label (LLVM)
+    awk -v workload="$workload" -v model="$model" '
+        /^[A-Za-z_][A-Za-z0-9_.]*:/ {
+            label = substr($1, 1, length($1) - 1)
+            if (label ~ /^frame_/) {
+                current = label
+                if (!(label in counts)) { counts[label] = 0; order[n++] = label }
+            }
+            next
+        }
+        /^\.Lfunc_end/ || /^[ \t]*\.size[ \t]/ { current = ""; next }
+        current != "" && $1 ~ /^(csetbounds|csetboundsexact|csetboundsimm|crrl|cram)$/ { counts[current]++ }
+        END {
+            for (i = 0; i < n; i++)
+                printf "RESULT,%s,%s,%s_bounds_insns,%d,insns\n", workload, model, substr(order[i], 7), counts[order[i]]
+        }
+    ' "$asm"
+done
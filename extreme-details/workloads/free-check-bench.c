@@ -0,0 +1,265 @@
+/*
+ * Real-World Application Stress Test - Validated free() at Scale
+ *
+ * cheri_double_free_test() and protected_double_free() in implementations/
+ * spot a double free by scanning a 32-entry array of live pointers, which
+ * stops being an option long before a production heap's size. This
+ * workload keeps -n objects (1-64 bytes) live in the slab allocator of
+ * common/slab_bitmap.h, whose out-of-line allocation-state bitmap checks
+ * every free() in constant time, and replaces random objects -o times per
+ * pass, timing each free three ways:
+ *   unchecked  - slab_free_unchecked(): the bitmap bookkeeping alone
+ *   validated  - slab_free(): range, slot alignment, exact bounds
+ *                (capability builds) and allocation-state checks
+ *   libc       - free() on a malloc heap with the same live objects
+ * Unchecked and validated frees are interleaved batch by batch, and each
+ * mode reports its best of -i passes, so the validation overhead is the
+ * difference of two measurements taken under the same conditions. It then
+ * frees live objects twice, through interior pointers, through narrowed
+ * views (capability builds) and from outside the slab, and every one of
+ * those must be rejected.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "capmodel.h"
+#include "bench.h"
+#include "slab_bitmap.h"
+
+// Benchmark configuration
+#define DEFAULT_LIVE        10000000
+#define DEFAULT_FREES       2000000
+#define DEFAULT_ITERATIONS  5
+#define MIN_OBJECT          1
+#define MAX_OBJECT          64
+#define FREE_BATCH          256         // Frees per timed batch
+#define BAD_FREES           100000      // Attempts per kind of bad free
+
+typedef enum {
+    FREE_UNCHECKED = 0, FREE_VALIDATED, FREE_LIBC, FREE_COUNT
+} free_mode_t;
+
+static const char *const free_names[FREE_COUNT] = { "unchecked", "validated", "libc" };
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ull;
+
+static inline size_t random_size(void) {
+    return MIN_OBJECT + (size_t)(bench_rng_next(&rng_state) % (MAX_OBJECT - MIN_OBJECT + 1));
+}
+
+static inline cap_ptr_t new_object(slab_t *slab, size_t size) {
+    cap_ptr_t obj = slab ? slab_alloc(slab, size) : cap_malloc(size);
+    if (!cap_is_null(obj)) *(unsigned char *)cap_check(obj, 0, 1) = (unsigned char)size;
+    return obj;
+}
+
+// Fill objs with live objects of random sizes
+static int populate(slab_t *slab, cap_ptr_t *objs, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        objs[i] = new_object(slab, random_size());
+        if (cap_is_null(objs[i])) return -1;
+    }
+    return 0;
+}
+
+/*
+ * Replace frees random objects per mode with new ones of the same size, so
+ * the live set stays at count. Frees are timed FREE_BATCH at a time, with
+ * the victims picked beforehand, so the timer brackets nothing but the free
+ * calls, and the modes take turns batch by batch (alternating which goes
+ * first), so each sees the same heap and cache state. Adds the cycles and
+ * nanoseconds each mode spent freeing to cycles[mode] and ns[mode] and
+ * returns the number of frees that were rejected (0 for a correct run).
+ */
+static size_t replace_objects(const free_mode_t *modes, int mode_count, slab_t *slab, cap_ptr_t *objs,
+                              size_t count, size_t frees, uint64_t *cycles, uint64_t *ns) {
+    cap_ptr_t victims[FREE_BATCH];
+    size_t slots[FREE_BATCH], sizes[FREE_BATCH];
+    size_t rejected = 0;
+
+    for (size_t done = 0; done < frees; done += FREE_BATCH) {
+        size_t batch = frees - done < FREE_BATCH ? frees - done : FREE_BATCH;
+        for (int turn = 0; turn < mode_count; turn++) {
+            free_mode_t mode = modes[(done / FREE_BATCH + (size_t)turn) % (size_t)mode_count];
+            for (size_t k = 0; k < batch; k++) {
+                size_t j;
+                do {
+                    j = (size_t)(bench_rng_next(&rng_state) % count);
+                } while (cap_is_null(objs[j]));     // Each object at most once per batch
+                victims[k] = objs[j];
+                slots[k] = j;
+                sizes[k] = *(unsigned char *)cap_check(objs[j], 0, 1);
+                objs[j] = CAP_NULL;
+            }
+
+            uint64_t start_ns = bench_now_ns();
+            uint64_t start = bench_cycles();
+            switch (mode) {
+            case FREE_UNCHECKED:
+                for (size_t k = 0; k < batch; k++) slab_free_unchecked(slab, victims[k]);
+                break;
+            case FREE_VALIDATED:
+                for (size_t k = 0; k < batch; k++) rejected += slab_free(slab, victims[k]) != SLAB_OK;
+                break;
+            default:
+                for (size_t k = 0; k < batch; k++) cap_free(victims[k]);
+                break;
+            }
+            cycles[mode] += bench_cycles() - start;
+            ns[mode] += bench_now_ns() - start_ns;
+
+            for (size_t k = 0; k < batch; k++) {
+                objs[slots[k]] = new_object(mode == FREE_LIBC ? NULL : slab, sizes[k]);
+                if (cap_is_null(objs[slots[k]])) return frees;
+            }
+        }
+    }
+    return rejected;
+}
+
+// Best pass of each mode over the iterations, into best_cycles and best_ns
+static size_t timed_passes(const free_mode_t *modes, int mode_count, slab_t *slab, cap_ptr_t *objs, size_t count,
+                           size_t frees, int iterations, uint64_t *best_cycles, uint64_t *best_ns) {
+    size_t rejected = 0;
+    for (int it = 0; it < iterations; it++) {
+        uint64_t cycles[FREE_COUNT] = { 0 }, ns[FREE_COUNT] = { 0 };
+        rejected += replace_objects(modes, mode_count, slab, objs, count, frees, cycles, ns);
+        for (int i = 0; i < mode_count; i++) {
+            free_mode_t m = modes[i];
+            if (it == 0 || cycles[m] < best_cycles[m]) {
+                best_cycles[m] = cycles[m];
+                best_ns[m] = ns[m];
+            }
+        }
+    }
+    return rejected;
+}
+
+// Cycles per free and frees per second; returns the cycles
+static double report_latency(free_mode_t mode, size_t frees, uint64_t cycles, uint64_t ns) {
+    char metric[48];
+    snprintf(metric, sizeof(metric), "%s_free_cycles", free_names[mode]);
+    bench_report(metric, (double)cycles / (double)frees, "cycles");
+    snprintf(metric, sizeof(metric), "%s_frees_per_sec", free_names[mode]);
+    bench_report(metric, (double)frees / ((double)ns / 1e9), "frees/s");
+    return (double)cycles / (double)frees;
+}
+
+/*
+ * Bad frees of random live objects; each kind must be rejected every time
+ * and must leave the object allocated. Returns the number that got through.
+ */
+static size_t check_bad_frees(slab_t *slab, cap_ptr_t *objs, size_t count) {
+    size_t missed = 0;
+    uint64_t doubles = slab->double_frees, invalids = slab->invalid_frees;
+    cap_ptr_t outside = cap_malloc(MAX_OBJECT);
+
+    for (size_t i = 0; i < BAD_FREES; i++) {
+        size_t j = (size_t)(bench_rng_next(&rng_state) % count);
+        cap_ptr_t obj = objs[j];
+        size_t size = *(unsigned char *)cap_check(obj, 0, 1);
+
+        // Interior pointer: slots are at least 16 bytes, so +8 is never a slot start
+        missed += slab_free(slab, cap_sub(obj, 8, 8)) == SLAB_OK;
+#if defined(__CHERI__) || defined(CAP_MODEL_SOFTCAP)
+        // Same address, narrowed bounds: only the capability can tell
+        missed += slab_free(slab, cap_sub(obj, 0, 8)) == SLAB_OK;
+#endif
+        missed += slab_free(slab, outside) == SLAB_OK;
+
+        // Double free of a freshly freed object, then put it back
+        if (slab_free(slab, obj) != SLAB_OK) missed++;
+        missed += slab_free(slab, obj) == SLAB_OK;
+        objs[j] = new_object(slab, size);
+    }
+    cap_free(outside);
+
+    bench_report("double_frees_rejected", (double)(slab->double_frees - doubles), "frees");
+    bench_report("invalid_frees_rejected", (double)(slab->invalid_frees - invalids), "frees");
+    return missed;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-n live_objects] [-o frees] [-i iterations]\n", prog);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    size_t live = DEFAULT_LIVE;
+    size_t frees = DEFAULT_FREES;
+    int iterations = DEFAULT_ITERATIONS;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:o:i:h")) != -1) {
+        switch (opt) {
+        case 'n': live = (size_t)strtoull(optarg, NULL, 0); break;
+        case 'o': frees = (size_t)strtoull(optarg, NULL, 0); break;
+        case 'i': iterations = atoi(optarg); break;
+        default: usage(argv[0]);
+        }
+    }
+    if (live < FREE_BATCH || frees == 0 || iterations <= 0) usage(argv[0]);
+
+    cap_ptr_t *objs = malloc(live * sizeof(cap_ptr_t));
+    if (!objs) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    bench_print_header("free-check", "VALIDATED FREE WORKLOAD");
+    printf("Live objects: %zu (%d-%d bytes), %zu frees per mode and pass, best of %d\n\n", live, MIN_OBJECT, MAX_OBJECT,
+           frees, iterations);
+
+    printf("FREE LATENCY RESULTS\n");
+    printf("-------------------------------------------\n");
+    int failed = 0;
+    uint64_t best_cycles[FREE_COUNT], best_ns[FREE_COUNT];
+    double per_free[FREE_COUNT];
+
+    // Largest slot is 64 bytes; one spare chunk per size class
+    slab_t slab;
+    if (slab_init(&slab, live * MAX_OBJECT + SLAB_CLASS_COUNT * SLAB_CHUNK_BYTES) != 0 ||
+        populate(&slab, objs, live) != 0) {
+        fprintf(stderr, "Out of memory for %zu slab objects\n", live);
+        return 1;
+    }
+    static const free_mode_t slab_modes[] = { FREE_UNCHECKED, FREE_VALIDATED };
+    if (timed_passes(slab_modes, 2, &slab, objs, live, frees, iterations, best_cycles, best_ns) != 0) {
+        fprintf(stderr, "validated: a free of a live object was rejected\n");
+        failed = 1;
+    }
+    for (int m = FREE_UNCHECKED; m <= FREE_VALIDATED; m++) {
+        per_free[m] = report_latency((free_mode_t)m, frees, best_cycles[m], best_ns[m]);
+    }
+    bench_report("validation_overhead_cycles", per_free[FREE_VALIDATED] - per_free[FREE_UNCHECKED], "cycles");
+    bench_report("slab_bitmap_mb", (double)(slab.chunks_used * SLAB_CHUNK_WORDS * sizeof(uint64_t)) / (1 << 20),
+                 "MB");
+    if (check_bad_frees(&slab, objs, live) != 0) {
+        fprintf(stderr, "A bad free was accepted\n");
+        failed = 1;
+    }
+    if (slab.live != live) {
+        fprintf(stderr, "Live count drifted: %zu, expected %zu\n", slab.live, live);
+        failed = 1;
+    }
+    slab_destroy(&slab);
+
+    if (populate(NULL, objs, live) != 0) {
+        fprintf(stderr, "Out of memory for %zu malloc objects\n", live);
+        return 1;
+    }
+    static const free_mode_t libc_mode[] = { FREE_LIBC };
+    timed_passes(libc_mode, 1, NULL, objs, live, frees, iterations, best_cycles, best_ns);
+    report_latency(FREE_LIBC, frees, best_cycles[FREE_LIBC], best_ns[FREE_LIBC]);
+    for (size_t i = 0; i < live; i++) cap_free(objs[i]);
+
+    bench_report("max_rss_mb", (double)bench_max_rss_bytes() / (1 << 20), "MB");
+    bench_finish();
+
+    free(objs);
+    return failed;
+}
@@ -0,0 +1,745 @@
+/*
+ * Real-World Application Stress Test - Graph Analytics
+ *
+ * BFS, PageRank and connected components over two representations of the
+ * same R-MAT graph:
+ *   list - every vertex is its own allocation holding a bounded array of
+ *          capabilities to its neighbor vertices; traversal chases those
+ *          capabilities and keeps per-vertex state inside the node
+ *   csr  - compressed sparse row: 64-bit row offsets and 32-bit neighbor
+ *          ids, per-vertex state in flat arrays
+ *
+ * A parallel direction-optimizing BFS (top-down queue steps, bottom-up
+ * bitmap steps, switched with the Beamer alpha/beta heuristics) runs over
+ * both representations. Traversal rates are reported as undirected input
+ * edges per second (Graph500 TEPS); PageRank and components report arcs
+ * scanned per second.
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "capmodel.h"
+#include "bench.h"
+
+// Benchmark configuration
+#define DEFAULT_SCALE       18
+#define DEFAULT_EDGE_FACTOR 16
+#define DEFAULT_ROOTS       8
+#define DEFAULT_PR_ITERS    10
+#define PAGERANK_DAMPING    0.85
+#define DOBFS_ALPHA         15      // Switch to bottom-up when frontier edges > unexplored / alpha
+#define DOBFS_BETA          18      // Switch back when frontier vertices < n / beta
+#define CHUNK_VERTICES      256     // Work unit for parallel steps (multiple of 64)
+#define LOCAL_QUEUE         256
+
+// Pointer-linked vertex; neighbors is an array of cap_ptr_t to vertex_t
+typedef struct {
+    cap_ptr_t neighbors;
+    uint32_t id;
+    uint32_t degree;
+    int32_t level;
+    uint32_t label;
+    double rank;
+    double contrib;
+} vertex_t;
+
+typedef struct {
+    uint32_t vertices;
+    size_t arcs;                // Directed arcs (each undirected edge twice)
+    size_t edges;               // Undirected input edges
+
+    // list representation
+    cap_ptr_t vertex_table;     // cap_ptr_t[vertices]
+    size_t list_bytes;
+
+    // csr representation
+    cap_ptr_t offsets;          // uint64_t[vertices + 1]
+    cap_ptr_t targets;          // uint32_t[arcs]
+    size_t csr_bytes;
+} graph_t;
+
+typedef enum { REP_LIST = 0, REP_CSR, REP_COUNT } rep_t;
+
+static const char *rep_name(rep_t rep) {
+    return rep == REP_LIST ? "list" : "csr";
+}
+
+static uint64_t rng_state = 0x853C49E6748FEA9Bull;
+
+static inline vertex_t *list_vertex(const graph_t *g, uint32_t v) {
+    return CAP_OBJ(CAP_AT(g->vertex_table, cap_ptr_t, v), vertex_t);
+}
+
+// ---------------------------------------------------------------------------
+// Graph generation and construction
+// ---------------------------------------------------------------------------
+
+// R-MAT edge list (a=0.57, b=0.19, c=0.19) with vertex ids permuted
+static uint32_t *generate_rmat(int scale, size_t edges, size_t *kept) {
+    uint32_t n = 1u << scale;
+    uint32_t *perm = malloc((size_t)n * sizeof(uint32_t));
+    uint32_t *list = malloc(edges * 2 * sizeof(uint32_t));
+    if (!perm || !list) {
+        free(perm);
+        free(list);
+        return NULL;
+    }
+    for (uint32_t i = 0; i < n; i++) perm[i] = i;
+    for (uint32_t i = n - 1; i > 0; i--) {
+        uint32_t j = (uint32_t)(bench_rng_next(&rng_state) % (i + 1));
+        uint32_t t = perm[i];
+        perm[i] = perm[j];
+        perm[j] = t;
+    }
+
+    const uint32_t a = (uint32_t)(0.57 * 4294967296.0);
+    const uint32_t ab = (uint32_t)(0.76 * 4294967296.0);
+    const uint32_t abc = (uint32_t)(0.95 * 4294967296.0);
+    size_t count = 0;
+    for (size_t e = 0; e < edges; e++) {
+        uint32_t u = 0, v = 0;
+        for (int bit = 0; bit < scale; bit++) {
+            uint32_t r = (uint32_t)(bench_rng_next(&rng_state) >> 32);
+            u <<= 1;
+            v <<= 1;
+            if (r >= abc) { u |= 1; v |= 1; }
+            else if (r >= ab) u |= 1;
+            else if (r >= a) v |= 1;
+        }
+        if (u == v) continue;   // Drop self loops
+        list[2 * count] = perm[u];
+        list[2 * count + 1] = perm[v];
+        count++;
+    }
+    free(perm);
+    *kept = count;
+    return list;
+}
+
+static int build_graph(graph_t *g, int scale, const uint32_t *edge_list, size_t edges) {
+    uint32_t n = 1u << scale;
+    g->vertices = n;
+    g->edges = edges;
+    g->arcs = edges * 2;
+
+    uint32_t *degree = calloc(n, sizeof(uint32_t));
+    if (!degree) return -1;
+    for (size_t e = 0; e < 2 * edges; e++) degree[edge_list[e]]++;
+
+    // CSR: prefix-sum offsets, then scatter both directions of every edge
+    g->offsets = cap_malloc(((size_t)n + 1) * sizeof(uint64_t));
+    g->targets = cap_malloc(g->arcs * sizeof(uint32_t) + 1);
+    uint64_t *cursor = malloc(((size_t)n + 1) * sizeof(uint64_t));
+    if (cap_is_null(g->offsets) || cap_is_null(g->targets) || !cursor) return -1;
+    uint64_t *offsets = (uint64_t *)cap_check(g->offsets, 0, ((size_t)n + 1) * sizeof(uint64_t));
+    uint32_t *targets = (uint32_t *)cap_check(g->targets, 0, g->arcs * sizeof(uint32_t));
+    offsets[0] = 0;
+    for (uint32_t v = 0; v < n; v++) offsets[v + 1] = offsets[v] + degree[v];
+    memcpy(cursor, offsets, ((size_t)n + 1) * sizeof(uint64_t));
+    for (size_t e = 0; e < edges; e++) {
+        uint32_t u = edge_list[2 * e], v = edge_list[2 * e + 1];
+        targets[cursor[u]++] = v;
+        targets[cursor[v]++] = u;
+    }
+    free(cursor);
+    g->csr_bytes = ((size_t)n + 1) * sizeof(uint64_t) + g->arcs * sizeof(uint32_t);
+
+    // List: one allocation per vertex, one bounded neighbor array per vertex
+    g->vertex_table = cap_malloc((size_t)n * sizeof(cap_ptr_t));
+    if (cap_is_null(g->vertex_table)) return -1;
+    g->list_bytes = (size_t)n * sizeof(cap_ptr_t);
+    for (uint32_t v = 0; v < n; v++) {
+        cap_ptr_t node = cap_malloc(sizeof(vertex_t));
+        if (cap_is_null(node)) return -1;
+        vertex_t *vx = CAP_OBJ(node, vertex_t);
+        vx->id = v;
+        vx->degree = degree[v];
+        vx->neighbors = degree[v] ? cap_malloc(degree[v] * sizeof(cap_ptr_t)) : CAP_NULL;
+        if (degree[v] && cap_is_null(vx->neighbors)) return -1;
+        CAP_AT(g->vertex_table, cap_ptr_t, v) = node;
+        g->list_bytes += sizeof(vertex_t) + degree[v] * sizeof(cap_ptr_t);
+    }
+    for (uint32_t v = 0; v < n; v++) {
+        vertex_t *vx = list_vertex(g, v);
+        for (uint32_t i = 0; i < vx->degree; i++) {
+            CAP_AT(vx->neighbors, cap_ptr_t, i) = CAP_AT(g->vertex_table, cap_ptr_t, targets[offsets[v] + i]);
+        }
+    }
+    free(degree);
+    return 0;
+}
+
+static void free_graph(graph_t *g) {
+    for (uint32_t v = 0; v < g->vertices; v++) {
+        cap_ptr_t node = CAP_AT(g->vertex_table, cap_ptr_t, v);
+        cap_free(CAP_OBJ(node, vertex_t)->neighbors);
+        cap_free(node);
+    }
+    cap_free(g->vertex_table);
+    cap_free(g->offsets);
+    cap_free(g->targets);
+}
+
+// ---------------------------------------------------------------------------
+// Serial top-down BFS
+// ---------------------------------------------------------------------------
+
+// Returns the sum of degrees of reached vertices; levels written to out_level
+static size_t bfs_list(const graph_t *g, uint32_t root, cap_ptr_t *queue, int32_t *out_level) {
+    for (uint32_t v = 0; v < g->vertices; v++) list_vertex(g, v)->level = -1;
+
+    // The queue holds vertex capabilities, not ids
+    size_t head = 0, tail = 0, reached_degree = 0;
+    cap_ptr_t start = CAP_AT(g->vertex_table, cap_ptr_t, root);
+    CAP_OBJ(start, vertex_t)->level = 0;
+    queue[tail++] = start;
+    while (head < tail) {
+        vertex_t *u = CAP_OBJ(queue[head++], vertex_t);
+        reached_degree += u->degree;
+        for (uint32_t i = 0; i < u->degree; i++) {
+            cap_ptr_t nbr = CAP_AT(u->neighbors, cap_ptr_t, i);
+            vertex_t *v = CAP_OBJ(nbr, vertex_t);
+            if (v->level < 0) {
+                v->level = u->level + 1;
+                queue[tail++] = nbr;
+            }
+        }
+    }
+    for (uint32_t v = 0; v < g->vertices; v++) out_level[v] = list_vertex(g, v)->level;
+    return reached_degree;
+}
+
+static size_t bfs_csr(const graph_t *g, uint32_t root, uint32_t *queue, int32_t *level) {
+    const uint64_t *offsets = (const uint64_t *)cap_check(g->offsets, 0, ((size_t)g->vertices + 1) * sizeof(uint64_t));
+    const uint32_t *targets = (const uint32_t *)cap_check(g->targets, 0, g->arcs * sizeof(uint32_t));
+    for (uint32_t v = 0; v < g->vertices; v++) level[v] = -1;
+
+    size_t head = 0, tail = 0, reached_degree = 0;
+    level[root] = 0;
+    queue[tail++] = root;
+    while (head < tail) {
+        uint32_t u = queue[head++];
+        reached_degree += offsets[u + 1] - offsets[u];
+        for (uint64_t i = offsets[u]; i < offsets[u + 1]; i++) {
+            uint32_t v = targets[i];
+            if (level[v] < 0) {
+                level[v] = level[u] + 1;
+                queue[tail++] = v;
+            }
+        }
+    }
+    return reached_degree;
+}
+
+// ---------------------------------------------------------------------------
+// Parallel direction-optimizing BFS
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    const graph_t *g;
+    rep_t rep;
+    int threads;
+    pthread_barrier_t barrier;
+
+    int32_t *level;
+    uint32_t *queue;            // Top-down frontier
+    uint32_t *next_queue;
+    size_t queue_len;
+    size_t next_len;            // Appended atomically
+    uint64_t *frontier;         // Bottom-up frontier bitmap
+    uint64_t *next_frontier;
+    size_t words;
+
+    int32_t depth;
+    int bottom_up;
+    int done;
+    size_t next_chunk;          // Work distribution counter
+    size_t next_count;          // Vertices discovered this step
+    size_t next_degree;         // Their summed degree
+    size_t unexplored_degree;
+    size_t reached_degree;
+} dobfs_t;
+
+typedef struct {
+    dobfs_t *b;
+    int id;
+    uint64_t elapsed_ns;
+} dobfs_worker_t;
+
+static inline uint32_t rep_degree(const dobfs_t *b, uint32_t v, const uint64_t *offsets) {
+    if (b->rep == REP_CSR) return (uint32_t)(offsets[v + 1] - offsets[v]);
+    return list_vertex(b->g, v)->degree;
+}
+
+static void dobfs_flush(dobfs_t *b, const uint32_t *local, size_t n) {
+    size_t at = __atomic_fetch_add(&b->next_len, n, __ATOMIC_RELAXED);
+    memcpy(b->next_queue + at, local, n * sizeof(uint32_t));
+}
+
+static inline int dobfs_claim(dobfs_t *b, uint32_t v) {
+    int32_t expected = -1;
+    return __atomic_load_n(&b->level[v], __ATOMIC_RELAXED) < 0 &&
+           __atomic_compare_exchange_n(&b->level[v], &expected, b->depth + 1, 0,
+                                       __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+}
+
+static void dobfs_top_down(dobfs_t *b, const uint64_t *offsets, const uint32_t *targets) {
+    uint32_t local[LOCAL_QUEUE];
+    size_t n = 0, count = 0, degree = 0;
+
+    for (;;) {
+        size_t start = __atomic_fetch_add(&b->next_chunk, CHUNK_VERTICES, __ATOMIC_RELAXED);
+        if (start >= b->queue_len) break;
+        size_t end = start + CHUNK_VERTICES < b->queue_len ? start + CHUNK_VERTICES : b->queue_len;
+        for (size_t q = start; q < end; q++) {
+            uint32_t u = b->queue[q];
+            if (b->rep == REP_CSR) {
+                for (uint64_t i = offsets[u]; i < offsets[u + 1]; i++) {
+                    uint32_t v = targets[i];
+                    if (!dobfs_claim(b, v)) continue;
+                    degree += offsets[v + 1] - offsets[v];
+                    local[n++] = v;
+                    if (n == LOCAL_QUEUE) { dobfs_flush(b, local, n); count += n; n = 0; }
+                }
+            } else {
+                const vertex_t *ux = list_vertex(b->g, u);
+                for (uint32_t i = 0; i < ux->degree; i++) {
+                    const vertex_t *vx = CAP_OBJ(CAP_AT(ux->neighbors, cap_ptr_t, i), vertex_t);
+                    if (!dobfs_claim(b, vx->id)) continue;
+                    degree += vx->degree;
+                    local[n++] = vx->id;
+                    if (n == LOCAL_QUEUE) { dobfs_flush(b, local, n); count += n; n = 0; }
+                }
+            }
+        }
+    }
+    if (n) dobfs_flush(b, local, n);
+    __atomic_fetch_add(&b->next_count, count + n, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&b->next_degree, degree, __ATOMIC_RELAXED);
+}
+
+// Each chunk owns whole bitmap words, so next-frontier words need no atomics
+static void dobfs_bottom_up(dobfs_t *b, const uint64_t *offsets, const uint32_t *targets) {
+    size_t count = 0, degree = 0;
+    uint32_t n = b->g->vertices;
+
+    for (;;) {
+        size_t start = __atomic_fetch_add(&b->next_chunk, CHUNK_VERTICES, __ATOMIC_RELAXED);
+        if (start >= n) break;
+        size_t end = start + CHUNK_VERTICES < n ? start + CHUNK_VERTICES : n;
+        for (size_t w = start / 64; w < (end + 63) / 64; w++) {
+            uint64_t word = 0;
+            for (uint32_t v = (uint32_t)(w * 64); v < end && v < (w + 1) * 64; v++) {
+                if (b->level[v] >= 0) continue;
+                int found = 0;
+                if (b->rep == REP_CSR) {
+                    for (uint64_t i = offsets[v]; i < offsets[v + 1]; i++) {
+                        uint32_t u = targets[i];
+                        if (b->frontier[u / 64] & (1ull << (u % 64))) { found = 1; break; }
+                    }
+                } else {
+                    const vertex_t *vx = list_vertex(b->g, v);
+                    for (uint32_t i = 0; i < vx->degree; i++) {
+                        uint32_t u = CAP_OBJ(CAP_AT(vx->neighbors, cap_ptr_t, i), vertex_t)->id;
+                        if (b->frontier[u / 64] & (1ull << (u % 64))) { found = 1; break; }
+                    }
+                }
+                if (found) {
+                    b->level[v] = b->depth + 1;
+                    word |= 1ull << (v % 64);
+                    count++;
+                    degree += rep_degree(b, v, offsets);
+                }
+            }
+            b->next_frontier[w] = word;
+        }
+    }
+    __atomic_fetch_add(&b->next_count, count, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&b->next_degree, degree, __ATOMIC_RELAXED);
+}
+
+// Between levels (worker 0 only): pick the direction and convert the frontier
+static void dobfs_advance(dobfs_t *b) {
+    size_t n_f = b->next_count;
+    size_t m_f = b->next_degree;
+    b->reached_degree += m_f;
+    b->unexplored_degree -= m_f;
+    b->depth++;
+    b->next_chunk = 0;
+    b->next_count = 0;
+    b->next_degree = 0;
+    if (n_f == 0) {
+        b->done = 1;
+        return;
+    }
+
+    if (!b->bottom_up) {
+        uint32_t *t = b->queue;
+        b->queue = b->next_queue;
+        b->next_queue = t;
+        b->queue_len = b->next_len;
+        b->next_len = 0;
+        if (m_f > b->unexplored_degree / DOBFS_ALPHA) {
+            memset(b->frontier, 0, b->words * sizeof(uint64_t));
+            for (size_t q = 0; q < b->queue_len; q++) {
+                b->frontier[b->queue[q] / 64] |= 1ull << (b->queue[q] % 64);
+            }
+            b->bottom_up = 1;
+        }
+    } else {
+        uint64_t *t = b->frontier;
+        b->frontier = b->next_frontier;
+        b->next_frontier = t;
+        if (n_f < b->g->vertices / DOBFS_BETA) {
+            b->queue_len = 0;
+            for (size_t w = 0; w < b->words; w++) {
+                for (uint64_t word = b->frontier[w]; word; word &= word - 1) {
+                    b->queue[b->queue_len++] = (uint32_t)(w * 64 + (size_t)__builtin_ctzll(word));
+                }
+            }
+            b->bottom_up = 0;
+        }
+    }
+}
+
+static void *dobfs_worker(void *arg) {
+    dobfs_worker_t *w = arg;
+    dobfs_t *b = w->b;
+    const uint64_t *offsets = (const uint64_t *)cap_check(b->g->offsets, 0, ((size_t)b->g->vertices + 1) * sizeof(uint64_t));
+    const uint32_t *targets = (const uint32_t *)cap_check(b->g->targets, 0, b->g->arcs * sizeof(uint32_t));
+
+    pthread_barrier_wait(&b->barrier);   // All workers started
+    uint64_t start = bench_now_ns();
+    while (!b->done) {
+        if (b->bottom_up) dobfs_bottom_up(b, offsets, targets);
+        else dobfs_top_down(b, offsets, targets);
+        pthread_barrier_wait(&b->barrier);
+        if (w->id == 0) dobfs_advance(b);
+        pthread_barrier_wait(&b->barrier);
+    }
+    w->elapsed_ns = bench_now_ns() - start;
+    return NULL;
+}
+
+// Returns elapsed nanoseconds; levels in b->level, reached degree in b->reached_degree
+static uint64_t dobfs_run(dobfs_t *b, uint32_t root) {
+    const graph_t *g = b->g;
+    for (uint32_t v = 0; v < g->vertices; v++) b->level[v] = -1;
+    b->level[root] = 0;
+    b->queue[0] = root;
+    b->queue_len = 1;
+    b->next_len = 0;
+    b->depth = 0;
+    b->bottom_up = 0;
+    b->done = 0;
+    b->next_chunk = 0;
+    b->next_count = 0;
+    b->next_degree = 0;
+    b->reached_degree = 0;
+    b->unexplored_degree = g->arcs;
+
+    // Root's own degree counts as the first frontier's
+    const uint64_t *offsets = (const uint64_t *)cap_check(g->offsets, 0, ((size_t)g->vertices + 1) * sizeof(uint64_t));
+    size_t root_degree = rep_degree(b, root, offsets);
+    b->reached_degree = root_degree;
+    b->unexplored_degree -= root_degree;
+
+    pthread_t tids[256];
+    dobfs_worker_t workers[256];
+    pthread_barrier_init(&b->barrier, NULL, (unsigned)b->threads);
+    for (int t = 0; t < b->threads; t++) {
+        workers[t].b = b;
+        workers[t].id = t;
+        if (t > 0) pthread_create(&tids[t], NULL, dobfs_worker, &workers[t]);
+    }
+    dobfs_worker(&workers[0]);
+    for (int t = 1; t < b->threads; t++) pthread_join(tids[t], NULL);
+    pthread_barrier_destroy(&b->barrier);
+    return workers[0].elapsed_ns;
+}
+
+// ---------------------------------------------------------------------------
+// PageRank (pull) and connected components (label propagation)
+// ---------------------------------------------------------------------------
+
+static void pagerank_list(const graph_t *g, int iterations, double *out_rank) {
+    uint32_t n = g->vertices;
+    for (uint32_t v = 0; v < n; v++) list_vertex(g, v)->rank = 1.0 / n;
+    for (int it = 0; it < iterations; it++) {
+        double dangling = 0.0;
+        for (uint32_t v = 0; v < n; v++) {
+            vertex_t *vx = list_vertex(g, v);
+            if (vx->degree) vx->contrib = vx->rank / vx->degree;
+            else dangling += vx->rank;
+        }
+        double base = (1.0 - PAGERANK_DAMPING) / n + PAGERANK_DAMPING * dangling / n;
+        for (uint32_t v = 0; v < n; v++) {
+            vertex_t *vx = list_vertex(g, v);
+            double sum = 0.0;
+            for (uint32_t i = 0; i < vx->degree; i++) {
+                sum += CAP_OBJ(CAP_AT(vx->neighbors, cap_ptr_t, i), vertex_t)->contrib;
+            }
+            vx->rank = base + PAGERANK_DAMPING * sum;
+        }
+    }
+    for (uint32_t v = 0; v < n; v++) out_rank[v] = list_vertex(g, v)->rank;
+}
+
+static void pagerank_csr(const graph_t *g, int iterations, double *rank, double *contrib) {
+    const uint64_t *offsets = (const uint64_t *)cap_check(g->offsets, 0, ((size_t)g->vertices + 1) * sizeof(uint64_t));
+    const uint32_t *targets = (const uint32_t *)cap_check(g->targets, 0, g->arcs * sizeof(uint32_t));
+    uint32_t n = g->vertices;
+    for (uint32_t v = 0; v < n; v++) rank[v] = 1.0 / n;
+    for (int it = 0; it < iterations; it++) {
+        double dangling = 0.0;
+        for (uint32_t v = 0; v < n; v++) {
+            uint64_t degree = offsets[v + 1] - offsets[v];
+            if (degree) contrib[v] = rank[v] / (double)degree;
+            else dangling += rank[v];
+        }
+        double base = (1.0 - PAGERANK_DAMPING) / n + PAGERANK_DAMPING * dangling / n;
+        for (uint32_t v = 0; v < n; v++) {
+            double sum = 0.0;
+            for (uint64_t i = offsets[v]; i < offsets[v + 1]; i++) sum += contrib[targets[i]];
+            rank[v] = base + PAGERANK_DAMPING * sum;
+        }
+    }
+}
+
+// Min-label propagation until stable; returns the number of passes
+static int components_list(const graph_t *g, uint32_t *out_label) {
+    uint32_t n = g->vertices;
+    for (uint32_t v = 0; v < n; v++) list_vertex(g, v)->label = v;
+    int passes = 0, changed = 1;
+    while (changed) {
+        changed = 0;
+        passes++;
+        for (uint32_t v = 0; v < n; v++) {
+            vertex_t *vx = list_vertex(g, v);
+            uint32_t m = vx->label;
+            for (uint32_t i = 0; i < vx->degree; i++) {
+                uint32_t l = CAP_OBJ(CAP_AT(vx->neighbors, cap_ptr_t, i), vertex_t)->label;
+                if (l < m) m = l;
+            }
+            if (m < vx->label) {
+                vx->label = m;
+                changed = 1;
+            }
+        }
+    }
+    for (uint32_t v = 0; v < n; v++) out_label[v] = list_vertex(g, v)->label;
+    return passes;
+}
+
+static int components_csr(const graph_t *g, uint32_t *label) {
+    const uint64_t *offsets = (const uint64_t *)cap_check(g->offsets, 0, ((size_t)g->vertices + 1) * sizeof(uint64_t));
+    const uint32_t *targets = (const uint32_t *)cap_check(g->targets, 0, g->arcs * sizeof(uint32_t));
+    uint32_t n = g->vertices;
+    for (uint32_t v = 0; v < n; v++) label[v] = v;
+    int passes = 0, changed = 1;
+    while (changed) {
+        changed = 0;
+        passes++;
+        for (uint32_t v = 0; v < n; v++) {
+            uint32_t m = label[v];
+            for (uint64_t i = offsets[v]; i < offsets[v + 1]; i++) {
+                if (label[targets[i]] < m) m = label[targets[i]];
+            }
+            if (m < label[v]) {
+                label[v] = m;
+                changed = 1;
+            }
+        }
+    }
+    return passes;
+}
+
+// ---------------------------------------------------------------------------
+// Benchmark
+// ---------------------------------------------------------------------------
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-s scale] [-e edge_factor] [-r roots] [-p pagerank_iters] [-t threads]\n",
+            prog);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    int scale = DEFAULT_SCALE;
+    int edge_factor = DEFAULT_EDGE_FACTOR;
+    int roots = DEFAULT_ROOTS;
+    int pr_iters = DEFAULT_PR_ITERS;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = cpus > 0 ? (int)cpus : 4;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:e:r:p:t:h")) != -1) {
+        switch (opt) {
+        case 's': scale = atoi(optarg); break;
+        case 'e': edge_factor = atoi(optarg); break;
+        case 'r': roots = atoi(optarg); break;
+        case 'p': pr_iters = atoi(optarg); break;
+        case 't': threads = atoi(optarg); break;
+        default: usage(argv[0]);
+        }
+    }
+    if (scale < 4 || scale > 30 || edge_factor <= 0 || roots <= 0 || pr_iters <= 0 ||
+        threads <= 0 || threads > 256) {
+        usage(argv[0]);
+    }
+
+    bench_print_header("graph-analytics", "GRAPH ANALYTICS WORKLOAD");
+
+    size_t edges = 0;
+    uint64_t start = bench_now_ns();
+    uint32_t *edge_list = generate_rmat(scale, ((size_t)edge_factor) << scale, &edges);
+    graph_t g;
+    memset(&g, 0, sizeof(g));
+    if (!edge_list || build_graph(&g, scale, edge_list, edges) != 0) {
+        fprintf(stderr, "Failed to build graph\n");
+        return 1;
+    }
+    free(edge_list);
+    printf("R-MAT scale %d: %u vertices, %zu edges (%zu arcs), built in %.2f s\n",
+           scale, g.vertices, g.edges, g.arcs, bench_seconds(start, bench_now_ns()));
+    printf("Vertex node: %zu bytes, %d threads, %d BFS roots\n\n", sizeof(vertex_t), threads, roots);
+
+    uint32_t n = g.vertices;
+    int32_t *level_ref = malloc(n * sizeof(int32_t));
+    int32_t *level = malloc(n * sizeof(int32_t));
+    uint32_t *queue = malloc(n * sizeof(uint32_t));
+    cap_ptr_t *cap_queue = malloc(n * sizeof(cap_ptr_t));
+    double *rank_ref = malloc(n * sizeof(double));
+    double *rank = malloc(n * sizeof(double));
+    double *contrib = malloc(n * sizeof(double));
+    uint32_t *label_ref = malloc(n * sizeof(uint32_t));
+    uint32_t *label = malloc(n * sizeof(uint32_t));
+    uint32_t *root_list = malloc((size_t)roots * sizeof(uint32_t));
+    dobfs_t b;
+    memset(&b, 0, sizeof(b));
+    b.g = &g;
+    b.threads = threads;
+    b.words = (n + 63) / 64;
+    b.level = malloc(n * sizeof(int32_t));
+    b.queue = malloc(n * sizeof(uint32_t));
+    b.next_queue = malloc(n * sizeof(uint32_t));
+    b.frontier = calloc(b.words, sizeof(uint64_t));
+    b.next_frontier = calloc(b.words, sizeof(uint64_t));
+    if (!level_ref || !level || !queue || !cap_queue || !rank_ref || !rank || !contrib ||
+        !label_ref || !label || !root_list || !b.level || !b.queue || !b.next_queue ||
+        !b.frontier || !b.next_frontier) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    // Roots with at least one neighbor, as in Graph500
+    const uint64_t *offsets = (const uint64_t *)cap_check(g.offsets, 0, ((size_t)n + 1) * sizeof(uint64_t));
+    for (int r = 0; r < roots; r++) {
+        uint32_t v;
+        do v = (uint32_t)(bench_rng_next(&rng_state) % n); while (offsets[v + 1] == offsets[v]);
+        root_list[r] = v;
+    }
+
+    printf("GRAPH ANALYTICS RESULTS\n");
+    printf("-------------------------------------------\n");
+    char metric[48];
+    int failed = 0;
+
+    // BFS: serial top-down per representation, then parallel direction-optimizing
+    double traversed = 0.0;
+    double seconds[REP_COUNT] = { 0.0, 0.0 }, do_seconds[REP_COUNT] = { 0.0, 0.0 };
+    for (int r = 0; r < roots; r++) {
+        uint64_t t0 = bench_now_ns();
+        size_t reached = bfs_list(&g, root_list[r], cap_queue, level_ref);
+        seconds[REP_LIST] += bench_seconds(t0, bench_now_ns());
+        traversed += (double)reached / 2.0;
+
+        t0 = bench_now_ns();
+        bfs_csr(&g, root_list[r], queue, level);
+        seconds[REP_CSR] += bench_seconds(t0, bench_now_ns());
+        failed |= memcmp(level, level_ref, n * sizeof(int32_t)) != 0;
+
+        for (int rep = 0; rep < REP_COUNT; rep++) {
+            b.rep = (rep_t)rep;
+            do_seconds[rep] += (double)dobfs_run(&b, root_list[r]) / 1e9;
+            failed |= memcmp(b.level, level_ref, n * sizeof(int32_t)) != 0 ||
+                      b.reached_degree != reached;
+        }
+    }
+    if (failed) fprintf(stderr, "BFS levels differ between implementations\n");
+    for (int rep = 0; rep < REP_COUNT; rep++) {
+        snprintf(metric, sizeof(metric), "%s_bfs_edges_per_sec", rep_name((rep_t)rep));
+        bench_report(metric, traversed / seconds[rep], "TEPS");
+    }
+    for (int rep = 0; rep < REP_COUNT; rep++) {
+        snprintf(metric, sizeof(metric), "%s_dobfs_edges_per_sec", rep_name((rep_t)rep));
+        bench_report(metric, traversed / do_seconds[rep], "TEPS");
+    }
+
+    // PageRank
+    uint64_t t0 = bench_now_ns();
+    pagerank_list(&g, pr_iters, rank_ref);
+    double list_pr = bench_seconds(t0, bench_now_ns());
+    t0 = bench_now_ns();
+    pagerank_csr(&g, pr_iters, rank, contrib);
+    double csr_pr = bench_seconds(t0, bench_now_ns());
+    for (uint32_t v = 0; v < n; v++) {
+        double diff = rank[v] - rank_ref[v];
+        if (diff > 1e-12 || diff < -1e-12) {
+            fprintf(stderr, "PageRank differs between representations at vertex %u\n", v);
+            failed = 1;
+            break;
+        }
+    }
+    bench_report("list_pagerank_edges_per_sec", (double)g.arcs * pr_iters / list_pr, "arcs/s");
+    bench_report("csr_pagerank_edges_per_sec", (double)g.arcs * pr_iters / csr_pr, "arcs/s");
+
+    // Connected components
+    t0 = bench_now_ns();
+    int passes = components_list(&g, label_ref);
+    double list_cc = bench_seconds(t0, bench_now_ns());
+    t0 = bench_now_ns();
+    components_csr(&g, label);
+    double csr_cc = bench_seconds(t0, bench_now_ns());
+    if (memcmp(label, label_ref, n * sizeof(uint32_t)) != 0) {
+        fprintf(stderr, "Component labels differ between representations\n");
+        failed = 1;
+    }
+    size_t components = 0;
+    for (uint32_t v = 0; v < n; v++) components += label[v] == v;
+    bench_report("list_cc_edges_per_sec", (double)g.arcs * passes / list_cc, "arcs/s");
+    bench_report("csr_cc_edges_per_sec", (double)g.arcs * passes / csr_cc, "arcs/s");
+    bench_report("cc_passes", passes, "passes");
+    bench_report("components", (double)components, "components");
+
+    // Memory
+    bench_report("list_bytes", (double)g.list_bytes, "bytes");
+    bench_report("csr_bytes", (double)g.csr_bytes, "bytes");
+    bench_report("list_bytes_per_edge", (double)g.list_bytes / (double)g.edges, "bytes");
+    bench_report("csr_bytes_per_edge", (double)g.csr_bytes / (double)g.edges, "bytes");
+    bench_report("max_rss", (double)bench_max_rss_bytes(), "bytes");
+    bench_finish();
+
+    free_graph(&g);
+    free(level_ref);
+    free(level);
+    free(queue);
+    free(cap_queue);
+    free(rank_ref);
+    free(rank);
+    free(contrib);
+    free(label_ref);
+    free(label);
+    free(root_list);
+    free(b.level);
+    free(b.queue);
+    free(b.next_queue);
+    free(b.frontier);
+    free(b.next_frontier);
+    return failed;
+}
@@ -0,0 +1,326 @@
+/*
+ * Real-World Application Stress Test - JSON Parsing
+ *
+ * Two-stage structural-index parsing (common/json_parser.h): tight bitmask
+ * loops over the input in stage 1, then tape construction in stage 2 where
+ * every string becomes a bounded view. The tape node carries a cap_ptr_t,
+ * so the DOM footprint scales with the pointer representation.
+ *
+ * Corpora mimic the standard shapes: a twitter-like API response (strings,
+ * nested objects, escapes) and numeric arrays (GeoJSON-like coordinates and
+ * integer arrays). A file can be supplied instead with -f.
+ */
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "capmodel.h"
+#include "bench.h"
+#include "json_parser.h"
+
+// Benchmark configuration
+#define DEFAULT_CORPUS_KB  4096
+#define DEFAULT_ITERATIONS 20
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t capacity;
+} text_t;
+
+static uint64_t rng_state = 0x853C49E6748FEA9Bull;
+
+static void text_append(text_t *t, const char *s, size_t n) {
+    if (t->len + n + 1 > t->capacity) {
+        size_t capacity = t->capacity ? t->capacity : 65536;
+        while (capacity < t->len + n + 1) capacity *= 2;
+        char *data = realloc(t->data, capacity);
+        if (!data) {
+            fprintf(stderr, "Out of memory building corpus\n");
+            exit(1);
+        }
+        t->data = data;
+        t->capacity = capacity;
+    }
+    memcpy(t->data + t->len, s, n);
+    t->len += n;
+    t->data[t->len] = '\0';
+}
+
+static void text_puts(text_t *t, const char *s) {
+    text_append(t, s, strlen(s));
+}
+
+static void text_printf(text_t *t, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+static void text_printf(text_t *t, const char *fmt, ...) {
+    char line[256];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(line, sizeof(line), fmt, ap);
+    va_end(ap);
+    if (n > 0) text_append(t, line, (size_t)n < sizeof(line) ? (size_t)n : sizeof(line) - 1);
+}
+
+// ---------------------------------------------------------------------------
+// Corpus generators
+// ---------------------------------------------------------------------------
+
+static const char *const words[] = {
+    "the", "cheri", "capability", "bounds", "pointer", "memory", "safety", "risc-v",
+    "hardware", "compartment", "revocation", "tagged", "fast", "json", "parser", "simd",
+    "kernel", "release", "today", "benchmark", "latency", "throughput", "cache", "heap",
+};
+#define WORD_COUNT (sizeof(words) / sizeof(words[0]))
+
+// Tweet text with the escapes real API responses carry
+static void append_tweet_text(text_t *t) {
+    size_t count = 6 + bench_rng_next(&rng_state) % 20;
+    text_puts(t, "\"");
+    for (size_t w = 0; w < count; w++) {
+        if (w) text_puts(t, " ");
+        unsigned pick = (unsigned)(bench_rng_next(&rng_state) % 40);
+        if (pick == 0) text_puts(t, "\\\"quoted\\\"");
+        else if (pick == 1) text_puts(t, "line\\nbreak");
+        else if (pick == 2) text_puts(t, "caf\\u00e9");
+        else if (pick == 3) text_puts(t, "\\ud83d\\ude80");   // Surrogate pair
+        else if (pick == 4) text_puts(t, "https:\\/\\/t.co\\/x");
+        else if (pick == 5) text_printf(t, "#%s", words[bench_rng_next(&rng_state) % WORD_COUNT]);
+        else text_puts(t, words[bench_rng_next(&rng_state) % WORD_COUNT]);
+    }
+    text_puts(t, "\"");
+}
+
+static void generate_twitter(text_t *t, size_t target) {
+    uint64_t id = 505874924095815681ull;
+    text_puts(t, "{\"statuses\":[");
+    for (size_t n = 0; t->len < target; n++) {
+        if (n) text_puts(t, ",");
+        id += 1 + bench_rng_next(&rng_state) % 100000;
+        unsigned user = (unsigned)(bench_rng_next(&rng_state) % 5000000);
+        text_printf(t, "{\"metadata\":{\"result_type\":\"recent\",\"iso_language_code\":\"%s\"},",
+                    bench_rng_next(&rng_state) % 4 ? "en" : "ja");
+        text_printf(t, "\"created_at\":\"Sun Aug 31 00:%02u:%02u +0000 2014\",",
+                    (unsigned)(bench_rng_next(&rng_state) % 60), (unsigned)(bench_rng_next(&rng_state) % 60));
+        text_printf(t, "\"id\":%llu,\"id_str\":\"%llu\",\"text\":",
+                    (unsigned long long)id, (unsigned long long)id);
+        append_tweet_text(t);
+        text_puts(t, ",\"source\":\"<a href=\\\"https://mobile.twitter.com\\\" rel=\\\"nofollow\\\">Mobile Web</a>\",");
+        text_puts(t, "\"truncated\":false,\"in_reply_to_status_id\":null,");
+        text_printf(t, "\"user\":{\"id\":%u,\"id_str\":\"%u\",\"name\":\"%s %s\",\"screen_name\":\"%s_%u\",",
+                    user, user, words[bench_rng_next(&rng_state) % WORD_COUNT], words[bench_rng_next(&rng_state) % WORD_COUNT],
+                    words[bench_rng_next(&rng_state) % WORD_COUNT], user % 1000);
+        text_puts(t, "\"location\":\"\",\"description\":");
+        append_tweet_text(t);
+        text_printf(t, ",\"url\":null,\"entities\":{\"description\":{\"urls\":[]}},\"protected\":false,"
+                       "\"followers_count\":%u,\"friends_count\":%u,\"listed_count\":%u,",
+                    (unsigned)(bench_rng_next(&rng_state) % 100000), (unsigned)(bench_rng_next(&rng_state) % 5000),
+                    (unsigned)(bench_rng_next(&rng_state) % 100));
+        text_printf(t, "\"utc_offset\":%d,\"time_zone\":%s,\"geo_enabled\":%s,\"verified\":%s,"
+                       "\"profile_background_color\":\"C0DEED\",\"default_profile\":true},",
+                    (int)(bench_rng_next(&rng_state) % 50400) - 25200, bench_rng_next(&rng_state) % 2 ? "\"Tokyo\"" : "null",
+                    bench_rng_next(&rng_state) % 2 ? "true" : "false", bench_rng_next(&rng_state) % 10 ? "false" : "true");
+        text_puts(t, "\"geo\":null,\"coordinates\":null,\"place\":null,\"contributors\":null,");
+        text_printf(t, "\"retweet_count\":%u,\"favorite_count\":%u,\"entities\":{\"hashtags\":[",
+                    (unsigned)(bench_rng_next(&rng_state) % 1000), (unsigned)(bench_rng_next(&rng_state) % 1000));
+        unsigned tags = (unsigned)(bench_rng_next(&rng_state) % 3);
+        for (unsigned h = 0; h < tags; h++) {
+            unsigned at = (unsigned)(bench_rng_next(&rng_state) % 100);
+            text_printf(t, "%s{\"text\":\"%s\",\"indices\":[%u,%u]}", h ? "," : "",
+                        words[bench_rng_next(&rng_state) % WORD_COUNT], at, at + 8);
+        }
+        text_puts(t, "],\"symbols\":[],\"urls\":[],\"user_mentions\":[]},"
+                     "\"favorited\":false,\"retweeted\":false,\"lang\":\"en\"}");
+    }
+    text_puts(t, "],\"search_metadata\":{\"completed_in\":0.087,\"count\":100}}\n");
+}
+
+// GeoJSON-like polygons of doubles plus plain integer arrays
+static void generate_numeric(text_t *t, size_t target) {
+    text_puts(t, "{\"type\":\"FeatureCollection\",\"features\":[");
+    for (size_t f = 0; t->len < target; f++) {
+        if (f) text_puts(t, ",");
+        text_printf(t, "{\"type\":\"Feature\",\"properties\":{\"id\":%zu},"
+                       "\"geometry\":{\"type\":\"Polygon\",\"coordinates\":[[", f);
+        double x = -140.0 + (double)(bench_rng_next(&rng_state) % 8000) / 100.0;
+        double y = 42.0 + (double)(bench_rng_next(&rng_state) % 3000) / 100.0;
+        size_t points = 200 + bench_rng_next(&rng_state) % 800;
+        for (size_t p = 0; p < points; p++) {
+            x += (double)((int64_t)(bench_rng_next(&rng_state) % 2001) - 1000) * 1e-6;
+            y += (double)((int64_t)(bench_rng_next(&rng_state) % 2001) - 1000) * 1e-6;
+            text_printf(t, "%s[%.15g,%.15g]", p ? "," : "", x, y);
+        }
+        text_puts(t, "]]},\"samples\":[");
+        size_t samples = 100 + bench_rng_next(&rng_state) % 400;
+        for (size_t s = 0; s < samples; s++) {
+            text_printf(t, "%s%lld", s ? "," : "", (long long)(bench_rng_next(&rng_state) % 2000001) - 1000000);
+        }
+        text_puts(t, "]}");
+    }
+    text_puts(t, "]}\n");
+}
+
+static int load_file(text_t *t, const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    char chunk[65536];
+    size_t n;
+    while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0) text_append(t, chunk, n);
+    fclose(f);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Benchmark
+// ---------------------------------------------------------------------------
+
+// Fold the tape into a checksum so scan modes can be cross-checked; string
+// bytes are read through their bounded views
+static uint64_t tape_digest(const json_doc_t *doc, size_t *string_views) {
+    uint64_t d = doc->tape_len;
+    size_t views = 0;
+    for (size_t i = 0; i < doc->tape_len; i++) {
+        const json_node_t *n = &doc->tape[i];
+        uint64_t v = n->type;
+        switch (n->type) {
+        case JSON_INT:
+            v += (uint64_t)n->u.i;
+            break;
+        case JSON_DOUBLE: {
+            uint64_t bits;
+            memcpy(&bits, &n->u.d, sizeof(bits));
+            v += bits;
+            break;
+        }
+        case JSON_STRING:
+            v += n->aux;
+            if (n->aux) {
+                const unsigned char *s = (const unsigned char *)cap_check(n->u.str, 0, n->aux);
+                v += (uint64_t)s[0] * 31u + s[n->aux - 1];
+            }
+            views++;
+            break;
+        case JSON_ARRAY:
+        case JSON_OBJECT:
+            v += n->u.count * 7u + n->aux;
+            break;
+        default:
+            v += n->aux;
+            break;
+        }
+        d = d * 1099511628211ull + v;
+    }
+    *string_views = views;
+    return d;
+}
+
+static int parse_checked(cap_ptr_t input, size_t len, json_doc_t *doc, json_scan_t scan) {
+    int rc = json_parse(input, len, doc, scan);
+    if (rc != JSON_OK) fprintf(stderr, "Parse failed (%s): error %d\n", json_scan_name(scan), rc);
+    return rc;
+}
+
+static int run_corpus(const char *name, const text_t *text, int iterations) {
+    // The parser only ever sees a capability bounded to the document bytes
+    cap_ptr_t input = cap_malloc(text->len);
+    if (cap_is_null(input)) return -1;
+    memcpy(cap_check(input, 0, text->len), text->data, text->len);
+
+    json_doc_t doc;
+    memset(&doc, 0, sizeof(doc));
+    doc.strings = CAP_NULL;
+
+    // Cross-check every scan mode against byte-at-a-time classification
+    size_t views = 0, structurals = 0;
+    if (parse_checked(input, text->len, &doc, JSON_SCAN_SCALAR) != JSON_OK) return -1;
+    uint64_t reference = tape_digest(&doc, &views);
+    structurals = doc.index_count;
+    for (int s = JSON_SCAN_SWAR; s < JSON_SCAN_MODES; s++) {
+        size_t v;
+        if (!json_scan_supported((json_scan_t)s)) continue;
+        if (parse_checked(input, text->len, &doc, (json_scan_t)s) != JSON_OK) return -1;
+        if (doc.index_count != structurals || tape_digest(&doc, &v) != reference) {
+            fprintf(stderr, "Scan mode %s disagrees with scalar parser\n", json_scan_name((json_scan_t)s));
+            return -1;
+        }
+    }
+
+    printf("%s corpus: %zu bytes, %zu structurals, %zu tape nodes, %zu string views\n",
+           name, text->len, structurals, doc.tape_len, views);
+    char metric[48];
+    for (int s = 0; s < JSON_SCAN_MODES; s++) {
+        json_scan_t scan = (json_scan_t)s;
+        if (!json_scan_supported(scan)) continue;
+
+        uint64_t start = bench_now_ns();
+        for (int it = 0; it < iterations; it++) json_stage1(input, text->len, &doc, scan);
+        double stage1_seconds = bench_seconds(start, bench_now_ns());
+
+        start = bench_now_ns();
+        for (int it = 0; it < iterations; it++) json_parse(input, text->len, &doc, scan);
+        double total_seconds = bench_seconds(start, bench_now_ns());
+
+        double bytes = (double)text->len * iterations;
+        snprintf(metric, sizeof(metric), "%s_%s_stage1_gb_per_sec", name, json_scan_name(scan));
+        bench_report(metric, bytes / stage1_seconds / 1e9, "GB/s");
+        snprintf(metric, sizeof(metric), "%s_%s_gb_per_sec", name, json_scan_name(scan));
+        bench_report(metric, bytes / total_seconds / 1e9, "GB/s");
+    }
+    snprintf(metric, sizeof(metric), "%s_tape_bytes_per_input_byte", name);
+    bench_report(metric, (double)(doc.tape_len * sizeof(json_node_t)) / (double)text->len, "ratio");
+
+    json_doc_free(&doc);
+    cap_free(input);
+    return 0;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-s corpus_kb] [-i iterations] [-f file.json]\n", prog);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    size_t corpus_kb = DEFAULT_CORPUS_KB;
+    int iterations = DEFAULT_ITERATIONS;
+    const char *path = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:i:f:h")) != -1) {
+        switch (opt) {
+        case 's': corpus_kb = (size_t)atol(optarg); break;
+        case 'i': iterations = atoi(optarg); break;
+        case 'f': path = optarg; break;
+        default: usage(argv[0]);
+        }
+    }
+    if (corpus_kb == 0 || iterations <= 0) usage(argv[0]);
+
+    bench_print_header("json-parser", "JSON PARSING WORKLOAD");
+    printf("Tape node: %zu bytes, %d iterations per corpus\n\n", sizeof(json_node_t), iterations);
+
+    printf("JSON PARSER RESULTS\n");
+    printf("-------------------------------------------\n");
+    int failed = 0;
+    if (path) {
+        text_t text = { 0 };
+        failed |= load_file(&text, path) != 0 || run_corpus("file", &text, iterations) != 0;
+        free(text.data);
+    } else {
+        text_t twitter = { 0 }, numeric = { 0 };
+        generate_twitter(&twitter, corpus_kb * 1024);
+        generate_numeric(&numeric, corpus_kb * 1024);
+        failed |= run_corpus("twitter", &twitter, iterations) != 0;
+        failed |= run_corpus("numeric", &numeric, iterations) != 0;
+        free(twitter.data);
+        free(numeric.data);
+    }
+    bench_report("tape_node_bytes", (double)sizeof(json_node_t), "bytes");
+    bench_finish();
+    return failed;
+}
@@ -0,0 +1,805 @@
+/*
+ * Real-World Application Stress Test - In-Memory Key-Value Cache
+ *
+ * A memcached-style cache server: slab-allocated items, a lock-striped hash
+ * index and per-worker epoll (kqueue on CheriBSD) event loops serving the
+ * memcached text protocol over a Unix domain socket. A closed-loop load
+ * generator with Zipfian key popularity drives it from the same process and
+ * reports requests/sec, latency percentiles and memory per key.
+ *
+ * Every item reference (hash chains, slab free lists, key and value views)
+ * is a cap_ptr_t, so the pointer, softcap and CHERI builds differ only in
+ * pointer width and bounds enforcement.
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#else
+#include <sys/event.h>
+#endif
+
+#include "capmodel.h"
+#include "bench.h"
+
+// Cache configuration
+#define SLAB_PAGE_SIZE      (1024 * 1024)
+#define SLAB_MIN_CHUNK      96
+#define SLAB_GROWTH_FACTOR  1.25
+#define SLAB_MAX_CLASSES    64
+#define LOCK_STRIPES        1024
+#define KEY_MAX_LEN         250
+#define VALUE_MAX_LEN       (64 * 1024)
+#define CONN_RBUF_SIZE      (VALUE_MAX_LEN + 1024)
+#define CONN_WBUF_SIZE      (2 * VALUE_MAX_LEN + 1024)
+#define MAX_EVENTS          64
+#define MAX_THREADS         64
+
+// Run configuration (command line)
+static long opt_keys = 100000;
+static int opt_value_size = 100;
+static int opt_workers = 4;
+static int opt_clients = 8;
+static long opt_ops = 50000;          // Requests per client
+static int opt_get_percent = 90;
+static double opt_theta = 0.99;
+static long opt_memory_mb = 1024;
+
+// Item stored in a slab chunk: header followed by key bytes then value bytes
+typedef struct kv_item {
+    cap_ptr_t h_next;      // Hash chain link (slab free-list link when free)
+    uint32_t hash;
+    uint32_t value_len;
+    uint16_t key_len;
+    uint8_t slab_class;
+    uint8_t reserved;
+    char data[];
+} kv_item_t;
+
+// Slab size class
+typedef struct {
+    size_t chunk_size;
+    cap_ptr_t free_list;
+    cap_ptr_t current_page;   // Page currently being carved into chunks
+    size_t carve_offset;
+    size_t pages;
+    size_t used_chunks;
+    pthread_mutex_t lock;
+} slab_class_t;
+
+static slab_class_t slab_classes[SLAB_MAX_CLASSES];
+static int slab_class_count = 0;
+static size_t slab_pages_total = 0;
+static size_t slab_page_limit = 0;
+static pthread_mutex_t slab_page_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// Hash index
+static cap_ptr_t hash_table;          // Array of cap_ptr_t chain heads
+static size_t hash_buckets = 0;
+static pthread_mutex_t hash_locks[LOCK_STRIPES];
+static long items_stored = 0;
+
+// ---------------------------------------------------------------------------
+// Slab allocator
+// ---------------------------------------------------------------------------
+
+void slab_init(size_t memory_limit) {
+    double size = SLAB_MIN_CHUNK;
+
+    while (slab_class_count < SLAB_MAX_CLASSES - 1 && size <= SLAB_PAGE_SIZE / 2) {
+        size_t chunk = ((size_t)size + 15) & ~(size_t)15;  // Capability alignment
+        slab_classes[slab_class_count].chunk_size = chunk;
+        slab_class_count++;
+        size *= SLAB_GROWTH_FACTOR;
+    }
+    slab_classes[slab_class_count++].chunk_size = SLAB_PAGE_SIZE;
+
+    for (int i = 0; i < slab_class_count; i++) {
+        slab_classes[i].free_list = CAP_NULL;
+        slab_classes[i].current_page = CAP_NULL;
+        pthread_mutex_init(&slab_classes[i].lock, NULL);
+    }
+
+    slab_page_limit = memory_limit / SLAB_PAGE_SIZE;
+}
+
+static int slab_class_for(size_t size) {
+    for (int i = 0; i < slab_class_count; i++) {
+        if (slab_classes[i].chunk_size >= size) return i;
+    }
+    return -1;
+}
+
+static cap_ptr_t slab_new_page(void) {
+    pthread_mutex_lock(&slab_page_lock);
+    if (slab_pages_total >= slab_page_limit) {
+        pthread_mutex_unlock(&slab_page_lock);
+        return CAP_NULL;
+    }
+    slab_pages_total++;
+    pthread_mutex_unlock(&slab_page_lock);
+
+    return cap_malloc(SLAB_PAGE_SIZE);
+}
+
+// Allocate a chunk bounded to its slab class size
+cap_ptr_t slab_alloc(size_t size, int *class_out) {
+    int cls = slab_class_for(size);
+    if (cls < 0) return CAP_NULL;
+
+    slab_class_t *sc = &slab_classes[cls];
+    cap_ptr_t chunk = CAP_NULL;
+
+    pthread_mutex_lock(&sc->lock);
+    if (!cap_is_null(sc->free_list)) {
+        chunk = sc->free_list;
+        sc->free_list = CAP_OBJ(chunk, kv_item_t)->h_next;
+    } else {
+        if (cap_is_null(sc->current_page) ||
+            sc->carve_offset + sc->chunk_size > SLAB_PAGE_SIZE) {
+            sc->current_page = slab_new_page();
+            sc->carve_offset = 0;
+            if (!cap_is_null(sc->current_page)) sc->pages++;
+        }
+        if (!cap_is_null(sc->current_page)) {
+            // Per-object bounds derived from the page capability
+            chunk = cap_sub(sc->current_page, sc->carve_offset, sc->chunk_size);
+            sc->carve_offset += sc->chunk_size;
+        }
+    }
+    if (!cap_is_null(chunk)) sc->used_chunks++;
+    pthread_mutex_unlock(&sc->lock);
+
+    *class_out = cls;
+    return chunk;
+}
+
+void slab_free(cap_ptr_t chunk) {
+    kv_item_t *item = CAP_OBJ(chunk, kv_item_t);
+    slab_class_t *sc = &slab_classes[item->slab_class];
+
+    pthread_mutex_lock(&sc->lock);
+    item->h_next = sc->free_list;
+    sc->free_list = chunk;
+    sc->used_chunks--;
+    pthread_mutex_unlock(&sc->lock);
+}
+
+// ---------------------------------------------------------------------------
+// Hash index
+// ---------------------------------------------------------------------------
+
+static inline uint32_t kv_hash(const char *key, size_t len) {
+    uint32_t h = 2166136261u;  // FNV-1a
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)key[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+void hash_init(long expected_keys) {
+    hash_buckets = 1;
+    while (hash_buckets < (size_t)expected_keys + (size_t)expected_keys / 2) {
+        hash_buckets <<= 1;
+    }
+
+    hash_table = cap_malloc(hash_buckets * sizeof(cap_ptr_t));
+    if (cap_is_null(hash_table)) {
+        fprintf(stderr, "hash table allocation failed\n");
+        exit(1);
+    }
+    for (size_t i = 0; i < hash_buckets; i++) {
+        CAP_AT(hash_table, cap_ptr_t, i) = CAP_NULL;
+    }
+    for (int i = 0; i < LOCK_STRIPES; i++) {
+        pthread_mutex_init(&hash_locks[i], NULL);
+    }
+}
+
+static inline int item_key_matches(cap_ptr_t it, uint32_t hash, const char *key, size_t key_len) {
+    kv_item_t *item = CAP_OBJ(it, kv_item_t);
+    if (item->hash != hash || item->key_len != key_len) return 0;
+    return memcmp(cap_check(it, offsetof(kv_item_t, data), key_len), key, key_len) == 0;
+}
+
+// Look up a key and append a "VALUE" record to out; returns bytes written, 0 on miss
+size_t kv_get(const char *key, size_t key_len, char *out, size_t out_room) {
+    uint32_t hash = kv_hash(key, key_len);
+    size_t bucket = hash & (hash_buckets - 1);
+    size_t written = 0;
+
+    pthread_mutex_lock(&hash_locks[bucket % LOCK_STRIPES]);
+    cap_ptr_t it = CAP_AT(hash_table, cap_ptr_t, bucket);
+    while (!cap_is_null(it)) {
+        if (item_key_matches(it, hash, key, key_len)) {
+            kv_item_t *item = CAP_OBJ(it, kv_item_t);
+            // Bounded view over just the value bytes
+            cap_ptr_t value = cap_sub(it, offsetof(kv_item_t, data) + key_len, item->value_len);
+            int header = snprintf(out, out_room, "VALUE %.*s 0 %u\r\n",
+                                  (int)key_len, key, item->value_len);
+            if (header > 0 && (size_t)header + item->value_len + 2 <= out_room) {
+                memcpy(out + header, cap_check(value, 0, item->value_len), item->value_len);
+                memcpy(out + header + item->value_len, "\r\n", 2);
+                written = (size_t)header + item->value_len + 2;
+            }
+            break;
+        }
+        it = CAP_OBJ(it, kv_item_t)->h_next;
+    }
+    pthread_mutex_unlock(&hash_locks[bucket % LOCK_STRIPES]);
+
+    return written;
+}
+
+// Store a key/value pair, replacing any existing item; returns 0 on success
+int kv_set(const char *key, size_t key_len, const char *value, size_t value_len) {
+    int cls;
+    size_t total = sizeof(kv_item_t) + key_len + value_len;
+    cap_ptr_t chunk = slab_alloc(total, &cls);
+    if (cap_is_null(chunk)) return -1;
+
+    uint32_t hash = kv_hash(key, key_len);
+    kv_item_t *item = CAP_OBJ(chunk, kv_item_t);
+    item->hash = hash;
+    item->key_len = (uint16_t)key_len;
+    item->value_len = (uint32_t)value_len;
+    item->slab_class = (uint8_t)cls;
+    memcpy(cap_check(chunk, offsetof(kv_item_t, data), key_len), key, key_len);
+    memcpy(cap_check(chunk, offsetof(kv_item_t, data) + key_len, value_len), value, value_len);
+
+    size_t bucket = hash & (hash_buckets - 1);
+    cap_ptr_t replaced = CAP_NULL;
+
+    pthread_mutex_lock(&hash_locks[bucket % LOCK_STRIPES]);
+    cap_ptr_t *link = &CAP_AT(hash_table, cap_ptr_t, bucket);
+    while (!cap_is_null(*link)) {
+        if (item_key_matches(*link, hash, key, key_len)) {
+            replaced = *link;
+            *link = CAP_OBJ(replaced, kv_item_t)->h_next;
+            break;
+        }
+        link = &CAP_OBJ(*link, kv_item_t)->h_next;
+    }
+    item->h_next = CAP_AT(hash_table, cap_ptr_t, bucket);
+    CAP_AT(hash_table, cap_ptr_t, bucket) = chunk;
+    pthread_mutex_unlock(&hash_locks[bucket % LOCK_STRIPES]);
+
+    if (!cap_is_null(replaced)) {
+        slab_free(replaced);
+    } else {
+        __atomic_add_fetch(&items_stored, 1, __ATOMIC_RELAXED);
+    }
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Event loop (epoll on Linux, kqueue on CheriBSD/FreeBSD)
+// ---------------------------------------------------------------------------
+
+static int ev_create(void) {
+#ifdef __linux__
+    return epoll_create1(0);
+#else
+    return kqueue();
+#endif
+}
+
+static int ev_add(int ev, int fd, void *udata) {
+#ifdef __linux__
+    struct epoll_event e;
+    memset(&e, 0, sizeof(e));
+    e.events = EPOLLIN;
+    e.data.ptr = udata;
+    return epoll_ctl(ev, EPOLL_CTL_ADD, fd, &e);
+#else
+    struct kevent kev;
+    EV_SET(&kev, fd, EVFILT_READ, EV_ADD, 0, 0, udata);
+    return kevent(ev, &kev, 1, NULL, 0, NULL);
+#endif
+}
+
+static int ev_wait(int ev, void **ready, int max, int timeout_ms) {
+#ifdef __linux__
+    struct epoll_event events[MAX_EVENTS];
+    int n = epoll_wait(ev, events, max < MAX_EVENTS ? max : MAX_EVENTS, timeout_ms);
+    for (int i = 0; i < n; i++) ready[i] = events[i].data.ptr;
+#else
+    struct kevent events[MAX_EVENTS];
+    struct timespec ts = { timeout_ms / 1000, (timeout_ms % 1000) * 1000000L };
+    int n = kevent(ev, NULL, 0, events, max < MAX_EVENTS ? max : MAX_EVENTS, &ts);
+    for (int i = 0; i < n; i++) ready[i] = (void *)events[i].udata;
+#endif
+    return n;
+}
+
+// ---------------------------------------------------------------------------
+// Server: listener thread hands connections to worker event loops
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    int fd;
+    size_t rlen;
+    char rbuf[CONN_RBUF_SIZE];
+    char wbuf[CONN_WBUF_SIZE];
+} conn_t;
+
+typedef struct {
+    pthread_t thread;
+    int ev;
+} worker_t;
+
+static worker_t workers[MAX_THREADS];
+static pthread_t listener_thread;
+static int listen_fd = -1;
+static char socket_path[108];
+static int server_stop = 0;
+
+static int send_all(int fd, const char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, buf, len, 0);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+// Parse an unsigned decimal field; returns pointer past it or NULL
+static const char *parse_u64(const char *p, const char *end, uint64_t *out) {
+    uint64_t v = 0;
+    const char *start = p;
+    while (p < end && *p >= '0' && *p <= '9') {
+        v = v * 10 + (uint64_t)(*p - '0');
+        p++;
+    }
+    *out = v;
+    return p > start ? p : NULL;
+}
+
+// Append a string literal to a response buffer
+#define APPEND_LITERAL(buf, len, str) \
+    do { memcpy((buf) + (len), str, sizeof(str) - 1); (len) += sizeof(str) - 1; } while (0)
+
+static const char *skip_token(const char *p, const char *end) {
+    while (p < end && *p != ' ') p++;
+    while (p < end && *p == ' ') p++;
+    return p;
+}
+
+// Execute every complete command in the read buffer; returns -1 to close
+static int conn_process(conn_t *c) {
+    size_t pos = 0;
+    size_t wlen = 0;
+
+    while (pos < c->rlen) {
+        char *line = c->rbuf + pos;
+        char *eol = memchr(line, '\n', c->rlen - pos);
+        if (!eol) break;
+        size_t line_len = (size_t)(eol - line);
+        if (line_len > 0 && line[line_len - 1] == '\r') line_len--;
+        size_t consumed = (size_t)(eol - line) + 1;
+
+        if (CONN_WBUF_SIZE - wlen < VALUE_MAX_LEN + KEY_MAX_LEN + 64) {
+            if (send_all(c->fd, c->wbuf, wlen) != 0) return -1;
+            wlen = 0;
+        }
+
+        if (line_len > 4 && memcmp(line, "get ", 4) == 0) {
+            size_t key_len = line_len - 4;
+            if (key_len <= KEY_MAX_LEN) {
+                wlen += kv_get(line + 4, key_len, c->wbuf + wlen, CONN_WBUF_SIZE - wlen);
+            }
+            APPEND_LITERAL(c->wbuf, wlen, "END\r\n");
+        } else if (line_len > 4 && memcmp(line, "set ", 4) == 0) {
+            // set <key> <flags> <exptime> <bytes>
+            const char *end = line + line_len;
+            const char *key = line + 4;
+            const char *p = skip_token(key, end);
+            size_t key_len = (size_t)(p - key);
+            while (key_len > 0 && key[key_len - 1] == ' ') key_len--;
+            p = skip_token(p, end);   // flags
+            p = skip_token(p, end);   // exptime
+            uint64_t bytes;
+            if (key_len == 0 || key_len > KEY_MAX_LEN ||
+                !parse_u64(p, end, &bytes) || bytes > VALUE_MAX_LEN) {
+                APPEND_LITERAL(c->wbuf, wlen, "CLIENT_ERROR bad command line format\r\n");
+                pos += consumed;
+                continue;
+            }
+            if (c->rlen - pos - consumed < bytes + 2) break;  // Wait for data block
+
+            const char *value = line + consumed;
+            if (kv_set(key, key_len, value, (size_t)bytes) == 0) {
+                APPEND_LITERAL(c->wbuf, wlen, "STORED\r\n");
+            } else {
+                APPEND_LITERAL(c->wbuf, wlen, "SERVER_ERROR out of memory storing object\r\n");
+            }
+            consumed += (size_t)bytes + 2;
+        } else {
+            APPEND_LITERAL(c->wbuf, wlen, "ERROR\r\n");
+        }
+        pos += consumed;
+    }
+
+    if (wlen > 0 && send_all(c->fd, c->wbuf, wlen) != 0) return -1;
+
+    if (pos == 0 && c->rlen == CONN_RBUF_SIZE) return -1;  // Oversized request
+    memmove(c->rbuf, c->rbuf + pos, c->rlen - pos);
+    c->rlen -= pos;
+    return 0;
+}
+
+static void *worker_main(void *arg) {
+    worker_t *w = (worker_t *)arg;
+    void *ready[MAX_EVENTS];
+
+    while (!__atomic_load_n(&server_stop, __ATOMIC_ACQUIRE)) {
+        int n = ev_wait(w->ev, ready, MAX_EVENTS, 100);
+        for (int i = 0; i < n; i++) {
+            conn_t *c = (conn_t *)ready[i];
+            ssize_t got = recv(c->fd, c->rbuf + c->rlen, CONN_RBUF_SIZE - c->rlen, 0);
+            if (got <= 0 || (c->rlen += (size_t)got, conn_process(c) != 0)) {
+                close(c->fd);   // Closing also removes it from the event set
+                free(c);
+            }
+        }
+    }
+    return NULL;
+}
+
+static void *listener_main(void *arg) {
+    (void)arg;
+    int next_worker = 0;
+    struct pollfd pfd = { listen_fd, POLLIN, 0 };
+
+    while (!__atomic_load_n(&server_stop, __ATOMIC_ACQUIRE)) {
+        if (poll(&pfd, 1, 100) <= 0) continue;
+        int fd = accept(listen_fd, NULL, NULL);
+        if (fd < 0) continue;
+
+        conn_t *c = malloc(sizeof(conn_t));
+        if (!c) {
+            close(fd);
+            continue;
+        }
+        c->fd = fd;
+        c->rlen = 0;
+        if (ev_add(workers[next_worker].ev, fd, c) != 0) {
+            close(fd);
+            free(c);
+            continue;
+        }
+        next_worker = (next_worker + 1) % opt_workers;
+    }
+    return NULL;
+}
+
+int server_start(void) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(socket_path, sizeof(socket_path), "/tmp/kv-cache-stress.%d.sock", (int)getpid());
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", socket_path);
+    unlink(socket_path);
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0 ||
+        bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(listen_fd, 128) != 0) {
+        perror("kv server socket");
+        return -1;
+    }
+
+    for (int i = 0; i < opt_workers; i++) {
+        workers[i].ev = ev_create();
+        if (workers[i].ev < 0) {
+            perror("event queue");
+            return -1;
+        }
+        pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]);
+    }
+    pthread_create(&listener_thread, NULL, listener_main, NULL);
+    return 0;
+}
+
+void server_stop_and_join(void) {
+    __atomic_store_n(&server_stop, 1, __ATOMIC_RELEASE);
+    pthread_join(listener_thread, NULL);
+    for (int i = 0; i < opt_workers; i++) {
+        pthread_join(workers[i].thread, NULL);
+        close(workers[i].ev);
+    }
+    close(listen_fd);
+    unlink(socket_path);
+}
+
+// ---------------------------------------------------------------------------
+// Closed-loop load generator with Zipfian key popularity (YCSB generator)
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    uint64_t items;
+    double theta;
+    double alpha;
+    double zetan;
+    double eta;
+    double half_pow_theta;
+} zipf_t;
+
+static void zipf_init(zipf_t *z, uint64_t items, double theta) {
+    double zeta2 = 1.0 + pow(0.5, theta);
+    z->items = items;
+    z->theta = theta;
+    z->zetan = 0.0;
+    for (uint64_t i = 1; i <= items; i++) {
+        z->zetan += 1.0 / pow((double)i, theta);
+    }
+    z->alpha = 1.0 / (1.0 - theta);
+    z->eta = (1.0 - pow(2.0 / (double)items, 1.0 - theta)) / (1.0 - zeta2 / z->zetan);
+    z->half_pow_theta = pow(0.5, theta);
+}
+
+static inline double rng_uniform(uint64_t *state) {
+    return (double)(bench_rng_next(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static inline uint64_t zipf_next(const zipf_t *z, uint64_t *rng) {
+    double u = rng_uniform(rng);
+    double uz = u * z->zetan;
+    uint64_t rank;
+    if (uz < 1.0) {
+        rank = 0;
+    } else if (uz < 1.0 + z->half_pow_theta) {
+        rank = 1;
+    } else {
+        rank = (uint64_t)((double)z->items * pow(z->eta * u - z->eta + 1.0, z->alpha));
+    }
+    if (rank >= z->items) rank = z->items - 1;
+    // Scatter popular ranks across the key space
+    return (rank * 0x9E3779B97F4A7C15ull) % z->items;
+}
+
+typedef struct {
+    pthread_t thread;
+    int id;
+    uint64_t *latencies_ns;
+    long completed;
+    long gets;
+    long hits;
+    long errors;
+} client_t;
+
+static zipf_t key_dist;
+static char *value_template;
+
+static int format_key(char *buf, uint64_t key) {
+    return sprintf(buf, "key:%010llu", (unsigned long long)key);
+}
+
+// Read until a complete response terminator arrives
+static int read_response(int fd, char *buf, size_t size, size_t *len_out) {
+    size_t len = 0;
+    for (;;) {
+        ssize_t n = recv(fd, buf + len, size - len - 1, 0);
+        if (n <= 0) return -1;
+        len += (size_t)n;
+        buf[len] = '\0';
+        if (len >= 2 && buf[len - 2] == '\r' && buf[len - 1] == '\n') {
+            if ((len >= 5 && memcmp(buf + len - 5, "END\r\n", 5) == 0) ||
+                memcmp(buf, "STORED\r\n", 8) == 0 ||
+                memcmp(buf, "SERVER_ERROR", 12) == 0 ||
+                memcmp(buf, "CLIENT_ERROR", 12) == 0 ||
+                memcmp(buf, "ERROR", 5) == 0) {
+                *len_out = len;
+                return 0;
+            }
+        }
+        if (len + 1 >= size) return -1;
+    }
+}
+
+static void *client_main(void *arg) {
+    client_t *cl = (client_t *)arg;
+    uint64_t rng = 0x9E3779B97F4A7C15ull ^ ((uint64_t)cl->id * 0xD1B54A32D192ED03ull);
+    size_t req_size = (size_t)opt_value_size + KEY_MAX_LEN + 64;
+    char *request = malloc(req_size);
+    char *response = malloc(CONN_WBUF_SIZE);
+    char key[32];
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", socket_path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (!request || !response || fd < 0 ||
+        connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        perror("kv client connect");
+        cl->errors = opt_ops;
+        free(request);
+        free(response);
+        if (fd >= 0) close(fd);
+        return NULL;
+    }
+
+    for (long i = 0; i < opt_ops; i++) {
+        int key_len = format_key(key, zipf_next(&key_dist, &rng));
+        int is_get = (int)(bench_rng_next(&rng) % 100) < opt_get_percent;
+        size_t req_len;
+
+        if (is_get) {
+            req_len = (size_t)sprintf(request, "get %.*s\r\n", key_len, key);
+        } else {
+            req_len = (size_t)sprintf(request, "set %.*s 0 0 %d\r\n", key_len, key, opt_value_size);
+            memcpy(request + req_len, value_template, (size_t)opt_value_size);
+            memcpy(request + req_len + opt_value_size, "\r\n", 2);
+            req_len += (size_t)opt_value_size + 2;
+        }
+
+        uint64_t start = bench_now_ns();
+        size_t resp_len;
+        if (send_all(fd, request, req_len) != 0 ||
+            read_response(fd, response, CONN_WBUF_SIZE, &resp_len) != 0) {
+            cl->errors++;
+            break;
+        }
+        cl->latencies_ns[i] = bench_now_ns() - start;
+        cl->completed++;
+
+        if (is_get) {
+            cl->gets++;
+            if (memcmp(response, "VALUE", 5) == 0) cl->hits++;
+        } else if (memcmp(response, "STORED", 6) != 0) {
+            cl->errors++;
+        }
+    }
+
+    close(fd);
+    free(request);
+    free(response);
+    return NULL;
+}
+
+// ---------------------------------------------------------------------------
+// Main benchmark driver
+// ---------------------------------------------------------------------------
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [-k keys] [-v value_bytes] [-w workers] [-c clients]\n"
+            "          [-n ops_per_client] [-g get_percent] [-t zipf_theta] [-m memory_mb]\n",
+            prog);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    int opt;
+    while ((opt = getopt(argc, argv, "k:v:w:c:n:g:t:m:h")) != -1) {
+        switch (opt) {
+        case 'k': opt_keys = atol(optarg); break;
+        case 'v': opt_value_size = atoi(optarg); break;
+        case 'w': opt_workers = atoi(optarg); break;
+        case 'c': opt_clients = atoi(optarg); break;
+        case 'n': opt_ops = atol(optarg); break;
+        case 'g': opt_get_percent = atoi(optarg); break;
+        case 't': opt_theta = atof(optarg); break;
+        case 'm': opt_memory_mb = atol(optarg); break;
+        default: usage(argv[0]);
+        }
+    }
+    if (opt_keys < 2 || opt_value_size < 1 || opt_value_size > VALUE_MAX_LEN ||
+        opt_workers < 1 || opt_workers > MAX_THREADS ||
+        opt_clients < 1 || opt_clients > MAX_THREADS || opt_ops < 1 ||
+        opt_theta <= 0.0 || opt_theta >= 1.0) {
+        usage(argv[0]);
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    bench_print_header("kv-cache", "KEY-VALUE CACHE WORKLOAD");
+    printf("Keys: %ld, value size: %d bytes, workers: %d, clients: %d, ops/client: %ld\n",
+           opt_keys, opt_value_size, opt_workers, opt_clients, opt_ops);
+    printf("Mix: %d%% get, Zipfian theta %.2f\n\n", opt_get_percent, opt_theta);
+
+    slab_init((size_t)opt_memory_mb * 1024 * 1024);
+    hash_init(opt_keys);
+
+    value_template = malloc((size_t)opt_value_size);
+    if (!value_template) return 1;
+    memset(value_template, 'x', (size_t)opt_value_size);
+
+    // Preload the full key space directly into the store
+    char key[32];
+    for (long k = 0; k < opt_keys; k++) {
+        int key_len = format_key(key, (uint64_t)k);
+        if (kv_set(key, (size_t)key_len, value_template, (size_t)opt_value_size) != 0) {
+            printf("Preload stopped at %ld keys (memory limit)\n", k);
+            break;
+        }
+    }
+
+    size_t index_bytes = hash_buckets * sizeof(cap_ptr_t);
+    size_t slab_bytes = slab_pages_total * SLAB_PAGE_SIZE;
+    size_t used_bytes = 0;
+    for (int i = 0; i < slab_class_count; i++) {
+        used_bytes += slab_classes[i].used_chunks * slab_classes[i].chunk_size;
+    }
+    long preloaded = items_stored;
+
+    zipf_init(&key_dist, (uint64_t)opt_keys, opt_theta);
+
+    if (server_start() != 0) return 1;
+
+    client_t *clients = calloc((size_t)opt_clients, sizeof(client_t));
+    if (!clients) return 1;
+    for (int i = 0; i < opt_clients; i++) {
+        clients[i].id = i;
+        clients[i].latencies_ns = malloc((size_t)opt_ops * sizeof(uint64_t));
+        if (!clients[i].latencies_ns) return 1;
+    }
+
+    uint64_t start = bench_now_ns();
+    for (int i = 0; i < opt_clients; i++) {
+        pthread_create(&clients[i].thread, NULL, client_main, &clients[i]);
+    }
+    for (int i = 0; i < opt_clients; i++) {
+        pthread_join(clients[i].thread, NULL);
+    }
+    uint64_t end = bench_now_ns();
+
+    server_stop_and_join();
+
+    // Merge latency samples
+    long completed = 0, gets = 0, hits = 0, errors = 0;
+    for (int i = 0; i < opt_clients; i++) {
+        completed += clients[i].completed;
+        gets += clients[i].gets;
+        hits += clients[i].hits;
+        errors += clients[i].errors;
+    }
+    uint64_t *all = malloc((size_t)(completed > 0 ? completed : 1) * sizeof(uint64_t));
+    if (!all) return 1;
+    size_t merged = 0;
+    for (int i = 0; i < opt_clients; i++) {
+        memcpy(all + merged, clients[i].latencies_ns, (size_t)clients[i].completed * sizeof(uint64_t));
+        merged += (size_t)clients[i].completed;
+    }
+
+    double seconds = bench_seconds(start, end);
+    printf("KEY-VALUE CACHE RESULTS\n");
+    printf("-------------------------------------------\n");
+    bench_report("requests_per_sec", (double)completed / seconds, "req/s");
+    bench_report("p50_latency_us", (double)bench_percentile(all, merged, 50.0) / 1000.0, "us");
+    bench_report("p99_latency_us", (double)bench_percentile(all, merged, 99.0) / 1000.0, "us");
+    bench_report("p999_latency_us", (double)bench_percentile(all, merged, 99.9) / 1000.0, "us");
+    bench_report("hit_ratio", gets ? (double)hits / (double)gets : 0.0, "fraction");
+    bench_report("errors", (double)errors, "requests");
+    bench_report("item_header_bytes", (double)sizeof(kv_item_t), "bytes");
+    bench_report("index_bytes_per_key", preloaded ? (double)index_bytes / (double)preloaded : 0.0, "bytes");
+    bench_report("slab_bytes_per_key", preloaded ? (double)used_bytes / (double)preloaded : 0.0, "bytes");
+    bench_report("memory_per_key", preloaded ? (double)(slab_bytes + index_bytes) / (double)preloaded : 0.0, "bytes");
+    bench_report("max_rss_mb", (double)bench_max_rss_bytes() / (1024.0 * 1024.0), "MB");
+    bench_finish();
+
+    for (int i = 0; i < opt_clients; i++) free(clients[i].latencies_ns);
+    free(clients);
+    free(all);
+    free(value_template);
+    return errors ? 1 : 0;
+}
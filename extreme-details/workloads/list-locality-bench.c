@@ -0,0 +1,215 @@
+/*
+ * Real-World Application Stress Test - Linked List Locality
+ *
+ * Walks a singly linked list the way the traversal tests in
+ * edge-cases/stress-tests do (sum the data, follow next), at sizes well
+ * past the last-level cache, with the nodes in four placements:
+ *   malloc_seq       - one malloc per node, linked in allocation order
+ *                      (the stress tests' pattern on a fresh heap)
+ *   malloc_shuffled  - one malloc per node, linked in random order, as a
+ *                      list ends up after inserts and deletes on a busy heap
+ *   pool_shuffled    - nodes from a type-stable pool (common/node_pool.h),
+ *                      still linked in random order
+ *   relinearized     - malloc_shuffled copied by np_relinearize() into
+ *                      consecutive pool slots in traversal order, with
+ *                      every next capability rewritten
+ * Each next field is a capability bounded to its node, so the capability
+ * build doubles the pointer share of every node and of the cache lines a
+ * walk touches. The relinearization itself is timed per node.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "capmodel.h"
+#include "bench.h"
+#include "node_pool.h"
+
+// Benchmark configuration
+#define DEFAULT_SIZES       "1e4,1e6,1e7"
+#define DEFAULT_ITERATIONS  3
+#define MIN_NODES_TIMED     20000000    // Repeat short walks until this many nodes
+#define MAX_SIZES           16
+
+typedef struct {
+    uint64_t data;
+    cap_ptr_t next;
+} list_node_t;
+
+typedef enum {
+    PLACE_MALLOC_SEQ = 0, PLACE_MALLOC_SHUFFLED, PLACE_POOL_SHUFFLED, PLACE_RELINEARIZED, PLACE_COUNT
+} placement_t;
+
+static const char *const placement_names[PLACE_COUNT] = {
+    "malloc_seq", "malloc_shuffled", "pool_shuffled", "relinearized"
+};
+
+static uint64_t rng_state = 0x853C49E6748FEA9Bull;
+
+// Link nodes[0..n) in order (shuffled first if asked); returns the head
+static cap_ptr_t link_nodes(cap_ptr_t *nodes, size_t n, int shuffle) {
+    if (shuffle) {
+        for (size_t i = n - 1; i > 0; i--) {
+            size_t j = (size_t)(bench_rng_next(&rng_state) % (i + 1));
+            cap_ptr_t tmp = nodes[i];
+            nodes[i] = nodes[j];
+            nodes[j] = tmp;
+        }
+    }
+    for (size_t i = 0; i < n; i++) {
+        list_node_t *node = CAP_OBJ(nodes[i], list_node_t);
+        node->data = i;
+        node->next = i + 1 < n ? nodes[i + 1] : CAP_NULL;
+    }
+    return nodes[0];
+}
+
+static cap_ptr_t build_malloc_list(cap_ptr_t *nodes, size_t n, int shuffle) {
+    for (size_t i = 0; i < n; i++) {
+        nodes[i] = cap_malloc(sizeof(list_node_t));
+        if (cap_is_null(nodes[i])) {
+            while (i--) cap_free(nodes[i]);
+            return CAP_NULL;
+        }
+    }
+    return link_nodes(nodes, n, shuffle);
+}
+
+static cap_ptr_t build_pool_list(np_pool_t *pool, cap_ptr_t *nodes, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        nodes[i] = np_alloc(pool);
+        if (cap_is_null(nodes[i])) return CAP_NULL;
+    }
+    return link_nodes(nodes, n, 1);
+}
+
+static void free_malloc_list(cap_ptr_t head) {
+    while (!cap_is_null(head)) {
+        cap_ptr_t next = CAP_OBJ(head, list_node_t)->next;
+        cap_free(head);
+        head = next;
+    }
+}
+
+static uint64_t traverse(cap_ptr_t head) {
+    uint64_t sum = 0;
+    for (cap_ptr_t p = head; !cap_is_null(p); ) {
+        const list_node_t *node = CAP_OBJ(p, list_node_t);
+        sum += node->data;
+        p = node->next;
+    }
+    return sum;
+}
+
+// Best ns per node over the iterations; 0 if the walk lost nodes
+static double time_traversal(cap_ptr_t head, size_t n, int iterations) {
+    uint64_t expected = (uint64_t)n * (n - 1) / 2;
+    size_t reps = MIN_NODES_TIMED / n > 0 ? MIN_NODES_TIMED / n : 1;
+    double best = 0.0;
+    for (int it = 0; it < iterations; it++) {
+        uint64_t start = bench_now_ns();
+        for (size_t r = 0; r < reps; r++) {
+            if (traverse(head) != expected) return 0.0;
+        }
+        double ns = (double)(bench_now_ns() - start) / ((double)n * (double)reps);
+        if (best == 0.0 || ns < best) best = ns;
+    }
+    return best;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-n nodes[,nodes...]] [-i iterations]\n", prog);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    const char *size_list = DEFAULT_SIZES;
+    int iterations = DEFAULT_ITERATIONS;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:i:h")) != -1) {
+        switch (opt) {
+        case 'n': size_list = optarg; break;
+        case 'i': iterations = atoi(optarg); break;
+        default: usage(argv[0]);
+        }
+    }
+    size_t sizes[MAX_SIZES];
+    int size_count = bench_parse_sizes(size_list, sizes, MAX_SIZES, 4e9);
+    if (size_count <= 0 || iterations <= 0) usage(argv[0]);
+
+    bench_print_header("list-locality", "LINKED LIST LOCALITY WORKLOAD");
+    printf("Node: %zu bytes (%zu-byte next capability), best of %d\n\n", sizeof(list_node_t),
+           sizeof(cap_ptr_t), iterations);
+
+    printf("LIST LOCALITY RESULTS\n");
+    printf("-------------------------------------------\n");
+    int failed = 0;
+    char metric[48];
+    for (int s = 0; s < size_count && !failed; s++) {
+        size_t n = sizes[s];
+        cap_ptr_t *nodes = malloc(n * sizeof(cap_ptr_t));
+        if (!nodes) {
+            fprintf(stderr, "Out of memory for %zu nodes\n", n);
+            failed = 1;
+            break;
+        }
+
+        double ns[PLACE_COUNT] = { 0 };
+        np_pool_t pool, linear;
+        np_init(&pool, sizeof(list_node_t));
+        np_init(&linear, sizeof(list_node_t));
+
+        cap_ptr_t head = build_malloc_list(nodes, n, 0);
+        if (!cap_is_null(head)) {
+            ns[PLACE_MALLOC_SEQ] = time_traversal(head, n, iterations);
+            free_malloc_list(head);
+        }
+        head = build_pool_list(&pool, nodes, n);
+        if (!cap_is_null(head)) ns[PLACE_POOL_SHUFFLED] = time_traversal(head, n, iterations);
+        np_destroy(&pool);
+
+        double relinearize_ns = 0.0;
+        head = build_malloc_list(nodes, n, 1);
+        if (!cap_is_null(head)) {
+            ns[PLACE_MALLOC_SHUFFLED] = time_traversal(head, n, iterations);
+            uint64_t start = bench_now_ns();
+            cap_ptr_t linear_head = np_relinearize(&linear, NULL, head, offsetof(list_node_t, next), n);
+            relinearize_ns = (double)(bench_now_ns() - start) / (double)n;
+            if (cap_is_null(linear_head)) {
+                free_malloc_list(head);
+            } else {
+                ns[PLACE_RELINEARIZED] = time_traversal(linear_head, n, iterations);
+            }
+        }
+        np_destroy(&linear);
+        free(nodes);
+
+        for (int p = 0; p < PLACE_COUNT; p++) {
+            if (ns[p] == 0.0) {
+                fprintf(stderr, "%s list of %zu nodes: out of memory or broken walk\n", placement_names[p], n);
+                failed = 1;
+                continue;
+            }
+            snprintf(metric, sizeof(metric), "%zu_%s_ns_per_node", n, placement_names[p]);
+            bench_report(metric, ns[p], "ns");
+        }
+        if (failed) break;
+        snprintf(metric, sizeof(metric), "%zu_relinearize_ns_per_node", n);
+        bench_report(metric, relinearize_ns, "ns");
+        snprintf(metric, sizeof(metric), "%zu_relinearized_speedup", n);
+        bench_report(metric, ns[PLACE_MALLOC_SHUFFLED] / ns[PLACE_RELINEARIZED], "x");
+        if (ns[PLACE_MALLOC_SHUFFLED] > ns[PLACE_RELINEARIZED]) {
+            // Walks after which the copy has paid for itself
+            snprintf(metric, sizeof(metric), "%zu_break_even_walks", n);
+            bench_report(metric, relinearize_ns / (ns[PLACE_MALLOC_SHUFFLED] - ns[PLACE_RELINEARIZED]), "walks");
+        }
+    }
+    bench_report("max_rss_mb", (double)bench_max_rss_bytes() / (1 << 20), "MB");
+    bench_finish();
+    return failed;
+}
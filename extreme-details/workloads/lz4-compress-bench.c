@@ -0,0 +1,283 @@
+/*
+ * Real-World Application Stress Test - LZ4 Block Compression
+ *
+ * LZ4-compatible block compression with a hash-chain match finder and two
+ * decoders (common/lz4_block.h). Overlapping back-reference copies are the
+ * classic stress case for bounds checks: the exact decoder checks every
+ * copy, while the wild decoder over-copies in whole words but never past
+ * the destination capability, which is bounded to exactly the block size.
+ *
+ * The corpus is split into independent blocks (default 64KB, as in the LZ4
+ * frame format); each block is compressed from and decompressed into its own
+ * bounded view. Text and binary corpora are synthetic by default, or a file
+ * can be supplied with -f.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "capmodel.h"
+#include "bench.h"
+#include "lz4_block.h"
+
+// Benchmark configuration
+#define DEFAULT_CORPUS_KB    8192
+#define DEFAULT_BLOCK_KB     64
+#define DEFAULT_ITERATIONS   5
+#define DEFAULT_SEARCH_DEPTH 16
+
+typedef struct {
+    cap_ptr_t data;
+    size_t size;
+} corpus_t;
+
+// Compressed corpus: per-block extents inside one output buffer
+typedef struct {
+    cap_ptr_t data;
+    size_t size;
+    size_t *offsets;
+    size_t *lengths;
+    size_t blocks;
+} packed_t;
+
+static uint64_t rng_state = 0x853C49E6748FEA9Bull;
+
+// ---------------------------------------------------------------------------
+// Corpus generators
+// ---------------------------------------------------------------------------
+
+// Word-level text with Zipf-like word frequencies and punctuation
+static void generate_text(unsigned char *p, size_t size) {
+    static const char *const words[] = {
+        "the", "of", "and", "to", "in", "a", "is", "that", "for", "it", "as", "was", "with",
+        "be", "by", "on", "not", "he", "this", "are", "or", "his", "from", "at", "which",
+        "capability", "memory", "bounds", "pointer", "hardware", "protection", "compartment",
+        "allocation", "revocation", "architecture", "instruction", "performance", "overhead",
+        "temporal", "spatial", "safety", "integrity", "monotonic", "derivation", "register",
+    };
+    const size_t count = sizeof(words) / sizeof(words[0]);
+    size_t pos = 0, sentence = 0;
+
+    while (pos < size) {
+        // Squaring a uniform variate skews picks toward the common words
+        double u = (double)(bench_rng_next(&rng_state) >> 11) / 9007199254740992.0;
+        const char *w = words[(size_t)(u * u * (double)count)];
+        size_t len = strlen(w);
+        for (size_t i = 0; i < len && pos < size; i++) {
+            char c = w[i];
+            p[pos++] = (unsigned char)(sentence == 0 && i == 0 ? c - 'a' + 'A' : c);
+        }
+        sentence++;
+        if (pos >= size) break;
+        if (sentence > 6 && bench_rng_next(&rng_state) % 8 == 0) {
+            p[pos++] = '.';
+            if (pos < size) p[pos++] = bench_rng_next(&rng_state) % 6 ? ' ' : '\n';
+            sentence = 0;
+        } else {
+            p[pos++] = bench_rng_next(&rng_state) % 20 ? ' ' : ',';
+        }
+    }
+}
+
+// Record-structured binary: headers, small integers, pointer-like words,
+// zero padding and incompressible payloads, as in heap dumps and databases
+static void generate_binary(unsigned char *p, size_t size) {
+    uint64_t heap = 0x00007f3a12000000ull;
+    size_t pos = 0;
+
+    while (pos + 64 <= size) {
+        uint32_t kind = (uint32_t)(bench_rng_next(&rng_state) % 8);
+        uint64_t words[8];
+        words[0] = 0xFEEDFACE00000000ull | kind;
+        words[1] = bench_rng_next(&rng_state) % 1000;
+        heap += (bench_rng_next(&rng_state) % 16) * 16;
+        words[2] = heap;
+        words[3] = heap + 64 * (bench_rng_next(&rng_state) % 4);
+        if (kind < 2) {            // Random payload
+            for (int i = 4; i < 8; i++) words[i] = bench_rng_next(&rng_state);
+        } else if (kind < 5) {     // Zero padding
+            for (int i = 4; i < 8; i++) words[i] = 0;
+        } else {                   // Small counters
+            for (int i = 4; i < 8; i++) words[i] = bench_rng_next(&rng_state) % 256;
+        }
+        memcpy(p + pos, words, sizeof(words));
+        pos += sizeof(words);
+    }
+    while (pos < size) p[pos++] = 0;
+}
+
+static int load_file(corpus_t *c, const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    fseek(f, 0, SEEK_END);
+    long file_size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    c->size = file_size > 0 ? (size_t)file_size : 0;
+    c->data = cap_malloc(c->size ? c->size : 1);
+    if (cap_is_null(c->data) ||
+        fread(cap_check(c->data, 0, c->size), 1, c->size, f) != c->size) {
+        fclose(f);
+        return -1;
+    }
+    fclose(f);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Benchmark
+// ---------------------------------------------------------------------------
+
+static int compress_corpus(lz4_matcher_t *m, const corpus_t *c, size_t block, packed_t *out) {
+    size_t blocks = (c->size + block - 1) / block;
+    size_t offset = 0;
+    out->blocks = blocks;
+    for (size_t b = 0; b < blocks; b++) {
+        size_t start = b * block;
+        size_t len = c->size - start < block ? c->size - start : block;
+        size_t bound = LZ4_COMPRESS_BOUND(len);
+        long n = lz4_compress(m, cap_sub(c->data, start, len), len,
+                              cap_sub(out->data, offset, bound), bound);
+        if (n < 0) return -1;
+        out->offsets[b] = offset;
+        out->lengths[b] = (size_t)n;
+        offset += (size_t)n;
+    }
+    out->size = offset;
+    return 0;
+}
+
+static int decompress_corpus(const packed_t *packed, size_t block, size_t total, cap_ptr_t dst,
+                             lz4_decode_t mode) {
+    for (size_t b = 0; b < packed->blocks; b++) {
+        size_t start = b * block;
+        size_t len = total - start < block ? total - start : block;
+        // Destination bounded to exactly the block: wild copies must stop at its end
+        long n = lz4_decompress(cap_sub(packed->data, packed->offsets[b], packed->lengths[b]),
+                                packed->lengths[b], cap_sub(dst, start, len), len, mode);
+        if (n != (long)len) return -1;
+    }
+    return 0;
+}
+
+static int run_corpus(const char *name, const corpus_t *c, size_t block, int depth, int iterations) {
+    size_t blocks = (c->size + block - 1) / block;
+    packed_t packed;
+    packed.data = cap_malloc(LZ4_COMPRESS_BOUND(block) * blocks);
+    packed.offsets = malloc(blocks * sizeof(size_t));
+    packed.lengths = malloc(blocks * sizeof(size_t));
+    cap_ptr_t restored = cap_malloc(c->size);
+    lz4_matcher_t *m = malloc(sizeof(lz4_matcher_t));
+    if (cap_is_null(packed.data) || !packed.offsets || !packed.lengths || cap_is_null(restored) || !m) {
+        fprintf(stderr, "Out of memory\n");
+        return -1;
+    }
+    m->search_depth = depth;
+
+    // Round trip through both decoders before timing
+    if (compress_corpus(m, c, block, &packed) != 0) return -1;
+    for (int d = 0; d < LZ4_DECODE_MODES; d++) {
+        memset(cap_check(restored, 0, c->size), 0, c->size);
+        if (decompress_corpus(&packed, block, c->size, restored, (lz4_decode_t)d) != 0 ||
+            memcmp(cap_check(restored, 0, c->size), cap_check(c->data, 0, c->size), c->size) != 0) {
+            fprintf(stderr, "%s: %s decoder failed round trip\n", name, lz4_decode_name((lz4_decode_t)d));
+            return -1;
+        }
+    }
+    printf("%s corpus: %zu bytes in %zu blocks -> %zu bytes\n", name, c->size, blocks, packed.size);
+
+    char metric[48];
+    double mb = (double)c->size * iterations / 1e6;
+    uint64_t start = bench_now_ns();
+    for (int it = 0; it < iterations; it++) compress_corpus(m, c, block, &packed);
+    snprintf(metric, sizeof(metric), "%s_compress_mb_per_sec", name);
+    bench_report(metric, mb / bench_seconds(start, bench_now_ns()), "MB/s");
+    snprintf(metric, sizeof(metric), "%s_compression_ratio", name);
+    bench_report(metric, (double)c->size / (double)packed.size, "x");
+
+    double exact_rate = 0.0;
+    for (int d = 0; d < LZ4_DECODE_MODES; d++) {
+        lz4_decode_t mode = (lz4_decode_t)d;
+        start = bench_now_ns();
+        for (int it = 0; it < iterations; it++) decompress_corpus(&packed, block, c->size, restored, mode);
+        double rate = mb / bench_seconds(start, bench_now_ns());
+        snprintf(metric, sizeof(metric), "%s_%s_decompress_mb_per_sec", name, lz4_decode_name(mode));
+        bench_report(metric, rate, "MB/s");
+        if (mode == LZ4_DECODE_EXACT) {
+            exact_rate = rate;
+        } else {
+            snprintf(metric, sizeof(metric), "%s_%s_speedup_vs_exact", name, lz4_decode_name(mode));
+            bench_report(metric, rate / exact_rate, "x");
+        }
+    }
+
+    free(m);
+    cap_free(restored);
+    cap_free(packed.data);
+    free(packed.offsets);
+    free(packed.lengths);
+    return 0;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-s corpus_kb] [-b block_kb] [-d search_depth] [-i iterations] [-f file]\n",
+            prog);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    size_t corpus_kb = DEFAULT_CORPUS_KB;
+    size_t block_kb = DEFAULT_BLOCK_KB;
+    int depth = DEFAULT_SEARCH_DEPTH;
+    int iterations = DEFAULT_ITERATIONS;
+    const char *path = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "s:b:d:i:f:h")) != -1) {
+        switch (opt) {
+        case 's': corpus_kb = (size_t)atol(optarg); break;
+        case 'b': block_kb = (size_t)atol(optarg); break;
+        case 'd': depth = atoi(optarg); break;
+        case 'i': iterations = atoi(optarg); break;
+        case 'f': path = optarg; break;
+        default: usage(argv[0]);
+        }
+    }
+    if (corpus_kb == 0 || block_kb == 0 || block_kb > 1024 * 1024 || depth <= 0 || iterations <= 0) {
+        usage(argv[0]);
+    }
+
+    bench_print_header("lz4-compress", "LZ4 BLOCK COMPRESSION WORKLOAD");
+    printf("Block size: %zu KB, hash-chain search depth %d, %d iterations\n\n",
+           block_kb, depth, iterations);
+
+    printf("LZ4 RESULTS\n");
+    printf("-------------------------------------------\n");
+    int failed = 0;
+    if (path) {
+        corpus_t file;
+        if (load_file(&file, path) != 0 || file.size == 0) return 1;
+        failed |= run_corpus("file", &file, block_kb * 1024, depth, iterations) != 0;
+        cap_free(file.data);
+    } else {
+        corpus_t text = { cap_malloc(corpus_kb * 1024), corpus_kb * 1024 };
+        corpus_t binary = { cap_malloc(corpus_kb * 1024), corpus_kb * 1024 };
+        if (cap_is_null(text.data) || cap_is_null(binary.data)) {
+            fprintf(stderr, "Out of memory\n");
+            return 1;
+        }
+        generate_text((unsigned char *)cap_check(text.data, 0, text.size), text.size);
+        generate_binary((unsigned char *)cap_check(binary.data, 0, binary.size), binary.size);
+        failed |= run_corpus("text", &text, block_kb * 1024, depth, iterations) != 0;
+        failed |= run_corpus("binary", &binary, block_kb * 1024, depth, iterations) != 0;
+        cap_free(text.data);
+        cap_free(binary.data);
+    }
+    bench_finish();
+    return failed;
+}
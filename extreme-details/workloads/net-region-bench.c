@@ -0,0 +1,464 @@
+/*
+ * Real-World Application Stress Test - Per-Request Region Allocation
+ *
+ * Runs the network path of real-world-network-stress.c with the object
+ * churn of a real server: every packet gets a metadata record and its own
+ * copy of the frame, and every HTTP request in a payload gets a parsed
+ * request, an owned header array, lowercased name and value copies, a
+ * path copy and a formatted response. All of these die together at the
+ * end of the request, so they are allocated three ways:
+ *   malloc         - one malloc/free per object; each packet tracks its
+ *                    objects and frees them one at a time
+ *   region         - common/region.h, bulk-reset in O(1) with the chunks
+ *                    kept for the next request
+ *   region_revoke  - region.h, with the chunks handed back to malloc on
+ *                    every reset so the heap's revocation covers the whole
+ *                    region at once (CheriBSD temporal safety)
+ * Every object is a capability bounded to its own bytes in all three.
+ * Objects are released every -r packets (1 = per request). An untimed
+ * pass measures how many of a request's bytes land on pages the previous
+ * request already used. Packets are synthetic or read from a pcap (-f).
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "capmodel.h"
+#include "bench.h"
+#include "http_parser.h"
+#include "pcap.h"
+#include "region.h"
+
+// Benchmark configuration
+#define DEFAULT_PACKETS     100000
+#define DEFAULT_ITERATIONS  5
+#define DEFAULT_RESET       1           // Packets per region lifetime
+#define MAX_REQUEST_SIZE    (16 * 1024)
+#define MAX_FRAME_SIZE      (MAX_REQUEST_SIZE + 64)
+#define RESPONSE_RESERVE    128         // Response bytes besides the echoed path
+#define PAGE_SHIFT          12
+#define MAX_TRACKED_PAGES   256         // Distinct pages remembered per lifetime
+
+typedef enum {
+    ALLOC_MALLOC = 0, ALLOC_REGION, ALLOC_REGION_REVOKE, ALLOC_COUNT
+} alloc_mode_t;
+
+static const char *const alloc_names[ALLOC_COUNT] = { "malloc", "region", "region_revoke" };
+
+// Per-packet metadata, the first object of every packet
+typedef struct {
+    cap_ptr_t frame;        // Owned copy of the frame
+    cap_ptr_t request;      // http_request_t, when the payload is a request
+    cap_ptr_t headers;      // owned_header_t[num_headers]
+    cap_ptr_t path;         // NUL-terminated copy of the path
+    cap_ptr_t response;
+    size_t frame_len;
+    size_t response_len;
+} packet_t;
+
+// Header copied out of the frame, so it outlives the receive buffer
+typedef struct {
+    cap_ptr_t name;         // Lowercased
+    cap_ptr_t value;
+    uint32_t name_len;
+    uint32_t value_len;
+} owned_header_t;
+
+// Pages used by the previous and the current lifetime
+typedef struct {
+    uintptr_t pages[2][MAX_TRACKED_PAGES];
+    size_t count[2];
+    int current;
+    uint64_t bytes;
+    uint64_t reused_bytes;
+} reuse_t;
+
+typedef struct {
+    alloc_mode_t mode;
+    region_t region;
+    cap_ptr_t *live;        // malloc mode: objects to free at the next reset
+    size_t live_count;
+    size_t live_capacity;
+    uint64_t allocations;
+    uint64_t bytes;
+    reuse_t *reuse;         // Set for the counting pass only
+} net_alloc_t;
+
+// Captured or generated frames, back to back in one buffer
+typedef struct {
+    cap_ptr_t data;
+    size_t size;
+    size_t capacity;
+    size_t *offsets;
+    size_t *lengths;
+    size_t count;
+    size_t max_count;
+} trace_t;
+
+static uint64_t rng_state = 0x853C49E6748FEA9Bull;
+
+// ---------------------------------------------------------------------------
+// Allocation front end
+// ---------------------------------------------------------------------------
+
+static void net_alloc_init(net_alloc_t *a, alloc_mode_t mode, size_t chunk_size) {
+    memset(a, 0, sizeof(*a));
+    a->mode = mode;
+    region_init(&a->region, chunk_size, mode == ALLOC_REGION_REVOKE);
+}
+
+static void reuse_record(reuse_t *u, cap_ptr_t object, size_t size) {
+    uintptr_t page = (uintptr_t)cap_addr(object) >> PAGE_SHIFT;
+    int prev = !u->current;
+    u->bytes += size;
+    for (size_t i = 0; i < u->count[prev]; i++) {
+        if (u->pages[prev][i] == page) {
+            u->reused_bytes += size;
+            break;
+        }
+    }
+    size_t n = u->count[u->current];
+    for (size_t i = 0; i < n; i++) {
+        if (u->pages[u->current][i] == page) return;
+    }
+    if (n < MAX_TRACKED_PAGES) u->pages[u->current][u->count[u->current]++] = page;
+}
+
+// size bytes that live until the next net_reset(); CAP_NULL if out of memory
+static cap_ptr_t net_alloc(net_alloc_t *a, size_t size) {
+    cap_ptr_t object;
+    switch (a->mode) {
+    case ALLOC_MALLOC:
+        if (a->live_count == a->live_capacity) {
+            size_t capacity = a->live_capacity ? 2 * a->live_capacity : 256;
+            cap_ptr_t *live = realloc(a->live, capacity * sizeof(cap_ptr_t));
+            if (!live) return CAP_NULL;
+            a->live = live;
+            a->live_capacity = capacity;
+        }
+        object = cap_malloc(size ? size : 1);
+        if (cap_is_null(object)) return CAP_NULL;
+        a->live[a->live_count++] = object;
+        break;
+    default:
+        object = region_alloc(&a->region, size);
+        if (cap_is_null(object)) return CAP_NULL;
+        break;
+    }
+    a->allocations++;
+    a->bytes += size;
+    if (a->reuse) reuse_record(a->reuse, object, size);
+    return object;
+}
+
+// End of a lifetime: every object from net_alloc() dies
+static void net_reset(net_alloc_t *a) {
+    switch (a->mode) {
+    case ALLOC_MALLOC:
+        for (size_t i = 0; i < a->live_count; i++) cap_free(a->live[i]);
+        a->live_count = 0;
+        break;
+    default:
+        region_reset(&a->region);
+        break;
+    }
+    if (a->reuse) {
+        a->reuse->current = !a->reuse->current;
+        a->reuse->count[a->reuse->current] = 0;
+    }
+}
+
+static void net_alloc_destroy(net_alloc_t *a) {
+    net_reset(a);
+    free(a->live);
+    region_destroy(&a->region);
+}
+
+// ---------------------------------------------------------------------------
+// Network path
+// ---------------------------------------------------------------------------
+
+static uint64_t handle_request(net_alloc_t *a, packet_t *pkt, const http_request_t *req) {
+    uint64_t digest = req->method_len * 31u + req->num_headers;
+
+    pkt->headers = net_alloc(a, req->num_headers * sizeof(owned_header_t));
+    if (cap_is_null(pkt->headers)) return 0;
+    owned_header_t *headers = cap_check(pkt->headers, 0, req->num_headers * sizeof(owned_header_t));
+    for (size_t h = 0; h < req->num_headers; h++) {
+        const http_header_t *src = &req->headers[h];
+        owned_header_t *dst = &headers[h];
+        dst->name = net_alloc(a, src->name_len);
+        dst->value = net_alloc(a, src->value_len);
+        if (cap_is_null(dst->name) || cap_is_null(dst->value)) return 0;
+        dst->name_len = src->name_len;
+        dst->value_len = src->value_len;
+
+        const char *name = cap_check(src->name, 0, src->name_len);
+        char *lower = cap_check(dst->name, 0, src->name_len);
+        for (uint32_t i = 0; i < src->name_len; i++) {
+            char c = name[i];
+            lower[i] = c >= 'A' && c <= 'Z' ? (char)(c + 'a' - 'A') : c;
+            digest = (digest ^ (unsigned char)lower[i]) * 1099511628211ull;
+        }
+        memcpy(cap_check(dst->value, 0, src->value_len), cap_check(src->value, 0, src->value_len),
+               src->value_len);
+        digest += src->value_len;
+    }
+
+    pkt->path = net_alloc(a, req->path_len + 1);
+    if (cap_is_null(pkt->path)) return 0;
+    char *path = cap_check(pkt->path, 0, req->path_len + 1);
+    memcpy(path, cap_check(req->path, 0, req->path_len), req->path_len);
+    path[req->path_len] = '\0';
+
+    size_t response_size = req->path_len + RESPONSE_RESERVE;
+    pkt->response = net_alloc(a, response_size);
+    if (cap_is_null(pkt->response)) return 0;
+    int n = snprintf(cap_check(pkt->response, 0, response_size), response_size,
+                     "HTTP/1.1 200 OK\r\nServer: net-region\r\nContent-Length: %u\r\nX-Path: %s\r\n\r\n",
+                     req->body_len, path);
+    pkt->response_len = n < 0 ? 0 : (size_t)n < response_size ? (size_t)n : response_size - 1;
+    return digest * 31 + pkt->response_len;
+}
+
+// Full per-packet path; returns the packet's digest, 0 when allocation failed
+static uint64_t process_packet(net_alloc_t *a, const unsigned char *frame, size_t caplen) {
+    cap_ptr_t meta = net_alloc(a, sizeof(packet_t));
+    if (cap_is_null(meta)) return 0;
+    packet_t *pkt = CAP_OBJ(meta, packet_t);
+    memset(pkt, 0, sizeof(*pkt));
+
+    pkt->frame = net_alloc(a, caplen);
+    if (cap_is_null(pkt->frame)) return 0;
+    unsigned char *copy = cap_check(pkt->frame, 0, caplen);
+    memcpy(copy, frame, caplen);
+    pkt->frame_len = caplen;
+
+    size_t payload_off, payload_len;
+    if (pcap_tcp_payload(copy, caplen, &payload_off, &payload_len) != 0 ||
+        !pcap_is_http_request(copy + payload_off, payload_len)) {
+        return caplen + 1;
+    }
+
+    pkt->request = net_alloc(a, sizeof(http_request_t));
+    if (cap_is_null(pkt->request)) return 0;
+    http_request_t *req = CAP_OBJ(pkt->request, http_request_t);
+    cap_ptr_t payload = cap_sub(pkt->frame, payload_off, payload_len);
+    if (http_parse_request(payload, payload_len, req, HTTP_SCAN_SWAR) <= 0) return caplen + 2;
+    return handle_request(a, pkt, req);
+}
+
+// One pass over the trace; returns the combined digest, 0 on allocation failure
+static uint64_t run_trace(net_alloc_t *a, const trace_t *t, size_t reset_every) {
+    const unsigned char *data = cap_check(t->data, 0, t->size);
+    uint64_t digest = 0;
+    for (size_t i = 0; i < t->count; i++) {
+        uint64_t d = process_packet(a, data + t->offsets[i], t->lengths[i]);
+        if (d == 0) return 0;
+        digest = digest * 1099511628211ull + d;
+        if ((i + 1) % reset_every == 0) net_reset(a);
+    }
+    net_reset(a);
+    return digest;
+}
+
+// ---------------------------------------------------------------------------
+// Packet sources
+// ---------------------------------------------------------------------------
+
+static int trace_init(trace_t *t, size_t capacity, size_t max_count) {
+    t->data = cap_malloc(capacity);
+    t->offsets = malloc(max_count * sizeof(size_t));
+    t->lengths = malloc(max_count * sizeof(size_t));
+    t->size = 0;
+    t->capacity = capacity;
+    t->count = 0;
+    t->max_count = max_count;
+    return (cap_is_null(t->data) || !t->offsets || !t->lengths) ? -1 : 0;
+}
+
+static int trace_add(trace_t *t, const unsigned char *frame, size_t len) {
+    if (t->count == t->max_count || len > t->capacity - t->size) return -1;
+    memcpy(cap_check(t->data, t->size, len), frame, len);
+    t->offsets[t->count] = t->size;
+    t->lengths[t->count] = len;
+    t->size += len;
+    t->count++;
+    return 0;
+}
+
+// Mostly requests, plus the bare ACKs that follow them
+static int build_synthetic_trace(trace_t *t, size_t packets) {
+    char *request = malloc(MAX_REQUEST_SIZE);
+    unsigned char *frame = malloc(MAX_FRAME_SIZE);
+    int rc = request && frame && trace_init(t, packets * 2048 + MAX_FRAME_SIZE, packets) == 0 ? 0 : -1;
+
+    for (size_t i = 0; rc == 0 && i < packets; i++) {
+        unsigned port = 1024 + (unsigned)(bench_rng_next(&rng_state) % 60000);
+        size_t len = bench_rng_next(&rng_state) % 4 == 0
+                         ? pcap_build_frame(frame, "", 0, port)
+                         : pcap_build_frame(frame, request, pcap_generate_request(request, MAX_REQUEST_SIZE, &rng_state), port);
+        if (trace_add(t, frame, len) != 0) break;
+    }
+    free(request);
+    free(frame);
+    return rc;
+}
+
+static int build_pcap_trace(trace_t *t, const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    fseek(f, 0, SEEK_END);
+    long file_size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    unsigned char *data = malloc(file_size > 0 ? (size_t)file_size : 1);
+    if (!data || fread(data, 1, (size_t)file_size, f) != (size_t)file_size) {
+        fclose(f);
+        free(data);
+        return -1;
+    }
+    fclose(f);
+
+    pcap_reader_t reader;
+    pcap_record_t rec;
+    if (pcap_open(&reader, data, (size_t)file_size) != 0 ||
+        reader.linktype != PCAP_LINKTYPE_ETHERNET) {
+        fprintf(stderr, "%s: not an Ethernet pcap file\n", path);
+        free(data);
+        return -1;
+    }
+
+    size_t packets = 0;
+    while (pcap_next(&reader, data, (size_t)file_size, &rec)) packets++;
+    if (trace_init(t, (size_t)file_size, packets ? packets : 1) != 0) {
+        free(data);
+        return -1;
+    }
+    pcap_open(&reader, data, (size_t)file_size);
+    while (pcap_next(&reader, data, (size_t)file_size, &rec)) {
+        if (rec.caplen > 0) trace_add(t, rec.frame, rec.caplen);
+    }
+    free(data);
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Benchmark
+// ---------------------------------------------------------------------------
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-p packets] [-f capture.pcap] [-r packets_per_reset] [-c chunk_bytes] "
+                    "[-i iterations]\n", prog);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    size_t packets = DEFAULT_PACKETS;
+    size_t reset_every = DEFAULT_RESET;
+    size_t chunk_size = REGION_DEFAULT_CHUNK;
+    int iterations = DEFAULT_ITERATIONS;
+    const char *pcap_path = NULL;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "p:f:r:c:i:h")) != -1) {
+        switch (opt) {
+        case 'p': packets = (size_t)strtoull(optarg, NULL, 0); break;
+        case 'f': pcap_path = optarg; break;
+        case 'r': reset_every = (size_t)strtoull(optarg, NULL, 0); break;
+        case 'c': chunk_size = (size_t)strtoull(optarg, NULL, 0); break;
+        case 'i': iterations = atoi(optarg); break;
+        default: usage(argv[0]);
+        }
+    }
+    if (packets == 0 || reset_every == 0 || chunk_size < 4096 || iterations <= 0) usage(argv[0]);
+
+    trace_t trace;
+    int rc = pcap_path ? build_pcap_trace(&trace, pcap_path) : build_synthetic_trace(&trace, packets);
+    if (rc != 0 || trace.count == 0) {
+        fprintf(stderr, "No packets to process\n");
+        return 1;
+    }
+
+    bench_print_header("net-region", "PER-REQUEST REGION ALLOCATION WORKLOAD");
+    printf("Packets: %zu (%zu bytes, %s), reset every %zu packet%s, %zu-byte chunks, best of %d\n\n",
+           trace.count, trace.size, pcap_path ? pcap_path : "synthetic", reset_every,
+           reset_every == 1 ? "" : "s", chunk_size, iterations);
+
+    printf("REGION ALLOCATION RESULTS\n");
+    printf("-------------------------------------------\n");
+    double allocs_per_sec[ALLOC_COUNT] = { 0 };
+    uint64_t reference = 0;
+    int failed = 0;
+    char metric[48];
+    for (int m = 0; m < ALLOC_COUNT && !failed; m++) {
+        net_alloc_t alloc;
+        reuse_t reuse;
+        net_alloc_init(&alloc, (alloc_mode_t)m, chunk_size);
+
+        // Counting pass: digest, object counts and page reuse
+        memset(&reuse, 0, sizeof(reuse));
+        alloc.reuse = &reuse;
+        uint64_t digest = run_trace(&alloc, &trace, reset_every);
+        alloc.reuse = NULL;
+        uint64_t allocations = alloc.allocations, bytes = alloc.bytes;
+        if (m == 0) reference = digest;
+        if (digest == 0 || digest != reference) {
+            fprintf(stderr, "%s: digest mismatch or out of memory\n", alloc_names[m]);
+            failed = 1;
+            net_alloc_destroy(&alloc);
+            break;
+        }
+
+        uint64_t fresh_before = alloc.region.fresh_bytes;
+        double best = 0.0;
+        for (int it = 0; it < iterations && !failed; it++) {
+            uint64_t start = bench_now_ns();
+            digest = run_trace(&alloc, &trace, reset_every);
+            double seconds = bench_seconds(start, bench_now_ns());
+            if (digest != reference) {
+                fprintf(stderr, "%s: digest mismatch in timed pass\n", alloc_names[m]);
+                failed = 1;
+            }
+            if (best == 0.0 || seconds < best) best = seconds;
+        }
+        if (failed) {
+            net_alloc_destroy(&alloc);
+            break;
+        }
+
+        if (m == 0) {
+            bench_report("allocs_per_packet", (double)allocations / trace.count, "allocs");
+            bench_report("bytes_per_packet", (double)bytes / trace.count, "bytes");
+        }
+        allocs_per_sec[m] = (double)allocations / best;
+        snprintf(metric, sizeof(metric), "%s_allocs_per_sec", alloc_names[m]);
+        bench_report(metric, allocs_per_sec[m], "allocs/s");
+        snprintf(metric, sizeof(metric), "%s_packets_per_sec", alloc_names[m]);
+        bench_report(metric, (double)trace.count / best, "packets/s");
+        snprintf(metric, sizeof(metric), "%s_page_reuse_pct", alloc_names[m]);
+        bench_report(metric, reuse.bytes ? 100.0 * (double)reuse.reused_bytes / (double)reuse.bytes : 0.0, "%");
+        if (m != ALLOC_MALLOC) {
+            uint64_t fresh = alloc.region.fresh_bytes - fresh_before;
+            snprintf(metric, sizeof(metric), "%s_fresh_bytes_per_packet", alloc_names[m]);
+            bench_report(metric, (double)fresh / ((double)trace.count * iterations), "bytes");
+            snprintf(metric, sizeof(metric), "%s_peak_kb", alloc_names[m]);
+            bench_report(metric, (double)alloc.region.peak_bytes / 1024, "KB");
+            snprintf(metric, sizeof(metric), "%s_speedup_vs_malloc", alloc_names[m]);
+            bench_report(metric, allocs_per_sec[m] / allocs_per_sec[ALLOC_MALLOC], "x");
+        }
+        net_alloc_destroy(&alloc);
+    }
+    bench_report("max_rss_mb", (double)bench_max_rss_bytes() / (1 << 20), "MB");
+    bench_finish();
+
+    cap_free(trace.data);
+    free(trace.offsets);
+    free(trace.lengths);
+    return failed;
+}
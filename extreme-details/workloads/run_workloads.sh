@@ -0,0 +1,110 @@
+#!/bin/bash
+
+# Hosted Workload Runner
+# Runs every built workload variant and collects RESULT lines into one CSV.
+#
+# Usage: run_workloads.sh [variant...]
+#   variants: host host_softcap riscv softcap cheri (default: host host_softcap)
+#
+# Per-workload arguments can be passed through the environment, e.g.
+#   WORKLOAD_ARGS_kv_cache_stress="-k 1000000 -c 16" run_workloads.sh host
+
+set -e
+
+# Colors for output
+RED='\033[0;31m'
+GREEN='\033[0;32m'
+YELLOW='\033[1;33m'
+BLUE='\033[0;34m'
+NC='\033[0m' # No Color
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+PROJECT_ROOT="$(cd "$SCRIPT_DIR/../.." && pwd)"
+TIMESTAMP=$(date +"%Y%m%d_%H%M%S")
+RESULTS_DIR="$PROJECT_ROOT/results/workloads_$TIMESTAMP"
+
+log_info() {
+    echo -e "${BLUE}[INFO]${NC} $1"
+}
+
+log_success() {
+    echo -e "${GREEN}[SUCCESS]${NC} $1"
+}
+
+log_warning() {
+    echo -e "${YELLOW}[WARNING]${NC} $1"
+}
+
+log_error() {
+    echo -e "${RED}[ERROR]${NC} $1"
+}
+
+# Command prefix needed to execute a variant on this machine
+runner_for() {
+    case "$1" in
+        host|host_softcap)
+            echo ""
+            ;;
+        riscv|softcap)
+            if [ "$(uname -m)" = "riscv64" ]; then
+                echo ""
+            elif command -v qemu-riscv64 &> /dev/null; then
+                echo "qemu-riscv64"
+            else
+                return 1
+            fi
+            ;;
+        cheri)
+            # Purecap binaries need a CheriBSD userland (run inside CheriBSD on QEMU-CHERI)
+            if [ "$(uname -s)" = "FreeBSD" ] && [ "$(uname -p)" = "riscv64c" ]; then
+                echo ""
+            else
+                return 1
+            fi
+            ;;
+        *)
+            return 1
+            ;;
+    esac
+}
+
+VARIANTS="$*"
+if [ -z "$VARIANTS" ]; then
+    VARIANTS="host host_softcap"
+fi
+
+mkdir -p "$RESULTS_DIR"
+CSV="$RESULTS_DIR/results.csv"
+echo "workload,model,metric,value,unit,variant" > "$CSV"
+
+log_info "Running hosted workloads: $VARIANTS"
+log_info "Results will be saved to: $RESULTS_DIR"
+
+for source in "$SCRIPT_DIR"/*.c; do
+    prog=$(basename "$source" .c)
+    args_var="WORKLOAD_ARGS_${prog//-/_}"
+    args="${!args_var}"
+
+    for variant in $VARIANTS; do
+        binary="$SCRIPT_DIR/${prog}_${variant}"
+        if [ ! -x "$binary" ]; then
+            log_warning "$prog ($variant) not built - skipping"
+            continue
+        fi
+        if ! runner=$(runner_for "$variant"); then
+            log_warning "No way to execute $variant binaries on this host - skipping $prog"
+            continue
+        fi
+
+        log_info "Running $prog ($variant) $args"
+        log="$RESULTS_DIR/${prog}_${variant}.log"
+        if $runner "$binary" $args > "$log" 2>&1; then
+            log_success "$prog ($variant) completed"
+        else
+            log_error "$prog ($variant) failed - see $log"
+        fi
+        grep '^RESULT,' "$log" | sed -e 's/^RESULT,//' -e "s/\$/,$variant/" >> "$CSV" || true
+    done
+done
+
+log_success "Workload results collected in $CSV"
@@ -0,0 +1,490 @@
+/*
+ * Real-World Application Stress Test - Search Tree Layouts
+ *
+ * Looks up random keys in the same sorted key set stored five ways:
+ *   bst        - balanced binary tree of individually allocated nodes
+ *                linked by capabilities, nodes scattered over the heap
+ *   btree      - bulk-loaded B+tree, 16-way nodes linked by capabilities
+ *   sorted     - plain sorted array, branchless binary search
+ *   eytzinger  - implicit BFS-order array, branchless descent that
+ *                prefetches the cache line holding the next three levels
+ *   veb        - implicit van Emde Boas order (complete tree, padded),
+ *                positions computed from per-depth tables
+ * The linked layouts carry two (bst) or sixteen (btree) capabilities per
+ * node, so the capability build grows their footprint; the implicit
+ * layouts hold keys only and are reached through one capability bounded
+ * to the whole array.
+ *
+ * Keys are the odd numbers 1, 3, ..., 2n-1 and lookups are uniform over
+ * [0, 2n), so about half of them hit; every layout must find the same keys.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "capmodel.h"
+#include "bench.h"
+
+// Benchmark configuration
+#define DEFAULT_SIZES       "1e3,1e4,1e5,1e6,1e7"
+#define DEFAULT_LOOKUPS     4000000
+#define DEFAULT_ITERATIONS  3
+#define MAX_SIZES           16
+#define MAX_HEIGHT          40          // Complete trees up to 2^40 - 1 nodes
+#define BT_FANOUT           16
+#define EYT_PREFETCH        8           // Keys per 64-byte line: 3 levels ahead
+#define LINE_ALIGN          64
+#define PAD_KEY             UINT64_MAX  // vEB padding, above every key
+
+typedef enum {
+    LAYOUT_BST = 0, LAYOUT_BTREE, LAYOUT_SORTED, LAYOUT_EYTZINGER, LAYOUT_VEB, LAYOUT_COUNT
+} layout_t;
+
+static const char *const layout_names[LAYOUT_COUNT] = { "bst", "btree", "sorted", "eytzinger", "veb" };
+
+typedef struct {
+    uint64_t key;
+    cap_ptr_t left, right;
+} bst_node_t;
+
+typedef struct {
+    uint32_t count;                 // Keys in a leaf, children in an inner node
+    uint64_t keys[BT_FANOUT];       // Inner: keys[j] = smallest key under child j
+    cap_ptr_t child[BT_FANOUT];     // Inner nodes only
+} btree_node_t;
+
+typedef struct {
+    uint32_t count;
+    uint64_t keys[BT_FANOUT];
+} btree_leaf_t;
+
+typedef struct {
+    layout_t layout;
+    size_t n;
+    size_t bytes;                   // Footprint of the layout
+
+    // Linked layouts
+    cap_ptr_t root;
+    int height;                     // btree: levels including the leaves
+    cap_ptr_t *nodes;               // Every allocated node, for freeing
+    size_t node_count;
+
+    // Implicit layouts
+    void *memory;                   // Allocation behind keys
+    cap_ptr_t keys;
+    size_t slots;                   // Array entries (eytzinger: n + 1, veb: 2^h - 1)
+    int veb_height;
+    uint64_t veb_top[MAX_HEIGHT];   // Per depth: size of the top tree it hangs below
+    uint64_t veb_bottom[MAX_HEIGHT];// Per depth: size of each bottom tree
+    int veb_parent[MAX_HEIGHT];     // Per depth: depth of that top tree's root
+} tree_t;
+
+static uint64_t rng_state = 0x853C49E6748FEA9Bull;
+
+static inline uint64_t key_at(size_t i) { return 2 * (uint64_t)i + 1; }
+
+static cap_ptr_t alloc_lines(tree_t *t, size_t bytes) {
+    if (posix_memalign(&t->memory, LINE_ALIGN, bytes) != 0) {
+        t->memory = NULL;
+        return CAP_NULL;
+    }
+    t->bytes = bytes;
+    return cap_make(t->memory, bytes);
+}
+
+// ---------------------------------------------------------------------------
+// Linked layouts
+// ---------------------------------------------------------------------------
+
+static cap_ptr_t bst_link(cap_ptr_t *nodes, size_t lo, size_t hi) {
+    if (lo >= hi) return CAP_NULL;
+    size_t mid = lo + (hi - lo) / 2;
+    bst_node_t *node = CAP_OBJ(nodes[mid], bst_node_t);
+    node->key = key_at(mid);
+    node->left = bst_link(nodes, lo, mid);
+    node->right = bst_link(nodes, mid + 1, hi);
+    return nodes[mid];
+}
+
+// Nodes are allocated in one go, then shuffled, as if the tree had grown
+// alongside other allocations: neighbours in the tree are far apart in memory
+static int build_bst(tree_t *t) {
+    t->nodes = malloc(t->n * sizeof(cap_ptr_t));
+    if (!t->nodes) return -1;
+    for (size_t i = 0; i < t->n; i++) {
+        t->nodes[i] = cap_malloc(sizeof(bst_node_t));
+        if (cap_is_null(t->nodes[i])) return -1;
+        t->node_count++;
+    }
+    for (size_t i = t->n - 1; i > 0; i--) {
+        size_t j = (size_t)(bench_rng_next(&rng_state) % (i + 1));
+        cap_ptr_t tmp = t->nodes[i];
+        t->nodes[i] = t->nodes[j];
+        t->nodes[j] = tmp;
+    }
+    t->root = bst_link(t->nodes, 0, t->n);
+    t->bytes = t->n * sizeof(bst_node_t);
+    return 0;
+}
+
+static size_t bst_lookups(const tree_t *t, const uint64_t *queries, size_t count) {
+    size_t hits = 0;
+    for (size_t q = 0; q < count; q++) {
+        uint64_t x = queries[q];
+        cap_ptr_t p = t->root;
+        while (!cap_is_null(p)) {
+            const bst_node_t *node = CAP_OBJ(p, bst_node_t);
+            if (node->key == x) {
+                hits++;
+                break;
+            }
+            p = x < node->key ? node->left : node->right;
+        }
+    }
+    return hits;
+}
+
+// Bottom-up bulk load: full leaves left to right, then each inner level
+static int build_btree(tree_t *t) {
+    size_t leaves = (t->n + BT_FANOUT - 1) / BT_FANOUT;
+    size_t total = leaves, width = leaves;
+    while (width > 1) {
+        width = (width + BT_FANOUT - 1) / BT_FANOUT;
+        total += width;
+    }
+    t->nodes = malloc(total * sizeof(cap_ptr_t));
+    uint64_t *low = malloc(leaves * sizeof(uint64_t));   // Smallest key per node of a level
+    if (!t->nodes || !low) {
+        free(low);
+        return -1;
+    }
+
+    size_t level_start = 0;
+    for (size_t l = 0; l < leaves; l++) {
+        cap_ptr_t cap = cap_malloc(sizeof(btree_leaf_t));
+        if (cap_is_null(cap)) {
+            free(low);
+            return -1;
+        }
+        btree_leaf_t *leaf = CAP_OBJ(cap, btree_leaf_t);
+        size_t first = l * BT_FANOUT;
+        leaf->count = (uint32_t)(t->n - first < BT_FANOUT ? t->n - first : BT_FANOUT);
+        for (uint32_t k = 0; k < leaf->count; k++) leaf->keys[k] = key_at(first + k);
+        low[l] = leaf->keys[0];
+        t->nodes[t->node_count++] = cap;
+    }
+    t->bytes = leaves * sizeof(btree_leaf_t);
+    t->height = 1;
+
+    for (width = leaves; width > 1; t->height++) {
+        size_t parents = (width + BT_FANOUT - 1) / BT_FANOUT;
+        size_t parent_start = t->node_count;
+        for (size_t p = 0; p < parents; p++) {
+            cap_ptr_t cap = cap_malloc(sizeof(btree_node_t));
+            if (cap_is_null(cap)) {
+                free(low);
+                return -1;
+            }
+            btree_node_t *node = CAP_OBJ(cap, btree_node_t);
+            size_t first = p * BT_FANOUT;
+            node->count = (uint32_t)(width - first < BT_FANOUT ? width - first : BT_FANOUT);
+            for (uint32_t c = 0; c < node->count; c++) {
+                node->keys[c] = low[first + c];
+                node->child[c] = t->nodes[level_start + first + c];
+            }
+            low[p] = node->keys[0];
+            t->nodes[t->node_count++] = cap;
+        }
+        t->bytes += parents * sizeof(btree_node_t);
+        level_start = parent_start;
+        width = parents;
+    }
+    t->root = t->nodes[t->node_count - 1];
+    free(low);
+    return 0;
+}
+
+static size_t btree_lookups(const tree_t *t, const uint64_t *queries, size_t count) {
+    size_t hits = 0;
+    for (size_t q = 0; q < count; q++) {
+        uint64_t x = queries[q];
+        cap_ptr_t p = t->root;
+        for (int level = t->height - 1; level > 0; level--) {
+            const btree_node_t *node = CAP_OBJ(p, btree_node_t);
+            uint32_t c = 0;
+            for (uint32_t k = 1; k < node->count; k++) c += node->keys[k] <= x;
+            p = node->child[c];
+        }
+        const btree_leaf_t *leaf = CAP_OBJ(p, btree_leaf_t);
+        int found = 0;
+        for (uint32_t k = 0; k < leaf->count; k++) found |= leaf->keys[k] == x;
+        hits += (size_t)found;
+    }
+    return hits;
+}
+
+// ---------------------------------------------------------------------------
+// Implicit layouts
+// ---------------------------------------------------------------------------
+
+static int build_sorted(tree_t *t) {
+    t->slots = t->n;
+    t->keys = alloc_lines(t, t->slots * sizeof(uint64_t));
+    if (cap_is_null(t->keys)) return -1;
+    uint64_t *a = (uint64_t *)cap_check(t->keys, 0, t->bytes);
+    for (size_t i = 0; i < t->n; i++) a[i] = key_at(i);
+    return 0;
+}
+
+static size_t sorted_lookups(const tree_t *t, const uint64_t *queries, size_t count) {
+    const uint64_t *a = (const uint64_t *)cap_check(t->keys, 0, t->bytes);
+    size_t hits = 0;
+    for (size_t q = 0; q < count; q++) {
+        uint64_t x = queries[q];
+        const uint64_t *base = a;
+        size_t len = t->n;
+        while (len > 1) {
+            size_t half = len / 2;
+            base = base[half - 1] < x ? base + half : base;
+            len -= half;
+        }
+        hits += *base == x;
+    }
+    return hits;
+}
+
+// In-order walk of the implicit tree assigns the sorted keys
+static size_t eytzinger_fill(uint64_t *b, size_t n, size_t k, size_t i) {
+    if (k <= n) {
+        i = eytzinger_fill(b, n, 2 * k, i);
+        b[k] = key_at(i++);
+        i = eytzinger_fill(b, n, 2 * k + 1, i);
+    }
+    return i;
+}
+
+static int build_eytzinger(tree_t *t) {
+    t->slots = t->n + 1;   // 1-based: node k has children 2k and 2k+1
+    t->keys = alloc_lines(t, t->slots * sizeof(uint64_t));
+    if (cap_is_null(t->keys)) return -1;
+    uint64_t *b = (uint64_t *)cap_check(t->keys, 0, t->bytes);
+    b[0] = 0;
+    eytzinger_fill(b, t->n, 1, 0);
+    return 0;
+}
+
+static size_t eytzinger_lookups(const tree_t *t, const uint64_t *queries, size_t count) {
+    const uint64_t *b = (const uint64_t *)cap_check(t->keys, 0, t->bytes);
+    size_t n = t->n, hits = 0;
+    for (size_t q = 0; q < count; q++) {
+        uint64_t x = queries[q];
+        size_t k = 1;
+        while (k <= n) {
+            // Descendants 3 levels down share one line; stay inside the array
+            size_t ahead = EYT_PREFETCH * k;
+            __builtin_prefetch(b + (ahead <= n ? ahead : 0));
+            k = 2 * k + (b[k] < x);
+        }
+        k >>= __builtin_ffsll((long long)~k);   // Undo the right turns past the answer
+        hits += k != 0 && b[k] == x;
+    }
+    return hits;
+}
+
+// Split every subtree of height h into a top tree of h/2 levels and the
+// bottom trees below it; record, for the depth each bottom tree starts at,
+// where its subtrees lie relative to the enclosing top tree's root
+static void veb_tables(tree_t *t, int depth, int h) {
+    if (h <= 1) return;
+    int top = h / 2, bottom = h - top;
+    t->veb_top[depth + top] = (1ull << top) - 1;
+    t->veb_bottom[depth + top] = (1ull << bottom) - 1;
+    t->veb_parent[depth + top] = depth;
+    veb_tables(t, depth, top);
+    veb_tables(t, depth + top, bottom);
+}
+
+// Place the subtree rooted at BFS index r (height h) starting at pos
+static void veb_place(uint64_t *out, const uint64_t *bfs, uint64_t r, int h, uint64_t pos) {
+    if (h == 1) {
+        out[pos] = bfs[r];
+        return;
+    }
+    int top = h / 2, bottom = h - top;
+    uint64_t top_size = (1ull << top) - 1, bottom_size = (1ull << bottom) - 1;
+    veb_place(out, bfs, r, top, pos);
+    for (uint64_t j = 0; j <= top_size; j++) {
+        veb_place(out, bfs, (r << top) + j, bottom, pos + top_size + j * bottom_size);
+    }
+}
+
+static size_t bfs_fill(uint64_t *b, size_t n, size_t slots, size_t k, size_t i) {
+    if (k <= slots) {
+        i = bfs_fill(b, n, slots, 2 * k, i);
+        b[k] = i < n ? key_at(i) : PAD_KEY;
+        i++;
+        i = bfs_fill(b, n, slots, 2 * k + 1, i);
+    }
+    return i;
+}
+
+static int build_veb(tree_t *t) {
+    int h = 1;
+    while (h < MAX_HEIGHT && ((1ull << h) - 1) < t->n) h++;
+    t->veb_height = h;
+    t->slots = (size_t)((1ull << h) - 1);
+    veb_tables(t, 0, h);
+
+    // Lay the padded complete tree out in BFS order first, then permute
+    uint64_t *bfs = malloc((t->slots + 1) * sizeof(uint64_t));
+    t->keys = alloc_lines(t, t->slots * sizeof(uint64_t));
+    if (!bfs || cap_is_null(t->keys)) {
+        free(bfs);
+        return -1;
+    }
+    bfs_fill(bfs, t->n, t->slots, 1, 0);
+    veb_place((uint64_t *)cap_check(t->keys, 0, t->bytes), bfs, 1, h, 0);
+    free(bfs);
+    return 0;
+}
+
+static size_t veb_lookups(const tree_t *t, const uint64_t *queries, size_t count) {
+    const uint64_t *v = (const uint64_t *)cap_check(t->keys, 0, t->bytes);
+    int h = t->veb_height;
+    size_t hits = 0;
+    uint64_t pos[MAX_HEIGHT];
+    for (size_t q = 0; q < count; q++) {
+        uint64_t x = queries[q];
+        uint64_t i = 1, candidate = PAD_KEY;
+        pos[0] = 0;
+        for (int d = 0; d < h; d++) {
+            if (d > 0) pos[d] = pos[t->veb_parent[d]] + t->veb_top[d] + (i & t->veb_top[d]) * t->veb_bottom[d];
+            uint64_t key = v[pos[d]];
+            candidate = key >= x ? key : candidate;   // Smallest key >= x on the path
+            i = 2 * i + (key < x);
+        }
+        hits += candidate == x;
+    }
+    return hits;
+}
+
+// ---------------------------------------------------------------------------
+// Benchmark
+// ---------------------------------------------------------------------------
+
+static int build(tree_t *t, layout_t layout, size_t n) {
+    memset(t, 0, sizeof(*t));
+    t->layout = layout;
+    t->n = n;
+    switch (layout) {
+    case LAYOUT_BST: return build_bst(t);
+    case LAYOUT_BTREE: return build_btree(t);
+    case LAYOUT_SORTED: return build_sorted(t);
+    case LAYOUT_EYTZINGER: return build_eytzinger(t);
+    default: return build_veb(t);
+    }
+}
+
+static size_t lookups(const tree_t *t, const uint64_t *queries, size_t count) {
+    switch (t->layout) {
+    case LAYOUT_BST: return bst_lookups(t, queries, count);
+    case LAYOUT_BTREE: return btree_lookups(t, queries, count);
+    case LAYOUT_SORTED: return sorted_lookups(t, queries, count);
+    case LAYOUT_EYTZINGER: return eytzinger_lookups(t, queries, count);
+    default: return veb_lookups(t, queries, count);
+    }
+}
+
+static void destroy(tree_t *t) {
+    for (size_t i = 0; i < t->node_count; i++) cap_free(t->nodes[i]);
+    free(t->nodes);
+    free(t->memory);
+    memset(t, 0, sizeof(*t));
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-n keys[,keys...]] [-l lookups] [-i iterations]\n", prog);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    const char *size_list = DEFAULT_SIZES;
+    size_t lookup_count = DEFAULT_LOOKUPS;
+    int iterations = DEFAULT_ITERATIONS;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:l:i:h")) != -1) {
+        switch (opt) {
+        case 'n': size_list = optarg; break;
+        case 'l': lookup_count = (size_t)strtod(optarg, NULL); break;
+        case 'i': iterations = atoi(optarg); break;
+        default: usage(argv[0]);
+        }
+    }
+    size_t sizes[MAX_SIZES];
+    int size_count = bench_parse_sizes(size_list, sizes, MAX_SIZES, 1e11);
+    uint64_t *queries = lookup_count ? malloc(lookup_count * sizeof(uint64_t)) : NULL;
+    if (size_count <= 0 || lookup_count == 0 || iterations <= 0) usage(argv[0]);
+    if (!queries) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    bench_print_header("search-tree", "SEARCH TREE LAYOUT WORKLOAD");
+    printf("%zu random lookups per run, best of %d; node bytes bst=%zu btree=%zu/%zu (inner/leaf)\n\n",
+           lookup_count, iterations, sizeof(bst_node_t), sizeof(btree_node_t), sizeof(btree_leaf_t));
+
+    printf("SEARCH TREE RESULTS\n");
+    printf("-------------------------------------------\n");
+    int failed = 0;
+    char metric[48];
+    for (int s = 0; s < size_count && !failed; s++) {
+        size_t n = sizes[s], expected = 0;
+        for (size_t q = 0; q < lookup_count; q++) {
+            queries[q] = bench_rng_next(&rng_state) % (2 * (uint64_t)n);
+            expected += queries[q] & 1;
+        }
+
+        double bst_rate = 0.0;
+        for (int l = 0; l < LAYOUT_COUNT; l++) {
+            tree_t tree;
+            if (build(&tree, (layout_t)l, n) != 0) {
+                fprintf(stderr, "Out of memory building %s with %zu keys\n", layout_names[l], n);
+                destroy(&tree);
+                failed = 1;
+                break;
+            }
+
+            double best = 0.0;
+            for (int it = 0; it < iterations; it++) {
+                uint64_t start = bench_now_ns();
+                size_t hits = lookups(&tree, queries, lookup_count);
+                double seconds = bench_seconds(start, bench_now_ns());
+                if (hits != expected) {
+                    fprintf(stderr, "%s with %zu keys found %zu of %zu keys\n", layout_names[l], n, hits, expected);
+                    failed = 1;
+                }
+                if ((double)lookup_count / seconds > best) best = (double)lookup_count / seconds;
+            }
+
+            snprintf(metric, sizeof(metric), "%zu_%s_lookups_per_sec", n, layout_names[l]);
+            bench_report(metric, best, "lookups/s");
+            snprintf(metric, sizeof(metric), "%zu_%s_bytes_per_key", n, layout_names[l]);
+            bench_report(metric, (double)tree.bytes / (double)n, "bytes");
+            if (l == LAYOUT_BST) {
+                bst_rate = best;
+            } else {
+                snprintf(metric, sizeof(metric), "%zu_%s_speedup_vs_bst", n, layout_names[l]);
+                bench_report(metric, best / bst_rate, "x");
+            }
+            destroy(&tree);
+        }
+    }
+    bench_report("max_rss_mb", (double)bench_max_rss_bytes() / (1 << 20), "MB");
+    bench_finish();
+    free(queries);
+    return failed;
+}
@@ -0,0 +1,261 @@
+/*
+ * Real-World Application Stress Test - Sorting
+ *
+ * Sorts the same keys in three layouts:
+ *   ptr     - array of capabilities to records, ordered by the pointee key
+ *             (each capability is bounded to its record)
+ *   idx     - array of 32-bit indices into the record array
+ *   record  - the 16-byte records themselves, inline
+ * with pdqsort, LSD radix sort and a parallel sample sort
+ * (common/sort_template.h). Pointer-array sorts move cap_ptr_t-sized
+ * elements, so the capability build moves twice the bytes of the pointer
+ * build; bytes moved are measured with a move-counting instantiation.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "capmodel.h"
+#include "bench.h"
+
+typedef struct {
+    uint64_t key;
+    uint64_t value;
+} record_t;
+
+// Timed instantiations
+#define SORT_T cap_ptr_t
+#define SORT_KEY(ctx, e) (CAP_OBJ((e), record_t)->key)
+#define SORT_NAME(x) ptr_##x
+#include "sort_template.h"
+
+#define SORT_T uint32_t
+#define SORT_KEY(ctx, e) (CAP_AT((ctx)->base, record_t, (e)).key)
+#define SORT_NAME(x) idx_##x
+#include "sort_template.h"
+
+#define SORT_T record_t
+#define SORT_KEY(ctx, e) ((e).key)
+#define SORT_NAME(x) rec_##x
+#include "sort_template.h"
+
+// Move-counting instantiations (bytes moved, never timed)
+#define SORT_T cap_ptr_t
+#define SORT_KEY(ctx, e) (CAP_OBJ((e), record_t)->key)
+#define SORT_NAME(x) ptr_counted_##x
+#define SORT_COUNT_MOVES
+#include "sort_template.h"
+
+#define SORT_T uint32_t
+#define SORT_KEY(ctx, e) (CAP_AT((ctx)->base, record_t, (e)).key)
+#define SORT_NAME(x) idx_counted_##x
+#define SORT_COUNT_MOVES
+#include "sort_template.h"
+
+#define SORT_T record_t
+#define SORT_KEY(ctx, e) ((e).key)
+#define SORT_NAME(x) rec_counted_##x
+#define SORT_COUNT_MOVES
+#include "sort_template.h"
+
+// Benchmark configuration
+#define DEFAULT_SIZES       "1000,100000,1000000"
+#define MIN_ELEMENTS_TIMED  4000000   // Repeat small sorts until this many elements
+
+typedef enum { LAYOUT_PTR = 0, LAYOUT_IDX, LAYOUT_REC, LAYOUT_COUNT } layout_t;
+typedef enum { ALGO_PDQ = 0, ALGO_RADIX, ALGO_SAMPLE, ALGO_COUNT } algo_t;
+typedef enum { DIST_RANDOM = 0, DIST_SORTED, DIST_REVERSED, DIST_DUPLICATES } dist_t;
+
+// Each size reports elems_per_sec and bytes_moved for every layout/algorithm pair
+#define MAX_SIZES (BENCH_MAX_RESULTS / (2 * LAYOUT_COUNT * ALGO_COUNT))
+
+static const char *const layout_names[LAYOUT_COUNT] = { "ptr", "idx", "record" };
+static const char *const algo_names[ALGO_COUNT] = { "pdq", "radix", "sample" };
+static const char *const dist_names[] = { "random", "sorted", "reversed", "dups" };
+
+static const size_t element_size[LAYOUT_COUNT] = {
+    sizeof(cap_ptr_t), sizeof(uint32_t), sizeof(record_t),
+};
+
+static uint64_t rng_state = 0x853C49E6748FEA9Bull;
+
+typedef struct {
+    size_t n;
+    int threads;
+    cap_ptr_t records;      // record_t[n], pointees of the ptr and idx layouts
+    void *pristine[LAYOUT_COUNT];
+    void *work;             // Sized for the largest element type
+    void *tmp;
+} sort_input_t;
+
+static void run_sort(sort_input_t *in, layout_t layout, algo_t algo, int counted, sort_ctx_t *ctx) {
+    size_t n = in->n;
+    int t = in->threads;
+#define DISPATCH(prefix, type)                                                          \
+    do {                                                                                \
+        type *a = in->work, *tmp = in->tmp;                                             \
+        if (algo == ALGO_PDQ) prefix##pdqsort(a, n, ctx);                               \
+        else if (algo == ALGO_RADIX) prefix##radix(a, tmp, n, ctx);                     \
+        else prefix##sample(a, tmp, n, ctx, t);                                         \
+    } while (0)
+    switch (layout) {
+    case LAYOUT_PTR:
+        if (counted) DISPATCH(ptr_counted_, cap_ptr_t); else DISPATCH(ptr_, cap_ptr_t);
+        break;
+    case LAYOUT_IDX:
+        if (counted) DISPATCH(idx_counted_, uint32_t); else DISPATCH(idx_, uint32_t);
+        break;
+    default:
+        if (counted) DISPATCH(rec_counted_, record_t); else DISPATCH(rec_, record_t);
+        break;
+    }
+#undef DISPATCH
+}
+
+static uint64_t element_key(const sort_input_t *in, layout_t layout, size_t i) {
+    switch (layout) {
+    case LAYOUT_PTR: return CAP_OBJ(((cap_ptr_t *)in->work)[i], record_t)->key;
+    case LAYOUT_IDX: return CAP_AT(in->records, record_t, ((uint32_t *)in->work)[i]).key;
+    default: return ((record_t *)in->work)[i].key;
+    }
+}
+
+// Sorted, and still a permutation of the original values
+static int verify(const sort_input_t *in, layout_t layout, uint64_t expected_sum) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < in->n; i++) {
+        if (i > 0 && element_key(in, layout, i - 1) > element_key(in, layout, i)) return 0;
+        switch (layout) {
+        case LAYOUT_PTR: sum += CAP_OBJ(((cap_ptr_t *)in->work)[i], record_t)->value; break;
+        case LAYOUT_IDX: sum += ((uint32_t *)in->work)[i]; break;
+        default: sum += ((record_t *)in->work)[i].value; break;
+        }
+    }
+    return sum == expected_sum;
+}
+
+static int prepare_input(sort_input_t *in, size_t n, dist_t dist) {
+    in->n = n;
+    in->records = cap_malloc(n * sizeof(record_t));
+    for (int l = 0; l < LAYOUT_COUNT; l++) in->pristine[l] = malloc(n * element_size[l]);
+    in->work = malloc(n * sizeof(record_t));
+    in->tmp = malloc(n * sizeof(record_t));
+    if (cap_is_null(in->records) || !in->pristine[LAYOUT_PTR] || !in->pristine[LAYOUT_IDX] ||
+        !in->pristine[LAYOUT_REC] || !in->work || !in->tmp) {
+        return -1;
+    }
+
+    record_t *records = (record_t *)cap_check(in->records, 0, n * sizeof(record_t));
+    for (size_t i = 0; i < n; i++) {
+        uint64_t key;
+        switch (dist) {
+        case DIST_SORTED: key = i * 0x9E37ull; break;
+        case DIST_REVERSED: key = (n - i) * 0x9E37ull; break;
+        case DIST_DUPLICATES: key = bench_rng_next(&rng_state) % 64; break;
+        default: key = bench_rng_next(&rng_state); break;
+        }
+        records[i].key = key;
+        records[i].value = i;
+        // Each pointer is bounded to exactly its record
+        ((cap_ptr_t *)in->pristine[LAYOUT_PTR])[i] = cap_sub(in->records, i * sizeof(record_t), sizeof(record_t));
+        ((uint32_t *)in->pristine[LAYOUT_IDX])[i] = (uint32_t)i;
+    }
+    memcpy(in->pristine[LAYOUT_REC], records, n * sizeof(record_t));
+    return 0;
+}
+
+static void free_input(sort_input_t *in) {
+    cap_free(in->records);
+    for (int l = 0; l < LAYOUT_COUNT; l++) free(in->pristine[l]);
+    free(in->work);
+    free(in->tmp);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-n size[,size...]] [-t threads] [-d random|sorted|reversed|dups]\n", prog);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    const char *size_list = DEFAULT_SIZES;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = cpus > 0 ? (int)cpus : 4;
+    dist_t dist = DIST_RANDOM;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:t:d:h")) != -1) {
+        switch (opt) {
+        case 'n': size_list = optarg; break;
+        case 't': threads = atoi(optarg); break;
+        case 'd':
+            for (dist = DIST_RANDOM; dist <= DIST_DUPLICATES; dist++) {
+                if (strcmp(optarg, dist_names[dist]) == 0) break;
+            }
+            if (dist > DIST_DUPLICATES) usage(argv[0]);
+            break;
+        default: usage(argv[0]);
+        }
+    }
+    size_t sizes[MAX_SIZES];
+    int size_count = bench_parse_sizes(size_list, sizes, MAX_SIZES, 4e9);
+    if (size_count <= 0 || threads <= 0 || threads > SORT_MAX_THREADS) usage(argv[0]);
+
+    bench_print_header("sort", "SORTING WORKLOAD");
+    printf("Keys: %s, %d sample-sort threads; element bytes ptr=%zu idx=%zu record=%zu\n\n",
+           dist_names[dist], threads, element_size[LAYOUT_PTR], element_size[LAYOUT_IDX],
+           element_size[LAYOUT_REC]);
+
+    printf("SORT RESULTS\n");
+    printf("-------------------------------------------\n");
+    int failed = 0;
+    char metric[48];
+    for (int s = 0; s < size_count; s++) {
+        sort_input_t in;
+        memset(&in, 0, sizeof(in));
+        in.threads = threads;
+        if (prepare_input(&in, sizes[s], dist) != 0) {
+            fprintf(stderr, "Out of memory for %zu elements\n", sizes[s]);
+            free_input(&in);
+            failed = 1;
+            break;
+        }
+        size_t n = in.n;
+        uint64_t value_sum = (uint64_t)n * (n - 1) / 2;
+        size_t reps = MIN_ELEMENTS_TIMED / n > 0 ? MIN_ELEMENTS_TIMED / n : 1;
+        sort_ctx_t ctx = { in.records, 0 };
+
+        for (int l = 0; l < LAYOUT_COUNT; l++) {
+            for (int a = 0; a < ALGO_COUNT; a++) {
+                // Moves counted once, then timed on fresh copies of the input
+                memcpy(in.work, in.pristine[l], n * element_size[l]);
+                ctx.moved = 0;
+                run_sort(&in, (layout_t)l, (algo_t)a, 1, &ctx);
+                if (!verify(&in, (layout_t)l, value_sum)) {
+                    fprintf(stderr, "%s %s sort of %zu elements is wrong\n", layout_names[l], algo_names[a], n);
+                    failed = 1;
+                }
+                double bytes_moved = (double)ctx.moved * (double)element_size[l];
+
+                uint64_t elapsed = 0;
+                for (size_t r = 0; r < reps; r++) {
+                    memcpy(in.work, in.pristine[l], n * element_size[l]);
+                    uint64_t start = bench_now_ns();
+                    run_sort(&in, (layout_t)l, (algo_t)a, 0, &ctx);
+                    elapsed += bench_now_ns() - start;
+                }
+                double seconds = (double)elapsed / 1e9;
+
+                snprintf(metric, sizeof(metric), "%zu_%s_%s_elems_per_sec", n, layout_names[l], algo_names[a]);
+                bench_report(metric, (double)n * (double)reps / seconds, "elem/s");
+                snprintf(metric, sizeof(metric), "%zu_%s_%s_bytes_moved", n, layout_names[l], algo_names[a]);
+                bench_report(metric, bytes_moved, "bytes");
+            }
+        }
+        free_input(&in);
+    }
+    bench_finish();
+    return failed;
+}
@@ -0,0 +1,586 @@
+/*
+ * Real-World Application Stress Test - Sparse Matrix-Vector Multiply
+ *
+ * y = A*x over the same matrix in four storage layouts:
+ *   csr64   - 64-bit row offsets and 64-bit column indices (size_t codes)
+ *   csr32   - 32-bit row offsets and 32-bit column indices
+ *   csr16   - 32-bit row offsets, column indices delta-coded as int16 from
+ *             the previous column (escape + full 32-bit index when a gap
+ *             does not fit)
+ *   rowptr  - legacy `double **` / `int **` code: per-row capabilities to the row's
+ *             values and column indices plus a row length array, so every
+ *             row costs two capabilities of metadata
+ * Row views are carved from contiguous storage, so the layouts differ only
+ * in index and row metadata. Each layout runs serially and multithreaded
+ * (rows partitioned by nonzeros); achieved bandwidth is compared against a
+ * STREAM triad measured in the same process.
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "capmodel.h"
+#include "bench.h"
+
+// Benchmark configuration
+#define DEFAULT_GRID        96          // 27-point stencil on a grid^3 cube
+#define DEFAULT_ROWS        (1 << 20)   // Power-law matrix rows
+#define DEFAULT_ROW_NNZ     16          // Power-law mean nonzeros per row
+#define DEFAULT_ITERATIONS  20
+#define LOCAL_WINDOW        2048        // Power-law columns near the diagonal
+#define LOCAL_PERCENT       85
+#define ROW_BLOCK           64          // Thread partitions start on a block
+#define STREAM_BYTES        (96u << 20) // Triad working set
+#define STREAM_REPS         5
+#define CSR16_ESCAPE        INT16_MIN
+
+typedef enum { LAYOUT_CSR64 = 0, LAYOUT_CSR32, LAYOUT_CSR16, LAYOUT_ROWPTR, LAYOUT_COUNT } layout_t;
+
+static const char *const layout_names[LAYOUT_COUNT] = { "csr64", "csr32", "csr16", "rowptr" };
+
+typedef struct {
+    const char *name;
+    uint32_t rows;              // Square: rows == columns
+    size_t nnz;
+    cap_ptr_t values;           // double[nnz], shared by every layout
+
+    // csr64
+    cap_ptr_t row64;            // uint64_t[rows + 1]
+    cap_ptr_t col64;            // uint64_t[nnz]
+    // csr32 (row32 is also the value offset for csr16)
+    cap_ptr_t row32;            // uint32_t[rows + 1]
+    cap_ptr_t col32;            // uint32_t[nnz]
+    // csr16
+    cap_ptr_t stream16;         // int16_t[stream_len]
+    size_t stream_len;
+    cap_ptr_t block16;          // uint32_t[rows / ROW_BLOCK + 1], stream offset per row block
+    size_t escapes;
+    // rowptr
+    cap_ptr_t row_values;       // cap_ptr_t[rows], each bounded to the row's values
+    cap_ptr_t row_cols;         // cap_ptr_t[rows], each bounded to the row's uint32_t columns
+    cap_ptr_t row_len;          // uint32_t[rows]
+
+    size_t metadata_bytes[LAYOUT_COUNT];   // Row metadata + column indices
+} matrix_t;
+
+static uint64_t rng_state = 0x853C49E6748FEA9Bull;
+
+// ---------------------------------------------------------------------------
+// Matrix generation (csr32 is built first, the other layouts derive from it)
+// ---------------------------------------------------------------------------
+
+static int alloc_csr32(matrix_t *m, uint32_t rows, size_t nnz) {
+    m->rows = rows;
+    m->nnz = nnz;
+    m->row32 = cap_malloc(((size_t)rows + 1) * sizeof(uint32_t));
+    m->col32 = cap_malloc(nnz * sizeof(uint32_t));
+    m->values = cap_malloc(nnz * sizeof(double));
+    return cap_is_null(m->row32) || cap_is_null(m->col32) || cap_is_null(m->values) ? -1 : 0;
+}
+
+// HPCG-style 27-point stencil: 26 on the diagonal, -1 for every neighbor
+static int generate_stencil(matrix_t *m, uint32_t grid) {
+    uint32_t rows = grid * grid * grid;
+    if (alloc_csr32(m, rows, (size_t)rows * 27) != 0) return -1;
+    uint32_t *row = (uint32_t *)cap_check(m->row32, 0, ((size_t)rows + 1) * sizeof(uint32_t));
+    uint32_t *col = (uint32_t *)cap_check(m->col32, 0, m->nnz * sizeof(uint32_t));
+    double *val = (double *)cap_check(m->values, 0, m->nnz * sizeof(double));
+
+    size_t k = 0;
+    for (uint32_t z = 0; z < grid; z++) {
+        for (uint32_t y = 0; y < grid; y++) {
+            for (uint32_t x = 0; x < grid; x++) {
+                uint32_t r = (z * grid + y) * grid + x;
+                row[r] = (uint32_t)k;
+                for (int dz = -1; dz <= 1; dz++) {
+                    for (int dy = -1; dy <= 1; dy++) {
+                        for (int dx = -1; dx <= 1; dx++) {
+                            int64_t nx = (int64_t)x + dx, ny = (int64_t)y + dy, nz = (int64_t)z + dz;
+                            if (nx < 0 || ny < 0 || nz < 0 || nx >= grid || ny >= grid || nz >= grid) continue;
+                            col[k] = (uint32_t)((nz * grid + ny) * grid + nx);
+                            val[k] = col[k] == r ? 26.0 : -1.0;
+                            k++;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    row[rows] = (uint32_t)k;
+    m->nnz = k;   // Boundary rows are shorter
+    return 0;
+}
+
+static int compare_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Skewed row lengths; most columns near the diagonal (as after a bandwidth-
+// reducing reordering), the rest anywhere. Duplicates within a row are kept.
+static int generate_powerlaw(matrix_t *m, uint32_t rows, int mean) {
+    uint32_t *lengths = malloc((size_t)rows * sizeof(uint32_t));
+    if (!lengths) return -1;
+    size_t nnz = 0;
+    for (uint32_t r = 0; r < rows; r++) {
+        // 1/u tail truncated at 50x; E[min(1/u, 50)] = 1 + ln 50
+        double u = ((double)(bench_rng_next(&rng_state) >> 11) + 1.0) / 9007199254740992.0;
+        double tail = u < 0.02 ? 50.0 : 1.0 / u;
+        lengths[r] = 1 + (uint32_t)((double)(mean - 1) * tail / 4.912);
+        nnz += lengths[r];
+    }
+    if (nnz >= UINT32_MAX) {
+        free(lengths);
+        return -1;
+    }
+    if (alloc_csr32(m, rows, nnz) != 0) {
+        free(lengths);
+        return -1;
+    }
+    uint32_t *row = (uint32_t *)cap_check(m->row32, 0, ((size_t)rows + 1) * sizeof(uint32_t));
+    uint32_t *col = (uint32_t *)cap_check(m->col32, 0, nnz * sizeof(uint32_t));
+    double *val = (double *)cap_check(m->values, 0, nnz * sizeof(double));
+
+    size_t k = 0;
+    for (uint32_t r = 0; r < rows; r++) {
+        row[r] = (uint32_t)k;
+        for (uint32_t j = 0; j < lengths[r]; j++) {
+            int64_t c;
+            if (bench_rng_next(&rng_state) % 100 < LOCAL_PERCENT) {
+                c = (int64_t)r + (int64_t)(bench_rng_next(&rng_state) % (2 * LOCAL_WINDOW + 1)) - LOCAL_WINDOW;
+                if (c < 0 || c >= rows) c = (int64_t)(bench_rng_next(&rng_state) % rows);
+            } else {
+                c = (int64_t)(bench_rng_next(&rng_state) % rows);
+            }
+            col[k + j] = (uint32_t)c;
+            val[k + j] = (double)((int64_t)(bench_rng_next(&rng_state) % 2001) - 1000) / 1000.0;
+        }
+        qsort(col + k, lengths[r], sizeof(uint32_t), compare_u32);
+        k += lengths[r];
+    }
+    row[rows] = (uint32_t)k;
+    free(lengths);
+    return 0;
+}
+
+static int build_layouts(matrix_t *m) {
+    uint32_t rows = m->rows;
+    size_t nnz = m->nnz;
+    const uint32_t *row = (const uint32_t *)cap_check(m->row32, 0, ((size_t)rows + 1) * sizeof(uint32_t));
+    const uint32_t *col = (const uint32_t *)cap_check(m->col32, 0, nnz * sizeof(uint32_t));
+
+    // csr64
+    m->row64 = cap_malloc(((size_t)rows + 1) * sizeof(uint64_t));
+    m->col64 = cap_malloc(nnz * sizeof(uint64_t));
+    if (cap_is_null(m->row64) || cap_is_null(m->col64)) return -1;
+    uint64_t *row64 = (uint64_t *)cap_check(m->row64, 0, ((size_t)rows + 1) * sizeof(uint64_t));
+    uint64_t *col64 = (uint64_t *)cap_check(m->col64, 0, nnz * sizeof(uint64_t));
+    for (uint32_t r = 0; r <= rows; r++) row64[r] = row[r];
+    for (size_t k = 0; k < nnz; k++) col64[k] = col[k];
+
+    // csr16: the previous column starts at the row index, so banded rows
+    // rarely escape even on their first entry
+    size_t blocks = (size_t)rows / ROW_BLOCK + 1;
+    m->stream16 = cap_malloc(3 * nnz * sizeof(int16_t) + 1);
+    m->block16 = cap_malloc(blocks * sizeof(uint32_t));
+    if (cap_is_null(m->stream16) || cap_is_null(m->block16)) return -1;
+    int16_t *stream = (int16_t *)cap_check(m->stream16, 0, 3 * nnz * sizeof(int16_t));
+    uint32_t *block = (uint32_t *)cap_check(m->block16, 0, blocks * sizeof(uint32_t));
+    size_t p = 0;
+    m->escapes = 0;
+    for (uint32_t r = 0; r < rows; r++) {
+        if (r % ROW_BLOCK == 0) block[r / ROW_BLOCK] = (uint32_t)p;
+        int64_t prev = r;
+        for (uint32_t k = row[r]; k < row[r + 1]; k++) {
+            int64_t delta = (int64_t)col[k] - prev;
+            if (delta > INT16_MIN && delta <= INT16_MAX) {
+                stream[p++] = (int16_t)delta;
+            } else {
+                stream[p++] = CSR16_ESCAPE;
+                stream[p++] = (int16_t)(uint16_t)(col[k] & 0xFFFF);
+                stream[p++] = (int16_t)(uint16_t)(col[k] >> 16);
+                m->escapes++;
+            }
+            prev = col[k];
+        }
+    }
+    block[blocks - 1] = (uint32_t)p;
+    m->stream_len = p;
+    m->stream16 = cap_sub(m->stream16, 0, p * sizeof(int16_t));
+
+    // rowptr: bounded per-row views of the shared values and csr32 columns
+    m->row_values = cap_malloc((size_t)rows * sizeof(cap_ptr_t));
+    m->row_cols = cap_malloc((size_t)rows * sizeof(cap_ptr_t));
+    m->row_len = cap_malloc((size_t)rows * sizeof(uint32_t));
+    if (cap_is_null(m->row_values) || cap_is_null(m->row_cols) || cap_is_null(m->row_len)) return -1;
+    for (uint32_t r = 0; r < rows; r++) {
+        uint32_t len = row[r + 1] - row[r];
+        CAP_AT(m->row_values, cap_ptr_t, r) = cap_sub(m->values, (size_t)row[r] * sizeof(double), len * sizeof(double));
+        CAP_AT(m->row_cols, cap_ptr_t, r) = cap_sub(m->col32, (size_t)row[r] * sizeof(uint32_t), len * sizeof(uint32_t));
+        CAP_AT(m->row_len, uint32_t, r) = len;
+    }
+
+    m->metadata_bytes[LAYOUT_CSR64] = ((size_t)rows + 1) * sizeof(uint64_t) + nnz * sizeof(uint64_t);
+    m->metadata_bytes[LAYOUT_CSR32] = ((size_t)rows + 1) * sizeof(uint32_t) + nnz * sizeof(uint32_t);
+    m->metadata_bytes[LAYOUT_CSR16] = ((size_t)rows + 1) * sizeof(uint32_t) + blocks * sizeof(uint32_t) +
+                                      p * sizeof(int16_t);
+    m->metadata_bytes[LAYOUT_ROWPTR] = (size_t)rows * (2 * sizeof(cap_ptr_t) + sizeof(uint32_t)) +
+                                       nnz * sizeof(uint32_t);
+    return 0;
+}
+
+static void free_matrix(matrix_t *m) {
+    cap_free(m->values);
+    cap_free(m->row64);
+    cap_free(m->col64);
+    cap_free(m->row32);
+    cap_free(m->col32);
+    cap_free(m->stream16);
+    cap_free(m->block16);
+    cap_free(m->row_values);
+    cap_free(m->row_cols);
+    cap_free(m->row_len);
+}
+
+// ---------------------------------------------------------------------------
+// Kernels: y[r0, r1) = A[r0, r1) * x
+// ---------------------------------------------------------------------------
+
+static void spmv_csr64(const matrix_t *m, const double *x, double *y, uint32_t r0, uint32_t r1) {
+    const uint64_t *row = (const uint64_t *)cap_check(m->row64, 0, ((size_t)m->rows + 1) * sizeof(uint64_t));
+    const uint64_t *col = (const uint64_t *)cap_check(m->col64, 0, m->nnz * sizeof(uint64_t));
+    const double *val = (const double *)cap_check(m->values, 0, m->nnz * sizeof(double));
+    for (uint32_t r = r0; r < r1; r++) {
+        double sum = 0.0;
+        for (uint64_t k = row[r]; k < row[r + 1]; k++) sum += val[k] * x[col[k]];
+        y[r] = sum;
+    }
+}
+
+static void spmv_csr32(const matrix_t *m, const double *x, double *y, uint32_t r0, uint32_t r1) {
+    const uint32_t *row = (const uint32_t *)cap_check(m->row32, 0, ((size_t)m->rows + 1) * sizeof(uint32_t));
+    const uint32_t *col = (const uint32_t *)cap_check(m->col32, 0, m->nnz * sizeof(uint32_t));
+    const double *val = (const double *)cap_check(m->values, 0, m->nnz * sizeof(double));
+    for (uint32_t r = r0; r < r1; r++) {
+        double sum = 0.0;
+        for (uint32_t k = row[r]; k < row[r + 1]; k++) sum += val[k] * x[col[k]];
+        y[r] = sum;
+    }
+}
+
+// r0 must start a row block
+static void spmv_csr16(const matrix_t *m, const double *x, double *y, uint32_t r0, uint32_t r1) {
+    const uint32_t *row = (const uint32_t *)cap_check(m->row32, 0, ((size_t)m->rows + 1) * sizeof(uint32_t));
+    const int16_t *stream = (const int16_t *)cap_check(m->stream16, 0, m->stream_len * sizeof(int16_t));
+    const double *val = (const double *)cap_check(m->values, 0, m->nnz * sizeof(double));
+    size_t p = CAP_AT(m->block16, uint32_t, r0 / ROW_BLOCK);
+    for (uint32_t r = r0; r < r1; r++) {
+        double sum = 0.0;
+        int64_t c = r;
+        for (uint32_t k = row[r]; k < row[r + 1]; k++) {
+            int16_t d = stream[p++];
+            if (__builtin_expect(d == CSR16_ESCAPE, 0)) {
+                c = (int64_t)(uint16_t)stream[p] | ((int64_t)(uint16_t)stream[p + 1] << 16);
+                p += 2;
+            } else {
+                c += d;
+            }
+            sum += val[k] * x[c];
+        }
+        y[r] = sum;
+    }
+}
+
+static void spmv_rowptr(const matrix_t *m, const double *x, double *y, uint32_t r0, uint32_t r1) {
+    const cap_ptr_t *row_values = (const cap_ptr_t *)cap_check(m->row_values, 0, (size_t)m->rows * sizeof(cap_ptr_t));
+    const cap_ptr_t *row_cols = (const cap_ptr_t *)cap_check(m->row_cols, 0, (size_t)m->rows * sizeof(cap_ptr_t));
+    const uint32_t *row_len = (const uint32_t *)cap_check(m->row_len, 0, (size_t)m->rows * sizeof(uint32_t));
+    for (uint32_t r = r0; r < r1; r++) {
+        uint32_t len = row_len[r];
+        // One bounds check per row view, as a bounds-aware compiler would hoist
+        const double *val = (const double *)cap_check(row_values[r], 0, len * sizeof(double));
+        const uint32_t *col = (const uint32_t *)cap_check(row_cols[r], 0, len * sizeof(uint32_t));
+        double sum = 0.0;
+        for (uint32_t j = 0; j < len; j++) sum += val[j] * x[col[j]];
+        y[r] = sum;
+    }
+}
+
+static void spmv(const matrix_t *m, layout_t layout, const double *x, double *y, uint32_t r0, uint32_t r1) {
+    switch (layout) {
+    case LAYOUT_CSR64: spmv_csr64(m, x, y, r0, r1); break;
+    case LAYOUT_CSR32: spmv_csr32(m, x, y, r0, r1); break;
+    case LAYOUT_CSR16: spmv_csr16(m, x, y, r0, r1); break;
+    default: spmv_rowptr(m, x, y, r0, r1); break;
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Multithreaded runs: rows split into nnz-balanced, block-aligned ranges
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    const matrix_t *m;
+    layout_t layout;
+    const double *x;
+    double *y;
+    int iterations;
+    int threads;
+    uint32_t *split;            // threads + 1 row boundaries
+    pthread_barrier_t barrier;
+} spmv_team_t;
+
+typedef struct {
+    spmv_team_t *team;
+    int id;
+    uint64_t elapsed_ns;
+} spmv_worker_t;
+
+static void partition_rows(const matrix_t *m, int threads, uint32_t *split) {
+    const uint32_t *row = (const uint32_t *)cap_check(m->row32, 0, ((size_t)m->rows + 1) * sizeof(uint32_t));
+    uint32_t r = 0;
+    split[0] = 0;
+    for (int t = 1; t < threads; t++) {
+        size_t target = m->nnz * (size_t)t / (size_t)threads;
+        while (r < m->rows && row[r] < target) r += ROW_BLOCK;
+        if (r > m->rows) r = m->rows;
+        split[t] = r;
+    }
+    split[threads] = m->rows;
+}
+
+static void *spmv_worker(void *arg) {
+    spmv_worker_t *w = arg;
+    spmv_team_t *team = w->team;
+    uint32_t r0 = team->split[w->id], r1 = team->split[w->id + 1];
+
+    pthread_barrier_wait(&team->barrier);
+    uint64_t start = bench_now_ns();
+    for (int it = 0; it < team->iterations; it++) {
+        if (r0 < r1) spmv(team->m, team->layout, team->x, team->y, r0, r1);
+        pthread_barrier_wait(&team->barrier);   // As between solver iterations
+    }
+    w->elapsed_ns = bench_now_ns() - start;
+    return NULL;
+}
+
+static uint64_t spmv_parallel(spmv_team_t *team) {
+    pthread_t tids[256];
+    spmv_worker_t workers[256];
+    pthread_barrier_init(&team->barrier, NULL, (unsigned)team->threads);
+    for (int t = 0; t < team->threads; t++) {
+        workers[t].team = team;
+        workers[t].id = t;
+        if (t > 0) pthread_create(&tids[t], NULL, spmv_worker, &workers[t]);
+    }
+    spmv_worker(&workers[0]);
+    for (int t = 1; t < team->threads; t++) pthread_join(tids[t], NULL);
+    pthread_barrier_destroy(&team->barrier);
+    return workers[0].elapsed_ns;
+}
+
+// ---------------------------------------------------------------------------
+// STREAM triad (a = b + s*c) as the attainable-bandwidth reference
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    double *a, *b, *c;
+    size_t begin, end;
+} triad_range_t;
+
+static void *triad_worker(void *arg) {
+    triad_range_t *r = arg;
+    for (size_t i = r->begin; i < r->end; i++) r->a[i] = r->b[i] + 3.0 * r->c[i];
+    return NULL;
+}
+
+// Best-of bandwidth in bytes/sec, counting 24 bytes per element
+static double stream_triad(int threads) {
+    size_t n = STREAM_BYTES / (3 * sizeof(double));
+    double *a = malloc(n * sizeof(double)), *b = malloc(n * sizeof(double)), *c = malloc(n * sizeof(double));
+    if (!a || !b || !c) {
+        free(a);
+        free(b);
+        free(c);
+        return 0.0;
+    }
+    for (size_t i = 0; i < n; i++) {
+        a[i] = 0.0;
+        b[i] = 1.0;
+        c[i] = 2.0;
+    }
+    pthread_t tids[256];
+    triad_range_t ranges[256];
+    double best = 0.0;
+    for (int rep = 0; rep < STREAM_REPS; rep++) {
+        uint64_t start = bench_now_ns();
+        for (int t = 0; t < threads; t++) {
+            ranges[t] = (triad_range_t){ a, b, c, n * (size_t)t / (size_t)threads, n * (size_t)(t + 1) / (size_t)threads };
+            if (t > 0) pthread_create(&tids[t], NULL, triad_worker, &ranges[t]);
+        }
+        triad_worker(&ranges[0]);
+        for (int t = 1; t < threads; t++) pthread_join(tids[t], NULL);
+        double rate = 24.0 * (double)n / bench_seconds(start, bench_now_ns());
+        if (rate > best) best = rate;
+    }
+    free(a);
+    free(b);
+    free(c);
+    return best;
+}
+
+// ---------------------------------------------------------------------------
+// Benchmark
+// ---------------------------------------------------------------------------
+
+// Compulsory traffic per SpMV: values, indices and row metadata once, x and y once
+static double spmv_bytes(const matrix_t *m, layout_t layout) {
+    return (double)(m->nnz * sizeof(double) + m->metadata_bytes[layout] + 2 * (size_t)m->rows * sizeof(double));
+}
+
+static int run_matrix(matrix_t *m, int iterations, int threads, double serial_bw, double parallel_bw) {
+    uint32_t n = m->rows;
+    if (build_layouts(m) != 0) {
+        fprintf(stderr, "%s: out of memory\n", m->name);
+        return -1;
+    }
+    double *x = malloc((size_t)n * sizeof(double));
+    double *y = malloc((size_t)n * sizeof(double));
+    double *y_ref = malloc((size_t)n * sizeof(double));
+    uint32_t *split = malloc(((size_t)threads + 1) * sizeof(uint32_t));
+    if (!x || !y || !y_ref || !split) return -1;
+    for (uint32_t i = 0; i < n; i++) x[i] = 1.0 + (double)(bench_rng_next(&rng_state) % 1000) / 1000.0;
+    partition_rows(m, threads, split);
+
+    printf("%s: %u rows, %zu nonzeros (%.1f per row), %zu csr16 escapes (%.2f%%)\n", m->name, n, m->nnz,
+           (double)m->nnz / n, m->escapes, 100.0 * (double)m->escapes / (double)m->nnz);
+
+    // Every layout must reproduce csr64 serially and in parallel
+    spmv(m, LAYOUT_CSR64, x, y_ref, 0, n);
+    spmv_team_t team;
+    memset(&team, 0, sizeof(team));
+    team.m = m;
+    team.x = x;
+    team.y = y;
+    team.threads = threads;
+    team.split = split;
+    for (int l = 0; l < LAYOUT_COUNT; l++) {
+        for (int pass = 0; pass < 2; pass++) {
+            memset(y, 0, (size_t)n * sizeof(double));
+            team.layout = (layout_t)l;
+            team.iterations = 1;
+            if (pass == 0) spmv(m, (layout_t)l, x, y, 0, n);
+            else spmv_parallel(&team);
+            for (uint32_t i = 0; i < n; i++) {
+                double diff = y[i] - y_ref[i];
+                if (diff > 1e-9 || diff < -1e-9) {
+                    fprintf(stderr, "%s: %s row %u differs (%g vs %g)\n", m->name, layout_names[l], i, y[i], y_ref[i]);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    char metric[48];
+    double flops = 2.0 * (double)m->nnz * iterations;
+    for (int l = 0; l < LAYOUT_COUNT; l++) {
+        layout_t layout = (layout_t)l;
+        double bytes = spmv_bytes(m, layout) * iterations;
+
+        uint64_t start = bench_now_ns();
+        for (int it = 0; it < iterations; it++) spmv(m, layout, x, y, 0, n);
+        double serial = bench_seconds(start, bench_now_ns());
+
+        team.layout = layout;
+        team.iterations = iterations;
+        double parallel = (double)spmv_parallel(&team) / 1e9;
+
+        snprintf(metric, sizeof(metric), "%s_%s_gflops", m->name, layout_names[l]);
+        bench_report(metric, flops / serial / 1e9, "GFLOP/s");
+        snprintf(metric, sizeof(metric), "%s_%s_mt_gflops", m->name, layout_names[l]);
+        bench_report(metric, flops / parallel / 1e9, "GFLOP/s");
+        snprintf(metric, sizeof(metric), "%s_%s_mt_gb_per_sec", m->name, layout_names[l]);
+        bench_report(metric, bytes / parallel / 1e9, "GB/s");
+        snprintf(metric, sizeof(metric), "%s_%s_bw_utilization", m->name, layout_names[l]);
+        bench_report(metric, 100.0 * bytes / serial / serial_bw, "%");
+        snprintf(metric, sizeof(metric), "%s_%s_mt_bw_utilization", m->name, layout_names[l]);
+        bench_report(metric, 100.0 * bytes / parallel / parallel_bw, "%");
+        snprintf(metric, sizeof(metric), "%s_%s_index_bytes_per_nnz", m->name, layout_names[l]);
+        bench_report(metric, (double)m->metadata_bytes[l] / (double)m->nnz, "bytes");
+    }
+
+    free(x);
+    free(y);
+    free(y_ref);
+    free(split);
+    return 0;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-g grid] [-n rows] [-d nnz_per_row] [-i iterations] [-t threads]\n", prog);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    int grid = DEFAULT_GRID;
+    long rows = DEFAULT_ROWS;
+    int row_nnz = DEFAULT_ROW_NNZ;
+    int iterations = DEFAULT_ITERATIONS;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = cpus > 0 ? (int)cpus : 4;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "g:n:d:i:t:h")) != -1) {
+        switch (opt) {
+        case 'g': grid = atoi(optarg); break;
+        case 'n': rows = atol(optarg); break;
+        case 'd': row_nnz = atoi(optarg); break;
+        case 'i': iterations = atoi(optarg); break;
+        case 't': threads = atoi(optarg); break;
+        default: usage(argv[0]);
+        }
+    }
+    // Nonzero counts must fit the 32-bit offsets of csr32
+    if (grid < 2 || grid > 256 || rows < ROW_BLOCK || rows > (1L << 26) || row_nnz <= 0 || row_nnz > 64 ||
+        iterations <= 0 || threads <= 0 || threads > 256) {
+        usage(argv[0]);
+    }
+
+    bench_print_header("spmv", "SPARSE MATRIX-VECTOR MULTIPLY WORKLOAD");
+    double serial_bw = stream_triad(1);
+    double parallel_bw = stream_triad(threads);
+    printf("STREAM triad: %.2f GB/s serial, %.2f GB/s with %d threads; %d iterations per layout\n\n",
+           serial_bw / 1e9, parallel_bw / 1e9, threads, iterations);
+    if (serial_bw <= 0.0 || parallel_bw <= 0.0) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    printf("SPMV RESULTS\n");
+    printf("-------------------------------------------\n");
+    bench_report("stream_triad_gb_per_sec", serial_bw / 1e9, "GB/s");
+    bench_report("stream_triad_mt_gb_per_sec", parallel_bw / 1e9, "GB/s");
+
+    int failed = 0;
+    matrix_t stencil, powerlaw;
+    memset(&stencil, 0, sizeof(stencil));
+    memset(&powerlaw, 0, sizeof(powerlaw));
+    stencil.name = "stencil";
+    powerlaw.name = "powerlaw";
+    if (generate_stencil(&stencil, (uint32_t)grid) != 0 || run_matrix(&stencil, iterations, threads, serial_bw, parallel_bw) != 0) {
+        failed = 1;
+    }
+    free_matrix(&stencil);
+    if (generate_powerlaw(&powerlaw, (uint32_t)rows, row_nnz) != 0 ||
+        run_matrix(&powerlaw, iterations, threads, serial_bw, parallel_bw) != 0) {
+        failed = 1;
+    }
+    free_matrix(&powerlaw);
+    bench_report("max_rss", (double)bench_max_rss_bytes(), "bytes");
+    bench_finish();
+    return failed;
+}
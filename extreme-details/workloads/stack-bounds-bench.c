@@ -0,0 +1,238 @@
+/*
+ * Real-World Application Stress Test - Stack-Object Bounds Derivation
+ *
+ * cheri_stack_protection_demo() and cheri_stack_corruption_test() in
+ * implementations/ bound one stack buffer each. Purecap code does that for
+ * every local whose address is taken: the compiler derives a capability
+ * bounded to the object, with CRRL/CRAM rounding first when the size is
+ * only known at run time (VLAs, alloca). This workload calls a family of
+ * frames in hot loops and times each call:
+ *   locals_N  - N address-taken locals of 2-200 bytes (N = 0 ... 32)
+ *   vla       - one variable-length array of 16 bytes to 20 KB
+ *   alloca    - one alloca() of the same sizes
+ *   alloca_4  - four alloca() calls of shrinking size
+ * Every frame hands its objects to a non-inlined consumer through a
+ * global table, so each one escapes and must be bounded. The softcap
+ * build derives the same references in software with cap_make().
+ */
+
+#include <alloca.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "capmodel.h"
+#include "bench.h"
+
+// Benchmark configuration
+#define DEFAULT_CALLS       5000000
+#define DEFAULT_ITERATIONS  3
+#define MAX_OBJECTS         32
+
+#ifdef __CHERI__
+// The compiler bounds &x itself; cap_make() would add a second CSetBounds
+#define STACK_REF(ptr, size) ((cap_ptr_t)(ptr))
+#else
+#define STACK_REF(ptr, size) cap_make((ptr), (size))
+#endif
+
+#if defined(__CHERI__) || defined(CAP_MODEL_SOFTCAP)
+#define STACK_BOUNDED 1
+#else
+#define STACK_BOUNDED 0
+#endif
+
+// Object types, cycled through by the locals_N frames
+typedef char blob24_t[24];
+typedef char blob64_t[64];
+typedef char blob200_t[200];
+typedef uint64_t words4_t[4];
+typedef struct {
+    double x, y, z;
+} point_t;
+
+// Sizes for the run-time sized frames, cycled per call
+static const size_t dynamic_sizes[8] = { 16, 48, 100, 256, 1000, 4000, 5000, 20000 };
+
+// Escaped references: filled by a frame, read by consume()
+static cap_ptr_t frame_refs[MAX_OBJECTS];
+
+// Touch every escaped object; keeps the frames' objects alive and distinct
+static __attribute__((noinline)) uint64_t consume(int count, uint64_t seed) {
+    uint64_t sum = seed;
+    for (int i = 0; i < count; i++) {
+        unsigned char *first = cap_check(frame_refs[i], 0, 1);
+        *first = (unsigned char)sum;
+        sum = sum * 31 + *first + (uint64_t)i;
+    }
+    return sum;
+}
+
+// ---------------------------------------------------------------------------
+// Frames
+// ---------------------------------------------------------------------------
+
+#define LOCAL(g, k, type) \
+    type v##g##_##k; \
+    frame_refs[8 * (g) + (k)] = STACK_REF(&v##g##_##k, sizeof(type));
+
+#define LOCALS_1(g) LOCAL(g, 0, uint32_t)
+#define LOCALS_2(g) LOCALS_1(g) LOCAL(g, 1, uint64_t)
+#define LOCALS_4(g) LOCALS_2(g) LOCAL(g, 2, blob24_t) LOCAL(g, 3, point_t)
+#define LOCALS_8(g) LOCALS_4(g) LOCAL(g, 4, blob64_t) LOCAL(g, 5, uint16_t) \
+                    LOCAL(g, 6, blob200_t) LOCAL(g, 7, words4_t)
+
+static __attribute__((noinline)) uint64_t frame_locals_0(size_t size, uint64_t seed) {
+    (void)size;
+    return consume(0, seed);
+}
+
+static __attribute__((noinline)) uint64_t frame_locals_1(size_t size, uint64_t seed) {
+    (void)size;
+    LOCALS_1(0)
+    return consume(1, seed);
+}
+
+static __attribute__((noinline)) uint64_t frame_locals_2(size_t size, uint64_t seed) {
+    (void)size;
+    LOCALS_2(0)
+    return consume(2, seed);
+}
+
+static __attribute__((noinline)) uint64_t frame_locals_4(size_t size, uint64_t seed) {
+    (void)size;
+    LOCALS_4(0)
+    return consume(4, seed);
+}
+
+static __attribute__((noinline)) uint64_t frame_locals_8(size_t size, uint64_t seed) {
+    (void)size;
+    LOCALS_8(0)
+    return consume(8, seed);
+}
+
+static __attribute__((noinline)) uint64_t frame_locals_16(size_t size, uint64_t seed) {
+    (void)size;
+    LOCALS_8(0)
+    LOCALS_8(1)
+    return consume(16, seed);
+}
+
+static __attribute__((noinline)) uint64_t frame_locals_24(size_t size, uint64_t seed) {
+    (void)size;
+    LOCALS_8(0)
+    LOCALS_8(1)
+    LOCALS_8(2)
+    return consume(24, seed);
+}
+
+static __attribute__((noinline)) uint64_t frame_locals_32(size_t size, uint64_t seed) {
+    (void)size;
+    LOCALS_8(0)
+    LOCALS_8(1)
+    LOCALS_8(2)
+    LOCALS_8(3)
+    return consume(32, seed);
+}
+
+static __attribute__((noinline)) uint64_t frame_vla(size_t size, uint64_t seed) {
+    char buf[size];
+    frame_refs[0] = STACK_REF(buf, size);
+    return consume(1, seed);
+}
+
+static __attribute__((noinline)) uint64_t frame_alloca(size_t size, uint64_t seed) {
+    char *buf = alloca(size);
+    frame_refs[0] = STACK_REF(buf, size);
+    return consume(1, seed);
+}
+
+static __attribute__((noinline)) uint64_t frame_alloca_4(size_t size, uint64_t seed) {
+    for (int i = 0; i < 4; i++) {
+        size_t part = (size >> i) + 1;
+        char *buf = alloca(part);
+        frame_refs[i] = STACK_REF(buf, part);
+    }
+    return consume(4, seed);
+}
+
+typedef struct {
+    const char *name;
+    uint64_t (*fn)(size_t size, uint64_t seed);
+    int objects;                // Address-taken objects per call
+} frame_t;
+
+static const frame_t frames[] = {
+    { "locals_0", frame_locals_0, 0 },
+    { "locals_1", frame_locals_1, 1 },
+    { "locals_2", frame_locals_2, 2 },
+    { "locals_4", frame_locals_4, 4 },
+    { "locals_8", frame_locals_8, 8 },
+    { "locals_16", frame_locals_16, 16 },
+    { "locals_24", frame_locals_24, 24 },
+    { "locals_32", frame_locals_32, 32 },
+    { "vla", frame_vla, 1 },
+    { "alloca", frame_alloca, 1 },
+    { "alloca_4", frame_alloca_4, 4 },
+};
+
+#define FRAME_COUNT     (sizeof(frames) / sizeof(frames[0]))
+#define FRAME_NO_LOCALS 0           // frames[] index of locals_0
+#define FRAME_MAX_LOCALS 7          // ... and of locals_32
+
+// Best cycles per call over the iterations
+static double time_frame(const frame_t *f, size_t calls, int iterations, uint64_t *checksum) {
+    double best = 0;
+    for (int it = 0; it < iterations; it++) {
+        uint64_t sum = *checksum;
+        uint64_t start = bench_cycles();
+        for (size_t i = 0; i < calls; i++) sum = f->fn(dynamic_sizes[i & 7], sum);
+        double per_call = (double)(bench_cycles() - start) / (double)calls;
+        if (it == 0 || per_call < best) best = per_call;
+        *checksum = sum;
+    }
+    return best;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-n calls] [-i iterations]\n", prog);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    size_t calls = DEFAULT_CALLS;
+    int iterations = DEFAULT_ITERATIONS;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:i:h")) != -1) {
+        switch (opt) {
+        case 'n': calls = (size_t)strtoull(optarg, NULL, 0); break;
+        case 'i': iterations = atoi(optarg); break;
+        default: usage(argv[0]);
+        }
+    }
+    if (calls == 0 || iterations <= 0) usage(argv[0]);
+
+    bench_print_header("stack-bounds", "STACK-OBJECT BOUNDS WORKLOAD");
+    printf("Calls per frame: %zu, best of %d\n\n", calls, iterations);
+
+    printf("STACK FRAME RESULTS\n");
+    printf("-------------------------------------------\n");
+    char metric[48];
+    double cycles[FRAME_COUNT];
+    uint64_t checksum = 1;
+    for (size_t f = 0; f < FRAME_COUNT; f++) {
+        cycles[f] = time_frame(&frames[f], calls, iterations, &checksum);
+        snprintf(metric, sizeof(metric), "%s_cycles_per_call", frames[f].name);
+        bench_report(metric, cycles[f], "cycles");
+        snprintf(metric, sizeof(metric), "%s_bounds_per_call", frames[f].name);
+        bench_report(metric, STACK_BOUNDED ? frames[f].objects : 0, "bounds");
+    }
+    // Slope from no locals to 32: what each further address-taken local costs
+    bench_report("cycles_per_local", (cycles[FRAME_MAX_LOCALS] - cycles[FRAME_NO_LOCALS]) / MAX_OBJECTS, "cycles");
+    printf("  (checksum %llx)\n", (unsigned long long)checksum);
+
+    bench_finish();
+    return 0;
+}
@@ -0,0 +1,231 @@
+/*
+ * Real-World Application Stress Test - Bulk Bounded Sub-View Derivation
+ *
+ * benchmark_capability_operations() in edge-cases/stress-tests derives
+ * one bounded capability per loop iteration. Packet batching, record
+ * scanning and string tables do the same thing in bulk: split one parent
+ * buffer into many bounded views from a table of extents. This workload
+ * derives those views with a scalar cap_sub() loop and with
+ * cap_sub_bulk() (common/capmodel.h), in batches of -b views:
+ *   packets  - back-to-back frames of 64-1500 bytes in a receive ring
+ *   records  - fixed 128-byte records of a scanned file
+ *   strings  - 4-40 byte entries of a string table
+ * Both paths must produce identical views, including the untagged view
+ * for an extent past the end of the parent.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "capmodel.h"
+#include "bench.h"
+
+// Benchmark configuration
+#define BUFFER_SIZE         (4 * 1024 * 1024)
+#define DEFAULT_BATCH       64
+#define DEFAULT_ITERATIONS  5
+#define MIN_DERIVATIONS     20000000    // Repeat the buffer until this many views
+#define RECORD_SIZE         128
+
+typedef enum {
+    LAYOUT_PACKETS = 0, LAYOUT_RECORDS, LAYOUT_STRINGS, LAYOUT_COUNT
+} layout_t;
+
+static const char *const layout_names[LAYOUT_COUNT] = { "packets", "records", "strings" };
+
+// Extents of every view in the parent buffer
+typedef struct {
+    size_t *offsets;
+    size_t *lengths;
+    size_t count;
+} extents_t;
+
+static uint64_t rng_state = 0x853C49E6748FEA9Bull;
+
+static int build_extents(extents_t *e, layout_t layout, size_t buffer_size) {
+    size_t max_count = buffer_size / 4;
+    e->offsets = malloc(max_count * sizeof(size_t));
+    e->lengths = malloc(max_count * sizeof(size_t));
+    e->count = 0;
+    if (!e->offsets || !e->lengths) return -1;
+
+    size_t pos = 0;
+    for (;;) {
+        size_t len;
+        switch (layout) {
+        case LAYOUT_PACKETS: len = 64 + (size_t)(bench_rng_next(&rng_state) % (1500 - 64 + 1)); break;
+        case LAYOUT_RECORDS: len = RECORD_SIZE; break;
+        default:             len = 4 + (size_t)(bench_rng_next(&rng_state) % 37); break;
+        }
+        if (pos + len > buffer_size || e->count == max_count) break;
+        e->offsets[e->count] = pos;
+        e->lengths[e->count] = len;
+        e->count++;
+        pos += len;
+    }
+    return 0;
+}
+
+static void free_extents(extents_t *e) {
+    free(e->offsets);
+    free(e->lengths);
+}
+
+// ---------------------------------------------------------------------------
+// Derivation paths
+// ---------------------------------------------------------------------------
+
+__attribute__((noinline))
+static size_t derive_scalar(cap_ptr_t parent, const size_t *offsets, const size_t *lengths,
+                            size_t count, cap_ptr_t *views) {
+    size_t valid = 0;
+    for (size_t i = 0; i < count; i++) {
+        views[i] = cap_sub(parent, offsets[i], lengths[i]);
+        valid += !cap_is_null(views[i]);
+    }
+    return valid;
+}
+
+__attribute__((noinline))
+static size_t derive_bulk(cap_ptr_t parent, const size_t *offsets, const size_t *lengths,
+                          size_t count, cap_ptr_t *views) {
+    return cap_sub_bulk(parent, offsets, lengths, count, views);
+}
+
+typedef size_t (*derive_fn)(cap_ptr_t, const size_t *, const size_t *, size_t, cap_ptr_t *);
+
+// Every extent once, batch views per call; returns tagged views plus an address checksum
+static uint64_t derive_all(derive_fn derive, cap_ptr_t parent, const extents_t *e, size_t batch,
+                           cap_ptr_t *views) {
+    uint64_t sum = 0;
+    for (size_t i = 0; i < e->count; i += batch) {
+        size_t n = e->count - i < batch ? e->count - i : batch;
+        sum += derive(parent, e->offsets + i, e->lengths + i, n, views);
+        sum += (uintptr_t)cap_addr(views[n - 1]);
+    }
+    return sum;
+}
+
+// Both paths agree on every view, on an extent running past the parent and on
+// one whose end overflows 2^63
+static int cross_check(cap_ptr_t parent, const extents_t *e, size_t batch, cap_ptr_t *a, cap_ptr_t *b) {
+    const size_t huge = (size_t)0x7000000000000000ull;
+    const size_t offsets[3] = { 0, BUFFER_SIZE - 8, huge };
+    const size_t lengths[3] = { 16, 16, huge };
+    for (size_t i = 0; i < e->count; i += batch) {
+        size_t n = e->count - i < batch ? e->count - i : batch;
+        if (derive_scalar(parent, e->offsets + i, e->lengths + i, n, a) !=
+            derive_bulk(parent, e->offsets + i, e->lengths + i, n, b)) {
+            return -1;
+        }
+        for (size_t j = 0; j < n; j++) {
+            if (cap_addr(a[j]) != cap_addr(b[j]) || cap_len(a[j]) != cap_len(b[j])) return -1;
+        }
+    }
+    // Each suffix, so every bad extent goes through both the paired and the
+    // single-entry checks of cap_sub_bulk()
+    for (size_t first = 0; first < 3; first++) {
+        size_t n = 3 - first;
+        if (derive_scalar(parent, offsets + first, lengths + first, n, a) !=
+            derive_bulk(parent, offsets + first, lengths + first, n, b)) {
+            return -1;
+        }
+        for (size_t j = 0; j < n; j++) {
+            if (cap_is_null(a[j]) != cap_is_null(b[j])) return -1;
+        }
+    }
+    return 0;
+}
+
+// Best derivations per second over the iterations
+static double time_derive(derive_fn derive, cap_ptr_t parent, const extents_t *e, size_t batch,
+                          cap_ptr_t *views, int iterations, uint64_t *checksum) {
+    size_t reps = MIN_DERIVATIONS / e->count > 0 ? MIN_DERIVATIONS / e->count : 1;
+    double best = 0.0;
+    for (int it = 0; it < iterations; it++) {
+        uint64_t sum = 0;
+        uint64_t start = bench_now_ns();
+        for (size_t r = 0; r < reps; r++) sum += derive_all(derive, parent, e, batch, views);
+        double rate = (double)e->count * (double)reps / bench_seconds(start, bench_now_ns());
+        if (rate > best) best = rate;
+        *checksum = sum;
+    }
+    return best;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-b batch] [-i iterations]\n", prog);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    size_t batch = DEFAULT_BATCH;
+    int iterations = DEFAULT_ITERATIONS;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "b:i:h")) != -1) {
+        switch (opt) {
+        case 'b': batch = (size_t)strtoull(optarg, NULL, 0); break;
+        case 'i': iterations = atoi(optarg); break;
+        default: usage(argv[0]);
+        }
+    }
+    if (batch == 0 || iterations <= 0) usage(argv[0]);
+
+    cap_ptr_t parent = cap_malloc(BUFFER_SIZE);
+    size_t slots = batch < 3 ? 3 : batch;   // cross_check() derives three views
+    cap_ptr_t *scalar_views = malloc(slots * sizeof(cap_ptr_t));
+    cap_ptr_t *bulk_views = malloc(slots * sizeof(cap_ptr_t));
+    if (cap_is_null(parent) || !scalar_views || !bulk_views) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    memset(cap_check(parent, 0, BUFFER_SIZE), 0, BUFFER_SIZE);
+
+    bench_print_header("subview", "BULK SUB-VIEW DERIVATION WORKLOAD");
+    printf("Parent: %d bytes, %zu views per call, best of %d\n\n", BUFFER_SIZE, batch, iterations);
+
+    printf("SUB-VIEW DERIVATION RESULTS\n");
+    printf("-------------------------------------------\n");
+    int failed = 0;
+    char metric[48];
+    for (int l = 0; l < LAYOUT_COUNT && !failed; l++) {
+        extents_t e;
+        if (build_extents(&e, (layout_t)l, BUFFER_SIZE) != 0) {
+            fprintf(stderr, "Out of memory for %s extents\n", layout_names[l]);
+            failed = 1;
+            break;
+        }
+        if (cross_check(parent, &e, batch, scalar_views, bulk_views) != 0) {
+            fprintf(stderr, "%s: bulk and scalar views differ\n", layout_names[l]);
+            failed = 1;
+            free_extents(&e);
+            break;
+        }
+
+        uint64_t scalar_sum = 0, bulk_sum = 0;
+        double scalar = time_derive(derive_scalar, parent, &e, batch, scalar_views, iterations, &scalar_sum);
+        double bulk = time_derive(derive_bulk, parent, &e, batch, bulk_views, iterations, &bulk_sum);
+        if (scalar_sum != bulk_sum) {
+            fprintf(stderr, "%s: checksum mismatch\n", layout_names[l]);
+            failed = 1;
+        }
+        snprintf(metric, sizeof(metric), "%s_scalar_derivs_per_sec", layout_names[l]);
+        bench_report(metric, scalar, "derivs/s");
+        snprintf(metric, sizeof(metric), "%s_bulk_derivs_per_sec", layout_names[l]);
+        bench_report(metric, bulk, "derivs/s");
+        snprintf(metric, sizeof(metric), "%s_bulk_speedup", layout_names[l]);
+        bench_report(metric, bulk / scalar, "x");
+        free_extents(&e);
+    }
+    bench_report("max_rss_mb", (double)bench_max_rss_bytes() / (1 << 20), "MB");
+    bench_finish();
+
+    free(scalar_views);
+    free(bulk_views);
+    cap_free(parent);
+    return failed;
+}
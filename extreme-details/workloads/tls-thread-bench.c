@@ -0,0 +1,243 @@
+/*
+ * Real-World Application Stress Test - Thread-Local Storage and Thread Startup
+ *
+ * Services that spawn many threads and touch thread-local state on every
+ * request pay for two code paths that capabilities change: TLS accesses
+ * (the thread pointer is a capability and every TLS slot that holds a
+ * pointer doubles in width; purecap code reaches TLS through the captable)
+ * and thread creation (stack and TLS block setup, larger thread control
+ * blocks). This workload measures:
+ *   tls      - cycles per access to a global and to a __thread counter,
+ *              both inside a hot loop and through a non-inlined accessor
+ *              called once per access (errno-style), plus a __thread
+ *              capability that is loaded and dereferenced on every call
+ *   threads  - pthread create+join rate, one at a time and in batches
+ *   stacks   - create+join cost for several stack sizes, with the new
+ *              thread faulting in the first 32 KB of the stack it is given
+ * Cycles come from bench_cycles() (rdcycle on RISC-V, the TSC on x86).
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "capmodel.h"
+#include "bench.h"
+
+// Benchmark configuration
+#define DEFAULT_ACCESSES    50000000
+#define DEFAULT_THREADS     20000
+#define DEFAULT_ITERATIONS  5
+#define BATCH_THREADS       64
+#define TOUCH_BYTES         (32 * 1024)     // Stack each stack-test thread writes (< smallest size)
+#define PAGE_BYTES          4096
+
+static const size_t stack_sizes[] = { 64 * 1024, 1024 * 1024, 8 * 1024 * 1024 };
+#define STACK_SIZE_COUNT (sizeof(stack_sizes) / sizeof(stack_sizes[0]))
+
+typedef enum {
+    TLS_GLOBAL_LOOP = 0, TLS_THREAD_LOOP, TLS_GLOBAL_CALL, TLS_THREAD_CALL, TLS_CAP_CALL, TLS_COUNT
+} tls_case_t;
+
+static const char *const tls_names[TLS_COUNT] = {
+    "global_loop", "tls_loop", "global_call", "tls_call", "tls_cap_call"
+};
+
+static uint64_t global_counter;
+static __thread uint64_t tls_counter;
+static __thread cap_ptr_t tls_object;       // Per-thread context, pointer-width
+
+// ---------------------------------------------------------------------------
+// TLS access
+// ---------------------------------------------------------------------------
+
+__attribute__((noinline)) static void bump_global(void) {
+    global_counter++;
+}
+
+__attribute__((noinline)) static void bump_tls(void) {
+    tls_counter++;
+}
+
+__attribute__((noinline)) static void bump_tls_object(void) {
+    CAP_OBJ(tls_object, uint64_t)[0]++;
+}
+
+// One pass of n accesses; the compiler barrier forces a load and store per access
+static uint64_t run_tls_case(tls_case_t which, uint64_t n) {
+    switch (which) {
+    case TLS_GLOBAL_LOOP:
+        for (uint64_t i = 0; i < n; i++) {
+            global_counter++;
+            asm volatile("" ::: "memory");
+        }
+        return global_counter;
+    case TLS_THREAD_LOOP:
+        for (uint64_t i = 0; i < n; i++) {
+            tls_counter++;
+            asm volatile("" ::: "memory");
+        }
+        return tls_counter;
+    case TLS_GLOBAL_CALL:
+        for (uint64_t i = 0; i < n; i++) bump_global();
+        return global_counter;
+    case TLS_THREAD_CALL:
+        for (uint64_t i = 0; i < n; i++) bump_tls();
+        return tls_counter;
+    default:
+        for (uint64_t i = 0; i < n; i++) bump_tls_object();
+        return *CAP_OBJ(tls_object, uint64_t);
+    }
+}
+
+// Best cycles per access; 0 if the counter went wrong
+static double time_tls_case(tls_case_t which, uint64_t n, int iterations) {
+    double best = 0.0;
+    for (int it = 0; it < iterations; it++) {
+        global_counter = 0;
+        tls_counter = 0;
+        *CAP_OBJ(tls_object, uint64_t) = 0;
+        uint64_t start = bench_cycles();
+        uint64_t count = run_tls_case(which, n);
+        double cycles = (double)(bench_cycles() - start) / (double)n;
+        if (count != n) return 0.0;
+        if (best == 0.0 || cycles < best) best = cycles;
+    }
+    return best;
+}
+
+// ---------------------------------------------------------------------------
+// Thread startup
+// ---------------------------------------------------------------------------
+
+static void *empty_thread(void *arg) {
+    tls_counter++;      // First touch of this thread's TLS block
+    return arg;
+}
+
+// Write one byte per page of the first TOUCH_BYTES below the frame
+static void *touch_thread(void *arg) {
+    (void)arg;
+    volatile char stack[TOUCH_BYTES];
+    for (size_t i = 0; i < sizeof(stack); i += PAGE_BYTES) stack[i] = (char)i;
+    tls_counter++;
+    return (void *)(uintptr_t)stack[PAGE_BYTES];
+}
+
+// count create+join pairs, batch threads in flight at a time; cycles per thread
+static double time_threads(size_t count, size_t batch, size_t stack_size,
+                           void *(*body)(void *), int *failed) {
+    pthread_t tids[BATCH_THREADS];
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    if (stack_size && pthread_attr_setstacksize(&attr, stack_size) != 0) *failed = 1;
+
+    uint64_t start = bench_cycles();
+    for (size_t done = 0; done < count && !*failed; done += batch) {
+        size_t n = count - done < batch ? count - done : batch;
+        size_t started = 0;
+        for (; started < n; started++) {
+            if (pthread_create(&tids[started], &attr, body, NULL) != 0) {
+                *failed = 1;
+                break;
+            }
+        }
+        for (size_t t = 0; t < started; t++) pthread_join(tids[t], NULL);
+    }
+    double cycles = (double)(bench_cycles() - start) / (double)count;
+    pthread_attr_destroy(&attr);
+    return cycles;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-n accesses] [-t threads] [-i iterations]\n", prog);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    uint64_t accesses = DEFAULT_ACCESSES;
+    size_t threads = DEFAULT_THREADS;
+    int iterations = DEFAULT_ITERATIONS;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:t:i:h")) != -1) {
+        switch (opt) {
+        case 'n': accesses = strtoull(optarg, NULL, 0); break;
+        case 't': threads = (size_t)strtoull(optarg, NULL, 0); break;
+        case 'i': iterations = atoi(optarg); break;
+        default: usage(argv[0]);
+        }
+    }
+    if (accesses == 0 || threads == 0 || iterations <= 0) usage(argv[0]);
+
+    tls_object = cap_malloc(sizeof(uint64_t));
+    if (cap_is_null(tls_object)) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    bench_print_header("tls-thread", "THREAD-LOCAL STORAGE AND THREAD STARTUP WORKLOAD");
+    printf("TLS: %llu accesses, threads: %zu create+join, best of %d\n\n",
+           (unsigned long long)accesses, threads, iterations);
+
+    printf("TLS AND THREAD RESULTS\n");
+    printf("-------------------------------------------\n");
+    int failed = 0;
+    char metric[48];
+    for (int c = 0; c < TLS_COUNT && !failed; c++) {
+        double cycles = time_tls_case((tls_case_t)c, accesses, iterations);
+        if (cycles == 0.0) {
+            fprintf(stderr, "%s: counter mismatch\n", tls_names[c]);
+            failed = 1;
+            break;
+        }
+        snprintf(metric, sizeof(metric), "%s_cycles_per_access", tls_names[c]);
+        bench_report(metric, cycles, "cycles");
+    }
+
+    // Best of the iterations for each thread pattern, rate from wall time
+    for (int pattern = 0; pattern < 2 && !failed; pattern++) {
+        size_t batch = pattern == 0 ? 1 : BATCH_THREADS;
+        const char *name = pattern == 0 ? "serial" : "batch";
+        double best_cycles = 0.0, best_rate = 0.0;
+        for (int it = 0; it < iterations && !failed; it++) {
+            uint64_t start = bench_now_ns();
+            double cycles = time_threads(threads, batch, 0, empty_thread, &failed);
+            double rate = (double)threads / bench_seconds(start, bench_now_ns());
+            if (best_cycles == 0.0 || cycles < best_cycles) best_cycles = cycles;
+            if (rate > best_rate) best_rate = rate;
+        }
+        if (failed) {
+            fprintf(stderr, "%s: pthread_create failed\n", name);
+            break;
+        }
+        snprintf(metric, sizeof(metric), "%s_create_join_per_sec", name);
+        bench_report(metric, best_rate, "threads/s");
+        snprintf(metric, sizeof(metric), "%s_create_join_cycles", name);
+        bench_report(metric, best_cycles, "cycles");
+    }
+
+    // Stack setup: fewer threads, since the large stacks are mapped per thread
+    size_t stack_threads = threads / 10 > 0 ? threads / 10 : 1;
+    for (size_t s = 0; s < STACK_SIZE_COUNT && !failed; s++) {
+        double best = 0.0;
+        for (int it = 0; it < iterations && !failed; it++) {
+            double cycles = time_threads(stack_threads, BATCH_THREADS, stack_sizes[s], touch_thread, &failed);
+            if (best == 0.0 || cycles < best) best = cycles;
+        }
+        if (failed) {
+            fprintf(stderr, "%zu KB stacks: pthread_create failed\n", stack_sizes[s] / 1024);
+            break;
+        }
+        snprintf(metric, sizeof(metric), "stack_%zuk_create_join_cycles", stack_sizes[s] / 1024);
+        bench_report(metric, best, "cycles");
+    }
+    bench_report("max_rss_mb", (double)bench_max_rss_bytes() / (1 << 20), "MB");
+    bench_finish();
+
+    cap_free(tls_object);
+    return failed;
+}
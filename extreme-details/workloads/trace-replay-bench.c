@@ -0,0 +1,595 @@
+/*
+ * Real-World Application Stress Test - Trace Replay from Storage
+ *
+ * Replays a packet capture or a memory-access trace from a file through a
+ * consumer stage while the file is read ahead asynchronously
+ * (common/trace_reader.h): io_uring with registered buffers where the
+ * kernel offers it, a pool of pread threads otherwise. The stage sees each
+ * block as a capability bounded to it; records that straddle two blocks
+ * are reassembled in a bounded carry buffer.
+ *
+ * Stages:
+ *   checksum - sums the words of each block; shows what the reader alone sustains
+ *   pcap     - walks the pcap records and parses HTTP requests in TCP payloads
+ *   cache    - replays 8-byte address records through an L1/L2 cache model
+ *
+ * Without -f a synthetic trace of each kind is written to $TMPDIR and
+ * removed afterwards. Every replay starts with the file dropped from the
+ * page cache (best effort), and every backend's stage digest must match
+ * the first backend's.
+ */
+
+#define _GNU_SOURCE  // O_DIRECT on glibc
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "capmodel.h"
+#include "bench.h"
+#include "http_parser.h"
+#include "pcap.h"
+#include "trace_reader.h"
+
+// Benchmark configuration
+#define DEFAULT_SIZE_MB     256
+#define DEFAULT_BLOCK_KB    1024
+#define DEFAULT_DEPTH       8
+#define DEFAULT_READERS     4
+#define DEFAULT_ITERATIONS  3
+#define PCAP_MAX_SNAPLEN    262144
+#define MAX_REQUEST_SIZE    (16 * 1024)
+#define MEM_RECORD_SIZE     8
+
+// Cache model: 32 KiB 8-way L1, 1 MiB 16-way L2, 64-byte lines
+#define LINE_SHIFT          6
+#define L1_SETS             64
+#define L1_WAYS             8
+#define L2_SETS             1024
+#define L2_WAYS             16
+
+typedef enum { TRACE_PCAP = 0, TRACE_MEM } trace_kind_t;
+typedef enum { STAGE_CHECKSUM = 0, STAGE_PCAP, STAGE_CACHE } stage_kind_t;
+
+static const char *const trace_names[] = { "pcap", "mem" };
+static const char *const stage_names[] = { "checksum", "pcap", "cache" };
+
+typedef struct {
+    size_t block_size;
+    int depth;
+    int readers;
+    int iterations;
+    int direct;
+} options_t;
+
+static uint64_t rng_state = 0x853C49E6748FEA9Bull;
+
+// ---------------------------------------------------------------------------
+// Cache model
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    int sets, ways;
+    uint64_t *tags;         // sets * ways, 0 = empty (tags are stored + 1)
+    uint64_t *stamps;       // Last use, for LRU
+    uint64_t clock;
+    uint64_t hits, misses;
+} cache_level_t;
+
+static int cache_init(cache_level_t *c, int sets, int ways) {
+    memset(c, 0, sizeof(*c));
+    c->sets = sets;
+    c->ways = ways;
+    c->tags = calloc((size_t)sets * ways, sizeof(uint64_t));
+    c->stamps = calloc((size_t)sets * ways, sizeof(uint64_t));
+    return c->tags && c->stamps ? 0 : -1;
+}
+
+static void cache_free(cache_level_t *c) {
+    free(c->tags);
+    free(c->stamps);
+}
+
+// Look up a line, filling it on a miss; returns 1 on a hit
+static inline int cache_access(cache_level_t *c, uint64_t line) {
+    uint64_t tag = line + 1;
+    size_t base = (size_t)(line % (uint64_t)c->sets) * c->ways;
+    size_t victim = base;
+    c->clock++;
+    for (int w = 0; w < c->ways; w++) {
+        if (c->tags[base + w] == tag) {
+            c->stamps[base + w] = c->clock;
+            c->hits++;
+            return 1;
+        }
+        if (c->stamps[base + w] < c->stamps[victim]) victim = base + w;
+    }
+    c->tags[victim] = tag;
+    c->stamps[victim] = c->clock;
+    c->misses++;
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// Consumer stages
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    stage_kind_t kind;
+    uint64_t digest;
+    uint64_t items;         // pcap: requests parsed, cache: accesses
+    uint64_t records;       // pcap: packets
+    http_scan_t scan;
+
+    // pcap reassembly
+    int started;
+    int swapped;
+    cap_ptr_t carry;        // Record split across blocks
+    size_t carry_len;
+    size_t carry_need;
+
+    cache_level_t l1, l2;
+} stage_t;
+
+static http_scan_t best_scan(void) {
+    for (int s = HTTP_SCAN_MODES - 1; s > HTTP_SCAN_SCALAR; s--) {
+        if (http_scan_supported((http_scan_t)s)) return (http_scan_t)s;
+    }
+    return HTTP_SCAN_SCALAR;
+}
+
+static int stage_init(stage_t *st, stage_kind_t kind) {
+    memset(st, 0, sizeof(*st));
+    st->kind = kind;
+    st->scan = best_scan();
+    if (kind == STAGE_PCAP) {
+        st->carry = cap_malloc(PCAP_RECORD_HEADER_LEN + PCAP_MAX_SNAPLEN);
+        if (cap_is_null(st->carry)) return -1;
+    } else if (kind == STAGE_CACHE) {
+        if (cache_init(&st->l1, L1_SETS, L1_WAYS) != 0 || cache_init(&st->l2, L2_SETS, L2_WAYS) != 0) return -1;
+    }
+    return 0;
+}
+
+static void stage_free(stage_t *st) {
+    if (!cap_is_null(st->carry)) cap_free(st->carry);
+    cache_free(&st->l1);
+    cache_free(&st->l2);
+}
+
+static void checksum_block(stage_t *st, cap_ptr_t block, size_t len) {
+    const unsigned char *p = cap_check(block, 0, len);
+    uint64_t sum = st->digest;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t w;
+        memcpy(&w, p + i, 8);
+        sum += w ^ (sum >> 29);
+    }
+    for (; i < len; i++) sum = sum * 31 + p[i];
+    st->digest = sum;
+}
+
+static inline uint64_t request_digest(const http_request_t *req) {
+    uint64_t d = req->method_len * 31u + req->path_len * 17u + req->body_len + req->num_headers;
+    for (size_t h = 0; h < req->num_headers; h++) {
+        d = d * 1099511628211ull + req->headers[h].name_len * 131u + req->headers[h].value_len;
+    }
+    return d;
+}
+
+// One whole record (header + frame) inside view at off
+static void pcap_record(stage_t *st, cap_ptr_t view, size_t off, size_t caplen) {
+    size_t frame_off = off + PCAP_RECORD_HEADER_LEN;
+    const unsigned char *frame = cap_check(view, frame_off, caplen);
+    size_t payload_off, payload_len;
+    http_request_t req;
+
+    st->records++;
+    if (pcap_tcp_payload(frame, caplen, &payload_off, &payload_len) != 0 ||
+        !pcap_is_http_request(frame + payload_off, payload_len)) {
+        return;
+    }
+    // The parser only sees the payload's bytes
+    cap_ptr_t payload = cap_sub(view, frame_off + payload_off, payload_len);
+    if (http_parse_request(payload, payload_len, &req, st->scan) > 0) {
+        st->digest += request_digest(&req);
+        st->items++;
+    }
+}
+
+// Append up to the record's missing bytes to the carry buffer; returns bytes taken
+static size_t pcap_carry(stage_t *st, const unsigned char *p, size_t avail) {
+    size_t take = st->carry_need - st->carry_len;
+    if (take > avail) take = avail;
+    memcpy(cap_check(st->carry, st->carry_len, take), p, take);
+    st->carry_len += take;
+    return take;
+}
+
+static int pcap_block(stage_t *st, cap_ptr_t block, size_t len) {
+    const unsigned char *p = cap_check(block, 0, len);
+    size_t pos = 0;
+
+    if (!st->started) {
+        pcap_reader_t reader;
+        if (pcap_open(&reader, p, len) != 0 || reader.linktype != PCAP_LINKTYPE_ETHERNET) return -1;
+        st->swapped = reader.swapped;
+        st->started = 1;
+        pos = PCAP_GLOBAL_HEADER_LEN;
+    }
+    while (pos < len) {
+        if (st->carry_len > 0) {
+            pos += pcap_carry(st, p + pos, len - pos);
+            if (st->carry_len < st->carry_need) break;
+            const unsigned char *h = cap_check(st->carry, 0, PCAP_RECORD_HEADER_LEN);
+            uint32_t caplen = pcap_u32(h + 8, st->swapped);
+            if (st->carry_need == PCAP_RECORD_HEADER_LEN) {
+                // Header complete: now wait for its frame
+                if (caplen > PCAP_MAX_SNAPLEN) return -1;
+                st->carry_need += caplen;
+                if (caplen > 0) continue;
+            }
+            pcap_record(st, st->carry, 0, caplen);
+            st->carry_len = 0;
+            continue;
+        }
+
+        size_t left = len - pos;
+        uint32_t caplen = left >= PCAP_RECORD_HEADER_LEN ? pcap_u32(p + pos + 8, st->swapped) : 0;
+        if (caplen > PCAP_MAX_SNAPLEN) return -1;
+        if (left < PCAP_RECORD_HEADER_LEN || left < PCAP_RECORD_HEADER_LEN + (size_t)caplen) {
+            st->carry_need = left < PCAP_RECORD_HEADER_LEN ? PCAP_RECORD_HEADER_LEN
+                                                           : PCAP_RECORD_HEADER_LEN + (size_t)caplen;
+            pos += pcap_carry(st, p + pos, left);
+            break;
+        }
+        pcap_record(st, block, pos, caplen);
+        pos += PCAP_RECORD_HEADER_LEN + caplen;
+    }
+    return 0;
+}
+
+// Address records: bit 0 flags a store, the rest is the byte address
+static void cache_block(stage_t *st, cap_ptr_t block, size_t len) {
+    const unsigned char *p = cap_check(block, 0, len);
+    uint64_t stores = 0;
+    for (size_t i = 0; i + MEM_RECORD_SIZE <= len; i += MEM_RECORD_SIZE) {
+        uint64_t rec;
+        memcpy(&rec, p + i, MEM_RECORD_SIZE);
+        uint64_t line = (rec & ~1ull) >> LINE_SHIFT;
+        stores += rec & 1;
+        if (!cache_access(&st->l1, line)) cache_access(&st->l2, line);
+    }
+    st->items += len / MEM_RECORD_SIZE;
+    st->digest = st->l1.hits * 1000003u + st->l2.hits * 31u + st->l2.misses;
+    st->records += stores;
+}
+
+static int stage_feed(stage_t *st, cap_ptr_t block, size_t len) {
+    switch (st->kind) {
+    case STAGE_CHECKSUM: checksum_block(st, block, len); return 0;
+    case STAGE_PCAP: return pcap_block(st, block, len);
+    case STAGE_CACHE: cache_block(st, block, len); return 0;
+    }
+    return -1;
+}
+
+// ---------------------------------------------------------------------------
+// Synthetic traces
+// ---------------------------------------------------------------------------
+
+static int write_record(FILE *f, const unsigned char *frame, size_t len, uint32_t seq) {
+    uint32_t header[4] = { 1700000000u + seq / 1000, (seq % 1000) * 1000, (uint32_t)len, (uint32_t)len };
+    return fwrite(header, sizeof(header), 1, f) == 1 && fwrite(frame, len, 1, f) == 1 ? 0 : -1;
+}
+
+// Requests, the bare ACKs that follow them and short responses
+static int generate_pcap(FILE *f, uint64_t size) {
+    uint32_t global[6] = { 0xa1b2c3d4u, 0x00040002u, 0, 0, PCAP_MAX_SNAPLEN, PCAP_LINKTYPE_ETHERNET };
+    static const char response[] = "HTTP/1.1 204 No Content\r\nServer: trace\r\n\r\n";
+    char *request = malloc(MAX_REQUEST_SIZE);
+    unsigned char *frame = malloc(MAX_REQUEST_SIZE + 64);
+    int rc = request && frame && fwrite(global, sizeof(global), 1, f) == 1 ? 0 : -1;
+    uint64_t written = sizeof(global);
+
+    for (uint32_t seq = 0; rc == 0 && written < size; seq++) {
+        unsigned port = 1024 + (unsigned)(bench_rng_next(&rng_state) % 60000);
+        size_t len;
+        switch (bench_rng_next(&rng_state) % 4) {
+        case 0: len = pcap_build_frame(frame, "", 0, port); break;
+        case 1: len = pcap_build_frame(frame, response, sizeof(response) - 1, port); break;
+        default: len = pcap_build_frame(frame, request, pcap_generate_request(request, MAX_REQUEST_SIZE, &rng_state), port); break;
+        }
+        rc = write_record(f, frame, len, seq);
+        written += PCAP_RECORD_HEADER_LEN + len;
+    }
+    free(request);
+    free(frame);
+    return rc;
+}
+
+// Array sweeps, a hot working set and scattered cold accesses
+static int generate_mem(FILE *f, uint64_t size) {
+    enum { BATCH = 4096 };
+    uint64_t records[BATCH];
+    uint64_t stream[4] = { 0x10000000, 0x20000000, 0x30000000, 0x40000000 };
+    for (uint64_t written = 0; written < size; written += sizeof(records)) {
+        for (int i = 0; i < BATCH; i++) {
+            uint64_t pick = bench_rng_next(&rng_state) % 100, addr;
+            if (pick < 60) {
+                int s = (int)(bench_rng_next(&rng_state) % 4);
+                addr = stream[s];
+                stream[s] += 8;
+            } else if (pick < 90) {
+                addr = 0x50000000 + (bench_rng_next(&rng_state) % (256 * 1024));
+            } else {
+                addr = 0x60000000 + (bench_rng_next(&rng_state) % (256ull << 20));
+            }
+            records[i] = (addr & ~7ull) | (bench_rng_next(&rng_state) % 10 < 3);
+        }
+        if (fwrite(records, sizeof(records), 1, f) != 1) return -1;
+    }
+    return 0;
+}
+
+// Drop the file's pages so the replay reads from storage (best effort)
+static void drop_cache(const char *path) {
+#ifdef POSIX_FADV_DONTNEED
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return;
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+#else
+    (void)path;
+#endif
+}
+
+static int create_trace(trace_kind_t kind, uint64_t size, char *path, size_t path_size) {
+    const char *dir = getenv("TMPDIR");
+    snprintf(path, path_size, "%s/trace-replay-%s-XXXXXX", dir && *dir ? dir : "/tmp", trace_names[kind]);
+    int fd = mkstemp(path);
+    if (fd < 0) return -1;
+    FILE *f = fdopen(fd, "wb");
+    if (!f) {
+        close(fd);
+        unlink(path);
+        return -1;
+    }
+    setvbuf(f, NULL, _IOFBF, 1 << 20);
+    int rc = kind == TRACE_PCAP ? generate_pcap(f, size) : generate_mem(f, size);
+    if (fflush(f) != 0 || fsync(fileno(f)) != 0) rc = -1;
+    fclose(f);
+    if (rc != 0) unlink(path);
+    return rc;
+}
+
+static trace_kind_t detect_trace(const char *path) {
+    unsigned char magic[4] = { 0 };
+    FILE *f = fopen(path, "rb");
+    if (f) {
+        if (fread(magic, 1, sizeof(magic), f) != sizeof(magic)) memset(magic, 0, sizeof(magic));
+        fclose(f);
+    }
+    pcap_reader_t reader;
+    unsigned char header[PCAP_GLOBAL_HEADER_LEN] = { 0 };
+    memcpy(header, magic, sizeof(magic));
+    return pcap_open(&reader, header, sizeof(header)) == 0 ? TRACE_PCAP : TRACE_MEM;
+}
+
+// ---------------------------------------------------------------------------
+// Benchmark
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    double seconds;
+    uint64_t bytes;
+    double idle_pct;        // Consumer waiting for data
+    double stall_pct;       // Readers waiting for a free buffer, per reader
+    uint64_t digest;
+    uint64_t items;
+    uint64_t records;
+    double l1_miss_rate, l2_miss_rate;
+    int registered;
+} replay_t;
+
+static int replay(const char *path, tr_backend_t backend, stage_kind_t kind, const options_t *o, replay_t *out) {
+    stage_t st;
+    tr_reader_t r;
+    int failed = 0;
+
+    drop_cache(path);
+    if (stage_init(&st, kind) != 0) {
+        fprintf(stderr, "Out of memory\n");
+        stage_free(&st);
+        return -1;
+    }
+    if (tr_open(&r, path, backend, o->block_size, o->depth, o->readers, o->direct) != 0) {
+        fprintf(stderr, "%s: %s reader: %s\n", path, tr_backend_name(backend), strerror(errno));
+        tr_close(&r);
+        stage_free(&st);
+        return -1;
+    }
+    size_t len;
+    cap_ptr_t block;
+    while (!cap_is_null(block = tr_next(&r, &len))) {
+        if (stage_feed(&st, block, len) != 0) {
+            fprintf(stderr, "%s: malformed %s trace\n", path, stage_names[kind]);
+            failed = 1;
+            break;
+        }
+        tr_release(&r);
+    }
+    int err = tr_close(&r);
+    if (err) {
+        fprintf(stderr, "%s: read failed: %s\n", path, strerror(err));
+        failed = 1;
+    }
+
+    out->seconds = bench_seconds(r.start_ns, r.end_ns);
+    out->bytes = r.file_size;
+    out->idle_pct = 100.0 * (double)r.consumer_wait_ns / (double)(r.end_ns - r.start_ns + 1);
+    out->stall_pct = 100.0 * (double)r.reader_wait_ns / r.threads / (double)(r.end_ns - r.start_ns + 1);
+    out->digest = st.digest;
+    out->items = st.items;
+    out->records = st.records;
+    out->l1_miss_rate = st.l1.hits + st.l1.misses ? (double)st.l1.misses / (double)(st.l1.hits + st.l1.misses) : 0.0;
+    out->l2_miss_rate = st.l2.hits + st.l2.misses ? (double)st.l2.misses / (double)(st.l2.hits + st.l2.misses) : 0.0;
+    out->registered = r.registered;
+    stage_free(&st);
+    return failed ? -1 : 0;
+}
+
+// Every backend x stage for one trace; returns nonzero on a failure or digest mismatch
+static int replay_trace(trace_kind_t kind, const char *path, const options_t *o, const int *backends) {
+    stage_kind_t stages[2] = { STAGE_CHECKSUM, kind == TRACE_PCAP ? STAGE_PCAP : STAGE_CACHE };
+    const char *trace = trace_names[kind];
+    char metric[48];
+    int failed = 0;
+
+    for (int s = 0; s < 2; s++) {
+        uint64_t reference = 0;
+        int have_reference = 0;
+        for (int b = 0; b < TR_BACKENDS; b++) {
+            if (!backends[b]) continue;
+            replay_t best = { 0 };
+            double best_rate = 0.0;
+            for (int it = 0; it < o->iterations; it++) {
+                replay_t run;
+                if (replay(path, (tr_backend_t)b, stages[s], o, &run) != 0) return 1;
+                if (!have_reference) {
+                    reference = run.digest;
+                    have_reference = 1;
+                } else if (run.digest != reference) {
+                    fprintf(stderr, "%s %s stage: %s digest disagrees\n", trace, stage_names[stages[s]],
+                            tr_backend_name((tr_backend_t)b));
+                    failed = 1;
+                }
+                double rate = (double)run.bytes / run.seconds / 1e6;
+                if (rate > best_rate) {
+                    best_rate = rate;
+                    best = run;
+                }
+            }
+            const char *name = tr_backend_name((tr_backend_t)b);
+            snprintf(metric, sizeof(metric), "%s_%s_%s_read_mbps", trace, name, stage_names[stages[s]]);
+            bench_report(metric, best_rate, "MB/s");
+            snprintf(metric, sizeof(metric), "%s_%s_%s_consumer_idle_pct", trace, name, stage_names[stages[s]]);
+            bench_report(metric, best.idle_pct, "%");
+            snprintf(metric, sizeof(metric), "%s_%s_%s_reader_stall_pct", trace, name, stage_names[stages[s]]);
+            bench_report(metric, best.stall_pct, "%");
+            if (stages[s] == STAGE_PCAP) {
+                snprintf(metric, sizeof(metric), "%s_%s_requests_per_sec", trace, name);
+                bench_report(metric, (double)best.items / best.seconds, "req/s");
+            } else if (stages[s] == STAGE_CACHE) {
+                snprintf(metric, sizeof(metric), "%s_%s_accesses_per_sec", trace, name);
+                bench_report(metric, (double)best.items / best.seconds, "acc/s");
+            }
+            if (b == TR_BACKEND_URING && s == 0) {
+                snprintf(metric, sizeof(metric), "%s_uring_fixed_buffers", trace);
+                bench_report(metric, best.registered, "bool");
+            }
+            if (stages[s] == STAGE_PCAP && b == TR_BACKEND_PREAD) {
+                snprintf(metric, sizeof(metric), "%s_packets", trace);
+                bench_report(metric, (double)best.records, "packets");
+                snprintf(metric, sizeof(metric), "%s_http_requests", trace);
+                bench_report(metric, (double)best.items, "requests");
+            }
+            if (stages[s] == STAGE_CACHE && b == TR_BACKEND_PREAD) {
+                bench_report("mem_l1_miss_rate", best.l1_miss_rate * 100.0, "%");
+                bench_report("mem_l2_miss_rate", best.l2_miss_rate * 100.0, "%");
+            }
+        }
+    }
+    return failed;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-f trace] [-t pcap|mem] [-s size_mb] [-b block_kb] [-q queue_depth]\n"
+                    "       [-r reader_threads] [-i iterations] [-d]\n", prog);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    options_t o = { (size_t)DEFAULT_BLOCK_KB * 1024, DEFAULT_DEPTH, DEFAULT_READERS, DEFAULT_ITERATIONS, 0 };
+    long size_mb = DEFAULT_SIZE_MB, block_kb = DEFAULT_BLOCK_KB;
+    const char *trace_path = NULL;
+    int only = -1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "f:t:s:b:q:r:i:dh")) != -1) {
+        switch (opt) {
+        case 'f': trace_path = optarg; break;
+        case 't':
+            if (strcmp(optarg, "pcap") == 0) only = TRACE_PCAP;
+            else if (strcmp(optarg, "mem") == 0) only = TRACE_MEM;
+            else usage(argv[0]);
+            break;
+        case 's': size_mb = atol(optarg); break;
+        case 'b': block_kb = atol(optarg); break;
+        case 'q': o.depth = atoi(optarg); break;
+        case 'r': o.readers = atoi(optarg); break;
+        case 'i': o.iterations = atoi(optarg); break;
+        case 'd': o.direct = 1; break;
+        default: usage(argv[0]);
+        }
+    }
+    if (size_mb <= 0 || block_kb <= 0 || block_kb > 65536 || o.depth < 2 || o.depth > TR_MAX_DEPTH ||
+        o.readers < 1 || o.readers > TR_MAX_THREADS || o.iterations <= 0) {
+        usage(argv[0]);
+    }
+    o.block_size = (size_t)block_kb * 1024;
+    if (o.direct && o.block_size % TR_BUFFER_ALIGN) {
+        fprintf(stderr, "-d needs a block size that is a multiple of %d KB\n", TR_BUFFER_ALIGN / 1024);
+        return 2;
+    }
+
+    bench_print_header("trace-replay", "ASYNCHRONOUS TRACE REPLAY WORKLOAD");
+
+    int backends[TR_BACKENDS];
+    for (int b = 0; b < TR_BACKENDS; b++) backends[b] = tr_backend_available((tr_backend_t)b);
+    if (!backends[TR_BACKEND_URING]) printf("io_uring unavailable: pread threads only\n");
+
+    trace_kind_t kinds[2];
+    char paths[2][512];
+    int trace_count = 0, temporary = trace_path == NULL;
+    if (trace_path) {
+        kinds[0] = detect_trace(trace_path);
+        snprintf(paths[0], sizeof(paths[0]), "%s", trace_path);
+        trace_count = 1;
+    } else {
+        for (int k = TRACE_PCAP; k <= TRACE_MEM; k++) {
+            if (only >= 0 && k != only) continue;
+            if (create_trace((trace_kind_t)k, (uint64_t)size_mb << 20, paths[trace_count],
+                             sizeof(paths[trace_count])) != 0) {
+                perror("Cannot write synthetic trace");
+                for (int t = 0; t < trace_count; t++) unlink(paths[t]);
+                return 1;
+            }
+            kinds[trace_count++] = (trace_kind_t)k;
+        }
+    }
+    printf("Block %zu KB, queue depth %d, %d pread threads, best of %d%s\n\n", o.block_size / 1024, o.depth,
+           o.readers, o.iterations, o.direct ? ", O_DIRECT" : "");
+
+    printf("TRACE REPLAY RESULTS\n");
+    printf("-------------------------------------------\n");
+    int failed = 0;
+    for (int t = 0; t < trace_count; t++) {
+        struct stat st;
+        if (stat(paths[t], &st) == 0) {
+            char metric[48];
+            snprintf(metric, sizeof(metric), "%s_trace_mb", trace_names[kinds[t]]);
+            bench_report(metric, (double)st.st_size / (1 << 20), "MB");
+        }
+        failed |= replay_trace(kinds[t], paths[t], &o, backends);
+        if (temporary) unlink(paths[t]);
+    }
+    bench_report("max_rss_mb", (double)bench_max_rss_bytes() / (1 << 20), "MB");
+    bench_finish();
+    return failed;
+}
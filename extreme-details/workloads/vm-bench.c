@@ -0,0 +1,607 @@
+/*
+ * Real-World Application Stress Test - Bytecode Interpreter
+ *
+ * A stack-machine VM (common/vm.h) whose operand stack, call frames, code,
+ * constants and every heap object are bounded capabilities, and whose
+ * values are as wide as a capability plus a tag. Three bytecode programs
+ * stress different paths:
+ *   fib     - recursive calls: frame push/pop and operand stack traffic
+ *   nbody   - floating point over a heap array (Computer Language
+ *             Benchmarks Game n-body, five bodies)
+ *   strings - integer-to-string conversion and appends into growing
+ *             heap strings
+ * Each program runs under computed-goto and switch dispatch, with every VM
+ * access checked and with the same accesses unchecked; the difference is
+ * the time spent on software bounds checks. Where Linux perf counters are
+ * available, retired instructions per bytecode are reported as well.
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+#include "capmodel.h"
+#include "bench.h"
+#include "vm.h"
+
+#define VM_NAME(x) vm_goto_##x
+#define VM_COMPUTED_GOTO 1
+#define VM_CHECKED 1
+#include "vm_interp.h"
+
+#define VM_NAME(x) vm_switch_##x
+#define VM_COMPUTED_GOTO 0
+#define VM_CHECKED 1
+#include "vm_interp.h"
+
+#define VM_NAME(x) vm_goto_unchecked_##x
+#define VM_COMPUTED_GOTO 1
+#define VM_CHECKED 0
+#include "vm_interp.h"
+
+#define VM_NAME(x) vm_switch_unchecked_##x
+#define VM_COMPUTED_GOTO 0
+#define VM_CHECKED 0
+#include "vm_interp.h"
+
+// Benchmark configuration
+#define DEFAULT_FIB_N        30
+#define DEFAULT_NBODY_STEPS  100000
+#define DEFAULT_STRING_ITEMS 200000
+#define DEFAULT_ITERATIONS   3
+#define STACK_SLOTS          (1 << 16)
+#define FRAME_SLOTS          (1 << 14)
+#define BASE_HEAP_BYTES      (16u << 20)
+#define HEAP_BYTES_PER_ITEM  96         // itoa temporaries + share of the output string
+#define NBODY_BODIES         5
+#define NBODY_FIELDS         7          // x y z vx vy vz mass
+#define NBODY_DT             0.01
+
+typedef int (*vm_run_fn)(vm_t *vm, uint32_t func);
+
+typedef struct {
+    const char *name;
+    vm_run_fn run;
+    int checked;
+} variant_t;
+
+static const variant_t variants[] = {
+    { "goto", vm_goto_run, 1 },
+    { "switch", vm_switch_run, 1 },
+    { "goto_unchecked", vm_goto_unchecked_run, 0 },
+    { "switch_unchecked", vm_switch_unchecked_run, 0 },
+};
+#define VARIANT_COUNT (sizeof(variants) / sizeof(variants[0]))
+
+typedef struct {
+    const char *name;
+    vm_program_t prog;
+    int32_t main;
+} program_t;
+
+// ---------------------------------------------------------------------------
+// Programs
+// ---------------------------------------------------------------------------
+
+static int build_fib(program_t *p, int n) {
+    vm_asm_t a;
+    memset(&a, 0, sizeof(a));
+    int32_t fib = vm_declare_func(&a, 1, 0);
+    p->main = vm_declare_func(&a, 0, 0);
+
+    vm_begin_func(&a, fib);
+    vm_emit(&a, VM_OP_LOAD, 0);
+    vm_emit(&a, VM_OP_PUSHI, 2);
+    vm_emit(&a, VM_OP_LT, 0);
+    uint32_t recurse = vm_emit_jump(&a, VM_OP_JF);
+    vm_emit(&a, VM_OP_LOAD, 0);
+    vm_emit(&a, VM_OP_RET, 0);
+    vm_patch(&a, recurse, vm_here(&a));
+    vm_emit(&a, VM_OP_LOAD, 0);
+    vm_emit(&a, VM_OP_PUSHI, 1);
+    vm_emit(&a, VM_OP_SUB, 0);
+    vm_emit(&a, VM_OP_CALL, fib);
+    vm_emit(&a, VM_OP_LOAD, 0);
+    vm_emit(&a, VM_OP_PUSHI, 2);
+    vm_emit(&a, VM_OP_SUB, 0);
+    vm_emit(&a, VM_OP_CALL, fib);
+    vm_emit(&a, VM_OP_ADD, 0);
+    vm_emit(&a, VM_OP_RET, 0);
+
+    vm_begin_func(&a, p->main);
+    vm_emit(&a, VM_OP_PUSHI, n);
+    vm_emit(&a, VM_OP_CALL, fib);
+    vm_emit(&a, VM_OP_HALT, 0);
+    return vm_asm_finish(&a, &p->prog);
+}
+
+// Sun, Jupiter, Saturn, Uranus, Neptune with the sun's velocity offset so
+// total momentum is zero
+static void nbody_initial(double *bodies) {
+    const double pi = 3.141592653589793, solar_mass = 4 * pi * pi, days = 365.24;
+    static const double init[NBODY_BODIES][NBODY_FIELDS] = {
+        { 0, 0, 0, 0, 0, 0, 1 },
+        { 4.84143144246472090e+00, -1.16032004402742839e+00, -1.03622044471123109e-01, 1.66007664274403694e-03,
+          7.69901118419740425e-03, -6.90460016972063023e-05, 9.54791938424326609e-04 },
+        { 8.34336671824457987e+00, 4.12479856412430479e+00, -4.03523417114321381e-01, -2.76742510726862411e-03,
+          4.99852801234917238e-03, 2.30417297573763929e-05, 2.85885980666130812e-04 },
+        { 1.28943695621391310e+01, -1.51111514016986312e+01, -2.23307578892655734e-01, 2.96460137564761618e-03,
+          2.37847173959480950e-03, -2.96589568540237556e-05, 4.36624404335156298e-05 },
+        { 1.53796971148509165e+01, -2.59193146099879641e+01, 1.79258772950371181e-01, 2.68067772490389322e-03,
+          1.62824170038242295e-03, -9.51592254519715870e-05, 5.15138902046611451e-05 },
+    };
+    double px = 0, py = 0, pz = 0;
+    for (int i = 0; i < NBODY_BODIES; i++) {
+        double *b = bodies + i * NBODY_FIELDS;
+        for (int f = 0; f < 3; f++) b[f] = init[i][f];
+        for (int f = 3; f < 6; f++) b[f] = init[i][f] * days;
+        b[6] = init[i][6] * solar_mass;
+        px += b[3] * b[6];
+        py += b[4] * b[6];
+        pz += b[5] * b[6];
+    }
+    bodies[3] = -px / solar_mass;
+    bodies[4] = -py / solar_mass;
+    bodies[5] = -pz / solar_mass;
+}
+
+// Reference with the same operation order as the bytecode
+static void nbody_reference(double *b, int steps) {
+    for (int s = 0; s < steps; s++) {
+        for (int i = 0; i < NBODY_BODIES; i++) {
+            double *bi = b + i * NBODY_FIELDS;
+            for (int j = i + 1; j < NBODY_BODIES; j++) {
+                double *bj = b + j * NBODY_FIELDS;
+                double d[3] = { bi[0] - bj[0], bi[1] - bj[1], bi[2] - bj[2] };
+                double d2 = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+                double mag = NBODY_DT / (d2 * sqrt(d2));
+                for (int c = 0; c < 3; c++) bi[3 + c] = bi[3 + c] - d[c] * bj[6] * mag;
+                for (int c = 0; c < 3; c++) bj[3 + c] = bj[3 + c] + d[c] * bi[6] * mag;
+            }
+        }
+        for (int i = 0; i < NBODY_BODIES; i++) {
+            double *bi = b + i * NBODY_FIELDS;
+            for (int c = 0; c < 3; c++) bi[c] = bi[c] + NBODY_DT * bi[3 + c];
+        }
+    }
+}
+
+// arr[base + field] address (array, index) and value
+static void emit_field_address(vm_asm_t *a, int arr, int base, int field) {
+    vm_emit(a, VM_OP_LOAD, arr);
+    vm_emit(a, VM_OP_LOAD, base);
+    vm_emit(a, VM_OP_PUSHI, field);
+    vm_emit(a, VM_OP_ADD, 0);
+}
+
+static void emit_field(vm_asm_t *a, int arr, int base, int field) {
+    emit_field_address(a, arr, base, field);
+    vm_emit(a, VM_OP_AGET, 0);
+}
+
+// local = local + delta
+static void emit_increment(vm_asm_t *a, int local, int delta) {
+    vm_emit(a, VM_OP_LOAD, local);
+    vm_emit(a, VM_OP_PUSHI, delta);
+    vm_emit(a, VM_OP_ADD, 0);
+    vm_emit(a, VM_OP_STORE, local);
+}
+
+static int build_nbody(program_t *p, int steps) {
+    enum { ARR = 0, DT, I, J, BI, BJ, DX, DY, DZ, D2, MAG, ADVANCE_SLOTS };
+    vm_asm_t a;
+    memset(&a, 0, sizeof(a));
+    int32_t advance = vm_declare_func(&a, 2, ADVANCE_SLOTS - 2);
+    p->main = vm_declare_func(&a, 0, 2);
+
+    vm_begin_func(&a, advance);
+    vm_emit(&a, VM_OP_PUSHI, 0);
+    vm_emit(&a, VM_OP_STORE, I);
+    uint32_t loop_i = vm_here(&a);
+    vm_emit(&a, VM_OP_LOAD, I);
+    vm_emit(&a, VM_OP_PUSHI, NBODY_BODIES);
+    vm_emit(&a, VM_OP_LT, 0);
+    uint32_t exit_i = vm_emit_jump(&a, VM_OP_JF);
+    vm_emit(&a, VM_OP_LOAD, I);
+    vm_emit(&a, VM_OP_PUSHI, NBODY_FIELDS);
+    vm_emit(&a, VM_OP_MUL, 0);
+    vm_emit(&a, VM_OP_STORE, BI);
+    vm_emit(&a, VM_OP_LOAD, I);
+    vm_emit(&a, VM_OP_PUSHI, 1);
+    vm_emit(&a, VM_OP_ADD, 0);
+    vm_emit(&a, VM_OP_STORE, J);
+    uint32_t loop_j = vm_here(&a);
+    vm_emit(&a, VM_OP_LOAD, J);
+    vm_emit(&a, VM_OP_PUSHI, NBODY_BODIES);
+    vm_emit(&a, VM_OP_LT, 0);
+    uint32_t exit_j = vm_emit_jump(&a, VM_OP_JF);
+    vm_emit(&a, VM_OP_LOAD, J);
+    vm_emit(&a, VM_OP_PUSHI, NBODY_FIELDS);
+    vm_emit(&a, VM_OP_MUL, 0);
+    vm_emit(&a, VM_OP_STORE, BJ);
+    for (int c = 0; c < 3; c++) {
+        emit_field(&a, ARR, BI, c);
+        emit_field(&a, ARR, BJ, c);
+        vm_emit(&a, VM_OP_SUB, 0);
+        vm_emit(&a, VM_OP_STORE, DX + c);
+    }
+    for (int c = 0; c < 3; c++) {
+        vm_emit(&a, VM_OP_LOAD, DX + c);
+        vm_emit(&a, VM_OP_LOAD, DX + c);
+        vm_emit(&a, VM_OP_MUL, 0);
+        if (c > 0) vm_emit(&a, VM_OP_ADD, 0);
+    }
+    vm_emit(&a, VM_OP_STORE, D2);
+    vm_emit(&a, VM_OP_LOAD, DT);
+    vm_emit(&a, VM_OP_LOAD, D2);
+    vm_emit(&a, VM_OP_LOAD, D2);
+    vm_emit(&a, VM_OP_SQRT, 0);
+    vm_emit(&a, VM_OP_MUL, 0);
+    vm_emit(&a, VM_OP_DIV, 0);
+    vm_emit(&a, VM_OP_STORE, MAG);
+    // v_i -= d * m_j * mag, v_j += d * m_i * mag
+    for (int side = 0; side < 2; side++) {
+        int self = side == 0 ? BI : BJ, other = side == 0 ? BJ : BI;
+        for (int c = 0; c < 3; c++) {
+            emit_field_address(&a, ARR, self, 3 + c);
+            emit_field(&a, ARR, self, 3 + c);
+            vm_emit(&a, VM_OP_LOAD, DX + c);
+            emit_field(&a, ARR, other, 6);
+            vm_emit(&a, VM_OP_MUL, 0);
+            vm_emit(&a, VM_OP_LOAD, MAG);
+            vm_emit(&a, VM_OP_MUL, 0);
+            vm_emit(&a, side == 0 ? VM_OP_SUB : VM_OP_ADD, 0);
+            vm_emit(&a, VM_OP_ASET, 0);
+        }
+    }
+    emit_increment(&a, J, 1);
+    vm_emit_jump_to(&a, VM_OP_JMP, loop_j);
+    vm_patch(&a, exit_j, vm_here(&a));
+    emit_increment(&a, I, 1);
+    vm_emit_jump_to(&a, VM_OP_JMP, loop_i);
+    vm_patch(&a, exit_i, vm_here(&a));
+
+    // Positions
+    vm_emit(&a, VM_OP_PUSHI, 0);
+    vm_emit(&a, VM_OP_STORE, I);
+    uint32_t loop_p = vm_here(&a);
+    vm_emit(&a, VM_OP_LOAD, I);
+    vm_emit(&a, VM_OP_PUSHI, NBODY_BODIES);
+    vm_emit(&a, VM_OP_LT, 0);
+    uint32_t exit_p = vm_emit_jump(&a, VM_OP_JF);
+    vm_emit(&a, VM_OP_LOAD, I);
+    vm_emit(&a, VM_OP_PUSHI, NBODY_FIELDS);
+    vm_emit(&a, VM_OP_MUL, 0);
+    vm_emit(&a, VM_OP_STORE, BI);
+    for (int c = 0; c < 3; c++) {
+        emit_field_address(&a, ARR, BI, c);
+        emit_field(&a, ARR, BI, c);
+        vm_emit(&a, VM_OP_LOAD, DT);
+        emit_field(&a, ARR, BI, 3 + c);
+        vm_emit(&a, VM_OP_MUL, 0);
+        vm_emit(&a, VM_OP_ADD, 0);
+        vm_emit(&a, VM_OP_ASET, 0);
+    }
+    emit_increment(&a, I, 1);
+    vm_emit_jump_to(&a, VM_OP_JMP, loop_p);
+    vm_patch(&a, exit_p, vm_here(&a));
+    vm_emit(&a, VM_OP_NIL, 0);
+    vm_emit(&a, VM_OP_RET, 0);
+
+    // main: locals 0 = bodies array, 1 = step
+    double bodies[NBODY_BODIES * NBODY_FIELDS];
+    nbody_initial(bodies);
+    vm_begin_func(&a, p->main);
+    vm_emit(&a, VM_OP_PUSHI, NBODY_BODIES * NBODY_FIELDS);
+    vm_emit(&a, VM_OP_NEWARR, 0);
+    vm_emit(&a, VM_OP_STORE, 0);
+    for (int k = 0; k < NBODY_BODIES * NBODY_FIELDS; k++) {
+        vm_emit(&a, VM_OP_LOAD, 0);
+        vm_emit(&a, VM_OP_PUSHI, k);
+        vm_emit(&a, VM_OP_PUSHK, vm_const_num(&a, bodies[k]));
+        vm_emit(&a, VM_OP_ASET, 0);
+    }
+    int32_t dt = vm_const_num(&a, NBODY_DT);
+    vm_emit(&a, VM_OP_PUSHI, 0);
+    vm_emit(&a, VM_OP_STORE, 1);
+    uint32_t loop_s = vm_here(&a);
+    vm_emit(&a, VM_OP_LOAD, 1);
+    vm_emit(&a, VM_OP_PUSHI, steps);
+    vm_emit(&a, VM_OP_LT, 0);
+    uint32_t exit_s = vm_emit_jump(&a, VM_OP_JF);
+    vm_emit(&a, VM_OP_LOAD, 0);
+    vm_emit(&a, VM_OP_PUSHK, dt);
+    vm_emit(&a, VM_OP_CALL, advance);
+    vm_emit(&a, VM_OP_POP, 0);
+    emit_increment(&a, 1, 1);
+    vm_emit_jump_to(&a, VM_OP_JMP, loop_s);
+    vm_patch(&a, exit_s, vm_here(&a));
+    vm_emit(&a, VM_OP_LOAD, 0);
+    vm_emit(&a, VM_OP_HALT, 0);
+    return vm_asm_finish(&a, &p->prog);
+}
+
+// main builds "0,1,2,...,items-1," from itoa() results
+static int build_strings(program_t *p, int items) {
+    enum { N = 0, TMP, OUT, ITOA_SLOTS };
+    vm_asm_t a;
+    memset(&a, 0, sizeof(a));
+    int32_t itoa = vm_declare_func(&a, 1, ITOA_SLOTS - 1);
+    p->main = vm_declare_func(&a, 0, 2);
+
+    // Digits least significant first into tmp, then reversed into out
+    vm_begin_func(&a, itoa);
+    vm_emit(&a, VM_OP_PUSHI, 12);
+    vm_emit(&a, VM_OP_NEWSTR, 0);
+    vm_emit(&a, VM_OP_STORE, TMP);
+    uint32_t digits = vm_here(&a);
+    vm_emit(&a, VM_OP_LOAD, TMP);
+    vm_emit(&a, VM_OP_LOAD, N);
+    vm_emit(&a, VM_OP_PUSHI, 10);
+    vm_emit(&a, VM_OP_MOD, 0);
+    vm_emit(&a, VM_OP_PUSHI, '0');
+    vm_emit(&a, VM_OP_ADD, 0);
+    vm_emit(&a, VM_OP_SPUSH, 0);
+    vm_emit(&a, VM_OP_STORE, TMP);
+    vm_emit(&a, VM_OP_LOAD, N);
+    vm_emit(&a, VM_OP_PUSHI, 10);
+    vm_emit(&a, VM_OP_DIV, 0);
+    vm_emit(&a, VM_OP_DUP, 0);
+    vm_emit(&a, VM_OP_STORE, N);
+    vm_emit(&a, VM_OP_PUSHI, 0);
+    vm_emit(&a, VM_OP_EQ, 0);
+    vm_emit_jump_to(&a, VM_OP_JF, digits);
+    vm_emit(&a, VM_OP_PUSHI, 12);
+    vm_emit(&a, VM_OP_NEWSTR, 0);
+    vm_emit(&a, VM_OP_STORE, OUT);
+    vm_emit(&a, VM_OP_LOAD, TMP);
+    vm_emit(&a, VM_OP_SLEN, 0);
+    vm_emit(&a, VM_OP_STORE, N);
+    uint32_t reverse = vm_here(&a);
+    vm_emit(&a, VM_OP_PUSHI, 0);
+    vm_emit(&a, VM_OP_LOAD, N);
+    vm_emit(&a, VM_OP_LT, 0);
+    uint32_t done = vm_emit_jump(&a, VM_OP_JF);
+    emit_increment(&a, N, -1);
+    vm_emit(&a, VM_OP_LOAD, OUT);
+    vm_emit(&a, VM_OP_LOAD, TMP);
+    vm_emit(&a, VM_OP_LOAD, N);
+    vm_emit(&a, VM_OP_SGET, 0);
+    vm_emit(&a, VM_OP_SPUSH, 0);
+    vm_emit(&a, VM_OP_STORE, OUT);
+    vm_emit_jump_to(&a, VM_OP_JMP, reverse);
+    vm_patch(&a, done, vm_here(&a));
+    vm_emit(&a, VM_OP_LOAD, OUT);
+    vm_emit(&a, VM_OP_RET, 0);
+
+    // main: locals 0 = output string, 1 = i
+    vm_begin_func(&a, p->main);
+    vm_emit(&a, VM_OP_PUSHI, 16);
+    vm_emit(&a, VM_OP_NEWSTR, 0);
+    vm_emit(&a, VM_OP_STORE, 0);
+    vm_emit(&a, VM_OP_PUSHI, 0);
+    vm_emit(&a, VM_OP_STORE, 1);
+    uint32_t loop = vm_here(&a);
+    vm_emit(&a, VM_OP_LOAD, 1);
+    vm_emit(&a, VM_OP_PUSHI, items);
+    vm_emit(&a, VM_OP_LT, 0);
+    uint32_t exit_loop = vm_emit_jump(&a, VM_OP_JF);
+    vm_emit(&a, VM_OP_LOAD, 0);
+    vm_emit(&a, VM_OP_LOAD, 1);
+    vm_emit(&a, VM_OP_CALL, itoa);
+    vm_emit(&a, VM_OP_SAPP, 0);
+    vm_emit(&a, VM_OP_PUSHI, ',');
+    vm_emit(&a, VM_OP_SPUSH, 0);
+    vm_emit(&a, VM_OP_STORE, 0);
+    emit_increment(&a, 1, 1);
+    vm_emit_jump_to(&a, VM_OP_JMP, loop);
+    vm_patch(&a, exit_loop, vm_here(&a));
+    vm_emit(&a, VM_OP_LOAD, 0);
+    vm_emit(&a, VM_OP_HALT, 0);
+    return vm_asm_finish(&a, &p->prog);
+}
+
+// ---------------------------------------------------------------------------
+// Result checks
+// ---------------------------------------------------------------------------
+
+static int check_fib(const vm_t *vm, int n) {
+    int64_t prev = 0, cur = 1;
+    for (int i = 1; i < n; i++) {
+        int64_t next = prev + cur;
+        prev = cur;
+        cur = next;
+    }
+    return vm->result.tag == VM_INT && vm->result.as.i == (n == 0 ? 0 : cur);
+}
+
+static int check_nbody(const vm_t *vm, int steps) {
+    double expected[NBODY_BODIES * NBODY_FIELDS];
+    nbody_initial(expected);
+    nbody_reference(expected, steps);
+    if (vm->result.tag != VM_ARR) return 0;
+    for (int k = 0; k < NBODY_BODIES * NBODY_FIELDS; k++) {
+        vm_value_t v = vm_elem(vm->result.as.ref, (uint32_t)k);
+        // FMA contraction may differ between the VM and the reference
+        if (v.tag != VM_NUM || fabs(v.as.d - expected[k]) > 1e-9 * (fabs(expected[k]) + 1.0)) return 0;
+    }
+    return 1;
+}
+
+static int check_strings(const vm_t *vm, int items) {
+    if (vm->result.tag != VM_STR) return 0;
+    uint32_t length;
+    const char *s = vm_str_bytes(vm->result.as.ref, &length);
+    size_t pos = 0;
+    char digits[16];
+    for (int i = 0; i < items; i++) {
+        int n = snprintf(digits, sizeof(digits), "%d,", i);
+        if (pos + (size_t)n > length || memcmp(s + pos, digits, (size_t)n) != 0) return 0;
+        pos += (size_t)n;
+    }
+    return pos == length;
+}
+
+// ---------------------------------------------------------------------------
+// Perf counters (Linux only)
+// ---------------------------------------------------------------------------
+
+static int perf_open_instructions(void) {
+#ifdef __linux__
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+    return -1;
+#endif
+}
+
+static void perf_start(int fd) {
+#ifdef __linux__
+    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+#else
+    (void)fd;
+#endif
+}
+
+static uint64_t perf_stop(int fd) {
+    uint64_t count = 0;
+#ifdef __linux__
+    ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    if (read(fd, &count, sizeof(count)) != sizeof(count)) count = 0;
+#else
+    (void)fd;
+#endif
+    return count;
+}
+
+// ---------------------------------------------------------------------------
+// Benchmark
+// ---------------------------------------------------------------------------
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-f fib_n] [-n nbody_steps] [-s string_items] [-i iterations]\n", prog);
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    int fib_n = DEFAULT_FIB_N;
+    int nbody_steps = DEFAULT_NBODY_STEPS;
+    int string_items = DEFAULT_STRING_ITEMS;
+    int iterations = DEFAULT_ITERATIONS;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "f:n:s:i:h")) != -1) {
+        switch (opt) {
+        case 'f': fib_n = atoi(optarg); break;
+        case 'n': nbody_steps = atoi(optarg); break;
+        case 's': string_items = atoi(optarg); break;
+        case 'i': iterations = atoi(optarg); break;
+        default: usage(argv[0]);
+        }
+    }
+    if (fib_n < 0 || fib_n > 40 || nbody_steps <= 0 || nbody_steps > VM_ARG_MAX || string_items <= 0 ||
+        string_items > VM_ARG_MAX || iterations <= 0) {
+        usage(argv[0]);
+    }
+
+    bench_print_header("vm", "BYTECODE INTERPRETER WORKLOAD");
+
+    program_t programs[3];
+    memset(programs, 0, sizeof(programs));
+    programs[0].name = "fib";
+    programs[1].name = "nbody";
+    programs[2].name = "strings";
+    if (build_fib(&programs[0], fib_n) != 0 || build_nbody(&programs[1], nbody_steps) != 0 ||
+        build_strings(&programs[2], string_items) != 0) {
+        fprintf(stderr, "Failed to assemble programs\n");
+        return 1;
+    }
+    size_t heap_bytes = BASE_HEAP_BYTES + (size_t)string_items * HEAP_BYTES_PER_ITEM;
+    int perf_fd = perf_open_instructions();
+    printf("Value: %zu bytes, stack %u slots, heap %zu MB, fib(%d), %d n-body steps, %d string items\n",
+           sizeof(vm_value_t), STACK_SLOTS, heap_bytes >> 20, fib_n, nbody_steps, string_items);
+    printf("Perf counters: %s\n\n", perf_fd >= 0 ? "instructions" : "unavailable");
+
+    printf("VM RESULTS\n");
+    printf("-------------------------------------------\n");
+    int failed = 0;
+    char metric[48];
+    for (int pi = 0; pi < 3; pi++) {
+        program_t *p = &programs[pi];
+        vm_t vm;
+        if (vm_init(&vm, &p->prog, STACK_SLOTS, FRAME_SLOTS, heap_bytes) != 0) {
+            fprintf(stderr, "Out of memory\n");
+            return 1;
+        }
+        // Variants interleaved and best-of taken, so drift and scheduler noise
+        // hit every variant alike
+        uint64_t best[VARIANT_COUNT];
+        double seconds[VARIANT_COUNT];
+        uint64_t ops = 0;
+        for (size_t v = 0; v < VARIANT_COUNT; v++) best[v] = UINT64_MAX;
+        for (int it = 0; it < iterations && !failed; it++) {
+            for (size_t v = 0; v < VARIANT_COUNT; v++) {
+                vm_reset(&vm);
+                uint64_t start = bench_now_ns();
+                int status = variants[v].run(&vm, (uint32_t)p->main);
+                uint64_t elapsed = bench_now_ns() - start;
+                if (elapsed < best[v]) best[v] = elapsed;
+                int ok = status == 0 && (pi == 0 ? check_fib(&vm, fib_n)
+                                       : pi == 1 ? check_nbody(&vm, nbody_steps)
+                                                 : check_strings(&vm, string_items));
+                if (!ok) {
+                    fprintf(stderr, "%s (%s): %s\n", p->name, variants[v].name,
+                            vm.error ? vm.error : "wrong result");
+                    failed = 1;
+                    break;
+                }
+                ops = vm.ops;
+            }
+        }
+        for (size_t v = 0; v < VARIANT_COUNT; v++) {
+            seconds[v] = (double)best[v] / 1e9;
+            snprintf(metric, sizeof(metric), "%s_%s_ops_per_sec", p->name, variants[v].name);
+            bench_report(metric, (double)ops / seconds[v], "ops/s");
+        }
+        snprintf(metric, sizeof(metric), "%s_ops", p->name);
+        bench_report(metric, (double)ops, "ops");
+        // Share of checked run time that disappears when the checks do
+        snprintf(metric, sizeof(metric), "%s_goto_check_time_fraction", p->name);
+        bench_report(metric, 1.0 - seconds[2] / seconds[0], "fraction");
+        snprintf(metric, sizeof(metric), "%s_switch_check_time_fraction", p->name);
+        bench_report(metric, 1.0 - seconds[3] / seconds[1], "fraction");
+
+        if (perf_fd >= 0) {
+            for (size_t v = 0; v < 2; v++) {
+                vm_reset(&vm);
+                perf_start(perf_fd);
+                variants[v].run(&vm, (uint32_t)p->main);
+                uint64_t instructions = perf_stop(perf_fd);
+                snprintf(metric, sizeof(metric), "%s_%s_instructions_per_op", p->name, variants[v].name);
+                bench_report(metric, (double)instructions / (double)vm.ops, "insns");
+            }
+        }
+        vm_free(&vm);
+        vm_program_free(&p->prog);
+    }
+    bench_report("value_bytes", (double)sizeof(vm_value_t), "bytes");
+    if (perf_fd >= 0) close(perf_fd);
+    bench_finish();
+    return failed;
+}
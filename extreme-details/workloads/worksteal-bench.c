@@ -0,0 +1,899 @@
+/*
+ * Real-World Application Stress Test - Work-Stealing Task Runtime
+ *
+ * Scheduling overhead of common/worksteal.h:
+ *   spawn   - fork-join Fibonacci with one task per call, against the same
+ *             recursion without tasks (cost of a spawn/sync pair)
+ *   steal   - time from pushing a task to a thief starting it
+ * and speedup across thread counts on data-parallel kernels:
+ *   fib     - the spawn tree itself (scheduler bound)
+ *   http    - parse a request corpus (parallel_reduce over requests)
+ *   lz4     - compress independent 64 KB blocks (parallel_for, one match
+ *             finder per worker)
+ *   sort    - fork-join mergesort with pdqsort leaves, each half handed to
+ *             its task as a capability bounded to that half
+ *   jacobi  - 5-point stencil sweeps over per-row capabilities
+ *             (parallel_reduce of the largest update)
+ *   bfs     - level-synchronous BFS over a random CSR graph (parallel_for
+ *             over the frontier)
+ * Tasks reach their data only through their bounded captures. Every
+ * kernel's checksum must match its single-thread run.
+ */
+
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "capmodel.h"
+#include "bench.h"
+#include "http_parser.h"
+#include "lz4_block.h"
+#include "pcap.h"
+#include "worksteal.h"
+
+#define SORT_T uint64_t
+#define SORT_KEY(ctx, e) (e)
+#define SORT_NAME(x) key_##x
+#include "sort_template.h"
+
+// Benchmark configuration
+#define DEFAULT_FIB         30
+#define DEFAULT_ITERATIONS  3
+#define STEAL_SAMPLES       2000
+#define HTTP_REQUESTS       200000
+#define HTTP_REQUEST_MAX    4096        // Generated requests stay below this
+#define HTTP_RESERVE        2048        // Corpus bytes per request, well above the mean
+#define LZ4_BYTES           (16u << 20)
+#define LZ4_BLOCK           (64u << 10)
+#define LZ4_SEARCH_DEPTH    4
+#define SORT_KEYS           (4u << 20)
+#define SORT_LEAF           (1u << 14)  // pdqsort below this many keys
+#define JACOBI_SIZE         1024
+#define JACOBI_SWEEPS       10
+#define BFS_VERTICES        (1u << 20)
+#define BFS_DEGREE          8
+#define BFS_FLUSH           256         // Discoveries buffered before appending to the next frontier
+
+static uint64_t rng_state = 0x853C49E6748FEA9Bull;
+
+typedef struct {
+    double scale;               // Multiplies every kernel's input size
+    int fib_n;
+    int max_threads;
+} config_t;
+
+static inline ws_value_t combine_sum(ws_value_t a, ws_value_t b) {
+    a.u += b.u;
+    return a;
+}
+
+static inline ws_value_t combine_max(ws_value_t a, ws_value_t b) {
+    return b.d > a.d ? b : a;
+}
+
+static inline uint64_t mix64(uint64_t h, uint64_t v) {
+    h ^= v + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2);
+    return h;
+}
+
+// ---------------------------------------------------------------------------
+// fib: one task per call
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    int n;
+    uint64_t result;
+} fib_frame_t;
+
+static uint64_t fib_serial(int n) {
+    return n < 2 ? (uint64_t)n : fib_serial(n - 1) + fib_serial(n - 2);
+}
+
+static void fib_task(ws_worker_t *w, cap_ptr_t capture) {
+    fib_frame_t *f = CAP_OBJ(capture, fib_frame_t);
+    if (f->n < 2) {
+        f->result = (uint64_t)f->n;
+        return;
+    }
+    fib_frame_t left = { f->n - 1, 0 };
+    fib_frame_t right = { f->n - 2, 0 };
+    ws_task_t task;
+    ws_spawn(w, &task, fib_task, cap_make(&left, sizeof(left)));
+    fib_task(w, cap_make(&right, sizeof(right)));
+    ws_sync(w, &task);
+    f->result = left.result + right.result;
+}
+
+typedef struct {
+    int n;
+    uint64_t result;
+} fib_state_t;
+
+static cap_ptr_t fib_setup(const config_t *cfg) {
+    cap_ptr_t state = cap_malloc(sizeof(fib_state_t));
+    if (!cap_is_null(state)) {
+        fib_state_t *s = CAP_OBJ(state, fib_state_t);
+        s->n = cfg->fib_n;
+        s->result = 0;
+    }
+    return state;
+}
+
+static void fib_root(ws_worker_t *w, cap_ptr_t state, size_t grain) {
+    (void)grain;
+    fib_state_t *s = CAP_OBJ(state, fib_state_t);
+    fib_frame_t f = { s->n, 0 };
+    fib_task(w, cap_make(&f, sizeof(f)));
+    s->result = f.result;
+}
+
+static uint64_t fib_check(cap_ptr_t state) {
+    return CAP_OBJ(state, fib_state_t)->result;
+}
+
+static void fib_teardown(cap_ptr_t state) {
+    cap_free(state);
+}
+
+// ---------------------------------------------------------------------------
+// http: parse every request of a corpus
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    cap_ptr_t corpus;           // char[bytes], requests back to back
+    size_t bytes;
+    cap_ptr_t offsets;          // uint64_t[count + 1]
+    size_t count;
+    http_scan_t scan;
+    uint64_t result;
+} http_state_t;
+
+static cap_ptr_t http_setup(const config_t *cfg) {
+    cap_ptr_t state = cap_malloc(sizeof(http_state_t));
+    if (cap_is_null(state)) return state;
+    http_state_t *s = CAP_OBJ(state, http_state_t);
+    memset(s, 0, sizeof(*s));
+    s->count = (size_t)(HTTP_REQUESTS * cfg->scale);
+    if (s->count == 0) s->count = 1;
+
+    size_t capacity = s->count * HTTP_RESERVE + HTTP_REQUEST_MAX;
+    char *corpus = malloc(capacity);
+    s->offsets = cap_malloc((s->count + 1) * sizeof(uint64_t));
+    if (!corpus || cap_is_null(s->offsets)) {
+        free(corpus);
+        cap_free(s->offsets);
+        cap_free(state);
+        return CAP_NULL;
+    }
+    size_t pos = 0;
+    for (size_t i = 0; i < s->count; i++) {
+        if (capacity - pos < HTTP_REQUEST_MAX) {
+            s->count = i;
+            break;
+        }
+        CAP_AT(s->offsets, uint64_t, i) = pos;
+        pos += pcap_generate_request(corpus + pos, HTTP_REQUEST_MAX, &rng_state);
+    }
+    CAP_AT(s->offsets, uint64_t, s->count) = pos;
+    s->bytes = pos;
+    s->corpus = cap_make(corpus, pos);
+
+    s->scan = HTTP_SCAN_SCALAR;
+    for (int scan = HTTP_SCAN_MODES - 1; scan >= 0; scan--) {
+        if (http_scan_supported((http_scan_t)scan)) {
+            s->scan = (http_scan_t)scan;
+            break;
+        }
+    }
+    return state;
+}
+
+static ws_value_t http_chunk(ws_worker_t *w, cap_ptr_t capture, size_t lo, size_t hi) {
+    (void)w;
+    const http_state_t *s = CAP_OBJ(capture, http_state_t);
+    const uint64_t *offsets = cap_check(s->offsets, lo * sizeof(uint64_t), (hi - lo + 1) * sizeof(uint64_t));
+    http_request_t req;
+    ws_value_t acc = { .u = 0 };
+    memset(&req, 0, sizeof(req));
+
+    for (size_t i = 0; i < hi - lo; i++) {
+        size_t len = offsets[i + 1] - offsets[i];
+        long parsed = http_parse_request(cap_sub(s->corpus, offsets[i], len), len, &req, s->scan);
+        if (parsed != (long)len) {
+            acc.u += 1ull << 48;    // Shows up in the checksum
+            continue;
+        }
+        acc.u += req.num_headers + ((uint64_t)req.path_len << 8) + ((uint64_t)req.body_len << 20);
+    }
+    return acc;
+}
+
+static void http_root(ws_worker_t *w, cap_ptr_t state, size_t grain) {
+    http_state_t *s = CAP_OBJ(state, http_state_t);
+    ws_value_t zero = { .u = 0 };
+    s->result = ws_parallel_reduce(w, 0, s->count, grain, http_chunk, combine_sum, zero, state).u;
+}
+
+static uint64_t http_check(cap_ptr_t state) {
+    return CAP_OBJ(state, http_state_t)->result;
+}
+
+static void http_teardown(cap_ptr_t state) {
+    http_state_t *s = CAP_OBJ(state, http_state_t);
+    cap_free(s->corpus);
+    cap_free(s->offsets);
+    cap_free(state);
+}
+
+// ---------------------------------------------------------------------------
+// lz4: compress independent blocks
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    cap_ptr_t input;            // unsigned char[bytes]
+    size_t bytes;
+    size_t blocks;
+    cap_ptr_t output;           // LZ4_COMPRESS_BOUND(LZ4_BLOCK) bytes per block
+    cap_ptr_t sizes;            // long[blocks]
+    cap_ptr_t matchers;         // lz4_matcher_t[max_threads], indexed by worker
+} lz4_state_t;
+
+static cap_ptr_t lz4_setup(const config_t *cfg) {
+    static const char *const words[] = {
+        "the", "request", "server", "capability", "bounds", "memory", "cache", "thread",
+        "packet", "header", "value", "index", "object", "pointer", "kernel", "buffer",
+    };
+    cap_ptr_t state = cap_malloc(sizeof(lz4_state_t));
+    if (cap_is_null(state)) return state;
+    lz4_state_t *s = CAP_OBJ(state, lz4_state_t);
+    memset(s, 0, sizeof(*s));
+    s->bytes = (size_t)(LZ4_BYTES * cfg->scale);
+    if (s->bytes < LZ4_BLOCK) s->bytes = LZ4_BLOCK;
+    s->blocks = (s->bytes + LZ4_BLOCK - 1) / LZ4_BLOCK;
+    s->input = cap_malloc(s->bytes);
+    s->output = cap_malloc(s->blocks * LZ4_COMPRESS_BOUND(LZ4_BLOCK));
+    s->sizes = cap_malloc(s->blocks * sizeof(long));
+    s->matchers = cap_malloc((size_t)cfg->max_threads * sizeof(lz4_matcher_t));
+    if (cap_is_null(s->input) || cap_is_null(s->output) || cap_is_null(s->sizes) || cap_is_null(s->matchers)) {
+        cap_free(s->input);
+        cap_free(s->output);
+        cap_free(s->sizes);
+        cap_free(s->matchers);
+        cap_free(state);
+        return CAP_NULL;
+    }
+    for (int i = 0; i < cfg->max_threads; i++) {
+        CAP_AT(s->matchers, lz4_matcher_t, i).search_depth = LZ4_SEARCH_DEPTH;
+    }
+
+    // Log-like text: dictionary words, numbers and the odd random byte
+    unsigned char *in = cap_check(s->input, 0, s->bytes);
+    size_t pos = 0;
+    while (pos < s->bytes) {
+        char token[32];
+        uint64_t r = bench_rng_next(&rng_state);
+        int len = (r & 7) == 0 ? snprintf(token, sizeof(token), "%llu ", (unsigned long long)(r >> 40))
+                               : snprintf(token, sizeof(token), "%s ", words[(r >> 8) % 16]);
+        if ((r & 0xFF00000) == 0) token[0] = (char)(r >> 32);
+        for (int i = 0; i < len && pos < s->bytes; i++) in[pos++] = (unsigned char)token[i];
+    }
+    return state;
+}
+
+static void lz4_chunk(ws_worker_t *w, cap_ptr_t capture, size_t lo, size_t hi) {
+    const lz4_state_t *s = CAP_OBJ(capture, lz4_state_t);
+    lz4_matcher_t *m = &CAP_AT(s->matchers, lz4_matcher_t, ws_worker_id(w));
+    size_t bound = LZ4_COMPRESS_BOUND(LZ4_BLOCK);
+
+    for (size_t b = lo; b < hi; b++) {
+        size_t offset = b * LZ4_BLOCK;
+        size_t len = s->bytes - offset < LZ4_BLOCK ? s->bytes - offset : LZ4_BLOCK;
+        CAP_AT(s->sizes, long, b) = lz4_compress(m, cap_sub(s->input, offset, len), len,
+                                                 cap_sub(s->output, b * bound, bound), bound);
+    }
+}
+
+static void lz4_root(ws_worker_t *w, cap_ptr_t state, size_t grain) {
+    lz4_state_t *s = CAP_OBJ(state, lz4_state_t);
+    ws_parallel_for(w, 0, s->blocks, grain, lz4_chunk, state);
+}
+
+static uint64_t lz4_check(cap_ptr_t state) {
+    lz4_state_t *s = CAP_OBJ(state, lz4_state_t);
+    uint64_t h = 0;
+    for (size_t b = 0; b < s->blocks; b++) h = mix64(h, (uint64_t)CAP_AT(s->sizes, long, b));
+    return h;
+}
+
+static void lz4_teardown(cap_ptr_t state) {
+    lz4_state_t *s = CAP_OBJ(state, lz4_state_t);
+    cap_free(s->input);
+    cap_free(s->output);
+    cap_free(s->sizes);
+    cap_free(s->matchers);
+    cap_free(state);
+}
+
+// ---------------------------------------------------------------------------
+// sort: fork-join mergesort
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    cap_ptr_t input;            // uint64_t[n], unsorted
+    cap_ptr_t keys;             // uint64_t[n], sorted in place
+    cap_ptr_t tmp;              // uint64_t[n], merge scratch
+    size_t n;
+} sort_state_t;
+
+typedef struct {
+    cap_ptr_t keys;             // Bounded to this subarray
+    cap_ptr_t tmp;
+    size_t n;
+} sort_frame_t;
+
+static cap_ptr_t sort_setup(const config_t *cfg) {
+    cap_ptr_t state = cap_malloc(sizeof(sort_state_t));
+    if (cap_is_null(state)) return state;
+    sort_state_t *s = CAP_OBJ(state, sort_state_t);
+    s->n = (size_t)(SORT_KEYS * cfg->scale);
+    if (s->n < 2) s->n = 2;
+    s->input = cap_malloc(s->n * sizeof(uint64_t));
+    s->keys = cap_malloc(s->n * sizeof(uint64_t));
+    s->tmp = cap_malloc(s->n * sizeof(uint64_t));
+    if (cap_is_null(s->input) || cap_is_null(s->keys) || cap_is_null(s->tmp)) {
+        cap_free(s->input);
+        cap_free(s->keys);
+        cap_free(s->tmp);
+        cap_free(state);
+        return CAP_NULL;
+    }
+    for (size_t i = 0; i < s->n; i++) CAP_AT(s->input, uint64_t, i) = bench_rng_next(&rng_state);
+    return state;
+}
+
+static void sort_task(ws_worker_t *w, cap_ptr_t capture) {
+    sort_frame_t *f = CAP_OBJ(capture, sort_frame_t);
+    size_t n = f->n;
+    if (n <= SORT_LEAF) {
+        sort_ctx_t ctx;
+        memset(&ctx, 0, sizeof(ctx));
+        key_pdqsort(cap_check(f->keys, 0, n * sizeof(uint64_t)), n, &ctx);
+        return;
+    }
+    size_t half = n / 2;
+    sort_frame_t left = { cap_sub(f->keys, 0, half * sizeof(uint64_t)),
+                          cap_sub(f->tmp, 0, half * sizeof(uint64_t)), half };
+    sort_frame_t right = { cap_sub(f->keys, half * sizeof(uint64_t), (n - half) * sizeof(uint64_t)),
+                           cap_sub(f->tmp, half * sizeof(uint64_t), (n - half) * sizeof(uint64_t)), n - half };
+    ws_task_t task;
+    ws_spawn(w, &task, sort_task, cap_make(&left, sizeof(left)));
+    sort_task(w, cap_make(&right, sizeof(right)));
+    ws_sync(w, &task);
+
+    uint64_t *a = cap_check(f->keys, 0, n * sizeof(uint64_t));
+    uint64_t *t = cap_check(f->tmp, 0, n * sizeof(uint64_t));
+    size_t i = 0, j = half, k = 0;
+    while (i < half && j < n) t[k++] = a[j] < a[i] ? a[j++] : a[i++];
+    while (i < half) t[k++] = a[i++];
+    while (j < n) t[k++] = a[j++];
+    memcpy(a, t, n * sizeof(uint64_t));
+}
+
+static void sort_copy_chunk(ws_worker_t *w, cap_ptr_t capture, size_t lo, size_t hi) {
+    (void)w;
+    const sort_state_t *s = CAP_OBJ(capture, sort_state_t);
+    memcpy(cap_check(s->keys, lo * sizeof(uint64_t), (hi - lo) * sizeof(uint64_t)),
+           cap_check(s->input, lo * sizeof(uint64_t), (hi - lo) * sizeof(uint64_t)),
+           (hi - lo) * sizeof(uint64_t));
+}
+
+static void sort_root(ws_worker_t *w, cap_ptr_t state, size_t grain) {
+    sort_state_t *s = CAP_OBJ(state, sort_state_t);
+    ws_parallel_for(w, 0, s->n, grain, sort_copy_chunk, state);
+    sort_frame_t f = { s->keys, s->tmp, s->n };
+    sort_task(w, cap_make(&f, sizeof(f)));
+}
+
+static uint64_t sort_check(cap_ptr_t state) {
+    sort_state_t *s = CAP_OBJ(state, sort_state_t);
+    const uint64_t *a = cap_check(s->keys, 0, s->n * sizeof(uint64_t));
+    uint64_t h = 0;
+    for (size_t i = 0; i < s->n; i++) {
+        if (i > 0 && a[i] < a[i - 1]) return 0;
+        h = mix64(h, a[i]);
+    }
+    return h;
+}
+
+static void sort_teardown(cap_ptr_t state) {
+    sort_state_t *s = CAP_OBJ(state, sort_state_t);
+    cap_free(s->input);
+    cap_free(s->keys);
+    cap_free(s->tmp);
+    cap_free(state);
+}
+
+// ---------------------------------------------------------------------------
+// jacobi: stencil sweeps over per-row capabilities
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    size_t size;                // size x size grid, boundary held fixed
+    cap_ptr_t initial;          // double[size * size]
+    cap_ptr_t storage[2];       // double[size * size]
+    cap_ptr_t rows[2];          // cap_ptr_t[size], each bounded to one row of storage
+    int current;                // Buffer holding the latest sweep
+    double delta;               // Largest update of the last sweep
+} jacobi_state_t;
+
+static cap_ptr_t jacobi_setup(const config_t *cfg) {
+    cap_ptr_t state = cap_malloc(sizeof(jacobi_state_t));
+    if (cap_is_null(state)) return state;
+    jacobi_state_t *s = CAP_OBJ(state, jacobi_state_t);
+    memset(s, 0, sizeof(*s));
+    s->size = (size_t)(JACOBI_SIZE * sqrt(cfg->scale));
+    if (s->size < 8) s->size = 8;
+    size_t bytes = s->size * s->size * sizeof(double);
+    s->initial = cap_malloc(bytes);
+    int failed = cap_is_null(s->initial);
+    for (int b = 0; b < 2; b++) {
+        s->storage[b] = cap_malloc(bytes);
+        s->rows[b] = cap_malloc(s->size * sizeof(cap_ptr_t));
+        failed |= cap_is_null(s->storage[b]) || cap_is_null(s->rows[b]);
+    }
+    if (failed) {
+        cap_free(s->initial);
+        for (int b = 0; b < 2; b++) {
+            cap_free(s->storage[b]);
+            cap_free(s->rows[b]);
+        }
+        cap_free(state);
+        return CAP_NULL;
+    }
+    for (int b = 0; b < 2; b++) {
+        for (size_t r = 0; r < s->size; r++) {
+            CAP_AT(s->rows[b], cap_ptr_t, r) =
+                cap_sub(s->storage[b], r * s->size * sizeof(double), s->size * sizeof(double));
+        }
+    }
+    // Hot top edge over a noisy interior
+    double *g = cap_check(s->initial, 0, bytes);
+    for (size_t i = 0; i < s->size * s->size; i++) g[i] = (double)(bench_rng_next(&rng_state) >> 11) / 9007199254740992.0;
+    for (size_t c = 0; c < s->size; c++) g[c] = 100.0;
+    return state;
+}
+
+static void jacobi_reset_chunk(ws_worker_t *w, cap_ptr_t capture, size_t lo, size_t hi) {
+    (void)w;
+    const jacobi_state_t *s = CAP_OBJ(capture, jacobi_state_t);
+    size_t row_bytes = s->size * sizeof(double);
+    const double *src = cap_check(s->initial, lo * row_bytes, (hi - lo) * row_bytes);
+    for (int b = 0; b < 2; b++) {
+        memcpy(cap_check(s->storage[b], lo * row_bytes, (hi - lo) * row_bytes), src, (hi - lo) * row_bytes);
+    }
+}
+
+static ws_value_t jacobi_chunk(ws_worker_t *w, cap_ptr_t capture, size_t lo, size_t hi) {
+    (void)w;
+    const jacobi_state_t *s = CAP_OBJ(capture, jacobi_state_t);
+    size_t n = s->size;
+    size_t row_bytes = n * sizeof(double);
+    cap_ptr_t from = s->rows[s->current];
+    cap_ptr_t to = s->rows[s->current ^ 1];
+    ws_value_t delta = { .d = 0.0 };
+
+    for (size_t r = lo; r < hi; r++) {
+        const double *up = cap_check(CAP_AT(from, cap_ptr_t, r - 1), 0, row_bytes);
+        const double *mid = cap_check(CAP_AT(from, cap_ptr_t, r), 0, row_bytes);
+        const double *down = cap_check(CAP_AT(from, cap_ptr_t, r + 1), 0, row_bytes);
+        double *out = cap_check(CAP_AT(to, cap_ptr_t, r), 0, row_bytes);
+        for (size_t c = 1; c + 1 < n; c++) {
+            double v = 0.25 * (up[c] + down[c] + mid[c - 1] + mid[c + 1]);
+            double d = fabs(v - mid[c]);
+            if (d > delta.d) delta.d = d;
+            out[c] = v;
+        }
+    }
+    return delta;
+}
+
+static void jacobi_root(ws_worker_t *w, cap_ptr_t state, size_t grain) {
+    jacobi_state_t *s = CAP_OBJ(state, jacobi_state_t);
+    ws_value_t zero = { .d = 0.0 };
+    ws_parallel_for(w, 0, s->size, grain, jacobi_reset_chunk, state);
+    s->current = 0;
+    for (int sweep = 0; sweep < JACOBI_SWEEPS; sweep++) {
+        s->delta = ws_parallel_reduce(w, 1, s->size - 1, grain, jacobi_chunk, combine_max, zero, state).d;
+        s->current ^= 1;
+    }
+}
+
+static uint64_t jacobi_check(cap_ptr_t state) {
+    jacobi_state_t *s = CAP_OBJ(state, jacobi_state_t);
+    const double *g = cap_check(s->storage[s->current], 0, s->size * s->size * sizeof(double));
+    uint64_t h = 0, bits;
+    for (size_t i = 0; i < s->size * s->size; i++) {
+        memcpy(&bits, &g[i], sizeof(bits));
+        h = mix64(h, bits);
+    }
+    memcpy(&bits, &s->delta, sizeof(bits));
+    return mix64(h, bits);
+}
+
+static void jacobi_teardown(cap_ptr_t state) {
+    jacobi_state_t *s = CAP_OBJ(state, jacobi_state_t);
+    cap_free(s->initial);
+    for (int b = 0; b < 2; b++) {
+        cap_free(s->storage[b]);
+        cap_free(s->rows[b]);
+    }
+    cap_free(state);
+}
+
+// ---------------------------------------------------------------------------
+// bfs: level-synchronous traversal of a random graph
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    uint32_t vertices;
+    cap_ptr_t offsets;          // uint32_t[vertices + 1]
+    cap_ptr_t edges;            // uint32_t[offsets[vertices]], both directions
+    cap_ptr_t level;            // int32_t[vertices], -1 until reached
+    cap_ptr_t frontier;         // uint32_t[vertices]
+    cap_ptr_t next;             // uint32_t[vertices]
+    size_t frontier_len;
+    size_t next_len;            // Appended atomically
+    int32_t depth;
+} bfs_state_t;
+
+static cap_ptr_t bfs_setup(const config_t *cfg) {
+    cap_ptr_t state = cap_malloc(sizeof(bfs_state_t));
+    if (cap_is_null(state)) return state;
+    bfs_state_t *s = CAP_OBJ(state, bfs_state_t);
+    memset(s, 0, sizeof(*s));
+    double vertices = BFS_VERTICES * cfg->scale;
+    s->vertices = vertices < 16.0 ? 16 : vertices > (double)(1u << 28) ? 1u << 28 : (uint32_t)vertices;
+    size_t pairs = (size_t)s->vertices * BFS_DEGREE / 2;
+    uint32_t *src = malloc(pairs * sizeof(uint32_t));
+    uint32_t *dst = malloc(pairs * sizeof(uint32_t));
+    s->offsets = cap_malloc(((size_t)s->vertices + 1) * sizeof(uint32_t));
+    s->edges = cap_malloc(pairs * 2 * sizeof(uint32_t));
+    s->level = cap_malloc((size_t)s->vertices * sizeof(int32_t));
+    s->frontier = cap_malloc((size_t)s->vertices * sizeof(uint32_t));
+    s->next = cap_malloc((size_t)s->vertices * sizeof(uint32_t));
+    if (!src || !dst || cap_is_null(s->offsets) || cap_is_null(s->edges) || cap_is_null(s->level) ||
+        cap_is_null(s->frontier) || cap_is_null(s->next)) {
+        free(src);
+        free(dst);
+        cap_free(s->offsets);
+        cap_free(s->edges);
+        cap_free(s->level);
+        cap_free(s->frontier);
+        cap_free(s->next);
+        cap_free(state);
+        return CAP_NULL;
+    }
+
+    uint32_t *offsets = cap_check(s->offsets, 0, ((size_t)s->vertices + 1) * sizeof(uint32_t));
+    uint32_t *edges = cap_check(s->edges, 0, pairs * 2 * sizeof(uint32_t));
+    memset(offsets, 0, ((size_t)s->vertices + 1) * sizeof(uint32_t));
+    for (size_t e = 0; e < pairs; e++) {
+        src[e] = (uint32_t)(e / (BFS_DEGREE / 2));
+        dst[e] = (uint32_t)(bench_rng_next(&rng_state) % s->vertices);
+        offsets[src[e] + 1]++;
+        offsets[dst[e] + 1]++;
+    }
+    for (uint32_t v = 0; v < s->vertices; v++) offsets[v + 1] += offsets[v];
+    uint32_t *fill = cap_check(s->next, 0, (size_t)s->vertices * sizeof(uint32_t));  // Scratch until the first run
+    memcpy(fill, offsets, (size_t)s->vertices * sizeof(uint32_t));
+    for (size_t e = 0; e < pairs; e++) {
+        edges[fill[src[e]]++] = dst[e];
+        edges[fill[dst[e]]++] = src[e];
+    }
+    free(src);
+    free(dst);
+    return state;
+}
+
+static void bfs_reset_chunk(ws_worker_t *w, cap_ptr_t capture, size_t lo, size_t hi) {
+    (void)w;
+    const bfs_state_t *s = CAP_OBJ(capture, bfs_state_t);
+    memset(cap_check(s->level, lo * sizeof(int32_t), (hi - lo) * sizeof(int32_t)), 0xFF,
+           (hi - lo) * sizeof(int32_t));
+}
+
+static void bfs_flush(bfs_state_t *s, const uint32_t *found, size_t count) {
+    size_t at = __atomic_fetch_add(&s->next_len, count, __ATOMIC_RELAXED);
+    memcpy(cap_check(s->next, at * sizeof(uint32_t), count * sizeof(uint32_t)), found, count * sizeof(uint32_t));
+}
+
+static void bfs_chunk(ws_worker_t *w, cap_ptr_t capture, size_t lo, size_t hi) {
+    (void)w;
+    bfs_state_t *s = CAP_OBJ(capture, bfs_state_t);
+    const uint32_t *frontier = cap_check(s->frontier, lo * sizeof(uint32_t), (hi - lo) * sizeof(uint32_t));
+    const uint32_t *offsets = cap_check(s->offsets, 0, ((size_t)s->vertices + 1) * sizeof(uint32_t));
+    int32_t *level = cap_check(s->level, 0, (size_t)s->vertices * sizeof(int32_t));
+    uint32_t found[BFS_FLUSH];
+    size_t count = 0;
+
+    for (size_t i = 0; i < hi - lo; i++) {
+        uint32_t u = frontier[i];
+        uint32_t begin = offsets[u];
+        const uint32_t *adj = cap_check(s->edges, begin * sizeof(uint32_t), (offsets[u + 1] - begin) * sizeof(uint32_t));
+        for (uint32_t e = 0; e < offsets[u + 1] - begin; e++) {
+            uint32_t v = adj[e];
+            int32_t expected = -1;
+            if (__atomic_load_n(&level[v], __ATOMIC_RELAXED) < 0 &&
+                __atomic_compare_exchange_n(&level[v], &expected, s->depth + 1, 0, __ATOMIC_RELAXED,
+                                            __ATOMIC_RELAXED)) {
+                found[count++] = v;
+                if (count == BFS_FLUSH) {
+                    bfs_flush(s, found, count);
+                    count = 0;
+                }
+            }
+        }
+    }
+    if (count) bfs_flush(s, found, count);
+}
+
+static void bfs_root(ws_worker_t *w, cap_ptr_t state, size_t grain) {
+    bfs_state_t *s = CAP_OBJ(state, bfs_state_t);
+    ws_parallel_for(w, 0, s->vertices, grain, bfs_reset_chunk, state);
+    CAP_AT(s->level, int32_t, 0) = 0;
+    CAP_AT(s->frontier, uint32_t, 0) = 0;
+    s->frontier_len = 1;
+    s->depth = 0;
+    while (s->frontier_len > 0) {
+        s->next_len = 0;
+        ws_parallel_for(w, 0, s->frontier_len, grain, bfs_chunk, state);
+        cap_ptr_t swap = s->frontier;
+        s->frontier = s->next;
+        s->next = swap;
+        s->frontier_len = s->next_len;
+        s->depth++;
+    }
+}
+
+static uint64_t bfs_check(cap_ptr_t state) {
+    bfs_state_t *s = CAP_OBJ(state, bfs_state_t);
+    const int32_t *level = cap_check(s->level, 0, (size_t)s->vertices * sizeof(int32_t));
+    uint64_t reached = 0, sum = 0;
+    for (uint32_t v = 0; v < s->vertices; v++) {
+        if (level[v] >= 0) {
+            reached++;
+            sum += (uint64_t)level[v];
+        }
+    }
+    return mix64(mix64(reached, sum), (uint64_t)s->depth);
+}
+
+static void bfs_teardown(cap_ptr_t state) {
+    bfs_state_t *s = CAP_OBJ(state, bfs_state_t);
+    cap_free(s->offsets);
+    cap_free(s->edges);
+    cap_free(s->level);
+    cap_free(s->frontier);
+    cap_free(s->next);
+    cap_free(state);
+}
+
+// ---------------------------------------------------------------------------
+// Driver
+// ---------------------------------------------------------------------------
+
+typedef struct {
+    const char *name;
+    cap_ptr_t (*setup)(const config_t *cfg);
+    void (*root)(ws_worker_t *w, cap_ptr_t state, size_t grain);
+    uint64_t (*check)(cap_ptr_t state);
+    void (*teardown)(cap_ptr_t state);
+} kernel_t;
+
+static const kernel_t kernels[] = {
+    { "fib", fib_setup, fib_root, fib_check, fib_teardown },
+    { "http", http_setup, http_root, http_check, http_teardown },
+    { "lz4", lz4_setup, lz4_root, lz4_check, lz4_teardown },
+    { "sort", sort_setup, sort_root, sort_check, sort_teardown },
+    { "jacobi", jacobi_setup, jacobi_root, jacobi_check, jacobi_teardown },
+    { "bfs", bfs_setup, bfs_root, bfs_check, bfs_teardown },
+};
+
+#define KERNEL_COUNT (sizeof(kernels) / sizeof(kernels[0]))
+
+typedef struct {
+    const kernel_t *kernel;
+    cap_ptr_t state;
+    size_t grain;
+} kernel_run_t;
+
+static void kernel_root(ws_worker_t *w, cap_ptr_t capture) {
+    const kernel_run_t *run = CAP_OBJ(capture, kernel_run_t);
+    run->kernel->root(w, run->state, run->grain);
+}
+
+// Best of iterations; returns seconds
+static double time_kernel(ws_pool_t *pool, const kernel_t *k, cap_ptr_t state, size_t grain, int iterations) {
+    kernel_run_t run = { k, state, grain };
+    double best = 0.0;
+    for (int i = 0; i < iterations; i++) {
+        uint64_t start = bench_now_ns();
+        ws_run(pool, kernel_root, cap_make(&run, sizeof(run)));
+        double seconds = bench_seconds(start, bench_now_ns());
+        if (i == 0 || seconds < best) best = seconds;
+    }
+    return best;
+}
+
+typedef struct {
+    uint64_t started_ns;
+} stamp_t;
+
+static void stamp_task(ws_worker_t *w, cap_ptr_t capture) {
+    (void)w;
+    CAP_OBJ(capture, stamp_t)->started_ns = bench_now_ns();
+}
+
+typedef struct {
+    cap_ptr_t samples;          // uint64_t[count]
+    size_t count;
+} steal_probe_t;
+
+// Push one task at a time and leave it for a thief
+static void steal_probe_root(ws_worker_t *w, cap_ptr_t capture) {
+    steal_probe_t *p = CAP_OBJ(capture, steal_probe_t);
+    for (size_t i = 0; i < p->count; i++) {
+        stamp_t stamp = { 0 };
+        ws_task_t task;
+        uint64_t pushed = bench_now_ns();
+        ws_spawn(w, &task, stamp_task, cap_make(&stamp, sizeof(stamp)));
+        for (unsigned spins = 1; !__atomic_load_n(&task.done, __ATOMIC_ACQUIRE); spins++) {
+            if (spins % WS_IDLE_SPINS == 0) {
+                sched_yield();
+            } else {
+                WS_CPU_RELAX();
+            }
+        }
+        ws_sync(w, &task);
+        CAP_AT(p->samples, uint64_t, i) = stamp.started_ns - pushed;
+    }
+}
+
+static void measure_overhead(ws_pool_t *pool, const config_t *cfg, int iterations) {
+    double serial = 0.0;
+    uint64_t expect = 0;
+    for (int i = 0; i < iterations; i++) {
+        uint64_t start = bench_now_ns();
+        expect = fib_serial(cfg->fib_n);
+        double seconds = bench_seconds(start, bench_now_ns());
+        if (i == 0 || seconds < serial) serial = seconds;
+    }
+    cap_ptr_t state = fib_setup(cfg);
+    if (cap_is_null(state)) return;
+    ws_pool_reset_stats(pool);
+    double tasked = time_kernel(pool, &kernels[0], state, 0, iterations);
+    ws_stats_t stats;
+    ws_pool_stats(pool, &stats);
+    uint64_t tasks = (stats.spawned + stats.inlined) / (uint64_t)iterations;
+    if (fib_check(state) != expect) printf("  fib(%d) mismatch: %llu\n", cfg->fib_n, (unsigned long long)fib_check(state));
+    fib_teardown(state);
+
+    bench_report("spawn_sync_ns_per_task", tasks ? tasked * 1e9 / (double)tasks : 0.0, "ns");
+    bench_report("spawn_overhead_ns", tasks ? (tasked - serial) * 1e9 / (double)tasks : 0.0, "ns");
+}
+
+static void measure_steal_latency(ws_pool_t *pool) {
+    steal_probe_t probe = { cap_malloc(STEAL_SAMPLES * sizeof(uint64_t)), STEAL_SAMPLES };
+    if (cap_is_null(probe.samples)) return;
+    ws_run(pool, steal_probe_root, cap_make(&probe, sizeof(probe)));
+    uint64_t *samples = cap_check(probe.samples, 0, STEAL_SAMPLES * sizeof(uint64_t));
+    bench_report("steal_latency_p50_ns", (double)bench_percentile(samples, STEAL_SAMPLES, 50.0), "ns");
+    bench_report("steal_latency_p99_ns", (double)bench_percentile(samples, STEAL_SAMPLES, 99.0), "ns");
+    cap_free(probe.samples);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-t max_threads] [-g grain] [-s scale] [-f fib_n] [-i iterations]\n", prog);
+    fprintf(stderr, "  grain 0 (default) lets parallel_for/reduce split adaptively\n");
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    config_t cfg = { 1.0, DEFAULT_FIB, 0 };
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    long grain = 0;
+    int iterations = DEFAULT_ITERATIONS;
+    int opt;
+
+    cfg.max_threads = cpus > 0 ? (int)cpus : 4;
+    while ((opt = getopt(argc, argv, "t:g:s:f:i:h")) != -1) {
+        switch (opt) {
+        case 't': cfg.max_threads = atoi(optarg); break;
+        case 'g': grain = atol(optarg); break;
+        case 's': cfg.scale = atof(optarg); break;
+        case 'f': cfg.fib_n = atoi(optarg); break;
+        case 'i': iterations = atoi(optarg); break;
+        default: usage(argv[0]);
+        }
+    }
+    if (cfg.max_threads <= 0 || cfg.max_threads > WS_MAX_THREADS || grain < 0 || cfg.scale <= 0.0 ||
+        cfg.scale > 64.0 || cfg.fib_n < 2 || cfg.fib_n > 40 || iterations <= 0) {
+        usage(argv[0]);
+    }
+    if (cfg.max_threads > cpus && cpus > 0) {
+        fprintf(stderr, "Warning: %d threads on %ld CPUs; helpers will time-share\n", cfg.max_threads, cpus);
+    }
+
+    bench_print_header("worksteal", "WORK-STEALING TASK RUNTIME WORKLOAD");
+    cap_ptr_t states[KERNEL_COUNT];
+    for (size_t k = 0; k < KERNEL_COUNT; k++) {
+        states[k] = kernels[k].setup(&cfg);
+        if (cap_is_null(states[k])) {
+            fprintf(stderr, "Out of memory\n");
+            return 1;
+        }
+    }
+    if (grain) {
+        printf("Threads 1..%d, grain %ld, scale %.2f, best of %d\n\n", cfg.max_threads, grain, cfg.scale, iterations);
+    } else {
+        printf("Threads 1..%d, adaptive grain, scale %.2f, best of %d\n\n", cfg.max_threads, cfg.scale, iterations);
+    }
+
+    int counts[16];
+    int count_n = 0;
+    for (int t = 1; t < cfg.max_threads; t *= 2) counts[count_n++] = t;
+    counts[count_n++] = cfg.max_threads;
+
+    double serial[KERNEL_COUNT];
+    uint64_t reference[KERNEL_COUNT];
+    int failed = 0;
+
+    printf("WORKSTEAL RESULTS\n");
+    printf("-------------------------------------------\n");
+    for (int c = 0; c < count_n; c++) {
+        int threads = counts[c];
+        ws_pool_t pool;
+        if (ws_pool_init(&pool, threads) != 0) {
+            fprintf(stderr, "Could not start %d workers\n", threads);
+            ws_pool_destroy(&pool);
+            failed = 1;
+            break;
+        }
+        if (threads == 1) measure_overhead(&pool, &cfg, iterations);
+        if (threads > 1 && threads == cfg.max_threads) measure_steal_latency(&pool);
+
+        for (size_t k = 0; k < KERNEL_COUNT; k++) {
+            ws_pool_reset_stats(&pool);
+            double seconds = time_kernel(&pool, &kernels[k], states[k], (size_t)grain, iterations);
+            uint64_t checksum = kernels[k].check(states[k]);
+            ws_stats_t stats;
+            ws_pool_stats(&pool, &stats);
+            printf("  %-8s %3d threads %9.4f s  %10llu steals%s\n", kernels[k].name, threads, seconds,
+                   (unsigned long long)(stats.stolen / (uint64_t)iterations),
+                   threads > 1 && checksum != reference[k] ? "  CHECKSUM MISMATCH" : "");
+
+            char metric[48];
+            if (threads == 1) {
+                serial[k] = seconds;
+                reference[k] = checksum;
+                snprintf(metric, sizeof(metric), "%s_seconds_t1", kernels[k].name);
+                bench_report(metric, seconds, "s");
+            } else {
+                if (checksum != reference[k]) failed = 1;
+                snprintf(metric, sizeof(metric), "%s_speedup_t%d", kernels[k].name, threads);
+                bench_report(metric, seconds > 0.0 ? serial[k] / seconds : 0.0, "x");
+            }
+        }
+        ws_pool_destroy(&pool);
+    }
+
+    for (size_t k = 0; k < KERNEL_COUNT; k++) kernels[k].teardown(states[k]);
+    bench_report("max_rss", (double)bench_max_rss_bytes(), "bytes");
+    bench_finish();
+    return failed;
+}